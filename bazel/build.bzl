@@ -32,7 +32,7 @@ def cc_test(
     _cc_test(
         linkstatic = True,
         deps = depset(test_main + test_deps + deps).to_list() + select({
-            "@tbox//bazel:libc_musl": [],
+            "@tbox//bazel:system_allocator": [],
             "//conditions:default": ["@mimalloc//:mimalloc"],
         }),
         **kwargs
@@ -0,0 +1,46 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef CPP_GRPC_ADMISSION_POLICY_H
+#define CPP_GRPC_ADMISSION_POLICY_H
+
+#include <memory>
+#include <string>
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include "grpc++/grpc++.h"
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace async_grpc {
+
+// Decides whether an incoming RPC is served. 'Admit()' runs on an event
+// thread once per RPC, after gRPC accepted the call but before the handler is
+// created or, for client streaming RPCs, any request message is read. A
+// rejected RPC is finished right away with the returned status.
+class AdmissionPolicy {
+ public:
+  // Held by an admitted RPC until the RPC is destroyed, e.g. to release a
+  // concurrency slot.
+  class Ticket {
+   public:
+    virtual ~Ticket() = default;
+  };
+
+  virtual ~AdmissionPolicy() = default;
+
+  // 'method' is the fully qualified method name, "/package.Service/Method".
+  virtual ::grpc::Status Admit(const std::string& method,
+                               const ::grpc::ServerContext& context,
+                               std::unique_ptr<Ticket>* ticket) = 0;
+};
+
+}  // namespace async_grpc
+
+#endif  // CPP_GRPC_ADMISSION_POLICY_H
@@ -17,7 +17,14 @@
 #ifndef ASYNC_GRPC_ASYNC_CLIENT_H
 #define ASYNC_GRPC_ASYNC_CLIENT_H
 
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
 
 #include "completion_queue_pool.h"
 #include "src/common/logging.h"
@@ -32,7 +39,10 @@
 #if defined(__GNUC__) || defined(__clang__)
 #pragma GCC diagnostic pop
 #endif
+#include "src/async_grpc/retry.h"
+#include "src/async_grpc/retrying_unary_call.h"
 #include "src/async_grpc/rpc_service_method_traits.h"
+#include "src/common/task.h"
 
 namespace async_grpc {
 
@@ -54,6 +64,20 @@ template <typename RpcServiceMethodConcept,
               RpcServiceMethodTraits<RpcServiceMethodConcept>::StreamType>
 class AsyncClient {};
 
+// Unary call, completed either through the callback or by co_await-ing the
+// result of 'WriteAsync()' from a 'tbox::common::Task':
+//
+//   AsyncClient<Method> client(channel);
+//   const ::grpc::Status& status = co_await client.WriteAsync(request);
+//   if (status.ok()) Use(client.response());
+//
+// The awaiting coroutine continues through its Resumer, e.g. on the event
+// queue of the RPC it serves. Destroying the client cancels a call still in
+// flight and waits for its completion. The callback must therefore not
+// destroy its own client, which would wait for itself; this is checked.
+//
+// With a 'RetryPolicy' the call is retried and hedged as described in
+// 'RetryingUnaryCall'; the callback and the awaiter only see the outcome.
 template <typename RpcServiceMethodConcept>
 class AsyncClient<RpcServiceMethodConcept,
                   ::grpc::internal::RpcMethod::NORMAL_RPC>
@@ -65,54 +89,165 @@ class AsyncClient<RpcServiceMethodConcept,
       std::function<void(const ::grpc::Status&, const ResponseType*)>;
 
  public:
-  AsyncClient(std::shared_ptr<::grpc::Channel> channel, CallbackType callback)
+  class FinishAwaiter {
+   public:
+    explicit FinishAwaiter(AsyncClient* client) : client_(client) {}
+
+    bool await_ready() const {
+      std::lock_guard<std::mutex> lock(client_->mutex_);
+      return !client_->in_flight_;
+    }
+    template <typename Promise>
+    bool await_suspend(std::coroutine_handle<Promise> handle) {
+      std::lock_guard<std::mutex> lock(client_->mutex_);
+      if (!client_->in_flight_) {
+        return false;
+      }
+      client_->continuation_ = handle;
+      client_->resumer_ = tbox::common::ResumerOf(handle);
+      return true;
+    }
+    const ::grpc::Status& await_resume() const { return client_->status_; }
+
+   private:
+    AsyncClient* client_;
+  };
+
+  explicit AsyncClient(std::shared_ptr<::grpc::Channel> channel,
+                       CallbackType callback = nullptr)
+      : AsyncClient(channel, NoRetry(), callback) {}
+
+  AsyncClient(std::shared_ptr<::grpc::Channel> channel,
+              RetryPolicy retry_policy, CallbackType callback = nullptr)
       : channel_(channel),
         callback_(callback),
         completion_queue_(CompletionQueuePool::GetCompletionQueue()),
         rpc_method_name_(RpcServiceMethod::MethodName()),
         rpc_method_(rpc_method_name_.c_str(), RpcServiceMethod::StreamType,
                     channel_),
-        finish_event_(CompletionQueue::ClientEvent::Event::FINISH, this) {}
+        retry_policy_(std::move(retry_policy)) {
+    // A single attempt needs neither; the lookups lock a global map.
+    if (!retry_policy_.budget && retry_policy_.max_attempts > 1) {
+      retry_policy_.budget = RetryBudget::ForChannel(channel_);
+    }
+    if (!retry_policy_.latency && retry_policy_.Hedges()) {
+      retry_policy_.latency =
+          LatencyTracker::ForMethod(channel_, rpc_method_name_);
+    }
+  }
 
-  void WriteAsync(const RequestType& request) {
-    response_reader_ =
-        std::unique_ptr<::grpc::ClientAsyncResponseReader<ResponseType>>(
-            ::grpc::internal::ClientAsyncResponseReaderFactory<
-                ResponseType>::Create(channel_.get(), completion_queue_,
-                                      rpc_method_, &client_context_, request,
-                                      /*start=*/false));
-    response_reader_->StartCall();
-    response_reader_->Finish(&response_, &status_, (void*)&finish_event_);
+  ~AsyncClient() override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (in_flight_) {
+      CHECK(callback_thread_ != std::this_thread::get_id())
+          << "AsyncClient destroyed from its own callback";
+      continuation_ = nullptr;
+      call_->Cancel();
+      finished_.wait(lock, [this] { return !in_flight_; });
+    }
+  }
+
+  // Applies to the following calls, e.g. the 'PropagatedDeadline()' of the
+  // RPC being served.
+  void SetDeadline(
+      std::optional<std::chrono::system_clock::time_point> deadline) {
+    deadline_ = deadline;
   }
 
+  FinishAwaiter WriteAsync(const RequestType& request) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      in_flight_ = true;
+    }
+    // Only retries need the request after 'Start()' returns.
+    const RequestType* call_request = &request;
+    if (retry_policy_.max_attempts > 1) {
+      request_ = request;
+      call_request = &request_;
+    }
+    call_ = std::make_unique<RetryingUnaryCall<ResponseType>>(
+        retry_policy_, deadline_, completion_queue_, this,
+        [this, call_request](::grpc::ClientContext* context,
+                             ::grpc::CompletionQueue* completion_queue) {
+          return std::unique_ptr<::grpc::ClientAsyncResponseReader<
+              ResponseType>>(::grpc::internal::ClientAsyncResponseReaderFactory<
+                             ResponseType>::Create(channel_.get(),
+                                                   completion_queue,
+                                                   rpc_method_, context,
+                                                   *call_request,
+                                                   /*start=*/true));
+        });
+    call_->Start();
+    return FinishAwaiter(this);
+  }
+
+  const ResponseType& response() const { return response_; }
+
   void HandleEvent(const CompletionQueue::ClientEvent& client_event) override {
     switch (client_event.event) {
       case CompletionQueue::ClientEvent::Event::FINISH:
-        HandleFinishEvent(client_event);
+      case CompletionQueue::ClientEvent::Event::ALARM:
+        if (call_->HandleEvent(client_event)) {
+          HandleFinish();
+        }
         break;
       default:
         LOG(FATAL) << "Unhandled event type: " << (int)client_event.event;
     }
   }
 
-  void HandleFinishEvent(const CompletionQueue::ClientEvent& client_event) {
+  void HandleFinish() {
+    status_ = call_->status();
+    response_ = std::move(*call_->mutable_response());
     if (callback_) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        callback_thread_ = std::this_thread::get_id();
+      }
       callback_(status_, status_.ok() ? &response_ : nullptr);
     }
+    std::coroutine_handle<> continuation;
+    tbox::common::Resumer resumer;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      in_flight_ = false;
+      callback_thread_ = std::thread::id();
+      continuation = std::exchange(continuation_, nullptr);
+      resumer = std::move(resumer_);
+      finished_.notify_all();
+    }
+    // The client may be destroyed from here on.
+    if (continuation) {
+      tbox::common::Resume(resumer, continuation);
+    }
   }
 
  private:
-  ::grpc::ClientContext client_context_;
+  static RetryPolicy NoRetry() {
+    RetryPolicy retry_policy;
+    retry_policy.max_attempts = 1;
+    return retry_policy;
+  }
+
   std::shared_ptr<::grpc::Channel> channel_;
   CallbackType callback_;
   ::grpc::CompletionQueue* completion_queue_;
   const std::string rpc_method_name_;
   const ::grpc::internal::RpcMethod rpc_method_;
-  std::unique_ptr<::grpc::ClientAsyncResponseReader<ResponseType>>
-      response_reader_;
-  CompletionQueue::ClientEvent finish_event_;
+  RetryPolicy retry_policy_;
+  std::optional<std::chrono::system_clock::time_point> deadline_;
+  RequestType request_;
+  std::unique_ptr<RetryingUnaryCall<ResponseType>> call_;
   ::grpc::Status status_;
   ResponseType response_;
+
+  std::mutex mutex_;
+  std::condition_variable finished_;
+  bool in_flight_ = false;
+  // Set while the callback runs, to catch it destroying this client.
+  std::thread::id callback_thread_;
+  std::coroutine_handle<> continuation_;
+  tbox::common::Resumer resumer_;
 };
 
 template <typename RpcServiceMethodConcept>
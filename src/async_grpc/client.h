@@ -17,7 +17,10 @@
 #ifndef CPP_GRPC_CLIENT_H
 #define CPP_GRPC_CLIENT_H
 
+#include <chrono>
+#include <memory>
 #include <optional>
+#include <utility>
 
 #include "src/common/logging.h"
 #if defined(__GNUC__) || defined(__clang__)
@@ -25,13 +28,16 @@
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
 #endif
 #include "grpc++/grpc++.h"
+#include "grpc++/impl/codegen/async_unary_call.h"
 #include "grpc++/impl/codegen/client_unary_call.h"
 #include "grpc++/impl/codegen/proto_utils.h"
 #include "grpc++/impl/codegen/sync_stream.h"
 #if defined(__GNUC__) || defined(__clang__)
 #pragma GCC diagnostic pop
 #endif
+#include "src/async_grpc/completion_queue_pool.h"
 #include "src/async_grpc/retry.h"
+#include "src/async_grpc/retrying_unary_call.h"
 #include "src/async_grpc/rpc_handler_interface.h"
 #include "src/async_grpc/rpc_service_method_traits.h"
 
@@ -71,25 +77,57 @@ class Client<RpcServiceMethodConcept, ::grpc::internal::RpcMethod::NORMAL_RPC> {
         rpc_method_(rpc_method_name_.c_str(), RpcServiceMethod::StreamType,
                     channel_),
         timeout_(timeout),
-        retry_strategy_(retry_strategy) {}
+        retry_strategy_(retry_strategy) {
+    if (retry_strategy_) {
+      retry_budget_ = RetryBudget::ForChannel(channel_);
+    }
+  }
+
+  // Retries and hedges as described in 'RetryingUnaryCall'.
+  Client(std::shared_ptr<::grpc::Channel> channel, RetryPolicy retry_policy)
+      : Client(channel) {
+    SetRetryPolicy(std::move(retry_policy));
+  }
+
+  Client(std::shared_ptr<::grpc::Channel> channel, common::Duration timeout,
+         RetryPolicy retry_policy)
+      : Client(channel, timeout) {
+    SetRetryPolicy(std::move(retry_policy));
+  }
+
+  // Bounds the following 'Write's in addition to the timeout, e.g. with the
+  // 'PropagatedDeadline()' of the RPC being served.
+  void SetDeadline(
+      std::optional<std::chrono::system_clock::time_point> deadline) {
+    deadline_ = deadline;
+  }
 
   bool Write(const RequestType& request, ::grpc::Status* status = nullptr) {
     ::grpc::Status internal_status;
-    std::optional<std::chrono::system_clock::time_point> deadline;
+    std::optional<std::chrono::system_clock::time_point> deadline = deadline_;
     if (timeout_.has_value()) {
-      deadline =
+      const auto timeout_deadline =
           std::chrono::system_clock::now() +
           std::chrono::duration_cast<std::chrono::system_clock::duration>(
               timeout_.value());
+      if (!deadline.has_value() || timeout_deadline < deadline.value()) {
+        deadline = timeout_deadline;
+      }
+    }
+    bool result;
+    if (retry_policy_.has_value()) {
+      result = WriteWithPolicy(request, deadline, &internal_status);
+    } else {
+      client_context_ = ResetContext(deadline);
+      result = RetryWithStrategy(
+          retry_strategy_,
+          [this, &request, &internal_status] {
+            WriteImpl(request, &internal_status);
+            return internal_status;
+          },
+          [this, deadline] { client_context_ = ResetContext(deadline); },
+          retry_budget_);
     }
-    client_context_ = ResetContext(deadline);
-    bool result = RetryWithStrategy(
-        retry_strategy_,
-        [this, &request, &internal_status] {
-          WriteImpl(request, &internal_status);
-          return internal_status;
-        },
-        [this, deadline] { client_context_ = ResetContext(deadline); });
     if (status != nullptr) {
       *status = internal_status;
     }
@@ -108,6 +146,54 @@ class Client<RpcServiceMethodConcept, ::grpc::internal::RpcMethod::NORMAL_RPC> {
     return context;
   }
 
+  void SetRetryPolicy(RetryPolicy retry_policy) {
+    if (!retry_policy.budget && retry_policy.max_attempts > 1) {
+      retry_policy.budget = RetryBudget::ForChannel(channel_);
+    }
+    if (!retry_policy.latency && retry_policy.Hedges()) {
+      retry_policy.latency =
+          LatencyTracker::ForMethod(channel_, rpc_method_name_);
+    }
+    retry_policy_ = std::move(retry_policy);
+  }
+
+  // Runs the attempts asynchronously on a private completion queue, so that
+  // hedges can overlap and losers can be cancelled.
+  bool WriteWithPolicy(
+      const RequestType& request,
+      std::optional<std::chrono::system_clock::time_point> deadline,
+      ::grpc::Status* status) {
+    ::grpc::CompletionQueue completion_queue;
+    RetryingUnaryCall<ResponseType> call(
+        retry_policy_.value(), deadline, &completion_queue,
+        /*async_client=*/nullptr,
+        [this, &request](::grpc::ClientContext* context,
+                         ::grpc::CompletionQueue* completion_queue) {
+          return std::unique_ptr<::grpc::ClientAsyncResponseReader<
+              ResponseType>>(::grpc::internal::ClientAsyncResponseReaderFactory<
+                             ResponseType>::Create(channel_.get(),
+                                                   completion_queue,
+                                                   rpc_method_, context,
+                                                   request, /*start=*/true));
+        });
+    call.Start();
+    void* tag;
+    bool ok;
+    while (completion_queue.Next(&tag, &ok)) {
+      auto* client_event = static_cast<CompletionQueue::ClientEvent*>(tag);
+      client_event->ok = ok;
+      if (call.HandleEvent(*client_event)) {
+        break;
+      }
+    }
+    completion_queue.Shutdown();
+    while (completion_queue.Next(&tag, &ok)) {
+    }
+    *status = call.status();
+    response_ = std::move(*call.mutable_response());
+    return status->ok();
+  }
+
   bool WriteImpl(const RequestType& request, ::grpc::Status* status) {
     auto status_normal_rpc = MakeBlockingUnaryCall(request, &response_);
     if (status != nullptr) {
@@ -126,9 +212,12 @@ class Client<RpcServiceMethodConcept, ::grpc::internal::RpcMethod::NORMAL_RPC> {
   const std::string rpc_method_name_;
   const ::grpc::internal::RpcMethod rpc_method_;
   std::optional<common::Duration> timeout_;
+  std::optional<std::chrono::system_clock::time_point> deadline_;
 
   ResponseType response_;
   RetryStrategy retry_strategy_;
+  std::shared_ptr<RetryBudget> retry_budget_;
+  std::optional<RetryPolicy> retry_policy_;
 };
 
 template <typename RpcServiceMethodConcept>
@@ -0,0 +1,80 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef CPP_GRPC_COMMON_SHARDED_H_
+#define CPP_GRPC_COMMON_SHARDED_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+namespace async_grpc {
+namespace common {
+
+// Destructive interference distance assumed for shard padding.
+constexpr size_t kCacheLineSize = 64;
+
+// A small per-thread index, assigned on a thread's first call. Threads that
+// start one after another, such as the event threads of a server, get
+// consecutive slots and so distinct shards.
+inline size_t ThreadSlot() {
+  static std::atomic<size_t> next_slot{0};
+  thread_local const size_t slot =
+      next_slot.fetch_add(1, std::memory_order_relaxed);
+  return slot;
+}
+
+// State split into 'kShards' cache-line-aligned copies, one per thread slot,
+// for data that many threads update and that is only read in aggregate,
+// e.g. per-method counters. Updates lock only the calling thread's shard,
+// which no other thread touches as long as there are at most 'kShards'
+// threads; readers visit every shard.
+template <typename T, size_t kShards = 64>
+class Sharded {
+ public:
+  Sharded() = default;
+  Sharded(const Sharded&) = delete;
+  Sharded& operator=(const Sharded&) = delete;
+
+  // Calls 'fn(T&)' on the calling thread's shard and returns its result.
+  template <typename F>
+  decltype(auto) WithLocal(F&& fn) {
+    Shard& shard = shards_[ThreadSlot() % kShards];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return fn(shard.value);
+  }
+
+  // Calls 'fn(const T&)' on every shard in turn, e.g. to sum them up.
+  template <typename F>
+  void ForEach(F&& fn) const {
+    for (const Shard& shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      fn(shard.value);
+    }
+  }
+
+  // Calls 'fn(T&)' on every shard in turn, e.g. to reset them.
+  template <typename F>
+  void ForEachMutable(F&& fn) {
+    for (Shard& shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      fn(shard.value);
+    }
+  }
+
+ private:
+  struct alignas(kCacheLineSize) Shard {
+    mutable std::mutex mutex;
+    T value{};
+  };
+
+  std::array<Shard, kShards> shards_;
+};
+
+}  // namespace common
+}  // namespace async_grpc
+
+#endif  // CPP_GRPC_COMMON_SHARDED_H_
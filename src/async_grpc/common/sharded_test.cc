@@ -0,0 +1,93 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/async_grpc/common/sharded.h"
+
+#include <cstdint>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace async_grpc {
+namespace common {
+namespace {
+
+TEST(ShardedTest, ForEachMergesUpdatesFromAllThreads) {
+  Sharded<uint64_t, 4> counter;
+  constexpr int kThreads = 8;
+  constexpr int kUpdates = 10000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    // More threads than shards, so some of them share one.
+    threads.emplace_back([&counter] {
+      for (int j = 0; j < kUpdates; ++j) {
+        counter.WithLocal([](uint64_t& value) { ++value; });
+      }
+    });
+  }
+  // Reads while the updates run see a consistent partial sum.
+  uint64_t partial = 0;
+  counter.ForEach([&partial](const uint64_t& value) { partial += value; });
+  EXPECT_LE(partial, static_cast<uint64_t>(kThreads) * kUpdates);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  uint64_t sum = 0;
+  counter.ForEach([&sum](const uint64_t& value) { sum += value; });
+  EXPECT_EQ(sum, static_cast<uint64_t>(kThreads) * kUpdates);
+}
+
+TEST(ShardedTest, ThreadsUseTheirOwnShard) {
+  Sharded<std::set<std::thread::id>, 64> seen;
+  constexpr int kThreads = 4;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&seen] {
+      seen.WithLocal([](std::set<std::thread::id>& ids) {
+        ids.insert(std::this_thread::get_id());
+      });
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  int shards = 0;
+  seen.ForEach([&shards](const std::set<std::thread::id>& ids) {
+    EXPECT_LE(ids.size(), 1u);
+    shards += ids.size();
+  });
+  EXPECT_EQ(shards, kThreads);
+}
+
+TEST(ShardedTest, WithLocalReturnsResult) {
+  Sharded<int> counter;
+  EXPECT_EQ(counter.WithLocal([](int& value) { return ++value; }), 1);
+  EXPECT_EQ(counter.WithLocal([](int& value) { return ++value; }), 2);
+}
+
+TEST(ShardedTest, ForEachMutableVisitsEveryShard) {
+  Sharded<int, 8> counter;
+  int visits = 0;
+  counter.ForEachMutable([&visits](int& value) {
+    value = 1;
+    ++visits;
+  });
+  EXPECT_EQ(visits, 8);
+  counter.WithLocal([](int& value) { value += 1; });
+  int sum = 0;
+  counter.ForEach([&sum](const int& value) { sum += value; });
+  EXPECT_EQ(sum, 9);
+
+  counter.ForEachMutable([](int& value) { value = 0; });
+  sum = 0;
+  counter.ForEach([&sum](const int& value) { sum += value; });
+  EXPECT_EQ(sum, 0);
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace async_grpc
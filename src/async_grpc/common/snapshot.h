@@ -0,0 +1,118 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef CPP_GRPC_COMMON_SNAPSHOT_H_
+#define CPP_GRPC_COMMON_SNAPSHOT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace async_grpc {
+namespace common {
+
+namespace internal {
+
+// Global publication counter, so a version identifies a value across all
+// 'Snapshot's.
+inline std::atomic<uint64_t> g_snapshot_version{0};
+
+struct CachedSnapshot {
+  uint64_t version = 0;
+  std::shared_ptr<const void> value;
+};
+
+// This thread's last seen value of each 'Snapshot', keyed by its id.
+inline std::unordered_map<uint64_t, CachedSnapshot>& SnapshotCache() {
+  thread_local std::unordered_map<uint64_t, CachedSnapshot> cache;
+  return cache;
+}
+
+}  // namespace internal
+
+// An immutable value replaced as a whole, RCU style, for read-mostly state
+// such as configuration or a certificate manifest. Writers publish a new
+// 'std::shared_ptr<const T>'; readers keep the one they got for as long as
+// they use it, so a value is freed once the last reader moved on.
+//
+// 'Get()' returns this thread's cached copy after comparing one atomic
+// version. It writes no shared memory, so reads scale with the number of
+// threads. 'Load()' takes a lock and returns shared ownership, for values
+// held across a suspension or handed to another thread.
+template <typename T>
+class Snapshot {
+ public:
+  explicit Snapshot(std::shared_ptr<const T> value)
+      : id_(next_id_.fetch_add(1, std::memory_order_relaxed)) {
+    Store(std::move(value));
+  }
+  ~Snapshot() {
+    // Only this thread's cache can be cleaned up; other threads release the
+    // last value they read on exit.
+    internal::SnapshotCache().erase(id_);
+  }
+  Snapshot(const Snapshot&) = delete;
+  Snapshot& operator=(const Snapshot&) = delete;
+
+  // The current value. The reference stays valid until this thread calls
+  // 'Get()' on this snapshot again.
+  const T& Get() const {
+    const uint64_t version = version_.load(std::memory_order_acquire);
+    internal::CachedSnapshot& cached = internal::SnapshotCache()[id_];
+    if (cached.version != version) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      cached.value = value_;
+      cached.version = current_version_;
+    }
+    return *static_cast<const T*>(cached.value.get());
+  }
+
+  std::shared_ptr<const T> Load() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return value_;
+  }
+
+  // Publishes 'value'; readers switch to it on their next 'Get()'.
+  void Store(std::shared_ptr<const T> value) {
+    std::shared_ptr<const T> old;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      old = std::exchange(value_, std::move(value));
+      current_version_ = internal::g_snapshot_version.fetch_add(
+                             1, std::memory_order_relaxed) +
+                         1;
+      version_.store(current_version_, std::memory_order_release);
+    }
+    // 'old' is released outside the lock.
+  }
+
+  // Publishes a modified copy of the current value. Concurrent 'Update()'s
+  // are serialized, so none of them is lost.
+  template <typename F>
+  void Update(F&& fn) {
+    std::lock_guard<std::mutex> update_lock(update_mutex_);
+    auto next = std::make_shared<T>(*Load());
+    fn(next.get());
+    Store(std::move(next));
+  }
+
+ private:
+  static inline std::atomic<uint64_t> next_id_{1};
+
+  const uint64_t id_;
+  std::atomic<uint64_t> version_{0};
+  mutable std::mutex mutex_;
+  std::mutex update_mutex_;
+  std::shared_ptr<const T> value_;
+  uint64_t current_version_ = 0;
+};
+
+}  // namespace common
+}  // namespace async_grpc
+
+#endif  // CPP_GRPC_COMMON_SNAPSHOT_H_
@@ -0,0 +1,118 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/async_grpc/common/snapshot.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+namespace async_grpc {
+namespace common {
+namespace {
+
+TEST(SnapshotTest, GetSeesOldValueUntilStore) {
+  Snapshot<std::string> snapshot(std::make_shared<const std::string>("old"));
+  const std::string& before = snapshot.Get();
+  EXPECT_EQ(before, "old");
+
+  snapshot.Store(std::make_shared<const std::string>("new"));
+  // The cached value outlives the publication until the next 'Get()'.
+  EXPECT_EQ(before, "old");
+  EXPECT_EQ(*snapshot.Load(), "new");
+  EXPECT_EQ(snapshot.Get(), "new");
+}
+
+TEST(SnapshotTest, ReaderSwitchesOnceAfterStore) {
+  Snapshot<int> snapshot(std::make_shared<const int>(1));
+  std::atomic<bool> started{false};
+  std::thread reader([&] {
+    int last = snapshot.Get();
+    started = true;
+    while (last != 2) {
+      const int value = snapshot.Get();
+      // Never back to the old value once the new one was seen.
+      ASSERT_GE(value, last);
+      last = value;
+    }
+    EXPECT_EQ(snapshot.Get(), 2);
+  });
+  while (!started) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(snapshot.Get(), 1);
+  snapshot.Store(std::make_shared<const int>(2));
+  reader.join();
+}
+
+TEST(SnapshotTest, UpdateLosesNoWrite) {
+  Snapshot<int> snapshot(std::make_shared<const int>(0));
+  constexpr int kThreads = 4;
+  constexpr int kUpdates = 1000;
+  std::thread threads[kThreads];
+  for (std::thread& thread : threads) {
+    thread = std::thread([&snapshot] {
+      for (int i = 0; i < kUpdates; ++i) {
+        snapshot.Update([](int* value) { ++*value; });
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(snapshot.Get(), kThreads * kUpdates);
+}
+
+TEST(SnapshotTest, StaleCacheEntryIsNotReused) {
+  auto first = std::make_unique<Snapshot<int>>(std::make_shared<const int>(1));
+  EXPECT_EQ(first->Get(), 1);
+  first.reset();
+  // A later snapshot never sees the entry its predecessor left behind, even
+  // at the same address.
+  auto second = std::make_unique<Snapshot<int>>(std::make_shared<const int>(2));
+  EXPECT_EQ(second->Get(), 2);
+}
+
+TEST(SnapshotTest, OtherThreadsReleaseStaleEntriesOnExit) {
+  auto value = std::make_shared<const int>(1);
+  std::weak_ptr<const int> watch = value;
+  auto snapshot = std::make_unique<Snapshot<int>>(std::move(value));
+  std::atomic<int> step{0};
+  std::thread reader([&] {
+    EXPECT_EQ(snapshot->Get(), 1);
+    step = 1;
+    while (step != 2) {
+      std::this_thread::yield();
+    }
+  });
+  while (step != 1) {
+    std::this_thread::yield();
+  }
+  snapshot.reset();
+  // The reader's cache still holds the value of the destroyed snapshot...
+  EXPECT_FALSE(watch.expired());
+  step = 2;
+  reader.join();
+  // ...until the reader exits.
+  EXPECT_TRUE(watch.expired());
+}
+
+TEST(SnapshotTest, DestructionDropsOwnThreadEntry) {
+  auto value = std::make_shared<const int>(1);
+  std::weak_ptr<const int> watch = value;
+  auto snapshot = std::make_unique<Snapshot<int>>(std::move(value));
+  EXPECT_EQ(snapshot->Get(), 1);
+  const size_t entries = internal::SnapshotCache().size();
+  snapshot.reset();
+  EXPECT_EQ(internal::SnapshotCache().size(), entries - 1);
+  EXPECT_TRUE(watch.expired());
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace async_grpc
@@ -38,7 +38,7 @@ class AsyncClientInterface;
 class CompletionQueue {
  public:
   struct ClientEvent {
-    enum class Event { FINISH = 0, READ = 1, WRITE = 2 };
+    enum class Event { FINISH = 0, READ = 1, WRITE = 2, ALARM = 3 };
     ClientEvent(Event event, AsyncClientInterface* async_client)
         : event(event), async_client(async_client) {}
     Event event;
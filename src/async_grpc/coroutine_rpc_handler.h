@@ -0,0 +1,72 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef CPP_GRPC_COROUTINE_RPC_HANDLER_H
+#define CPP_GRPC_COROUTINE_RPC_HANDLER_H
+
+#include <algorithm>
+#include <exception>
+#include <vector>
+
+#include "src/async_grpc/rpc.h"
+#include "src/async_grpc/rpc_handler.h"
+#include "src/common/logging.h"
+#include "src/common/task.h"
+
+namespace async_grpc {
+
+// An 'RpcHandler' whose requests are handled by a coroutine. While it awaits
+// (an 'AsyncClient', a worker pool, ...) the event thread serves other RPCs;
+// it continues through the RPC's event queue, so it never runs concurrently
+// with the RPC's other events. The coroutine ends the RPC itself with
+// 'Send()' or 'Finish()'. If the RPC goes away first, for instance because
+// the client cancelled, the suspended coroutine is destroyed. If it throws,
+// the RPC is finished with INTERNAL, so it must not throw after finishing.
+//
+// For NORMAL_RPC and SERVER_STREAMING the request stays valid for the
+// lifetime of the coroutine; streaming requests must be copied before the
+// first suspension.
+template <typename RpcServiceMethodConcept>
+class CoroutineRpcHandler : public RpcHandler<RpcServiceMethodConcept> {
+ public:
+  using RequestType =
+      typename RpcHandler<RpcServiceMethodConcept>::RequestType;
+
+  virtual tbox::common::Task<void> OnRequestAsync(
+      const RequestType& request) = 0;
+
+  void OnRequest(const RequestType& request) final {
+    tasks_.erase(std::remove_if(tasks_.begin(), tasks_.end(),
+                                [](const tbox::common::Task<void>& task) {
+                                  return task.done();
+                                }),
+                 tasks_.end());
+    tasks_.push_back(Run(request));
+    tasks_.back().Start(this->GetRpc()->GetResumer());
+  }
+
+ private:
+  // Nothing awaits a root task's result, so an exception left in it would
+  // never finish the RPC and the client would wait for its deadline.
+  tbox::common::Task<void> Run(const RequestType& request) {
+    try {
+      co_await OnRequestAsync(request);
+    } catch (const std::exception& e) {
+      LOG(ERROR) << "RPC handler failed: " << e.what();
+      this->Finish(::grpc::Status(::grpc::StatusCode::INTERNAL,
+                                  "internal error"));
+    } catch (...) {
+      LOG(ERROR) << "RPC handler failed with an unknown exception";
+      this->Finish(::grpc::Status(::grpc::StatusCode::INTERNAL,
+                                  "internal error"));
+    }
+  }
+
+  std::vector<tbox::common::Task<void>> tasks_;
+};
+
+}  // namespace async_grpc
+
+#endif  // CPP_GRPC_COROUTINE_RPC_HANDLER_H
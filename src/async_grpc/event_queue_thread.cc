@@ -21,7 +21,7 @@
 namespace async_grpc {
 
 EventQueueThread::EventQueueThread() {
-  event_queue_ = std::make_unique<EventQueue>();
+  event_queue_ = std::make_shared<EventQueue>();
 }
 
 EventQueue* EventQueueThread::event_queue() {
@@ -37,7 +37,12 @@ void EventQueueThread::Start(EventQueueRunner runner) {
 
 void EventQueueThread::Shutdown() {
   LOG(INFO) << "Shutting down event queue " << event_queue_.get();
-  thread_->join();
+  if (thread_) {
+    thread_->join();
+  } else {
+    // Never started: the queue was drained by a shared executor.
+    event_queue_->DrainForShutdown();
+  }
 }
 
 }  // namespace async_grpc
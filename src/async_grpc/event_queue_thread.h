@@ -37,7 +37,7 @@ class EventQueueThread {
   void Shutdown();
 
  private:
-  std::unique_ptr<EventQueue> event_queue_;
+  std::shared_ptr<EventQueue> event_queue_;
   std::unique_ptr<std::thread> thread_;
 };
 
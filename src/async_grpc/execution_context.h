@@ -17,6 +17,9 @@
 #ifndef CPP_GRPC_EXECUTION_CONTEXT_H
 #define CPP_GRPC_EXECUTION_CONTEXT_H
 
+#include <mutex>
+#include <shared_mutex>
+
 #include "src/common/logging.h"
 #include "src/async_grpc/common/mutex.h"
 
@@ -27,6 +30,17 @@ namespace async_grpc {
 // 'ExecutionContext' can be specified. This 'ExecutionContext' can be retrieved
 // by all implementations of 'RpcHandler' by calling
 // 'RpcHandler::GetContext<MyContext>()'.
+//
+// 'GetContext()' serializes every RPC touching the context. Contexts shared by
+// many concurrent RPCs have cheaper options:
+//  - 'GetSharedContext()' / 'GetExclusiveContext()': reader/writer locking,
+//    readers run concurrently.
+//  - 'common::Sharded<T>' members for per-thread state read in aggregate,
+//    e.g. counters.
+//  - 'common::Snapshot<T>' members for read-mostly values, e.g.
+//    configuration, read without any lock.
+// The latter two are thread-safe themselves and are reached through
+// 'GetUnsynchronizedContext()'.
 class ExecutionContext {
  public:
   // Automatically locks an ExecutionContext for shared use by RPC handlers.
@@ -47,14 +61,56 @@ class ExecutionContext {
     common::MutexLocker locker_;
     ExecutionContext* execution_context_;
   };
+
+  // Holds 'shared_lock()' in shared mode and gives read-only access. Any
+  // number of RPCs can hold one at the same time.
+  template <typename ContextType>
+  class SharedSynchronized {
+   public:
+    const ContextType* operator->() const {
+      return static_cast<const ContextType*>(execution_context_);
+    }
+    SharedSynchronized(std::shared_mutex* lock,
+                       const ExecutionContext* execution_context)
+        : locker_(*lock), execution_context_(execution_context) {}
+    SharedSynchronized(const SharedSynchronized&) = delete;
+    SharedSynchronized(SharedSynchronized&&) = delete;
+
+   private:
+    std::shared_lock<std::shared_mutex> locker_;
+    const ExecutionContext* execution_context_;
+  };
+
+  // Holds 'shared_lock()' exclusively, for modifying state that readers
+  // access through 'SharedSynchronized'. Note that 'lock()' is a separate
+  // mutex: state must be guarded by one of the two, not a mix.
+  template <typename ContextType>
+  class ExclusiveSynchronized {
+   public:
+    ContextType* operator->() {
+      return static_cast<ContextType*>(execution_context_);
+    }
+    ExclusiveSynchronized(std::shared_mutex* lock,
+                          ExecutionContext* execution_context)
+        : locker_(*lock), execution_context_(execution_context) {}
+    ExclusiveSynchronized(const ExclusiveSynchronized&) = delete;
+    ExclusiveSynchronized(ExclusiveSynchronized&&) = delete;
+
+   private:
+    std::unique_lock<std::shared_mutex> locker_;
+    ExecutionContext* execution_context_;
+  };
+
   ExecutionContext() = default;
   virtual ~ExecutionContext() = default;
   ExecutionContext(const ExecutionContext&) = delete;
   ExecutionContext& operator=(const ExecutionContext&) = delete;
   common::Mutex* lock() { return &lock_; }
+  std::shared_mutex* shared_lock() { return &shared_lock_; }
 
  private:
   common::Mutex lock_;
+  std::shared_mutex shared_lock_;
 };
 
 }  // namespace async_grpc
@@ -0,0 +1,115 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+// Reading shared handler state from 1 to 16 event threads:
+//   Mutex:     ExecutionContext::Synchronized, the server-wide mutex.
+//   Shared:    ExecutionContext::SharedSynchronized, shared std::shared_mutex.
+//   Snapshot:  common::Snapshot<T>::Get(), no lock.
+// and updating a per-RPC counter:
+//   CounterMutex:   one counter under the server-wide mutex.
+//   CounterSharded: common::Sharded<uint64_t>.
+// items_per_second is the aggregate over all threads; with perfect scaling it
+// grows linearly with the thread count.
+//
+//   bazel run -c opt //src/async_grpc:execution_context_benchmark
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "src/async_grpc/common/sharded.h"
+#include "src/async_grpc/common/snapshot.h"
+#include "src/async_grpc/execution_context.h"
+
+namespace async_grpc {
+namespace {
+
+struct Config {
+  std::string server_name = "tbox";
+  int64_t max_body_bytes = 1 << 20;
+};
+
+class BenchmarkContext : public ExecutionContext {
+ public:
+  Config config;
+  uint64_t requests = 0;
+  common::Snapshot<Config> config_snapshot{std::make_shared<Config>()};
+  common::Sharded<uint64_t> sharded_requests;
+};
+
+BenchmarkContext* Context() {
+  static BenchmarkContext* context = new BenchmarkContext();
+  return context;
+}
+
+void BM_ReadMutex(benchmark::State& state) {
+  BenchmarkContext* context = Context();
+  for (auto _ : state) {
+    ExecutionContext::Synchronized<BenchmarkContext> synchronized(
+        context->lock(), context);
+    benchmark::DoNotOptimize(synchronized->config.max_body_bytes);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ReadShared(benchmark::State& state) {
+  BenchmarkContext* context = Context();
+  for (auto _ : state) {
+    ExecutionContext::SharedSynchronized<BenchmarkContext> synchronized(
+        context->shared_lock(), context);
+    benchmark::DoNotOptimize(synchronized->config.max_body_bytes);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ReadSnapshot(benchmark::State& state) {
+  BenchmarkContext* context = Context();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(context->config_snapshot.Get().max_body_bytes);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_CounterMutex(benchmark::State& state) {
+  BenchmarkContext* context = Context();
+  for (auto _ : state) {
+    ExecutionContext::Synchronized<BenchmarkContext> synchronized(
+        context->lock(), context);
+    ++synchronized->requests;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_CounterSharded(benchmark::State& state) {
+  BenchmarkContext* context = Context();
+  for (auto _ : state) {
+    context->sharded_requests.WithLocal([](uint64_t& value) { ++value; });
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ReadMutex)->Name("Read/Mutex")->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_ReadShared)
+    ->Name("Read/Shared")
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK(BM_ReadSnapshot)
+    ->Name("Read/Snapshot")
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK(BM_CounterMutex)
+    ->Name("Counter/Mutex")
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK(BM_CounterSharded)
+    ->Name("Counter/Sharded")
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace async_grpc
+
+BENCHMARK_MAIN();
@@ -0,0 +1,44 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/async_grpc/local_span.h"
+
+#include <utility>
+
+namespace async_grpc {
+
+std::unique_ptr<Span> LocalSpan::StartSpan(const std::string& name) {
+  auto span = tbox::trace::Tracer::Instance()->StartRootSpan(name);
+  if (!span) {
+    return nullptr;
+  }
+  return std::unique_ptr<LocalSpan>(new LocalSpan(std::move(span)));
+}
+
+tbox::trace::Span* LocalSpan::Get(Span* span) {
+  auto* local_span = dynamic_cast<LocalSpan*>(span);
+  return local_span ? local_span->span_.get() : nullptr;
+}
+
+std::unique_ptr<Span> LocalSpan::CreateChildSpan(const std::string& name) {
+  return std::unique_ptr<LocalSpan>(new LocalSpan(span_->StartChild(name)));
+}
+
+void LocalSpan::SetStatus(const ::grpc::Status& status) {
+  span_->AddAttribute("rpc.grpc.status_code",
+                      std::to_string(status.error_code()));
+  if (status.ok()) {
+    span_->SetStatus(tbox::trace::StatusCode::kOk);
+  } else {
+    span_->SetStatus(tbox::trace::StatusCode::kError, status.error_message());
+  }
+}
+
+void LocalSpan::End() { span_->End(); }
+
+LocalSpan::LocalSpan(std::unique_ptr<tbox::trace::Span> span)
+    : span_(std::move(span)) {}
+
+}  // namespace async_grpc
@@ -0,0 +1,40 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef CPP_GRPC_LOCAL_SPAN_H
+#define CPP_GRPC_LOCAL_SPAN_H
+
+#include <memory>
+#include <string>
+
+#include "src/async_grpc/span.h"
+#include "src/common/trace.h"
+
+namespace async_grpc {
+
+// An implementation of the Span interface backed by the in-process tracer of
+// 'src/common/trace.h', whose exporters keep spans in memory for
+// /debug/traces or write them out as OTLP. It needs no tracing backend.
+class LocalSpan : public Span {
+ public:
+  // Starts a root span, nullptr if the sampler skips this RPC.
+  static std::unique_ptr<Span> StartSpan(const std::string& name);
+
+  // The recording span behind 'span', nullptr if there is none.
+  static tbox::trace::Span* Get(Span* span);
+
+  std::unique_ptr<Span> CreateChildSpan(const std::string& name) override;
+  void SetStatus(const ::grpc::Status& status) override;
+  void End() override;
+
+ private:
+  explicit LocalSpan(std::unique_ptr<tbox::trace::Span> span);
+
+  std::unique_ptr<tbox::trace::Span> span_;
+};
+
+}  // namespace async_grpc
+
+#endif  // CPP_GRPC_LOCAL_SPAN_H
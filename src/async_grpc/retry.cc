@@ -16,13 +16,171 @@
 
 #include "src/async_grpc/retry.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <map>
+#include <random>
 #include <thread>
+#include <utility>
 
 #include "src/common/logging.h"
 
 namespace async_grpc {
+namespace {
+
+constexpr double kFirstBucketSeconds = 1e-4;
+constexpr double kBucketGrowth = 1.1;
+
+constexpr size_t kMinSweepSize = 64;
+
+// Values per channel and key, dropped once the channel is gone. Entries of
+// dead channels are swept when the map has doubled since the last sweep, so
+// a lookup costs amortized O(log n).
+template <typename T>
+std::shared_ptr<T> ForChannelKey(
+    const std::shared_ptr<::grpc::Channel>& channel, const std::string& key) {
+  struct Entry {
+    std::weak_ptr<::grpc::Channel> channel;
+    std::shared_ptr<T> value;
+  };
+  static auto* const mutex = new std::mutex;
+  static auto* const entries =
+      new std::map<std::pair<const ::grpc::Channel*, std::string>, Entry>;
+  static size_t sweep_size = kMinSweepSize;
+  std::lock_guard<std::mutex> lock(*mutex);
+  if (entries->size() >= sweep_size) {
+    std::erase_if(*entries, [](const auto& item) {
+      return item.second.channel.expired();
+    });
+    sweep_size = std::max(kMinSweepSize, 2 * entries->size());
+  }
+  Entry& entry = (*entries)[{channel.get(), key}];
+  // A new channel may reuse the address of a dead one.
+  if (!entry.value || entry.channel.expired()) {
+    entry.channel = channel;
+    entry.value = std::make_shared<T>();
+  }
+  return entry.value;
+}
+
+}  // namespace
+
+RetryBudget::RetryBudget(double ratio, double max_tokens)
+    : deposit_(static_cast<int64_t>(ratio * kScale)),
+      capacity_(static_cast<int64_t>(max_tokens * kScale)),
+      tokens_(capacity_) {}
+
+std::shared_ptr<RetryBudget> RetryBudget::ForChannel(
+    const std::shared_ptr<::grpc::Channel>& channel) {
+  return ForChannelKey<RetryBudget>(channel, "");
+}
+
+void RetryBudget::RecordCall() {
+  int64_t tokens = tokens_.load(std::memory_order_relaxed);
+  while (tokens < capacity_ &&
+         !tokens_.compare_exchange_weak(tokens,
+                                        std::min(capacity_, tokens + deposit_),
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+bool RetryBudget::TryRetry() {
+  int64_t tokens = tokens_.load(std::memory_order_relaxed);
+  do {
+    if (tokens < kScale) {
+      return false;
+    }
+  } while (!tokens_.compare_exchange_weak(tokens, tokens - kScale,
+                                          std::memory_order_relaxed));
+  return true;
+}
+
+double RetryBudget::tokens() const {
+  return static_cast<double>(tokens_.load(std::memory_order_relaxed)) /
+         kScale;
+}
+
+std::shared_ptr<LatencyTracker> LatencyTracker::ForMethod(
+    const std::shared_ptr<::grpc::Channel>& channel,
+    const std::string& method_name) {
+  return ForChannelKey<LatencyTracker>(channel, method_name);
+}
+
+void LatencyTracker::Record(Duration latency) {
+  const double seconds = common::ToSeconds(latency);
+  int bucket = 0;
+  if (seconds > kFirstBucketSeconds) {
+    bucket = std::min<int>(
+        kBuckets - 1, static_cast<int>(std::log(seconds / kFirstBucketSeconds) /
+                                       std::log(kBucketGrowth)));
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++counts_[bucket];
+  ++samples_;
+  if (++since_decay_ >= kDecaySamples) {
+    since_decay_ = 0;
+    samples_ = 0;
+    for (int64_t& count : counts_) {
+      count /= 2;
+      samples_ += count;
+    }
+  }
+}
+
+optional<Duration> LatencyTracker::Quantile(double quantile) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (samples_ < kMinSamples) {
+    return std::nullopt;
+  }
+  const int64_t rank = static_cast<int64_t>(std::ceil(quantile * samples_));
+  int64_t seen = 0;
+  int bucket = 0;
+  for (; bucket < kBuckets - 1; ++bucket) {
+    seen += counts_[bucket];
+    if (seen >= rank) {
+      break;
+    }
+  }
+  // The upper bound of the bucket.
+  return common::FromSeconds(kFirstBucketSeconds *
+                             std::pow(kBucketGrowth, bucket + 1));
+}
+
+bool RetryPolicy::IsRetryable(const ::grpc::Status& status) const {
+  return retryable_codes.count(status.error_code()) > 0;
+}
+
+Duration RetryPolicy::Backoff(int failed_attempts) const {
+  CHECK_GE(failed_attempts, 1);
+  const double limit =
+      std::min(common::ToSeconds(max_backoff),
+               common::ToSeconds(initial_backoff) *
+                   std::pow(backoff_multiplier, failed_attempts - 1));
+  thread_local std::mt19937 random(std::random_device{}());
+  return common::FromSeconds(
+      std::uniform_real_distribution<double>(0., limit)(random));
+}
+
+optional<Duration> RetryPolicy::HedgingDelay() const {
+  if (!hedging || !latency) {
+    return std::nullopt;
+  }
+  const optional<Duration> delay = latency->Quantile(hedging_quantile);
+  if (!delay.has_value()) {
+    return std::nullopt;
+  }
+  return std::max(delay.value(), min_hedging_delay);
+}
+
+optional<std::chrono::system_clock::time_point> PropagatedDeadline(
+    const ::grpc::ServerContext& server_context) {
+  const auto deadline = server_context.deadline();
+  if (deadline == std::chrono::system_clock::time_point::max()) {
+    return std::nullopt;
+  }
+  return deadline;
+}
 
 RetryStrategy CreateRetryStrategy(RetryIndicator retry_indicator,
                                   RetryDelayCalculator retry_delay_calculator) {
@@ -92,9 +250,13 @@ RetryStrategy CreateUnlimitedConstantDelayStrategy(
 
 bool RetryWithStrategy(RetryStrategy retry_strategy,
                        std::function<::grpc::Status()> op,
-                       std::function<void()> reset) {
+                       std::function<void()> reset,
+                       std::shared_ptr<RetryBudget> budget) {
   optional<Duration> delay;
   int failed_attemps = 0;
+  if (budget) {
+    budget->RecordCall();
+  }
   for (;;) {
     ::grpc::Status status = op();
     if (status.ok()) {
@@ -107,6 +269,11 @@ bool RetryWithStrategy(RetryStrategy retry_strategy,
     if (!delay.has_value()) {
       break;
     }
+    if (budget && !budget->TryRetry()) {
+      LOG(WARNING) << "Retry budget exhausted, giving up: "
+                   << status.error_message();
+      break;
+    }
     LOG(INFO) << "Retrying after "
               << std::chrono::duration_cast<std::chrono::milliseconds>(
                      delay.value())
@@ -17,7 +17,15 @@
 #ifndef CPP_GRPC_RETRY_H
 #define CPP_GRPC_RETRY_H
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <set>
+#include <string>
 
 #if defined(__GNUC__) || defined(__clang__)
 #pragma GCC diagnostic push
@@ -57,9 +65,111 @@ RetryStrategy CreateUnlimitedConstantDelayStrategy(Duration delay);
 RetryStrategy CreateUnlimitedConstantDelayStrategy(
     Duration delay, const std::set<::grpc::StatusCode>& unrecoverable_codes);
 
+// Caps retries and hedged attempts to a fraction of the calls made on a
+// channel, so that a server brownout is not multiplied by every client
+// retrying. Each call deposits 'ratio' tokens and each extra attempt
+// withdraws one. The bucket holds at most 'max_tokens' and starts full, which
+// lets a quiet channel ride out a short burst of failures.
+// It is thread safe.
+class RetryBudget {
+ public:
+  explicit RetryBudget(double ratio = 0.1, double max_tokens = 10.);
+
+  // The budget shared by all clients of 'channel'.
+  static std::shared_ptr<RetryBudget> ForChannel(
+      const std::shared_ptr<::grpc::Channel>& channel);
+
+  void RecordCall();
+  // Withdraws a token for an extra attempt; false if the budget is spent.
+  bool TryRetry();
+  double tokens() const;
+
+ private:
+  static constexpr int64_t kScale = 1000;
+
+  const int64_t deposit_;
+  const int64_t capacity_;
+  std::atomic<int64_t> tokens_;
+};
+
+// Latency distribution of recent successful calls, from which the hedging
+// delay is taken. Samples are counted in buckets about 10% wide between
+// 100us and one minute; the counts are halved every 'kDecaySamples' samples
+// so that the estimate follows the current latency of the server.
+// It is thread safe.
+class LatencyTracker {
+ public:
+  static constexpr int kMinSamples = 20;
+  static constexpr int kDecaySamples = 1000;
+
+  // The tracker shared by all clients of 'method_name' on 'channel'.
+  static std::shared_ptr<LatencyTracker> ForMethod(
+      const std::shared_ptr<::grpc::Channel>& channel,
+      const std::string& method_name);
+
+  void Record(Duration latency);
+  // The 'quantile' latency, e.g. 0.95, or nothing before 'kMinSamples'.
+  optional<Duration> Quantile(double quantile) const;
+
+ private:
+  static constexpr int kBuckets = 140;
+
+  mutable std::mutex mutex_;
+  std::array<int64_t, kBuckets> counts_{};
+  int64_t samples_ = 0;
+  int64_t since_decay_ = 0;
+};
+
+// Retry and hedging policy for the unary calls of 'Client' and
+// 'AsyncClient'. Every attempt after the first needs a token from 'budget',
+// and no attempt is started or delayed beyond the deadline of the call.
+struct RetryPolicy {
+  // Attempts per call, the first one and hedges included.
+  int max_attempts = 3;
+  std::set<::grpc::StatusCode> retryable_codes = {
+      ::grpc::StatusCode::UNAVAILABLE};
+
+  // Exponential backoff after a failed attempt, with full jitter: the n-th
+  // retry waits a random time up to initial_backoff * multiplier^(n-1).
+  Duration initial_backoff = std::chrono::milliseconds(100);
+  float backoff_multiplier = 2.f;
+  Duration max_backoff = std::chrono::seconds(5);
+
+  // Hedging sends another attempt when the current ones have not answered
+  // within the 'hedging_quantile' latency of recent calls, but no sooner
+  // than 'min_hedging_delay'. The first response wins and the other
+  // attempts are cancelled. Until 'latency' has enough samples no hedge is
+  // sent. Only enable it for idempotent methods.
+  bool hedging = false;
+  double hedging_quantile = 0.95;
+  Duration min_hedging_delay = std::chrono::milliseconds(1);
+
+  // nullptr selects the budget of the channel and the tracker of the
+  // method on it. The clients leave the budget unset for a single attempt
+  // and the tracker unset without hedging, so that calls which cannot
+  // retry skip the lookups; the tracker then only learns from hedged calls.
+  std::shared_ptr<RetryBudget> budget;
+  std::shared_ptr<LatencyTracker> latency;
+
+  // Whether hedges may be sent at all.
+  bool Hedges() const { return hedging && max_attempts > 1; }
+  bool IsRetryable(const ::grpc::Status& status) const;
+  Duration Backoff(int failed_attempts) const;
+  // Nothing if hedging is off or there are not enough samples yet.
+  optional<Duration> HedgingDelay() const;
+};
+
+// The deadline of the call served by 'server_context', to be passed on to
+// the calls made on its behalf so that they stop once the caller gave up.
+// Nothing if the caller set no deadline.
+optional<std::chrono::system_clock::time_point> PropagatedDeadline(
+    const ::grpc::ServerContext& server_context);
+
+// With a 'budget', retries stop early once it is spent.
 bool RetryWithStrategy(RetryStrategy retry_strategy,
                        std::function<::grpc::Status()> op,
-                       std::function<void()> reset = nullptr);
+                       std::function<void()> reset = nullptr,
+                       std::shared_ptr<RetryBudget> budget = nullptr);
 
 }  // namespace async_grpc
 
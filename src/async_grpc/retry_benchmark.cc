@@ -0,0 +1,221 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+// Tail latency of unary calls to an in-process server that injects faults:
+// 3% of the calls answer after 20ms instead of 1ms and 1% fail with
+// UNAVAILABLE.
+//   NoRetry: a single attempt.
+//   Retry:   RetryPolicy with backoff and the channel's retry budget.
+//   Hedged:  Retry plus a hedge after the p95 latency.
+// each through the blocking Client and the AsyncClient. p50_ms, p99_ms and
+// p999_ms are latency quantiles, failed is the share of calls that failed.
+//
+//   bazel run -c opt //src/async_grpc:retry_benchmark
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "google/protobuf/empty.pb.h"
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include "grpc++/grpc++.h"
+#include "grpcpp/alarm.h"
+#include "grpcpp/generic/async_generic_service.h"
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#include "src/async_grpc/async_client.h"
+#include "src/async_grpc/client.h"
+#include "src/async_grpc/completion_queue_pool.h"
+#include "src/async_grpc/retry.h"
+
+namespace async_grpc {
+namespace {
+
+constexpr auto kFastDelay = std::chrono::milliseconds(1);
+constexpr auto kSlowDelay = std::chrono::milliseconds(20);
+constexpr double kSlowRate = 0.03;
+constexpr double kUnavailableRate = 0.01;
+
+struct FaultyMethod {
+  static constexpr const char* MethodName() {
+    return "/async_grpc.benchmark.Faulty/Call";
+  }
+  using IncomingType = google::protobuf::Empty;
+  using OutgoingType = google::protobuf::Empty;
+};
+
+// Answers every method with an empty message, late or not at all.
+class FaultyReactor : public ::grpc::ServerGenericBidiReactor {
+ public:
+  FaultyReactor() { StartRead(&request_); }
+
+  void OnReadDone(bool ok) override {
+    if (!ok) {
+      Finish(::grpc::Status(::grpc::StatusCode::INTERNAL, "no request"));
+      return;
+    }
+    thread_local std::mt19937 random(std::random_device{}());
+    const double draw = std::uniform_real_distribution<double>()(random);
+    if (draw < kUnavailableRate) {
+      Finish(::grpc::Status(::grpc::StatusCode::UNAVAILABLE, "injected"));
+      return;
+    }
+    const auto delay = draw < kUnavailableRate + kSlowRate ? kSlowDelay
+                                                          : kFastDelay;
+    alarm_.Set(std::chrono::system_clock::now() + delay, [this](bool) {
+      ::grpc::Slice empty("");
+      response_ = ::grpc::ByteBuffer(&empty, 1);
+      StartWriteAndFinish(&response_, ::grpc::WriteOptions(),
+                          ::grpc::Status::OK);
+    });
+  }
+
+  void OnDone() override { delete this; }
+
+ private:
+  ::grpc::ByteBuffer request_;
+  ::grpc::ByteBuffer response_;
+  ::grpc::Alarm alarm_;
+};
+
+class FaultyService : public ::grpc::CallbackGenericService {
+ public:
+  ::grpc::ServerGenericBidiReactor* CreateReactor(
+      ::grpc::GenericCallbackServerContext* /* context */) override {
+    return new FaultyReactor();
+  }
+};
+
+const std::string& ServerAddress() {
+  static const std::string* const address = [] {
+    static auto* const service = new FaultyService();
+    int port = 0;
+    ::grpc::ServerBuilder builder;
+    builder.AddListeningPort("127.0.0.1:0", ::grpc::InsecureServerCredentials(),
+                             &port);
+    builder.RegisterCallbackGenericService(service);
+    builder.BuildAndStart().release();
+    CompletionQueuePool::Start();
+    return new std::string("127.0.0.1:" + std::to_string(port));
+  }();
+  return *address;
+}
+
+enum class Mode { kNoRetry, kRetry, kHedged };
+
+RetryPolicy MakeRetryPolicy(Mode mode) {
+  RetryPolicy retry_policy;
+  retry_policy.initial_backoff = std::chrono::milliseconds(2);
+  retry_policy.max_attempts = mode == Mode::kNoRetry ? 1 : 3;
+  retry_policy.hedging = mode == Mode::kHedged;
+  return retry_policy;
+}
+
+// A new channel per run, so that budgets and latency estimates start over.
+std::shared_ptr<::grpc::Channel> NewChannel() {
+  ::grpc::ChannelArguments arguments;
+  arguments.SetInt("benchmark_channel_id", std::random_device{}());
+  return ::grpc::CreateCustomChannel(
+      ServerAddress(), ::grpc::InsecureChannelCredentials(), arguments);
+}
+
+void Report(benchmark::State& state, std::vector<double> latencies_ms,
+            int64_t failed) {
+  std::sort(latencies_ms.begin(), latencies_ms.end());
+  auto quantile = [&latencies_ms](double q) {
+    return latencies_ms[std::min<size_t>(
+        latencies_ms.size() - 1,
+        static_cast<size_t>(std::ceil(q * latencies_ms.size())))];
+  };
+  state.counters["p50_ms"] = quantile(0.5);
+  state.counters["p99_ms"] = quantile(0.99);
+  state.counters["p999_ms"] = quantile(0.999);
+  state.counters["failed"] =
+      static_cast<double>(failed) / static_cast<double>(latencies_ms.size());
+}
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+void BM_Blocking(benchmark::State& state, Mode mode) {
+  Client<FaultyMethod> client(NewChannel(), MakeRetryPolicy(mode));
+  google::protobuf::Empty request;
+  std::vector<double> latencies_ms;
+  int64_t failed = 0;
+  for (auto _ : state) {
+    const auto start = std::chrono::steady_clock::now();
+    failed += client.Write(request) ? 0 : 1;
+    latencies_ms.push_back(MillisecondsSince(start));
+  }
+  Report(state, std::move(latencies_ms), failed);
+}
+
+void BM_Async(benchmark::State& state, Mode mode) {
+  std::promise<bool>* done = nullptr;
+  AsyncClient<FaultyMethod> client(
+      NewChannel(), MakeRetryPolicy(mode),
+      [&done](const ::grpc::Status& status,
+              const google::protobuf::Empty* /* response */) {
+        done->set_value(status.ok());
+      });
+  google::protobuf::Empty request;
+  std::vector<double> latencies_ms;
+  int64_t failed = 0;
+  for (auto _ : state) {
+    std::promise<bool> promise;
+    done = &promise;
+    const auto start = std::chrono::steady_clock::now();
+    client.WriteAsync(request);
+    failed += promise.get_future().get() ? 0 : 1;
+    latencies_ms.push_back(MillisecondsSince(start));
+  }
+  Report(state, std::move(latencies_ms), failed);
+}
+
+constexpr int kCalls = 3000;
+
+BENCHMARK_CAPTURE(BM_Blocking, NoRetry, Mode::kNoRetry)
+    ->Name("Blocking/NoRetry")
+    ->Iterations(kCalls)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_Blocking, Retry, Mode::kRetry)
+    ->Name("Blocking/Retry")
+    ->Iterations(kCalls)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_Blocking, Hedged, Mode::kHedged)
+    ->Name("Blocking/Hedged")
+    ->Iterations(kCalls)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_Async, NoRetry, Mode::kNoRetry)
+    ->Name("Async/NoRetry")
+    ->Iterations(kCalls)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_Async, Retry, Mode::kRetry)
+    ->Name("Async/Retry")
+    ->Iterations(kCalls)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_Async, Hedged, Mode::kHedged)
+    ->Name("Async/Hedged")
+    ->Iterations(kCalls)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace async_grpc
+
+BENCHMARK_MAIN();
@@ -0,0 +1,258 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef CPP_GRPC_RETRYING_UNARY_CALL_H
+#define CPP_GRPC_RETRYING_UNARY_CALL_H
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "src/async_grpc/completion_queue_pool.h"
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include "grpc++/grpc++.h"
+#include "grpc++/impl/codegen/async_unary_call.h"
+#include "grpcpp/alarm.h"
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#include "src/async_grpc/retry.h"
+
+namespace async_grpc {
+
+// One unary call under a 'RetryPolicy', driven by completion queue events.
+// Every attempt and the retry timer report to the queue with their own
+// 'ClientEvent'; the owner passes each of them to 'HandleEvent()' until it
+// returns true. From then on no event is pending and the call may be
+// destroyed. 'Client' drives it from a private queue, 'AsyncClient' from
+// the 'CompletionQueuePool'. The policy's budget must be set if it allows
+// more than one attempt, and its latency tracker if it hedges.
+//
+// A failed attempt with a retryable status is retried after a backoff; with
+// hedging, further attempts also start while earlier ones are still
+// running. The first attempt that succeeds, or fails for good, decides the
+// call and the others are cancelled.
+template <typename ResponseType>
+class RetryingUnaryCall {
+ public:
+  using StartAttemptFunction = std::function<
+      std::unique_ptr<::grpc::ClientAsyncResponseReader<ResponseType>>(
+          ::grpc::ClientContext*, ::grpc::CompletionQueue*)>;
+
+  RetryingUnaryCall(
+      const RetryPolicy& policy,
+      std::optional<std::chrono::system_clock::time_point> deadline,
+      ::grpc::CompletionQueue* completion_queue,
+      AsyncClientInterface* async_client, StartAttemptFunction start_attempt)
+      : policy_(policy),
+        deadline_(deadline),
+        completion_queue_(completion_queue),
+        async_client_(async_client),
+        start_attempt_(std::move(start_attempt)),
+        alarm_event_(CompletionQueue::ClientEvent::Event::ALARM,
+                     async_client) {}
+
+  RetryingUnaryCall(const RetryingUnaryCall&) = delete;
+  RetryingUnaryCall& operator=(const RetryingUnaryCall&) = delete;
+
+  void Start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (policy_.budget) {
+      policy_.budget->RecordCall();
+    }
+    StartAttempt();
+  }
+
+  // Returns true once the call is finished and no event is pending.
+  bool HandleEvent(const CompletionQueue::ClientEvent& client_event) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    --pending_events_;
+    if (&client_event == &alarm_event_) {
+      HandleAlarm(client_event.ok);
+    } else {
+      HandleAttemptFinished(client_event);
+    }
+    return result_ != nullptr && pending_events_ == 0;
+  }
+
+  // Cancels all attempts and the timer; the call still finishes through
+  // 'HandleEvent()'.
+  void Cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancelled_ = true;
+    CancelPending();
+  }
+
+  // Valid once 'HandleEvent()' returned true.
+  const ::grpc::Status& status() const { return result_->status; }
+  ResponseType* mutable_response() { return &result_->response; }
+  int attempts() const { return attempts_.size(); }
+
+ private:
+  struct Attempt {
+    explicit Attempt(AsyncClientInterface* async_client)
+        : event(CompletionQueue::ClientEvent::Event::FINISH, async_client) {}
+
+    ::grpc::ClientContext context;
+    std::unique_ptr<::grpc::ClientAsyncResponseReader<ResponseType>> reader;
+    CompletionQueue::ClientEvent event;
+    ResponseType response;
+    ::grpc::Status status;
+    std::chrono::steady_clock::time_point start_time;
+    bool running = true;
+  };
+
+  void StartAttempt() {
+    attempts_.push_back(std::make_unique<Attempt>(async_client_));
+    Attempt* attempt = attempts_.back().get();
+    if (deadline_.has_value()) {
+      attempt->context.set_deadline(deadline_.value());
+    }
+    attempt->start_time = std::chrono::steady_clock::now();
+    attempt->reader = start_attempt_(&attempt->context, completion_queue_);
+    attempt->reader->Finish(&attempt->response, &attempt->status,
+                            (void*)&attempt->event);
+    ++pending_events_;
+    ++running_attempts_;
+    if (attempts() < policy_.max_attempts) {
+      if (const auto delay = policy_.HedgingDelay()) {
+        SetAlarm(delay.value(), /*retry=*/false);
+      }
+    }
+  }
+
+  void HandleAttemptFinished(const CompletionQueue::ClientEvent& client_event) {
+    Attempt* attempt = nullptr;
+    for (const auto& candidate : attempts_) {
+      if (&candidate->event == &client_event) {
+        attempt = candidate.get();
+      }
+    }
+    CHECK(attempt != nullptr);
+    attempt->running = false;
+    --running_attempts_;
+    if (result_ != nullptr) {
+      return;
+    }
+    if (attempt->status.ok() && policy_.latency) {
+      policy_.latency->Record(std::chrono::duration_cast<Duration>(
+          std::chrono::steady_clock::now() - attempt->start_time));
+    }
+    if (attempt->status.ok() || cancelled_ ||
+        !policy_.IsRetryable(attempt->status)) {
+      Finish(attempt);
+      return;
+    }
+    ++failed_attempts_;
+    last_failure_ = attempt;
+    if (running_attempts_ > 0) {
+      // A hedge is still out; it may yet succeed.
+      return;
+    }
+    if (attempts() >= policy_.max_attempts || !policy_.budget->TryRetry()) {
+      Finish(attempt);
+      return;
+    }
+    if (alarm_pending_) {
+      // The hedging timer is set; retry once its cancellation arrives.
+      retry_after_alarm_ = true;
+      alarm_->Cancel();
+    } else if (!SetAlarm(policy_.Backoff(failed_attempts_), /*retry=*/true)) {
+      Finish(attempt);
+    }
+  }
+
+  void HandleAlarm(bool fired) {
+    alarm_pending_ = false;
+    if (result_ != nullptr) {
+      return;
+    }
+    if (cancelled_) {
+      if (running_attempts_ == 0) {
+        Finish(last_failure_);
+      }
+      return;
+    }
+    if (std::exchange(retry_after_alarm_, false)) {
+      if (!SetAlarm(policy_.Backoff(failed_attempts_), /*retry=*/true)) {
+        Finish(last_failure_);
+      }
+      return;
+    }
+    if (!fired) {
+      return;
+    }
+    if (alarm_is_retry_) {
+      StartAttempt();
+    } else if (running_attempts_ > 0 && policy_.budget->TryRetry()) {
+      StartAttempt();
+    }
+  }
+
+  // Returns false if the alarm would go off after the deadline.
+  bool SetAlarm(Duration delay, bool retry) {
+    const auto now = std::chrono::system_clock::now();
+    const auto when =
+        now + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                  delay);
+    if (deadline_.has_value() && when >= deadline_.value()) {
+      return false;
+    }
+    // An alarm is not reused, so a late cancellation cannot hit the next one.
+    alarm_ = std::make_unique<::grpc::Alarm>();
+    alarm_->Set(completion_queue_, when, (void*)&alarm_event_);
+    alarm_is_retry_ = retry;
+    alarm_pending_ = true;
+    ++pending_events_;
+    return true;
+  }
+
+  void Finish(Attempt* attempt) {
+    result_ = attempt;
+    CancelPending();
+  }
+
+  void CancelPending() {
+    for (const auto& attempt : attempts_) {
+      if (attempt->running) {
+        attempt->context.TryCancel();
+      }
+    }
+    if (alarm_pending_) {
+      alarm_->Cancel();
+    }
+  }
+
+  const RetryPolicy& policy_;
+  const std::optional<std::chrono::system_clock::time_point> deadline_;
+  ::grpc::CompletionQueue* const completion_queue_;
+  AsyncClientInterface* const async_client_;
+  const StartAttemptFunction start_attempt_;
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<Attempt>> attempts_;
+  CompletionQueue::ClientEvent alarm_event_;
+  std::unique_ptr<::grpc::Alarm> alarm_;
+  bool alarm_pending_ = false;
+  bool alarm_is_retry_ = false;
+  bool retry_after_alarm_ = false;
+  bool cancelled_ = false;
+  int pending_events_ = 0;
+  int running_attempts_ = 0;
+  int failed_attempts_ = 0;
+  Attempt* last_failure_ = nullptr;
+  Attempt* result_ = nullptr;
+};
+
+}  // namespace async_grpc
+
+#endif  // CPP_GRPC_RETRYING_UNARY_CALL_H
@@ -0,0 +1,334 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/async_grpc/retrying_unary_call.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "google/protobuf/empty.pb.h"
+#include "gtest/gtest.h"
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include "grpc++/grpc++.h"
+#include "grpcpp/alarm.h"
+#include "grpcpp/generic/async_generic_service.h"
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#include "src/async_grpc/retry.h"
+
+namespace async_grpc {
+namespace {
+
+using google::protobuf::Empty;
+using std::chrono::milliseconds;
+
+// How the server answers one attempt.
+struct Reply {
+  milliseconds delay{0};
+  ::grpc::StatusCode code = ::grpc::StatusCode::OK;
+};
+
+// What the server saw of one attempt.
+struct Seen {
+  std::chrono::system_clock::time_point deadline;
+  bool cancelled = false;
+};
+
+// Answers the attempts in turn with the scripted replies; once they run out
+// the last one is repeated.
+class ScriptedService : public ::grpc::CallbackGenericService {
+ public:
+  void Script(std::vector<Reply> replies) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    replies_ = std::move(replies);
+  }
+
+  // The attempts seen once 'count' of them are done.
+  std::vector<Seen> WaitForDone(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_changed_.wait_for(lock, std::chrono::seconds(10),
+                           [this, count] { return done_ >= count; });
+    return seen_;
+  }
+
+  ::grpc::ServerGenericBidiReactor* CreateReactor(
+      ::grpc::GenericCallbackServerContext* context) override {
+    return new Reactor(this, context->deadline());
+  }
+
+ private:
+  class Reactor : public ::grpc::ServerGenericBidiReactor {
+   public:
+    Reactor(ScriptedService* service,
+            std::chrono::system_clock::time_point deadline)
+        : service_(service), deadline_(deadline) {
+      StartRead(&request_);
+    }
+
+    void OnReadDone(bool ok) override {
+      if (!ok) {
+        Finish(::grpc::Status(::grpc::StatusCode::INTERNAL, "no request"));
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reply_ = service_->Arrive(deadline_, &index_);
+        if (reply_.delay > milliseconds(0)) {
+          alarm_set_ = true;
+          alarm_.Set(std::chrono::system_clock::now() + reply_.delay,
+                     [this](bool /* fired */) { Answer(); });
+          return;
+        }
+      }
+      Answer();
+    }
+
+    void OnCancel() override {
+      std::lock_guard<std::mutex> lock(mutex_);
+      service_->Cancelled(index_);
+      if (alarm_set_) {
+        alarm_.Cancel();
+      }
+    }
+
+    void OnDone() override {
+      service_->Done();
+      delete this;
+    }
+
+   private:
+    void Answer() {
+      if (reply_.code != ::grpc::StatusCode::OK) {
+        Finish(::grpc::Status(reply_.code, "scripted"));
+        return;
+      }
+      // An empty message serializes to no bytes.
+      ::grpc::Slice empty("");
+      response_ = ::grpc::ByteBuffer(&empty, 1);
+      StartWriteAndFinish(&response_, ::grpc::WriteOptions(),
+                          ::grpc::Status::OK);
+    }
+
+    ScriptedService* const service_;
+    const std::chrono::system_clock::time_point deadline_;
+    ::grpc::ByteBuffer request_;
+    ::grpc::ByteBuffer response_;
+    std::mutex mutex_;
+    Reply reply_;
+    int index_ = -1;
+    bool alarm_set_ = false;
+    ::grpc::Alarm alarm_;
+  };
+
+  Reply Arrive(std::chrono::system_clock::time_point deadline, int* index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    *index = seen_.size();
+    seen_.push_back(Seen{deadline});
+    return replies_.empty()
+               ? Reply()
+               : replies_[std::min<size_t>(*index, replies_.size() - 1)];
+  }
+
+  void Cancelled(int index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index >= 0) {
+      seen_[index].cancelled = true;
+    }
+  }
+
+  void Done() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++done_;
+    done_changed_.notify_all();
+  }
+
+  std::mutex mutex_;
+  std::condition_variable done_changed_;
+  std::vector<Reply> replies_;
+  std::vector<Seen> seen_;
+  size_t done_ = 0;
+};
+
+struct Outcome {
+  ::grpc::Status status;
+  int attempts = 0;
+  std::chrono::steady_clock::duration elapsed;
+};
+
+class RetryingUnaryCallTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ::grpc::ServerBuilder builder;
+    builder.RegisterCallbackGenericService(&service_);
+    server_ = builder.BuildAndStart();
+    channel_ = server_->InProcessChannel(::grpc::ChannelArguments());
+  }
+
+  void TearDown() override { server_->Shutdown(); }
+
+  // Drives one call on a private completion queue, as 'Client' does.
+  Outcome Call(const RetryPolicy& policy,
+               std::optional<std::chrono::system_clock::time_point> deadline =
+                   std::nullopt) {
+    const ::grpc::internal::RpcMethod method(
+        "/async_grpc.test.Scripted/Call",
+        ::grpc::internal::RpcMethod::NORMAL_RPC, channel_);
+    const Empty request;
+    ::grpc::CompletionQueue completion_queue;
+    RetryingUnaryCall<Empty> call(
+        policy, deadline, &completion_queue, /*async_client=*/nullptr,
+        [&](::grpc::ClientContext* context,
+            ::grpc::CompletionQueue* completion_queue) {
+          return std::unique_ptr<::grpc::ClientAsyncResponseReader<Empty>>(
+              ::grpc::internal::ClientAsyncResponseReaderFactory<
+                  Empty>::Create(channel_.get(), completion_queue, method,
+                                 context, request, /*start=*/true));
+        });
+    const auto start = std::chrono::steady_clock::now();
+    call.Start();
+    void* tag;
+    bool ok;
+    while (completion_queue.Next(&tag, &ok)) {
+      auto* client_event = static_cast<CompletionQueue::ClientEvent*>(tag);
+      client_event->ok = ok;
+      if (call.HandleEvent(*client_event)) {
+        break;
+      }
+    }
+    Outcome outcome{call.status(), call.attempts(),
+                    std::chrono::steady_clock::now() - start};
+    completion_queue.Shutdown();
+    while (completion_queue.Next(&tag, &ok)) {
+    }
+    return outcome;
+  }
+
+  // Hedges one attempt after about 50ms.
+  static RetryPolicy HedgingPolicy() {
+    RetryPolicy policy;
+    policy.max_attempts = 2;
+    policy.hedging = true;
+    policy.budget = std::make_shared<RetryBudget>();
+    policy.latency = std::make_shared<LatencyTracker>();
+    for (int i = 0; i < LatencyTracker::kMinSamples; ++i) {
+      policy.latency->Record(milliseconds(50));
+    }
+    return policy;
+  }
+
+  ScriptedService service_;
+  std::unique_ptr<::grpc::Server> server_;
+  std::shared_ptr<::grpc::Channel> channel_;
+};
+
+TEST_F(RetryingUnaryCallTest, RetriesUntilBudgetIsSpent) {
+  service_.Script({{milliseconds(0), ::grpc::StatusCode::UNAVAILABLE}});
+  RetryPolicy policy;
+  policy.max_attempts = 5;
+  policy.initial_backoff = milliseconds(1);
+  // A single token, refilled by a tenth per call.
+  policy.budget = std::make_shared<RetryBudget>(0.1, 1.);
+
+  Outcome outcome = Call(policy);
+  EXPECT_EQ(outcome.status.error_code(), ::grpc::StatusCode::UNAVAILABLE);
+  EXPECT_EQ(outcome.attempts, 2);
+  EXPECT_LT(policy.budget->tokens(), 1.);
+
+  outcome = Call(policy);
+  EXPECT_EQ(outcome.status.error_code(), ::grpc::StatusCode::UNAVAILABLE);
+  EXPECT_EQ(outcome.attempts, 1);
+}
+
+TEST_F(RetryingUnaryCallTest, RetriesRetryableFailure) {
+  service_.Script({{milliseconds(0), ::grpc::StatusCode::UNAVAILABLE},
+                   {milliseconds(0), ::grpc::StatusCode::OK}});
+  RetryPolicy policy;
+  policy.initial_backoff = milliseconds(1);
+  policy.budget = std::make_shared<RetryBudget>();
+
+  const Outcome outcome = Call(policy);
+  EXPECT_TRUE(outcome.status.ok()) << outcome.status.error_message();
+  EXPECT_EQ(outcome.attempts, 2);
+}
+
+TEST_F(RetryingUnaryCallTest, HedgesAfterLatencyQuantile) {
+  service_.Script({{std::chrono::seconds(5), ::grpc::StatusCode::OK},
+                   {milliseconds(0), ::grpc::StatusCode::OK}});
+
+  const Outcome outcome = Call(HedgingPolicy());
+  EXPECT_TRUE(outcome.status.ok()) << outcome.status.error_message();
+  EXPECT_EQ(outcome.attempts, 2);
+  EXPECT_GE(outcome.elapsed, milliseconds(50));
+  EXPECT_LT(outcome.elapsed, std::chrono::seconds(5));
+}
+
+TEST_F(RetryingUnaryCallTest, NoHedgeWithoutLatencySamples) {
+  service_.Script({{milliseconds(100), ::grpc::StatusCode::OK}});
+  RetryPolicy policy = HedgingPolicy();
+  policy.latency = std::make_shared<LatencyTracker>();
+
+  const Outcome outcome = Call(policy);
+  EXPECT_TRUE(outcome.status.ok()) << outcome.status.error_message();
+  EXPECT_EQ(outcome.attempts, 1);
+}
+
+TEST_F(RetryingUnaryCallTest, FirstResponseCancelsLoser) {
+  service_.Script({{std::chrono::seconds(5), ::grpc::StatusCode::OK},
+                   {milliseconds(0), ::grpc::StatusCode::OK}});
+
+  const Outcome outcome = Call(HedgingPolicy());
+  ASSERT_TRUE(outcome.status.ok()) << outcome.status.error_message();
+  const std::vector<Seen> seen = service_.WaitForDone(2);
+  ASSERT_EQ(seen.size(), 2u);
+  EXPECT_TRUE(seen[0].cancelled);
+  EXPECT_FALSE(seen[1].cancelled);
+}
+
+TEST_F(RetryingUnaryCallTest, PropagatesDeadlineToAttempts) {
+  service_.Script({{milliseconds(0), ::grpc::StatusCode::UNAVAILABLE},
+                   {milliseconds(0), ::grpc::StatusCode::OK}});
+  RetryPolicy policy;
+  policy.initial_backoff = milliseconds(1);
+  policy.budget = std::make_shared<RetryBudget>();
+  const auto deadline =
+      std::chrono::system_clock::now() + std::chrono::seconds(10);
+
+  const Outcome outcome = Call(policy, deadline);
+  ASSERT_TRUE(outcome.status.ok()) << outcome.status.error_message();
+  const std::vector<Seen> seen = service_.WaitForDone(2);
+  ASSERT_EQ(seen.size(), 2u);
+  for (const Seen& attempt : seen) {
+    EXPECT_LT(attempt.deadline - deadline, milliseconds(100));
+    EXPECT_LT(deadline - attempt.deadline, milliseconds(100));
+  }
+}
+
+TEST_F(RetryingUnaryCallTest, NoRetryAfterDeadline) {
+  service_.Script({{milliseconds(0), ::grpc::StatusCode::UNAVAILABLE}});
+  RetryPolicy policy;
+  policy.max_attempts = 100;
+  policy.initial_backoff = milliseconds(50);
+  policy.backoff_multiplier = 1.f;
+  policy.budget = std::make_shared<RetryBudget>(1., 100.);
+  const auto deadline = std::chrono::system_clock::now() + milliseconds(300);
+
+  const Outcome outcome = Call(policy, deadline);
+  EXPECT_FALSE(outcome.status.ok());
+  EXPECT_LT(outcome.attempts, 100);
+  EXPECT_LT(outcome.elapsed, milliseconds(1000));
+}
+
+}  // namespace
+}  // namespace async_grpc
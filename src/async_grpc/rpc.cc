@@ -17,11 +17,14 @@
 #include "src/async_grpc/rpc.h"
 
 #include "src/common/logging.h"
+#include "src/async_grpc/local_span.h"
 #include "src/async_grpc/service.h"
 
 namespace async_grpc {
 namespace {
 
+constexpr size_t kMaxEventsPerDrain = 64;
+
 // Finishes the gRPC for non-streaming response RPCs, i.e. NORMAL_RPC and
 // CLIENT_STREAMING. If no 'msg' is passed, we signal an error to the client as
 // the server is not honoring the gRPC call signature.
@@ -51,6 +54,18 @@ void Rpc::InternalRpcEvent::Handle() {
   }
 }
 
+void Rpc::ResumeEvent::Handle() {
+  // Holding the RPC keeps the handler, and with it the coroutine frame, alive
+  // while it runs.
+  if (auto rpc_shared = rpc.lock()) {
+    // A resumed coroutine handler continues the RPC's trace.
+    RpcHandlerInterface* handler = rpc_shared->handler();
+    tbox::trace::ScopedActivation activation(
+        handler ? LocalSpan::Get(handler->trace_span()) : nullptr);
+    handle.resume();
+  }
+}
+
 Rpc::Rpc(int method_index,
          ::grpc::ServerCompletionQueue* server_completion_queue,
          EventQueue* event_queue, ExecutionContext* execution_context,
@@ -89,6 +104,13 @@ void Rpc::OnConnection() {
   if (!handler_) {
     // Instantiate the handler.
     handler_ = rpc_handler_info_.rpc_handler_factory(this, execution_context_);
+    // The trace starts when the call was queued for an event thread.
+    if (tbox::trace::Span* span = LocalSpan::Get(handler_->trace_span())) {
+      const int64_t queued = new_connection_event_.queued_unix_nanos;
+      span->SetStartTime(queued);
+      span->AddCompletedChild("queue_wait", queued,
+                              tbox::trace::NowUnixNanos());
+    }
   }
 
   // For request-streaming RPCs ask the client to start sending requests.
@@ -96,6 +118,22 @@ void Rpc::OnConnection() {
 }
 
 void Rpc::OnRequest() {
+  tbox::trace::Span* span = LocalSpan::Get(handler_->trace_span());
+  if (span == nullptr) {
+    handler_->OnRequestInternal(request_.get());
+    return;
+  }
+  // Streamed requests come through gRPC's CompletionQueue and may wait for
+  // an event thread again; unary requests arrive with the call.
+  const auto rpc_type = rpc_handler_info_.rpc_type;
+  if (rpc_type == ::grpc::internal::RpcMethod::CLIENT_STREAMING ||
+      rpc_type == ::grpc::internal::RpcMethod::BIDI_STREAMING) {
+    span->AddCompletedChild("queue_wait", read_event_.queued_unix_nanos,
+                            tbox::trace::NowUnixNanos());
+  }
+  // Spans the handler opens, e.g. for DB calls, become children of this one.
+  tbox::trace::ScopedActivation activation(span);
+  tbox::trace::ScopedSpan execution("handler");
   handler_->OnRequestInternal(request_.get());
 }
 
@@ -104,7 +142,10 @@ void Rpc::OnReadsDone() {
 }
 
 void Rpc::OnFinish() {
-  handler_->OnFinish();
+  // Rejected RPCs finish without a handler.
+  if (handler_) {
+    handler_->OnFinish();
+  }
 }
 
 void Rpc::RequestNextMethodInvocation() {
@@ -170,6 +211,50 @@ void Rpc::RequestStreamingReadIfNeeded() {
   }
 }
 
+void Rpc::EventQueue::Push(UniqueEventPtr event) {
+  common::BlockingQueue<UniqueEventPtr>::Push(std::move(event));
+  if (scheduler_) {
+    ScheduleDrainIfIdle();
+  }
+}
+
+void Rpc::EventQueue::ScheduleDrainIfIdle() {
+  if (!stopped_.load(std::memory_order_acquire) &&
+      !drain_pending_.exchange(true, std::memory_order_acq_rel)) {
+    scheduler_([this]() { Drain(kMaxEventsPerDrain); });
+  }
+}
+
+void Rpc::EventQueue::Drain(size_t max_events) {
+  for (size_t i = 0; i < max_events; ++i) {
+    UniqueEventPtr rpc_event = PopWithTimeout(common::FromMilliseconds(0));
+    if (!rpc_event) {
+      break;
+    }
+    rpc_event->Handle();
+  }
+  // A push racing with the last pop saw 'drain_pending_' set and did not
+  // schedule, so look again after clearing it.
+  drain_pending_.store(false, std::memory_order_release);
+  drain_pending_.notify_all();
+  if (Size() > 0) {
+    ScheduleDrainIfIdle();
+  }
+}
+
+void Rpc::EventQueue::DrainForShutdown() {
+  stopped_.store(true, std::memory_order_release);
+  // Take the drain token for good: no executor 'Drain()' may run alongside
+  // this one, and a scheduled or running one hands the token back when done.
+  while (drain_pending_.exchange(true, std::memory_order_acq_rel)) {
+    drain_pending_.wait(true, std::memory_order_acquire);
+  }
+  while (UniqueEventPtr rpc_event =
+             PopWithTimeout(common::FromMilliseconds(0))) {
+    rpc_event->Handle();
+  }
+}
+
 void Rpc::Write(std::unique_ptr<::google::protobuf::Message> message) {
   EnqueueMessage(SendItem{std::move(message), ::grpc::Status::OK});
   event_queue_->Push(UniqueEventPtr(
@@ -268,6 +353,9 @@ Rpc::CompletionQueueRpcEvent* Rpc::GetRpcEvent(Event event) {
     case Event::WRITE_NEEDED:
       LOG(FATAL) << "Rpc does not store Event::WRITE_NEEDED.";
       break;
+    case Event::RESUME:
+      LOG(FATAL) << "Rpc does not store Event::RESUME.";
+      break;
     case Event::WRITE:
       return &write_event_;
     case Event::FINISH:
@@ -290,6 +378,13 @@ void Rpc::EnqueueMessage(SendItem&& send_item) {
 void Rpc::PerformFinish(std::unique_ptr<::google::protobuf::Message> message,
                         ::grpc::Status status) {
   SetRpcEventState(Event::FINISH, true);
+  service_->rpc_metrics(method_index_)
+      ->Record(status.error_code(),
+               tbox::trace::NowUnixNanos() -
+                   new_connection_event_.queued_unix_nanos);
+  if (handler_ && handler_->trace_span()) {
+    handler_->trace_span()->SetStatus(status);
+  }
   switch (rpc_handler_info_.rpc_type) {
     case ::grpc::internal::RpcMethod::BIDI_STREAMING:
       CHECK(!message);
@@ -347,6 +442,17 @@ std::weak_ptr<Rpc> Rpc::GetWeakPtr() {
   return weak_ptr_factory_(this);
 }
 
+tbox::common::Resumer Rpc::GetResumer() {
+  // Pool and DNS workers may complete after 'Server::Shutdown()' destroyed
+  // the queue. The coroutine is then dropped; its frame goes with the RPC.
+  return [rpc = GetWeakPtr(), event_queue = event_queue_->weak_from_this()](
+             std::coroutine_handle<> handle) {
+    if (auto queue = event_queue.lock()) {
+      queue->Push(UniqueEventPtr(new ResumeEvent(rpc, handle)));
+    }
+  };
+}
+
 ActiveRpcs::ActiveRpcs() : lock_() {}
 
 void Rpc::InitializeReadersAndWriters(
@@ -17,6 +17,10 @@
 #ifndef CPP_GRPC_RPC_H
 #define CPP_GRPC_RPC_H
 
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <queue>
 #include <unordered_set>
@@ -34,16 +38,24 @@
 #if defined(__GNUC__) || defined(__clang__)
 #pragma GCC diagnostic pop
 #endif
+#include "src/async_grpc/admission_policy.h"
 #include "src/async_grpc/common/blocking_queue.h"
 #include "src/async_grpc/common/mutex.h"
 #include "src/async_grpc/execution_context.h"
 #include "src/async_grpc/rpc_handler_interface.h"
+#include "src/common/heap.h"
+#include "src/common/task.h"
+#include "src/common/trace.h"
 
 namespace async_grpc {
 
 class Service;
 // TODO(cschuet): Add a unittest that tests the logic of this class.
-class Rpc {
+// Calls and the events they create live on their own heap: they come and go
+// at the request rate and would otherwise interleave with longer lived
+// objects.
+class Rpc
+    : public tbox::memory::HeapAllocated<tbox::memory::HeapId::kGrpcEvents> {
  public:
   using WeakPtrFactory = std::function<std::weak_ptr<Rpc>(Rpc*)>;
   enum class Event {
@@ -52,10 +64,12 @@ class Rpc {
     WRITE_NEEDED,
     WRITE,
     FINISH,
-    DONE
+    DONE,
+    RESUME
   };
 
-  struct EventBase {
+  struct EventBase
+      : public tbox::memory::HeapAllocated<tbox::memory::HeapId::kGrpcEvents> {
     explicit EventBase(Event event) : event(event) {}
     virtual ~EventBase() {};
     virtual void Handle() = 0;
@@ -83,13 +97,47 @@ class Rpc {
   };
 
   using UniqueEventPtr = std::unique_ptr<EventBase, EventDeleter>;
-  using EventQueue = common::BlockingQueue<UniqueEventPtr>;
+
+  // Events of one RPC are handled in order from one queue. By default an
+  // 'EventQueueThread' pops them. With a scheduler set, a push that finds
+  // the queue idle schedules a single 'Drain()' task instead, so events run
+  // on a shared executor and stay serialized per queue. Queues are owned by
+  // shared_ptr so that work finishing on other threads after shutdown can
+  // tell whether the queue is still there.
+  class EventQueue : public common::BlockingQueue<UniqueEventPtr>,
+                     public std::enable_shared_from_this<EventQueue> {
+   public:
+    using Scheduler = std::function<void(std::function<void()>)>;
+
+    void SetScheduler(Scheduler scheduler) {
+      scheduler_ = std::move(scheduler);
+    }
+    bool HasScheduler() const { return scheduler_ != nullptr; }
+
+    void Push(UniqueEventPtr event);
+
+    // Handles up to 'max_events' events, then reschedules itself if more
+    // are queued so one busy queue cannot monopolize an executor thread.
+    void Drain(size_t max_events);
+
+    // Stops scheduling, waits for a pending executor drain to finish and
+    // handles the remaining events on this thread.
+    void DrainForShutdown();
+
+   private:
+    void ScheduleDrainIfIdle();
+
+    Scheduler scheduler_;
+    std::atomic<bool> drain_pending_{false};
+    std::atomic<bool> stopped_{false};
+  };
 
   // Flows through gRPC's CompletionQueue and then our EventQueue.
   struct CompletionQueueRpcEvent : public EventBase {
     CompletionQueueRpcEvent(Event event, Rpc* rpc)
         : EventBase(event), rpc_ptr(rpc), ok(false), pending(false) {}
     void PushToEventQueue() {
+      queued_unix_nanos = tbox::trace::NowUnixNanos();
       rpc_ptr->event_queue()->Push(
           UniqueEventPtr(this, EventDeleter(EventDeleter::DO_NOT_DELETE)));
     }
@@ -98,6 +146,8 @@ class Rpc {
     Rpc* rpc_ptr;
     bool ok;
     bool pending;
+    // When the event entered our EventQueue, for the queue wait span.
+    int64_t queued_unix_nanos = 0;
   };
 
   // Flows only through our EventQueue.
@@ -109,12 +159,27 @@ class Rpc {
     std::weak_ptr<Rpc> rpc;
   };
 
+  // Continues a suspended coroutine handler on this RPC's event queue. If
+  // the RPC is gone its handler destroyed the coroutine and the event is
+  // dropped.
+  struct ResumeEvent : public EventBase {
+    ResumeEvent(std::weak_ptr<Rpc> rpc, std::coroutine_handle<> handle)
+        : EventBase(Event::RESUME), rpc(rpc), handle(handle) {}
+    void Handle() override;
+
+    std::weak_ptr<Rpc> rpc;
+    std::coroutine_handle<> handle;
+  };
+
   Rpc(int method_index, ::grpc::ServerCompletionQueue* server_completion_queue,
       EventQueue* event_queue, ExecutionContext* execution_context,
       const RpcHandlerInfo& rpc_handler_info, Service* service,
       WeakPtrFactory weak_ptr_factory);
   std::unique_ptr<Rpc> Clone();
   void OnConnection();
+  void SetAdmissionTicket(std::unique_ptr<AdmissionPolicy::Ticket> ticket) {
+    admission_ticket_ = std::move(ticket);
+  }
   void OnRequest();
   void OnReadsDone();
   void OnFinish();
@@ -124,11 +189,16 @@ class Rpc {
   void Write(std::unique_ptr<::google::protobuf::Message> message);
   void Finish(::grpc::Status status);
   Service* service() { return service_; }
+  const RpcHandlerInfo& rpc_handler_info() const { return rpc_handler_info_; }
   bool IsRpcEventPending(Event event);
   bool IsAnyEventPending();
   void SetEventQueue(EventQueue* event_queue) { event_queue_ = event_queue; }
   EventQueue* event_queue() { return event_queue_; }
   std::weak_ptr<Rpc> GetWeakPtr();
+  // Resumes coroutines through 'ResumeEvent's, so handler code runs
+  // serialized with this RPC's other events whichever thread completed the
+  // awaited operation.
+  tbox::common::Resumer GetResumer();
   RpcHandlerInterface* handler() { return handler_.get(); }
   ::grpc::ServerContext* server_context() { return &server_context_; }
 
@@ -177,6 +247,7 @@ class Rpc {
   std::unique_ptr<google::protobuf::Message> response_;
 
   std::unique_ptr<RpcHandlerInterface> handler_;
+  std::unique_ptr<AdmissionPolicy::Ticket> admission_ticket_;
 
   std::unique_ptr<::grpc::ServerAsyncResponseWriter<google::protobuf::Message>>
       server_async_response_writer_;
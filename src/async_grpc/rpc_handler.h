@@ -26,6 +26,8 @@
 #include "src/async_grpc/span.h"
 #if BUILD_TRACING
 #include "src/async_grpc/opencensus_span.h"
+#else
+#include "src/async_grpc/local_span.h"
 #endif
 
 namespace async_grpc {
@@ -57,10 +59,6 @@ class RpcHandler : public RpcHandlerInterface {
     bool Finish(const ::grpc::Status& status) const {
       if (auto rpc = rpc_.lock()) {
         rpc->Finish(status);
-        auto* span = rpc->handler()->trace_span();
-        if (span) {
-          span->SetStatus(status);
-        }
         return true;
       }
       return false;
@@ -74,8 +72,16 @@ class RpcHandler : public RpcHandlerInterface {
   RpcHandler()
       : span_(
             OpencensusSpan::StartSpan(RpcServiceMethodConcept::MethodName())) {}
-  virtual ~RpcHandler() { span_->End(); }
+#else
+  // 'span_' stays null for RPCs the sampler skips.
+  RpcHandler()
+      : span_(LocalSpan::StartSpan(RpcServiceMethodConcept::MethodName())) {}
 #endif
+  virtual ~RpcHandler() {
+    if (span_) {
+      span_->End();
+    }
+  }
 
   Span* trace_span() override { return span_.get(); }
   void SetExecutionContext(ExecutionContext* execution_context) override {
@@ -89,9 +95,6 @@ class RpcHandler : public RpcHandlerInterface {
   virtual void OnRequest(const RequestType& request) = 0;
   void Finish(::grpc::Status status) {
     rpc_->Finish(status);
-#if BUILD_TRACING
-    span_->SetStatus(status);
-#endif
   }
   void Send(std::unique_ptr<ResponseType> response) {
     rpc_->Write(std::move(response));
@@ -101,6 +104,14 @@ class RpcHandler : public RpcHandlerInterface {
     return {execution_context_->lock(), execution_context_};
   }
   template <typename T>
+  ExecutionContext::SharedSynchronized<T> GetSharedContext() {
+    return {execution_context_->shared_lock(), execution_context_};
+  }
+  template <typename T>
+  ExecutionContext::ExclusiveSynchronized<T> GetExclusiveContext() {
+    return {execution_context_->shared_lock(), execution_context_};
+  }
+  template <typename T>
   T* GetUnsynchronizedContext() {
     return dynamic_cast<T*>(execution_context_);
   }
@@ -0,0 +1,63 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/async_grpc/rpc_metrics.h"
+
+#include <iterator>
+
+namespace async_grpc {
+namespace {
+
+const char* StatusCodeName(size_t code) {
+  static constexpr const char* kNames[] = {
+      "OK",
+      "CANCELLED",
+      "UNKNOWN",
+      "INVALID_ARGUMENT",
+      "DEADLINE_EXCEEDED",
+      "NOT_FOUND",
+      "ALREADY_EXISTS",
+      "PERMISSION_DENIED",
+      "RESOURCE_EXHAUSTED",
+      "FAILED_PRECONDITION",
+      "ABORTED",
+      "OUT_OF_RANGE",
+      "UNIMPLEMENTED",
+      "INTERNAL",
+      "UNAVAILABLE",
+      "DATA_LOSS",
+      "UNAUTHENTICATED",
+  };
+  return code < std::size(kNames) ? kNames[code] : "UNKNOWN";
+}
+
+}  // namespace
+
+RpcMetrics::RpcMetrics(const std::string& method)
+    : method_(method),
+      latency_(tbox::metrics::Registry::Instance()->GetHistogram(
+          "tbox_grpc_server_handling_seconds",
+          "Time from a gRPC call reaching the event queue to its finish.",
+          {{"method", method}})) {}
+
+void RpcMetrics::Record(::grpc::StatusCode code, int64_t latency_nanos) {
+  latency_->Record(latency_nanos > 0 ? static_cast<uint64_t>(latency_nanos)
+                                     : 0);
+  const size_t index = static_cast<size_t>(code) < kNumCodes
+                           ? static_cast<size_t>(code)
+                           : static_cast<size_t>(::grpc::StatusCode::UNKNOWN);
+  tbox::metrics::Counter* counter =
+      handled_[index].load(std::memory_order_acquire);
+  if (counter == nullptr) {
+    // Racing threads get the same counter from the registry.
+    counter = tbox::metrics::Registry::Instance()->GetCounter(
+        "tbox_grpc_server_handled_total", "gRPC calls finished, by status.",
+        {{"method", method_}, {"code", StatusCodeName(index)}});
+    handled_[index].store(counter, std::memory_order_release);
+  }
+  counter->Increment();
+}
+
+}  // namespace async_grpc
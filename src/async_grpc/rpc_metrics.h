@@ -0,0 +1,49 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef CPP_GRPC_RPC_METRICS_H
+#define CPP_GRPC_RPC_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include "grpc++/grpc++.h"
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#include "src/common/metrics.h"
+
+namespace async_grpc {
+
+// Latency and outcome counts of one RPC method, exported as
+// 'tbox_grpc_server_handling_seconds{method}' and
+// 'tbox_grpc_server_handled_total{method,code}'. Recording is lock-free; the
+// counter for a status code is registered the first time the code is seen.
+class RpcMetrics {
+ public:
+  explicit RpcMetrics(const std::string& method);
+
+  // 'latency_nanos' runs from the call reaching our event queue to the
+  // handler finishing it.
+  void Record(::grpc::StatusCode code, int64_t latency_nanos);
+
+ private:
+  static constexpr size_t kNumCodes =
+      static_cast<size_t>(::grpc::StatusCode::UNAUTHENTICATED) + 1;
+
+  const std::string method_;
+  tbox::metrics::Histogram* const latency_;
+  std::array<std::atomic<tbox::metrics::Counter*>, kNumCodes> handled_{};
+};
+
+}  // namespace async_grpc
+
+#endif  // CPP_GRPC_RPC_METRICS_H
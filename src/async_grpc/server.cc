@@ -16,10 +16,14 @@
 
 #include "src/async_grpc/server.h"
 
+#include "grpcpp/health_check_service_interface.h"
 #include "src/common/logging.h"
+#include "src/common/metrics.h"
 #if BUILD_TRACING
 #include "opencensus/exporters/trace/stackdriver/stackdriver_exporter.h"
 #include "opencensus/trace/trace_config.h"
+#else
+#include "src/common/trace.h"
 #endif
 
 namespace async_grpc {
@@ -33,6 +37,20 @@ constexpr unsigned int kDefaultTracingMaxLinks = 128;
 
 }  // namespace
 
+bool ParseCompressionAlgorithm(const std::string& name,
+                               grpc_compression_algorithm* algorithm) {
+  if (name.empty() || name == "none" || name == "identity") {
+    *algorithm = GRPC_COMPRESS_NONE;
+  } else if (name == "deflate") {
+    *algorithm = GRPC_COMPRESS_DEFLATE;
+  } else if (name == "gzip") {
+    *algorithm = GRPC_COMPRESS_GZIP;
+  } else {
+    return false;
+  }
+  return true;
+}
+
 void Server::Builder::SetNumGrpcThreads(const size_t num_grpc_threads) {
   options_.num_grpc_threads = num_grpc_threads;
 }
@@ -58,11 +76,7 @@ void Server::Builder::SetMaxSendMessageSize(int max_send_message_size) {
 }
 
 void Server::Builder::EnableTracing() {
-#if BUILD_TRACING
   options_.enable_tracing = true;
-#else
-  LOG(FATAL) << "Enable tracing support by compiling with -DBUILD_TRACING=1.";
-#endif
 }
 
 void Server::Builder::DisableTracing() {
@@ -83,6 +97,29 @@ void Server::Builder::SetTracingGcpProjectId(
   options_.tracing_gcp_project_id = tracing_gcp_project_id;
 }
 
+void Server::Builder::SetCompressionAlgorithm(
+    grpc_compression_algorithm algorithm) {
+  options_.compression_algorithm = algorithm;
+}
+
+void Server::Builder::SetCompressionLevel(grpc_compression_level level) {
+  options_.compression_level = level;
+}
+
+void Server::Builder::SetEventScheduler(EventQueue::Scheduler scheduler) {
+  options_.event_scheduler = std::move(scheduler);
+}
+
+void Server::Builder::SetThreadInitializer(
+    std::function<void(size_t)> initializer) {
+  options_.thread_initializer = std::move(initializer);
+}
+
+void Server::Builder::SetAdmissionPolicy(
+    std::shared_ptr<AdmissionPolicy> policy) {
+  options_.admission_policy = std::move(policy);
+}
+
 std::tuple<std::string, std::string> Server::Builder::ParseMethodFullName(
     const std::string& method_full_name) {
   CHECK(method_full_name.at(0) == '/') << "Invalid method name.";
@@ -107,13 +144,32 @@ Server::Server(const Options& options) : options_(options) {
   server_builder_.AddListeningPort(options_.server_address,
                                    ::grpc::InsecureServerCredentials());
 
+  // Clients balancing over several servers health-check each of them, and
+  // keep idle connections alive with pings every minute by default.
+  ::grpc::EnableDefaultHealthCheckService(true);
+  server_builder_.AddChannelArgument(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS,
+                                     1);
+  server_builder_.AddChannelArgument(
+      GRPC_ARG_HTTP2_MIN_RECV_PING_INTERVAL_WITHOUT_DATA_MS, 10000);
+
   // Set max message sizes.
   server_builder_.SetMaxReceiveMessageSize(options.max_receive_message_size);
   server_builder_.SetMaxSendMessageSize(options.max_send_message_size);
 
+  if (options_.compression_algorithm != GRPC_COMPRESS_NONE) {
+    server_builder_.SetDefaultCompressionAlgorithm(
+        options_.compression_algorithm);
+    server_builder_.SetDefaultCompressionLevel(options_.compression_level);
+  }
+
   // Set up event queue threads.
   event_queue_threads_ =
       std::vector<EventQueueThread>(options_.num_event_threads);
+  if (options_.event_scheduler) {
+    for (auto& event_queue_thread : event_queue_threads_) {
+      event_queue_thread.event_queue()->SetScheduler(options_.event_scheduler);
+    }
+  }
 
   // Set up completion queues threads.
   for (size_t i = 0; i < options_.num_grpc_threads; ++i) {
@@ -129,7 +185,8 @@ void Server::AddService(
   const auto result = services_.emplace(
       std::piecewise_construct, std::make_tuple(service_name),
       std::make_tuple(service_name, rpc_handler_infos,
-                      [this]() { return SelectNextEventQueueRoundRobin(); }));
+                      [this]() { return SelectNextEventQueueRoundRobin(); },
+                      options_.admission_policy.get()));
   CHECK(result.second) << "A service named " << service_name
                        << " already exists.";
   server_builder_.RegisterService(&result.first->second);
@@ -180,29 +237,59 @@ void Server::Start() {
          opencensus::trace::ProbabilitySampler(
              options_.tracing_sampler_probability)});
   }
+#else
+  tbox::trace::Tracer::Instance()->SetSampleProbability(
+      options_.enable_tracing ? options_.tracing_sampler_probability : 0);
 #endif
 
   // Start the gRPC server process.
   server_ = server_builder_.BuildAndStart();
 
+  // Events waiting for a thread, read on each metrics scrape.
+  event_queue_depth_gauge_ =
+      tbox::metrics::Registry::Instance()->AddCallbackGauge(
+          "tbox_grpc_event_queue_depth",
+          "gRPC events waiting in the event queues.", {}, [this]() {
+            size_t depth = 0;
+            for (auto& event_queue_thread : event_queue_threads_) {
+              depth += event_queue_thread.event_queue()->Size();
+            }
+            return static_cast<double>(depth);
+          });
+
   // Start serving all services on all completion queues.
   for (auto& service : services_) {
     service.second.StartServing(completion_queue_threads_,
                                 execution_context_.get());
   }
 
-  // Start threads to process all event queues.
+  // Start threads to process all event queues, unless a shared executor
+  // drains them.
+  size_t thread_index = completion_queue_threads_.size();
   for (auto& event_queue_thread : event_queue_threads_) {
-    event_queue_thread.Start(
-        [this](EventQueue* event_queue) { RunEventQueue(event_queue); });
+    if (options_.event_scheduler) {
+      break;
+    }
+    event_queue_thread.Start([this, thread_index](EventQueue* event_queue) {
+      if (options_.thread_initializer) {
+        options_.thread_initializer(thread_index);
+      }
+      RunEventQueue(event_queue);
+    });
+    ++thread_index;
   }
 
   // Start threads to process all completion queues.
+  thread_index = 0;
   for (auto& completion_queue_threads : completion_queue_threads_) {
     completion_queue_threads.Start(
-        [this](::grpc::ServerCompletionQueue* completion_queue) {
+        [this, thread_index](::grpc::ServerCompletionQueue* completion_queue) {
+          if (options_.thread_initializer) {
+            options_.thread_initializer(thread_index);
+          }
           RunCompletionQueue(completion_queue);
         });
+    ++thread_index;
   }
 }
 
@@ -237,6 +324,12 @@ void Server::Shutdown() {
     event_queue_thread.Shutdown();
   }
 
+  if (event_queue_depth_gauge_ != 0) {
+    tbox::metrics::Registry::Instance()->RemoveCallbackGauge(
+        event_queue_depth_gauge_);
+    event_queue_depth_gauge_ = 0;
+  }
+
   LOG(INFO) << "Shutdown complete.";
 }
 
@@ -18,9 +18,13 @@
 #define CPP_GRPC_SERVER_H
 
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 
+#include "grpc/compression.h"
+#include "src/async_grpc/admission_policy.h"
 #include "src/async_grpc/completion_queue_thread.h"
 #include "src/async_grpc/event_queue_thread.h"
 #include "src/async_grpc/execution_context.h"
@@ -31,6 +35,13 @@ namespace async_grpc {
 constexpr int64_t MAX_GRPC_MSG_SIZE = 2 * 64 * 1024 * 1024 * 8;  // 128MB
 constexpr double TRACING_SAMPLER_PROBALITITY = 0.01;             // 1 Percent
 
+// Maps "none", "deflate" and "gzip" to the gRPC message compression
+// algorithm. These are the codecs gRPC core negotiates through
+// grpc-accept-encoding, so each channel ends up with the best algorithm both
+// peers support.
+bool ParseCompressionAlgorithm(const std::string& name,
+                               grpc_compression_algorithm* algorithm);
+
 class Server {
  protected:
   // All options that configure server behaviour such as number of threads,
@@ -51,6 +62,11 @@ class Server {
     double tracing_sampler_probability = TRACING_SAMPLER_PROBALITITY;
     std::string tracing_task_name;
     std::string tracing_gcp_project_id;
+    grpc_compression_algorithm compression_algorithm = GRPC_COMPRESS_NONE;
+    grpc_compression_level compression_level = GRPC_COMPRESS_LEVEL_NONE;
+    EventQueue::Scheduler event_scheduler;
+    std::function<void(size_t)> thread_initializer;
+    std::shared_ptr<AdmissionPolicy> admission_policy;
   };
 
  public:
@@ -65,11 +81,29 @@ class Server {
     void SetServerAddress(const std::string& server_address);
     void SetMaxReceiveMessageSize(int max_receive_message_size);
     void SetMaxSendMessageSize(int max_send_message_size);
+    // Samples 'tracing_sampler_probability' of the RPCs. With BUILD_TRACING
+    // spans go to Stackdriver, otherwise to the exporters installed on
+    // 'tbox::trace::Tracer'.
     void EnableTracing();
     void DisableTracing();
     void SetTracingSamplerProbability(double tracing_sampler_probability);
     void SetTracingTaskName(const std::string& tracing_task_name);
     void SetTracingGcpProjectId(const std::string& tracing_gcp_project_id);
+    // Responses are compressed only for clients that announce the algorithm,
+    // older clients keep receiving uncompressed messages.
+    void SetCompressionAlgorithm(grpc_compression_algorithm algorithm);
+    void SetCompressionLevel(grpc_compression_level level);
+    // Runs RPC events as tasks on an external executor (e.g. the HTTP IO
+    // threads) instead of on 'num_event_threads' dedicated threads. The
+    // event thread count then only sets how many serialized queues RPCs are
+    // spread over. Handlers must not block when the executor is shared.
+    void SetEventScheduler(EventQueue::Scheduler scheduler);
+    // Called first on every thread the server starts, with an index that
+    // counts completion queue threads then event threads; used to pin them.
+    void SetThreadInitializer(std::function<void(size_t)> initializer);
+    // Consulted for every incoming RPC before its handler is created, see
+    // 'AdmissionPolicy'.
+    void SetAdmissionPolicy(std::shared_ptr<AdmissionPolicy> policy);
 
     template <typename RpcHandlerType>
     void RegisterHandler() {
@@ -171,6 +205,16 @@ class Server {
     return {execution_context_->lock(), execution_context_.get()};
   }
 
+  template <typename T>
+  ExecutionContext::SharedSynchronized<T> GetSharedContext() {
+    return {execution_context_->shared_lock(), execution_context_.get()};
+  }
+
+  template <typename T>
+  ExecutionContext::ExclusiveSynchronized<T> GetExclusiveContext() {
+    return {execution_context_->shared_lock(), execution_context_.get()};
+  }
+
   template <typename T>
   T* GetUnsynchronizedContext() {
     return dynamic_cast<T*>(execution_context_.get());
@@ -204,6 +248,8 @@ class Server {
   std::vector<EventQueueThread> event_queue_threads_;
   common::Mutex current_event_queue_id_lock_;
   int current_event_queue_id_ = 0;
+  // Registration of the event queue depth gauge, 0 when not running.
+  uint64_t event_queue_depth_gauge_ = 0;
 
   // Map of service names to services.
   std::map<std::string, Service> services_;
@@ -15,6 +15,8 @@
  */
 
 #include <cstdlib>
+#include <memory>
+#include <utility>
 
 #include "src/common/logging.h"
 #if defined(__GNUC__) || defined(__clang__)
@@ -31,15 +33,20 @@ namespace async_grpc {
 
 Service::Service(const std::string& /*service_name*/,
                  const std::map<std::string, RpcHandlerInfo>& rpc_handler_infos,
-                 EventQueueSelector event_queue_selector)
+                 EventQueueSelector event_queue_selector,
+                 AdmissionPolicy* admission_policy)
     : rpc_handler_infos_(rpc_handler_infos),
-      event_queue_selector_(event_queue_selector) {
+      event_queue_selector_(event_queue_selector),
+      admission_policy_(admission_policy) {
   for (const auto& rpc_handler_info : rpc_handler_infos_) {
     // The 'handler' below is set to 'nullptr' indicating that we want to
     // handle this method asynchronously.
     this->AddMethod(new ::grpc::internal::RpcServiceMethod(
         rpc_handler_info.second.fully_qualified_name.c_str(),
         rpc_handler_info.second.rpc_type, nullptr /* handler */));
+    // Indexed like the methods, which 'StartServing' numbers in map order.
+    rpc_metrics_.push_back(std::make_unique<RpcMetrics>(
+        rpc_handler_info.second.fully_qualified_name));
   }
 }
 
@@ -81,6 +88,9 @@ void Service::HandleEvent(Rpc::Event event, Rpc* rpc, bool ok) {
     case Rpc::Event::DONE:
       HandleDone(rpc, ok);
       break;
+    case Rpc::Event::RESUME:
+      // 'Rpc::ResumeEvent' resumes its coroutine itself.
+      break;
   }
 }
 
@@ -99,7 +109,20 @@ void Service::HandleNewConnection(Rpc* rpc, bool ok) {
   }
 
   if (ok) {
-    rpc->OnConnection();
+    std::unique_ptr<AdmissionPolicy::Ticket> ticket;
+    ::grpc::Status status =
+        admission_policy_ == nullptr
+            ? ::grpc::Status::OK
+            : admission_policy_->Admit(
+                  rpc->rpc_handler_info().fully_qualified_name,
+                  *rpc->server_context(), &ticket);
+    if (status.ok()) {
+      rpc->SetAdmissionTicket(std::move(ticket));
+      rpc->OnConnection();
+    } else {
+      // No handler and no reads: the RPC only sends its status.
+      rpc->Finish(status);
+    }
   }
 
   // Create new active rpc to handle next connection and register it for the
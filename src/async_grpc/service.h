@@ -17,12 +17,17 @@
 #ifndef CPP_GRPC_SERVICE_H
 #define CPP_GRPC_SERVICE_H
 
+#include <memory>
+#include <vector>
+
 #include "grpc++/impl/codegen/service_type.h"
+#include "src/async_grpc/admission_policy.h"
 #include "src/async_grpc/completion_queue_thread.h"
 #include "src/async_grpc/event_queue_thread.h"
 #include "src/async_grpc/execution_context.h"
 #include "src/async_grpc/rpc.h"
 #include "src/async_grpc/rpc_handler.h"
+#include "src/async_grpc/rpc_metrics.h"
 
 namespace async_grpc {
 
@@ -35,9 +40,11 @@ class Service : public ::grpc::Service {
   using EventQueueSelector = std::function<EventQueue*()>;
   friend class Rpc;
 
+  // 'admission_policy' may be null to serve every RPC.
   Service(const std::string& service_name,
           const std::map<std::string, RpcHandlerInfo>& rpc_handlers,
-          EventQueueSelector event_queue_selector);
+          EventQueueSelector event_queue_selector,
+          AdmissionPolicy* admission_policy = nullptr);
   void StartServing(std::vector<CompletionQueueThread>& completion_queues,
                     ExecutionContext* execution_context);
   void HandleEvent(Rpc::Event event, Rpc* rpc, bool ok);
@@ -52,8 +59,15 @@ class Service : public ::grpc::Service {
 
   void RemoveIfNotPending(Rpc* rpc);
 
+  // Metrics of the method an 'Rpc' serves, by its 'method_index'.
+  RpcMetrics* rpc_metrics(int method_index) {
+    return rpc_metrics_[method_index].get();
+  }
+
   std::map<std::string, RpcHandlerInfo> rpc_handler_infos_;
+  std::vector<std::unique_ptr<RpcMetrics>> rpc_metrics_;
   EventQueueSelector event_queue_selector_;
+  AdmissionPolicy* admission_policy_;
   ActiveRpcs active_rpcs_;
   bool shutting_down_ = false;
 };
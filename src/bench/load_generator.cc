@@ -0,0 +1,636 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+// End to end load generator: runs the real GrpcServer and HttpServer in
+// process, on a scratch directory with its own config, user database,
+// certificate file and SSH keys and the in memory "local" DNS provider, and
+// drives them from --threads client threads, each with its own gRPC channel
+// and HTTP/1.1 connection, sending a weighted --mix of:
+//   login             UserOp challenge, then UserOp login with its proof
+//   validate          UserOp challenge carrying the session token, which the
+//                     server validates first; the challenge is not redeemed
+//   report            ReportOp OP_REPORT, with DDNS reconciliation
+//   cert_hash         CertOp OP_GET_CERT_FILE_HASH
+//   cert_file         CertOp OP_GET_CERT_FILE of --cert_file_bytes
+//   server_info       ServerOp OP_SERVER_INFO
+//   http_login        POST /user, password only login
+//   http_server_info  POST /server
+// Each thread sends its next request as soon as the previous one completes
+// (closed loop). After --warmup seconds, requests started during the next
+// --duration seconds are measured. The JSON report, on stdout or in
+// --output, has throughput and p50/p99/p999 latency per op, CPU time per
+// request (the client threads' own CPU time is subtracted from the process
+// total to get the server's) and resident memory.
+//
+//   bazel run -c opt //src/bench:load_generator -- --threads=16
+//       --mix=report:10,cert_hash:4,login:1 --output=/tmp/load.json
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/asio/connect.hpp"
+#include "boost/asio/io_context.hpp"
+#include "boost/asio/ip/tcp.hpp"
+#include "boost/beast/core.hpp"
+#include "boost/beast/http.hpp"
+#include "folly/init/Init.h"
+#include "folly/json.h"
+#include "gflags/gflags.h"
+#include "grpcpp/grpcpp.h"
+#include "src/bench/load_stats.h"
+#include "src/bench/mix.h"
+#include "src/common/error.h"
+#include "src/common/heap.h"
+#include "src/common/logging.h"
+#include "src/common/ssh_key_auth.h"
+#include "src/impl/admission_controller.h"
+#include "src/impl/config_manager.h"
+#include "src/impl/ddns_manager.h"
+#include "src/impl/user_manager.h"
+#include "src/proto/error.pb.h"
+#include "src/proto/service.grpc.pb.h"
+#include "src/proto/service.pb.h"
+#include "src/server/grpc_server_impl.h"
+#include "src/server/http_server_impl.h"
+#include "src/server/server_context.h"
+#include "src/server/version_info.h"
+#include "src/util/util.h"
+
+DEFINE_int32(threads, 8, "Client threads.");
+DEFINE_double(duration, 10, "Seconds measured, after the warmup.");
+DEFINE_double(warmup, 2, "Seconds of load before measuring.");
+DEFINE_string(mix, tbox::bench::Mix::kDefault,
+              "Relative weights of the ops, as name:weight,...");
+DEFINE_int32(grpc_port, 20001, "gRPC port of the in process server.");
+DEFINE_int32(http_port, 20003, "HTTP port of the in process server.");
+DEFINE_int32(server_grpc_threads, 3, "grpc_threads of the server config.");
+DEFINE_int32(server_event_threads, 5, "event_threads of the server config.");
+DEFINE_int32(cert_file_bytes, 4096, "Size of the certificate file served.");
+DEFINE_string(work_dir, "",
+              "Scratch directory, a new one under the system temporary "
+              "directory when empty. It becomes the working directory.");
+DEFINE_string(output, "", "File for the JSON report instead of stdout.");
+
+namespace tbox {
+namespace bench {
+namespace {
+
+constexpr const char* kUser = "bench";
+// Passwords are hex encoded client side digests.
+constexpr const char* kPassword =
+    "6265e1d2c4b2a1f0e9d8c7b6a5f4e3d2c1b0a9f8e7d6c5b4a3f2e1d0c9b8a7f6";
+constexpr const char* kCertFile = "bench.example.com.fullchain.cer";
+constexpr auto kRpcTimeout = std::chrono::seconds(10);
+
+enum class Phase { kWarmup, kMeasure, kStop };
+
+std::string ClientId(int index) { return "bench-" + std::to_string(index); }
+
+bool WriteFile(const std::filesystem::path& path, const std::string& content) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file << content;
+  return static_cast<bool>(file);
+}
+
+std::string RandomBytes(size_t size) {
+  std::string bytes(size, '\0');
+  util::Util::FillSecureRandomBytes(&bytes);
+  return bytes;
+}
+
+// The directory layout and config the server expects under its working
+// directory: data/ for the user database, conf/server_config.json, plus the
+// certificate and the SSH key pair the login proofs are made with.
+bool PrepareWorkDir(const std::filesystem::path& dir) {
+  std::error_code ec;
+  for (const char* sub : {"data", "conf", "certs", "keys", "logs"}) {
+    std::filesystem::create_directories(dir / sub, ec);
+    if (ec) {
+      std::fprintf(stderr, "Cannot create %s: %s\n", (dir / sub).c_str(),
+                   ec.message().c_str());
+      return false;
+    }
+  }
+  // The proofs are keyed on the file bytes and the public key line, so
+  // random bytes do as the key pair.
+  const std::filesystem::path private_key = dir / "keys" / "id_ed25519";
+  const std::filesystem::path public_key = dir / "keys" / "id_ed25519.pub";
+  if (!WriteFile(dir / "certs" / kCertFile,
+                 RandomBytes(FLAGS_cert_file_bytes)) ||
+      !WriteFile(private_key, RandomBytes(64)) ||
+      !WriteFile(public_key,
+                 "ssh-ed25519 " + util::Util::Base64Encode(RandomBytes(32)) +
+                     " bench\n")) {
+    std::fprintf(stderr, "Cannot write to %s\n", dir.c_str());
+    return false;
+  }
+
+  folly::dynamic client_ids = folly::dynamic::array;
+  for (int i = 0; i < FLAGS_threads; ++i) {
+    client_ids.push_back(ClientId(i));
+  }
+  folly::dynamic config =
+      folly::dynamic::object("server_addr", "127.0.0.1")(
+          "grpc_server_port", FLAGS_grpc_port)("http_server_port",
+                                               FLAGS_http_port)(
+          "grpc_threads", FLAGS_server_grpc_threads)(
+          "event_threads", FLAGS_server_event_threads)("write_logs", false)(
+          "dns_provider", "local")(
+          "certificate_files", folly::dynamic::array(kCertFile))(
+          "certificate_sync_client_ids", client_ids)(
+          "certificate_path", (dir / "certs").string())(
+          "ssh_private_key_path", private_key.string())(
+          "ssh_public_key_path", public_key.string())("vlmcsd_enabled",
+                                                      false);
+  if (!WriteFile(dir / "conf" / "server_config.json",
+                 folly::toPrettyJson(config))) {
+    std::fprintf(stderr, "Cannot write the server config\n");
+    return false;
+  }
+  return true;
+}
+
+// Blocking HTTP/1.1 client on one keep-alive connection, reconnecting after
+// an error or a close.
+class HttpClient final {
+ public:
+  explicit HttpClient(int port) : port_(port) {}
+
+  // POSTs req as protobuf; parses the body into res when given.
+  bool Post(const std::string& target, const google::protobuf::Message& req,
+            google::protobuf::Message* res) {
+    namespace http = boost::beast::http;
+    boost::beast::error_code ec;
+    if (!connected_ && !Connect()) {
+      return false;
+    }
+    http::request<http::string_body> request(http::verb::post, target, 11);
+    request.set(http::field::host, "127.0.0.1");
+    request.set(http::field::content_type, "application/x-protobuf");
+    request.set(http::field::accept, "application/x-protobuf");
+    request.keep_alive(true);
+    request.body() = req.SerializeAsString();
+    request.prepare_payload();
+    stream_.expires_after(kRpcTimeout);
+    http::write(stream_, request, ec);
+    http::response<http::string_body> response;
+    if (!ec) {
+      http::read(stream_, buffer_, response, ec);
+    }
+    if (ec || !response.keep_alive()) {
+      Close();
+    }
+    if (ec || response.result() != http::status::ok) {
+      return false;
+    }
+    return res == nullptr || res->ParseFromString(response.body());
+  }
+
+  bool Connect() {
+    boost::beast::error_code ec;
+    stream_.expires_after(kRpcTimeout);
+    stream_.connect(boost::asio::ip::tcp::endpoint(
+                        boost::asio::ip::make_address("127.0.0.1"), port_),
+                    ec);
+    connected_ = !ec;
+    return connected_;
+  }
+
+ private:
+  void Close() {
+    boost::beast::error_code ec;
+    stream_.socket().shutdown(boost::asio::ip::tcp::socket::shutdown_both,
+                              ec);
+    stream_.close();
+    buffer_.clear();
+    connected_ = false;
+  }
+
+  const uint16_t port_;
+  boost::asio::io_context ioc_;
+  boost::beast::tcp_stream stream_{ioc_};
+  boost::beast::flat_buffer buffer_;
+  bool connected_ = false;
+};
+
+class Worker final {
+ public:
+  Worker(int index, const Mix& mix)
+      : index_(index),
+        client_id_(ClientId(index)),
+        mix_(mix),
+        http_(FLAGS_http_port),
+        random_(88172645463325252ULL + index) {
+    grpc::ChannelArguments args;
+    // Its own connection, as a separate client would have.
+    args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+    stub_ = proto::TBOXService::NewStub(grpc::CreateCustomChannel(
+        "127.0.0.1:" + std::to_string(FLAGS_grpc_port),
+        grpc::InsecureChannelCredentials(), args));
+  }
+
+  // Logs in, so that the ops needing a session have one.
+  bool Init() { return Login(); }
+
+  void Run(const std::atomic<Phase>& phase) {
+    bool measuring = false;
+    while (true) {
+      const Phase current = phase.load(std::memory_order_acquire);
+      if (current == Phase::kStop) {
+        break;
+      }
+      if (current == Phase::kMeasure && !measuring) {
+        measuring = true;
+        cpu_seconds_ = -ThreadCpuSeconds();
+      }
+      random_ ^= random_ << 13;
+      random_ ^= random_ >> 7;
+      random_ ^= random_ << 17;
+      const Op op = mix_.Pick(random_);
+      const auto start = std::chrono::steady_clock::now();
+      const bool ok = Send(op);
+      const auto end = std::chrono::steady_clock::now();
+      if (measuring) {
+        recorders_[static_cast<size_t>(op)].Record(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+                .count(),
+            ok);
+      }
+    }
+    if (measuring) {
+      cpu_seconds_ += ThreadCpuSeconds();
+    }
+  }
+
+  LatencyRecorder& Recorder(Op op) {
+    return recorders_[static_cast<size_t>(op)];
+  }
+  // CPU time of this thread while measuring.
+  double CpuSeconds() const { return cpu_seconds_; }
+
+ private:
+  template <typename Request>
+  void Prepare(Request* req, proto::OpCode op) {
+    req->set_request_id(util::Util::UUID());
+    req->set_op(op);
+    req->set_token(token_);
+  }
+
+  static void SetDeadline(grpc::ClientContext* context) {
+    context->set_deadline(std::chrono::system_clock::now() + kRpcTimeout);
+  }
+
+  bool Send(Op op) {
+    switch (op) {
+      case Op::kLogin:
+        return Login();
+      case Op::kValidate:
+        return Challenge(token_, RandomBytes(32), nullptr);
+      case Op::kReport:
+        return Report();
+      case Op::kCertHash:
+        return Cert(proto::OpCode::OP_GET_CERT_FILE_HASH);
+      case Op::kCertFile:
+        return Cert(proto::OpCode::OP_GET_CERT_FILE);
+      case Op::kServerInfo:
+        return ServerInfo();
+      case Op::kHttpLogin:
+        return HttpLogin();
+      case Op::kHttpServerInfo:
+        return HttpServerInfo();
+      case Op::kCount:
+        break;
+    }
+    return false;
+  }
+
+  bool Challenge(const std::string& token, const std::string& client_nonce,
+                 proto::UserResponse* res) {
+    proto::UserRequest req;
+    req.set_request_id(client_id_);
+    req.set_op(proto::OpCode::OP_USER_LOGIN_CHALLENGE);
+    req.set_user(kUser);
+    req.set_token(token);
+    req.set_client_nonce(client_nonce);
+    proto::UserResponse response;
+    grpc::ClientContext context;
+    SetDeadline(&context);
+    const grpc::Status status =
+        stub_->UserOp(&context, req, res ? res : &response);
+    return status.ok() &&
+           (res ? res : &response)->err_code() == proto::ErrCode::Success;
+  }
+
+  bool Login() {
+    const std::string client_nonce = RandomBytes(32);
+    proto::UserResponse challenge;
+    if (!Challenge("", client_nonce, &challenge)) {
+      return false;
+    }
+    auto config = util::ConfigManager::Instance();
+    proto::UserRequest req;
+    if (!common::SshKeyAuth::CreateClientProof(
+            config->SshPrivateKeyPath(), config->SshPublicKeyPath(),
+            common::SshKeyAuth::BuildLoginMessage(
+                challenge.challenge_id(), client_nonce,
+                challenge.server_nonce(), kUser, client_id_),
+            req.mutable_signature())) {
+      return false;
+    }
+    req.set_request_id(client_id_);
+    req.set_op(proto::OpCode::OP_USER_LOGIN);
+    req.set_user(kUser);
+    req.set_password(kPassword);
+    req.set_challenge_id(challenge.challenge_id());
+    proto::UserResponse res;
+    grpc::ClientContext context;
+    SetDeadline(&context);
+    if (!stub_->UserOp(&context, req, &res).ok() ||
+        res.err_code() != proto::ErrCode::Success) {
+      return false;
+    }
+    token_ = res.token();
+    return true;
+  }
+
+  bool Report() {
+    proto::ReportRequest req;
+    Prepare(&req, proto::OpCode::OP_REPORT);
+    // Documentation ranges, which DDNS treats as public addresses.
+    req.add_client_ip("203.0.113." + std::to_string(index_ % 254 + 1));
+    req.add_client_ip("2001:db8::" + std::to_string(index_ + 1));
+    req.set_timestamp(std::time(nullptr));
+    req.set_client_info("tbox load generator");
+    req.set_client_id(client_id_);
+    req.add_monitor_domains(client_id_ + ".bench.example.com");
+    proto::ReportResponse res;
+    grpc::ClientContext context;
+    SetDeadline(&context);
+    return stub_->ReportOp(&context, req, &res).ok() &&
+           res.err_code() == proto::ErrCode::Success;
+  }
+
+  bool Cert(proto::OpCode op) {
+    proto::CertRequest req;
+    Prepare(&req, op);
+    req.set_filename(kCertFile);
+    req.set_client_id(client_id_);
+    proto::CertResponse res;
+    grpc::ClientContext context;
+    SetDeadline(&context);
+    return stub_->CertOp(&context, req, &res).ok() &&
+           res.err_code() == proto::ErrCode::Success;
+  }
+
+  bool ServerInfo() {
+    proto::ServerRequest req;
+    Prepare(&req, proto::OpCode::OP_SERVER_INFO);
+    proto::ServerResponse res;
+    grpc::ClientContext context;
+    SetDeadline(&context);
+    return stub_->ServerOp(&context, req, &res).ok() &&
+           res.err_code() == proto::ErrCode::Success;
+  }
+
+  bool HttpLogin() {
+    proto::UserRequest req;
+    req.set_request_id(client_id_);
+    req.set_op(proto::OpCode::OP_USER_LOGIN);
+    req.set_user(kUser);
+    req.set_password(kPassword);
+    proto::UserResponse res;
+    return http_.Post("/user", req, &res) &&
+           res.err_code() == proto::ErrCode::Success;
+  }
+
+  bool HttpServerInfo() {
+    proto::ServerRequest req;
+    Prepare(&req, proto::OpCode::OP_SERVER_INFO);
+    return http_.Post("/server", req, nullptr);
+  }
+
+  const int index_;
+  const std::string client_id_;
+  const Mix mix_;
+  std::unique_ptr<proto::TBOXService::Stub> stub_;
+  HttpClient http_;
+  std::string token_;
+  uint64_t random_;
+  std::array<LatencyRecorder, kOpCount> recorders_;
+  double cpu_seconds_ = 0;
+};
+
+// Polls until the HTTP server, started on another thread, accepts.
+bool WaitForHttpServer() {
+  for (int i = 0; i < 200; ++i) {
+    HttpClient client(FLAGS_http_port);
+    if (client.Connect()) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  return false;
+}
+
+folly::dynamic OpReport(const LatencySummary& summary, double seconds) {
+  return folly::dynamic::object("requests",
+                                static_cast<int64_t>(summary.requests))(
+      "errors", static_cast<int64_t>(summary.errors))(
+      "throughput_rps", summary.requests / seconds)(
+      "mean_us", summary.mean_us)("p50_us", summary.p50_us)(
+      "p99_us", summary.p99_us)("p999_us", summary.p999_us)("max_us",
+                                                            summary.max_us);
+}
+
+int Run(const Mix& mix) {
+  auto config = util::ConfigManager::Instance();
+  if (!config->Init("./conf/server_config.json")) {
+    std::fprintf(stderr, "Failed to initialize the server config\n");
+    return 1;
+  }
+  impl::AdmissionController::Instance()->Configure(
+      impl::AdmissionController::FromConfig());
+  memory::Heap::ExportMetrics();
+  auto users = impl::UserManager::Instance();
+  if (!users->Init()) {
+    std::fprintf(stderr, "Failed to open the user database\n");
+    return 1;
+  }
+  std::string token;
+  const int32_t registered = users->UserRegister(kUser, kPassword, &token);
+  // The user is already there when --work_dir is reused.
+  if (registered != Err_Success && registered != Err_User_exists) {
+    std::fprintf(stderr, "Failed to create the bench user\n");
+    return 1;
+  }
+  if (!impl::DDNSManager::Instance()->Init()) {
+    std::fprintf(stderr, "Failed to initialize DDNS\n");
+    return 1;
+  }
+
+  auto server_context = std::make_shared<server::ServerContext>();
+  server::GrpcServer grpc_server(server_context);
+  grpc_server.Start();
+  server::HttpServer http_server(server_context);
+  std::thread http_thread([&http_server] { http_server.Start(); });
+
+  int status = 0;
+  std::vector<std::unique_ptr<Worker>> workers;
+  if (!WaitForHttpServer()) {
+    std::fprintf(stderr, "HTTP server did not start on port %d\n",
+                 FLAGS_http_port);
+    status = 1;
+  }
+  for (int i = 0; status == 0 && i < FLAGS_threads; ++i) {
+    workers.push_back(std::make_unique<Worker>(i, mix));
+    if (!workers.back()->Init()) {
+      std::fprintf(stderr, "Worker %d failed to log in\n", i);
+      status = 1;
+    }
+  }
+
+  if (status == 0) {
+    std::atomic<Phase> phase{Phase::kWarmup};
+    std::vector<std::thread> threads;
+    for (auto& worker : workers) {
+      threads.emplace_back([&worker, &phase] { worker->Run(phase); });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(FLAGS_warmup));
+    const ProcessUsage before = ProcessUsage::Now();
+    const auto start = std::chrono::steady_clock::now();
+    phase.store(Phase::kMeasure, std::memory_order_release);
+    std::this_thread::sleep_for(
+        std::chrono::duration<double>(FLAGS_duration));
+    phase.store(Phase::kStop, std::memory_order_release);
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                      start)
+            .count();
+    const ProcessUsage after = ProcessUsage::Now();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    LatencyRecorder total;
+    double client_cpu = 0;
+    folly::dynamic ops = folly::dynamic::object;
+    for (size_t i = 0; i < kOpCount; ++i) {
+      const Op op = static_cast<Op>(i);
+      if (mix.Weight(op) == 0) {
+        continue;
+      }
+      LatencyRecorder merged;
+      for (auto& worker : workers) {
+        merged.Merge(worker->Recorder(op));
+      }
+      total.Merge(merged);
+      ops[OpName(op)] = OpReport(merged.Summarize(), seconds);
+    }
+    for (auto& worker : workers) {
+      client_cpu += worker->CpuSeconds();
+    }
+    const double requests = std::max<double>(total.Requests(), 1);
+    const double process_cpu = after.cpu_seconds - before.cpu_seconds;
+    const double server_cpu = std::max(process_cpu - client_cpu, 0.0);
+
+    const folly::dynamic report =
+        folly::dynamic::object("git_commit", GIT_VERSION)(
+            "timestamp", static_cast<int64_t>(std::time(nullptr)))(
+            "allocator", memory::Heap::Isolated() ? "mimalloc" : "system")(
+            "cpus", static_cast<int64_t>(std::thread::hardware_concurrency()))(
+            "threads", FLAGS_threads)("mix", FLAGS_mix)(
+            "seconds", seconds)("total", OpReport(total.Summarize(), seconds))(
+            "ops", ops)(
+            "cpu", folly::dynamic::object("process_seconds", process_cpu)(
+                       "client_seconds", client_cpu)("server_seconds",
+                                                     server_cpu)(
+                       "server_us_per_request", server_cpu * 1e6 / requests)(
+                       "process_us_per_request",
+                       process_cpu * 1e6 / requests))(
+            "memory",
+            folly::dynamic::object(
+                "rss_bytes_start", static_cast<int64_t>(before.rss_bytes))(
+                "rss_bytes_end", static_cast<int64_t>(after.rss_bytes))(
+                "peak_rss_bytes", static_cast<int64_t>(after.peak_rss_bytes)));
+    const std::string json = folly::toPrettyJson(report) + "\n";
+    if (FLAGS_output.empty()) {
+      std::cout << json;
+    } else if (!WriteFile(FLAGS_output, json)) {
+      std::fprintf(stderr, "Cannot write %s\n", FLAGS_output.c_str());
+      status = 1;
+    }
+  }
+
+  workers.clear();
+  // Same order as the server: the gRPC queues may drain on the HTTP IO
+  // executor.
+  grpc_server.Shutdown();
+  http_server.Shutdown();
+  http_thread.join();
+  return status;
+}
+
+}  // namespace
+}  // namespace bench
+}  // namespace tbox
+
+int main(int argc, char** argv) {
+  gflags::SetUsageMessage("In process load generator for the tbox servers");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::Init init(&argc, &argv, false);
+#if !defined(_WIN32)
+  signal(SIGPIPE, SIG_IGN);
+#endif
+
+  tbox::bench::Mix mix;
+  std::string error;
+  if (FLAGS_threads <= 0 || FLAGS_duration <= 0 || FLAGS_warmup < 0) {
+    std::fprintf(stderr, "--threads and --duration must be positive\n");
+    return 1;
+  }
+  if (!tbox::bench::Mix::Parse(FLAGS_mix, &mix, &error)) {
+    std::fprintf(stderr, "Bad --mix: %s\n", error.c_str());
+    return 1;
+  }
+
+  const bool scratch = FLAGS_work_dir.empty();
+  const std::filesystem::path dir =
+      scratch ? std::filesystem::temp_directory_path() /
+                    ("tbox_load_generator." + std::to_string(getpid()))
+              : std::filesystem::absolute(FLAGS_work_dir);
+  if (!FLAGS_output.empty()) {
+    FLAGS_output = std::filesystem::absolute(FLAGS_output).string();
+  }
+  if (!tbox::bench::PrepareWorkDir(dir)) {
+    return 1;
+  }
+  // Util::HomeDir() is the working directory; the user database goes there.
+  std::filesystem::current_path(dir);
+  tbox::logging::Initialize(argv[0], (dir / "logs").string(), false);
+
+  const int status = tbox::bench::Run(mix);
+
+  tbox::logging::Shutdown();
+  if (scratch) {
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+  }
+  return status;
+}
@@ -0,0 +1,102 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/bench/load_stats.h"
+
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace tbox {
+namespace bench {
+namespace {
+
+double Seconds(const timeval& time) {
+  return static_cast<double>(time.tv_sec) +
+         static_cast<double>(time.tv_usec) / 1e6;
+}
+
+uint64_t ResidentBytes() {
+  FILE* file = std::fopen("/proc/self/statm", "r");
+  if (file == nullptr) {
+    return 0;
+  }
+  long size = 0;      // NOLINT(runtime/int)
+  long resident = 0;  // NOLINT(runtime/int)
+  const int fields = std::fscanf(file, "%ld %ld", &size, &resident);
+  std::fclose(file);
+  return fields == 2 ? static_cast<uint64_t>(resident) * sysconf(_SC_PAGESIZE)
+                     : 0;
+}
+
+// Sample at rank ceil(q * n), samples sorted.
+double Percentile(const std::vector<int64_t>& samples, double q) {
+  size_t rank = static_cast<size_t>(std::ceil(q * samples.size()));
+  rank = std::clamp<size_t>(rank, 1, samples.size());
+  return static_cast<double>(samples[rank - 1]) / 1e3;
+}
+
+}  // namespace
+
+void LatencyRecorder::Record(int64_t nanos, bool ok) {
+  samples_.push_back(nanos);
+  if (!ok) {
+    ++errors_;
+  }
+}
+
+void LatencyRecorder::Merge(const LatencyRecorder& other) {
+  samples_.insert(samples_.end(), other.samples_.begin(),
+                  other.samples_.end());
+  errors_ += other.errors_;
+}
+
+LatencySummary LatencyRecorder::Summarize() {
+  LatencySummary summary;
+  summary.requests = samples_.size();
+  summary.errors = errors_;
+  if (samples_.empty()) {
+    return summary;
+  }
+  std::sort(samples_.begin(), samples_.end());
+  double total = 0;
+  for (int64_t sample : samples_) {
+    total += static_cast<double>(sample);
+  }
+  summary.mean_us = total / samples_.size() / 1e3;
+  summary.p50_us = Percentile(samples_, 0.5);
+  summary.p99_us = Percentile(samples_, 0.99);
+  summary.p999_us = Percentile(samples_, 0.999);
+  summary.max_us = static_cast<double>(samples_.back()) / 1e3;
+  return summary;
+}
+
+ProcessUsage ProcessUsage::Now() {
+  ProcessUsage usage;
+  rusage self;
+  if (getrusage(RUSAGE_SELF, &self) == 0) {
+    usage.cpu_seconds = Seconds(self.ru_utime) + Seconds(self.ru_stime);
+    // Kilobytes on Linux.
+    usage.peak_rss_bytes = static_cast<uint64_t>(self.ru_maxrss) * 1024;
+  }
+  usage.rss_bytes = ResidentBytes();
+  return usage;
+}
+
+double ThreadCpuSeconds() {
+  timespec time;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) {
+    return 0;
+  }
+  return static_cast<double>(time.tv_sec) +
+         static_cast<double>(time.tv_nsec) / 1e9;
+}
+
+}  // namespace bench
+}  // namespace tbox
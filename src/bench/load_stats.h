@@ -0,0 +1,60 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_BENCH_LOAD_STATS_H_
+#define TBOX_BENCH_LOAD_STATS_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace tbox {
+namespace bench {
+
+/// @brief Latency percentiles of one op, in microseconds.
+struct LatencySummary {
+  uint64_t requests = 0;
+  uint64_t errors = 0;
+  double mean_us = 0;
+  double p50_us = 0;
+  double p99_us = 0;
+  double p999_us = 0;
+  double max_us = 0;
+};
+
+/// @brief Every latency of one op seen by one worker; workers merge theirs
+///        once the run is over, so recording takes no lock.
+/// @details Samples are kept rather than bucketed so that p999 is exact; a
+///          million requests cost 8 MB.
+class LatencyRecorder final {
+ public:
+  void Record(int64_t nanos, bool ok);
+  void Merge(const LatencyRecorder& other);
+
+  uint64_t Requests() const { return samples_.size(); }
+
+  /// @brief Nearest rank percentiles; sorts the samples.
+  LatencySummary Summarize();
+
+ private:
+  std::vector<int64_t> samples_;
+  uint64_t errors_ = 0;
+};
+
+/// @brief CPU time and memory of the whole process.
+struct ProcessUsage {
+  double cpu_seconds = 0;  // User plus system time of every thread.
+  uint64_t rss_bytes = 0;
+  uint64_t peak_rss_bytes = 0;
+
+  static ProcessUsage Now();
+};
+
+/// @brief User plus system time of the calling thread.
+double ThreadCpuSeconds();
+
+}  // namespace bench
+}  // namespace tbox
+
+#endif  // TBOX_BENCH_LOAD_STATS_H_
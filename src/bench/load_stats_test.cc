@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/bench/load_stats.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace bench {
+namespace {
+
+TEST(LoadStatsTest, Percentiles) {
+  LatencyRecorder first;
+  LatencyRecorder second;
+  // 1..1000 us, split across two workers and out of order.
+  for (int64_t i = 1000; i >= 1; --i) {
+    (i % 2 == 0 ? first : second).Record(i * 1000, i % 100 != 0);
+  }
+  first.Merge(second);
+  EXPECT_EQ(first.Requests(), 1000u);
+
+  const LatencySummary summary = first.Summarize();
+  EXPECT_EQ(summary.requests, 1000u);
+  EXPECT_EQ(summary.errors, 10u);
+  EXPECT_DOUBLE_EQ(summary.mean_us, 500.5);
+  EXPECT_DOUBLE_EQ(summary.p50_us, 500);
+  EXPECT_DOUBLE_EQ(summary.p99_us, 990);
+  EXPECT_DOUBLE_EQ(summary.p999_us, 999);
+  EXPECT_DOUBLE_EQ(summary.max_us, 1000);
+}
+
+TEST(LoadStatsTest, FewSamples) {
+  LatencyRecorder recorder;
+  EXPECT_EQ(recorder.Summarize().requests, 0u);
+
+  recorder.Record(7000, true);
+  const LatencySummary summary = recorder.Summarize();
+  EXPECT_DOUBLE_EQ(summary.p50_us, 7);
+  EXPECT_DOUBLE_EQ(summary.p999_us, 7);
+}
+
+TEST(LoadStatsTest, ProcessUsage) {
+  // Keep a few pages resident.
+  std::vector<char> pages(1 << 20, 1);
+  volatile int64_t sum = 0;
+  for (int i = 0; i < 1000000; ++i) {
+    sum = sum + i;
+  }
+  const ProcessUsage usage = ProcessUsage::Now();
+  EXPECT_GT(usage.rss_bytes, pages.size());
+  EXPECT_GE(usage.peak_rss_bytes, pages.size());
+  EXPECT_GT(usage.cpu_seconds, 0);
+  EXPECT_GT(ThreadCpuSeconds(), 0);
+  EXPECT_LE(ThreadCpuSeconds(), ProcessUsage::Now().cpu_seconds + 0.01);
+}
+
+}  // namespace
+}  // namespace bench
+}  // namespace tbox
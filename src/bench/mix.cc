@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/bench/mix.h"
+
+#include <charconv>
+#include <string>
+#include <string_view>
+
+namespace tbox {
+namespace bench {
+namespace {
+
+constexpr const char* kNames[kOpCount] = {
+    "login",     "validate",    "report",     "cert_hash",
+    "cert_file", "server_info", "http_login", "http_server_info",
+};
+
+}  // namespace
+
+const char* OpName(Op op) { return kNames[static_cast<size_t>(op)]; }
+
+bool Mix::Parse(std::string_view spec, Mix* mix, std::string* error) {
+  Mix parsed;
+  while (!spec.empty()) {
+    const size_t comma = spec.find(',');
+    const std::string_view entry = spec.substr(0, comma);
+    spec = comma == std::string_view::npos ? std::string_view()
+                                           : spec.substr(comma + 1);
+    if (entry.empty()) {
+      continue;
+    }
+    const size_t colon = entry.find(':');
+    if (colon == std::string_view::npos) {
+      *error = "missing weight in \"" + std::string(entry) + "\"";
+      return false;
+    }
+    const std::string_view name = entry.substr(0, colon);
+    const std::string_view weight = entry.substr(colon + 1);
+    size_t index = 0;
+    while (index < kOpCount && name != kNames[index]) {
+      ++index;
+    }
+    if (index == kOpCount) {
+      *error = "unknown op \"" + std::string(name) + "\"";
+      return false;
+    }
+    uint32_t value = 0;
+    const auto [end, ec] =
+        std::from_chars(weight.data(), weight.data() + weight.size(), value);
+    if (ec != std::errc() || end != weight.data() + weight.size()) {
+      *error = "bad weight in \"" + std::string(entry) + "\"";
+      return false;
+    }
+    parsed.total_ += value;
+    parsed.total_ -= parsed.weights_[index];
+    parsed.weights_[index] = value;
+  }
+  if (parsed.total_ == 0) {
+    *error = "every weight is 0";
+    return false;
+  }
+  *mix = parsed;
+  return true;
+}
+
+Op Mix::Pick(uint64_t random) const {
+  uint64_t point = random % total_;
+  for (size_t i = 0; i < kOpCount; ++i) {
+    if (point < weights_[i]) {
+      return static_cast<Op>(i);
+    }
+    point -= weights_[i];
+  }
+  return Op::kCount;
+}
+
+}  // namespace bench
+}  // namespace tbox
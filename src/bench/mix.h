@@ -0,0 +1,66 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_BENCH_MIX_H_
+#define TBOX_BENCH_MIX_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace tbox {
+namespace bench {
+
+/// @brief Requests the load generator can send.
+enum class Op {
+  kLogin = 0,       // UserOp challenge, then UserOp login with its proof.
+  kValidate,        // UserOp challenge carrying the session token.
+  kReport,          // ReportOp OP_REPORT, reconciling DDNS records.
+  kCertHash,        // CertOp OP_GET_CERT_FILE_HASH.
+  kCertFile,        // CertOp OP_GET_CERT_FILE.
+  kServerInfo,      // ServerOp OP_SERVER_INFO.
+  kHttpLogin,       // POST /user, password only login.
+  kHttpServerInfo,  // POST /server; shells out to curl for the public IP.
+  kCount,
+};
+
+constexpr size_t kOpCount = static_cast<size_t>(Op::kCount);
+
+/// @brief Name of op in mix specs and reports, e.g. "cert_hash".
+const char* OpName(Op op);
+
+/// @brief Relative weights of the ops a worker picks from.
+class Mix final {
+ public:
+  /// @brief Roughly what a fleet of clients sends: mostly reports and
+  ///        certificate checks, few logins. http_server_info is left out
+  ///        since its curl calls dominate everything else.
+  static constexpr const char* kDefault =
+      "login:1,validate:4,report:10,cert_hash:4,cert_file:1,server_info:1,"
+      "http_login:1";
+
+  /// @brief Parse "name:weight,..." where weights are non negative integers
+  ///        and unnamed ops get 0.
+  /// @return false, with a message in error, for an unknown name, a bad
+  ///         weight or a spec whose weights are all 0.
+  static bool Parse(std::string_view spec, Mix* mix, std::string* error);
+
+  uint32_t Weight(Op op) const { return weights_[static_cast<size_t>(op)]; }
+  uint64_t TotalWeight() const { return total_; }
+
+  /// @brief The op for a uniformly distributed random number.
+  Op Pick(uint64_t random) const;
+
+ private:
+  std::array<uint32_t, kOpCount> weights_{};
+  uint64_t total_ = 0;
+};
+
+}  // namespace bench
+}  // namespace tbox
+
+#endif  // TBOX_BENCH_MIX_H_
@@ -0,0 +1,66 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/bench/mix.h"
+
+#include <array>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace bench {
+namespace {
+
+TEST(MixTest, Parse) {
+  Mix mix;
+  std::string error;
+  ASSERT_TRUE(Mix::Parse("login:1,report:3,cert_file:0", &mix, &error));
+  EXPECT_EQ(mix.Weight(Op::kLogin), 1u);
+  EXPECT_EQ(mix.Weight(Op::kReport), 3u);
+  EXPECT_EQ(mix.Weight(Op::kCertFile), 0u);
+  EXPECT_EQ(mix.Weight(Op::kValidate), 0u);
+  EXPECT_EQ(mix.TotalWeight(), 4u);
+
+  // A later entry replaces an earlier one.
+  ASSERT_TRUE(Mix::Parse("report:3,,report:5", &mix, &error));
+  EXPECT_EQ(mix.TotalWeight(), 5u);
+
+  ASSERT_TRUE(Mix::Parse(Mix::kDefault, &mix, &error)) << error;
+  EXPECT_EQ(mix.Weight(Op::kHttpServerInfo), 0u);
+}
+
+TEST(MixTest, ParseErrors) {
+  Mix mix;
+  std::string error;
+  EXPECT_FALSE(Mix::Parse("", &mix, &error));
+  EXPECT_FALSE(Mix::Parse("login:0", &mix, &error));
+  EXPECT_FALSE(Mix::Parse("login", &mix, &error));
+  EXPECT_FALSE(Mix::Parse("login:x", &mix, &error));
+  EXPECT_FALSE(Mix::Parse("login:-1", &mix, &error));
+  EXPECT_FALSE(Mix::Parse("logout:1", &mix, &error));
+  EXPECT_EQ(error, "unknown op \"logout\"");
+}
+
+TEST(MixTest, PickFollowsWeights) {
+  Mix mix;
+  std::string error;
+  ASSERT_TRUE(Mix::Parse("validate:1,cert_hash:3", &mix, &error));
+  std::array<int, kOpCount> picks{};
+  for (uint64_t i = 0; i < 400; ++i) {
+    ++picks[static_cast<size_t>(mix.Pick(i))];
+  }
+  EXPECT_EQ(picks[static_cast<size_t>(Op::kValidate)], 100);
+  EXPECT_EQ(picks[static_cast<size_t>(Op::kCertHash)], 300);
+}
+
+TEST(MixTest, OpName) {
+  EXPECT_STREQ(OpName(Op::kCertHash), "cert_hash");
+  EXPECT_STREQ(OpName(Op::kHttpServerInfo), "http_server_info");
+}
+
+}  // namespace
+}  // namespace bench
+}  // namespace tbox
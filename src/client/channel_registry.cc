@@ -0,0 +1,309 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/client/channel_registry.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <utility>
+
+#include "src/async_grpc/server.h"
+#include "src/client/ssl_config_manager.h"
+#include "src/common/logging.h"
+#include "src/common/socket_compat.h"
+#include "src/impl/config_manager.h"
+
+namespace tbox {
+namespace client {
+
+namespace {
+
+constexpr int kKeepaliveTimeoutMs = 20000;
+
+uint32_t ParsePort(const std::string& text, uint32_t default_port) {
+  const unsigned long port = std::strtoul(text.c_str(), nullptr, 10);
+  return port == 0 || port > 65535 ? default_port : port;
+}
+
+// Splits "host", "host:port", "[v6]" or "[v6]:port"; a bare IPv6 literal is
+// a host.
+std::pair<std::string, uint32_t> SplitHostPort(const std::string& entry,
+                                               uint32_t default_port) {
+  if (!entry.empty() && entry.front() == '[') {
+    const size_t close = entry.find(']');
+    if (close == std::string::npos) {
+      return {entry, default_port};
+    }
+    const std::string host = entry.substr(1, close - 1);
+    if (close + 2 < entry.size() && entry[close + 1] == ':') {
+      return {host, ParsePort(entry.substr(close + 2), default_port)};
+    }
+    return {host, default_port};
+  }
+  const size_t colon = entry.find(':');
+  if (colon != std::string::npos &&
+      entry.find(':', colon + 1) == std::string::npos) {
+    return {entry.substr(0, colon),
+            ParsePort(entry.substr(colon + 1), default_port)};
+  }
+  return {entry, default_port};
+}
+
+std::vector<std::string> Resolve(const std::string& host, int family) {
+  struct addrinfo hints, *res = nullptr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = family;
+  hints.ai_socktype = SOCK_STREAM;
+  std::vector<std::string> addresses;
+  if (getaddrinfo(host.c_str(), nullptr, &hints, &res) != 0) {
+    return addresses;
+  }
+  for (const struct addrinfo* ai = res; ai != nullptr; ai = ai->ai_next) {
+    char buffer[INET6_ADDRSTRLEN];
+    const void* address =
+        family == AF_INET
+            ? static_cast<const void*>(
+                  &reinterpret_cast<const struct sockaddr_in*>(ai->ai_addr)
+                       ->sin_addr)
+            : static_cast<const void*>(
+                  &reinterpret_cast<const struct sockaddr_in6*>(ai->ai_addr)
+                       ->sin6_addr);
+    if (inet_ntop(family, address, buffer, sizeof(buffer)) != nullptr &&
+        std::find(addresses.begin(), addresses.end(), buffer) ==
+            addresses.end()) {
+      addresses.push_back(buffer);
+    }
+  }
+  freeaddrinfo(res);
+  return addresses;
+}
+
+// Comma separated "ipv4:"/"ipv6:" address list, empty if nothing resolves.
+std::string ResolvedTarget(const ChannelRegistry::Options& options,
+                           int family) {
+  std::string target;
+  for (const auto& entry : options.hosts) {
+    const auto [host, port] = SplitHostPort(entry, options.port);
+    for (const auto& address : Resolve(host, family)) {
+      if (target.empty()) {
+        target = family == AF_INET ? "ipv4:" : "ipv6:";
+      } else {
+        target += ",";
+      }
+      target += family == AF_INET ? address : "[" + address + "]";
+      target += ":" + std::to_string(port);
+    }
+  }
+  return target;
+}
+
+// Name resolution is left to gRPC only for a single host of any family; it
+// then follows DNS changes by itself.
+bool UsesDns(const ChannelRegistry::Options& options) {
+  return options.family == ChannelRegistry::AddressFamily::kAny &&
+         options.hosts.size() == 1;
+}
+
+// gRPC C++ has no least-request policy; with the few, equal servers a
+// client talks to, round robin over the healthy ones comes closest.
+std::string ServiceConfig(const std::string& lb_policy) {
+  if (lb_policy == "round_robin" || lb_policy == "least_request") {
+    return R"({"loadBalancingConfig":[{"round_robin":{}}],)"
+           R"("healthCheckConfig":{"serviceName":""}})";
+  }
+  if (lb_policy != "pick_first") {
+    LOG(WARNING) << "Unknown gRPC load balancing policy " << lb_policy
+                 << ", using pick_first";
+  }
+  return "";
+}
+
+}  // namespace
+
+std::shared_ptr<ChannelRegistry> ChannelRegistry::Instance() {
+  static std::shared_ptr<ChannelRegistry> instance(new ChannelRegistry());
+  return instance;
+}
+
+std::optional<ChannelRegistry::Options> ChannelRegistry::ServerOptions(
+    AddressFamily family) {
+  auto config_manager = util::ConfigManager::Instance();
+  Options options;
+  std::string server_addr = config_manager->ServerAddr();
+  if (server_addr.find("http://") == 0) {
+    server_addr = server_addr.substr(7);
+    options.use_tls = false;
+  } else if (server_addr.find("https://") == 0) {
+    server_addr = server_addr.substr(8);
+  }
+  options.hosts.push_back(server_addr);
+  for (const auto& addr : config_manager->GrpcServerAddrs()) {
+    options.hosts.push_back(addr);
+  }
+  options.port = config_manager->GrpcServerPort();
+  options.family = family;
+  options.lb_policy = config_manager->GrpcLbPolicy();
+  options.compression = config_manager->GrpcCompression();
+  options.keepalive_ms = config_manager->GrpcKeepaliveMs();
+
+  if (options.use_tls) {
+    std::string ca_cert_path = config_manager->LocalCertPath();
+    if (ca_cert_path.empty()) {
+      ca_cert_path = "conf/ca-bundle.pem";  // Default fallback
+    }
+    options.ca_cert = SSLConfigManager::LoadCACert(ca_cert_path);
+    if (options.ca_cert.empty()) {
+      LOG(ERROR) << "Failed to load CA certificate from: " << ca_cert_path;
+      return std::nullopt;
+    }
+  }
+  return options;
+}
+
+std::string ChannelRegistry::Target(const Options& options) {
+  if (options.hosts.empty()) {
+    return "";
+  }
+  if (UsesDns(options)) {
+    const auto [host, port] =
+        SplitHostPort(options.hosts.front(), options.port);
+    const bool ipv6_literal = host.find(':') != std::string::npos;
+    return "dns:///" + (ipv6_literal ? "[" + host + "]" : host) + ":" +
+           std::to_string(port);
+  }
+  switch (options.family) {
+    case AddressFamily::kIPv4:
+      return ResolvedTarget(options, AF_INET);
+    case AddressFamily::kIPv6:
+      return ResolvedTarget(options, AF_INET6);
+    case AddressFamily::kAny:
+      break;
+  }
+  // One target holds one family; several servers of any family are reached
+  // over IPv4 when they have it.
+  std::string target = ResolvedTarget(options, AF_INET);
+  return target.empty() ? ResolvedTarget(options, AF_INET6) : target;
+}
+
+std::string ChannelRegistry::Key(const Options& options) {
+  std::string key;
+  for (const auto& host : options.hosts) {
+    key += host + ",";
+  }
+  key += "|" + std::to_string(options.port) + "|" +
+         std::to_string(static_cast<int>(options.family)) + "|" +
+         (options.use_tls ? "tls" : "plain") + "|" +
+         std::to_string(std::hash<std::string>()(options.ca_cert)) + "|" +
+         options.lb_policy + "|" + options.compression + "|" +
+         std::to_string(options.keepalive_ms);
+  return key;
+}
+
+std::shared_ptr<grpc::Channel> ChannelRegistry::GetChannel(
+    const Options& options) {
+  const std::string key = Key(options);
+  // A failed channel is rebuilt from a fresh resolution; with gRPC doing the
+  // DNS itself the channel recovers on its own.
+  auto usable = [&options](const std::shared_ptr<grpc::Channel>& channel) {
+    return UsesDns(options) ||
+           channel->GetState(/*try_to_connect=*/false) !=
+               GRPC_CHANNEL_TRANSIENT_FAILURE;
+  };
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channels_.find(key);
+    if (it != channels_.end() && usable(it->second)) {
+      return it->second;
+    }
+  }
+
+  // Target() may block in getaddrinfo, so it runs without the lock; callers
+  // for other channels are not held up by a slow lookup.
+  const std::string target = Target(options);
+  if (target.empty()) {
+    return nullptr;
+  }
+
+  grpc::ChannelArguments args;
+  args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS, options.keepalive_ms);
+  args.SetInt(GRPC_ARG_KEEPALIVE_TIMEOUT_MS, kKeepaliveTimeoutMs);
+  args.SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+  args.SetInt(GRPC_ARG_HTTP2_MAX_PINGS_WITHOUT_DATA, 0);
+
+  const std::string service_config = ServiceConfig(options.lb_policy);
+  if (!service_config.empty()) {
+    args.SetServiceConfigJSON(service_config);
+  }
+
+  // gRPC advertises every algorithm it supports in grpc-accept-encoding, so
+  // responses may be compressed regardless; this only affects requests.
+  grpc_compression_algorithm algorithm;
+  if (async_grpc::ParseCompressionAlgorithm(options.compression,
+                                            &algorithm)) {
+    args.SetCompressionAlgorithm(algorithm);
+  }
+
+  const std::string authority =
+      SplitHostPort(options.hosts.front(), options.port).first;
+  if (!UsesDns(options)) {
+    // Set authority to the original hostname for nginx routing
+    args.SetString(GRPC_ARG_DEFAULT_AUTHORITY, authority);
+  }
+
+  std::shared_ptr<grpc::ChannelCredentials> creds;
+  if (options.use_tls) {
+    grpc::SslCredentialsOptions ssl_opts;
+    ssl_opts.pem_root_certs = options.ca_cert;
+    creds = grpc::SslCredentials(ssl_opts);
+    if (!UsesDns(options)) {
+      args.SetSslTargetNameOverride(authority);
+    }
+  } else {
+    creds = grpc::InsecureChannelCredentials();
+  }
+
+  auto channel = grpc::CreateCustomChannel(target, creds, args);
+  if (!channel) {
+    LOG(WARNING) << "Failed to create gRPC channel to " << target;
+    return nullptr;
+  }
+  {
+    // Another caller may have built the same channel meanwhile.
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto [it, inserted] = channels_.emplace(key, channel);
+    if (!inserted) {
+      if (usable(it->second)) {
+        return it->second;
+      }
+      it->second = channel;
+    }
+  }
+  // Start resolving, connecting and the TLS handshake before the first call.
+  channel->GetState(/*try_to_connect=*/true);
+  LOG(INFO) << "Created gRPC channel to " << target << " ("
+            << options.lb_policy << ")";
+  return channel;
+}
+
+bool ChannelRegistry::WarmUp(const std::shared_ptr<grpc::Channel>& channel,
+                             std::chrono::milliseconds timeout) {
+  return channel->WaitForConnected(std::chrono::system_clock::now() +
+                                   timeout);
+}
+
+void ChannelRegistry::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  channels_.clear();
+}
+
+size_t ChannelRegistry::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return channels_.size();
+}
+
+}  // namespace client
+}  // namespace tbox
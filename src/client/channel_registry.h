@@ -0,0 +1,98 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_CLIENT_CHANNEL_REGISTRY_H_
+#define TBOX_CLIENT_CHANNEL_REGISTRY_H_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include "grpcpp/grpcpp.h"
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace tbox {
+namespace client {
+
+/// @brief Process wide cache of gRPC channels to the tbox servers.
+/// @details Channels are keyed by target, address family and credentials, so
+///          GrpcClient, ReportManager and SSLConfigManager share one HTTP/2
+///          connection and one TLS handshake per server instead of one per
+///          component. Every channel sends keepalive pings, starts
+///          connecting as soon as it is created and, with several servers,
+///          spreads calls by the configured policy, health-checking each
+///          server through grpc.health.v1.
+class ChannelRegistry final {
+ public:
+  enum class AddressFamily { kAny, kIPv4, kIPv6 };
+
+  struct Options {
+    /// host or host:port; the first one is the authority and TLS name.
+    std::vector<std::string> hosts;
+    uint32_t port = 0;
+    AddressFamily family = AddressFamily::kAny;
+    bool use_tls = true;
+    /// PEM root certificates, required with TLS.
+    std::string ca_cert;
+    /// "pick_first", "round_robin" or "least_request", which gRPC C++
+    /// lacks and is served by round_robin.
+    std::string lb_policy = "pick_first";
+    /// "none", "deflate" or "gzip".
+    std::string compression = "none";
+    uint32_t keepalive_ms = 60000;
+  };
+
+  static std::shared_ptr<ChannelRegistry> Instance();
+
+  /// @brief Options for the servers in the ConfigManager configuration.
+  /// @return Nothing if TLS is used and the CA bundle cannot be loaded.
+  static std::optional<Options> ServerOptions(AddressFamily family);
+
+  /// @brief gRPC target URI for options, e.g. "dns:///host:443" or
+  ///        "ipv4:192.0.2.1:443,192.0.2.2:443".
+  /// @return Empty if no host resolves to an address of the family.
+  static std::string Target(const Options& options);
+
+  /// @brief Returns the shared channel for options, creating it on first
+  ///        use. A channel to resolved addresses that is failing is
+  ///        replaced, which resolves the hosts again.
+  /// @return nullptr if Target() is empty.
+  std::shared_ptr<grpc::Channel> GetChannel(const Options& options);
+
+  /// @brief Waits until channel is connected.
+  /// @return False if it did not connect within timeout.
+  static bool WarmUp(const std::shared_ptr<grpc::Channel>& channel,
+                     std::chrono::milliseconds timeout);
+
+  /// @brief Forgets all channels, e.g. after the CA bundle changed. Their
+  ///        users keep them until they let go.
+  void Clear();
+
+  size_t size() const;
+
+ private:
+  ChannelRegistry() = default;
+
+  static std::string Key(const Options& options);
+
+  mutable std::mutex mutex_;
+  std::map<std::string, std::shared_ptr<grpc::Channel>> channels_;
+};
+
+}  // namespace client
+}  // namespace tbox
+
+#endif  // TBOX_CLIENT_CHANNEL_REGISTRY_H_
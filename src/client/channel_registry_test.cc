@@ -0,0 +1,132 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/client/channel_registry.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "grpcpp/health_check_service_interface.h"
+#include "grpcpp/server.h"
+#include "grpcpp/server_builder.h"
+#include "gtest/gtest.h"
+#include "src/proto/service.grpc.pb.h"
+
+namespace tbox {
+namespace client {
+namespace {
+
+class CountingService : public tbox::proto::TBOXService::Service {
+ public:
+  grpc::Status ReportOp(grpc::ServerContext* /*context*/,
+                        const tbox::proto::ReportRequest* /*request*/,
+                        tbox::proto::ReportResponse* /*response*/) override {
+    ++calls;
+    return grpc::Status::OK;
+  }
+
+  std::atomic<int> calls{0};
+};
+
+struct TestServer {
+  TestServer() {
+    grpc::EnableDefaultHealthCheckService(true);
+    grpc::ServerBuilder builder;
+    builder.RegisterService(&service);
+    builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(),
+                             &port);
+    server = builder.BuildAndStart();
+  }
+  ~TestServer() { server->Shutdown(); }
+
+  CountingService service;
+  std::unique_ptr<grpc::Server> server;
+  int port = 0;
+};
+
+ChannelRegistry::Options PlainOptions(std::vector<std::string> hosts,
+                                      uint32_t port) {
+  ChannelRegistry::Options options;
+  options.hosts = std::move(hosts);
+  options.port = port;
+  options.use_tls = false;
+  return options;
+}
+
+TEST(ChannelRegistryTest, Target) {
+  auto options = PlainOptions({"127.0.0.1"}, 443);
+  EXPECT_EQ(ChannelRegistry::Target(options), "dns:///127.0.0.1:443");
+
+  options.family = ChannelRegistry::AddressFamily::kIPv4;
+  options.hosts.push_back("127.0.0.1:8443");
+  EXPECT_EQ(ChannelRegistry::Target(options),
+            "ipv4:127.0.0.1:443,127.0.0.1:8443");
+
+  options = PlainOptions({"::1", "[::1]:8443"}, 443);
+  options.family = ChannelRegistry::AddressFamily::kIPv6;
+  EXPECT_EQ(ChannelRegistry::Target(options), "ipv6:[::1]:443,[::1]:8443");
+
+  options = PlainOptions({"no-such-host.invalid"}, 443);
+  options.family = ChannelRegistry::AddressFamily::kIPv4;
+  EXPECT_EQ(ChannelRegistry::Target(options), "");
+  EXPECT_EQ(ChannelRegistry::Instance()->GetChannel(options), nullptr);
+}
+
+TEST(ChannelRegistryTest, SharesChannelsPerKey) {
+  auto registry = ChannelRegistry::Instance();
+  registry->Clear();
+  const auto options = PlainOptions({"127.0.0.1"}, 50051);
+  auto channel = registry->GetChannel(options);
+  ASSERT_NE(channel, nullptr);
+  EXPECT_EQ(registry->GetChannel(options), channel);
+
+  auto ipv4 = options;
+  ipv4.family = ChannelRegistry::AddressFamily::kIPv4;
+  EXPECT_NE(registry->GetChannel(ipv4), channel);
+
+  auto tls = options;
+  tls.use_tls = true;
+  tls.ca_cert = "-----BEGIN CERTIFICATE-----";
+  EXPECT_NE(registry->GetChannel(tls), channel);
+  EXPECT_EQ(registry->size(), 3u);
+
+  registry->Clear();
+  EXPECT_EQ(registry->size(), 0u);
+  EXPECT_NE(registry->GetChannel(options), channel);
+}
+
+TEST(ChannelRegistryTest, RoundRobinOverHealthyServers) {
+  TestServer first;
+  TestServer second;
+  auto options = PlainOptions({"127.0.0.1:" + std::to_string(first.port),
+                               "127.0.0.1:" + std::to_string(second.port)},
+                              0);
+  options.family = ChannelRegistry::AddressFamily::kIPv4;
+  options.lb_policy = "round_robin";
+  auto channel = ChannelRegistry::Instance()->GetChannel(options);
+  ASSERT_NE(channel, nullptr);
+  ASSERT_TRUE(ChannelRegistry::WarmUp(channel, std::chrono::seconds(10)));
+
+  auto stub = tbox::proto::TBOXService::NewStub(channel);
+  for (int i = 0; i < 20; ++i) {
+    grpc::ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() +
+                         std::chrono::seconds(5));
+    context.set_wait_for_ready(true);
+    tbox::proto::ReportRequest request;
+    tbox::proto::ReportResponse response;
+    ASSERT_TRUE(stub->ReportOp(&context, request, &response).ok());
+  }
+  EXPECT_GT(first.service.calls.load(), 0);
+  EXPECT_GT(second.service.calls.load(), 0);
+  EXPECT_EQ(first.service.calls.load() + second.service.calls.load(), 20);
+}
+
+}  // namespace
+}  // namespace client
+}  // namespace tbox
@@ -126,7 +126,7 @@ int main(int argc, char** argv) {
     return 1;
   }
   tbox::logging::Initialize(argv[0], selected_log_dir,
-                            config_manager->WriteLogs());
+                            config_manager->LoggingOptions());
 
   LOG(INFO) << "Client initializing ...";
   LOG(INFO) << "CommandLine: " << tbox::logging::CommandLine(argc, argv);
@@ -9,14 +9,14 @@
 #include <exception>
 #include <vector>
 
-#include "src/common/logging.h"
 #include "src/client/authentication_manager.h"
+#include "src/client/channel_registry.h"
 #include "src/client/platform_ca_bundle.h"
 #include "src/client/report_manager.h"
 #include "src/client/ssl_config_manager.h"
+#include "src/common/logging.h"
 #include "src/impl/config_manager.h"
 #include "src/proto/service.grpc.pb.h"
-#include "src/util/util.h"
 
 namespace tbox {
 namespace client {
@@ -60,45 +60,22 @@ GrpcClient::~GrpcClient() {
 
 bool GrpcClient::Init() {
   auto config_manager = util::ConfigManager::Instance();
-  std::shared_ptr<grpc::ChannelCredentials> channel_creds;
-  grpc::ChannelArguments args;
 
   // Parse hostname and determine protocol
   std::string server_addr = config_manager->ServerAddr();
   auto [hostname, use_http] = ParseHostname(server_addr);
 
-  if (use_http) {
-    // Use insecure channel for HTTP
-    channel_creds = grpc::InsecureChannelCredentials();
-    LOG(INFO) << "Using insecure gRPC channel (HTTP/2)";
-  } else {
-    // Load SSL certificate using configuration path
-    // Get certificate path from configuration
-    std::string ca_cert_path = config_manager->LocalCertPath();
-    if (ca_cert_path.empty()) {
-      ca_cert_path = "conf/ca-bundle.pem";  // Default fallback
-    }
-
-    std::string ca_cert = SSLConfigManager::LoadCACert(ca_cert_path);
-    if (ca_cert.empty()) {
-      LOG(ERROR) << "Failed to load CA certificate from: " << ca_cert_path;
-      return false;
-    }
-
-    // Configure SSL
-    grpc::SslCredentialsOptions ssl_opts;
-    ssl_opts.pem_root_certs = ca_cert;
-    channel_creds = grpc::SslCredentials(ssl_opts);
-
-    // Configure SSL-specific arguments - removed override to use native
-    // certificate validation std::string ssl_target_name = "xiedeacc.com";
-    // args.SetSslTargetNameOverride(ssl_target_name);
-    // args.SetString(GRPC_SSL_TARGET_NAME_OVERRIDE_ARG, ssl_target_name);
-    LOG(INFO) << "Using secure gRPC channel (HTTPS)";
+  auto options =
+      ChannelRegistry::ServerOptions(ChannelRegistry::AddressFamily::kAny);
+  if (!options.has_value()) {
+    return false;
   }
+  LOG(INFO) << (use_http ? "Using insecure gRPC channel (HTTP/2)"
+                         : "Using secure gRPC channel (HTTPS)");
 
-  // Create channel
-  channel_ = grpc::CreateCustomChannel(target_address_, channel_creds, args);
+  // Shared with the other client components; a CA bundle change creates a
+  // new one.
+  channel_ = ChannelRegistry::Instance()->GetChannel(options.value());
   if (!channel_) {
     LOG(ERROR) << "Failed to create gRPC channel to " << target_address_;
     return false;
@@ -112,12 +89,9 @@ bool GrpcClient::Init() {
 
   // Wait for connection
   int connection_timeout_seconds = 10;
-  int64_t current_millis = util::Util::CurrentTimeMillis();
-  auto deadline =
-      std::chrono::system_clock::time_point(std::chrono::milliseconds(
-          current_millis + (connection_timeout_seconds * 1000)));
   uint32_t grpc_port = config_manager->GrpcServerPort();
-  if (channel_->WaitForConnected(deadline)) {
+  if (ChannelRegistry::WarmUp(
+          channel_, std::chrono::seconds(connection_timeout_seconds))) {
     LOG(INFO) << "Connected to " << server_addr << ":" << grpc_port
               << " successfully";
   } else {
@@ -252,6 +226,7 @@ bool GrpcClient::ReloadTLSChannel() {
 
   StopManagers();
   AuthenticationManager::Instance()->ClearToken();
+  ChannelRegistry::Instance()->Clear();
   if (!Init()) {
     return false;
   }
@@ -11,11 +11,10 @@
 #include <vector>
 
 #include "src/common/logging.h"
-#include "src/common/socket_compat.h"
 #include "src/async_grpc/client.h"
 #include "src/async_grpc/common/time.h"
 #include "src/client/authentication_manager.h"
-#include "src/client/ssl_config_manager.h"
+#include "src/client/channel_registry.h"
 #include "src/impl/config_manager.h"
 #include "src/server/grpc_handler/meta.h"
 #include "src/util/util.h"
@@ -571,145 +570,34 @@ bool ReportManager::Reconnect() {
 
 std::shared_ptr<tbox::proto::TBOXService::Stub>
 ReportManager::CreateIPv4Stub() {
-  auto config_manager = util::ConfigManager::Instance();
-  std::string server_addr = config_manager->ServerAddr();
-  uint32_t grpc_port = config_manager->GrpcServerPort();
-
-  // Parse hostname
-  std::string hostname = server_addr;
-  bool use_http = false;
-  if (hostname.find("http://") == 0) {
-    hostname = hostname.substr(7);
-    use_http = true;
-  } else if (hostname.find("https://") == 0) {
-    hostname = hostname.substr(8);
-    use_http = false;
-  }
-
-  // Resolve hostname to IPv4 address
-  struct addrinfo hints, *res = nullptr;
-  memset(&hints, 0, sizeof(hints));
-  hints.ai_family = AF_INET;  // Force IPv4
-  hints.ai_socktype = SOCK_STREAM;
-
-  int status = getaddrinfo(hostname.c_str(), nullptr, &hints, &res);
-  if (status != 0 || res == nullptr) {
-    LOG(WARNING) << "Failed to resolve " << hostname
-                 << " to IPv4: " << gai_strerror(status);
+  auto options =
+      ChannelRegistry::ServerOptions(ChannelRegistry::AddressFamily::kIPv4);
+  if (!options.has_value()) {
+    LOG(WARNING) << "Failed to load CA cert for IPv4 stub";
     return nullptr;
   }
-
-  // Get IPv4 address
-  char ipv4_str[INET_ADDRSTRLEN];
-  struct sockaddr_in* ipv4 =
-      reinterpret_cast<struct sockaddr_in*>(res->ai_addr);
-  inet_ntop(AF_INET, &(ipv4->sin_addr), ipv4_str, INET_ADDRSTRLEN);
-  std::string ipv4_address = std::string(ipv4_str);
-  freeaddrinfo(res);
-
-  // Create channel to IPv4 address
-  std::string target = ipv4_address + ":" + std::to_string(grpc_port);
-  std::shared_ptr<grpc::ChannelCredentials> creds;
-  grpc::ChannelArguments args;
-
-  // Set authority to the original hostname for nginx routing
-  args.SetString(GRPC_ARG_DEFAULT_AUTHORITY, hostname);
-
-  if (use_http) {
-    creds = grpc::InsecureChannelCredentials();
-  } else {
-    auto ssl_config_manager = SSLConfigManager::Instance();
-    auto config_manager = util::ConfigManager::Instance();
-    std::string ca_cert =
-        ssl_config_manager->LoadCACert(config_manager->LocalCertPath());
-    if (ca_cert.empty()) {
-      LOG(WARNING) << "Failed to load CA cert for IPv4 stub";
-      return nullptr;
-    }
-    grpc::SslCredentialsOptions ssl_opts;
-    ssl_opts.pem_root_certs = ca_cert;
-    creds = grpc::SslCredentials(ssl_opts);
-    args.SetSslTargetNameOverride(hostname);
-  }
-
-  auto channel = grpc::CreateCustomChannel(target, creds, args);
+  auto channel = ChannelRegistry::Instance()->GetChannel(options.value());
   if (!channel) {
-    LOG(WARNING) << "Failed to create IPv4 channel to " << target;
+    LOG(WARNING) << "Failed to resolve " << options->hosts.front()
+                 << " to IPv4";
     return nullptr;
   }
-
   return tbox::proto::TBOXService::NewStub(channel);
 }
 
 std::shared_ptr<tbox::proto::TBOXService::Stub>
 ReportManager::CreateIPv6Stub() {
-  auto config_manager = util::ConfigManager::Instance();
-  std::string server_addr = config_manager->ServerAddr();
-  uint32_t grpc_port = config_manager->GrpcServerPort();
-
-  // Parse hostname
-  std::string hostname = server_addr;
-  bool use_http = false;
-  if (hostname.find("http://") == 0) {
-    hostname = hostname.substr(7);
-    use_http = true;
-  } else if (hostname.find("https://") == 0) {
-    hostname = hostname.substr(8);
-    use_http = false;
-  }
-
-  // Resolve hostname to IPv6 address
-  struct addrinfo hints, *res = nullptr;
-  memset(&hints, 0, sizeof(hints));
-  hints.ai_family = AF_INET6;  // Force IPv6
-  hints.ai_socktype = SOCK_STREAM;
-
-  int status = getaddrinfo(hostname.c_str(), nullptr, &hints, &res);
-  if (status != 0 || res == nullptr) {
-    LOG(INFO) << "No IPv6 address available for " << hostname << ": "
-              << gai_strerror(status);
+  auto options =
+      ChannelRegistry::ServerOptions(ChannelRegistry::AddressFamily::kIPv6);
+  if (!options.has_value()) {
+    LOG(WARNING) << "Failed to load CA cert for IPv6 stub";
     return nullptr;
   }
-
-  // Get IPv6 address
-  char ipv6_str[INET6_ADDRSTRLEN];
-  struct sockaddr_in6* ipv6 =
-      reinterpret_cast<struct sockaddr_in6*>(res->ai_addr);
-  inet_ntop(AF_INET6, &(ipv6->sin6_addr), ipv6_str, INET6_ADDRSTRLEN);
-  std::string ipv6_address = std::string(ipv6_str);
-  freeaddrinfo(res);
-
-  // Create channel to IPv6 address (wrap in brackets for URL)
-  std::string target = "[" + ipv6_address + "]:" + std::to_string(grpc_port);
-  std::shared_ptr<grpc::ChannelCredentials> creds;
-  grpc::ChannelArguments args;
-
-  // Set authority to the original hostname for nginx routing
-  args.SetString(GRPC_ARG_DEFAULT_AUTHORITY, hostname);
-
-  if (use_http) {
-    creds = grpc::InsecureChannelCredentials();
-  } else {
-    auto ssl_config_manager = SSLConfigManager::Instance();
-    auto config_manager = util::ConfigManager::Instance();
-    std::string ca_cert =
-        ssl_config_manager->LoadCACert(config_manager->LocalCertPath());
-    if (ca_cert.empty()) {
-      LOG(WARNING) << "Failed to load CA cert for IPv6 stub";
-      return nullptr;
-    }
-    grpc::SslCredentialsOptions ssl_opts;
-    ssl_opts.pem_root_certs = ca_cert;
-    creds = grpc::SslCredentials(ssl_opts);
-    args.SetSslTargetNameOverride(hostname);
-  }
-
-  auto channel = grpc::CreateCustomChannel(target, creds, args);
+  auto channel = ChannelRegistry::Instance()->GetChannel(options.value());
   if (!channel) {
-    LOG(WARNING) << "Failed to create IPv6 channel to " << target;
+    LOG(INFO) << "No IPv6 address available for " << options->hosts.front();
     return nullptr;
   }
-
   return tbox::proto::TBOXService::NewStub(channel);
 }
 
@@ -756,6 +644,9 @@ std::string ReportManager::GetPublicIPv4() {
           status.error_message().find("token") != std::string::npos) {
         LOG(WARNING) << "Authentication failed while getting public IPv4";
         auth_manager->ClearToken();
+      } else if (status.error_code() == grpc::StatusCode::UNAVAILABLE) {
+        // Fetch it again, replacing the channel if it keeps failing.
+        ipv4_stub_.reset();
       }
     }
   } catch (const std::exception& e) {
@@ -808,6 +699,9 @@ std::string ReportManager::GetPublicIPv6() {
           status.error_message().find("token") != std::string::npos) {
         LOG(WARNING) << "Authentication failed while getting public IPv6";
         auth_manager->ClearToken();
+      } else if (status.error_code() == grpc::StatusCode::UNAVAILABLE) {
+        // Fetch it again, replacing the channel if it keeps failing.
+        ipv6_stub_.reset();
       }
     }
   } catch (const std::exception& e) {
@@ -86,11 +86,13 @@ class ReportManager final {
   /// @return Public IPv6 address, or empty string on failure.
   std::string GetPublicIPv6();
 
-  /// @brief Create a gRPC stub that forces IPv4 connection.
+  /// @brief Create a gRPC stub that forces IPv4 connection, on the
+  ///        registry's shared IPv4 channel.
   /// @return Stub connected via IPv4, or nullptr on failure.
   std::shared_ptr<tbox::proto::TBOXService::Stub> CreateIPv4Stub();
 
-  /// @brief Create a gRPC stub that forces IPv6 connection.
+  /// @brief Create a gRPC stub that forces IPv6 connection, on the
+  ///        registry's shared IPv6 channel.
   /// @return Stub connected via IPv6, or nullptr on failure.
   std::shared_ptr<tbox::proto::TBOXService::Stub> CreateIPv6Stub();
 
@@ -26,6 +26,7 @@
 #include "src/async_grpc/common/time.h"
 #include "src/client/authentication_manager.h"
 #include "src/impl/config_manager.h"
+#include "src/impl/sync/delta_sync.h"
 #include "src/server/grpc_handler/meta.h"
 #include "src/util/util.h"
 
@@ -1028,29 +1029,69 @@ std::string SSLConfigManager::GetRemoteCertificateFileHash(
   return client.response().message();
 }
 
-bool SSLConfigManager::FetchAndStoreCertificateFile(
-    const std::string& filename, const std::string& path) {
-  auto auth_manager = client::AuthenticationManager::Instance();
-  if (!channel_ || !auth_manager || !auth_manager->IsAuthenticated()) {
+bool SSLConfigManager::FetchCertificateFileDelta(const std::string& filename,
+                                                 const std::string& path,
+                                                 std::string* content) {
+  // Without a local copy there is nothing to reuse, fetch the whole file.
+  const std::string basis = ReadFileContent(path);
+  if (basis.empty()) {
     return false;
   }
 
   async_grpc::Client<server::grpc_handler::CertOpMethod> client(channel_);
   tbox::proto::CertRequest request;
   request.set_request_id(util::Util::UUID());
-  request.set_op(tbox::proto::OpCode::OP_GET_CERT_FILE);
-  request.set_token(auth_manager->GetToken());
+  request.set_op(tbox::proto::OpCode::OP_GET_CERT_FILE_DELTA);
+  request.set_token(AuthenticationManager::Instance()->GetToken());
   request.set_client_id(util::ConfigManager::Instance()->ClientId());
   request.set_filename(filename);
+  impl::sync::DeltaSync::ComputeSignature(basis, 0,
+                                          request.mutable_signature());
 
   grpc::Status status;
   if (!client.Write(request, &status) || !status.ok() ||
-      client.response().err_code() != tbox::proto::ErrCode::Success ||
-      client.response().file_content().empty()) {
+      client.response().err_code() != tbox::proto::ErrCode::Success) {
+    // Servers without delta support answer Fail or Unsupported_op.
+    return false;
+  }
+  if (!impl::sync::DeltaSync::ApplyDelta(basis, client.response().delta(),
+                                         content)) {
     return false;
   }
+  LOG(INFO) << "Fetched " << filename << " by delta, literal bytes "
+            << impl::sync::DeltaSync::LiteralBytes(client.response().delta())
+            << " of " << content->size();
+  return true;
+}
+
+bool SSLConfigManager::FetchAndStoreCertificateFile(
+    const std::string& filename, const std::string& path) {
+  auto auth_manager = client::AuthenticationManager::Instance();
+  if (!channel_ || !auth_manager || !auth_manager->IsAuthenticated()) {
+    return false;
+  }
+
+  std::string content;
+  if (!FetchCertificateFileDelta(filename, path, &content) ||
+      content.empty()) {
+    async_grpc::Client<server::grpc_handler::CertOpMethod> client(channel_);
+    tbox::proto::CertRequest request;
+    request.set_request_id(util::Util::UUID());
+    request.set_op(tbox::proto::OpCode::OP_GET_CERT_FILE);
+    request.set_token(auth_manager->GetToken());
+    request.set_client_id(util::ConfigManager::Instance()->ClientId());
+    request.set_filename(filename);
+
+    grpc::Status status;
+    if (!client.Write(request, &status) || !status.ok() ||
+        client.response().err_code() != tbox::proto::ErrCode::Success ||
+        client.response().file_content().empty()) {
+      return false;
+    }
+    content = client.response().file_content();
+  }
 
-  if (!WriteFileContent(path, client.response().file_content())) {
+  if (!WriteFileContent(path, content)) {
     return false;
   }
   SetFilePermissions(path, filename.ends_with(".key") ? 0600 : 0644);
@@ -149,6 +149,10 @@ class SSLConfigManager {
   std::string GetRemoteCertificateFileHash(const std::string& filename);
   bool FetchAndStoreCertificateFile(const std::string& filename,
                                     const std::string& path);
+  // Rebuild filename from the local copy at path plus the differing blocks
+  // sent by the server. Returns false if a full fetch is needed instead.
+  bool FetchCertificateFileDelta(const std::string& filename,
+                                 const std::string& path, std::string* content);
 
   std::atomic<bool> running_;
   std::unique_ptr<std::thread> monitor_thread_;
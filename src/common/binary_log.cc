@@ -0,0 +1,298 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/common/binary_log.h"
+
+#include <cinttypes>
+#include <filesystem>
+#include <system_error>
+
+namespace tbox {
+namespace logging {
+namespace {
+
+bool GetVarint(std::string_view* data, uint64_t* value) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64 && !data->empty(); shift += 7) {
+    const uint8_t byte = static_cast<uint8_t>(data->front());
+    data->remove_prefix(1);
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool GetBytes(std::string_view* data, std::string_view* value) {
+  uint64_t size = 0;
+  if (!GetVarint(data, &size) || size > data->size()) {
+    return false;
+  }
+  *value = data->substr(0, size);
+  data->remove_prefix(size);
+  return true;
+}
+
+// "name.BIN.log" -> "name.BIN.<index>.log", as spdlog names rotated files.
+std::string RotatedName(const std::string& path, size_t index) {
+  if (index == 0) {
+    return path;
+  }
+  const std::filesystem::path p(path);
+  return (p.parent_path() / (p.stem().string() + "." + std::to_string(index) +
+                             p.extension().string()))
+      .string();
+}
+
+}  // namespace
+
+bool DecodeArgs(std::string_view encoded, std::vector<BinaryArg>* args) {
+  args->clear();
+  while (!encoded.empty()) {
+    BinaryArg arg;
+    arg.type = static_cast<ArgType>(encoded.front());
+    encoded.remove_prefix(1);
+    uint64_t value = 0;
+    switch (arg.type) {
+      case ArgType::kBool:
+        if (encoded.empty()) {
+          return false;
+        }
+        arg.b = encoded.front() != 0;
+        encoded.remove_prefix(1);
+        break;
+      case ArgType::kInt:
+        if (!GetVarint(&encoded, &value)) {
+          return false;
+        }
+        arg.i = static_cast<int64_t>(value >> 1) ^
+                -static_cast<int64_t>(value & 1);
+        break;
+      case ArgType::kUint:
+        if (!GetVarint(&encoded, &arg.u)) {
+          return false;
+        }
+        break;
+      case ArgType::kDouble:
+        if (encoded.size() < sizeof(arg.d)) {
+          return false;
+        }
+        std::memcpy(&arg.d, encoded.data(), sizeof(arg.d));
+        encoded.remove_prefix(sizeof(arg.d));
+        break;
+      case ArgType::kString:
+        if (!GetBytes(&encoded, &arg.s)) {
+          return false;
+        }
+        break;
+      default:
+        return false;
+    }
+    args->push_back(arg);
+  }
+  return true;
+}
+
+void AppendArg(const BinaryArg& arg, std::string* out) {
+  char buffer[32];
+  int n = 0;
+  switch (arg.type) {
+    case ArgType::kBool:
+      // std::ostream prints bools as digits.
+      out->push_back(arg.b ? '1' : '0');
+      return;
+    case ArgType::kInt:
+      n = std::snprintf(buffer, sizeof(buffer), "%" PRId64, arg.i);
+      break;
+    case ArgType::kUint:
+      n = std::snprintf(buffer, sizeof(buffer), "%" PRIu64, arg.u);
+      break;
+    case ArgType::kDouble:
+      // The default std::ostream precision.
+      n = std::snprintf(buffer, sizeof(buffer), "%g", arg.d);
+      break;
+    case ArgType::kString:
+      out->append(arg.s);
+      return;
+  }
+  out->append(buffer, n > 0 ? static_cast<size_t>(n) : 0);
+}
+
+bool FormatArgs(std::string_view format, std::string_view encoded,
+                std::string* out) {
+  std::vector<BinaryArg> args;
+  if (!DecodeArgs(encoded, &args)) {
+    return false;
+  }
+  size_t next = 0;
+  for (size_t i = 0; i < format.size(); ++i) {
+    const char c = format[i];
+    if ((c == '{' || c == '}') && i + 1 < format.size() &&
+        format[i + 1] == c) {
+      out->push_back(c);
+      ++i;
+    } else if (c == '{' && i + 1 < format.size() && format[i + 1] == '}' &&
+               next < args.size()) {
+      AppendArg(args[next++], out);
+      ++i;
+    } else {
+      out->push_back(c);
+    }
+  }
+  for (; next < args.size(); ++next) {
+    out->push_back(' ');
+    AppendArg(args[next], out);
+  }
+  return true;
+}
+
+std::unique_ptr<BinaryLogWriter> BinaryLogWriter::Open(const std::string& path,
+                                                       size_t max_size,
+                                                       size_t max_files) {
+  std::unique_ptr<BinaryLogWriter> writer(
+      new BinaryLogWriter(path, max_size, max_files));
+  std::lock_guard<std::mutex> lock(writer->mutex_);
+  if (!writer->OpenLocked()) {
+    return nullptr;
+  }
+  return writer;
+}
+
+BinaryLogWriter::~BinaryLogWriter() {
+  if (file_) {
+    std::fclose(file_);
+  }
+}
+
+bool BinaryLogWriter::OpenLocked() {
+  file_ = std::fopen(path_.c_str(), "ab");
+  if (!file_) {
+    return false;
+  }
+  std::setvbuf(file_, nullptr, _IOFBF, 64 * 1024);
+  std::error_code error;
+  size_ = std::filesystem::file_size(path_, error);
+  if (error) {
+    size_ = 0;
+  }
+  if (size_ == 0) {
+    std::fwrite(kBinaryLogMagic.data(), 1, kBinaryLogMagic.size(), file_);
+    size_ = kBinaryLogMagic.size();
+  }
+  // An appended-to file may have been written by an earlier process whose
+  // site ids differ.
+  defined_.clear();
+  return true;
+}
+
+void BinaryLogWriter::RotateLocked() {
+  std::fclose(file_);
+  file_ = nullptr;
+  std::error_code error;
+  for (size_t i = max_files_; i > 0; --i) {
+    const std::string from = RotatedName(path_, i - 1);
+    if (std::filesystem::exists(from, error)) {
+      std::filesystem::rename(from, RotatedName(path_, i), error);
+    }
+  }
+  OpenLocked();
+}
+
+void BinaryLogWriter::AppendLocked(const std::string& bytes) {
+  if (file_) {
+    std::fwrite(bytes.data(), 1, bytes.size(), file_);
+    size_ += bytes.size();
+  }
+}
+
+void BinaryLogWriter::Write(const LogSite& site, int64_t unix_time_ns,
+                            uint64_t thread_id, std::string_view args) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (file_ && size_ >= max_size_ && max_files_ > 0) {
+    RotateLocked();
+  }
+  scratch_.clear();
+  if (site.id >= defined_.size()) {
+    defined_.resize(site.id + 1);
+  }
+  if (!defined_[site.id]) {
+    defined_[site.id] = true;
+    scratch_.push_back('S');
+    internal::PutVarint(&scratch_, site.id);
+    internal::PutVarint(&scratch_, static_cast<uint64_t>(site.severity));
+    internal::PutVarint(&scratch_, static_cast<uint64_t>(site.line));
+    const std::string_view file(site.file);
+    internal::PutVarint(&scratch_, file.size());
+    scratch_.append(file);
+    const std::string_view format(site.format);
+    internal::PutVarint(&scratch_, format.size());
+    scratch_.append(format);
+  }
+  scratch_.push_back('R');
+  internal::PutVarint(&scratch_, site.id);
+  internal::PutVarint(&scratch_, static_cast<uint64_t>(unix_time_ns));
+  internal::PutVarint(&scratch_, thread_id);
+  internal::PutVarint(&scratch_, args.size());
+  scratch_.append(args);
+  AppendLocked(scratch_);
+}
+
+void BinaryLogWriter::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (file_) {
+    std::fflush(file_);
+  }
+}
+
+bool BinaryLogReader::ReadHeader() {
+  if (!data_.starts_with(kBinaryLogMagic)) {
+    return false;
+  }
+  data_.remove_prefix(kBinaryLogMagic.size());
+  return true;
+}
+
+BinaryLogReader::Entry BinaryLogReader::Next(Site* site, Record* record) {
+  if (data_.empty()) {
+    return Entry::kEnd;
+  }
+  const char kind = data_.front();
+  data_.remove_prefix(1);
+  uint64_t id = 0;
+  if (!GetVarint(&data_, &id)) {
+    return Entry::kCorrupt;
+  }
+  if (kind == 'S') {
+    uint64_t severity = 0;
+    uint64_t line = 0;
+    if (!GetVarint(&data_, &severity) ||
+        severity > static_cast<uint64_t>(Severity::kFatal) ||
+        !GetVarint(&data_, &line) || !GetBytes(&data_, &site->file) ||
+        !GetBytes(&data_, &site->format)) {
+      return Entry::kCorrupt;
+    }
+    site->id = static_cast<uint32_t>(id);
+    site->severity = static_cast<Severity>(severity);
+    site->line = static_cast<int>(line);
+    return Entry::kSite;
+  }
+  if (kind == 'R') {
+    uint64_t time = 0;
+    if (!GetVarint(&data_, &time) ||
+        !GetVarint(&data_, &record->thread_id) ||
+        !GetBytes(&data_, &record->args)) {
+      return Entry::kCorrupt;
+    }
+    record->site_id = static_cast<uint32_t>(id);
+    record->unix_time_ns = static_cast<int64_t>(time);
+    return Entry::kRecord;
+  }
+  return Entry::kCorrupt;
+}
+
+}  // namespace logging
+}  // namespace tbox
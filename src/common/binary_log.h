@@ -0,0 +1,271 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_COMMON_BINARY_LOG_H_
+#define TBOX_COMMON_BINARY_LOG_H_
+
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "src/common/logging.h"
+
+namespace tbox {
+namespace logging {
+
+/// @brief Layout of <program>.BIN.log, all integers LEB128 varints:
+///          file   := "TBOXBLG1" entry*
+///          entry  := 'S' id severity line str(file) str(format)
+///                  | 'R' id unix_time_ns thread_id str(args)
+///          args   := (type value)*
+///          str    := length bytes
+///        A site is written once per file, before its first record, so each
+///        rotated file decodes on its own.
+constexpr std::string_view kBinaryLogMagic = "TBOXBLG1";
+
+enum class ArgType : uint8_t {
+  kBool = 1,
+  kInt = 2,     // zigzag varint
+  kUint = 3,    // varint
+  kDouble = 4,  // 8 bytes little endian
+  kString = 5,  // varint length, bytes
+};
+
+/// @brief Static description of one BLOG statement: everything but the
+///        argument values, so records only carry the site id.
+class LogSite final {
+ public:
+  LogSite(const char* file, int line, Severity severity, const char* format)
+      : file(file),
+        line(line),
+        severity(severity),
+        format(format),
+        id(next_id_.fetch_add(1, std::memory_order_relaxed) + 1) {}
+  LogSite(const LogSite&) = delete;
+  LogSite& operator=(const LogSite&) = delete;
+
+  const char* const file;
+  const int line;
+  const Severity severity;
+  const char* const format;
+  const uint32_t id;
+
+ private:
+  static inline std::atomic<uint32_t> next_id_{0};
+};
+
+namespace internal {
+
+inline void PutVarint(std::string* out, uint64_t value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+inline void PutString(std::string* out, std::string_view value) {
+  out->push_back(static_cast<char>(ArgType::kString));
+  PutVarint(out, value.size());
+  out->append(value);
+}
+
+inline void PutInt(std::string* out, int64_t value) {
+  out->push_back(static_cast<char>(ArgType::kInt));
+  PutVarint(out, (static_cast<uint64_t>(value) << 1) ^
+                     static_cast<uint64_t>(value >> 63));
+}
+
+inline void PutUint(std::string* out, uint64_t value) {
+  out->push_back(static_cast<char>(ArgType::kUint));
+  PutVarint(out, value);
+}
+
+inline void EncodeArg(std::string* out, bool value) {
+  out->push_back(static_cast<char>(ArgType::kBool));
+  out->push_back(value ? 1 : 0);
+}
+
+inline void EncodeArg(std::string* out, char value) {
+  PutString(out, std::string_view(&value, 1));
+}
+
+template <std::signed_integral T>
+void EncodeArg(std::string* out, T value) {
+  PutInt(out, value);
+}
+
+template <std::unsigned_integral T>
+void EncodeArg(std::string* out, T value) {
+  PutUint(out, value);
+}
+
+template <std::floating_point T>
+void EncodeArg(std::string* out, T value) {
+  const double d = static_cast<double>(value);
+  char bytes[sizeof(d)];
+  std::memcpy(bytes, &d, sizeof(d));
+  out->push_back(static_cast<char>(ArgType::kDouble));
+  out->append(bytes, sizeof(bytes));
+}
+
+template <typename T>
+  requires std::is_enum_v<T>
+void EncodeArg(std::string* out, T value) {
+  EncodeArg(out, static_cast<std::underlying_type_t<T>>(value));
+}
+
+inline void EncodeArg(std::string* out, const char* value) {
+  PutString(out, value ? std::string_view(value) : std::string_view("(null)"));
+}
+
+inline void EncodeArg(std::string* out, std::string_view value) {
+  PutString(out, value);
+}
+
+inline void EncodeArg(std::string* out, const std::string& value) {
+  PutString(out, value);
+}
+
+// Anything else that LOG() could print is stored as its text.
+template <typename T>
+  requires(!std::is_arithmetic_v<T> && !std::is_enum_v<T>)
+void EncodeArg(std::string* out, const T& value) {
+  std::ostringstream stream;
+  stream << value;
+  PutString(out, stream.view());
+}
+
+}  // namespace internal
+
+/// @brief Hands an encoded record to the active backend: the binary log when
+///        Options::binary is set, else formatted into the text logs.
+void WriteBinaryRecord(const LogSite& site, std::string&& args);
+
+template <typename... Args>
+void BinaryLog(const LogSite& site, const Args&... args) {
+  std::string encoded;
+  (internal::EncodeArg(&encoded, args), ...);
+  WriteBinaryRecord(site, std::move(encoded));
+}
+
+/// @brief One decoded argument; string points into the decoded buffer.
+struct BinaryArg {
+  ArgType type = ArgType::kInt;
+  bool b = false;
+  int64_t i = 0;
+  uint64_t u = 0;
+  double d = 0;
+  std::string_view s;
+};
+
+bool DecodeArgs(std::string_view encoded, std::vector<BinaryArg>* args);
+
+/// @brief Appends the argument as LOG() would have printed it.
+void AppendArg(const BinaryArg& arg, std::string* out);
+
+/// @brief Replaces each "{}" in format with the next argument ("{{" and "}}"
+///        are literal braces); surplus arguments are appended.
+bool FormatArgs(std::string_view format, std::string_view encoded,
+                std::string* out);
+
+/// @brief Appends sites and records to a size rotated binary log file,
+///        named like the text logs: name.BIN.log, name.BIN.1.log, ...
+/// @details Thread safe.
+class BinaryLogWriter final {
+ public:
+  static std::unique_ptr<BinaryLogWriter> Open(const std::string& path,
+                                               size_t max_size,
+                                               size_t max_files);
+  ~BinaryLogWriter();
+
+  BinaryLogWriter(const BinaryLogWriter&) = delete;
+  BinaryLogWriter& operator=(const BinaryLogWriter&) = delete;
+
+  void Write(const LogSite& site, int64_t unix_time_ns, uint64_t thread_id,
+             std::string_view args);
+  void Flush();
+
+ private:
+  BinaryLogWriter(std::string path, size_t max_size, size_t max_files)
+      : path_(std::move(path)), max_size_(max_size), max_files_(max_files) {}
+
+  // Caller holds mutex_.
+  bool OpenLocked();
+  void RotateLocked();
+  void AppendLocked(const std::string& bytes);
+
+  const std::string path_;
+  const size_t max_size_;
+  const size_t max_files_;
+
+  std::mutex mutex_;
+  std::FILE* file_ = nullptr;
+  size_t size_ = 0;
+  // Indexed by site id: whether the current file defines the site.
+  std::vector<bool> defined_;
+  std::string scratch_;
+};
+
+/// @brief Walks the entries of a binary log file held in memory.
+class BinaryLogReader final {
+ public:
+  struct Site {
+    uint32_t id = 0;
+    Severity severity = Severity::kInfo;
+    int line = 0;
+    std::string_view file;
+    std::string_view format;
+  };
+
+  struct Record {
+    uint32_t site_id = 0;
+    int64_t unix_time_ns = 0;
+    uint64_t thread_id = 0;
+    std::string_view args;
+  };
+
+  enum class Entry { kSite, kRecord, kEnd, kCorrupt };
+
+  explicit BinaryLogReader(std::string_view data) : data_(data) {}
+
+  /// @brief Whether data starts with the file magic; consumes it.
+  bool ReadHeader();
+
+  /// @brief Fills site or record depending on the returned entry kind.
+  Entry Next(Site* site, Record* record);
+
+ private:
+  std::string_view data_;
+};
+
+}  // namespace logging
+}  // namespace tbox
+
+#define BLOG(level, format, ...)                                       \
+  do {                                                                 \
+    if (TBOX_LOG_IS_ON_##level) {                                      \
+      static const ::tbox::logging::LogSite tbox_blog_site(            \
+          __FILE__, __LINE__, TBOX_BLOG_SEVERITY_##level, format);     \
+      ::tbox::logging::BinaryLog(tbox_blog_site __VA_OPT__(, )         \
+                                     __VA_ARGS__);                     \
+    }                                                                  \
+  } while (0)
+
+// BLOG(FATAL) is not supported: a crash report is never worth saving bytes.
+#define TBOX_BLOG_SEVERITY_INFO ::tbox::logging::Severity::kInfo
+#define TBOX_BLOG_SEVERITY_WARNING ::tbox::logging::Severity::kWarning
+#define TBOX_BLOG_SEVERITY_ERROR ::tbox::logging::Severity::kError
+
+#endif  // TBOX_COMMON_BINARY_LOG_H_
@@ -0,0 +1,239 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+// Turns binary logs written by BLOG() back into the text log format, or into
+// one JSON object per line with the raw arguments:
+//
+//   binary_log_decode [--json] server.BIN.2.log server.BIN.1.log server.BIN.log
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "src/common/binary_log.h"
+
+namespace tbox {
+namespace logging {
+namespace {
+
+struct Site {
+  Severity severity = Severity::kInfo;
+  int line = 0;
+  std::string file;
+  std::string format;
+};
+
+const char* SeverityName(Severity severity) {
+  switch (severity) {
+    case Severity::kInfo:
+      return "INFO";
+    case Severity::kWarning:
+      return "WARNING";
+    case Severity::kError:
+      return "ERROR";
+    case Severity::kFatal:
+      return "FATAL";
+  }
+  return "INFO";
+}
+
+// The level letters of the text logs (spdlog's %L).
+char SeverityLetter(Severity severity) {
+  switch (severity) {
+    case Severity::kInfo:
+      return 'I';
+    case Severity::kWarning:
+      return 'W';
+    case Severity::kError:
+      return 'E';
+    case Severity::kFatal:
+      return 'C';
+  }
+  return 'I';
+}
+
+// "%Y%m%d %H:%M:%S.%e" in local time, like the text logs.
+std::string FormatTime(int64_t unix_time_ns) {
+  const std::time_t seconds =
+      static_cast<std::time_t>(unix_time_ns / 1000000000);
+  std::tm tm{};
+  localtime_r(&seconds, &tm);
+  char buffer[32];
+  const size_t n =
+      std::strftime(buffer, sizeof(buffer), "%Y%m%d %H:%M:%S", &tm);
+  std::snprintf(buffer + n, sizeof(buffer) - n, ".%03d",
+                static_cast<int>(unix_time_ns / 1000000 % 1000));
+  return buffer;
+}
+
+std::string_view Basename(std::string_view path) {
+  const size_t slash = path.find_last_of("/\\");
+  return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+void AppendJsonString(std::string_view value, std::string* out) {
+  out->push_back('"');
+  for (const char c : value) {
+    switch (c) {
+      case '"':
+        out->append("\\\"");
+        break;
+      case '\\':
+        out->append("\\\\");
+        break;
+      case '\n':
+        out->append("\\n");
+        break;
+      case '\r':
+        out->append("\\r");
+        break;
+      case '\t':
+        out->append("\\t");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          out->append(escaped);
+        } else {
+          out->push_back(c);
+        }
+    }
+  }
+  out->push_back('"');
+}
+
+void AppendJsonArg(const BinaryArg& arg, std::string* out) {
+  switch (arg.type) {
+    case ArgType::kBool:
+      out->append(arg.b ? "true" : "false");
+      return;
+    case ArgType::kString:
+      AppendJsonString(arg.s, out);
+      return;
+    default:
+      AppendArg(arg, out);
+  }
+}
+
+bool DecodeFile(const char* path, bool json) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    std::fprintf(stderr, "%s: cannot open\n", path);
+    return false;
+  }
+  const std::string data((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+  BinaryLogReader reader(data);
+  if (!reader.ReadHeader()) {
+    std::fprintf(stderr, "%s: not a binary log\n", path);
+    return false;
+  }
+
+  std::unordered_map<uint32_t, Site> sites;
+  std::vector<BinaryArg> args;
+  std::string line;
+  BinaryLogReader::Site site;
+  BinaryLogReader::Record record;
+  while (true) {
+    const BinaryLogReader::Entry entry = reader.Next(&site, &record);
+    if (entry == BinaryLogReader::Entry::kEnd) {
+      return true;
+    }
+    if (entry == BinaryLogReader::Entry::kCorrupt) {
+      // A crash can leave a partial record at the end.
+      std::fprintf(stderr, "%s: truncated or corrupt entry\n", path);
+      return false;
+    }
+    if (entry == BinaryLogReader::Entry::kSite) {
+      sites[site.id] = Site{site.severity, site.line, std::string(site.file),
+                            std::string(site.format)};
+      continue;
+    }
+
+    auto it = sites.find(record.site_id);
+    if (it == sites.end()) {
+      std::fprintf(stderr, "%s: record of unknown site %" PRIu32 "\n", path,
+                   record.site_id);
+      continue;
+    }
+    const Site& s = it->second;
+    std::string message;
+    if (!FormatArgs(s.format, record.args, &message)) {
+      std::fprintf(stderr, "%s: bad arguments for site %" PRIu32 "\n", path,
+                   record.site_id);
+      continue;
+    }
+    line.clear();
+    if (json) {
+      DecodeArgs(record.args, &args);
+      line.append("{\"time\":");
+      AppendJsonString(FormatTime(record.unix_time_ns), &line);
+      line.append(",\"unix_time_ns\":" + std::to_string(record.unix_time_ns));
+      line.append(",\"severity\":\"");
+      line.append(SeverityName(s.severity));
+      line.append("\",\"thread\":" + std::to_string(record.thread_id));
+      line.append(",\"file\":");
+      AppendJsonString(s.file, &line);
+      line.append(",\"line\":" + std::to_string(s.line));
+      line.append(",\"format\":");
+      AppendJsonString(s.format, &line);
+      line.append(",\"args\":[");
+      for (size_t i = 0; i < args.size(); ++i) {
+        if (i != 0) {
+          line.push_back(',');
+        }
+        AppendJsonArg(args[i], &line);
+      }
+      line.append("],\"message\":");
+      AppendJsonString(message, &line);
+      line.append("}\n");
+    } else {
+      line.append(FormatTime(record.unix_time_ns));
+      line.push_back(' ');
+      line.push_back(SeverityLetter(s.severity));
+      line.append(" " + std::to_string(record.thread_id) + " ");
+      line.append(Basename(s.file));
+      line.append(":" + std::to_string(s.line) + "] ");
+      line.append(message);
+      line.push_back('\n');
+    }
+    std::fwrite(line.data(), 1, line.size(), stdout);
+  }
+}
+
+}  // namespace
+}  // namespace logging
+}  // namespace tbox
+
+int main(int argc, char** argv) {
+  bool json = false;
+  std::vector<const char*> files;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+  if (files.empty()) {
+    std::fprintf(stderr, "usage: %s [--json] FILE...\n", argv[0]);
+    return 2;
+  }
+  int status = 0;
+  for (const char* file : files) {
+    if (!tbox::logging::DecodeFile(file, json)) {
+      status = 1;
+    }
+  }
+  return status;
+}
@@ -0,0 +1,176 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/common/binary_log.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace logging {
+namespace {
+
+enum class Color { kRed = 2 };
+
+struct Point {
+  int x;
+  int y;
+};
+
+std::ostream& operator<<(std::ostream& os, const Point& p) {
+  return os << "(" << p.x << "," << p.y << ")";
+}
+
+template <typename... Args>
+std::string Format(std::string_view format, const Args&... args) {
+  std::string encoded;
+  (internal::EncodeArg(&encoded, args), ...);
+  std::string out;
+  EXPECT_TRUE(FormatArgs(format, encoded, &out));
+  return out;
+}
+
+TEST(BinaryLog, FormatsLikeTheStream) {
+  const std::string name = "alice";
+  EXPECT_EQ(Format("user {} logged in from {}:{}", name, "10.0.0.1",
+                   static_cast<uint16_t>(443)),
+            "user alice logged in from 10.0.0.1:443");
+  EXPECT_EQ(Format("{} {} {} {} {}", -42, uint64_t{1} << 63, 0.5, true, 'x'),
+            "-42 9223372036854775808 0.5 1 x");
+  EXPECT_EQ(Format("{} at {}", Color::kRed, Point{1, 2}), "2 at (1,2)");
+  EXPECT_EQ(Format("{{}} {}", std::string_view("x")), "{} x");
+  // Missing arguments keep the placeholder, extra ones are appended.
+  EXPECT_EQ(Format("{} {}", 1), "1 {}");
+  EXPECT_EQ(Format("done", 1, "more"), "done 1 more");
+
+  std::string out;
+  EXPECT_FALSE(FormatArgs("{}", std::string("\x02\x80", 2), &out));
+}
+
+TEST(BinaryLog, SmallerThanText) {
+  std::string encoded;
+  internal::EncodeArg(&encoded, 1234);
+  internal::EncodeArg(&encoded, uint64_t{200});
+  // Type byte plus a two byte varint each.
+  EXPECT_EQ(encoded.size(), 6);
+}
+
+std::filesystem::path TempPath(const char* name) {
+  const auto timestamp =
+      std::chrono::steady_clock::now().time_since_epoch().count();
+  return std::filesystem::temp_directory_path() /
+         (std::string("tbox_binary_log_test_") + std::to_string(timestamp)) /
+         name;
+}
+
+std::string ReadFile(const std::filesystem::path& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>());
+}
+
+TEST(BinaryLog, WriterAndReaderRoundTrip) {
+  const auto path = TempPath("test.BIN.log");
+  std::filesystem::create_directories(path.parent_path());
+  static const LogSite site_a("a.cc", 10, Severity::kInfo, "a {}");
+  static const LogSite site_b("b.cc", 20, Severity::kError, "b {} {}");
+
+  auto writer = BinaryLogWriter::Open(path.string(), 1 << 20, 3);
+  ASSERT_NE(writer, nullptr);
+  for (int i = 0; i < 3; ++i) {
+    std::string args;
+    internal::EncodeArg(&args, i);
+    writer->Write(site_a, 1000 + i, 7, args);
+  }
+  std::string args;
+  internal::EncodeArg(&args, "x");
+  internal::EncodeArg(&args, 2.5);
+  writer->Write(site_b, 2000, 8, args);
+  writer->Flush();
+
+  const std::string data = ReadFile(path);
+  BinaryLogReader reader(data);
+  ASSERT_TRUE(reader.ReadHeader());
+  BinaryLogReader::Site site;
+  BinaryLogReader::Record record;
+  std::vector<std::string> lines;
+  int sites = 0;
+  while (true) {
+    const auto entry = reader.Next(&site, &record);
+    if (entry == BinaryLogReader::Entry::kEnd) {
+      break;
+    }
+    ASSERT_NE(entry, BinaryLogReader::Entry::kCorrupt);
+    if (entry == BinaryLogReader::Entry::kSite) {
+      ++sites;
+      EXPECT_TRUE(site.id == site_a.id || site.id == site_b.id);
+      continue;
+    }
+    const LogSite& s = record.site_id == site_a.id ? site_a : site_b;
+    std::string line = std::to_string(record.unix_time_ns) + " " +
+                       std::to_string(record.thread_id) + " ";
+    ASSERT_TRUE(FormatArgs(s.format, record.args, &line));
+    lines.push_back(line);
+  }
+  // Each site is defined once.
+  EXPECT_EQ(sites, 2);
+  EXPECT_EQ(lines, (std::vector<std::string>{"1000 7 a 0", "1001 7 a 1",
+                                             "1002 7 a 2", "2000 8 b x 2.5"}));
+
+  // A truncated record is reported, not misread.
+  BinaryLogReader truncated(std::string_view(data).substr(0, data.size() - 3));
+  ASSERT_TRUE(truncated.ReadHeader());
+  BinaryLogReader::Entry entry;
+  do {
+    entry = truncated.Next(&site, &record);
+  } while (entry == BinaryLogReader::Entry::kSite ||
+           entry == BinaryLogReader::Entry::kRecord);
+  EXPECT_EQ(entry, BinaryLogReader::Entry::kCorrupt);
+
+  std::error_code error;
+  std::filesystem::remove_all(path.parent_path(), error);
+}
+
+TEST(BinaryLog, RotatedFilesDecodeOnTheirOwn) {
+  const auto path = TempPath("test.BIN.log");
+  std::filesystem::create_directories(path.parent_path());
+  static const LogSite site("r.cc", 1, Severity::kInfo, "record {}");
+
+  auto writer = BinaryLogWriter::Open(path.string(), 256, 2);
+  ASSERT_NE(writer, nullptr);
+  for (int i = 0; i < 100; ++i) {
+    std::string args;
+    internal::EncodeArg(&args, i);
+    writer->Write(site, i, 1, args);
+  }
+  writer.reset();
+
+  const auto rotated = path.parent_path() / "test.BIN.1.log";
+  ASSERT_TRUE(std::filesystem::exists(rotated));
+  EXPECT_TRUE(std::filesystem::exists(path.parent_path() / "test.BIN.2.log"));
+  EXPECT_FALSE(std::filesystem::exists(path.parent_path() / "test.BIN.3.log"));
+  const std::string data = ReadFile(rotated);
+  BinaryLogReader reader(data);
+  ASSERT_TRUE(reader.ReadHeader());
+  BinaryLogReader::Site s;
+  BinaryLogReader::Record record;
+  EXPECT_EQ(reader.Next(&s, &record), BinaryLogReader::Entry::kSite);
+  EXPECT_EQ(s.id, site.id);
+  EXPECT_EQ(s.format, "record {}");
+  EXPECT_EQ(reader.Next(&s, &record), BinaryLogReader::Entry::kRecord);
+
+  std::error_code error;
+  std::filesystem::remove_all(path.parent_path(), error);
+}
+
+}  // namespace
+}  // namespace logging
+}  // namespace tbox
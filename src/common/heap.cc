@@ -0,0 +1,213 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/common/heap.h"
+
+#include <array>
+#include <cstdlib>
+#include <memory>
+
+#include "src/common/metrics.h"
+
+#if defined(TBOX_MIMALLOC)
+#include "mimalloc.h"
+#endif
+
+namespace tbox {
+namespace memory {
+namespace {
+
+constexpr size_t kHeapCount = static_cast<size_t>(HeapId::kCount);
+
+constexpr const char* kNames[kHeapCount] = {
+    "io_buffers",
+    "grpc_events",
+    "client_registry",
+};
+
+size_t Index(HeapId id) { return static_cast<size_t>(id); }
+
+struct HeapCounters {
+  metrics::Counter* allocations;
+  metrics::Counter* frees;
+  metrics::Counter* allocated_bytes;
+  metrics::Counter* freed_bytes;
+};
+
+#if defined(TBOX_MIMALLOC)
+struct ProcessInfo {
+  size_t current_rss = 0;
+  size_t peak_rss = 0;
+  size_t current_commit = 0;
+  size_t peak_commit = 0;
+  size_t page_faults = 0;
+};
+
+ProcessInfo GetProcessInfo() {
+  ProcessInfo info;
+  size_t elapsed_msecs = 0;
+  size_t user_msecs = 0;
+  size_t system_msecs = 0;
+  mi_process_info(&elapsed_msecs, &user_msecs, &system_msecs,
+                  &info.current_rss, &info.peak_rss, &info.current_commit,
+                  &info.peak_commit, &info.page_faults);
+  return info;
+}
+#endif
+
+// Created on the first allocation and never destroyed: blocks are still
+// freed by static destructors, after function local statics such as the
+// registry are gone, which is also why it holds on to the registry.
+struct Metrics {
+  Metrics();
+
+  std::shared_ptr<metrics::Registry> registry;
+  std::array<HeapCounters, kHeapCount> heaps;
+};
+
+Metrics::Metrics() : registry(metrics::Registry::Instance()) {
+  for (size_t i = 0; i < kHeapCount; ++i) {
+    const metrics::Labels labels = {{"heap", kNames[i]}};
+    HeapCounters* heap = &heaps[i];
+    heap->allocations = registry->GetCounter(
+        "tbox_heap_allocations_total", "Blocks allocated from the heap.",
+        labels);
+    heap->frees = registry->GetCounter("tbox_heap_frees_total",
+                                       "Blocks returned to the heap.", labels);
+    heap->allocated_bytes = registry->GetCounter(
+        "tbox_heap_allocated_bytes_total", "Bytes allocated from the heap.",
+        labels);
+    heap->freed_bytes = registry->GetCounter(
+        "tbox_heap_freed_bytes_total", "Bytes returned to the heap.", labels);
+    registry->AddCallbackGauge(
+        "tbox_heap_live_bytes", "Bytes allocated from the heap and not freed.",
+        labels, [heap] {
+          // Freed first: every free is counted after its allocation.
+          const uint64_t freed = heap->freed_bytes->Value();
+          const uint64_t allocated = heap->allocated_bytes->Value();
+          return allocated > freed ? static_cast<double>(allocated - freed)
+                                   : 0.0;
+        });
+  }
+  registry->AddCallbackGauge(
+      "tbox_allocator_info", "The global allocator, as a label; always 1.",
+      {{"allocator", Heap::Isolated() ? "mimalloc" : "system"}},
+      [] { return 1.0; });
+#if defined(TBOX_MIMALLOC)
+  registry->AddCallbackGauge(
+      "tbox_mimalloc_committed_bytes", "Memory mimalloc has committed.", {},
+      [] { return static_cast<double>(GetProcessInfo().current_commit); });
+  registry->AddCallbackGauge(
+      "tbox_mimalloc_peak_committed_bytes",
+      "Most memory mimalloc has had committed at once.", {},
+      [] { return static_cast<double>(GetProcessInfo().peak_commit); });
+  registry->AddCallbackGauge(
+      "tbox_mimalloc_peak_resident_memory_bytes",
+      "Peak resident set size of the process.", {},
+      [] { return static_cast<double>(GetProcessInfo().peak_rss); });
+  registry->AddCallbackGauge(
+      "tbox_mimalloc_page_faults", "Hard page faults of the process.", {},
+      [] { return static_cast<double>(GetProcessInfo().page_faults); });
+#endif
+}
+
+Metrics* GetMetrics() {
+  static Metrics* const metrics = new Metrics();
+  return metrics;
+}
+
+#if defined(TBOX_MIMALLOC)
+// The calling thread's heaps, created on first use since a mimalloc heap
+// only allocates on the thread that made it.
+struct ThreadHeaps {
+  ~ThreadHeaps();
+
+  std::array<mi_heap_t*, kHeapCount> heaps{};
+};
+
+thread_local ThreadHeaps thread_heaps;
+// Set once thread_heaps is destroyed; later allocations of the exiting
+// thread, from other thread local destructors, use the default heap.
+thread_local bool thread_heaps_gone = false;
+
+ThreadHeaps::~ThreadHeaps() {
+  thread_heaps_gone = true;
+  for (mi_heap_t* heap : heaps) {
+    if (heap != nullptr) {
+      mi_heap_delete(heap);
+    }
+  }
+}
+
+void* AllocateFrom(HeapId id, size_t size) {
+  if (thread_heaps_gone) {
+    return mi_malloc(size);
+  }
+  mi_heap_t*& heap = thread_heaps.heaps[Index(id)];
+  if (heap == nullptr) {
+    heap = mi_heap_new();
+    if (heap == nullptr) {
+      return mi_malloc(size);
+    }
+  }
+  return mi_heap_malloc(heap, size);
+}
+#endif
+
+}  // namespace
+
+void* Heap::Allocate(HeapId id, size_t size) {
+#if defined(TBOX_MIMALLOC)
+  void* ptr = AllocateFrom(id, size);
+#else
+  // malloc(0) may return nullptr, which callers take for out of memory.
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+#endif
+  if (ptr != nullptr) {
+    HeapCounters& counters = GetMetrics()->heaps[Index(id)];
+    counters.allocations->Increment();
+    counters.allocated_bytes->Increment(size);
+  }
+  return ptr;
+}
+
+void Heap::Free(HeapId id, void* ptr, size_t size) noexcept {
+  if (ptr == nullptr) {
+    return;
+  }
+  HeapCounters& counters = GetMetrics()->heaps[Index(id)];
+  counters.frees->Increment();
+  counters.freed_bytes->Increment(size);
+#if defined(TBOX_MIMALLOC)
+  mi_free(ptr);
+#else
+  std::free(ptr);
+#endif
+}
+
+const char* Heap::Name(HeapId id) { return kNames[Index(id)]; }
+
+bool Heap::Isolated() {
+#if defined(TBOX_MIMALLOC)
+  return true;
+#else
+  return false;
+#endif
+}
+
+Heap::Stats Heap::GetStats(HeapId id) {
+  const HeapCounters& counters = GetMetrics()->heaps[Index(id)];
+  Stats stats;
+  stats.allocations = counters.allocations->Value();
+  stats.frees = counters.frees->Value();
+  stats.allocated_bytes = counters.allocated_bytes->Value();
+  stats.freed_bytes = counters.freed_bytes->Value();
+  return stats;
+}
+
+void Heap::ExportMetrics() { GetMetrics(); }
+
+}  // namespace memory
+}  // namespace tbox
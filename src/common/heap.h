@@ -0,0 +1,127 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_COMMON_HEAP_H_
+#define TBOX_COMMON_HEAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+namespace tbox {
+namespace memory {
+
+/// @brief Subsystems that allocate from a heap of their own.
+enum class HeapId {
+  kIoBuffers = 0,   // Frames and bodies handed to proxygen.
+  kGrpcEvents,      // async_grpc calls and the events they queue.
+  kClientRegistry,  // Reported clients, kept until the process exits.
+  kCount,
+};
+
+/// @brief Per subsystem heaps.
+/// @details With mimalloc as the global allocator, the default (see
+///          `--define allocator=system` in bazel/BUILD), every thread gets
+///          one mi_heap_t per subsystem. Blocks of different subsystems
+///          then never share a page, so a long lived registry entry cannot
+///          pin a page of short lived frames, and a burst of frames leaves
+///          no holes among registry entries. Any thread may free a block;
+///          mimalloc returns it to the heap it came from. When a thread
+///          exits its heaps are deleted and their live blocks move to the
+///          thread's default heap. With the system allocator the heaps are
+///          plain malloc and free.
+///
+///          Each heap counts allocations, frees and bytes in sharded
+///          counters, exported with the allocator's own process statistics
+///          as tbox_heap_* and tbox_mimalloc_* metrics.
+class Heap final {
+ public:
+  struct Stats {
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t allocated_bytes = 0;
+    uint64_t freed_bytes = 0;
+  };
+
+  /// @return size bytes aligned for any standard type, or nullptr when
+  ///         out of memory.
+  static void* Allocate(HeapId id, size_t size);
+  /// @param size The size ptr was allocated with.
+  static void Free(HeapId id, void* ptr, size_t size) noexcept;
+
+  /// @brief Label value of the heap's metrics, e.g. "io_buffers".
+  static const char* Name(HeapId id);
+  /// @brief True if the heaps are separate mimalloc heaps, false if they
+  ///        all come from the system allocator.
+  static bool Isolated();
+
+  static Stats GetStats(HeapId id);
+
+  /// @brief Registers the metrics now rather than on the first allocation,
+  ///        so that every series is there from the first scrape.
+  static void ExportMetrics();
+};
+
+/// @brief Standard allocator on heap kId, for containers.
+template <typename T, HeapId kId>
+class HeapAllocator {
+ public:
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = HeapAllocator<U, kId>;
+  };
+
+  HeapAllocator() noexcept = default;
+  template <typename U>
+  HeapAllocator(const HeapAllocator<U, kId>& /*other*/) noexcept {}  // NOLINT
+
+  T* allocate(size_t n) {
+    static_assert(alignof(T) <= alignof(std::max_align_t));
+    if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    void* ptr = Heap::Allocate(kId, n * sizeof(T));
+    if (ptr == nullptr) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(ptr);
+  }
+
+  void deallocate(T* ptr, size_t n) noexcept {
+    Heap::Free(kId, ptr, n * sizeof(T));
+  }
+
+  template <typename U>
+  bool operator==(const HeapAllocator<U, kId>& /*other*/) const noexcept {
+    return true;
+  }
+};
+
+/// @brief Base class that puts every `new` of the derived class on heap
+///        kId. Polymorphic classes need a virtual destructor, which they
+///        have anyway to be deleted through a base pointer.
+template <HeapId kId>
+class HeapAllocated {
+ public:
+  static void* operator new(size_t size) {
+    void* ptr = Heap::Allocate(kId, size);
+    if (ptr == nullptr) {
+      throw std::bad_alloc();
+    }
+    return ptr;
+  }
+
+  static void operator delete(void* ptr, size_t size) noexcept {
+    Heap::Free(kId, ptr, size);
+  }
+};
+
+}  // namespace memory
+}  // namespace tbox
+
+#endif  // TBOX_COMMON_HEAP_H_
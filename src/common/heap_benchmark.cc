@@ -0,0 +1,132 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+// Throughput and memory of the subsystem heaps under a server like mix,
+// at 1 and 8 threads. Each iteration allocates an IO frame of 256 B to
+// 16 KiB, kept until 64 newer ones exist, and two short lived gRPC events;
+// every 256th also adds a registry entry that lives for the whole run.
+//   ServerMix/0: everything from the global operator new.
+//   ServerMix/1: frames, events and entries from their own Heap.
+// rss_bytes is the resident set at the end of the loop, rss_after_free once
+// frames and events are freed and only the registry entries remain: memory
+// the allocator cannot give back because entries pin pages.
+//
+// RSS is per process, so compare the two variants in separate runs (with
+// --benchmark_filter=ServerMix/0 and ServerMix/1), and the allocators with
+// separate builds:
+//   bazel run -c opt //src/common:heap_benchmark
+//   bazel run -c opt --define allocator=system //src/common:heap_benchmark
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "benchmark/benchmark.h"
+#include "src/common/heap.h"
+
+namespace tbox {
+namespace memory {
+namespace {
+
+struct Block {
+  void* ptr = nullptr;
+  size_t size = 0;
+};
+
+double ResidentBytes() {
+#if defined(__linux__)
+  FILE* file = std::fopen("/proc/self/statm", "r");
+  if (file == nullptr) {
+    return 0;
+  }
+  long size = 0;      // NOLINT(runtime/int)
+  long resident = 0;  // NOLINT(runtime/int)
+  const int fields = std::fscanf(file, "%ld %ld", &size, &resident);
+  std::fclose(file);
+  return fields == 2 ? static_cast<double>(resident) * sysconf(_SC_PAGESIZE)
+                     : 0;
+#else
+  return 0;
+#endif
+}
+
+Block Allocate(HeapId id, size_t size, bool heaps) {
+  Block block{heaps ? Heap::Allocate(id, size) : ::operator new(size), size};
+  // Touch the block as its user would, so that it is resident.
+  std::memset(block.ptr, 0, size);
+  return block;
+}
+
+void Free(HeapId id, Block block, bool heaps) {
+  if (heaps) {
+    Heap::Free(id, block.ptr, block.size);
+  } else {
+    ::operator delete(block.ptr, block.size);
+  }
+}
+
+void BM_ServerMix(benchmark::State& state) {
+  const bool heaps = state.range(0) != 0;
+  std::array<Block, 64> frames{};
+  std::vector<Block> registry;
+  uint64_t random = 88172645463325252ULL + state.thread_index();
+  size_t next = 0;
+  int64_t count = 0;
+
+  for (auto _ : state) {
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    Block& frame = frames[next++ % frames.size()];
+    if (frame.ptr != nullptr) {
+      Free(HeapId::kIoBuffers, frame, heaps);
+    }
+    frame = Allocate(HeapId::kIoBuffers, 256 + random % (16 * 1024 - 256),
+                     heaps);
+    Block event = Allocate(HeapId::kGrpcEvents, 96, heaps);
+    Block resume = Allocate(HeapId::kGrpcEvents, 48, heaps);
+    benchmark::DoNotOptimize(event.ptr);
+    benchmark::DoNotOptimize(resume.ptr);
+    Free(HeapId::kGrpcEvents, resume, heaps);
+    Free(HeapId::kGrpcEvents, event, heaps);
+    if (++count % 256 == 0) {
+      registry.push_back(Allocate(HeapId::kClientRegistry, 224, heaps));
+    }
+  }
+
+  state.counters["rss_bytes"] =
+      benchmark::Counter(ResidentBytes(), benchmark::Counter::kAvgThreads);
+  for (Block& frame : frames) {
+    if (frame.ptr != nullptr) {
+      Free(HeapId::kIoBuffers, frame, heaps);
+    }
+  }
+  state.counters["rss_after_free"] =
+      benchmark::Counter(ResidentBytes(), benchmark::Counter::kAvgThreads);
+  for (const Block& entry : registry) {
+    Free(HeapId::kClientRegistry, entry, heaps);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ServerMix)
+    ->Arg(0)
+    ->Arg(1)
+    ->Threads(1)
+    ->Threads(8)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace memory
+}  // namespace tbox
+
+BENCHMARK_MAIN();
@@ -0,0 +1,126 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/common/heap.h"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/common/metrics.h"
+
+namespace tbox {
+namespace memory {
+namespace {
+
+struct Event : public HeapAllocated<HeapId::kGrpcEvents> {
+  virtual ~Event() = default;
+  uint64_t id = 0;
+};
+
+struct LargeEvent : public Event {
+  char payload[200] = {};
+};
+
+TEST(HeapTest, AllocateAndFree) {
+  const Heap::Stats before = Heap::GetStats(HeapId::kIoBuffers);
+  void* ptr = Heap::Allocate(HeapId::kIoBuffers, 1000);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % alignof(std::max_align_t), 0u);
+  std::memset(ptr, 1, 1000);
+  Heap::Stats stats = Heap::GetStats(HeapId::kIoBuffers);
+  EXPECT_EQ(stats.allocations - before.allocations, 1u);
+  EXPECT_EQ(stats.allocated_bytes - before.allocated_bytes, 1000u);
+
+  Heap::Free(HeapId::kIoBuffers, ptr, 1000);
+  stats = Heap::GetStats(HeapId::kIoBuffers);
+  EXPECT_EQ(stats.frees - before.frees, 1u);
+  EXPECT_EQ(stats.freed_bytes - before.freed_bytes, 1000u);
+
+  ptr = Heap::Allocate(HeapId::kIoBuffers, 0);
+  EXPECT_NE(ptr, nullptr);
+  Heap::Free(HeapId::kIoBuffers, ptr, 0);
+}
+
+TEST(HeapTest, HeapAllocated) {
+  const Heap::Stats before = Heap::GetStats(HeapId::kGrpcEvents);
+  std::unique_ptr<Event> event = std::make_unique<LargeEvent>();
+  event.reset();
+  const Heap::Stats stats = Heap::GetStats(HeapId::kGrpcEvents);
+  EXPECT_EQ(stats.allocations - before.allocations, 1u);
+  // Deleting through the base frees the size of the derived class.
+  EXPECT_EQ(stats.allocated_bytes - before.allocated_bytes,
+            sizeof(LargeEvent));
+  EXPECT_EQ(stats.freed_bytes - before.freed_bytes, sizeof(LargeEvent));
+}
+
+TEST(HeapTest, Containers) {
+  using Allocator = HeapAllocator<std::pair<const int, std::string>,
+                                  HeapId::kClientRegistry>;
+  const Heap::Stats before = Heap::GetStats(HeapId::kClientRegistry);
+  {
+    std::unordered_map<int, std::string, std::hash<int>, std::equal_to<int>,
+                       Allocator>
+        map;
+    for (int i = 0; i < 100; ++i) {
+      map[i] = std::to_string(i);
+    }
+    EXPECT_EQ(map.at(42), "42");
+    const Heap::Stats stats = Heap::GetStats(HeapId::kClientRegistry);
+    // Nodes and buckets.
+    EXPECT_GT(stats.allocations - before.allocations, 100u);
+  }
+  const Heap::Stats stats = Heap::GetStats(HeapId::kClientRegistry);
+  EXPECT_EQ(stats.allocations - before.allocations,
+            stats.frees - before.frees);
+  EXPECT_EQ(stats.allocated_bytes - before.allocated_bytes,
+            stats.freed_bytes - before.freed_bytes);
+}
+
+TEST(HeapTest, FreeOnAnotherThread) {
+  const Heap::Stats before = Heap::GetStats(HeapId::kIoBuffers);
+  std::vector<void*> blocks;
+  std::thread producer([&blocks] {
+    for (int i = 0; i < 1000; ++i) {
+      blocks.push_back(Heap::Allocate(HeapId::kIoBuffers, 64 + i));
+    }
+  });
+  // The producer's heaps are deleted when it exits, before the frees.
+  producer.join();
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    ASSERT_NE(blocks[i], nullptr);
+    Heap::Free(HeapId::kIoBuffers, blocks[i], 64 + i);
+  }
+  const Heap::Stats stats = Heap::GetStats(HeapId::kIoBuffers);
+  EXPECT_EQ(stats.allocations - before.allocations, 1000u);
+  EXPECT_EQ(stats.frees - before.frees, 1000u);
+}
+
+TEST(HeapTest, Metrics) {
+  Heap::ExportMetrics();
+  const std::string text = metrics::Registry::Instance()->PrometheusText();
+  for (int i = 0; i < static_cast<int>(HeapId::kCount); ++i) {
+    const std::string labels =
+        std::string("{heap=\"") + Heap::Name(static_cast<HeapId>(i)) + "\"}";
+    EXPECT_NE(text.find("\ntbox_heap_live_bytes" + labels + " "),
+              std::string::npos);
+    EXPECT_NE(text.find("\ntbox_heap_allocations_total" + labels + " "),
+              std::string::npos);
+  }
+  EXPECT_NE(text.find(Heap::Isolated()
+                          ? "tbox_allocator_info{allocator=\"mimalloc\"} 1\n"
+                          : "tbox_allocator_info{allocator=\"system\"} 1\n"),
+            std::string::npos);
+}
+
+}  // namespace
+}  // namespace memory
+}  // namespace tbox
@@ -5,10 +5,19 @@
 
 #include "src/common/logging.h"
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
 #include <filesystem>
 #include <mutex>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include "src/common/binary_log.h"
+#include "spdlog/details/log_msg.h"
+#include "spdlog/details/os.h"
 #include "spdlog/sinks/null_sink.h"
 #include "spdlog/sinks/rotating_file_sink.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
@@ -20,9 +29,12 @@ namespace {
 
 constexpr size_t kMaxLogFileSize = 10 * 1024 * 1024;
 constexpr size_t kMaxRotatedFiles = 10;
-
-std::mutex g_logging_mutex;
-std::shared_ptr<spdlog::logger> g_logger;
+constexpr char kPattern[] = "%Y%m%d %H:%M:%S.%e %L %t %s:%#] %v";
+// Records taken from one ring per writer pass, so one busy thread cannot
+// starve the others.
+constexpr size_t kMaxBatch = 512;
+// The writer polls at least this often even if no producer woke it.
+constexpr auto kMaxIdleWait = std::chrono::milliseconds(50);
 
 spdlog::level::level_enum ToSpdlogLevel(Severity severity) {
   switch (severity) {
@@ -38,33 +50,388 @@ spdlog::level::level_enum ToSpdlogLevel(Severity severity) {
   return spdlog::level::info;
 }
 
-std::shared_ptr<spdlog::logger> Logger() {
+struct Record {
+  spdlog::log_clock::time_point time;
+  const char* file = nullptr;
+  int line = 0;
+  Severity severity = Severity::kInfo;
+  size_t thread_id = 0;
+  // Set for BLOG() records, message then holds the encoded arguments.
+  const LogSite* site = nullptr;
+  std::string message;
+};
+
+// Single producer (the owning thread), single consumer (whoever holds the
+// writer's rings mutex) queue of records.
+class RecordRing {
+ public:
+  explicit RecordRing(size_t capacity)
+      : slots_(std::bit_ceil(std::max<size_t>(capacity, 2))),
+        mask_(slots_.size() - 1) {}
+
+  // Moves record in only on success.
+  bool TryPush(Record* record) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == slots_.size()) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == slots_.size()) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::move(*record);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Appends up to max records to out, returns how many.
+  size_t PopBatch(std::vector<Record>* out, size_t max) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    const size_t n = std::min(tail - head, max);
+    for (size_t i = 0; i < n; ++i) {
+      out->push_back(std::move(slots_[(head + i) & mask_]));
+    }
+    head_.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  bool Empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+  // Set when the producing thread exits; the writer forgets the ring once
+  // it is drained.
+  std::atomic<bool> orphaned{false};
+
+ private:
+  std::vector<Record> slots_;
+  const size_t mask_;
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+  // Producer's last seen head_, saves reading the consumer's cache line.
+  size_t cached_head_ = 0;
+};
+
+// Where records go: straight into the spdlog logger, or through per-thread
+// rings to a writer thread that writes them in batches.
+class Backend {
+ public:
+  Backend(std::shared_ptr<spdlog::logger> logger,
+          std::unique_ptr<BinaryLogWriter> binary, const Options& options)
+      : logger_(std::move(logger)),
+        binary_(std::move(binary)),
+        options_(options),
+        generation_(next_generation_.fetch_add(1) + 1) {
+    if (options_.async) {
+      writer_ = std::thread([this] { Run(); });
+    }
+  }
+
+  Backend(const Backend&) = delete;
+  Backend& operator=(const Backend&) = delete;
+
+  ~Backend() { Stop(); }
+
+  void Log(Severity severity, const char* file, int line,
+           std::string&& message) {
+    if (!options_.async || severity == Severity::kFatal ||
+        stopped_.load(std::memory_order_acquire)) {
+      if (severity == Severity::kFatal) {
+        // Everything logged before the crash must reach the files first.
+        Flush();
+      }
+      logger_->log(spdlog::source_loc{file, line, nullptr},
+                   ToSpdlogLevel(severity), message);
+      return;
+    }
+
+    Enqueue(Record{spdlog::log_clock::now(), file, line, severity,
+                   spdlog::details::os::thread_id(), nullptr,
+                   std::move(message)});
+  }
+
+  void LogBinary(const LogSite& site, std::string&& args) {
+    if (!binary_) {
+      std::string message;
+      FormatArgs(site.format, args, &message);
+      Log(site.severity, site.file, site.line, std::move(message));
+      return;
+    }
+    if (!options_.async || stopped_.load(std::memory_order_acquire)) {
+      binary_->Write(site, UnixNanos(spdlog::log_clock::now()),
+                     spdlog::details::os::thread_id(), args);
+      if (site.severity >= options_.flush_severity) {
+        binary_->Flush();
+      }
+      return;
+    }
+    Enqueue(Record{spdlog::log_clock::now(), site.file, site.line,
+                   site.severity, spdlog::details::os::thread_id(), &site,
+                   std::move(args)});
+  }
+
+  void Flush() {
+    if (options_.async) {
+      std::lock_guard<std::mutex> lock(rings_mutex_);
+      std::vector<Record> batch;
+      while (DrainLocked(&batch) != 0) {
+      }
+    }
+    FlushSinks();
+  }
+
+  void Stop() {
+    if (stopped_.exchange(true)) {
+      return;
+    }
+    if (writer_.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_.notify_one();
+      }
+      writer_.join();
+    }
+    Flush();
+  }
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  static int64_t UnixNanos(spdlog::log_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               time.time_since_epoch())
+        .count();
+  }
+
+  void FlushSinks() {
+    logger_->flush();
+    if (binary_) {
+      binary_->Flush();
+    }
+  }
+
+  void Enqueue(Record&& record) {
+    const Severity severity = record.severity;
+    RecordRing* ring = LocalRing();
+    while (!ring->TryPush(&record)) {
+      if (options_.overflow == OverflowPolicy::kDrop) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      Wake();
+      std::this_thread::yield();
+    }
+    if (severity >= options_.flush_severity) {
+      flush_requested_.store(true, std::memory_order_relaxed);
+      Wake();
+    } else if (sleeping_.load(std::memory_order_seq_cst)) {
+      Wake();
+    }
+  }
+
+  RecordRing* LocalRing() {
+    // One ring per thread and backend; a thread that logged to an earlier
+    // backend registers a fresh ring.
+    struct Local {
+      uint64_t generation = 0;
+      std::shared_ptr<RecordRing> ring;
+      ~Local() {
+        if (ring) {
+          ring->orphaned.store(true, std::memory_order_release);
+        }
+      }
+    };
+    thread_local Local local;
+    if (local.generation != generation_) {
+      if (local.ring) {
+        local.ring->orphaned.store(true, std::memory_order_release);
+      }
+      local.ring = std::make_shared<RecordRing>(options_.ring_capacity);
+      local.generation = generation_;
+      std::lock_guard<std::mutex> lock(rings_mutex_);
+      rings_.push_back(local.ring);
+    }
+    return local.ring.get();
+  }
+
+  void Wake() {
+    if (sleeping_.load(std::memory_order_seq_cst)) {
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+      woken_ = true;
+      wake_.notify_one();
+    }
+  }
+
+  // One pass over all rings, writes what it took. Caller holds rings_mutex_.
+  size_t DrainLocked(std::vector<Record>* batch) {
+    batch->clear();
+    for (auto it = rings_.begin(); it != rings_.end();) {
+      RecordRing* ring = it->get();
+      // Read the flag before popping so a ring is only dropped once its last
+      // record has been taken.
+      const bool orphaned = ring->orphaned.load(std::memory_order_acquire);
+      ring->PopBatch(batch, kMaxBatch);
+      if (orphaned && ring->Empty()) {
+        it = rings_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    if (batch->empty()) {
+      return 0;
+    }
+    // Rings are drained one after the other, restore the global order.
+    std::stable_sort(batch->begin(), batch->end(),
+                     [](const Record& a, const Record& b) {
+                       return a.time < b.time;
+                     });
+    const auto& sinks = logger_->sinks();
+    for (const Record& record : *batch) {
+      if (record.site) {
+        binary_->Write(*record.site, UnixNanos(record.time), record.thread_id,
+                       record.message);
+        continue;
+      }
+      spdlog::details::log_msg msg(
+          record.time, spdlog::source_loc{record.file, record.line, nullptr},
+          logger_->name(), ToSpdlogLevel(record.severity), record.message);
+      msg.thread_id = record.thread_id;
+      for (const auto& sink : sinks) {
+        if (sink->should_log(msg.level)) {
+          sink->log(msg);
+        }
+      }
+    }
+    return batch->size();
+  }
+
+  void Run() {
+    std::vector<Record> batch;
+    batch.reserve(kMaxBatch);
+    auto last_flush = std::chrono::steady_clock::now();
+    while (true) {
+      const bool stopping = stopped_.load(std::memory_order_acquire);
+      size_t written = 0;
+      {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        written = DrainLocked(&batch);
+      }
+      const auto now = std::chrono::steady_clock::now();
+      if (flush_requested_.exchange(false, std::memory_order_relaxed) ||
+          now - last_flush >= options_.flush_interval) {
+        FlushSinks();
+        last_flush = now;
+      }
+      if (stopping) {
+        return;
+      }
+      if (written != 0) {
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(wake_mutex_);
+      sleeping_.store(true, std::memory_order_seq_cst);
+      wake_.wait_for(lock,
+                     std::min<std::chrono::steady_clock::duration>(
+                         options_.flush_interval, kMaxIdleWait),
+                     [this] {
+                       return woken_ ||
+                              stopped_.load(std::memory_order_acquire);
+                     });
+      woken_ = false;
+      sleeping_.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  static inline std::atomic<uint64_t> next_generation_{0};
+
+  const std::shared_ptr<spdlog::logger> logger_;
+  const std::unique_ptr<BinaryLogWriter> binary_;
+  const Options options_;
+  const uint64_t generation_;
+
+  std::mutex rings_mutex_;
+  std::vector<std::shared_ptr<RecordRing>> rings_;
+
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+  bool woken_ = false;  // guarded by wake_mutex_
+  std::atomic<bool> sleeping_{false};
+  std::atomic<bool> flush_requested_{false};
+  std::atomic<bool> stopped_{false};
+  std::atomic<uint64_t> dropped_{0};
+  std::thread writer_;
+};
+
+// Guards Initialize() / Shutdown(); log statements only load g_backend.
+std::mutex g_logging_mutex;
+std::atomic<Backend*> g_backend{nullptr};
+// Replaced backends are stopped but never freed: another thread may still be
+// inside Log() with the old pointer. Initialize() runs a handful of times per
+// process.
+std::vector<std::unique_ptr<Backend>>* g_backends =
+    new std::vector<std::unique_ptr<Backend>>();
+std::atomic<uint64_t> g_dropped_before{0};
+
+// Caller holds g_logging_mutex.
+void InstallLocked(std::shared_ptr<spdlog::logger> logger,
+                   std::unique_ptr<BinaryLogWriter> binary,
+                   const Options& options) {
+  spdlog::set_default_logger(logger);
+  internal::g_min_severity.store(
+      options.write_logs ? static_cast<int>(options.min_severity)
+                         : static_cast<int>(Severity::kFatal),
+      std::memory_order_relaxed);
+  auto backend = std::make_unique<Backend>(std::move(logger),
+                                           std::move(binary), options);
+  Backend* previous = g_backend.exchange(backend.get());
+  g_backends->push_back(std::move(backend));
+  if (previous) {
+    previous->Stop();
+    g_dropped_before.fetch_add(previous->dropped());
+  }
+}
+
+Backend* CurrentBackend() {
+  Backend* backend = g_backend.load(std::memory_order_acquire);
+  if (backend) {
+    return backend;
+  }
   std::lock_guard<std::mutex> lock(g_logging_mutex);
-  if (!g_logger) {
+  if (!g_backend.load(std::memory_order_relaxed)) {
     auto sink = std::make_shared<spdlog::sinks::stderr_color_sink_mt>();
     sink->set_level(spdlog::level::info);
-    g_logger = std::make_shared<spdlog::logger>("tbox", std::move(sink));
-    g_logger->set_level(spdlog::level::info);
-    g_logger->set_pattern("%Y%m%d %H:%M:%S.%e %L %t %s:%#] %v");
-    spdlog::set_default_logger(g_logger);
+    auto logger = std::make_shared<spdlog::logger>("tbox", std::move(sink));
+    logger->set_level(spdlog::level::info);
+    logger->set_pattern(kPattern);
+    Options options;
+    options.flush_severity = Severity::kInfo;
+    InstallLocked(std::move(logger), nullptr, options);
   }
-  return g_logger;
+  return g_backend.load(std::memory_order_relaxed);
 }
 
 void Log(Severity severity, const char* file, int line,
-         const std::string& message) {
-  auto logger = Logger();
-  logger->log(spdlog::source_loc{file, line, nullptr}, ToSpdlogLevel(severity),
-              message);
-  if (severity == Severity::kFatal) {
-    logger->flush();
-  }
+         std::string&& message) {
+  CurrentBackend()->Log(severity, file, line, std::move(message));
 }
 
 }  // namespace
 
+void WriteBinaryRecord(const LogSite& site, std::string&& args) {
+  CurrentBackend()->LogBinary(site, std::move(args));
+}
+
 void Initialize(const std::string& program_name, const std::string& log_dir,
                 bool write_logs) {
+  Options options;
+  options.write_logs = write_logs;
+  options.flush_severity = Severity::kInfo;
+  Initialize(program_name, log_dir, options);
+}
+
+void Initialize(const std::string& program_name, const std::string& log_dir,
+                const Options& options) {
   std::lock_guard<std::mutex> lock(g_logging_mutex);
 
   std::string basename =
@@ -75,15 +442,19 @@ void Initialize(const std::string& program_name, const std::string& log_dir,
     basename = "tbox";
   }
   std::vector<spdlog::sink_ptr> sinks;
+  std::unique_ptr<BinaryLogWriter> binary;
 
-  if (!write_logs) {
+  if (!options.write_logs) {
     sinks.push_back(std::make_shared<spdlog::sinks::null_sink_mt>());
   }
 
-  if (write_logs) {
-    auto console_sink = std::make_shared<spdlog::sinks::stderr_color_sink_mt>();
-    console_sink->set_level(spdlog::level::info);
-    sinks.push_back(console_sink);
+  if (options.write_logs) {
+    if (options.console) {
+      auto console_sink =
+          std::make_shared<spdlog::sinks::stderr_color_sink_mt>();
+      console_sink->set_level(spdlog::level::info);
+      sinks.push_back(console_sink);
+    }
     std::filesystem::create_directories(log_dir);
     const struct {
       const char* suffix;
@@ -103,24 +474,51 @@ void Initialize(const std::string& program_name, const std::string& log_dir,
       sink->set_level(sink_config.level);
       sinks.push_back(sink);
     }
+    if (options.binary) {
+      const auto path =
+          std::filesystem::path(log_dir) / (basename + ".BIN.log");
+      binary = BinaryLogWriter::Open(path.string(), kMaxLogFileSize,
+                                     kMaxRotatedFiles);
+    }
   }
 
   auto logger =
       std::make_shared<spdlog::logger>(basename, sinks.begin(), sinks.end());
   logger->set_level(spdlog::level::info);
-  logger->set_pattern("%Y%m%d %H:%M:%S.%e %L %t %s:%#] %v");
-  logger->flush_on(spdlog::level::info);
-  spdlog::set_default_logger(logger);
-  g_logger = logger;
+  logger->set_pattern(kPattern);
+  // The async writer flushes on its own schedule.
+  logger->flush_on(options.async ? spdlog::level::off
+                                 : ToSpdlogLevel(options.flush_severity));
+  if (options.binary && options.write_logs && !binary) {
+    logger->warn("Cannot open the binary log in {}, BLOG writes text",
+                 log_dir);
+  }
+  InstallLocked(std::move(logger), std::move(binary), options);
 }
 
+void Flush() { CurrentBackend()->Flush(); }
+
 void Shutdown() {
   std::lock_guard<std::mutex> lock(g_logging_mutex);
-  if (g_logger) {
-    g_logger->flush();
+  Backend* backend = g_backend.exchange(nullptr);
+  if (backend) {
+    backend->Stop();
+    g_dropped_before.fetch_add(backend->dropped());
   }
+  internal::g_min_severity.store(static_cast<int>(Severity::kInfo),
+                                 std::memory_order_relaxed);
   spdlog::shutdown();
-  g_logger.reset();
+}
+
+void SetMinSeverity(Severity severity) {
+  internal::g_min_severity.store(
+      static_cast<int>(std::min(severity, Severity::kFatal)),
+      std::memory_order_relaxed);
+}
+
+uint64_t DroppedRecords() {
+  const Backend* backend = g_backend.load(std::memory_order_acquire);
+  return g_dropped_before.load() + (backend ? backend->dropped() : 0);
 }
 
 std::string CommandLine(int argc, char** argv) {
@@ -138,7 +536,7 @@ LogMessage::LogMessage(const char* file, int line, Severity severity)
     : file_(file), line_(line), severity_(severity) {}
 
 LogMessage::~LogMessage() {
-  Log(severity_, file_, line_, stream_.str());
+  Log(severity_, file_, line_, std::move(stream_).str());
   if (severity_ == Severity::kFatal) {
     std::abort();
   }
@@ -148,7 +546,7 @@ FatalLogMessage::FatalLogMessage(const char* file, int line)
     : file_(file), line_(line) {}
 
 FatalLogMessage::~FatalLogMessage() {
-  Log(Severity::kFatal, file_, line_, stream_.str());
+  Log(Severity::kFatal, file_, line_, std::move(stream_).str());
   std::abort();
 }
 
@@ -164,7 +562,7 @@ CheckMessage::~CheckMessage() {
   if (!failed_) {
     return;
   }
-  Log(Severity::kFatal, file_, line_, stream_.str());
+  Log(Severity::kFatal, file_, line_, std::move(stream_).str());
   std::abort();
 }
 
@@ -6,12 +6,22 @@
 #ifndef TBOX_COMMON_LOGGING_H_
 #define TBOX_COMMON_LOGGING_H_
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
 #include <ostream>
 #include <sstream>
 #include <string>
 
+// Statements below this level are compiled out: 0 INFO, 1 WARNING, 2 ERROR.
+// FATAL is always compiled in.
+#ifndef TBOX_MIN_LOG_LEVEL
+#define TBOX_MIN_LOG_LEVEL 0
+#endif
+
 namespace tbox {
 namespace logging {
 
@@ -22,10 +32,72 @@ enum class Severity {
   kFatal,
 };
 
+/// @brief What a thread does when its async ring buffer is full.
+enum class OverflowPolicy {
+  kDrop,   // discard the record and count it in DroppedRecords()
+  kBlock,  // wait for the writer thread to make room
+};
+
+struct Options {
+  bool write_logs = true;
+  // Also write to stderr; only used when write_logs is set.
+  bool console = true;
+  // Hand records to a background writer through a lock-free ring per thread
+  // instead of writing them in the calling thread.
+  bool async = false;
+  // Records per thread ring, rounded up to a power of two.
+  size_t ring_capacity = 8192;
+  OverflowPolicy overflow = OverflowPolicy::kDrop;
+  // Sinks are flushed right after a record of at least this severity and at
+  // least every flush_interval (async mode only) otherwise. FATAL records are
+  // always written and flushed synchronously.
+  Severity flush_severity = Severity::kWarning;
+  std::chrono::milliseconds flush_interval{1000};
+  // Records below this severity are skipped before their arguments are
+  // evaluated.
+  Severity min_severity = Severity::kInfo;
+  // BLOG() records go to <program>.BIN.log as a format string id plus the
+  // raw arguments (see binary_log.h) instead of the text logs.
+  bool binary = false;
+};
+
+/// @brief Legacy synchronous setup, flushing after every record.
 void Initialize(const std::string& program_name,
                 const std::string& log_dir = "./logs",
                 bool write_logs = true);
+void Initialize(const std::string& program_name, const std::string& log_dir,
+                const Options& options);
+
+/// @brief Write out everything queued so far and flush the sinks.
+void Flush();
+
+/// @brief Flushes and stops the async writer. Records logged concurrently
+///        with Shutdown() may be lost.
 void Shutdown();
+
+/// @brief Records discarded by OverflowPolicy::kDrop since start.
+uint64_t DroppedRecords();
+
+namespace internal {
+inline std::atomic<int> g_min_severity{0};
+}  // namespace internal
+
+/// @brief Changes the runtime threshold set by Options::min_severity. FATAL
+///        can not be disabled.
+void SetMinSeverity(Severity severity);
+
+inline bool IsEnabled(Severity severity) {
+  return static_cast<int>(severity) >=
+         internal::g_min_severity.load(std::memory_order_relaxed);
+}
+
+// Lets LOG() be the false branch of a conditional expression; & binds looser
+// than << and tighter than ?:.
+class LogMessageVoidify {
+ public:
+  void operator&(std::ostream&) {}
+};
+
 std::string CommandLine(int argc, char** argv);
 
 class LogMessage {
@@ -109,7 +181,24 @@ class CheckMessage {
 #undef CHECK_GE
 #endif
 
-#define LOG(level) TBOX_LOG_##level(__FILE__, __LINE__)
+// Nothing after LOG(level) is evaluated when the level is compiled out or
+// below the runtime threshold.
+#define LOG(level) \
+  !(TBOX_LOG_IS_ON_##level) \
+      ? (void)0 \
+      : ::tbox::logging::LogMessageVoidify() & \
+            TBOX_LOG_##level(__FILE__, __LINE__)
+
+#define TBOX_LOG_IS_ON_INFO \
+  (TBOX_MIN_LOG_LEVEL <= 0 && \
+   ::tbox::logging::IsEnabled(::tbox::logging::Severity::kInfo))
+#define TBOX_LOG_IS_ON_WARNING \
+  (TBOX_MIN_LOG_LEVEL <= 1 && \
+   ::tbox::logging::IsEnabled(::tbox::logging::Severity::kWarning))
+#define TBOX_LOG_IS_ON_ERROR \
+  (TBOX_MIN_LOG_LEVEL <= 2 && \
+   ::tbox::logging::IsEnabled(::tbox::logging::Severity::kError))
+#define TBOX_LOG_IS_ON_FATAL true
 
 #define TBOX_LOG_INFO(file, line) \
   ::tbox::logging::LogMessage(file, line, \
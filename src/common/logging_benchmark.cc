@@ -0,0 +1,171 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+// Cost of a LOG(INFO) statement seen by the calling thread, at 1 and 16
+// threads, writing to the rotating files in a temporary directory:
+//   Sync:       the legacy mode, every record written and flushed in place.
+//   AsyncDrop:  per-thread rings, records dropped when a ring is full.
+//   AsyncBlock: per-thread rings, callers wait for room.
+//   Binary:     BLOG() through the async rings into the binary log, waiting
+//               for room like AsyncBlock so both time every record.
+//   Disabled:   LOG(INFO) below the runtime threshold.
+// p50 / p99 / max call latency and the dropped records are reported as
+// counters, items_per_second is the aggregate throughput.
+//
+//   bazel run -c opt //src/common:logging_benchmark
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/common/binary_log.h"
+#include "src/common/logging.h"
+
+namespace tbox {
+namespace logging {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::filesystem::path LogDirectory() {
+  return std::filesystem::temp_directory_path() / "tbox_logging_benchmark";
+}
+
+void Start(const Options& options) {
+  Initialize("logging_benchmark", LogDirectory().string(), options);
+}
+
+void SetupSync(const benchmark::State&) {
+  Options options;
+  options.console = false;
+  options.flush_severity = Severity::kInfo;
+  Start(options);
+}
+
+void SetupAsyncDrop(const benchmark::State&) {
+  Options options;
+  options.console = false;
+  options.async = true;
+  options.overflow = OverflowPolicy::kDrop;
+  Start(options);
+}
+
+void SetupAsyncBlock(const benchmark::State&) {
+  Options options;
+  options.console = false;
+  options.async = true;
+  options.overflow = OverflowPolicy::kBlock;
+  Start(options);
+}
+
+void SetupBinary(const benchmark::State&) {
+  Options options;
+  options.console = false;
+  options.async = true;
+  options.binary = true;
+  options.overflow = OverflowPolicy::kBlock;
+  Start(options);
+}
+
+void SetupDisabled(const benchmark::State&) {
+  Options options;
+  options.console = false;
+  options.min_severity = Severity::kWarning;
+  Start(options);
+}
+
+void Teardown(const benchmark::State&) {
+  Shutdown();
+  std::error_code error;
+  std::filesystem::remove_all(LogDirectory(), error);
+}
+
+enum class Api { kStream, kBinary };
+
+template <Api api>
+void BM_Log(benchmark::State& state) {
+  const uint64_t dropped_before = DroppedRecords();
+  std::vector<int64_t> latency_ns;
+  latency_ns.reserve(1 << 20);
+  int64_t i = 0;
+  for (auto _ : state) {
+    const auto start = Clock::now();
+    if constexpr (api == Api::kStream) {
+      LOG(INFO) << "request " << i++ << " served in " << 42 << "us";
+    } else {
+      BLOG(INFO, "request {} served in {}us", i++, 42);
+    }
+    const auto end = Clock::now();
+    if (latency_ns.size() < latency_ns.capacity()) {
+      latency_ns.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+              .count());
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (latency_ns.empty()) {
+    return;
+  }
+  std::sort(latency_ns.begin(), latency_ns.end());
+  // Averaged over threads by the framework.
+  state.counters["p50_ns"] = benchmark::Counter(
+      latency_ns[latency_ns.size() / 2], benchmark::Counter::kAvgThreads);
+  state.counters["p99_ns"] = benchmark::Counter(
+      latency_ns[latency_ns.size() * 99 / 100],
+      benchmark::Counter::kAvgThreads);
+  state.counters["max_ns"] = benchmark::Counter(
+      latency_ns.back(), benchmark::Counter::kAvgThreads);
+  if (state.thread_index() == 0) {
+    state.counters["dropped"] =
+        static_cast<double>(DroppedRecords() - dropped_before);
+  }
+}
+
+BENCHMARK(BM_Log<Api::kStream>)
+    ->Name("Log/Sync")
+    ->Setup(SetupSync)
+    ->Teardown(Teardown)
+    ->Threads(1)
+    ->Threads(16)
+    ->UseRealTime();
+BENCHMARK(BM_Log<Api::kStream>)
+    ->Name("Log/AsyncDrop")
+    ->Setup(SetupAsyncDrop)
+    ->Teardown(Teardown)
+    ->Threads(1)
+    ->Threads(16)
+    ->UseRealTime();
+BENCHMARK(BM_Log<Api::kStream>)
+    ->Name("Log/AsyncBlock")
+    ->Setup(SetupAsyncBlock)
+    ->Teardown(Teardown)
+    ->Threads(1)
+    ->Threads(16)
+    ->UseRealTime();
+BENCHMARK(BM_Log<Api::kBinary>)
+    ->Name("Log/Binary")
+    ->Setup(SetupBinary)
+    ->Teardown(Teardown)
+    ->Threads(1)
+    ->Threads(16)
+    ->UseRealTime();
+BENCHMARK(BM_Log<Api::kStream>)
+    ->Name("Log/Disabled")
+    ->Setup(SetupDisabled)
+    ->Teardown(Teardown)
+    ->Threads(1)
+    ->Threads(16)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace logging
+}  // namespace tbox
+
+BENCHMARK_MAIN();
@@ -5,9 +5,15 @@
 
 #include "src/common/logging.h"
 
+#include "src/common/binary_log.h"
+
 #include <chrono>
 #include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -45,6 +51,181 @@ TEST(LoggingTest, EnabledLoggingCreatesRotatingFiles) {
   std::filesystem::remove_all(log_directory, error);
 }
 
+std::string ReadFile(const std::filesystem::path& path) {
+  std::ifstream in(path);
+  return std::string(std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>());
+}
+
+size_t CountLines(const std::string& content, const std::string& needle) {
+  size_t count = 0;
+  for (size_t pos = content.find(needle); pos != std::string::npos;
+       pos = content.find(needle, pos + needle.size())) {
+    ++count;
+  }
+  return count;
+}
+
+TEST(LoggingTest, AsyncWritesEveryRecordFromAllThreads) {
+  const auto log_directory = UniqueLogDirectory("async");
+  Options options;
+  options.console = false;
+  options.async = true;
+  options.overflow = OverflowPolicy::kBlock;
+  options.ring_capacity = 16;
+  Initialize("logging_test", log_directory.string(), options);
+
+  constexpr int kThreads = 8;
+  constexpr int kRecords = 500;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([t] {
+      for (int i = 0; i < kRecords; ++i) {
+        LOG(INFO) << "async record " << t << " " << i;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  LOG(WARNING) << "async warning";
+  Flush();
+
+  const std::string info = ReadFile(log_directory / "logging_test.INFO.log");
+  EXPECT_EQ(CountLines(info, "async record "), kThreads * kRecords);
+  EXPECT_EQ(CountLines(info, "async warning"), 1);
+  EXPECT_EQ(
+      CountLines(ReadFile(log_directory / "logging_test.WARNING.log"),
+                 "async record "),
+      0);
+  EXPECT_EQ(DroppedRecords(), 0);
+  Shutdown();
+
+  std::error_code error;
+  std::filesystem::remove_all(log_directory, error);
+}
+
+TEST(LoggingTest, AsyncDropCountsDiscardedRecords) {
+  const auto log_directory = UniqueLogDirectory("drop");
+  Options options;
+  options.console = false;
+  options.async = true;
+  options.overflow = OverflowPolicy::kDrop;
+  options.ring_capacity = 4;
+  Initialize("logging_test", log_directory.string(), options);
+
+  const uint64_t dropped_before = DroppedRecords();
+  constexpr int kRecords = 10000;
+  for (int i = 0; i < kRecords; ++i) {
+    LOG(INFO) << "drop record " << i;
+  }
+  Shutdown();
+
+  const uint64_t dropped = DroppedRecords() - dropped_before;
+  const size_t written = CountLines(
+      ReadFile(log_directory / "logging_test.INFO.log"), "drop record ");
+  EXPECT_EQ(written + dropped, kRecords);
+  EXPECT_GE(written, 4);
+
+  std::error_code error;
+  std::filesystem::remove_all(log_directory, error);
+}
+
+int Expensive(int* calls) {
+  ++*calls;
+  return 42;
+}
+
+TEST(LoggingTest, DisabledLevelsSkipArguments) {
+  const auto log_directory = UniqueLogDirectory("gating");
+  Options options;
+  options.console = false;
+  options.min_severity = Severity::kWarning;
+  Initialize("logging_test", log_directory.string(), options);
+
+  int calls = 0;
+  LOG(INFO) << "skipped " << Expensive(&calls);
+  BLOG(INFO, "skipped {}", Expensive(&calls));
+  EXPECT_EQ(calls, 0);
+  LOG(WARNING) << "kept " << Expensive(&calls);
+  EXPECT_EQ(calls, 1);
+
+  SetMinSeverity(Severity::kInfo);
+  LOG(INFO) << "kept " << Expensive(&calls);
+  EXPECT_EQ(calls, 2);
+
+  // Logging switched off by configuration costs a load and a compare.
+  Initialize("logging_test", log_directory.string(), false);
+  LOG(ERROR) << "skipped " << Expensive(&calls);
+  EXPECT_EQ(calls, 2);
+  Shutdown();
+
+  EXPECT_TRUE(IsEnabled(Severity::kInfo));
+  std::error_code error;
+  std::filesystem::remove_all(log_directory, error);
+}
+
+TEST(LoggingTest, BinaryRecordsRoundTrip) {
+  const auto log_directory = UniqueLogDirectory("binary");
+  Options options;
+  options.console = false;
+  options.async = true;
+  options.binary = true;
+  options.overflow = OverflowPolicy::kBlock;
+  Initialize("logging_test", log_directory.string(), options);
+
+  for (int i = 0; i < 100; ++i) {
+    BLOG(INFO, "frame {} of {} bytes", i, static_cast<size_t>(i * 10));
+  }
+  BLOG(WARNING, "closed: {}", std::string("bye"));
+  Shutdown();
+
+  // BLOG records stay out of the text logs.
+  EXPECT_EQ(CountLines(ReadFile(log_directory / "logging_test.INFO.log"),
+                       "frame "),
+            0);
+  const std::string data = ReadFile(log_directory / "logging_test.BIN.log");
+  BinaryLogReader reader(data);
+  ASSERT_TRUE(reader.ReadHeader());
+  BinaryLogReader::Site site;
+  BinaryLogReader::Record record;
+  std::string formats;
+  std::vector<std::string> messages;
+  while (true) {
+    const auto entry = reader.Next(&site, &record);
+    if (entry == BinaryLogReader::Entry::kEnd) {
+      break;
+    }
+    ASSERT_NE(entry, BinaryLogReader::Entry::kCorrupt);
+    if (entry == BinaryLogReader::Entry::kSite) {
+      formats += std::string(site.format) + ";";
+      continue;
+    }
+    std::string message;
+    ASSERT_TRUE(FormatArgs(messages.size() < 100 ? "frame {} of {} bytes"
+                                                 : "closed: {}",
+                           record.args, &message));
+    messages.push_back(message);
+  }
+  EXPECT_EQ(formats, "frame {} of {} bytes;closed: {};");
+  ASSERT_EQ(messages.size(), 101);
+  EXPECT_EQ(messages[7], "frame 7 of 70 bytes");
+  EXPECT_EQ(messages[100], "closed: bye");
+
+  // Without a binary log BLOG writes text.
+  Options text;
+  text.console = false;
+  Initialize("text_test", log_directory.string(), text);
+  BLOG(ERROR, "fallback {}", 1.5);
+  Shutdown();
+  EXPECT_EQ(CountLines(ReadFile(log_directory / "text_test.ERROR.log"),
+                       "fallback 1.5"),
+            1);
+
+  std::error_code error;
+  std::filesystem::remove_all(log_directory, error);
+}
+
 }  // namespace
 }  // namespace logging
 }  // namespace tbox
@@ -0,0 +1,358 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/common/metrics.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#include "src/common/logging.h"
+
+namespace tbox {
+namespace metrics {
+namespace {
+
+void AppendEscaped(std::string_view text, bool quote, std::string* out) {
+  for (const char c : text) {
+    if (c == '\\') {
+      *out += "\\\\";
+    } else if (c == '\n') {
+      *out += "\\n";
+    } else if (c == '"' && quote) {
+      *out += "\\\"";
+    } else {
+      *out += c;
+    }
+  }
+}
+
+std::string RenderLabels(const Labels& labels) {
+  if (labels.empty()) {
+    return {};
+  }
+  std::string out = "{";
+  for (const auto& [name, value] : labels) {
+    if (out.size() > 1) {
+      out += ',';
+    }
+    out += name;
+    out += "=\"";
+    AppendEscaped(value, true, &out);
+    out += '"';
+  }
+  out += '}';
+  return out;
+}
+
+void AppendNumber(double value, std::string* out) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+  *out += buffer;
+}
+
+void AppendSample(std::string_view name, std::string_view labels,
+                  double value, std::string* out) {
+  *out += name;
+  *out += labels;
+  *out += ' ';
+  AppendNumber(value, out);
+  *out += '\n';
+}
+
+// Adds le="bound" to already rendered labels.
+std::string WithBound(const std::string& labels, std::string_view bound) {
+  std::string out = labels.empty() ? "{" : labels.substr(0, labels.size() - 1);
+  if (!labels.empty()) {
+    out += ',';
+  }
+  out += "le=\"";
+  out += bound;
+  out += "\"}";
+  return out;
+}
+
+void AppendHistogram(const std::string& name, const std::string& labels,
+                     const Histogram& histogram, std::string* out) {
+  const Histogram::Snapshot snapshot = histogram.Collect();
+  uint64_t cumulative = 0;
+  size_t next_bucket = 0;
+  for (int exponent = histogram.min_exponent();
+       exponent <= histogram.max_exponent(); ++exponent) {
+    // 2^k starts a bucket: the buckets below it hold exactly the values
+    // below 2^k.
+    const size_t end = Histogram::BucketIndex(uint64_t{1} << exponent);
+    for (; next_bucket < end; ++next_bucket) {
+      cumulative += snapshot.buckets[next_bucket];
+    }
+    std::string bound;
+    AppendNumber(std::ldexp(histogram.scale(), exponent), &bound);
+    AppendSample(name + "_bucket", WithBound(labels, bound),
+                 static_cast<double>(cumulative), out);
+  }
+  AppendSample(name + "_bucket", WithBound(labels, "+Inf"),
+               static_cast<double>(snapshot.count), out);
+  AppendSample(name + "_sum", labels,
+               static_cast<double>(snapshot.sum) * histogram.scale(), out);
+  AppendSample(name + "_count", labels, static_cast<double>(snapshot.count),
+               out);
+}
+
+void AppendProcessMetrics(std::string* out) {
+#if defined(__linux__)
+  long pages = 0;
+  long resident = 0;
+  std::ifstream statm("/proc/self/statm");
+  if (statm >> pages >> resident) {
+    *out +=
+        "# HELP process_resident_memory_bytes Resident memory size in bytes.\n"
+        "# TYPE process_resident_memory_bytes gauge\n";
+    AppendSample("process_resident_memory_bytes", {},
+                 static_cast<double>(resident) * sysconf(_SC_PAGESIZE), out);
+  }
+  std::error_code error;
+  size_t fds = 0;
+  for (std::filesystem::directory_iterator it("/proc/self/fd", error), end;
+       !error && it != end; it.increment(error)) {
+    ++fds;
+  }
+  if (!error) {
+    *out +=
+        "# HELP process_open_fds Number of open file descriptors.\n"
+        "# TYPE process_open_fds gauge\n";
+    AppendSample("process_open_fds", {}, static_cast<double>(fds), out);
+  }
+#else
+  (void)out;
+#endif
+}
+
+}  // namespace
+
+size_t ThisThreadShard() {
+  static std::atomic<size_t> next_shard{0};
+  static thread_local const size_t shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+  return shard;
+}
+
+uint64_t Counter::Value() const {
+  uint64_t value = 0;
+  for (const Shard& shard : shards_) {
+    value += shard.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+double Histogram::Snapshot::Quantile(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+  q = q < 0 ? 0 : (q > 1 ? 1 : q);
+  // The rank of the wanted value, 1 based.
+  uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count) + 0.5);
+  rank = rank == 0 ? 1 : rank;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      const uint64_t lower = BucketLowerBound(i);
+      if (i + 1 == buckets.size()) {
+        return static_cast<double>(lower);
+      }
+      const uint64_t width = BucketLowerBound(i + 1) - lower;
+      return static_cast<double>(lower) +
+             static_cast<double>(width - 1) / 2;
+    }
+  }
+  return static_cast<double>(BucketLowerBound(buckets.size() - 1));
+}
+
+Histogram::Histogram(double scale, int min_exponent, int max_exponent)
+    : scale_(scale),
+      min_exponent_(min_exponent < 0 ? 0 : min_exponent),
+      max_exponent_(max_exponent >= kMaxExponent ? kMaxExponent - 1
+                                                 : max_exponent),
+      shards_(new Shard[kHistogramShards]) {}
+
+uint64_t Histogram::BucketLowerBound(size_t index) {
+  if (index < (size_t{2} << kSubBucketBits)) {
+    return index;
+  }
+  const int exponent = static_cast<int>(index >> kSubBucketBits) +
+                       kSubBucketBits - 1;
+  const uint64_t sub = index & ((size_t{1} << kSubBucketBits) - 1);
+  return ((uint64_t{1} << kSubBucketBits) | sub)
+         << (exponent - kSubBucketBits);
+}
+
+Histogram::Snapshot Histogram::Collect() const {
+  Snapshot snapshot;
+  snapshot.buckets.assign(kBuckets, 0);
+  for (size_t s = 0; s < kHistogramShards; ++s) {
+    const Shard& shard = shards_[s];
+    for (size_t i = 0; i < kBuckets; ++i) {
+      const uint64_t count =
+          shard.buckets[i].load(std::memory_order_relaxed);
+      snapshot.buckets[i] += count;
+      snapshot.count += count;
+    }
+    snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+std::shared_ptr<Registry> Registry::Instance() {
+  static std::shared_ptr<Registry> instance(new Registry());
+  return instance;
+}
+
+const char* Registry::TypeName(Type type) {
+  switch (type) {
+    case Type::kCounter:
+      return "counter";
+    case Type::kGauge:
+      return "gauge";
+    case Type::kHistogram:
+      return "histogram";
+  }
+  return "untyped";
+}
+
+Registry::Series* Registry::FindOrAddLocked(std::string_view name,
+                                            std::string_view help, Type type,
+                                            const Labels& labels) {
+  auto it = families_.find(name);
+  if (it == families_.end()) {
+    it = families_.emplace(std::string(name), Family{type, std::string(help),
+                                                     {}})
+             .first;
+  } else if (it->second.type != type) {
+    LOG(FATAL) << "Metric " << name << " registered as "
+               << TypeName(it->second.type) << " and "
+               << TypeName(type);
+  }
+  std::string rendered = RenderLabels(labels);
+  for (Series& series : it->second.series) {
+    if (series.labels == rendered && !series.callback) {
+      return &series;
+    }
+  }
+  Series& series = it->second.series.emplace_back();
+  series.labels = std::move(rendered);
+  return &series;
+}
+
+Counter* Registry::GetCounter(std::string_view name, std::string_view help,
+                              const Labels& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Series* series = FindOrAddLocked(name, help, Type::kCounter, labels);
+  if (!series->counter) {
+    series->counter = std::make_unique<Counter>();
+  }
+  return series->counter.get();
+}
+
+Gauge* Registry::GetGauge(std::string_view name, std::string_view help,
+                          const Labels& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Series* series = FindOrAddLocked(name, help, Type::kGauge, labels);
+  if (!series->gauge) {
+    series->gauge = std::make_unique<Gauge>();
+  }
+  return series->gauge.get();
+}
+
+Histogram* Registry::GetHistogram(std::string_view name,
+                                  std::string_view help, const Labels& labels,
+                                  double scale, int min_exponent,
+                                  int max_exponent) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Series* series = FindOrAddLocked(name, help, Type::kHistogram, labels);
+  if (!series->histogram) {
+    series->histogram =
+        std::make_unique<Histogram>(scale, min_exponent, max_exponent);
+  }
+  return series->histogram.get();
+}
+
+uint64_t Registry::AddCallbackGauge(std::string_view name,
+                                    std::string_view help,
+                                    const Labels& labels,
+                                    std::function<double()> callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = families_.find(name);
+  if (it == families_.end()) {
+    it = families_
+             .emplace(std::string(name),
+                      Family{Type::kGauge, std::string(help), {}})
+             .first;
+  } else if (it->second.type != Type::kGauge) {
+    LOG(FATAL) << "Metric " << name << " registered as "
+               << TypeName(it->second.type)
+               << " and gauge";
+  }
+  Series& series = it->second.series.emplace_back();
+  series.labels = RenderLabels(labels);
+  series.callback = std::move(callback);
+  series.callback_id = next_callback_id_++;
+  return series.callback_id;
+}
+
+void Registry::RemoveCallbackGauge(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& [name, family] : families_) {
+    for (auto it = family.series.begin(); it != family.series.end(); ++it) {
+      if (it->callback_id == id) {
+        family.series.erase(it);
+        return;
+      }
+    }
+  }
+}
+
+std::string Registry::PrometheusText() const {
+  std::string out;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [name, family] : families_) {
+      if (family.series.empty()) {
+        continue;
+      }
+      out += "# HELP ";
+      out += name;
+      out += ' ';
+      AppendEscaped(family.help, false, &out);
+      out += "\n# TYPE ";
+      out += name;
+      out += ' ';
+      out += TypeName(family.type);
+      out += '\n';
+      for (const Series& series : family.series) {
+        if (series.counter) {
+          AppendSample(name, series.labels,
+                       static_cast<double>(series.counter->Value()), &out);
+        } else if (series.gauge) {
+          AppendSample(name, series.labels,
+                       static_cast<double>(series.gauge->Value()), &out);
+        } else if (series.callback) {
+          AppendSample(name, series.labels, series.callback(), &out);
+        } else if (series.histogram) {
+          AppendHistogram(name, series.labels, *series.histogram, &out);
+        }
+      }
+    }
+  }
+  AppendProcessMetrics(&out);
+  return out;
+}
+
+}  // namespace metrics
+}  // namespace tbox
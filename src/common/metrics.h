@@ -0,0 +1,221 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_COMMON_METRICS_H_
+#define TBOX_COMMON_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tbox {
+namespace metrics {
+
+/// @brief Label names and values of one series, in exposition order.
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+/// @brief Counters and histograms keep this many copies of their cells; a
+///        thread always updates the same copy, so threads rarely share a
+///        cache line.
+inline constexpr size_t kShards = 16;
+
+/// @brief The shard of the calling thread, fixed for its lifetime.
+size_t ThisThreadShard();
+
+/// @brief A monotonically increasing count. Increment() is a relaxed
+///        fetch_add on the caller's shard; Value() sums the shards.
+class Counter final {
+ public:
+  void Increment(uint64_t n = 1) {
+    shards_[ThisThreadShard()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  uint64_t Value() const;
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> value{0};
+  };
+
+  std::array<Shard, kShards> shards_;
+};
+
+/// @brief A value that goes up and down, such as a queue depth.
+class Gauge final {
+ public:
+  void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  void Add(int64_t delta) {
+    value_.fetch_add(delta, std::memory_order_relaxed);
+  }
+
+  int64_t Value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+/// @brief A log-linear (HDR style) histogram of non-negative integers,
+///        usually latencies in nanoseconds.
+/// @details Values below 16 get a bucket each; above that every power of two
+///          is split in 8 buckets, so a bucket is at most 12.5% wide. Values
+///          of 2^48 and more share the last bucket. Record() finds the
+///          bucket with a count-leading-zeros and does two relaxed adds on
+///          the caller's shard, without locks or allocation.
+///
+///          Prometheus gets cumulative buckets at the powers of two between
+///          2^min_exponent and 2^max_exponent. These fall on bucket
+///          boundaries, so the counts are exact, but the bounds are
+///          exclusive: le="2^k" counts values below 2^k, and a value of
+///          exactly 2^k units is counted from the next bound on. Counting it
+///          at 2^k would take in its whole fine bucket, up to 12.5% above
+///          the bound. Quantile() uses the fine buckets.
+class Histogram final {
+ public:
+  static constexpr int kSubBucketBits = 3;
+  static constexpr int kMaxExponent = 48;
+  static constexpr size_t kBuckets =
+      static_cast<size_t>(kMaxExponent - kSubBucketBits + 1)
+      << kSubBucketBits;
+
+  /// @brief Merged bucket counts; values are in recorded units.
+  struct Snapshot {
+    std::vector<uint64_t> buckets;
+    uint64_t count = 0;
+    uint64_t sum = 0;
+
+    /// @brief Estimate of quantile q in [0, 1]: the middle of the bucket
+    ///        holding it, or 0 for an empty histogram.
+    double Quantile(double q) const;
+  };
+
+  /// @param scale Factor from recorded units to exported units, e.g. 1e-9
+  ///        for nanoseconds exported as seconds.
+  /// @param min_exponent, max_exponent Range of exported bucket bounds.
+  explicit Histogram(double scale = 1e-9, int min_exponent = 10,
+                     int max_exponent = 35);
+
+  static size_t BucketIndex(uint64_t value) {
+    if (value < (uint64_t{2} << kSubBucketBits)) {
+      return static_cast<size_t>(value);
+    }
+    const int exponent = 63 - std::countl_zero(value);
+    if (exponent >= kMaxExponent) {
+      return kBuckets - 1;
+    }
+    const uint64_t sub = (value >> (exponent - kSubBucketBits)) &
+                         ((uint64_t{1} << kSubBucketBits) - 1);
+    return (static_cast<size_t>(exponent - kSubBucketBits + 1)
+            << kSubBucketBits) |
+           static_cast<size_t>(sub);
+  }
+
+  /// @brief Smallest value that falls into bucket index.
+  static uint64_t BucketLowerBound(size_t index);
+
+  void Record(uint64_t value) {
+    Shard& shard = shards_[ThisThreadShard() % kHistogramShards];
+    shard.buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  Snapshot Collect() const;
+
+  double scale() const { return scale_; }
+  int min_exponent() const { return min_exponent_; }
+  int max_exponent() const { return max_exponent_; }
+
+ private:
+  // A shard is ~3 KiB, so histograms use fewer copies than counters.
+  static constexpr size_t kHistogramShards = 4;
+
+  struct Shard {
+    std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+    std::atomic<uint64_t> sum{0};
+  };
+
+  const double scale_;
+  const int min_exponent_;
+  const int max_exponent_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+/// @brief Process wide set of named metrics, rendered for Prometheus.
+/// @details The Get*() calls take a lock and are meant for setup: keep the
+///          returned pointer, it stays valid for the life of the process,
+///          and record through it. The same name and labels always return
+///          the same metric. Registering a name twice with different types
+///          is a programming error and aborts.
+class Registry final {
+ public:
+  static std::shared_ptr<Registry> Instance();
+
+  Counter* GetCounter(std::string_view name, std::string_view help,
+                      const Labels& labels = {});
+  Gauge* GetGauge(std::string_view name, std::string_view help,
+                  const Labels& labels = {});
+  /// @brief scale and exponents as for Histogram(); they only apply when
+  ///        the series is created.
+  Histogram* GetHistogram(std::string_view name, std::string_view help,
+                          const Labels& labels = {}, double scale = 1e-9,
+                          int min_exponent = 10, int max_exponent = 35);
+
+  /// @brief A gauge read from callback on each scrape, for values owned
+  ///        elsewhere such as a queue length or a map size. callback runs
+  ///        under the registry lock and must not call back into it.
+  /// @return Id for RemoveCallbackGauge().
+  uint64_t AddCallbackGauge(std::string_view name, std::string_view help,
+                            const Labels& labels,
+                            std::function<double()> callback);
+  /// @brief Must be called before whatever callback reads goes away.
+  void RemoveCallbackGauge(uint64_t id);
+
+  /// @brief Every metric in the Prometheus text exposition format 0.0.4,
+  ///        followed by process_resident_memory_bytes and process_open_fds.
+  std::string PrometheusText() const;
+
+ private:
+  enum class Type { kCounter, kGauge, kHistogram };
+
+  struct Series {
+    std::string labels;  // Rendered, e.g. {method="Login"}; may be empty.
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<Gauge> gauge;
+    std::unique_ptr<Histogram> histogram;
+    std::function<double()> callback;
+    uint64_t callback_id = 0;
+  };
+
+  struct Family {
+    Type type;
+    std::string help;
+    std::vector<Series> series;
+  };
+
+  Registry() = default;
+
+  static const char* TypeName(Type type);
+
+  Series* FindOrAddLocked(std::string_view name, std::string_view help,
+                          Type type, const Labels& labels);
+
+  mutable std::mutex mutex_;
+  std::map<std::string, Family, std::less<>> families_;
+  uint64_t next_callback_id_ = 1;
+};
+
+}  // namespace metrics
+}  // namespace tbox
+
+#endif  // TBOX_COMMON_METRICS_H_
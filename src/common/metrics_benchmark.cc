@@ -0,0 +1,66 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+// Cost of recording on the hot paths:
+//   CounterIncrement: Counter::Increment(), at 1 and 8 threads.
+//   HistogramRecord:  Histogram::Record() of RPC-like latencies, at 1 and 8
+//                     threads.
+//   PrometheusText:   a scrape of 50 histograms and 50 counters.
+//
+//   bazel run -c opt //src/common:metrics_benchmark
+
+#include <cstdint>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "src/common/metrics.h"
+
+namespace tbox {
+namespace metrics {
+namespace {
+
+void BM_CounterIncrement(benchmark::State& state) {
+  static Counter counter;
+  for (auto _ : state) {
+    counter.Increment();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CounterIncrement)->Threads(1)->Threads(8)->UseRealTime();
+
+void BM_HistogramRecord(benchmark::State& state) {
+  static Histogram histogram;
+  uint64_t value = 150000 + state.thread_index();
+  for (auto _ : state) {
+    histogram.Record(value);
+    value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+    value = 50000 + (value >> 44);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HistogramRecord)->Threads(1)->Threads(8)->UseRealTime();
+
+void BM_PrometheusText(benchmark::State& state) {
+  auto registry = Registry::Instance();
+  for (int i = 0; i < 50; ++i) {
+    const std::string method = "Method" + std::to_string(i);
+    registry
+        ->GetHistogram("bench_latency_seconds", "Latency.",
+                       {{"method", method}})
+        ->Record(100000);
+    registry->GetCounter("bench_total", "Count.", {{"method", method}})
+        ->Increment();
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(registry->PrometheusText());
+  }
+}
+BENCHMARK(BM_PrometheusText);
+
+}  // namespace
+}  // namespace metrics
+}  // namespace tbox
+
+BENCHMARK_MAIN();
@@ -0,0 +1,141 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/common/metrics.h"
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace metrics {
+namespace {
+
+TEST(MetricsTest, CounterSumsThreads) {
+  Counter counter;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&counter] {
+      for (int j = 0; j < 10000; ++j) {
+        counter.Increment();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  counter.Increment(5);
+  EXPECT_EQ(counter.Value(), 80005u);
+}
+
+TEST(MetricsTest, HistogramBuckets) {
+  for (uint64_t value = 0; value < 16; ++value) {
+    EXPECT_EQ(Histogram::BucketIndex(value), value);
+  }
+  size_t previous = 0;
+  for (uint64_t value = 16; value < (uint64_t{1} << 20); value += 7) {
+    const size_t index = Histogram::BucketIndex(value);
+    ASSERT_GE(index, previous);
+    ASSERT_LE(Histogram::BucketLowerBound(index), value);
+    ASSERT_GT(Histogram::BucketLowerBound(index + 1), value);
+    // At most 12.5% wide.
+    ASSERT_LE(Histogram::BucketLowerBound(index + 1) -
+                  Histogram::BucketLowerBound(index),
+              Histogram::BucketLowerBound(index) / 8 + 1);
+    previous = index;
+  }
+  for (int exponent = 4; exponent < Histogram::kMaxExponent; ++exponent) {
+    const uint64_t power = uint64_t{1} << exponent;
+    EXPECT_EQ(Histogram::BucketLowerBound(Histogram::BucketIndex(power)),
+              power);
+  }
+  EXPECT_EQ(Histogram::BucketIndex(UINT64_MAX), Histogram::kBuckets - 1);
+}
+
+TEST(MetricsTest, HistogramQuantiles) {
+  Histogram histogram;
+  for (uint64_t value = 1; value <= 10000; ++value) {
+    histogram.Record(value * 1000);
+  }
+  const Histogram::Snapshot snapshot = histogram.Collect();
+  EXPECT_EQ(snapshot.count, 10000u);
+  EXPECT_EQ(snapshot.sum, uint64_t{1000} * 10000 * 10001 / 2);
+  EXPECT_NEAR(snapshot.Quantile(0.5), 5e6, 5e6 * 0.125);
+  EXPECT_NEAR(snapshot.Quantile(0.99), 9.9e6, 9.9e6 * 0.125);
+  EXPECT_NEAR(snapshot.Quantile(0.999), 9.99e6, 9.99e6 * 0.125);
+  EXPECT_EQ(Histogram::Snapshot().Quantile(0.5), 0);
+}
+
+TEST(MetricsTest, RegistryReturnsTheSameSeries) {
+  auto registry = Registry::Instance();
+  Counter* a = registry->GetCounter("test_same_total", "Help.",
+                                    {{"method", "Login"}});
+  Counter* b = registry->GetCounter("test_same_total", "Help.",
+                                    {{"method", "Login"}});
+  Counter* c = registry->GetCounter("test_same_total", "Help.",
+                                    {{"method", "Logout"}});
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+}
+
+TEST(MetricsTest, HistogramBoundsAreExclusive) {
+  Histogram* histogram = Registry::Instance()->GetHistogram(
+      "test_bound_seconds", "Bounds.", {}, 1e-9, 10, 11);
+  histogram->Record(1023);
+  histogram->Record(1024);
+  const std::string text = Registry::Instance()->PrometheusText();
+  EXPECT_NE(text.find("test_bound_seconds_bucket{le=\"1.024e-06\"} 1\n"
+                      "test_bound_seconds_bucket{le=\"2.048e-06\"} 2\n"),
+            std::string::npos);
+}
+
+TEST(MetricsTest, PrometheusText) {
+  auto registry = Registry::Instance();
+  registry->GetCounter("test_requests_total", "Requests \\ served.",
+                       {{"path", "/a\"b"}})
+      ->Increment(3);
+  registry->GetGauge("test_depth", "Queue depth.")->Set(-2);
+  Histogram* latency = registry->GetHistogram(
+      "test_latency_seconds", "Latency.", {{"method", "Get"}}, 1e-9, 10, 12);
+  latency->Record(1000);
+  latency->Record(3000);
+  latency->Record(1000000);
+  const uint64_t id = registry->AddCallbackGauge(
+      "test_callback", "From a callback.", {}, [] { return 42.5; });
+
+  std::string text = registry->PrometheusText();
+  EXPECT_NE(text.find("# HELP test_requests_total Requests \\\\ served.\n"
+                      "# TYPE test_requests_total counter\n"
+                      "test_requests_total{path=\"/a\\\"b\"} 3\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("# TYPE test_depth gauge\ntest_depth -2\n"),
+            std::string::npos);
+  EXPECT_NE(
+      text.find(
+          "# TYPE test_latency_seconds histogram\n"
+          "test_latency_seconds_bucket{method=\"Get\",le=\"1.024e-06\"} 1\n"
+          "test_latency_seconds_bucket{method=\"Get\",le=\"2.048e-06\"} 1\n"
+          "test_latency_seconds_bucket{method=\"Get\",le=\"4.096e-06\"} 2\n"
+          "test_latency_seconds_bucket{method=\"Get\",le=\"+Inf\"} 3\n"
+          "test_latency_seconds_sum{method=\"Get\"} 0.001004\n"
+          "test_latency_seconds_count{method=\"Get\"} 3\n"),
+      std::string::npos);
+  EXPECT_NE(text.find("test_callback 42.5\n"), std::string::npos);
+#if defined(__linux__)
+  EXPECT_NE(text.find("\nprocess_resident_memory_bytes "), std::string::npos);
+  EXPECT_NE(text.find("\nprocess_open_fds "), std::string::npos);
+#endif
+
+  registry->RemoveCallbackGauge(id);
+  text = registry->PrometheusText();
+  EXPECT_EQ(text.find("test_callback"), std::string::npos);
+}
+
+}  // namespace
+}  // namespace metrics
+}  // namespace tbox
@@ -0,0 +1,746 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/common/profiler.h"
+
+#if defined(__linux__)
+#include <signal.h>
+#include <sys/time.h>
+
+#include <cerrno>
+#define UNW_LOCAL_ONLY
+#include "libunwind.h"
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include "src/common/logging.h"
+#include "src/proto/profile.pb.h"
+#include "zlib.h"
+
+namespace tbox {
+namespace profiler {
+
+namespace {
+
+struct Mapping {
+  uint64_t start;
+  uint64_t limit;
+  uint64_t offset;
+  std::string file;
+};
+
+// Executable mappings of this process, in address order.
+std::vector<Mapping> ExecutableMappings() {
+  std::vector<Mapping> mappings;
+#if defined(__linux__)
+  FILE* maps = std::fopen("/proc/self/maps", "r");
+  if (maps == nullptr) {
+    return mappings;
+  }
+  char line[4096];
+  while (std::fgets(line, sizeof(line), maps) != nullptr) {
+    unsigned long long start = 0;  // NOLINT(runtime/int)
+    unsigned long long limit = 0;  // NOLINT(runtime/int)
+    unsigned long long offset = 0;  // NOLINT(runtime/int)
+    char perms[8] = {};
+    int path = 0;
+    if (std::sscanf(line, "%llx-%llx %7s %llx %*s %*s %n", &start, &limit,
+                    perms, &offset, &path) < 4 ||
+        perms[2] != 'x') {
+      continue;
+    }
+    std::string file = path > 0 ? line + path : "";
+    while (!file.empty() && (file.back() == '\n' || file.back() == ' ')) {
+      file.pop_back();
+    }
+    mappings.push_back({start, limit, offset, std::move(file)});
+  }
+  std::fclose(maps);
+#endif
+  return mappings;
+}
+
+std::string Gzip(const std::string& data) {
+  z_stream stream{};
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16,
+                   8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return "";
+  }
+  std::string out(deflateBound(&stream, data.size()), '\0');
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = reinterpret_cast<Bytef*>(out.data());
+  stream.avail_out = static_cast<uInt>(out.size());
+  const int rc = deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  return rc == Z_STREAM_END ? out : "";
+}
+
+int64_t NowUnixNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+ProfileBuilder::ProfileBuilder(std::vector<ValueType> sample_types)
+    : sample_types_(std::move(sample_types)) {}
+
+void ProfileBuilder::SetPeriod(ValueType period_type, int64_t period) {
+  period_type_ = std::move(period_type);
+  period_ = period;
+}
+
+void ProfileBuilder::SetTime(int64_t time_nanos, int64_t duration_nanos) {
+  time_nanos_ = time_nanos;
+  duration_nanos_ = duration_nanos;
+}
+
+void ProfileBuilder::AddSample(const uint64_t* stack, size_t depth,
+                               const int64_t* values) {
+  auto [it, inserted] = samples_.try_emplace(
+      std::vector<uint64_t>(stack, stack + depth), sample_types_.size(), 0);
+  for (size_t i = 0; i < sample_types_.size(); ++i) {
+    it->second[i] += values[i];
+  }
+}
+
+std::string ProfileBuilder::Build(const Symbolizer& symbolizer) const {
+  perftools::profiles::Profile profile;
+  std::unordered_map<std::string, int64_t> strings;
+  auto intern = [&profile, &strings](const std::string& s) {
+    auto [it, inserted] = strings.try_emplace(s, strings.size());
+    if (inserted) {
+      profile.add_string_table(s);
+    }
+    return it->second;
+  };
+  intern("");
+
+  for (const auto& type : sample_types_) {
+    auto* value_type = profile.add_sample_type();
+    value_type->set_type(intern(type.type));
+    value_type->set_unit(intern(type.unit));
+  }
+  if (!period_type_.type.empty()) {
+    profile.mutable_period_type()->set_type(intern(period_type_.type));
+    profile.mutable_period_type()->set_unit(intern(period_type_.unit));
+  }
+  profile.set_period(period_);
+  profile.set_time_nanos(time_nanos_);
+  profile.set_duration_nanos(duration_nanos_);
+
+  const std::vector<Mapping> mappings = ExecutableMappings();
+  for (size_t i = 0; i < mappings.size(); ++i) {
+    auto* mapping = profile.add_mapping();
+    mapping->set_id(i + 1);
+    mapping->set_memory_start(mappings[i].start);
+    mapping->set_memory_limit(mappings[i].limit);
+    mapping->set_file_offset(mappings[i].offset);
+    mapping->set_filename(intern(mappings[i].file));
+    // Tells pprof not to symbolize again.
+    mapping->set_has_functions(symbolizer != nullptr);
+    mapping->set_has_filenames(symbolizer != nullptr);
+    mapping->set_has_line_numbers(symbolizer != nullptr);
+  }
+
+  std::unordered_map<uint64_t, uint64_t> location_ids;
+  std::vector<uint64_t> addresses;
+  for (const auto& [stack, values] : samples_) {
+    for (const uint64_t address : stack) {
+      if (location_ids.try_emplace(address, addresses.size() + 1).second) {
+        addresses.push_back(address);
+      }
+    }
+  }
+  std::vector<Frame> frames(addresses.size());
+  if (symbolizer) {
+    symbolizer(addresses, &frames);
+  }
+
+  std::map<std::pair<std::string, std::string>, uint64_t> function_ids;
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    auto* location = profile.add_location();
+    location->set_id(i + 1);
+    location->set_address(addresses[i]);
+    auto mapping = std::upper_bound(
+        mappings.begin(), mappings.end(), addresses[i],
+        [](uint64_t address, const Mapping& m) { return address < m.start; });
+    if (mapping != mappings.begin() && addresses[i] < (mapping - 1)->limit) {
+      location->set_mapping_id(mapping - mappings.begin());
+    }
+    const Frame& frame = frames[i];
+    if (frame.function.empty()) {
+      continue;
+    }
+    auto [function, inserted] = function_ids.try_emplace(
+        std::make_pair(frame.function, frame.file), function_ids.size() + 1);
+    if (inserted) {
+      auto* entry = profile.add_function();
+      entry->set_id(function->second);
+      entry->set_name(intern(frame.function));
+      entry->set_system_name(entry->name());
+      entry->set_filename(intern(frame.file));
+    }
+    auto* line = location->add_line();
+    line->set_function_id(function->second);
+    line->set_line(frame.line);
+  }
+
+  for (const auto& [stack, values] : samples_) {
+    auto* sample = profile.add_sample();
+    for (const uint64_t address : stack) {
+      sample->add_location_id(location_ids[address]);
+    }
+    for (const int64_t value : values) {
+      sample->add_value(value);
+    }
+  }
+  return Gzip(profile.SerializeAsString());
+}
+
+#if defined(__linux__)
+namespace {
+
+// Walks the stack from cursor, leaf first. Frames after the first hold
+// return addresses, which are moved back into the call instruction.
+int Unwind(unw_cursor_t* cursor, int skip, uint64_t* stack, int max_depth) {
+  int depth = 0;
+  int frame = 0;
+  do {
+    unw_word_t ip = 0;
+    if (unw_get_reg(cursor, UNW_REG_IP, &ip) < 0 || ip == 0) {
+      break;
+    }
+    if (frame >= skip) {
+      stack[depth++] = frame == 0 ? ip : ip - 1;
+    }
+    ++frame;
+  } while (depth < max_depth && unw_step(cursor) > 0);
+  return depth;
+}
+
+// Stacks of one CPU profile, as [depth, address...] records.
+struct CpuSamples {
+  std::unique_ptr<uint64_t[]> words;
+  size_t capacity = 0;
+  std::atomic<size_t> used{0};
+  std::atomic<uint64_t> dropped{0};
+};
+
+std::atomic<CpuSamples*> cpu_samples{nullptr};
+// Handlers between reading cpu_samples and their last write to it.
+std::atomic<int> cpu_handlers{0};
+
+void OnSigprof(int /*signo*/, siginfo_t* /*info*/, void* ucontext) {
+  const int saved_errno = errno;
+  cpu_handlers.fetch_add(1);
+  CpuSamples* samples = cpu_samples.load();
+  if (samples != nullptr) {
+    uint64_t stack[CpuProfiler::kMaxDepth];
+    unw_cursor_t cursor;
+    int depth = 0;
+    if (unw_init_local2(&cursor, static_cast<unw_context_t*>(ucontext),
+                        UNW_INIT_SIGNAL_FRAME) == 0) {
+      depth = Unwind(&cursor, 0, stack, CpuProfiler::kMaxDepth);
+    }
+    if (depth > 0) {
+      const size_t size = static_cast<size_t>(depth) + 1;
+      const size_t start =
+          samples->used.fetch_add(size, std::memory_order_relaxed);
+      if (start + size <= samples->capacity) {
+        samples->words[start] = static_cast<uint64_t>(depth);
+        std::memcpy(&samples->words[start + 1], stack,
+                    sizeof(uint64_t) * depth);
+      } else {
+        samples->dropped.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+  cpu_handlers.fetch_sub(1);
+  errno = saved_errno;
+}
+
+}  // namespace
+#endif
+
+std::shared_ptr<CpuProfiler> CpuProfiler::Instance() {
+  static std::shared_ptr<CpuProfiler> instance(new CpuProfiler());
+  return instance;
+}
+
+bool CpuProfiler::Supported() {
+#if defined(__linux__)
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool CpuProfiler::Collect(std::chrono::milliseconds duration, int hz,
+                          ProfileBuilder* builder) {
+#if defined(__linux__)
+  if (running_.exchange(true)) {
+    return false;
+  }
+  hz = std::clamp(hz, 1, kMaxHz);
+  static std::once_flag install;
+  std::call_once(install, [] {
+    unw_set_caching_policy(unw_local_addr_space, UNW_CACHE_PER_THREAD);
+    // Stays installed: a SIGPROF still in flight after the timer is
+    // disarmed would otherwise kill the process.
+    struct sigaction action = {};
+    action.sa_sigaction = OnSigprof;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, nullptr) != 0) {
+      LOG(ERROR) << "Cannot install the SIGPROF handler: "
+                 << std::strerror(errno);
+    }
+  });
+
+  // Every core can take hz samples a second, of half the maximum depth on
+  // average.
+  CpuSamples samples;
+  const uint64_t expected =
+      static_cast<uint64_t>(hz) * (duration.count() / 1000 + 1) *
+      std::max(1u, std::thread::hardware_concurrency()) * (kMaxDepth / 2 + 1);
+  samples.capacity = static_cast<size_t>(
+      std::clamp<uint64_t>(expected, uint64_t{1} << 16, uint64_t{1} << 22));
+  samples.words.reset(new uint64_t[samples.capacity]());
+  cpu_samples.store(&samples);
+
+  const int64_t period_micros = 1000000 / hz;
+  itimerval timer = {};
+  timer.it_interval.tv_sec = period_micros / 1000000;
+  timer.it_interval.tv_usec = period_micros % 1000000;
+  timer.it_value = timer.it_interval;
+  const int64_t start = NowUnixNanos();
+  setitimer(ITIMER_PROF, &timer, nullptr);
+  {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    stop_cv_.wait_for(lock, duration, [this] { return stop_; });
+  }
+  const itimerval off = {};
+  setitimer(ITIMER_PROF, &off, nullptr);
+  const int64_t end = NowUnixNanos();
+  cpu_samples.store(nullptr);
+  while (cpu_handlers.load() != 0) {
+    std::this_thread::yield();
+  }
+
+  const int64_t period = period_micros * 1000;
+  *builder = ProfileBuilder({{"samples", "count"}, {"cpu", "nanoseconds"}});
+  builder->SetPeriod({"cpu", "nanoseconds"}, period);
+  builder->SetTime(start, end - start);
+  const size_t used = std::min(samples.used.load(), samples.capacity);
+  const int64_t values[] = {1, period};
+  for (size_t pos = 0; pos < used;) {
+    const size_t depth = samples.words[pos];
+    if (depth == 0 || pos + 1 + depth > used) {
+      break;
+    }
+    builder->AddSample(&samples.words[pos + 1], depth, values);
+    pos += 1 + depth;
+  }
+  dropped_ = samples.dropped.load();
+  if (dropped_ > 0) {
+    LOG(WARNING) << "CPU profile dropped " << dropped_ << " samples";
+  }
+  // Together, so that a Stop() racing with the end of this profile cannot
+  // cut the next one short.
+  std::lock_guard<std::mutex> lock(stop_mutex_);
+  stop_ = false;
+  running_.store(false);
+  return true;
+#else
+  (void)duration;
+  (void)hz;
+  (void)builder;
+  return false;
+#endif
+}
+
+void CpuProfiler::Stop() {
+  std::lock_guard<std::mutex> lock(stop_mutex_);
+  if (running_.load()) {
+    stop_ = true;
+    stop_cv_.notify_all();
+  }
+}
+
+namespace {
+
+std::atomic<int64_t> heap_interval{0};
+// Sampled blocks not freed yet, and the same per address hash: a free
+// only looks a block up when its hint is set.
+std::atomic<int64_t> heap_live{0};
+constexpr int kHeapHintBits = 16;
+std::array<std::atomic<uint32_t>, size_t{1} << kHeapHintBits> heap_hints;
+
+size_t HeapHint(const void* ptr) {
+  return static_cast<size_t>((reinterpret_cast<uintptr_t>(ptr) >> 4) *
+                                 0x9e3779b97f4a7c15ULL >>
+                             (64 - kHeapHintBits));
+}
+
+#if defined(__linux__)
+struct HeapThreadState {
+  int64_t until;  // Bytes left before the next sample.
+  uint64_t random;
+  bool armed;  // until has been drawn.
+  bool busy;   // Inside the profiler; allocations are not sampled.
+};
+
+// initial-exec: the general dynamic model may allocate on first access.
+thread_local HeapThreadState heap_thread
+    __attribute__((tls_model("initial-exec")));
+
+int64_t NextSampleDistance(HeapThreadState* state, int64_t interval) {
+  if (state->random == 0) {
+    state->random = reinterpret_cast<uintptr_t>(state) * 0x9e3779b97f4a7c15ULL;
+    state->random |= 1;
+  }
+  state->random ^= state->random << 13;
+  state->random ^= state->random >> 7;
+  state->random ^= state->random << 17;
+  const double uniform = static_cast<double>((state->random >> 11) + 1) *
+                         0x1.0p-53;  // (0, 1]
+  return static_cast<int64_t>(-std::log(uniform) * interval) + 1;
+}
+
+// The interval to sample an allocation of size at, or 0 to skip it.
+inline int64_t SampleInterval(size_t size) {
+  const int64_t interval = heap_interval.load(std::memory_order_relaxed);
+  if (interval == 0) [[likely]] {
+    return 0;
+  }
+  HeapThreadState& state = heap_thread;
+  if (state.busy) {
+    return 0;
+  }
+  state.until -= static_cast<int64_t>(size);
+  if (state.until > 0) [[likely]] {
+    return 0;
+  }
+  const bool sample = state.armed;
+  state.armed = true;
+  state.until = NextSampleDistance(&state, interval);
+  return sample ? interval : 0;
+}
+
+// Inlined into the hooks so that the stack of a sample always starts with
+// RecordAllocation() and the hook.
+__attribute__((always_inline)) inline void* AfterAlloc(void* ptr,
+                                                        size_t size) {
+  if (ptr != nullptr) {
+    const int64_t interval = SampleInterval(size);
+    if (interval != 0) [[unlikely]] {
+      HeapProfiler::Instance()->RecordAllocation(ptr, size, interval);
+    }
+  }
+  return ptr;
+}
+
+inline void BeforeFree(void* ptr) {
+  if (ptr == nullptr || heap_live.load(std::memory_order_relaxed) == 0)
+      [[likely]] {
+    return;
+  }
+  if (heap_hints[HeapHint(ptr)].load(std::memory_order_relaxed) == 0 ||
+      heap_thread.busy) {
+    return;
+  }
+  HeapProfiler::Instance()->RecordFree(ptr);
+}
+
+class ScopedBusy {
+ public:
+  ScopedBusy() { heap_thread.busy = true; }
+  ~ScopedBusy() { heap_thread.busy = false; }
+};
+#else
+class ScopedBusy {
+ public:
+  ScopedBusy() {}
+};
+#endif
+
+}  // namespace
+
+std::shared_ptr<HeapProfiler> HeapProfiler::Instance() {
+  // Never destroyed: blocks are still freed after static destructors ran.
+  static auto* instance =
+      new std::shared_ptr<HeapProfiler>(new HeapProfiler());
+  return *instance;
+}
+
+bool HeapProfiler::Supported() {
+#if defined(__linux__)
+  return true;
+#else
+  return false;
+#endif
+}
+
+void HeapProfiler::SetSampleInterval(int64_t interval) {
+  if (Supported()) {
+    heap_interval.store(std::max<int64_t>(interval, 0));
+  }
+}
+
+int64_t HeapProfiler::sample_interval() const { return heap_interval.load(); }
+
+#if defined(__linux__)
+__attribute__((noinline))
+#endif
+void HeapProfiler::RecordAllocation(void* ptr, size_t size,
+                                    int64_t interval) {
+#if defined(__linux__)
+  ScopedBusy busy;
+  // Frames 0 and 1 are this function and the allocation hook.
+  uint64_t stack[CpuProfiler::kMaxDepth];
+  unw_context_t context;
+  unw_cursor_t cursor;
+  int depth = 0;
+  if (unw_getcontext(&context) == 0 &&
+      unw_init_local(&cursor, &context) == 0) {
+    depth = Unwind(&cursor, 2, stack, CpuProfiler::kMaxDepth);
+  }
+  const double probability =
+      -std::expm1(-static_cast<double>(size) / static_cast<double>(interval));
+  const Block block{nullptr, 1 / probability, size / probability};
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  StackStats& stats = stacks_[std::vector<uint64_t>(stack, stack + depth)];
+  stats.alloc_objects += block.objects;
+  stats.alloc_bytes += block.bytes;
+  stats.inuse_objects += block.objects;
+  stats.inuse_bytes += block.bytes;
+  auto [it, inserted] = live_.try_emplace(ptr, block);
+  if (!inserted) {
+    // The old block was freed where the hooks did not see it.
+    it->second.stats->inuse_objects -= it->second.objects;
+    it->second.stats->inuse_bytes -= it->second.bytes;
+    it->second = block;
+  } else {
+    heap_hints[HeapHint(ptr)].fetch_add(1, std::memory_order_relaxed);
+    heap_live.fetch_add(1, std::memory_order_relaxed);
+  }
+  it->second.stats = &stats;
+#else
+  (void)ptr;
+  (void)size;
+  (void)interval;
+#endif
+}
+
+void HeapProfiler::RecordFree(void* ptr) {
+  ScopedBusy busy;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = live_.find(ptr);
+  if (it == live_.end()) {
+    return;
+  }
+  it->second.stats->inuse_objects -= it->second.objects;
+  it->second.stats->inuse_bytes -= it->second.bytes;
+  live_.erase(it);
+  heap_hints[HeapHint(ptr)].fetch_sub(1, std::memory_order_relaxed);
+  heap_live.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void HeapProfiler::Collect(ProfileBuilder* builder) {
+  std::vector<std::pair<std::vector<uint64_t>, StackStats>> stacks;
+  {
+    ScopedBusy busy;
+    std::lock_guard<std::mutex> lock(mutex_);
+    stacks.assign(stacks_.begin(), stacks_.end());
+  }
+  *builder = ProfileBuilder({{"alloc_objects", "count"},
+                             {"alloc_space", "bytes"},
+                             {"inuse_objects", "count"},
+                             {"inuse_space", "bytes"}});
+  builder->SetPeriod({"space", "bytes"}, sample_interval());
+  builder->SetTime(NowUnixNanos(), 0);
+  for (const auto& [stack, stats] : stacks) {
+    const int64_t values[] = {std::llround(stats.alloc_objects),
+                              std::llround(stats.alloc_bytes),
+                              std::llround(stats.inuse_objects),
+                              std::llround(stats.inuse_bytes)};
+    builder->AddSample(stack.data(), stack.size(), values);
+  }
+}
+
+}  // namespace profiler
+}  // namespace tbox
+
+#if defined(__linux__)
+// Targets of the -Wl,--wrap linker options set by the profiler library:
+// every call to X from code linked into the binary reaches __wrap_X, and
+// __real_X is the allocator's own X. The nothrow operator delete overloads
+// only run when a constructor throws and are left alone.
+using tbox::profiler::AfterAlloc;
+using tbox::profiler::BeforeFree;
+
+extern "C" {
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+int __real_posix_memalign(void** ptr, size_t alignment, size_t size);
+void* __real_aligned_alloc(size_t alignment, size_t size);
+void* __real_memalign(size_t alignment, size_t size);
+void* __real__Znwm(size_t size);
+void* __real__Znam(size_t size);
+void* __real__ZnwmRKSt9nothrow_t(size_t size, const std::nothrow_t& tag);
+void* __real__ZnamRKSt9nothrow_t(size_t size, const std::nothrow_t& tag);
+void* __real__ZnwmSt11align_val_t(size_t size, std::align_val_t alignment);
+void* __real__ZnamSt11align_val_t(size_t size, std::align_val_t alignment);
+void* __real__ZnwmSt11align_val_tRKSt9nothrow_t(size_t size,
+                                                std::align_val_t alignment,
+                                                const std::nothrow_t& tag);
+void* __real__ZnamSt11align_val_tRKSt9nothrow_t(size_t size,
+                                                std::align_val_t alignment,
+                                                const std::nothrow_t& tag);
+void __real__ZdlPv(void* ptr);
+void __real__ZdaPv(void* ptr);
+void __real__ZdlPvm(void* ptr, size_t size);
+void __real__ZdaPvm(void* ptr, size_t size);
+void __real__ZdlPvSt11align_val_t(void* ptr, std::align_val_t alignment);
+void __real__ZdaPvSt11align_val_t(void* ptr, std::align_val_t alignment);
+void __real__ZdlPvmSt11align_val_t(void* ptr, size_t size,
+                                   std::align_val_t alignment);
+void __real__ZdaPvmSt11align_val_t(void* ptr, size_t size,
+                                   std::align_val_t alignment);
+
+void* __wrap_malloc(size_t size) {
+  return AfterAlloc(__real_malloc(size), size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  return AfterAlloc(__real_calloc(count, size), count * size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  BeforeFree(ptr);
+  return AfterAlloc(__real_realloc(ptr, size), size);
+}
+
+void __wrap_free(void* ptr) {
+  BeforeFree(ptr);
+  __real_free(ptr);
+}
+
+int __wrap_posix_memalign(void** ptr, size_t alignment, size_t size) {
+  const int rc = __real_posix_memalign(ptr, alignment, size);
+  if (rc == 0) {
+    AfterAlloc(*ptr, size);
+  }
+  return rc;
+}
+
+void* __wrap_aligned_alloc(size_t alignment, size_t size) {
+  return AfterAlloc(__real_aligned_alloc(alignment, size), size);
+}
+
+void* __wrap_memalign(size_t alignment, size_t size) {
+  return AfterAlloc(__real_memalign(alignment, size), size);
+}
+
+void* __wrap__Znwm(size_t size) {
+  return AfterAlloc(__real__Znwm(size), size);
+}
+
+void* __wrap__Znam(size_t size) {
+  return AfterAlloc(__real__Znam(size), size);
+}
+
+void* __wrap__ZnwmRKSt9nothrow_t(size_t size, const std::nothrow_t& tag) {
+  return AfterAlloc(__real__ZnwmRKSt9nothrow_t(size, tag), size);
+}
+
+void* __wrap__ZnamRKSt9nothrow_t(size_t size, const std::nothrow_t& tag) {
+  return AfterAlloc(__real__ZnamRKSt9nothrow_t(size, tag), size);
+}
+
+void* __wrap__ZnwmSt11align_val_t(size_t size, std::align_val_t alignment) {
+  return AfterAlloc(__real__ZnwmSt11align_val_t(size, alignment), size);
+}
+
+void* __wrap__ZnamSt11align_val_t(size_t size, std::align_val_t alignment) {
+  return AfterAlloc(__real__ZnamSt11align_val_t(size, alignment), size);
+}
+
+void* __wrap__ZnwmSt11align_val_tRKSt9nothrow_t(size_t size,
+                                                std::align_val_t alignment,
+                                                const std::nothrow_t& tag) {
+  return AfterAlloc(
+      __real__ZnwmSt11align_val_tRKSt9nothrow_t(size, alignment, tag), size);
+}
+
+void* __wrap__ZnamSt11align_val_tRKSt9nothrow_t(size_t size,
+                                                std::align_val_t alignment,
+                                                const std::nothrow_t& tag) {
+  return AfterAlloc(
+      __real__ZnamSt11align_val_tRKSt9nothrow_t(size, alignment, tag), size);
+}
+
+void __wrap__ZdlPv(void* ptr) {
+  BeforeFree(ptr);
+  __real__ZdlPv(ptr);
+}
+
+void __wrap__ZdaPv(void* ptr) {
+  BeforeFree(ptr);
+  __real__ZdaPv(ptr);
+}
+
+void __wrap__ZdlPvm(void* ptr, size_t size) {
+  BeforeFree(ptr);
+  __real__ZdlPvm(ptr, size);
+}
+
+void __wrap__ZdaPvm(void* ptr, size_t size) {
+  BeforeFree(ptr);
+  __real__ZdaPvm(ptr, size);
+}
+
+void __wrap__ZdlPvSt11align_val_t(void* ptr, std::align_val_t alignment) {
+  BeforeFree(ptr);
+  __real__ZdlPvSt11align_val_t(ptr, alignment);
+}
+
+void __wrap__ZdaPvSt11align_val_t(void* ptr, std::align_val_t alignment) {
+  BeforeFree(ptr);
+  __real__ZdaPvSt11align_val_t(ptr, alignment);
+}
+
+void __wrap__ZdlPvmSt11align_val_t(void* ptr, size_t size,
+                                   std::align_val_t alignment) {
+  BeforeFree(ptr);
+  __real__ZdlPvmSt11align_val_t(ptr, size, alignment);
+}
+
+void __wrap__ZdaPvmSt11align_val_t(void* ptr, size_t size,
+                                   std::align_val_t alignment) {
+  BeforeFree(ptr);
+  __real__ZdaPvmSt11align_val_t(ptr, size, alignment);
+}
+
+}  // extern "C"
+#endif
@@ -0,0 +1,191 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_COMMON_PROFILER_H_
+#define TBOX_COMMON_PROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tbox {
+namespace profiler {
+
+/// @brief Function, source file and line of one code address; empty and 0
+///        when unknown.
+struct Frame {
+  std::string function;
+  std::string file;
+  int64_t line = 0;
+};
+
+/// @brief Resolves addresses to frames. frames arrives with one default
+///        entry per address.
+using Symbolizer = std::function<void(const std::vector<uint64_t>& addresses,
+                                      std::vector<Frame>* frames)>;
+
+/// @brief Stack samples, encoded as a gzipped perftools.profiles.Profile,
+///        the format `pprof` reads.
+/// @details Stacks are leaf first; callers are return addresses minus one,
+///          so they point into the call instruction. Samples with the same
+///          stack are merged by adding their values. Build() records the
+///          executable mappings of /proc/self/maps, which lets
+///          `pprof <binary> <profile>` symbolize offline, and fills in
+///          function names and lines itself when given a symbolizer.
+class ProfileBuilder final {
+ public:
+  struct ValueType {
+    std::string type;
+    std::string unit;
+  };
+
+  /// @param sample_types Meaning of each sample value, e.g. {samples,
+  ///        count} and {cpu, nanoseconds}. pprof shows the last by default.
+  explicit ProfileBuilder(std::vector<ValueType> sample_types);
+
+  void SetPeriod(ValueType period_type, int64_t period);
+  void SetTime(int64_t time_nanos, int64_t duration_nanos);
+
+  /// @param values One per sample type.
+  void AddSample(const uint64_t* stack, size_t depth, const int64_t* values);
+
+  /// @brief Number of distinct stacks.
+  size_t size() const { return samples_.size(); }
+
+  /// @brief The gzipped profile.
+  std::string Build(const Symbolizer& symbolizer = nullptr) const;
+
+ private:
+  std::vector<ValueType> sample_types_;
+  ValueType period_type_;
+  int64_t period_ = 0;
+  int64_t time_nanos_ = 0;
+  int64_t duration_nanos_ = 0;
+  std::map<std::vector<uint64_t>, std::vector<int64_t>> samples_;
+};
+
+/// @brief Statistical CPU profiler for the whole process.
+/// @details Collect() arms ITIMER_PROF at hz. The kernel sends SIGPROF to
+///          a thread that is using CPU, and the handler unwinds it with
+///          libunwind straight from the signal context, then appends the
+///          stack to a buffer allocated for the run. Space is reserved with
+///          one fetch_add, so the handler neither locks nor allocates;
+///          stacks that no longer fit are counted as dropped. One profile
+///          runs at a time. Linux only.
+class CpuProfiler final {
+ public:
+  static constexpr int kDefaultHz = 100;
+  static constexpr int kMaxHz = 1000;
+  static constexpr int kMaxDepth = 64;
+
+  static std::shared_ptr<CpuProfiler> Instance();
+
+  /// @brief True where SIGPROF sampling exists, i.e. on Linux.
+  static bool Supported();
+
+  /// @brief Samples for duration at hz, blocking the caller, and replaces
+  ///        builder with the stacks as {samples, count} and
+  ///        {cpu, nanoseconds}.
+  /// @return False if another profile is running or profiling is not
+  ///         supported on this platform.
+  bool Collect(std::chrono::milliseconds duration, int hz,
+               ProfileBuilder* builder);
+
+  /// @brief Whether a Collect() is in progress.
+  bool running() const { return running_.load(); }
+
+  /// @brief Ends a running Collect() early, with the samples taken so far;
+  ///        does nothing when no profile runs.
+  void Stop();
+
+  /// @brief Stacks lost to a full buffer in the last profile.
+  uint64_t dropped() const { return dropped_; }
+
+ private:
+  CpuProfiler() = default;
+
+  std::atomic<bool> running_{false};
+  uint64_t dropped_ = 0;
+  std::mutex stop_mutex_;
+  std::condition_variable stop_cv_;
+  bool stop_ = false;
+};
+
+/// @brief Sampling heap profiler.
+/// @details The allocation functions are redirected here at link time
+///          (`-Wl,--wrap` for malloc, calloc, realloc, free, the aligned
+///          allocators and the global operator new and delete), since
+///          mimalloc has no sampling hook of its own. Each thread samples
+///          one allocation per sample_interval bytes on average, at
+///          exponentially distributed distances as tcmalloc does: an
+///          allocation of s bytes is picked with probability
+///          1 - exp(-s / interval), and samples are scaled back by its
+///          inverse. A sampled block keeps its stack until it is freed.
+///
+///          With sampling off, which is the default, an allocation costs
+///          one relaxed load more. With it on, an unsampled allocation
+///          costs a thread local countdown, and a free one load of a per
+///          address hint while any sampled block is live.
+///
+///          Only calls from code linked into the binary are seen;
+///          allocations made inside shared libraries are not.
+class HeapProfiler final {
+ public:
+  static constexpr int64_t kDefaultSampleInterval = 512 * 1024;
+
+  static std::shared_ptr<HeapProfiler> Instance();
+
+  /// @brief True where the allocation hooks exist, i.e. on Linux.
+  static bool Supported();
+
+  /// @brief Starts sampling every interval bytes on average, or stops at 0.
+  ///        Blocks sampled before keep being tracked until freed.
+  void SetSampleInterval(int64_t interval);
+  int64_t sample_interval() const;
+
+  /// @brief Replaces builder with {alloc_objects, count},
+  ///        {alloc_space, bytes}, {inuse_objects, count} and
+  ///        {inuse_space, bytes} per stack: everything sampled so far, and
+  ///        what of it is still live.
+  void Collect(ProfileBuilder* builder);
+
+  // Called by the allocation hooks.
+  void RecordAllocation(void* ptr, size_t size, int64_t interval);
+  void RecordFree(void* ptr);
+
+ private:
+  struct StackStats {
+    double alloc_objects = 0;
+    double alloc_bytes = 0;
+    double inuse_objects = 0;
+    double inuse_bytes = 0;
+  };
+
+  struct Block {
+    StackStats* stats;
+    double objects;
+    double bytes;
+  };
+
+  HeapProfiler() = default;
+
+  std::mutex mutex_;
+  std::map<std::vector<uint64_t>, StackStats> stacks_;
+  std::unordered_map<void*, Block> live_;
+};
+
+}  // namespace profiler
+}  // namespace tbox
+
+#endif  // TBOX_COMMON_PROFILER_H_
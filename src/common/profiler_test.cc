@@ -0,0 +1,213 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/common/profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/proto/profile.pb.h"
+#include "zlib.h"
+
+namespace tbox {
+namespace profiler {
+namespace {
+
+perftools::profiles::Profile Decode(const std::string& gzipped) {
+  std::string data(gzipped.size() * 20 + 4096, '\0');
+  z_stream stream{};
+  EXPECT_EQ(inflateInit2(&stream, MAX_WBITS + 16), Z_OK);
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(gzipped.data()));
+  stream.avail_in = static_cast<uInt>(gzipped.size());
+  stream.next_out = reinterpret_cast<Bytef*>(data.data());
+  stream.avail_out = static_cast<uInt>(data.size());
+  EXPECT_EQ(inflate(&stream, Z_FINISH), Z_STREAM_END);
+  data.resize(stream.total_out);
+  inflateEnd(&stream);
+  perftools::profiles::Profile profile;
+  EXPECT_TRUE(profile.ParseFromString(data));
+  return profile;
+}
+
+// Sum of sample value index over all samples.
+int64_t Total(const perftools::profiles::Profile& profile, int index) {
+  int64_t total = 0;
+  for (const auto& sample : profile.sample()) {
+    total += sample.value(index);
+  }
+  return total;
+}
+
+TEST(ProfilerTest, ProfileBuilder) {
+  ProfileBuilder builder({{"samples", "count"}, {"cpu", "nanoseconds"}});
+  builder.SetPeriod({"cpu", "nanoseconds"}, 10000000);
+  builder.SetTime(1700000000000000000, 2000000000);
+  const uint64_t a[] = {0x1000, 0x2000, 0x3000};
+  const uint64_t b[] = {0x1100, 0x2000};
+  const int64_t values[] = {1, 10000000};
+  builder.AddSample(a, 3, values);
+  builder.AddSample(b, 2, values);
+  builder.AddSample(a, 3, values);
+  EXPECT_EQ(builder.size(), 2u);
+
+  const auto profile = Decode(builder.Build(
+      [](const std::vector<uint64_t>& addresses, std::vector<Frame>* frames) {
+        ASSERT_EQ(addresses.size(), frames->size());
+        for (size_t i = 0; i < addresses.size(); ++i) {
+          if (addresses[i] != 0x3000) {
+            (*frames)[i].function = "f" + std::to_string(addresses[i] >> 8);
+            (*frames)[i].file = "f.cc";
+            (*frames)[i].line = static_cast<int64_t>(addresses[i] >> 8);
+          }
+        }
+      }));
+  const auto& strings = profile.string_table();
+  ASSERT_GT(strings.size(), 0);
+  EXPECT_EQ(strings[0], "");
+  ASSERT_EQ(profile.sample_type_size(), 2);
+  EXPECT_EQ(strings[profile.sample_type(1).type()], "cpu");
+  EXPECT_EQ(strings[profile.sample_type(1).unit()], "nanoseconds");
+  EXPECT_EQ(strings[profile.period_type().type()], "cpu");
+  EXPECT_EQ(profile.period(), 10000000);
+  EXPECT_EQ(profile.duration_nanos(), 2000000000);
+
+  // Four distinct addresses, three of them symbolized into three functions.
+  ASSERT_EQ(profile.location_size(), 4);
+  EXPECT_EQ(profile.function_size(), 3);
+  ASSERT_EQ(profile.sample_size(), 2);
+  EXPECT_EQ(Total(profile, 0), 3);
+  EXPECT_EQ(Total(profile, 1), 30000000);
+  for (const auto& sample : profile.sample()) {
+    const auto& leaf = profile.location(sample.location_id(0) - 1);
+    if (leaf.address() == 0x1000) {
+      EXPECT_EQ(sample.value(0), 2);
+      ASSERT_EQ(sample.location_id_size(), 3);
+      EXPECT_EQ(profile.location(sample.location_id(2) - 1).line_size(), 0);
+    } else {
+      EXPECT_EQ(leaf.address(), 0x1100u);
+      ASSERT_EQ(leaf.line_size(), 1);
+      EXPECT_EQ(leaf.line(0).line(), 0x11);
+      const auto& function = profile.function(leaf.line(0).function_id() - 1);
+      EXPECT_EQ(strings[function.name()], "f17");
+      EXPECT_EQ(strings[function.filename()], "f.cc");
+    }
+  }
+#if defined(__linux__)
+  EXPECT_GT(profile.mapping_size(), 0);
+#endif
+}
+
+#if defined(__linux__)
+__attribute__((noinline)) uint64_t Spin(const std::atomic<bool>& stop) {
+  uint64_t x = 1;
+  while (!stop.load(std::memory_order_relaxed)) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+  }
+  return x;
+}
+
+TEST(ProfilerTest, CpuProfile) {
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> sink{0};
+  std::thread spinner([&] { sink = Spin(stop); });
+
+  ProfileBuilder builder({});
+  std::thread other([] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ProfileBuilder unused({});
+    EXPECT_FALSE(CpuProfiler::Instance()->Collect(
+        std::chrono::milliseconds(10), 100, &unused));
+  });
+  ASSERT_TRUE(CpuProfiler::Instance()->Collect(std::chrono::milliseconds(500),
+                                               1000, &builder));
+  other.join();
+  stop = true;
+  spinner.join();
+
+  const auto profile = Decode(builder.Build());
+  // 500 ms of one busy thread at 1 kHz; leave room for a loaded machine.
+  EXPECT_GT(Total(profile, 0), 100);
+  EXPECT_EQ(profile.period(), 1000000);
+  size_t deep = 0;
+  for (const auto& sample : profile.sample()) {
+    deep += sample.location_id_size() > 2 ? 1 : 0;
+  }
+  EXPECT_GT(deep, 0u);
+}
+
+TEST(ProfilerTest, StopCpuProfile) {
+  // Nothing runs: a no-op that must not cut the next profile short.
+  CpuProfiler::Instance()->Stop();
+  std::thread stopper([] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CpuProfiler::Instance()->Stop();
+  });
+  ProfileBuilder builder({});
+  const auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(CpuProfiler::Instance()->Collect(std::chrono::seconds(60), 100,
+                                               &builder));
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  stopper.join();
+  EXPECT_GE(elapsed, std::chrono::milliseconds(100));
+  EXPECT_LT(elapsed, std::chrono::seconds(30));
+}
+
+__attribute__((noinline)) std::vector<void*> Allocate(int count,
+                                                      size_t size) {
+  std::vector<void*> blocks;
+  for (int i = 0; i < count; ++i) {
+    blocks.push_back(std::malloc(size));
+  }
+  return blocks;
+}
+
+TEST(ProfilerTest, HeapProfile) {
+  auto heap = HeapProfiler::Instance();
+  // Sample nearly everything: an allocation of s bytes is picked with
+  // probability 1 - exp(-s).
+  heap->SetSampleInterval(1);
+  std::vector<void*> blocks = Allocate(100, 4096);
+  heap->SetSampleInterval(0);
+
+  ProfileBuilder builder({});
+  heap->Collect(&builder);
+  auto profile = Decode(builder.Build());
+  ASSERT_EQ(profile.sample_type_size(), 4);
+  EXPECT_EQ(profile.string_table(profile.sample_type(3).type()),
+            "inuse_space");
+  // A thread's first allocation only arms its countdown.
+  EXPECT_GE(Total(profile, 1), 99 * 4096);
+  EXPECT_GE(Total(profile, 3), 99 * 4096);
+  // The stacks start at the caller of malloc, not in the hooks.
+  const auto* biggest = &profile.sample(0);
+  for (const auto& sample : profile.sample()) {
+    if (sample.value(3) > biggest->value(3)) {
+      biggest = &sample;
+    }
+  }
+  const uint64_t leaf = profile.location(biggest->location_id(0) - 1).address();
+  const auto function = reinterpret_cast<uint64_t>(&Allocate);
+  EXPECT_GT(leaf, function);
+  EXPECT_LT(leaf, function + 1024);
+
+  for (void* block : blocks) {
+    std::free(block);
+  }
+  heap->Collect(&builder);
+  profile = Decode(builder.Build());
+  EXPECT_GE(Total(profile, 1), 99 * 4096);
+  EXPECT_LT(Total(profile, 3), 100 * 4096);
+}
+#endif
+
+}  // namespace
+}  // namespace profiler
+}  // namespace tbox
@@ -0,0 +1,323 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_COMMON_TASK_H_
+#define TBOX_COMMON_TASK_H_
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace tbox {
+namespace common {
+
+/// @brief Continues a suspended coroutine once the operation it awaits has
+///        completed, typically by posting it to the thread that owns it. An
+///        empty Resumer resumes on the completing thread.
+using Resumer = std::function<void(std::coroutine_handle<>)>;
+
+inline void Resume(const Resumer& resumer, std::coroutine_handle<> handle) {
+  if (resumer) {
+    resumer(handle);
+  } else {
+    handle.resume();
+  }
+}
+
+template <typename T = void>
+class Task;
+
+namespace internal {
+
+class PromiseBase {
+ public:
+  struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<Promise> handle) noexcept {
+      auto continuation = handle.promise().continuation_;
+      return continuation ? continuation : std::noop_coroutine();
+    }
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() { exception_ = std::current_exception(); }
+
+  const Resumer& resumer() const { return resumer_; }
+
+ protected:
+  template <typename T>
+  friend class ::tbox::common::Task;
+  template <typename T>
+  friend struct TaskAwaiter;
+
+  void RethrowIfFailed() {
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+  }
+
+  Resumer resumer_;
+  std::coroutine_handle<> continuation_;
+  std::exception_ptr exception_;
+};
+
+template <typename T>
+class Promise : public PromiseBase {
+ public:
+  Task<T> get_return_object();
+
+  template <typename U>
+  void return_value(U&& value) {
+    value_.emplace(std::forward<U>(value));
+  }
+
+  T TakeValue() {
+    RethrowIfFailed();
+    return std::move(*value_);
+  }
+
+ private:
+  std::optional<T> value_;
+};
+
+template <>
+class Promise<void> : public PromiseBase {
+ public:
+  Task<void> get_return_object();
+  void return_void() {}
+  void TakeValue() { RethrowIfFailed(); }
+};
+
+template <typename T>
+struct TaskAwaiter;
+
+}  // namespace internal
+
+/// @brief The Resumer of the coroutine behind handle, so an awaitable that
+///        completes on a foreign thread resumes it where it belongs.
+template <typename Promise>
+Resumer ResumerOf(std::coroutine_handle<Promise> handle) {
+  if constexpr (std::is_base_of_v<internal::PromiseBase, Promise>) {
+    return handle.promise().resumer();
+  } else {
+    return nullptr;
+  }
+}
+
+/// @brief Lazily started coroutine returning T.
+/// @details A Task runs when it is co_awaited, inheriting the awaiting
+///          coroutine's Resumer, or when a root task is Start()ed. The Task
+///          owns the coroutine frame: destroying a suspended Task destroys
+///          the frame and with it everything the coroutine was awaiting.
+template <typename T>
+class [[nodiscard]] Task {
+ public:
+  using promise_type = internal::Promise<T>;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  Task() = default;
+  explicit Task(Handle handle) : handle_(handle) {}
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      Reset();
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+  ~Task() { Reset(); }
+
+  bool valid() const { return static_cast<bool>(handle_); }
+  bool done() const { return handle_ && handle_.done(); }
+
+  /// @brief Runs a root task on this thread until it first suspends.
+  /// @param resumer Where the task continues after each suspension.
+  void Start(Resumer resumer = nullptr) {
+    handle_.promise().resumer_ = std::move(resumer);
+    handle_.resume();
+  }
+
+  /// @brief Result of a finished root task; rethrows what it threw.
+  T Result() { return handle_.promise().TakeValue(); }
+
+  auto operator co_await() && noexcept {
+    return internal::TaskAwaiter<T>{handle_};
+  }
+
+ private:
+  void Reset() {
+    if (handle_) {
+      handle_.destroy();
+      handle_ = {};
+    }
+  }
+
+  Handle handle_;
+};
+
+namespace internal {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() {
+  return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() {
+  return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+template <typename T>
+struct TaskAwaiter {
+  std::coroutine_handle<Promise<T>> handle;
+
+  bool await_ready() const noexcept { return false; }
+
+  // Starts the child, which inherits where the awaiting coroutine resumes.
+  template <typename P>
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<P> awaiting) {
+    handle.promise().resumer_ = ResumerOf(awaiting);
+    handle.promise().continuation_ = awaiting;
+    return handle;
+  }
+
+  T await_resume() { return handle.promise().TakeValue(); }
+};
+
+// Result slot shared by an awaiting coroutine and the thread completing the
+// operation; 'suspended' decides which of the two continues.
+template <typename T>
+struct CallbackState {
+  std::optional<T> value;
+  std::exception_ptr exception;
+  std::coroutine_handle<> handle;
+  Resumer resumer;
+  std::atomic<bool> suspended{false};
+
+  void Complete() {
+    // Second to arrive resumes: if the callback ran inside start, the
+    // awaiting coroutine simply does not suspend.
+    if (suspended.exchange(true, std::memory_order_acq_rel)) {
+      Resume(resumer, handle);
+    }
+  }
+};
+
+struct Unit {};
+
+template <typename T>
+class CallbackAwaiter {
+ public:
+  bool await_ready() const noexcept { return false; }
+
+  T await_resume() {
+    if (state_->exception) {
+      std::rethrow_exception(state_->exception);
+    }
+    return std::move(*state_->value);
+  }
+
+ protected:
+  template <typename Promise, typename Launch>
+  bool Suspend(std::coroutine_handle<Promise> handle, Launch&& launch) {
+    state_ = std::make_shared<CallbackState<T>>();
+    state_->handle = handle;
+    state_->resumer = ResumerOf(handle);
+    launch(state_);
+    return !state_->suspended.exchange(true, std::memory_order_acq_rel);
+  }
+
+ private:
+  std::shared_ptr<CallbackState<T>> state_;
+};
+
+template <typename Spawn, typename F>
+class OffloadAwaiter
+    : public CallbackAwaiter<std::conditional_t<
+          std::is_void_v<std::invoke_result_t<F&>>, Unit,
+          std::invoke_result_t<F&>>> {
+ public:
+  OffloadAwaiter(Spawn spawn, F fn)
+      : spawn_(std::move(spawn)), fn_(std::move(fn)) {}
+
+  template <typename P>
+  bool await_suspend(std::coroutine_handle<P> handle) {
+    return this->Suspend(handle, [this](const auto& state) {
+      spawn_([state, fn = std::move(fn_)]() mutable {
+        try {
+          if constexpr (std::is_void_v<std::invoke_result_t<F&>>) {
+            fn();
+            state->value.emplace();
+          } else {
+            state->value.emplace(fn());
+          }
+        } catch (...) {
+          state->exception = std::current_exception();
+        }
+        state->Complete();
+      });
+    });
+  }
+
+ private:
+  Spawn spawn_;
+  F fn_;
+};
+
+}  // namespace internal
+
+/// @brief Awaits an operation that reports its result once, from any thread,
+///        through a callback: co_await CallbackAwaitable<int>([](auto done) {
+///        StartSomething([done](int v) { done(v); }); }).
+/// @details The coroutine continues through its Resumer. The operation must
+///          not outlive what the callback refers to; when the awaiting frame
+///          can be destroyed early its Resumer has to drop the resumption.
+template <typename T>
+class CallbackAwaitable : public internal::CallbackAwaiter<T> {
+ public:
+  using Callback = std::function<void(T)>;
+  using Start = std::function<void(Callback)>;
+
+  explicit CallbackAwaitable(Start start) : start_(std::move(start)) {}
+
+  template <typename Promise>
+  bool await_suspend(std::coroutine_handle<Promise> handle) {
+    // The callback may run, and resume the coroutine, before start returns.
+    Start start = std::move(start_);
+    return this->Suspend(handle, [&start](const auto& state) {
+      start([state](T value) {
+        state->value.emplace(std::move(value));
+        state->Complete();
+      });
+    });
+  }
+
+ private:
+  Start start_;
+};
+
+/// @brief Runs fn on another thread and resumes with its result, rethrowing
+///        what it threw: co_await Offload(spawn, [] { return Blocking(); }).
+/// @param spawn Called with a nullary callable to run on a worker thread,
+///        e.g. forwarding it to a folly::Executor's add().
+template <typename Spawn, typename F>
+auto Offload(Spawn spawn, F fn) {
+  return internal::OffloadAwaiter<Spawn, F>(std::move(spawn), std::move(fn));
+}
+
+}  // namespace common
+}  // namespace tbox
+
+#endif  // TBOX_COMMON_TASK_H_
@@ -0,0 +1,207 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/common/task.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace common {
+namespace {
+
+// Single threaded event loop standing in for an Rpc's event queue.
+class Loop {
+ public:
+  Resumer resumer() {
+    return [this](std::coroutine_handle<> handle) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.push_back(handle);
+    };
+  }
+
+  // Runs queued resumptions until none is left; returns how many ran.
+  int Drain() {
+    int ran = 0;
+    while (true) {
+      std::coroutine_handle<> handle;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.empty()) {
+          return ran;
+        }
+        handle = pending_.front();
+        pending_.pop_front();
+      }
+      handle.resume();
+      ++ran;
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::deque<std::coroutine_handle<>> pending_;
+};
+
+Task<int> Add(int a, int b) { co_return a + b; }
+
+Task<int> Sum(int n) {
+  int total = 0;
+  for (int i = 0; i < n; ++i) {
+    total += co_await Add(i, 1);
+  }
+  co_return total;
+}
+
+TEST(Task, NestedTasksRunInline) {
+  Task<int> task = Sum(1000);
+  EXPECT_FALSE(task.done());
+  task.Start();
+  ASSERT_TRUE(task.done());
+  EXPECT_EQ(task.Result(), 500500);
+}
+
+Task<void> Fail() {
+  throw std::runtime_error("boom");
+  co_return;
+}
+
+Task<std::string> Catch() {
+  try {
+    co_await Fail();
+  } catch (const std::runtime_error& e) {
+    co_return e.what();
+  }
+  co_return "";
+}
+
+TEST(Task, ExceptionsPropagateToTheAwaiter) {
+  Task<std::string> task = Catch();
+  task.Start();
+  ASSERT_TRUE(task.done());
+  EXPECT_EQ(task.Result(), "boom");
+
+  Task<void> failed = Fail();
+  failed.Start();
+  EXPECT_THROW(failed.Result(), std::runtime_error);
+}
+
+TEST(Task, CompletionOnAnotherThreadResumesThroughTheResumer) {
+  Loop loop;
+  std::vector<std::thread> threads;
+  const auto owner = std::this_thread::get_id();
+  std::thread::id resumed_on;
+  std::atomic<bool> started{false};
+
+  auto coroutine = [&]() -> Task<int> {
+    const int value = co_await CallbackAwaitable<int>(
+        [&](CallbackAwaitable<int>::Callback done) {
+          threads.emplace_back([&started, done] {
+            while (!started.load()) {
+              std::this_thread::yield();
+            }
+            done(7);
+          });
+        });
+    resumed_on = std::this_thread::get_id();
+    co_return value * 6;
+  };
+  Task<int> task = coroutine();
+  task.Start(loop.resumer());
+  EXPECT_FALSE(task.done());
+  started = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(loop.Drain(), 1);
+  ASSERT_TRUE(task.done());
+  EXPECT_EQ(task.Result(), 42);
+  EXPECT_EQ(resumed_on, owner);
+}
+
+TEST(Task, SynchronousCompletionDoesNotSuspend) {
+  Loop loop;
+  auto coroutine = []() -> Task<int> {
+    co_return co_await CallbackAwaitable<int>(
+        [](CallbackAwaitable<int>::Callback done) { done(3); });
+  };
+  Task<int> task = coroutine();
+  task.Start(loop.resumer());
+  ASSERT_TRUE(task.done());
+  EXPECT_EQ(loop.Drain(), 0);
+  EXPECT_EQ(task.Result(), 3);
+}
+
+TEST(Task, OffloadReturnsValuesAndExceptions) {
+  Loop loop;
+  std::vector<std::thread> threads;
+  auto spawn = [&threads](std::function<void()> fn) {
+    threads.emplace_back(std::move(fn));
+  };
+  auto coroutine = [&]() -> Task<std::string> {
+    const auto worker = co_await Offload(spawn, [] {
+      return std::this_thread::get_id();
+    });
+    EXPECT_NE(worker, std::this_thread::get_id());
+    co_await Offload(spawn, [] {});
+    try {
+      co_await Offload(spawn, []() -> int { throw std::logic_error("bad"); });
+    } catch (const std::logic_error& e) {
+      co_return e.what();
+    }
+    co_return "";
+  };
+  Task<std::string> task = coroutine();
+  task.Start(loop.resumer());
+  while (!task.done()) {
+    for (auto& thread : threads) {
+      if (thread.joinable()) {
+        thread.join();
+      }
+    }
+    loop.Drain();
+  }
+  for (auto& thread : threads) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+  EXPECT_EQ(task.Result(), "bad");
+}
+
+TEST(Task, DestroyingASuspendedTaskDestroysItsFrame) {
+  struct Guard {
+    bool* destroyed;
+    ~Guard() { *destroyed = true; }
+  };
+  bool destroyed = false;
+  CallbackAwaitable<int>::Callback pending;
+  auto coroutine = [&]() -> Task<int> {
+    Guard guard{&destroyed};
+    co_return co_await CallbackAwaitable<int>(
+        [&](CallbackAwaitable<int>::Callback done) { pending = done; });
+  };
+  {
+    Task<int> task = coroutine();
+    task.Start([](std::coroutine_handle<>) {});
+    EXPECT_FALSE(destroyed);
+  }
+  EXPECT_TRUE(destroyed);
+  // The shared state outlives the frame; a late completion is dropped by the
+  // resumer.
+  pending(1);
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace tbox
@@ -0,0 +1,453 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/common/trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+namespace tbox {
+namespace trace {
+namespace {
+
+thread_local Span* current_span = nullptr;
+
+// xorshift64*, seeded per thread; sampling needs speed, not quality.
+uint64_t NextRandom() {
+  thread_local uint64_t state = [] {
+    uint64_t seed = std::random_device()();
+    seed = (seed << 32) ^ std::random_device()();
+    seed ^= std::hash<std::thread::id>()(std::this_thread::get_id());
+    return seed == 0 ? 0x9e3779b97f4a7c15ull : seed;
+  }();
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 0x2545f4914f6cdd1dull;
+}
+
+uint64_t NewId() {
+  uint64_t id;
+  do {
+    id = NextRandom();
+  } while (id == 0);
+  return id;
+}
+
+void AppendHex(uint64_t value, std::string* out) {
+  char buffer[17];
+  std::snprintf(buffer, sizeof(buffer), "%016llx",
+                static_cast<unsigned long long>(value));
+  out->append(buffer, 16);
+}
+
+void AppendJsonString(std::string_view value, std::string* out) {
+  out->push_back('"');
+  for (const char c : value) {
+    switch (c) {
+      case '"':
+        out->append("\\\"");
+        break;
+      case '\\':
+        out->append("\\\\");
+        break;
+      case '\n':
+        out->append("\\n");
+        break;
+      case '\r':
+        out->append("\\r");
+        break;
+      case '\t':
+        out->append("\\t");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char buffer[7];
+          std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+          out->append(buffer);
+        } else {
+          out->push_back(c);
+        }
+    }
+  }
+  out->push_back('"');
+}
+
+void AppendSpanJson(const SpanData& span, std::string* out) {
+  out->append("{\"traceId\":\"");
+  AppendHex(span.context.trace_id_high, out);
+  AppendHex(span.context.trace_id_low, out);
+  out->append("\",\"spanId\":\"");
+  AppendHex(span.context.span_id, out);
+  out->append("\",");
+  if (span.parent_span_id != 0) {
+    out->append("\"parentSpanId\":\"");
+    AppendHex(span.parent_span_id, out);
+    out->append("\",");
+  }
+  out->append("\"name\":");
+  AppendJsonString(span.name, out);
+  out->append(",\"kind\":" + std::to_string(static_cast<int>(span.kind)));
+  // 64 bit integers are strings in OTLP/JSON.
+  out->append(",\"startTimeUnixNano\":\"" +
+              std::to_string(span.start_unix_nanos) + "\"");
+  out->append(",\"endTimeUnixNano\":\"" + std::to_string(span.end_unix_nanos) +
+              "\"");
+  out->append(",\"attributes\":[");
+  for (size_t i = 0; i < span.attributes.size(); ++i) {
+    if (i > 0) {
+      out->push_back(',');
+    }
+    out->append("{\"key\":");
+    AppendJsonString(span.attributes[i].first, out);
+    out->append(",\"value\":{\"stringValue\":");
+    AppendJsonString(span.attributes[i].second, out);
+    out->append("}}");
+  }
+  out->append("],\"status\":{\"code\":" +
+              std::to_string(static_cast<int>(span.status)));
+  if (!span.status_message.empty()) {
+    out->append(",\"message\":");
+    AppendJsonString(span.status_message, out);
+  }
+  out->append("}}");
+}
+
+}  // namespace
+
+int64_t NowUnixNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// RingBufferExporter
+
+RingBufferExporter::RingBufferExporter(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1)) {
+  spans_.reserve(capacity_);
+}
+
+void RingBufferExporter::Export(const SpanData& span) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (spans_.size() < capacity_) {
+    spans_.push_back(span);
+  } else {
+    spans_[next_] = span;
+  }
+  next_ = (next_ + 1) % capacity_;
+}
+
+std::vector<SpanData> RingBufferExporter::Snapshot() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (spans_.size() < capacity_) {
+    return spans_;
+  }
+  std::vector<SpanData> spans;
+  spans.reserve(capacity_);
+  spans.insert(spans.end(), spans_.begin() + next_, spans_.end());
+  spans.insert(spans.end(), spans_.begin(), spans_.begin() + next_);
+  return spans;
+}
+
+std::vector<RingBufferExporter::Trace> RingBufferExporter::SlowestTraces(
+    size_t count) const {
+  std::vector<SpanData> spans = Snapshot();
+  std::vector<const SpanData*> roots;
+  for (const auto& span : spans) {
+    if (span.is_root()) {
+      roots.push_back(&span);
+    }
+  }
+  const size_t n = std::min(count, roots.size());
+  std::partial_sort(roots.begin(), roots.begin() + n, roots.end(),
+                    [](const SpanData* a, const SpanData* b) {
+                      return a->duration_nanos() > b->duration_nanos();
+                    });
+  roots.resize(n);
+
+  std::vector<Trace> traces(n);
+  std::unordered_map<uint64_t, Trace*> by_trace;
+  for (size_t i = 0; i < n; ++i) {
+    traces[i].root = *roots[i];
+    by_trace[roots[i]->context.trace_id_low] = &traces[i];
+  }
+  for (const auto& span : spans) {
+    if (span.is_root()) {
+      continue;
+    }
+    auto it = by_trace.find(span.context.trace_id_low);
+    if (it != by_trace.end() &&
+        it->second->root.context.trace_id_high ==
+            span.context.trace_id_high) {
+      it->second->children.push_back(span);
+    }
+  }
+  for (auto& trace : traces) {
+    std::stable_sort(trace.children.begin(), trace.children.end(),
+                     [](const SpanData& a, const SpanData& b) {
+                       return a.start_unix_nanos < b.start_unix_nanos;
+                     });
+  }
+  return traces;
+}
+
+// OtlpFileExporter
+
+OtlpFileExporter::OtlpFileExporter(const std::string& path,
+                                   std::string service_name,
+                                   size_t batch_size)
+    : service_name_(std::move(service_name)),
+      batch_size_(std::max<size_t>(batch_size, 1)),
+      file_(path, std::ios::out | std::ios::app) {
+  ok_ = file_.is_open();
+  batch_.reserve(batch_size_);
+}
+
+OtlpFileExporter::~OtlpFileExporter() { Flush(); }
+
+void OtlpFileExporter::Export(const SpanData& span) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  batch_.push_back(span);
+  if (batch_.size() >= batch_size_) {
+    WriteLocked();
+  }
+}
+
+void OtlpFileExporter::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  WriteLocked();
+  file_.flush();
+}
+
+void OtlpFileExporter::WriteLocked() {
+  if (batch_.empty()) {
+    return;
+  }
+  if (ok_) {
+    file_ << ToJson(batch_, service_name_) << '\n';
+  }
+  batch_.clear();
+}
+
+std::string OtlpFileExporter::ToJson(const std::vector<SpanData>& spans,
+                                     const std::string& service_name) {
+  std::string out;
+  out.reserve(256 + spans.size() * 320);
+  out.append(
+      "{\"resourceSpans\":[{\"resource\":{\"attributes\":[{\"key\":"
+      "\"service.name\",\"value\":{\"stringValue\":");
+  AppendJsonString(service_name, &out);
+  out.append("}}]},\"scopeSpans\":[{\"scope\":{\"name\":\"tbox\"},\"spans\":[");
+  for (size_t i = 0; i < spans.size(); ++i) {
+    if (i > 0) {
+      out.push_back(',');
+    }
+    AppendSpanJson(spans[i], &out);
+  }
+  out.append("]}]}]}");
+  return out;
+}
+
+// Span
+
+Span::Span(std::shared_ptr<Tracer> tracer, SpanData data)
+    : tracer_(std::move(tracer)), data_(std::move(data)) {}
+
+Span::~Span() { End(); }
+
+std::unique_ptr<Span> Span::StartChild(std::string_view name,
+                                       SpanKind kind) {
+  return tracer_->StartSpan(name, data_.context, kind);
+}
+
+void Span::AddCompletedChild(std::string_view name, int64_t start_unix_nanos,
+                             int64_t end_unix_nanos) {
+  SpanData child;
+  child.context = data_.context;
+  child.context.span_id = NewId();
+  child.parent_span_id = data_.context.span_id;
+  child.name = std::string(name);
+  child.start_unix_nanos = start_unix_nanos;
+  child.end_unix_nanos = std::max(start_unix_nanos, end_unix_nanos);
+  tracer_->Export(child);
+}
+
+void Span::SetStartTime(int64_t start_unix_nanos) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!ended_ && start_unix_nanos > 0 &&
+      start_unix_nanos < data_.start_unix_nanos) {
+    data_.start_unix_nanos = start_unix_nanos;
+  }
+}
+
+void Span::AddAttribute(std::string key, std::string value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!ended_) {
+    data_.attributes.emplace_back(std::move(key), std::move(value));
+  }
+}
+
+void Span::SetStatus(StatusCode code, std::string message) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!ended_) {
+    data_.status = code;
+    data_.status_message = std::move(message);
+  }
+}
+
+void Span::End() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ended_) {
+      return;
+    }
+    ended_ = true;
+    data_.end_unix_nanos = NowUnixNanos();
+  }
+  tracer_->Export(data_);
+}
+
+// Tracer
+
+std::shared_ptr<Tracer> Tracer::Instance() {
+  static std::shared_ptr<Tracer> instance(new Tracer());
+  return instance;
+}
+
+void Tracer::SetSampleProbability(double probability) {
+  if (!(probability > 0)) {
+    threshold_.store(0, std::memory_order_relaxed);
+  } else if (probability >= 1) {
+    threshold_.store(std::numeric_limits<uint64_t>::max(),
+                     std::memory_order_relaxed);
+  } else {
+    threshold_.store(static_cast<uint64_t>(std::ldexp(probability, 64)),
+                     std::memory_order_relaxed);
+  }
+}
+
+double Tracer::sample_probability() const {
+  return std::ldexp(
+      static_cast<double>(threshold_.load(std::memory_order_relaxed)), -64);
+}
+
+void Tracer::AddExporter(std::shared_ptr<SpanExporter> exporter) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  exporters_.push_back(std::move(exporter));
+  exporter_count_.store(exporters_.size(), std::memory_order_relaxed);
+}
+
+void Tracer::ClearExporters() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  exporters_.clear();
+  exporter_count_.store(0, std::memory_order_relaxed);
+}
+
+std::unique_ptr<Span> Tracer::StartRootSpan(std::string_view name,
+                                            SpanKind kind) {
+  const uint64_t threshold = threshold_.load(std::memory_order_relaxed);
+  if (threshold == 0 || NextRandom() >= threshold ||
+      exporter_count_.load(std::memory_order_relaxed) == 0) {
+    return nullptr;
+  }
+  SpanData data;
+  data.context.trace_id_high = NextRandom();
+  data.context.trace_id_low = NewId();
+  data.context.span_id = NewId();
+  data.name = std::string(name);
+  data.kind = kind;
+  data.start_unix_nanos = NowUnixNanos();
+  return std::unique_ptr<Span>(new Span(shared_from_this(), std::move(data)));
+}
+
+std::unique_ptr<Span> Tracer::StartSpan(std::string_view name,
+                                        const SpanContext& parent,
+                                        SpanKind kind) {
+  if (!parent.valid()) {
+    return nullptr;
+  }
+  SpanData data;
+  data.context = parent;
+  data.context.span_id = NewId();
+  data.parent_span_id = parent.span_id;
+  data.name = std::string(name);
+  data.kind = kind;
+  data.start_unix_nanos = NowUnixNanos();
+  return std::unique_ptr<Span>(new Span(shared_from_this(), std::move(data)));
+}
+
+void Tracer::Flush() {
+  std::vector<std::shared_ptr<SpanExporter>> exporters;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    exporters = exporters_;
+  }
+  for (const auto& exporter : exporters) {
+    exporter->Flush();
+  }
+}
+
+void Tracer::Export(const SpanData& span) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& exporter : exporters_) {
+    exporter->Export(span);
+  }
+}
+
+// Thread-local context
+
+Span* CurrentSpan() { return current_span; }
+
+SpanContext CurrentSpanContext() {
+  return current_span == nullptr ? SpanContext() : current_span->context();
+}
+
+ScopedActivation::ScopedActivation(Span* span) : previous_(current_span) {
+  current_span = span;
+}
+
+ScopedActivation::~ScopedActivation() { current_span = previous_; }
+
+ScopedSpan::ScopedSpan(std::string_view name, SpanKind kind) {
+  if (current_span != nullptr) {
+    span_ = current_span->StartChild(name, kind);
+    Activate();
+  }
+}
+
+ScopedSpan::ScopedSpan(std::string_view name, const SpanContext& parent,
+                       SpanKind kind) {
+  if (parent.valid()) {
+    span_ = Tracer::Instance()->StartSpan(name, parent, kind);
+    Activate();
+  }
+}
+
+ScopedSpan::~ScopedSpan() { End(); }
+
+void ScopedSpan::End() {
+  if (span_) {
+    span_->End();
+    span_.reset();
+    current_span = previous_;
+  }
+}
+
+void ScopedSpan::Activate() {
+  if (span_) {
+    previous_ = current_span;
+    current_span = span_.get();
+  }
+}
+
+}  // namespace trace
+}  // namespace tbox
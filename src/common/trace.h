@@ -0,0 +1,301 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_COMMON_TRACE_H_
+#define TBOX_COMMON_TRACE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tbox {
+namespace trace {
+
+/// @brief Identifies a span; trace ids are 128 bit as in OpenTelemetry.
+struct SpanContext {
+  uint64_t trace_id_high = 0;
+  uint64_t trace_id_low = 0;
+  uint64_t span_id = 0;
+
+  bool valid() const { return span_id != 0; }
+};
+
+/// @brief OpenTelemetry span kinds, with their OTLP numbers.
+enum class SpanKind {
+  kInternal = 1,
+  kServer = 2,
+  kClient = 3,
+};
+
+/// @brief OpenTelemetry status codes, with their OTLP numbers.
+enum class StatusCode {
+  kUnset = 0,
+  kOk = 1,
+  kError = 2,
+};
+
+/// @brief A finished span as handed to the exporters.
+struct SpanData {
+  SpanContext context;
+  uint64_t parent_span_id = 0;
+  std::string name;
+  SpanKind kind = SpanKind::kInternal;
+  int64_t start_unix_nanos = 0;
+  int64_t end_unix_nanos = 0;
+  StatusCode status = StatusCode::kUnset;
+  std::string status_message;
+  std::vector<std::pair<std::string, std::string>> attributes;
+
+  bool is_root() const { return parent_span_id == 0; }
+  int64_t duration_nanos() const { return end_unix_nanos - start_unix_nanos; }
+};
+
+/// @brief Receives every span of a sampled trace when it ends.
+/// @details Export() runs on the thread that ends the span, so it must be
+///          thread-safe and cheap; anything slow belongs behind a buffer.
+class SpanExporter {
+ public:
+  virtual ~SpanExporter() = default;
+
+  virtual void Export(const SpanData& span) = 0;
+
+  /// @brief Writes out anything buffered.
+  virtual void Flush() {}
+};
+
+/// @brief Keeps the most recent spans in memory for /debug/traces.
+class RingBufferExporter final : public SpanExporter {
+ public:
+  /// @brief A root span and the children of its trace still in the buffer.
+  struct Trace {
+    SpanData root;
+    std::vector<SpanData> children;
+  };
+
+  /// @param capacity Spans kept, the oldest are overwritten.
+  explicit RingBufferExporter(size_t capacity = 4096);
+
+  void Export(const SpanData& span) override;
+
+  /// @brief Buffered spans, oldest first.
+  std::vector<SpanData> Snapshot() const;
+
+  /// @brief The count slowest traces whose root span is still buffered,
+  ///        slowest first; children are ordered by start time.
+  std::vector<Trace> SlowestTraces(size_t count) const;
+
+  size_t capacity() const { return capacity_; }
+
+ private:
+  const size_t capacity_;
+  mutable std::mutex mutex_;
+  std::vector<SpanData> spans_;
+  size_t next_ = 0;
+};
+
+/// @brief Appends spans to a file in the OTLP/JSON file exporter format: one
+///        ExportTraceServiceRequest per line, which an OpenTelemetry
+///        collector's otlpjsonfile receiver or any OTLP backend can import.
+class OtlpFileExporter final : public SpanExporter {
+ public:
+  /// @param batch_size Spans collected before a line is written; Flush()
+  ///        writes a partial batch.
+  OtlpFileExporter(const std::string& path, std::string service_name,
+                   size_t batch_size = 64);
+  ~OtlpFileExporter() override;
+
+  /// @brief False if the file could not be opened.
+  bool ok() const { return ok_; }
+
+  void Export(const SpanData& span) override;
+  void Flush() override;
+
+  /// @brief One ExportTraceServiceRequest holding spans, without newline.
+  static std::string ToJson(const std::vector<SpanData>& spans,
+                            const std::string& service_name);
+
+ private:
+  void WriteLocked();
+
+  const std::string service_name_;
+  const size_t batch_size_;
+  bool ok_ = false;
+  std::mutex mutex_;
+  std::ofstream file_;
+  std::vector<SpanData> batch_;
+};
+
+class Tracer;
+
+/// @brief A recording span; only sampled traces create them. Thread-safe.
+///        The destructor ends the span if End() was not called.
+class Span final {
+ public:
+  ~Span();
+
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+
+  /// @brief Starts a child of this span, in the same trace.
+  std::unique_ptr<Span> StartChild(std::string_view name,
+                                   SpanKind kind = SpanKind::kInternal);
+
+  /// @brief Records a finished child that covered [start, end], for work
+  ///        measured before the span existed, such as queueing.
+  void AddCompletedChild(std::string_view name, int64_t start_unix_nanos,
+                         int64_t end_unix_nanos);
+
+  /// @brief Moves the start back, for spans created after their work began.
+  void SetStartTime(int64_t start_unix_nanos);
+
+  void AddAttribute(std::string key, std::string value);
+  void SetStatus(StatusCode code, std::string message = {});
+
+  /// @brief Stops the clock and exports the span; later calls do nothing.
+  void End();
+
+  const SpanContext& context() const { return data_.context; }
+
+ private:
+  friend class Tracer;
+
+  Span(std::shared_ptr<Tracer> tracer, SpanData data);
+
+  const std::shared_ptr<Tracer> tracer_;
+  std::mutex mutex_;
+  SpanData data_;
+  bool ended_ = false;
+};
+
+/// @brief Samples traces and fans finished spans out to the exporters.
+/// @details Sampling happens once per trace, at the root span; everything
+///          below a sampled root is recorded. A rejected root costs a
+///          thread-local random number and no allocation, so instrumented
+///          code stays cheap with tracing disabled or at low probability.
+class Tracer final : public std::enable_shared_from_this<Tracer> {
+ public:
+  static std::shared_ptr<Tracer> Instance();
+
+  /// @brief Fraction of root spans to record, clamped to [0, 1]. The
+  ///        default 0 records nothing.
+  void SetSampleProbability(double probability);
+  double sample_probability() const;
+
+  void AddExporter(std::shared_ptr<SpanExporter> exporter);
+  void ClearExporters();
+
+  /// @brief First exporter of type T, e.g. the ring buffer behind
+  ///        /debug/traces.
+  template <typename T>
+  std::shared_ptr<T> FindExporter() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& exporter : exporters_) {
+      if (auto found = std::dynamic_pointer_cast<T>(exporter)) {
+        return found;
+      }
+    }
+    return nullptr;
+  }
+
+  /// @brief Starts a new trace.
+  /// @return nullptr if sampling rejects it or no exporter is installed.
+  std::unique_ptr<Span> StartRootSpan(std::string_view name,
+                                      SpanKind kind = SpanKind::kServer);
+
+  /// @brief Starts a child of parent, which may come from another thread.
+  /// @return nullptr if parent is invalid, i.e. not sampled.
+  std::unique_ptr<Span> StartSpan(std::string_view name,
+                                  const SpanContext& parent,
+                                  SpanKind kind = SpanKind::kInternal);
+
+  void Flush();
+
+ private:
+  friend class Span;
+
+  Tracer() = default;
+
+  void Export(const SpanData& span);
+
+  // A root is sampled if a random 64 bit number is below this; 0 samples
+  // nothing.
+  std::atomic<uint64_t> threshold_{0};
+  std::atomic<size_t> exporter_count_{0};
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<SpanExporter>> exporters_;
+};
+
+/// @brief Wall clock time in nanoseconds since the Unix epoch.
+int64_t NowUnixNanos();
+
+/// @brief The span active on this thread, nullptr outside a sampled trace.
+Span* CurrentSpan();
+
+/// @brief Context of CurrentSpan(), to continue the trace on another thread.
+SpanContext CurrentSpanContext();
+
+/// @brief Makes span the current span of this thread for its lifetime.
+class ScopedActivation final {
+ public:
+  explicit ScopedActivation(Span* span);
+  ~ScopedActivation();
+
+  ScopedActivation(const ScopedActivation&) = delete;
+  ScopedActivation& operator=(const ScopedActivation&) = delete;
+
+ private:
+  Span* const previous_;
+};
+
+/// @brief A child span of the current span that is current itself until it
+///        goes out of scope. Outside a sampled trace it records nothing and
+///        costs a thread-local load.
+class ScopedSpan final {
+ public:
+  explicit ScopedSpan(std::string_view name,
+                      SpanKind kind = SpanKind::kInternal);
+  /// @brief Child of parent instead, e.g. one captured on another thread.
+  ScopedSpan(std::string_view name, const SpanContext& parent,
+             SpanKind kind = SpanKind::kInternal);
+  ~ScopedSpan();
+
+  ScopedSpan(const ScopedSpan&) = delete;
+  ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+  /// @brief Ends the span before the scope does; later calls do nothing.
+  void End();
+
+  /// @brief nullptr when not recording.
+  Span* span() const { return span_.get(); }
+
+  void AddAttribute(std::string key, std::string value) {
+    if (span_) {
+      span_->AddAttribute(std::move(key), std::move(value));
+    }
+  }
+  void SetStatus(StatusCode code, std::string message = {}) {
+    if (span_) {
+      span_->SetStatus(code, std::move(message));
+    }
+  }
+
+ private:
+  void Activate();
+
+  std::unique_ptr<Span> span_;
+  Span* previous_ = nullptr;
+};
+
+}  // namespace trace
+}  // namespace tbox
+
+#endif  // TBOX_COMMON_TRACE_H_
@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+// Cost of tracing an RPC as the instrumented code sees it:
+//   RejectedRoot:   StartRootSpan() when sampling says no, the price every
+//                   unsampled RPC pays; it must stay well below 200 ns.
+//   ScopedSpanIdle: a ScopedSpan (session check, DB, DNS) outside a trace.
+//   SampledRpc:     a sampled root with three child spans exported to the
+//                   ring buffer, at 1 and 8 threads.
+//
+//   bazel run -c opt //src/common:trace_benchmark
+
+#include <memory>
+
+#include "benchmark/benchmark.h"
+#include "src/common/trace.h"
+
+namespace tbox {
+namespace trace {
+namespace {
+
+void Setup(double probability) {
+  auto tracer = Tracer::Instance();
+  tracer->ClearExporters();
+  tracer->AddExporter(std::make_shared<RingBufferExporter>());
+  tracer->SetSampleProbability(probability);
+}
+
+void SetupRejecting(const benchmark::State&) { Setup(0.01); }
+
+void SetupSampling(const benchmark::State&) { Setup(1); }
+
+void BM_RejectedRoot(benchmark::State& state) {
+  auto tracer = Tracer::Instance();
+  int sampled = 0;
+  for (auto _ : state) {
+    auto span = tracer->StartRootSpan("TBOXService/ReportOp");
+    sampled += span != nullptr;
+    benchmark::DoNotOptimize(span);
+  }
+  state.counters["sampled"] = sampled;
+}
+BENCHMARK(BM_RejectedRoot)->Setup(SetupRejecting);
+
+void BM_ScopedSpanIdle(benchmark::State& state) {
+  for (auto _ : state) {
+    ScopedSpan span("db.users.select", SpanKind::kClient);
+    benchmark::DoNotOptimize(span.span());
+  }
+}
+BENCHMARK(BM_ScopedSpanIdle);
+
+void BM_SampledRpc(benchmark::State& state) {
+  auto tracer = Tracer::Instance();
+  for (auto _ : state) {
+    auto root = tracer->StartRootSpan("TBOXService/ReportOp");
+    root->AddCompletedChild("queue_wait", NowUnixNanos(), NowUnixNanos());
+    ScopedActivation active(root.get());
+    ScopedSpan handler("handler");
+    {
+      ScopedSpan session("session.validate");
+    }
+    {
+      ScopedSpan db("db.users.select", SpanKind::kClient);
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SampledRpc)
+    ->Setup(SetupSampling)
+    ->Threads(1)
+    ->Threads(8)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace trace
+}  // namespace tbox
+
+BENCHMARK_MAIN();
@@ -0,0 +1,180 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/common/trace.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace trace {
+namespace {
+
+class TraceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    tracer_ = Tracer::Instance();
+    tracer_->ClearExporters();
+    ring_ = std::make_shared<RingBufferExporter>(16);
+    tracer_->AddExporter(ring_);
+    tracer_->SetSampleProbability(1);
+  }
+  void TearDown() override {
+    tracer_->ClearExporters();
+    tracer_->SetSampleProbability(0);
+  }
+
+  std::shared_ptr<Tracer> tracer_;
+  std::shared_ptr<RingBufferExporter> ring_;
+};
+
+TEST_F(TraceTest, SamplingRejectsWithoutRecording) {
+  tracer_->SetSampleProbability(0);
+  EXPECT_EQ(tracer_->StartRootSpan("rpc"), nullptr);
+  {
+    ScopedSpan child("db");
+    EXPECT_EQ(child.span(), nullptr);
+    EXPECT_EQ(CurrentSpan(), nullptr);
+  }
+  EXPECT_TRUE(ring_->Snapshot().empty());
+
+  tracer_->SetSampleProbability(1);
+  tracer_->ClearExporters();
+  EXPECT_EQ(tracer_->StartRootSpan("rpc"), nullptr);
+}
+
+TEST_F(TraceTest, SampleProbability) {
+  tracer_->SetSampleProbability(0.25);
+  EXPECT_NEAR(tracer_->sample_probability(), 0.25, 1e-9);
+  int sampled = 0;
+  for (int i = 0; i < 10000; ++i) {
+    sampled += tracer_->StartRootSpan("rpc") != nullptr;
+  }
+  EXPECT_GT(sampled, 2000);
+  EXPECT_LT(sampled, 3000);
+}
+
+TEST_F(TraceTest, ScopedSpansNestUnderTheCurrentSpan) {
+  auto root = tracer_->StartRootSpan("rpc");
+  ASSERT_NE(root, nullptr);
+  {
+    ScopedActivation active(root.get());
+    ScopedSpan handler("handler");
+    ASSERT_NE(handler.span(), nullptr);
+    EXPECT_EQ(CurrentSpan(), handler.span());
+    {
+      ScopedSpan db("db", SpanKind::kClient);
+      db.AddAttribute("db.system", "sqlite");
+      db.SetStatus(StatusCode::kError, "busy");
+    }
+    EXPECT_EQ(CurrentSpan(), handler.span());
+  }
+  EXPECT_EQ(CurrentSpan(), nullptr);
+  root->End();
+  root->End();
+
+  const auto spans = ring_->Snapshot();
+  ASSERT_EQ(spans.size(), 3u);
+  const SpanData& db = spans[0];
+  const SpanData& handler = spans[1];
+  const SpanData& rpc = spans[2];
+  EXPECT_EQ(db.name, "db");
+  EXPECT_EQ(db.parent_span_id, handler.context.span_id);
+  EXPECT_EQ(db.kind, SpanKind::kClient);
+  EXPECT_EQ(db.status, StatusCode::kError);
+  EXPECT_EQ(db.status_message, "busy");
+  ASSERT_EQ(db.attributes.size(), 1u);
+  EXPECT_EQ(handler.parent_span_id, rpc.context.span_id);
+  EXPECT_TRUE(rpc.is_root());
+  EXPECT_EQ(db.context.trace_id_low, rpc.context.trace_id_low);
+  EXPECT_EQ(db.context.trace_id_high, rpc.context.trace_id_high);
+  EXPECT_GE(rpc.duration_nanos(), handler.duration_nanos());
+}
+
+TEST_F(TraceTest, ContextCrossesThreads) {
+  auto root = tracer_->StartRootSpan("rpc");
+  ASSERT_NE(root, nullptr);
+  SpanContext parent;
+  {
+    ScopedActivation active(root.get());
+    parent = CurrentSpanContext();
+  }
+  std::thread([parent] { ScopedSpan dns("dns", parent); }).join();
+  root->End();
+
+  const auto spans = ring_->Snapshot();
+  ASSERT_EQ(spans.size(), 2u);
+  EXPECT_EQ(spans[0].name, "dns");
+  EXPECT_EQ(spans[0].parent_span_id, root->context().span_id);
+}
+
+TEST_F(TraceTest, SlowestTraces) {
+  for (int delay_ms : {1, 5, 3}) {
+    auto root = tracer_->StartRootSpan("rpc" + std::to_string(delay_ms));
+    ASSERT_NE(root, nullptr);
+    const int64_t start = NowUnixNanos();
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+    root->AddCompletedChild("queue_wait", start, NowUnixNanos());
+    root->End();
+  }
+  const auto traces = ring_->SlowestTraces(2);
+  ASSERT_EQ(traces.size(), 2u);
+  EXPECT_EQ(traces[0].root.name, "rpc5");
+  EXPECT_EQ(traces[1].root.name, "rpc3");
+  ASSERT_EQ(traces[0].children.size(), 1u);
+  EXPECT_EQ(traces[0].children[0].name, "queue_wait");
+
+  // The ring keeps the newest spans only.
+  for (int i = 0; i < 20; ++i) {
+    tracer_->StartRootSpan("fast")->End();
+  }
+  EXPECT_EQ(ring_->Snapshot().size(), 16u);
+  EXPECT_EQ(ring_->SlowestTraces(1)[0].root.name, "fast");
+}
+
+TEST_F(TraceTest, OtlpFileExporter) {
+  const auto path =
+      std::filesystem::temp_directory_path() / "tbox_trace_test.jsonl";
+  std::filesystem::remove(path);
+  auto otlp = std::make_shared<OtlpFileExporter>(path.string(), "tbox_test",
+                                                 /*batch_size=*/2);
+  ASSERT_TRUE(otlp->ok());
+  tracer_->AddExporter(otlp);
+
+  auto root = tracer_->StartRootSpan("TBOXService/ReportOp");
+  root->AddAttribute("note", "a \"quoted\"\nvalue");
+  root->StartChild("db")->End();
+  root->End();
+  tracer_->StartRootSpan("other")->End();
+  tracer_->Flush();
+
+  std::ifstream file(path);
+  std::vector<std::string> lines;
+  for (std::string line; std::getline(file, line);) {
+    lines.push_back(line);
+  }
+  ASSERT_EQ(lines.size(), 2u);
+  EXPECT_EQ(lines[0].find("{\"resourceSpans\":[{\"resource\":{\"attributes\":"
+                          "[{\"key\":\"service.name\",\"value\":"
+                          "{\"stringValue\":\"tbox_test\"}}]}"),
+            0u);
+  EXPECT_NE(lines[0].find("\"name\":\"TBOXService/ReportOp\",\"kind\":2"),
+            std::string::npos);
+  EXPECT_NE(lines[0].find("\"parentSpanId\":\""), std::string::npos);
+  EXPECT_NE(lines[0].find("a \\\"quoted\\\"\\nvalue"), std::string::npos);
+  EXPECT_NE(lines[1].find("\"name\":\"other\""), std::string::npos);
+  std::filesystem::remove(path);
+}
+
+}  // namespace
+}  // namespace trace
+}  // namespace tbox
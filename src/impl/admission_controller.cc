@@ -0,0 +1,275 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/impl/admission_controller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "src/impl/config_manager.h"
+
+namespace tbox {
+namespace impl {
+
+namespace {
+
+constexpr double kNanosPerSecond = 1e9;
+
+int64_t NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+void TokenBucket::Refill(int64_t now_ns) {
+  if (now_ns > last_ns_) {
+    tokens_ = std::min(burst_, tokens_ + (now_ns - last_ns_) * rate_ /
+                                             kNanosPerSecond);
+    last_ns_ = now_ns;
+  }
+}
+
+bool TokenBucket::TryTake(double cost, int64_t now_ns) {
+  Refill(now_ns);
+  if (tokens_ < cost) {
+    return false;
+  }
+  tokens_ -= cost;
+  return true;
+}
+
+bool TokenBucket::IsIdle(int64_t now_ns) const {
+  return tokens_ + (now_ns - last_ns_) * rate_ / kNanosPerSecond >= burst_;
+}
+
+KeyedRateLimiter::KeyedRateLimiter(double rate, double burst, size_t max_keys)
+    : rate_(rate),
+      burst_(std::max(burst, rate)),
+      max_keys_per_shard_(std::max<size_t>(1, max_keys / kShards)) {}
+
+bool KeyedRateLimiter::TryTake(std::string_view key, double cost,
+                               int64_t now_ns) {
+  if (rate_ <= 0) {
+    return true;
+  }
+  Shard& shard = shards_[Hash()(key) % kShards];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.buckets.find(key);
+  if (it == shard.buckets.end()) {
+    if (shard.buckets.size() >= max_keys_per_shard_) {
+      // Forget the coldest key even if busy rather than grow without bound,
+      // and the idle keys behind it while at it. Every key is dropped at
+      // most once, so a scan of new addresses costs O(1) per address.
+      do {
+        shard.buckets.erase(shard.lru.back().key);
+        shard.lru.pop_back();
+      } while (!shard.lru.empty() && shard.lru.back().bucket.IsIdle(now_ns));
+    }
+    shard.lru.push_front(
+        Entry{std::string(key), TokenBucket(rate_, burst_, now_ns)});
+    it = shard.buckets.emplace(shard.lru.front().key, shard.lru.begin()).first;
+  } else {
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  }
+  return it->second->bucket.TryTake(cost, now_ns);
+}
+
+size_t KeyedRateLimiter::size() const {
+  size_t size = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    size += shard.buckets.size();
+  }
+  return size;
+}
+
+ConcurrencyLimiter::ConcurrencyLimiter(const Options& options)
+    : options_(options),
+      limit_(std::clamp(options.initial_limit, options.min_limit,
+                        options.max_limit)),
+      estimated_limit_(limit_.load()) {}
+
+bool ConcurrencyLimiter::TryAcquire() {
+  uint32_t inflight = inflight_.load(std::memory_order_relaxed);
+  do {
+    if (inflight >= limit_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+  } while (!inflight_.compare_exchange_weak(inflight, inflight + 1,
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_relaxed));
+  return true;
+}
+
+void ConcurrencyLimiter::Release(std::chrono::nanoseconds latency) {
+  const uint32_t inflight =
+      inflight_.fetch_sub(1, std::memory_order_acq_rel);
+  if (options_.algorithm != Algorithm::kFixed) {
+    Update(static_cast<double>(latency.count()), inflight);
+  }
+}
+
+void ConcurrencyLimiter::Update(double latency_ns, uint32_t inflight) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  double limit = estimated_limit_;
+  if (options_.algorithm == Algorithm::kAimd) {
+    const auto threshold = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        options_.latency_threshold);
+    if (latency_ns > threshold.count()) {
+      limit *= options_.backoff;
+    } else if (inflight * 2 >= limit) {
+      // Only grow while the limit is actually being used.
+      limit += 1.0 / limit;
+    }
+  } else {
+    long_latency_ns_ =
+        long_latency_ns_ == 0
+            ? latency_ns
+            : long_latency_ns_ +
+                  (latency_ns - long_latency_ns_) / options_.long_window;
+    // Recover quickly once a latency spike is over instead of waiting for
+    // the long average to come down by itself.
+    if (long_latency_ns_ > 2 * latency_ns) {
+      long_latency_ns_ = (long_latency_ns_ + latency_ns) / 2;
+    }
+    const double gradient = std::clamp(
+        options_.tolerance * long_latency_ns_ / std::max(latency_ns, 1.0), 0.5,
+        1.0);
+    double new_limit = limit * gradient + std::sqrt(limit);
+    if (inflight * 2 < limit) {
+      new_limit = std::min(new_limit, limit);
+    }
+    limit = limit * (1 - options_.smoothing) + new_limit * options_.smoothing;
+  }
+  estimated_limit_ = std::clamp(limit, double(options_.min_limit),
+                                double(options_.max_limit));
+  limit_.store(static_cast<uint32_t>(estimated_limit_),
+               std::memory_order_relaxed);
+}
+
+AdmissionController::Permit& AdmissionController::Permit::operator=(
+    Permit&& other) noexcept {
+  if (this != &other) {
+    Release();
+    limiter_ = std::exchange(other.limiter_, nullptr);
+    start_ = other.start_;
+  }
+  return *this;
+}
+
+void AdmissionController::Permit::Release() {
+  if (limiter_ != nullptr) {
+    limiter_->Release(std::chrono::steady_clock::now() - start_);
+    limiter_ = nullptr;
+  }
+}
+
+std::shared_ptr<AdmissionController> AdmissionController::Instance() {
+  static std::shared_ptr<AdmissionController> instance(
+      new AdmissionController());
+  return instance;
+}
+
+AdmissionController::Options AdmissionController::FromConfig() {
+  auto config = util::ConfigManager::Instance();
+  Options options;
+  options.client_rate = config->AdmissionClientRate();
+  options.client_burst = BurstForRate(options.client_rate);
+  options.ip_rate = config->AdmissionIpRate();
+  options.ip_burst = BurstForRate(options.ip_rate);
+  options.concurrency.max_limit = config->AdmissionMaxConcurrency();
+  options.concurrency.initial_limit =
+      std::max<uint32_t>(options.concurrency.min_limit,
+                         options.concurrency.max_limit / 4);
+  const std::string algorithm = config->AdmissionLimitAlgorithm();
+  if (algorithm == "aimd") {
+    options.concurrency.algorithm = ConcurrencyLimiter::Algorithm::kAimd;
+  } else if (algorithm == "fixed") {
+    options.concurrency.algorithm = ConcurrencyLimiter::Algorithm::kFixed;
+    options.concurrency.initial_limit = options.concurrency.max_limit;
+  }
+  return options;
+}
+
+double AdmissionController::BurstForRate(double rate) {
+  return rate > 0 ? std::max(2 * rate, kPasswordHashCost) : 0;
+}
+
+AdmissionController::AdmissionController(const Options& options) {
+  Configure(options);
+}
+
+void AdmissionController::Configure(const Options& options) {
+  clients_ = std::make_unique<KeyedRateLimiter>(
+      options.client_rate, options.client_burst, options.max_keys);
+  ips_ = std::make_unique<KeyedRateLimiter>(options.ip_rate, options.ip_burst,
+                                            options.max_keys);
+  concurrency_.reset();
+  if (options.concurrency.max_limit > 0) {
+    ConcurrencyLimiter::Options concurrency = options.concurrency;
+    concurrency.min_limit =
+        std::min(concurrency.min_limit, concurrency.max_limit);
+    concurrency_ = std::make_unique<ConcurrencyLimiter>(concurrency);
+  }
+}
+
+AdmissionController::Decision AdmissionController::Admit(
+    const Request& request, Permit* permit) {
+  const int64_t now_ns =
+      clients_->enabled() || ips_->enabled() ? NowNanos() : 0;
+  if (!request.client_id.empty() &&
+      !clients_->TryTake(request.client_id, request.cost, now_ns)) {
+    client_limited_.fetch_add(1, std::memory_order_relaxed);
+    return Decision::kClientLimited;
+  }
+  if (!request.ip.empty() && !ips_->TryTake(request.ip, request.cost, now_ns)) {
+    ip_limited_.fetch_add(1, std::memory_order_relaxed);
+    return Decision::kIpLimited;
+  }
+  if (concurrency_ && request.counts_toward_concurrency) {
+    if (!concurrency_->TryAcquire()) {
+      overloaded_.fetch_add(1, std::memory_order_relaxed);
+      return Decision::kOverloaded;
+    }
+    permit->Release();
+    permit->limiter_ = concurrency_.get();
+    permit->start_ = std::chrono::steady_clock::now();
+  }
+  admitted_.fetch_add(1, std::memory_order_relaxed);
+  return Decision::kAdmitted;
+}
+
+AdmissionController::Stats AdmissionController::GetStats() const {
+  Stats stats;
+  stats.admitted = admitted_.load(std::memory_order_relaxed);
+  stats.client_limited = client_limited_.load(std::memory_order_relaxed);
+  stats.ip_limited = ip_limited_.load(std::memory_order_relaxed);
+  stats.overloaded = overloaded_.load(std::memory_order_relaxed);
+  if (concurrency_) {
+    stats.limit = concurrency_->limit();
+    stats.inflight = concurrency_->inflight();
+  }
+  return stats;
+}
+
+const char* AdmissionController::DecisionName(Decision decision) {
+  switch (decision) {
+    case Decision::kAdmitted:
+      return "admitted";
+    case Decision::kClientLimited:
+      return "client rate limited";
+    case Decision::kIpLimited:
+      return "ip rate limited";
+    case Decision::kOverloaded:
+      return "overloaded";
+  }
+  return "unknown";
+}
+
+}  // namespace impl
+}  // namespace tbox
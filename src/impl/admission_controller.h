@@ -0,0 +1,248 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_IMPL_ADMISSION_CONTROLLER_H_
+#define TBOX_IMPL_ADMISSION_CONTROLLER_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace tbox {
+namespace impl {
+
+/// @brief Classic token bucket: refills at rate tokens per second up to
+///        burst, every admitted request takes cost tokens.
+/// @details Not synchronized, callers hold a lock around it.
+class TokenBucket final {
+ public:
+  TokenBucket(double rate, double burst, int64_t now_ns)
+      : rate_(rate), burst_(burst), tokens_(burst), last_ns_(now_ns) {}
+
+  bool TryTake(double cost, int64_t now_ns);
+
+  /// @brief Whether the bucket would be full at now_ns, i.e. forgetting it
+  ///        loses nothing.
+  bool IsIdle(int64_t now_ns) const;
+
+ private:
+  void Refill(int64_t now_ns);
+
+  double rate_;
+  double burst_;
+  double tokens_;
+  int64_t last_ns_;
+};
+
+/// @brief Token buckets by key (client id, IP), sharded so admission on
+///        different keys rarely contends. Once a shard is full a new key
+///        drops the least recently used bucket, and the idle ones used just
+///        before it, so memory stays bounded under address scans at O(1)
+///        amortized cost per key.
+class KeyedRateLimiter final {
+ public:
+  /// @param rate Tokens per second per key, 0 admits everything.
+  KeyedRateLimiter(double rate, double burst, size_t max_keys);
+
+  bool TryTake(std::string_view key, double cost, int64_t now_ns);
+
+  bool enabled() const { return rate_ > 0; }
+  size_t size() const;
+
+ private:
+  static constexpr size_t kShards = 16;
+
+  struct Hash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const {
+      return std::hash<std::string_view>()(key);
+    }
+  };
+
+  struct Entry {
+    std::string key;
+    TokenBucket bucket;
+  };
+
+  struct Shard {
+    mutable std::mutex mutex;
+    /// Most recently used first.
+    std::list<Entry> lru;
+    /// Keys point into lru.
+    std::unordered_map<std::string_view, std::list<Entry>::iterator, Hash>
+        buckets;
+  };
+
+  const double rate_;
+  const double burst_;
+  const size_t max_keys_per_shard_;
+  std::array<Shard, kShards> shards_;
+};
+
+/// @brief Global limit on requests in flight whose size follows observed
+///        latency.
+/// @details kAimd grows the limit by one per limit-many fast completions
+///          and multiplies it by backoff when a request is slower than
+///          latency_threshold. kGradient (the Netflix concurrency-limits
+///          "gradient2" scheme) compares each latency sample with a slow
+///          moving average: as queueing makes requests slower than usual the
+///          limit shrinks in proportion, with sqrt(limit) of headroom so it
+///          can probe upwards again. kFixed keeps initial_limit.
+class ConcurrencyLimiter final {
+ public:
+  enum class Algorithm { kFixed, kAimd, kGradient };
+
+  struct Options {
+    Algorithm algorithm = Algorithm::kGradient;
+    uint32_t initial_limit = 64;
+    uint32_t min_limit = 4;
+    uint32_t max_limit = 1024;
+    // kAimd
+    std::chrono::milliseconds latency_threshold{200};
+    double backoff = 0.9;
+    // kGradient
+    double tolerance = 1.5;
+    double smoothing = 0.2;
+    uint32_t long_window = 600;
+  };
+
+  explicit ConcurrencyLimiter(const Options& options);
+
+  /// @brief Take a slot if fewer than limit() requests are in flight.
+  bool TryAcquire();
+
+  /// @brief Give the slot back and feed its latency to the algorithm.
+  void Release(std::chrono::nanoseconds latency);
+
+  uint32_t limit() const { return limit_.load(std::memory_order_relaxed); }
+  uint32_t inflight() const {
+    return inflight_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  void Update(double latency_ns, uint32_t inflight);
+
+  const Options options_;
+  std::atomic<uint32_t> limit_;
+  std::atomic<uint32_t> inflight_{0};
+
+  std::mutex mutex_;
+  double estimated_limit_;
+  double long_latency_ns_ = 0;
+};
+
+/// @brief Shared admission control for the gRPC and HTTP entry points.
+/// @details Admit() runs before a request is parsed or a handler is
+///          created and checks, cheapest first, the client id bucket, the
+///          IP bucket and the global concurrency limit. An admitted request
+///          holds a Permit until its response is finished; the permit's
+///          lifetime is the latency sample for the concurrency limit.
+class AdmissionController final {
+ public:
+  enum class Decision {
+    kAdmitted,
+    kClientLimited,
+    kIpLimited,
+    kOverloaded,
+  };
+
+  struct Options {
+    // Requests per second and burst per client id / IP; 0 disables.
+    double client_rate = 0;
+    double client_burst = 0;
+    double ip_rate = 0;
+    double ip_burst = 0;
+    size_t max_keys = 65536;
+    // Disabled unless concurrency.max_limit > 0.
+    ConcurrencyLimiter::Options concurrency{.max_limit = 0};
+  };
+
+  /// @brief Cost of a request that triggers a password hash (UserOp).
+  static constexpr double kPasswordHashCost = 10;
+
+  struct Request {
+    std::string_view client_id;  // empty when unknown
+    std::string_view ip;
+    double cost = 1;
+    // Long lived streams (/ws) are rate limited but hold no slot.
+    bool counts_toward_concurrency = true;
+  };
+
+  /// @brief Slot of an admitted request, released on destruction.
+  class Permit final {
+   public:
+    Permit() = default;
+    ~Permit() { Release(); }
+    Permit(Permit&& other) noexcept { *this = std::move(other); }
+    Permit& operator=(Permit&& other) noexcept;
+    Permit(const Permit&) = delete;
+    Permit& operator=(const Permit&) = delete;
+
+    void Release();
+
+    /// @brief Whether a concurrency slot is held.
+    explicit operator bool() const { return limiter_ != nullptr; }
+
+   private:
+    friend class AdmissionController;
+    ConcurrencyLimiter* limiter_ = nullptr;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  struct Stats {
+    uint64_t admitted = 0;
+    uint64_t client_limited = 0;
+    uint64_t ip_limited = 0;
+    uint64_t overloaded = 0;
+    uint32_t limit = 0;
+    uint32_t inflight = 0;
+  };
+
+  static std::shared_ptr<AdmissionController> Instance();
+
+  /// @brief Options from the server configuration.
+  static Options FromConfig();
+
+  /// @brief Burst for a configured rate: twice the rate, but never below
+  ///        kPasswordHashCost, or a low rate would turn every login away.
+  static double BurstForRate(double rate);
+
+  AdmissionController() : AdmissionController(Options()) {}
+  explicit AdmissionController(const Options& options);
+
+  /// @brief Replace all limits. Only call before the servers start.
+  void Configure(const Options& options);
+
+  Decision Admit(const Request& request, Permit* permit);
+
+  Stats GetStats() const;
+
+  static const char* DecisionName(Decision decision);
+
+ private:
+  std::unique_ptr<KeyedRateLimiter> clients_;
+  std::unique_ptr<KeyedRateLimiter> ips_;
+  std::unique_ptr<ConcurrencyLimiter> concurrency_;
+
+  std::atomic<uint64_t> admitted_{0};
+  std::atomic<uint64_t> client_limited_{0};
+  std::atomic<uint64_t> ip_limited_{0};
+  std::atomic<uint64_t> overloaded_{0};
+};
+
+}  // namespace impl
+}  // namespace tbox
+
+#endif  // TBOX_IMPL_ADMISSION_CONTROLLER_H_
@@ -0,0 +1,213 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/impl/admission_controller.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace impl {
+namespace {
+
+constexpr int64_t kSecond = 1000000000;
+
+TEST(TokenBucket, RefillsUpToBurst) {
+  TokenBucket bucket(10, 20, 0);
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_TRUE(bucket.TryTake(1, 0));
+  }
+  EXPECT_FALSE(bucket.TryTake(1, 0));
+  EXPECT_FALSE(bucket.IsIdle(0));
+
+  // 100ms buys one token, a long pause never more than the burst.
+  EXPECT_TRUE(bucket.TryTake(1, kSecond / 10));
+  EXPECT_FALSE(bucket.TryTake(1, kSecond / 10));
+  EXPECT_TRUE(bucket.IsIdle(kSecond * 10));
+  EXPECT_TRUE(bucket.TryTake(20, kSecond * 10));
+  EXPECT_FALSE(bucket.TryTake(1, kSecond * 10));
+}
+
+TEST(KeyedRateLimiter, KeysAreIndependent) {
+  KeyedRateLimiter limiter(1, 2, 1024);
+  EXPECT_TRUE(limiter.TryTake("a", 1, 0));
+  EXPECT_TRUE(limiter.TryTake("a", 1, 0));
+  EXPECT_FALSE(limiter.TryTake("a", 1, 0));
+  EXPECT_TRUE(limiter.TryTake("b", 2, 0));
+  EXPECT_FALSE(limiter.TryTake("b", 1, 0));
+  EXPECT_EQ(limiter.size(), 2);
+
+  KeyedRateLimiter disabled(0, 0, 1024);
+  EXPECT_FALSE(disabled.enabled());
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(disabled.TryTake("a", 1, 0));
+  }
+  EXPECT_EQ(disabled.size(), 0);
+}
+
+TEST(KeyedRateLimiter, MemoryIsBounded) {
+  KeyedRateLimiter limiter(1, 1, 64);
+  for (int i = 0; i < 10000; ++i) {
+    limiter.TryTake("10.0.0." + std::to_string(i), 1, 0);
+  }
+  EXPECT_LE(limiter.size(), 64);
+}
+
+TEST(KeyedRateLimiter, ScanKeepsRecentlyUsedKeys) {
+  KeyedRateLimiter limiter(1, 1, 64);
+  EXPECT_TRUE(limiter.TryTake("client", 1, 0));
+  for (int i = 0; i < 10000; ++i) {
+    limiter.TryTake("10.0.0." + std::to_string(i), 1, 0);
+    // Still drained: its bucket was not forgotten and refilled.
+    EXPECT_FALSE(limiter.TryTake("client", 1, 0));
+  }
+  EXPECT_LE(limiter.size(), 64);
+}
+
+TEST(ConcurrencyLimiter, Fixed) {
+  ConcurrencyLimiter::Options options;
+  options.algorithm = ConcurrencyLimiter::Algorithm::kFixed;
+  options.initial_limit = 2;
+  options.min_limit = 1;
+  ConcurrencyLimiter limiter(options);
+  EXPECT_TRUE(limiter.TryAcquire());
+  EXPECT_TRUE(limiter.TryAcquire());
+  EXPECT_FALSE(limiter.TryAcquire());
+  limiter.Release(std::chrono::seconds(10));
+  EXPECT_EQ(limiter.limit(), 2);
+  EXPECT_EQ(limiter.inflight(), 1);
+  EXPECT_TRUE(limiter.TryAcquire());
+}
+
+// Keeps the limiter saturated and completes requests with latency.
+void Drive(ConcurrencyLimiter* limiter, std::chrono::nanoseconds latency,
+           int requests) {
+  for (int i = 0; i < requests; ++i) {
+    while (limiter->TryAcquire()) {
+    }
+    limiter->Release(latency);
+  }
+}
+
+TEST(ConcurrencyLimiter, AimdBacksOffOnSlowRequests) {
+  ConcurrencyLimiter::Options options;
+  options.algorithm = ConcurrencyLimiter::Algorithm::kAimd;
+  options.initial_limit = 20;
+  options.latency_threshold = std::chrono::milliseconds(100);
+  ConcurrencyLimiter limiter(options);
+
+  Drive(&limiter, std::chrono::milliseconds(10), 200);
+  const uint32_t grown = limiter.limit();
+  EXPECT_GT(grown, 20);
+
+  Drive(&limiter, std::chrono::milliseconds(500), 10);
+  EXPECT_LT(limiter.limit(), grown * 0.9);
+  Drive(&limiter, std::chrono::milliseconds(500), 100);
+  EXPECT_EQ(limiter.limit(), options.min_limit);
+}
+
+TEST(ConcurrencyLimiter, GradientFollowsLatency) {
+  ConcurrencyLimiter::Options options;
+  options.initial_limit = 20;
+  options.max_limit = 200;
+  ConcurrencyLimiter limiter(options);
+
+  // Steady latency: the limit probes upwards.
+  Drive(&limiter, std::chrono::milliseconds(10), 200);
+  const uint32_t grown = limiter.limit();
+  EXPECT_GT(grown, 20);
+
+  // Queueing makes requests four times slower: the limit shrinks.
+  Drive(&limiter, std::chrono::milliseconds(40), 50);
+  EXPECT_LT(limiter.limit(), grown / 2);
+  EXPECT_GE(limiter.limit(), options.min_limit);
+}
+
+TEST(AdmissionController, DisabledAdmitsEverything) {
+  AdmissionController controller;
+  for (int i = 0; i < 1000; ++i) {
+    AdmissionController::Permit permit;
+    EXPECT_EQ(controller.Admit({"client", "10.0.0.1"}, &permit),
+              AdmissionController::Decision::kAdmitted);
+  }
+  EXPECT_EQ(controller.GetStats().admitted, 1000);
+  EXPECT_EQ(controller.GetStats().limit, 0);
+}
+
+TEST(AdmissionController, Limits) {
+  AdmissionController::Options options;
+  options.client_rate = 1;
+  options.client_burst = 3;
+  options.ip_rate = 1;
+  options.ip_burst = 5;
+  options.concurrency.algorithm = ConcurrencyLimiter::Algorithm::kFixed;
+  options.concurrency.initial_limit = 2;
+  options.concurrency.max_limit = 2;
+  AdmissionController controller(options);
+  using Decision = AdmissionController::Decision;
+
+  std::vector<AdmissionController::Permit> permits(8);
+  EXPECT_EQ(controller.Admit({"a", "10.0.0.1"}, &permits[0]),
+            Decision::kAdmitted);
+  EXPECT_EQ(controller.Admit({"a", "10.0.0.1"}, &permits[1]),
+            Decision::kAdmitted);
+  EXPECT_EQ(controller.Admit({"a", "10.0.0.1"}, &permits[2]),
+            Decision::kOverloaded);
+  EXPECT_EQ(controller.GetStats().inflight, 2);
+  permits[0].Release();
+  permits[1] = AdmissionController::Permit();
+  EXPECT_EQ(controller.GetStats().inflight, 0);
+
+  // Client "a" has used its burst of 3, the IP bucket still has 2 tokens.
+  EXPECT_EQ(controller.Admit({"a", "10.0.0.1"}, &permits[3]),
+            Decision::kClientLimited);
+  EXPECT_EQ(controller.Admit({"b", "10.0.0.1"}, &permits[4]),
+            Decision::kAdmitted);
+  permits[4].Release();
+  // Streams do not hold a slot.
+  AdmissionController::Request stream{"", "10.0.0.1"};
+  stream.counts_toward_concurrency = false;
+  EXPECT_EQ(controller.Admit(stream, &permits[5]), Decision::kAdmitted);
+  EXPECT_EQ(controller.GetStats().inflight, 0);
+  EXPECT_EQ(controller.Admit({"c", "10.0.0.1"}, &permits[6]),
+            Decision::kIpLimited);
+
+  // An expensive request takes more tokens at once.
+  AdmissionController::Request login{"d", "10.0.0.2"};
+  login.cost = AdmissionController::kPasswordHashCost;
+  EXPECT_EQ(controller.Admit(login, &permits[7]), Decision::kClientLimited);
+
+  const AdmissionController::Stats stats = controller.GetStats();
+  EXPECT_EQ(stats.admitted, 4);
+  EXPECT_EQ(stats.overloaded, 1);
+  EXPECT_EQ(stats.client_limited, 2);
+  EXPECT_EQ(stats.ip_limited, 1);
+}
+
+TEST(AdmissionController, LowRatesStillAdmitLogins) {
+  EXPECT_EQ(AdmissionController::BurstForRate(0), 0);
+  EXPECT_EQ(AdmissionController::BurstForRate(100), 200);
+  AdmissionController::Options options;
+  for (const double rate : {1.0, 2.0, 4.0}) {
+    options.client_rate = rate;
+    options.client_burst = AdmissionController::BurstForRate(rate);
+    options.ip_rate = rate;
+    options.ip_burst = AdmissionController::BurstForRate(rate);
+    AdmissionController controller(options);
+    AdmissionController::Request login{"client", "10.0.0.1"};
+    login.cost = AdmissionController::kPasswordHashCost;
+    AdmissionController::Permit permit;
+    EXPECT_EQ(controller.Admit(login, &permit),
+              AdmissionController::Decision::kAdmitted)
+        << rate;
+  }
+}
+
+}  // namespace
+}  // namespace impl
+}  // namespace tbox
@@ -19,6 +19,8 @@
 #include <thread>
 
 #include "src/common/logging.h"
+#include "src/common/metrics.h"
+#include "src/impl/event_hub.h"
 #include "src/util/util.h"
 
 #ifdef CopyFile
@@ -27,6 +29,30 @@
 
 namespace tbox {
 namespace impl {
+namespace {
+
+enum class SyncResult { kSkipped, kUnchanged, kUpdated, kFailed };
+
+// tbox_cert_sync_files_total, by the outcome of one certificate file.
+void CountSync(SyncResult result) {
+  static metrics::Counter* const kCounters[] = {
+      metrics::Registry::Instance()->GetCounter(
+          "tbox_cert_sync_files_total", "Certificate file checks, by result.",
+          {{"result", "skipped"}}),
+      metrics::Registry::Instance()->GetCounter(
+          "tbox_cert_sync_files_total", "Certificate file checks, by result.",
+          {{"result", "unchanged"}}),
+      metrics::Registry::Instance()->GetCounter(
+          "tbox_cert_sync_files_total", "Certificate file checks, by result.",
+          {{"result", "updated"}}),
+      metrics::Registry::Instance()->GetCounter(
+          "tbox_cert_sync_files_total", "Certificate file checks, by result.",
+          {{"result", "failed"}}),
+  };
+  kCounters[static_cast<int>(result)]->Increment();
+}
+
+}  // namespace
 
 std::shared_ptr<CertManager> CertManager::Instance() {
   static std::shared_ptr<CertManager> instance(new CertManager());
@@ -157,6 +183,13 @@ bool CertManager::SyncCertificates() {
 
   LOG(INFO) << "Certificate sync check completed. Successfully processed "
             << synced_count << "/" << domains_.size() << " domain(s)";
+  if (overall_success) {
+    static metrics::Gauge* const last_success =
+        metrics::Registry::Instance()->GetGauge(
+            "tbox_cert_sync_last_success_timestamp_seconds",
+            "Unix time of the last certificate sync without failures.");
+    last_success->Set(util::Util::CurrentTimeMillis() / 1000);
+  }
 
   return overall_success;
 }
@@ -267,6 +300,7 @@ bool CertManager::SyncCertificateFile(const DomainConfig& domain_config,
   // Check if source file exists
   if (!FileExists(src_path)) {
     LOG(WARNING) << "Source certificate file not found: " << src_path;
+    CountSync(SyncResult::kSkipped);
     return true;  // Not a failure, just skip
   }
 
@@ -286,6 +320,7 @@ bool CertManager::SyncCertificateFile(const DomainConfig& domain_config,
     if (src_hash.empty() || dest_hash.empty()) {
       LOG(ERROR) << "Failed to calculate hash for comparison: " << src_path
                  << " or " << dest_path;
+      CountSync(SyncResult::kFailed);
       return false;
     }
 
@@ -301,9 +336,17 @@ bool CertManager::SyncCertificateFile(const DomainConfig& domain_config,
 
   // Copy file if needed
   if (need_copy) {
-    return CopyFile(src_path, dest_path);
+    if (!CopyFile(src_path, dest_path)) {
+      CountSync(SyncResult::kFailed);
+      return false;
+    }
+    EventHub::Instance()->Publish(
+        EventHub::kTopicCert,
+        folly::dynamic::object("domain", domain_config.domain)(
+            "file", nginx_filename));
   }
 
+  CountSync(need_copy ? SyncResult::kUpdated : SyncResult::kUnchanged);
   return true;
 }
 
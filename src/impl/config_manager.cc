@@ -39,6 +39,48 @@ bool ConfigManager::Validate() const {
     return false;
   }
 
+  // Validate optional HTTP listener ports
+  for (uint32_t port :
+       {base_config_.http_server_port(), base_config_.https_server_port(),
+        base_config_.h2c_server_port(), base_config_.http3_server_port()}) {
+    if (port > 65535) {
+      LOG(ERROR) << "Invalid HTTP port: " << port
+                 << " (must be between 1 and 65535, or 0 to disable)";
+      return false;
+    }
+  }
+  if ((base_config_.https_server_port() != 0 ||
+       base_config_.http3_server_port() != 0) &&
+      (base_config_.tls_cert_file().empty() ||
+       base_config_.tls_key_file().empty())) {
+    LOG(ERROR) << "https_server_port and http3_server_port need "
+               << "tls_cert_file and tls_key_file";
+    return false;
+  }
+
+  const std::string& algorithm = base_config_.admission_limit_algorithm();
+  if (!algorithm.empty() && algorithm != "gradient" && algorithm != "aimd" &&
+      algorithm != "fixed") {
+    LOG(ERROR) << "Invalid admission_limit_algorithm: " << algorithm
+               << " (must be gradient, aimd or fixed)";
+    return false;
+  }
+
+  const std::string& overflow = base_config_.log_overflow_policy();
+  if (!overflow.empty() && overflow != "drop" && overflow != "block") {
+    LOG(ERROR) << "Invalid log_overflow_policy: " << overflow
+               << " (must be drop or block)";
+    return false;
+  }
+
+  const std::string& level = base_config_.min_log_level();
+  if (!level.empty() && level != "info" && level != "warning" &&
+      level != "error") {
+    LOG(ERROR) << "Invalid min_log_level: " << level
+               << " (must be info, warning or error)";
+    return false;
+  }
+
   // Validate check interval
   uint32_t check_interval = base_config_.check_interval_seconds();
   if (check_interval == 0) {
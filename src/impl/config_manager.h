@@ -6,8 +6,10 @@
 #ifndef TBOX_UTIL_CONFIG_MANAGER_H_
 #define TBOX_UTIL_CONFIG_MANAGER_H_
 
+#include <chrono>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "src/common/logging.h"
 #include "src/proto/config.pb.h"
@@ -58,6 +60,36 @@ class ConfigManager {
    */
   uint32_t HttpServerPort() const { return base_config_.http_server_port(); }
 
+  /**
+   * @brief Get HTTPS (h2 / http/1.1 over TLS) server port.
+   * @return Port number, 0 when disabled.
+   */
+  uint32_t HttpsServerPort() const { return base_config_.https_server_port(); }
+
+  /**
+   * @brief Get cleartext HTTP/2 prior knowledge server port.
+   * @return Port number, 0 when disabled.
+   */
+  uint32_t H2cServerPort() const { return base_config_.h2c_server_port(); }
+
+  /**
+   * @brief Get HTTP/3 (QUIC) server UDP port.
+   * @return Port number, 0 when disabled.
+   */
+  uint32_t Http3ServerPort() const { return base_config_.http3_server_port(); }
+
+  /**
+   * @brief Get TLS certificate chain file for HTTPS and HTTP/3.
+   * @return PEM file path.
+   */
+  std::string TlsCertFile() const { return base_config_.tls_cert_file(); }
+
+  /**
+   * @brief Get TLS private key file for HTTPS and HTTP/3.
+   * @return PEM file path.
+   */
+  std::string TlsKeyFile() const { return base_config_.tls_key_file(); }
+
   /**
    * @brief Get gRPC server port.
    * @return gRPC server port number.
@@ -82,6 +114,80 @@ class ConfigManager {
     return threads > 0 ? threads : 5;  // Default to 5 if not set
   }
 
+  /**
+   * @brief Get CPU budget shared by the HTTP and gRPC servers.
+   * @return CPU count, 0 for all CPUs with legacy thread counts.
+   */
+  uint32_t CpuBudget() const { return base_config_.cpu_budget(); }
+
+  /**
+   * @brief Get HTTP IO thread count.
+   * @return Thread count, 0 to derive it from the CPU budget.
+   */
+  uint32_t HttpIoThreads() const { return base_config_.http_io_threads(); }
+
+  /**
+   * @brief Get HTTP connection idle timeout.
+   * @return Timeout in milliseconds, 0 for the default.
+   */
+  uint32_t HttpIdleTimeoutMs() const {
+    return base_config_.http_idle_timeout_ms();
+  }
+
+  /**
+   * @brief Whether server threads are pinned to CPUs.
+   * @return true to pin HTTP IO and gRPC threads.
+   */
+  bool PinThreads() const { return base_config_.pin_threads(); }
+
+  /**
+   * @brief Whether HTTP listeners use one SO_REUSEPORT socket per thread.
+   * @return true to shard accept across IO threads.
+   */
+  bool ReusePort() const { return base_config_.reuse_port(); }
+
+  /**
+   * @brief Whether gRPC events run on the HTTP IO threads.
+   * @return true to share one executor between HTTP and gRPC.
+   */
+  bool SharedExecutor() const { return base_config_.shared_executor(); }
+
+  /**
+   * @brief Get the directory of the built web dashboard.
+   * @return Web root, empty when the dashboard is not served.
+   */
+  std::string WebRoot() const { return base_config_.web_root(); }
+
+  /**
+   * @brief Get the per client id request rate limit.
+   * @return Requests per second, 0 when unlimited.
+   */
+  uint32_t AdmissionClientRate() const {
+    return base_config_.admission_client_rate();
+  }
+
+  /**
+   * @brief Get the per client IP request rate limit.
+   * @return Requests per second, 0 when unlimited.
+   */
+  uint32_t AdmissionIpRate() const { return base_config_.admission_ip_rate(); }
+
+  /**
+   * @brief Get the upper bound of the adaptive concurrency limit.
+   * @return Maximum requests in flight, 0 when unlimited.
+   */
+  uint32_t AdmissionMaxConcurrency() const {
+    return base_config_.admission_max_concurrency();
+  }
+
+  /**
+   * @brief Get how the concurrency limit adapts to latency.
+   * @return "gradient", "aimd" or "fixed"; empty means "gradient".
+   */
+  std::string AdmissionLimitAlgorithm() const {
+    return base_config_.admission_limit_algorithm();
+  }
+
   /**
    * @brief Get client worker thread pool size.
    * @return Thread pool size.
@@ -208,6 +314,149 @@ class ConfigManager {
    */
   bool WriteLogs() const { return base_config_.write_logs(); }
 
+  /**
+   * @brief Get logging setup: write_logs, level, binary and async writer
+   * settings.
+   * @return Options for tbox::logging::Initialize().
+   */
+  logging::Options LoggingOptions() const {
+    logging::Options options;
+    options.write_logs = base_config_.write_logs();
+    options.async = base_config_.async_logging();
+    if (base_config_.log_overflow_policy() == "block") {
+      options.overflow = logging::OverflowPolicy::kBlock;
+    }
+    if (base_config_.log_flush_interval_ms() > 0) {
+      options.flush_interval = std::chrono::milliseconds(
+          base_config_.log_flush_interval_ms());
+    }
+    options.binary = base_config_.binary_logging();
+    if (base_config_.min_log_level() == "warning") {
+      options.min_severity = logging::Severity::kWarning;
+    } else if (base_config_.min_log_level() == "error") {
+      options.min_severity = logging::Severity::kError;
+    }
+    if (!options.async) {
+      // Synchronous logging keeps flushing every record.
+      options.flush_severity = logging::Severity::kInfo;
+    }
+    return options;
+  }
+
+  /**
+   * @brief Get gRPC message compression algorithm name.
+   * @return "none", "deflate" or "gzip" (default: "none").
+   */
+  std::string GrpcCompression() const {
+    const std::string& name = base_config_.grpc_compression();
+    return name.empty() ? "none" : name;
+  }
+
+  /**
+   * @brief Get extra gRPC server addresses balanced with ServerAddr().
+   * @return host or host:port entries, possibly empty.
+   */
+  std::vector<std::string> GrpcServerAddrs() const {
+    return {base_config_.grpc_server_addrs().begin(),
+            base_config_.grpc_server_addrs().end()};
+  }
+
+  /**
+   * @brief Get the client side gRPC load balancing policy.
+   * @return "pick_first", "round_robin" or "least_request", an alias of
+   *         round_robin (default: "pick_first").
+   */
+  std::string GrpcLbPolicy() const {
+    const std::string& policy = base_config_.grpc_lb_policy();
+    return policy.empty() ? "pick_first" : policy;
+  }
+
+  /**
+   * @brief Get the keepalive ping interval of client gRPC connections.
+   * @return Interval in milliseconds (default: 60000).
+   */
+  uint32_t GrpcKeepaliveMs() const {
+    return base_config_.grpc_keepalive_ms() == 0
+               ? 60000
+               : base_config_.grpc_keepalive_ms();
+  }
+
+  /**
+   * @brief Check whether gRPC requests are traced.
+   * @return True if tracing is enabled (default: false).
+   */
+  bool EnableTracing() const { return base_config_.enable_tracing(); }
+
+  /**
+   * @brief Get the fraction of gRPC requests that are traced.
+   * @return Probability in (0, 1] (default: 0.01).
+   */
+  double TracingSampleProbability() const {
+    const double probability = base_config_.tracing_sample_probability();
+    return probability > 0 && probability <= 1 ? probability : 0.01;
+  }
+
+  /**
+   * @brief Get the OTLP/JSON file spans are appended to.
+   * @return File path, empty if spans are only kept in memory.
+   */
+  std::string TracingOtlpFile() const {
+    return base_config_.tracing_otlp_file();
+  }
+
+  /**
+   * @brief Get the number of spans kept in memory for /debug/traces.
+   * @return Span count (default: 4096).
+   */
+  uint32_t TracingBufferSpans() const {
+    return base_config_.tracing_buffer_spans() == 0
+               ? 4096
+               : base_config_.tracing_buffer_spans();
+  }
+
+  /**
+   * @brief Check whether /metrics is served to remote clients.
+   * @return True for every client, false for loopback only (default).
+   */
+  bool MetricsPublic() const { return base_config_.metrics_public(); }
+
+  /**
+   * @brief Get the heap profiler's sampling interval at startup.
+   * @return Bytes per sample on average, 0 if off (default).
+   */
+  uint64_t HeapProfileSampleBytes() const {
+    return base_config_.heap_profile_sample_bytes();
+  }
+
+  /**
+   * @brief Get the reverse proxies whose forwarding headers are trusted.
+   * @return Addresses or CIDR networks, possibly empty (default).
+   */
+  std::vector<std::string> TrustedProxies() const {
+    return {base_config_.trusted_proxies().begin(),
+            base_config_.trusted_proxies().end()};
+  }
+
+  /**
+   * @brief Get WebSocket compression codecs in preference order.
+   * @return Codec names (default: zstd, lz4, deflate).
+   */
+  std::vector<std::string> WebSocketCompression() const {
+    if (base_config_.websocket_compression().empty()) {
+      return {"zstd", "lz4", "deflate"};
+    }
+    return {base_config_.websocket_compression().begin(),
+            base_config_.websocket_compression().end()};
+  }
+  /**
+   * @brief Get the WebSocket compression dictionary file.
+   * @return File path, empty if there is none (default).
+   */
+  std::string WebSocketDictionary() const {
+    return base_config_.websocket_dictionary();
+  }
+
+
   /**
    * @brief Get embedded vlmcsd listen addresses.
    * @return Configured addresses, or 127.0.0.1 when enabled and unset.
@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <exception>
 #include <map>
 #include <set>
@@ -16,7 +17,9 @@
 
 #include "folly/IPAddress.h"
 #include "src/common/logging.h"
+#include "src/common/trace.h"
 #include "src/impl/dns/dns_provider.h"
+#include "src/impl/event_hub.h"
 
 namespace tbox {
 namespace impl {
@@ -141,8 +144,13 @@ bool DDNSManager::ReconcileRecord(const std::string& zone_id,
                                   dns::RecordType type,
                                   const std::string& desired) {
   std::vector<dns::Record> records;
-  if (!provider_->ListRecords(zone_id, domain, type, &records)) {
-    return false;
+  {
+    trace::ScopedSpan span("dns.ListRecords", trace::SpanKind::kClient);
+    span.AddAttribute("dns.provider", provider_->Name());
+    if (!provider_->ListRecords(zone_id, domain, type, &records)) {
+      span.SetStatus(trace::StatusCode::kError);
+      return false;
+    }
   }
 
   if (records.size() == 1 && records.front().value == desired) {
@@ -150,7 +158,13 @@ bool DDNSManager::ReconcileRecord(const std::string& zone_id,
               << domain << " is already current";
     return true;
   }
-  return provider_->UpsertRecord(zone_id, domain, type, desired, kDnsTtl);
+  trace::ScopedSpan span("dns.UpsertRecord", trace::SpanKind::kClient);
+  span.AddAttribute("dns.provider", provider_->Name());
+  if (!provider_->UpsertRecord(zone_id, domain, type, desired, kDnsTtl)) {
+    span.SetStatus(trace::StatusCode::kError);
+    return false;
+  }
+  return true;
 }
 
 bool DDNSManager::UpdateDomains(
@@ -197,8 +211,11 @@ bool DDNSManager::UpdateDomains(
     if (zone_it != domain_to_zone_id_.end()) {
       zone_id = zone_it->second;
     } else {
+      trace::ScopedSpan span("dns.GetZoneId", trace::SpanKind::kClient);
+      span.AddAttribute("dns.provider", provider_->Name());
       zone_id = provider_->GetZoneId(domain);
       if (zone_id.empty()) {
+        span.SetStatus(trace::StatusCode::kError);
         all_success = false;
         continue;
       }
@@ -217,8 +234,21 @@ bool DDNSManager::UpdateDomains(
           cached->second == address_it->second) {
         continue;
       }
-      if (ReconcileRecord(zone_id, domain, type, address_it->second)) {
+      const auto start = std::chrono::steady_clock::now();
+      const bool reconciled =
+          ReconcileRecord(zone_id, domain, type, address_it->second);
+      reconcile_latency_->Record(static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count()));
+      (reconciled ? reconcile_updated_ : reconcile_failed_)->Increment();
+      if (reconciled) {
         last_record_values_[cache_key] = address_it->second;
+        EventHub::Instance()->Publish(
+            EventHub::kTopicDdns,
+            folly::dynamic::object("domain", domain)(
+                "type", dns::RecordTypeToString(type))("value",
+                                                       address_it->second));
       } else {
         all_success = false;
       }
@@ -14,6 +14,7 @@
 #include <string>
 #include <vector>
 
+#include "src/common/metrics.h"
 #include "src/impl/dns/dns_provider.h"
 
 namespace tbox {
@@ -63,6 +64,19 @@ class DDNSManager final {
   std::map<std::string, std::string> domain_to_zone_id_;
   std::map<std::string, std::string> last_record_values_;
   std::mutex mutex_;
+
+  metrics::Histogram* const reconcile_latency_ =
+      metrics::Registry::Instance()->GetHistogram(
+          "tbox_ddns_reconcile_seconds",
+          "Time to bring one DNS record to a reported address.");
+  metrics::Counter* const reconcile_updated_ =
+      metrics::Registry::Instance()->GetCounter(
+          "tbox_ddns_reconciles_total", "DNS record reconciles, by result.",
+          {{"result", "updated"}});
+  metrics::Counter* const reconcile_failed_ =
+      metrics::Registry::Instance()->GetCounter(
+          "tbox_ddns_reconciles_total", "DNS record reconciles, by result.",
+          {{"result", "failed"}});
 };
 
 }  // namespace impl
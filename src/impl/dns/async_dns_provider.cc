@@ -0,0 +1,26 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/impl/dns/async_dns_provider.h"
+
+#include "folly/executors/thread_factory/NamedThreadFactory.h"
+
+namespace tbox {
+namespace impl {
+namespace dns {
+
+AsyncDnsProvider::AsyncDnsProvider(std::unique_ptr<DnsProvider> provider)
+    : provider_(std::move(provider)),
+      executor_(std::make_shared<folly::CPUThreadPoolExecutor>(
+          1, std::make_shared<folly::NamedThreadFactory>("AsyncDns"))) {}
+
+AsyncDnsProvider::~AsyncDnsProvider() {
+  // The queued calls use provider_.
+  executor_->join();
+}
+
+}  // namespace dns
+}  // namespace impl
+}  // namespace tbox
@@ -0,0 +1,118 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_IMPL_DNS_ASYNC_DNS_PROVIDER_H_
+#define TBOX_IMPL_DNS_ASYNC_DNS_PROVIDER_H_
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "folly/executors/CPUThreadPoolExecutor.h"
+#include "src/common/task.h"
+#include "src/common/trace.h"
+#include "src/impl/dns/dns_provider.h"
+
+namespace tbox {
+namespace impl {
+namespace dns {
+
+/// @brief Awaitable front end of a DnsProvider.
+/// @details Backend calls are blocking SDK or HTTP requests. Each one runs on
+///          a worker thread owned by this object, one at a time and in
+///          submission order, which keeps the single thread contract of
+///          DnsProvider; the awaiting coroutine resumes through its Resumer.
+///          Arguments are copied, so callers need not keep them alive. Each
+///          call is a client span in the trace of the code that made it.
+class AsyncDnsProvider final {
+ public:
+  /// @param provider Backend to drive, Init() not yet called.
+  explicit AsyncDnsProvider(std::unique_ptr<DnsProvider> provider);
+  /// @brief Waits for the calls already submitted.
+  ~AsyncDnsProvider();
+
+  /// @return Backend name, no remote call.
+  std::string Name() const { return provider_->Name(); }
+
+  /// @brief Runs fn(DnsProvider*) on the worker thread; co_await yields its
+  ///        result. Lets a caller batch several backend calls.
+  template <typename F>
+  auto Run(F fn) {
+    return Run("dns.Run", std::move(fn));
+  }
+
+  /// @brief Run(fn), traced as a span called name.
+  template <typename F>
+  auto Run(const char* name, F fn) {
+    return common::Offload(
+        [executor = executor_](auto task) { executor->add(std::move(task)); },
+        [provider = provider_.get(), fn = std::move(fn), name,
+         parent = trace::CurrentSpanContext()]() mutable {
+          trace::ScopedSpan span(name, parent, trace::SpanKind::kClient);
+          return fn(provider);
+        });
+  }
+
+  /// @brief co_await yields DnsProvider::Init().
+  auto Init() {
+    return Run("dns.Init",
+               [](DnsProvider* provider) { return provider->Init(); });
+  }
+
+  /// @brief co_await yields the zone identifier, empty on failure.
+  auto GetZoneId(std::string domain) {
+    return Run("dns.GetZoneId",
+               [domain = std::move(domain)](DnsProvider* provider) {
+                 return provider->GetZoneId(domain);
+               });
+  }
+
+  /// @brief co_await yields the records, std::nullopt on failure.
+  auto ListRecords(std::string zone_id, std::string domain, RecordType type) {
+    return Run("dns.ListRecords",
+               [zone_id = std::move(zone_id), domain = std::move(domain),
+                type](DnsProvider* provider)
+                   -> std::optional<std::vector<Record>> {
+                 std::vector<Record> records;
+                 if (!provider->ListRecords(zone_id, domain, type, &records)) {
+                   return std::nullopt;
+                 }
+                 return records;
+               });
+  }
+
+  /// @brief co_await yields DnsProvider::UpsertRecord().
+  auto UpsertRecord(std::string zone_id, std::string domain, RecordType type,
+                    std::string value, int ttl) {
+    return Run("dns.UpsertRecord",
+               [zone_id = std::move(zone_id), domain = std::move(domain), type,
+                value = std::move(value), ttl](DnsProvider* provider) {
+                 return provider->UpsertRecord(zone_id, domain, type, value,
+                                               ttl);
+               });
+  }
+
+  /// @brief co_await yields DnsProvider::DeleteRecord().
+  auto DeleteRecord(std::string zone_id, std::string domain, RecordType type,
+                    std::string value) {
+    return Run("dns.DeleteRecord",
+               [zone_id = std::move(zone_id), domain = std::move(domain), type,
+                value = std::move(value)](DnsProvider* provider) {
+                 return provider->DeleteRecord(zone_id, domain, type, value);
+               });
+  }
+
+ private:
+  std::unique_ptr<DnsProvider> provider_;
+  std::shared_ptr<folly::CPUThreadPoolExecutor> executor_;
+};
+
+}  // namespace dns
+}  // namespace impl
+}  // namespace tbox
+
+#endif  // TBOX_IMPL_DNS_ASYNC_DNS_PROVIDER_H_
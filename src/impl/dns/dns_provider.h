@@ -50,7 +50,7 @@ class DnsProvider {
   virtual bool Init() = 0;
 
   /// @brief Get the backend identifier.
-  /// @return Backend name such as "route53" or "cloudflare".
+  /// @return Backend name such as "route53", "cloudflare" or "local".
   virtual std::string Name() const = 0;
 
   /// @brief Resolve the backend zone identifier that owns a domain.
@@ -102,7 +102,7 @@ class DnsProvider {
 std::unique_ptr<DnsProvider> CreateDnsProvider();
 
 /// @brief Build a DNS backend by name.
-/// @param name Backend name such as "route53" or "cloudflare".
+/// @param name Backend name such as "route53", "cloudflare" or "local".
 /// @return Owned backend instance, or nullptr when the name is unknown.
 std::unique_ptr<DnsProvider> CreateDnsProvider(const std::string& name);
 
@@ -10,6 +10,7 @@
 #include "src/impl/config_manager.h"
 #include "src/impl/dns/cloudflare_provider.h"
 #include "src/impl/dns/dns_provider.h"
+#include "src/impl/dns/local_provider.h"
 #include "src/impl/dns/route53_provider.h"
 
 namespace tbox {
@@ -27,8 +28,11 @@ std::unique_ptr<DnsProvider> CreateDnsProvider(const std::string& name) {
   if (name == "cloudflare") {
     return std::make_unique<CloudflareProvider>();
   }
+  if (name == "local") {
+    return std::make_unique<LocalProvider>();
+  }
   LOG(ERROR) << "Unknown DNS provider: " << name
-             << ", supported values are route53 and cloudflare";
+             << ", supported values are route53, cloudflare and local";
   return nullptr;
 }
 
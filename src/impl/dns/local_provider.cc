@@ -0,0 +1,58 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/impl/dns/local_provider.h"
+
+#include <string>
+#include <vector>
+
+namespace tbox {
+namespace impl {
+namespace dns {
+
+std::string LocalProvider::GetZoneId(const std::string& domain) {
+  // One zone per domain: the name itself.
+  return domain;
+}
+
+bool LocalProvider::ListRecords(const std::string& zone_id,
+                                const std::string& domain, RecordType type,
+                                std::vector<Record>* records) {
+  records->clear();
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = records_.find(Key(zone_id, domain, type));
+  if (it != records_.end()) {
+    records->push_back(it->second);
+  }
+  return true;
+}
+
+bool LocalProvider::UpsertRecord(const std::string& zone_id,
+                                 const std::string& domain, RecordType type,
+                                 const std::string& value, int ttl) {
+  std::lock_guard<std::mutex> lock(mu_);
+  Record& record = records_[Key(zone_id, domain, type)];
+  record.id = domain + "/" + RecordTypeToString(type);
+  record.name = domain;
+  record.value = value;
+  record.type = type;
+  record.ttl = ttl;
+  return true;
+}
+
+bool LocalProvider::DeleteRecord(const std::string& zone_id,
+                                 const std::string& domain, RecordType type,
+                                 const std::string& value) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = records_.find(Key(zone_id, domain, type));
+  if (it != records_.end() && it->second.value == value) {
+    records_.erase(it);
+  }
+  return true;
+}
+
+}  // namespace dns
+}  // namespace impl
+}  // namespace tbox
@@ -0,0 +1,55 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_IMPL_DNS_LOCAL_PROVIDER_H_
+#define TBOX_IMPL_DNS_LOCAL_PROVIDER_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "src/impl/dns/dns_provider.h"
+
+namespace tbox {
+namespace impl {
+namespace dns {
+
+/// @brief In memory implementation of the DNS backend interface.
+/// @details Keeps records in a map and never touches the network, so that
+///          DDNS updates can be exercised by benchmarks and local setups
+///          without provider credentials. Records are lost on exit.
+class LocalProvider final : public DnsProvider {
+ public:
+  bool Init() override { return true; }
+
+  std::string Name() const override { return "local"; }
+
+  std::string GetZoneId(const std::string& domain) override;
+
+  bool ListRecords(const std::string& zone_id, const std::string& domain,
+                   RecordType type, std::vector<Record>* records) override;
+
+  bool UpsertRecord(const std::string& zone_id, const std::string& domain,
+                    RecordType type, const std::string& value,
+                    int ttl) override;
+
+  bool DeleteRecord(const std::string& zone_id, const std::string& domain,
+                    RecordType type, const std::string& value) override;
+
+ private:
+  /// @brief Zone identifier, record name and type of a record set.
+  using Key = std::tuple<std::string, std::string, RecordType>;
+
+  std::mutex mu_;
+  std::map<Key, Record> records_;
+};
+
+}  // namespace dns
+}  // namespace impl
+}  // namespace tbox
+
+#endif  // TBOX_IMPL_DNS_LOCAL_PROVIDER_H_
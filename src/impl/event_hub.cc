@@ -0,0 +1,214 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/impl/event_hub.h"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "src/common/logging.h"
+#include "src/util/io_buffer.h"
+#include "src/util/util.h"
+
+namespace tbox {
+namespace impl {
+
+std::shared_ptr<EventHub> EventHub::Instance() {
+  static std::shared_ptr<EventHub> instance(new EventHub());
+  return instance;
+}
+
+EventHub::SubscriberId EventHub::Subscribe(
+    const std::set<std::string>& topics, WakeupCallback wakeup,
+    EvictCallback evict, std::shared_ptr<const FrameEncoder> encoder) {
+  auto subscriber = std::make_shared<Subscriber>();
+  subscriber->topics = topics;
+  subscriber->wakeup = std::move(wakeup);
+  subscriber->evict = std::move(evict);
+  subscriber->encoder = std::move(encoder);
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  const SubscriberId id = next_id_++;
+  subscribers_.emplace(id, std::move(subscriber));
+  return id;
+}
+
+void EventHub::Unsubscribe(SubscriberId id) {
+  std::shared_ptr<Subscriber> subscriber;
+  {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = subscribers_.find(id);
+    if (it == subscribers_.end()) {
+      return;
+    }
+    subscriber = std::move(it->second);
+    subscribers_.erase(it);
+  }
+  // A publisher may still hold a reference; make sure it queues nothing.
+  std::lock_guard<std::mutex> lock(subscriber->mutex);
+  subscriber->evicted = true;
+  subscriber->queue.clear();
+  subscriber->queued_bytes = 0;
+}
+
+size_t EventHub::Publish(const std::string& topic,
+                         const folly::dynamic& data) {
+  const int64_t seq = static_cast<int64_t>(next_seq_.fetch_add(1));
+  folly::dynamic event = folly::dynamic::object("topic", topic)("seq", seq)(
+      "time", util::Util::CurrentTimeMillis())("data", data);
+  std::string payload;
+  try {
+    payload = folly::toJson(event);
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "Failed to serialize " << topic << " event: " << e.what();
+    return 0;
+  }
+  // One frame per distinct encoder, built when its first subscriber comes
+  // up; there are only a handful of codec and dictionary combinations.
+  std::vector<std::pair<const FrameEncoder*, std::unique_ptr<folly::IOBuf>>>
+      frames;
+  auto frame_for = [&](const FrameEncoder* encoder) -> const folly::IOBuf& {
+    for (const auto& entry : frames) {
+      if (entry.first == encoder) {
+        return *entry.second;
+      }
+    }
+    std::unique_ptr<folly::IOBuf> frame =
+        encoder ? (*encoder)(payload) : nullptr;
+    if (!frame) {
+      frame = EncodeTextFrame(payload);
+    }
+    frames.emplace_back(encoder, std::move(frame));
+    return *frames.back().second;
+  };
+
+  std::vector<std::shared_ptr<Subscriber>> to_wake;
+  std::vector<std::pair<SubscriberId, std::shared_ptr<Subscriber>>> to_evict;
+  size_t queued = 0;
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (const auto& [id, subscriber] : subscribers_) {
+      if (!subscriber->topics.empty() && !subscriber->topics.count(topic)) {
+        continue;
+      }
+      const folly::IOBuf& frame = frame_for(subscriber->encoder.get());
+      const size_t frame_size = frame.length();
+      std::lock_guard<std::mutex> sub_lock(subscriber->mutex);
+      if (subscriber->evicted) {
+        continue;
+      }
+      if (subscriber->queue.size() >= options_.max_queued_events ||
+          subscriber->queued_bytes + frame_size > options_.max_queued_bytes) {
+        subscriber->evicted = true;
+        subscriber->queue.clear();
+        subscriber->queued_bytes = 0;
+        to_evict.emplace_back(id, subscriber);
+        continue;
+      }
+      subscriber->queue.push_back(frame.cloneAsValue());
+      subscriber->queued_bytes += frame_size;
+      ++queued;
+      if (!subscriber->wakeup_pending) {
+        subscriber->wakeup_pending = true;
+        to_wake.push_back(subscriber);
+      }
+    }
+  }
+
+  // Callbacks run without hub locks held, they may call back into the hub.
+  for (const auto& subscriber : to_wake) {
+    if (subscriber->wakeup) {
+      subscriber->wakeup();
+    }
+  }
+  if (!to_evict.empty()) {
+    {
+      std::unique_lock<std::shared_mutex> lock(mutex_);
+      for (const auto& entry : to_evict) {
+        subscribers_.erase(entry.first);
+      }
+    }
+    evicted_count_.fetch_add(to_evict.size());
+    for (const auto& entry : to_evict) {
+      LOG(WARNING) << "Evicting slow event subscriber " << entry.first;
+      if (entry.second->evict) {
+        entry.second->evict();
+      }
+    }
+  }
+  return queued;
+}
+
+std::unique_ptr<folly::IOBuf> EventHub::Drain(SubscriberId id) {
+  std::shared_ptr<Subscriber> subscriber;
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = subscribers_.find(id);
+    if (it == subscribers_.end()) {
+      return nullptr;
+    }
+    subscriber = it->second;
+  }
+
+  std::deque<folly::IOBuf> queue;
+  {
+    std::lock_guard<std::mutex> lock(subscriber->mutex);
+    subscriber->wakeup_pending = false;
+    queue.swap(subscriber->queue);
+    subscriber->queued_bytes = 0;
+  }
+
+  std::unique_ptr<folly::IOBuf> chain;
+  for (auto& frame : queue) {
+    auto buf = std::make_unique<folly::IOBuf>(std::move(frame));
+    if (chain) {
+      chain->prependChain(std::move(buf));
+    } else {
+      chain = std::move(buf);
+    }
+  }
+  return chain;
+}
+
+size_t EventHub::SubscriberCount() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return subscribers_.size();
+}
+
+std::unique_ptr<folly::IOBuf> EventHub::EncodeTextFrame(
+    const std::string& payload, bool compressed) {
+  const uint64_t size = payload.size();
+  size_t header_size = 2;
+  if (size > 65535) {
+    header_size += 8;
+  } else if (size > 125) {
+    header_size += 2;
+  }
+
+  // Fanned out to every subscriber, so it can outlive a slow consumer.
+  auto frame = util::NewIoBuffer(header_size + size);
+  uint8_t* out = frame->writableData();
+  // FIN + RSV1 if compressed + text opcode, server frames are never masked.
+  *out++ = compressed ? 0xC1 : 0x81;
+  if (size <= 125) {
+    *out++ = static_cast<uint8_t>(size);
+  } else if (size <= 65535) {
+    *out++ = 126;
+    *out++ = static_cast<uint8_t>(size >> 8);
+    *out++ = static_cast<uint8_t>(size);
+  } else {
+    *out++ = 127;
+    for (int i = 7; i >= 0; --i) {
+      *out++ = static_cast<uint8_t>(size >> (8 * i));
+    }
+  }
+  memcpy(out, payload.data(), size);
+  frame->append(header_size + size);
+  return frame;
+}
+
+}  // namespace impl
+}  // namespace tbox
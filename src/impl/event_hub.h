@@ -0,0 +1,118 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_IMPL_EVENT_HUB_H_
+#define TBOX_IMPL_EVENT_HUB_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "folly/io/IOBuf.h"
+#include "folly/json.h"
+
+namespace tbox {
+namespace impl {
+
+/// @brief Publish/subscribe hub behind the /ws endpoint.
+/// @details Each event is serialized once, as an unmasked WebSocket text
+///          frame holding {"topic","seq","time","data"}, into one refcounted
+///          IOBuf. Subscribers queue clones of it that share the buffer, so
+///          fan-out to thousands of connections copies no payload bytes.
+///          Subscribers that negotiated compression pass a FrameEncoder;
+///          each distinct encoder runs once per event and its frame is
+///          shared the same way.
+///
+///          Every subscriber has a bounded queue. The hub calls its wakeup
+///          callback once when the queue turns non-empty; the subscriber
+///          then drains on its own thread. A subscriber that lets its queue
+///          grow past the bounds (a stalled socket, a paused transport) is
+///          removed and told so through its evict callback, so one slow
+///          consumer never holds memory or delays the others.
+class EventHub final {
+ public:
+  struct Options {
+    size_t max_queued_events = 1024;
+    size_t max_queued_bytes = 4 * 1024 * 1024;
+  };
+
+  using SubscriberId = uint64_t;
+  /// Called from the publishing thread, must only schedule work.
+  using WakeupCallback = std::function<void()>;
+  using EvictCallback = std::function<void()>;
+  /// Builds the frame for an event's JSON payload. Subscribers passing the
+  /// same encoder object share one frame per event.
+  using FrameEncoder =
+      std::function<std::unique_ptr<folly::IOBuf>(const std::string&)>;
+
+  static constexpr const char* kTopicClient = "client";
+  static constexpr const char* kTopicCert = "cert";
+  static constexpr const char* kTopicDdns = "ddns";
+
+  static std::shared_ptr<EventHub> Instance();
+
+  explicit EventHub(const Options& options = Options()) : options_(options) {}
+
+  /// @param topics Topics to receive, empty for all of them.
+  /// @param encoder Frame encoder, nullptr for EncodeTextFrame.
+  SubscriberId Subscribe(
+      const std::set<std::string>& topics, WakeupCallback wakeup,
+      EvictCallback evict,
+      std::shared_ptr<const FrameEncoder> encoder = nullptr);
+
+  void Unsubscribe(SubscriberId id);
+
+  /// @brief Serialize data once and queue it for every subscriber of topic.
+  /// @return Number of subscribers the event was queued for.
+  size_t Publish(const std::string& topic, const folly::dynamic& data);
+
+  /// @brief Take everything queued for id as one chain, ready to write.
+  /// @return nullptr if nothing is queued or id is no longer subscribed.
+  std::unique_ptr<folly::IOBuf> Drain(SubscriberId id);
+
+  size_t SubscriberCount() const;
+
+  /// @brief Subscribers dropped for falling behind since startup.
+  uint64_t EvictedCount() const { return evicted_count_.load(); }
+
+  /// @brief Encode payload as a single unmasked text frame.
+  /// @param compressed Set RSV1, payload is compressed per RFC 7692.
+  static std::unique_ptr<folly::IOBuf> EncodeTextFrame(
+      const std::string& payload, bool compressed = false);
+
+ private:
+  struct Subscriber {
+    std::set<std::string> topics;
+    WakeupCallback wakeup;
+    EvictCallback evict;
+    std::shared_ptr<const FrameEncoder> encoder;
+
+    std::mutex mutex;
+    std::deque<folly::IOBuf> queue;
+    size_t queued_bytes = 0;
+    bool wakeup_pending = false;
+    bool evicted = false;
+  };
+
+  Options options_;
+  mutable std::shared_mutex mutex_;
+  std::unordered_map<SubscriberId, std::shared_ptr<Subscriber>> subscribers_;
+  SubscriberId next_id_ = 1;
+  std::atomic<uint64_t> next_seq_{1};
+  std::atomic<uint64_t> evicted_count_{0};
+};
+
+}  // namespace impl
+}  // namespace tbox
+
+#endif  // TBOX_IMPL_EVENT_HUB_H_
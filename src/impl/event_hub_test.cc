@@ -0,0 +1,151 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/impl/event_hub.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace impl {
+namespace {
+
+std::string ToString(const folly::IOBuf& buf) {
+  return buf.cloneAsValue().moveToFbString().toStdString();
+}
+
+// Payload of every frame in chain, which holds one event per element.
+std::vector<std::string> Payloads(const folly::IOBuf& chain) {
+  std::vector<std::string> payloads;
+  const folly::IOBuf* buf = &chain;
+  do {
+    const std::string frame(reinterpret_cast<const char*>(buf->data()),
+                            buf->length());
+    EXPECT_EQ(static_cast<uint8_t>(frame[0]), 0x81);
+    const uint8_t length = frame[1];
+    const size_t offset = length < 126 ? 2 : (length == 126 ? 4 : 10);
+    payloads.push_back(frame.substr(offset));
+    buf = buf->next();
+  } while (buf != &chain);
+  return payloads;
+}
+
+TEST(EventHub, EncodeTextFrame) {
+  for (const size_t size : {size_t(0), size_t(125), size_t(126),
+                            size_t(65535), size_t(65536)}) {
+    const std::string payload(size, 'x');
+    const auto frame = EventHub::EncodeTextFrame(payload);
+    const std::string bytes = ToString(*frame);
+    ASSERT_EQ(Payloads(*frame), std::vector<std::string>{payload});
+    EXPECT_EQ(bytes.size() - payload.size(),
+              size < 126 ? 2u : (size < 65536 ? 4u : 10u));
+  }
+}
+
+TEST(EventHub, FanOutSharesOneBuffer) {
+  EventHub hub;
+  int wakeups = 0;
+  std::vector<EventHub::SubscriberId> ids;
+  for (int i = 0; i < 100; ++i) {
+    ids.push_back(hub.Subscribe({}, [&] { ++wakeups; }, nullptr));
+  }
+  const auto cert_only =
+      hub.Subscribe({EventHub::kTopicCert}, [&] { ++wakeups; }, nullptr);
+
+  EXPECT_EQ(hub.Publish(EventHub::kTopicClient,
+                        folly::dynamic::object("client_id", "a")),
+            100);
+  EXPECT_EQ(hub.Publish(EventHub::kTopicClient,
+                        folly::dynamic::object("client_id", "b")),
+            100);
+  // One wakeup per subscriber until it drains.
+  EXPECT_EQ(wakeups, 100);
+  EXPECT_EQ(hub.Drain(cert_only), nullptr);
+
+  const uint8_t* shared = nullptr;
+  for (const auto id : ids) {
+    const auto chain = hub.Drain(id);
+    ASSERT_NE(chain, nullptr);
+    ASSERT_EQ(chain->countChainElements(), 2);
+    if (!shared) {
+      shared = chain->data();
+    }
+    // Every subscriber points at the same serialized event.
+    EXPECT_EQ(chain->data(), shared);
+    const auto payloads = Payloads(*chain);
+    const auto first = folly::parseJson(payloads[0]);
+    EXPECT_EQ(first["topic"].asString(), "client");
+    EXPECT_EQ(first["data"]["client_id"].asString(), "a");
+    EXPECT_LT(first["seq"].asInt(),
+              folly::parseJson(payloads[1])["seq"].asInt());
+    EXPECT_EQ(hub.Drain(id), nullptr);
+  }
+
+  hub.Publish(EventHub::kTopicCert, folly::dynamic::object("domain", "x"));
+  EXPECT_EQ(wakeups, 201);
+  EXPECT_NE(hub.Drain(cert_only), nullptr);
+}
+
+TEST(EventHub, EncoderRunsOncePerEvent) {
+  EventHub hub;
+  int encoded = 0;
+  const auto encoder = std::make_shared<const EventHub::FrameEncoder>(
+      [&](const std::string& payload) {
+        ++encoded;
+        return EventHub::EncodeTextFrame("z:" + payload, true);
+      });
+  std::vector<EventHub::SubscriberId> ids;
+  for (int i = 0; i < 10; ++i) {
+    ids.push_back(hub.Subscribe({}, nullptr, nullptr, encoder));
+  }
+  const auto plain = hub.Subscribe({}, nullptr, nullptr);
+
+  EXPECT_EQ(hub.Publish(EventHub::kTopicDdns, folly::dynamic::object()), 11);
+  EXPECT_EQ(encoded, 1);
+
+  const auto first = hub.Drain(ids[0]);
+  ASSERT_NE(first, nullptr);
+  // RSV1 marks the encoded frame as compressed.
+  EXPECT_EQ(first->data()[0], 0xC1);
+  EXPECT_EQ(ToString(*first).substr(2, 2), "z:");
+  for (size_t i = 1; i < ids.size(); ++i) {
+    EXPECT_EQ(hub.Drain(ids[i])->data(), first->data());
+  }
+  const auto plain_frame = hub.Drain(plain);
+  ASSERT_NE(plain_frame, nullptr);
+  EXPECT_EQ(plain_frame->data()[0], 0x81);
+}
+
+TEST(EventHub, EvictsSlowConsumer) {
+  EventHub::Options options;
+  options.max_queued_events = 4;
+  EventHub hub(options);
+  bool slow_evicted = false;
+  bool fast_evicted = false;
+  const auto slow =
+      hub.Subscribe({}, nullptr, [&] { slow_evicted = true; });
+  const auto fast =
+      hub.Subscribe({}, nullptr, [&] { fast_evicted = true; });
+
+  for (int i = 0; i < 10; ++i) {
+    hub.Publish(EventHub::kTopicDdns, folly::dynamic::object("seq", i));
+    ASSERT_NE(hub.Drain(fast), nullptr);
+  }
+  EXPECT_TRUE(slow_evicted);
+  EXPECT_FALSE(fast_evicted);
+  EXPECT_EQ(hub.EvictedCount(), 1);
+  EXPECT_EQ(hub.SubscriberCount(), 1);
+  EXPECT_EQ(hub.Drain(slow), nullptr);
+
+  hub.Unsubscribe(fast);
+  EXPECT_EQ(hub.SubscriberCount(), 0);
+  EXPECT_EQ(hub.Publish(EventHub::kTopicDdns, folly::dynamic::object()), 0);
+}
+
+}  // namespace
+}  // namespace impl
+}  // namespace tbox
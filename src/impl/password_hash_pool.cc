@@ -0,0 +1,38 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/impl/password_hash_pool.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "folly/executors/task_queue/LifoSemMPMCQueue.h"
+#include "folly/executors/thread_factory/NamedThreadFactory.h"
+
+namespace tbox {
+namespace impl {
+
+std::shared_ptr<PasswordHashPool> PasswordHashPool::Instance() {
+  static std::shared_ptr<PasswordHashPool> instance(new PasswordHashPool());
+  return instance;
+}
+
+PasswordHashPool::PasswordHashPool(size_t threads, size_t max_queued) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (max_queued == 0) {
+    max_queued = threads * kQueuedPerThread;
+  }
+  executor_ = std::make_shared<folly::CPUThreadPoolExecutor>(
+      threads,
+      std::make_unique<folly::LifoSemMPMCQueue<
+          folly::CPUThreadPoolExecutor::CPUTask,
+          folly::QueueBehaviorIfFull::THROW>>(max_queued),
+      std::make_shared<folly::NamedThreadFactory>("PasswordHash"));
+}
+
+}  // namespace impl
+}  // namespace tbox
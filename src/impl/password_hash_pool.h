@@ -0,0 +1,82 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_IMPL_PASSWORD_HASH_POOL_H_
+#define TBOX_IMPL_PASSWORD_HASH_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "folly/executors/CPUThreadPoolExecutor.h"
+#include "folly/executors/task_queue/BlockingQueue.h"
+#include "src/common/task.h"
+#include "src/util/util.h"
+
+namespace tbox {
+namespace impl {
+
+/// @brief Worker threads for password hashing and the account operations
+///        built on it.
+/// @details PBKDF2 takes milliseconds on purpose. Coroutine handlers
+///          co_await these calls so the hashing runs here while their event
+///          thread keeps serving other requests; they resume through their
+///          own Resumer. The queue is bounded so that a flood of logins is
+///          shed instead of piling up jobs: once max_queued jobs wait, co_await
+///          throws folly::QueueFullException without running fn.
+class PasswordHashPool final {
+ public:
+  /// @brief Queued jobs per worker when max_queued is 0.
+  static constexpr size_t kQueuedPerThread = 64;
+
+  static std::shared_ptr<PasswordHashPool> Instance();
+
+  /// @param threads Worker count, 0 for one per hardware thread.
+  /// @param max_queued Jobs waiting for a worker before Run rejects, 0 for
+  ///        kQueuedPerThread per worker.
+  explicit PasswordHashPool(size_t threads = 0, size_t max_queued = 0);
+
+  /// @brief Runs fn, which may block, on the pool; co_await yields its
+  ///        result, or throws folly::QueueFullException if the queue is
+  ///        full. fn must not refer to state the awaiting coroutine can
+  ///        lose, such as an RPC's request, by reference.
+  template <typename F>
+  auto Run(F fn) {
+    return common::Offload(
+        [executor = executor_](auto task) { executor->add(std::move(task)); },
+        std::move(fn));
+  }
+
+  /// @brief co_await yields the hex encoded hash, empty on failure.
+  auto Hash(std::string password, std::string salt) {
+    return Run([password = std::move(password), salt = std::move(salt)] {
+      std::string hash;
+      if (!util::Util::HashPassword(password, salt, &hash)) {
+        hash.clear();
+      }
+      return hash;
+    });
+  }
+
+  /// @brief co_await yields whether password hashes to stored_hash.
+  auto Verify(std::string password, std::string salt,
+              std::string stored_hash) {
+    return Run([password = std::move(password), salt = std::move(salt),
+                stored_hash = std::move(stored_hash)] {
+      return util::Util::VerifyPassword(password, salt, stored_hash);
+    });
+  }
+
+  size_t threads() const { return executor_->numThreads(); }
+
+ private:
+  std::shared_ptr<folly::CPUThreadPoolExecutor> executor_;
+};
+
+}  // namespace impl
+}  // namespace tbox
+
+#endif  // TBOX_IMPL_PASSWORD_HASH_POOL_H_
@@ -0,0 +1,129 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/impl/password_hash_pool.h"
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace impl {
+namespace {
+
+// Resumes root tasks on the thread calling RunUntil() the way an RPC's
+// event queue would.
+class ResumeQueue {
+ public:
+  common::Resumer resumer() {
+    return [this](std::coroutine_handle<> handle) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.push_back(handle);
+      cv_.notify_one();
+    };
+  }
+
+  void RunUntil(const std::function<bool()>& done) {
+    while (!done()) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return !pending_.empty(); });
+      const auto handle = pending_.front();
+      pending_.pop_front();
+      lock.unlock();
+      handle.resume();
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::coroutine_handle<>> pending_;
+};
+
+// Runs a root task to completion on this thread.
+template <typename T>
+T Wait(common::Task<T>* task) {
+  ResumeQueue queue;
+  task->Start(queue.resumer());
+  queue.RunUntil([task] { return task->done(); });
+  return task->Result();
+}
+
+TEST(PasswordHashPool, HashesOffTheCallingThread) {
+  PasswordHashPool pool(2);
+  const std::string password = util::Util::SHA256("admin");
+  const std::string salt = util::Util::GenerateSalt();
+  std::string expected;
+  ASSERT_TRUE(util::Util::HashPassword(password, salt, &expected));
+
+  const auto caller = std::this_thread::get_id();
+  auto coroutine = [&]() -> common::Task<std::string> {
+    const auto worker =
+        co_await pool.Run([] { return std::this_thread::get_id(); });
+    EXPECT_NE(worker, caller);
+    std::string hash = co_await pool.Hash(password, salt);
+    EXPECT_EQ(std::this_thread::get_id(), caller);
+    const bool match = co_await pool.Verify(password, salt, hash);
+    EXPECT_TRUE(match);
+    co_return hash;
+  };
+  auto task = coroutine();
+  EXPECT_EQ(Wait(&task), expected);
+}
+
+TEST(PasswordHashPool, RunPropagatesExceptions) {
+  PasswordHashPool pool(1);
+  auto coroutine = [&]() -> common::Task<int> {
+    co_return co_await pool.Run([]() -> int {
+      throw std::runtime_error("failed");
+    });
+  };
+  auto task = coroutine();
+  EXPECT_THROW(Wait(&task), std::runtime_error);
+}
+
+TEST(PasswordHashPool, RejectsWhenQueueIsFull) {
+  PasswordHashPool pool(/*threads=*/1, /*max_queued=*/1);
+  std::promise<void> started;
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  auto run = [&pool](std::function<int()> fn) -> common::Task<int> {
+    co_return co_await pool.Run(std::move(fn));
+  };
+  ResumeQueue queue;
+
+  auto busy = run([&started, released] {
+    started.set_value();
+    released.wait();
+    return 1;
+  });
+  busy.Start(queue.resumer());
+  started.get_future().wait();
+  auto queued = run([] { return 2; });
+  queued.Start(queue.resumer());
+
+  // The worker is busy and the queue holds one job.
+  auto rejected = run([] { return 3; });
+  rejected.Start(queue.resumer());
+  ASSERT_TRUE(rejected.done());
+  EXPECT_THROW(rejected.Result(), folly::QueueFullException);
+
+  release.set_value();
+  queue.RunUntil([&] { return busy.done() && queued.done(); });
+  EXPECT_EQ(busy.Result(), 1);
+  EXPECT_EQ(queued.Result(), 2);
+}
+
+}  // namespace
+}  // namespace impl
+}  // namespace tbox
@@ -7,6 +7,7 @@
 #define TBOX_IMPL_SESSION_MANAGER_H
 
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -14,6 +15,8 @@
 #include "absl/synchronization/mutex.h"
 #include "src/common/logging.h"
 #include "src/common/defs.h"
+#include "src/common/metrics.h"
+#include "src/common/trace.h"
 #include "src/util/util.h"
 
 namespace tbox {
@@ -41,7 +44,13 @@ class Session final {
  */
 class SessionManager final {
  private:
-  SessionManager() {}
+  SessionManager() {
+    sessions_gauge_ = metrics::Registry::Instance()->AddCallbackGauge(
+        "tbox_sessions", "Logged in sessions.", {}, [this]() {
+          absl::MutexLock locker(lock_);
+          return static_cast<double>(token_sessions_.size());
+        });
+  }
 
  public:
   /**
@@ -50,7 +59,9 @@ class SessionManager final {
    */
   static std::shared_ptr<SessionManager> Instance();
 
-  ~SessionManager() {}
+  ~SessionManager() {
+    metrics::Registry::Instance()->RemoveCallbackGauge(sessions_gauge_);
+  }
 
   /**
    * @brief Initialize session manager.
@@ -85,6 +96,7 @@ class SessionManager final {
     if (token.empty()) {
       return false;
     }
+    trace::ScopedSpan span("session.validate");
     absl::MutexLock locker(lock_);
     auto token_it = token_sessions_.find(token);
     if (token_it == token_sessions_.end()) {
@@ -156,6 +168,7 @@ class SessionManager final {
   std::atomic<bool> stop_ = false;
   std::unordered_map<std::string, Session> token_sessions_;
   std::unordered_map<std::string, Session> user_sessions_;
+  uint64_t sessions_gauge_ = 0;
 };
 
 }  // namespace impl
@@ -0,0 +1,394 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/impl/sync/delta_sync.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "blake3.h"
+#include "src/common/logging.h"
+#include "src/impl/sync/dir_scanner.h"
+#include "src/util/util.h"
+
+namespace tbox {
+namespace impl {
+namespace sync {
+
+namespace {
+
+std::string StrongChecksum(std::string_view data) {
+  uint8_t hash[DeltaSync::kStrongSize];
+  blake3_hasher hasher;
+  blake3_hasher_init(&hasher);
+  blake3_hasher_update(&hasher, data.data(), data.size());
+  blake3_hasher_finalize(&hasher, hash, sizeof(hash));
+  return std::string(reinterpret_cast<const char*>(hash), sizeof(hash));
+}
+
+// Same encoding as util::Util::Blake3, without copying data into a string.
+std::string TargetHash(std::string_view data) {
+  uint8_t hash[BLAKE3_OUT_LEN];
+  blake3_hasher hasher;
+  blake3_hasher_init(&hasher);
+  blake3_hasher_update(&hasher, data.data(), data.size());
+  blake3_hasher_finalize(&hasher, hash, BLAKE3_OUT_LEN);
+  std::string hex;
+  util::Util::ToHexStr(
+      std::string(reinterpret_cast<const char*>(hash), BLAKE3_OUT_LEN), &hex);
+  return hex;
+}
+
+void AppendLiteral(std::string_view data, proto::FileDelta* delta) {
+  if (data.empty()) {
+    return;
+  }
+  const int last = delta->ops_size() - 1;
+  if (last >= 0 && delta->ops(last).block_count() == 0) {
+    delta->mutable_ops(last)->mutable_literal()->append(data);
+    return;
+  }
+  delta->add_ops()->mutable_literal()->assign(data);
+}
+
+void AppendCopy(uint64_t index, proto::FileDelta* delta) {
+  if (delta->ops_size() > 0) {
+    auto* last = delta->mutable_ops(delta->ops_size() - 1);
+    if (last->block_count() > 0 &&
+        last->block_index() + last->block_count() == index) {
+      last->set_block_count(last->block_count() + 1);
+      return;
+    }
+  }
+  auto* op = delta->add_ops();
+  op->set_block_index(index);
+  op->set_block_count(1);
+}
+
+bool ReadFile(const std::string& path, std::string* content) {
+  content->clear();
+  std::error_code ec;
+  if (!std::filesystem::exists(path, ec)) {
+    return true;
+  }
+  std::ifstream in(path, std::ios::binary);
+  if (!in.is_open()) {
+    LOG(ERROR) << "Failed to open file: " << path;
+    return false;
+  }
+  content->assign(std::istreambuf_iterator<char>(in),
+                  std::istreambuf_iterator<char>());
+  return !in.bad();
+}
+
+}  // namespace
+
+uint32_t DeltaSync::ChooseBlockSize(uint64_t file_size) {
+  const auto size = static_cast<uint64_t>(std::sqrt(file_size));
+  // Round up to a multiple of 8 so blocks stay nicely aligned.
+  const uint64_t aligned = (size + 7) & ~uint64_t{7};
+  return static_cast<uint32_t>(std::clamp<uint64_t>(
+      aligned, kMinBlockSize, kMaxBlockSize));
+}
+
+uint32_t DeltaSync::WeakChecksum(std::string_view data) {
+  RollingChecksum checksum;
+  checksum.Reset(data);
+  return checksum.Value();
+}
+
+bool DeltaSync::ComputeSignature(std::string_view basis, uint32_t block_size,
+                                 proto::FileSignature* signature) {
+  signature->Clear();
+  if (block_size == 0) {
+    block_size = ChooseBlockSize(basis.size());
+  }
+  signature->set_block_size(block_size);
+  signature->set_file_size(basis.size());
+  signature->mutable_blocks()->Reserve(
+      static_cast<int>((basis.size() + block_size - 1) / block_size));
+  for (size_t offset = 0; offset < basis.size(); offset += block_size) {
+    const auto block = basis.substr(offset, block_size);
+    auto* sig = signature->add_blocks();
+    sig->set_weak(WeakChecksum(block));
+    sig->set_strong(StrongChecksum(block));
+  }
+  return true;
+}
+
+bool DeltaSync::ComputeDelta(const proto::FileSignature& signature,
+                             std::string_view target,
+                             proto::FileDelta* delta) {
+  delta->Clear();
+  // The signature comes from the peer: its block count must match the file
+  // size it claims, or the lookups below would run past the blocks.
+  const uint32_t block_size = signature.block_size();
+  if (block_size == 0) {
+    if (signature.blocks_size() > 0 || signature.file_size() > 0) {
+      LOG(ERROR) << "Invalid signature block size";
+      return false;
+    }
+  } else if (block_size < kMinBlockSize || block_size > kMaxBlockSize ||
+             static_cast<uint64_t>(signature.blocks_size()) !=
+                 signature.file_size() / block_size +
+                     (signature.file_size() % block_size != 0)) {
+    LOG(ERROR) << "Invalid signature, block size " << block_size << ", "
+               << signature.blocks_size() << " blocks for "
+               << signature.file_size() << " bytes";
+    return false;
+  }
+  delta->set_block_size(block_size);
+  delta->set_target_size(target.size());
+  delta->set_target_hash(TargetHash(target));
+
+  if (signature.blocks_size() == 0) {
+    AppendLiteral(target, delta);
+    return true;
+  }
+
+  // Only full blocks take part in the rolling search; a short trailing basis
+  // block is matched once against the tail of the target.
+  const uint64_t full_blocks = signature.file_size() / block_size;
+  const uint32_t tail_size = signature.file_size() % block_size;
+  std::unordered_multimap<uint32_t, uint64_t> index;
+  index.reserve(full_blocks);
+  for (uint64_t i = 0; i < full_blocks; ++i) {
+    index.emplace(signature.blocks(i).weak(), i);
+  }
+
+  size_t literal_start = 0;
+  size_t pos = 0;
+  RollingChecksum checksum;
+  checksum.Reset(target.substr(0, block_size));
+  while (pos + block_size <= target.size()) {
+    bool matched = false;
+    auto range = index.equal_range(checksum.Value());
+    if (range.first != range.second) {
+      const std::string strong =
+          StrongChecksum(target.substr(pos, block_size));
+      // Prefer the block right after the previous match so runs of
+      // unchanged blocks collapse into one copy op.
+      uint64_t hit = UINT64_MAX;
+      for (auto it = range.first; it != range.second; ++it) {
+        if (signature.blocks(it->second).strong() != strong) {
+          continue;
+        }
+        if (hit == UINT64_MAX) {
+          hit = it->second;
+        }
+        if (delta->ops_size() > 0) {
+          const auto& last = delta->ops(delta->ops_size() - 1);
+          if (last.block_count() > 0 &&
+              last.block_index() + last.block_count() == it->second) {
+            hit = it->second;
+            break;
+          }
+        }
+      }
+      if (hit != UINT64_MAX) {
+        AppendLiteral(target.substr(literal_start, pos - literal_start),
+                      delta);
+        AppendCopy(hit, delta);
+        pos += block_size;
+        literal_start = pos;
+        matched = true;
+        if (pos + block_size <= target.size()) {
+          checksum.Reset(target.substr(pos, block_size));
+        }
+      }
+    }
+    if (!matched) {
+      if (pos + block_size < target.size()) {
+        checksum.Roll(static_cast<uint8_t>(target[pos]),
+                      static_cast<uint8_t>(target[pos + block_size]));
+      }
+      ++pos;
+    }
+  }
+
+  if (tail_size > 0 && target.size() - literal_start >= tail_size) {
+    const size_t tail_pos = target.size() - tail_size;
+    const auto& tail_sig = signature.blocks(static_cast<int>(full_blocks));
+    const auto tail = target.substr(tail_pos);
+    if (WeakChecksum(tail) == tail_sig.weak() &&
+        StrongChecksum(tail) == tail_sig.strong()) {
+      AppendLiteral(target.substr(literal_start, tail_pos - literal_start),
+                    delta);
+      AppendCopy(full_blocks, delta);
+      return true;
+    }
+  }
+  AppendLiteral(target.substr(literal_start), delta);
+  return true;
+}
+
+bool DeltaSync::ApplyDelta(std::string_view basis,
+                           const proto::FileDelta& delta, std::string* out) {
+  out->clear();
+  out->reserve(delta.target_size());
+  const uint64_t block_size = delta.block_size();
+  for (const auto& op : delta.ops()) {
+    if (op.block_count() == 0) {
+      out->append(op.literal());
+      continue;
+    }
+    const uint64_t offset = op.block_index() * block_size;
+    if (block_size == 0 || offset >= basis.size()) {
+      LOG(ERROR) << "Delta references block outside basis: "
+                 << op.block_index();
+      return false;
+    }
+    out->append(basis.substr(offset, op.block_count() * block_size));
+  }
+  if (out->size() != delta.target_size() ||
+      TargetHash(*out) != delta.target_hash()) {
+    LOG(ERROR) << "Delta result mismatch, expected size "
+               << delta.target_size() << ", got " << out->size();
+    return false;
+  }
+  return true;
+}
+
+bool DeltaSync::FileSignature(const std::string& path, uint32_t block_size,
+                              proto::FileSignature* signature) {
+  std::string content;
+  if (!ReadFile(path, &content)) {
+    return false;
+  }
+  return ComputeSignature(content, block_size, signature);
+}
+
+uint64_t DeltaSync::LiteralBytes(const proto::FileDelta& delta) {
+  uint64_t bytes = 0;
+  for (const auto& op : delta.ops()) {
+    bytes += op.literal().size();
+  }
+  return bytes;
+}
+
+bool DeltaSync::SyncFile(const std::string& source, const std::string& dest,
+                         uint64_t* literal_bytes) {
+  if (literal_bytes) {
+    *literal_bytes = 0;
+  }
+  std::string target;
+  std::string basis;
+  if (!ReadFile(source, &target) || !ReadFile(dest, &basis)) {
+    return false;
+  }
+  if (basis.size() == target.size() &&
+      TargetHash(basis) == TargetHash(target)) {
+    return true;
+  }
+
+  proto::FileSignature signature;
+  proto::FileDelta delta;
+  std::string rebuilt;
+  if (!ComputeSignature(basis, 0, &signature) ||
+      !ComputeDelta(signature, target, &delta) ||
+      !ApplyDelta(basis, delta, &rebuilt)) {
+    return false;
+  }
+  if (literal_bytes) {
+    *literal_bytes = LiteralBytes(delta);
+  }
+
+  std::error_code ec;
+  const std::filesystem::path dest_path(dest);
+  if (dest_path.has_parent_path()) {
+    std::filesystem::create_directories(dest_path.parent_path(), ec);
+  }
+  const std::string tmp = dest + ".tbox-sync";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out.is_open() ||
+        !out.write(rebuilt.data(), static_cast<std::streamsize>(
+                                       rebuilt.size()))) {
+      LOG(ERROR) << "Failed to write file: " << tmp;
+      std::filesystem::remove(tmp, ec);
+      return false;
+    }
+  }
+  std::filesystem::rename(tmp, dest, ec);
+  if (ec) {
+    LOG(ERROR) << "Failed to rename " << tmp << " to " << dest << ": "
+               << ec.message();
+    std::filesystem::remove(tmp, ec);
+    return false;
+  }
+  return true;
+}
+
+bool DeltaSync::SyncPair(const proto::SyncPair& pair,
+                         const std::string& index_path) {
+  namespace fs = std::filesystem;
+  std::error_code ec;
+  const fs::path source_dir(pair.source_dir());
+  if (!fs::is_directory(source_dir, ec)) {
+    LOG(ERROR) << "Sync source is not a directory: " << pair.source_dir();
+    return false;
+  }
+
+  bool ret = true;
+  uint64_t total_literal = 0;
+  auto sync = [&](const std::string& relative) {
+    const fs::path source = source_dir / relative;
+    bool synced = true;
+    for (const auto& dest_dir : pair.dest_dirs()) {
+      uint64_t literal = 0;
+      const fs::path dest = fs::path(dest_dir) / relative;
+      if (!SyncFile(source.string(), dest.string(), &literal)) {
+        LOG(ERROR) << "Failed to sync " << source << " to " << dest;
+        synced = false;
+      }
+      total_literal += literal;
+    }
+    ret = ret && synced;
+    return synced;
+  };
+
+  if (!index_path.empty()) {
+    // Files are synced before the index is saved, and those that failed
+    // stay out of date in it, so the next run retries them.
+    std::vector<std::string> files;
+    ScanStats stats;
+    if (!DirScanner().Update(pair.source_dir(), index_path, &files, &stats,
+                             sync)) {
+      return false;
+    }
+    LOG(INFO) << "Scanned " << pair.source_dir() << ", files " << stats.files
+              << ", hashed " << stats.hashed << ", changed " << files.size();
+  } else {
+    std::vector<std::string> files;
+    fs::recursive_directory_iterator it(
+        source_dir, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::recursive_directory_iterator();
+         it.increment(ec)) {
+      if (it->is_regular_file(ec)) {
+        files.push_back(fs::relative(it->path(), source_dir, ec).string());
+      }
+    }
+    if (ec) {
+      LOG(ERROR) << "Failed to walk " << pair.source_dir() << ": "
+                 << ec.message();
+      return false;
+    }
+    for (const auto& relative : files) {
+      sync(relative);
+    }
+  }
+  LOG(INFO) << "Synced " << pair.source_dir() << ", literal bytes "
+            << total_literal;
+  return ret;
+}
+
+}  // namespace sync
+}  // namespace impl
+}  // namespace tbox
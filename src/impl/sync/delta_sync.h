@@ -0,0 +1,118 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_IMPL_SYNC_DELTA_SYNC_H_
+#define TBOX_IMPL_SYNC_DELTA_SYNC_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "src/proto/service.pb.h"
+#include "src/proto/syncer_config.pb.h"
+
+namespace tbox {
+namespace impl {
+namespace sync {
+
+/// @brief rsync style block level delta engine.
+/// @details The receiver splits its copy (the basis) into fixed size blocks
+///          and sends a FileSignature holding a rolling checksum and a
+///          truncated BLAKE3 digest per block. The sender slides a window over
+///          its copy (the target), looks every window up by rolling checksum,
+///          confirms candidates with BLAKE3 and emits a FileDelta made of
+///          block references and literal bytes. Transfer size is therefore
+///          proportional to the change, not to the file.
+class DeltaSync final {
+ public:
+  static constexpr uint32_t kMinBlockSize = 512;
+  static constexpr uint32_t kMaxBlockSize = 128 * 1024;
+  /// Bytes of the BLAKE3 digest kept per block.
+  static constexpr uint32_t kStrongSize = 16;
+
+  /// @brief Pick a block size for a file, roughly sqrt(file_size).
+  static uint32_t ChooseBlockSize(uint64_t file_size);
+
+  /// @brief Rolling checksum of data, see RollingChecksum.
+  static uint32_t WeakChecksum(std::string_view data);
+
+  /// @brief Build the signature of a basis buffer.
+  /// @param block_size Block size, 0 to pick one with ChooseBlockSize.
+  static bool ComputeSignature(std::string_view basis, uint32_t block_size,
+                               proto::FileSignature* signature);
+
+  /// @brief Build the delta that turns the signed basis into target.
+  /// @return False for a malformed signature: a block size outside
+  ///         [kMinBlockSize, kMaxBlockSize] or a block count that does not
+  ///         cover file_size().
+  static bool ComputeDelta(const proto::FileSignature& signature,
+                           std::string_view target, proto::FileDelta* delta);
+
+  /// @brief Rebuild the target from basis and delta.
+  /// @return False if the delta references blocks outside basis or the result
+  ///         does not match delta.target_hash().
+  static bool ApplyDelta(std::string_view basis, const proto::FileDelta& delta,
+                         std::string* out);
+
+  /// @brief Signature of a file, a missing file has an empty signature.
+  static bool FileSignature(const std::string& path, uint32_t block_size,
+                            proto::FileSignature* signature);
+
+  /// @brief Bring dest up to date with source through a local delta.
+  /// @details Unchanged files are detected by size and BLAKE3 and left
+  ///          untouched. Otherwise the rebuilt file is written next to dest
+  ///          and renamed over it, so readers never see a partial file.
+  /// @param literal_bytes If not null, receives the number of bytes that had
+  ///        to be copied from source rather than reused from dest.
+  static bool SyncFile(const std::string& source, const std::string& dest,
+                       uint64_t* literal_bytes = nullptr);
+
+  /// @brief Sync every regular file of pair.source_dir() into each of
+  ///        pair.dest_dirs(), keeping relative paths.
+  /// @param index_path If not empty, the source is walked by DirScanner and
+  ///        only files that changed since the index at index_path was last
+  ///        written are synced. Destinations are then assumed to be modified
+  ///        by this syncer only.
+  static bool SyncPair(const proto::SyncPair& pair,
+                       const std::string& index_path = "");
+
+  /// @brief Number of literal bytes carried by a delta.
+  static uint64_t LiteralBytes(const proto::FileDelta& delta);
+};
+
+/// @brief rsync rolling checksum over a fixed size window.
+/// @details a is the byte sum and b the position weighted sum, both mod 2^16.
+///          Roll() moves the window by one byte in O(1).
+class RollingChecksum final {
+ public:
+  void Reset(std::string_view window) {
+    a_ = 0;
+    b_ = 0;
+    len_ = static_cast<uint32_t>(window.size());
+    uint32_t i = len_;
+    for (const char c : window) {
+      a_ += static_cast<uint8_t>(c);
+      b_ += i-- * static_cast<uint8_t>(c);
+    }
+  }
+
+  void Roll(uint8_t out, uint8_t in) {
+    a_ += in - out;
+    b_ += a_ - len_ * out;
+  }
+
+  uint32_t Value() const { return (a_ & 0xffff) | (b_ << 16); }
+
+ private:
+  uint32_t a_ = 0;
+  uint32_t b_ = 0;
+  uint32_t len_ = 0;
+};
+
+}  // namespace sync
+}  // namespace impl
+}  // namespace tbox
+
+#endif  // TBOX_IMPL_SYNC_DELTA_SYNC_H_
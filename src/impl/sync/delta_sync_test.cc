@@ -0,0 +1,163 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/impl/sync/delta_sync.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace impl {
+namespace sync {
+namespace {
+
+std::string RandomData(size_t size, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::string data(size, '\0');
+  for (auto& c : data) {
+    c = static_cast<char>(rng());
+  }
+  return data;
+}
+
+std::string RoundTrip(const std::string& basis, const std::string& target,
+                      uint32_t block_size, proto::FileDelta* delta) {
+  proto::FileSignature signature;
+  EXPECT_TRUE(DeltaSync::ComputeSignature(basis, block_size, &signature));
+  EXPECT_TRUE(DeltaSync::ComputeDelta(signature, target, delta));
+  std::string out;
+  EXPECT_TRUE(DeltaSync::ApplyDelta(basis, *delta, &out));
+  return out;
+}
+
+TEST(DeltaSync, RollingChecksumMatchesRecompute) {
+  const std::string data = RandomData(4096, 1);
+  const size_t window = 700;
+  RollingChecksum rolling;
+  rolling.Reset(std::string_view(data).substr(0, window));
+  for (size_t i = 0; i + window < data.size(); ++i) {
+    ASSERT_EQ(rolling.Value(),
+              DeltaSync::WeakChecksum(std::string_view(data).substr(i, window)))
+        << i;
+    rolling.Roll(static_cast<uint8_t>(data[i]),
+                 static_cast<uint8_t>(data[i + window]));
+  }
+}
+
+TEST(DeltaSync, IdenticalFileHasNoLiteral) {
+  const std::string data = RandomData(100000, 2);
+  proto::FileDelta delta;
+  EXPECT_EQ(RoundTrip(data, data, 1024, &delta), data);
+  EXPECT_EQ(DeltaSync::LiteralBytes(delta), 0);
+  EXPECT_EQ(delta.ops_size(), 1);
+}
+
+TEST(DeltaSync, SmallEditTransfersOnlyChange) {
+  const std::string basis = RandomData(1 << 20, 3);
+  std::string target = basis;
+  target.insert(300000, "inserted bytes");
+  target.erase(700000, 100);
+  target[900000] ^= 0x55;
+
+  proto::FileDelta delta;
+  EXPECT_EQ(RoundTrip(basis, target, 0, &delta), target);
+  // Three edits, each costs at most about two blocks of literal data.
+  const uint32_t block_size = DeltaSync::ChooseBlockSize(basis.size());
+  EXPECT_LT(DeltaSync::LiteralBytes(delta), 6 * block_size);
+}
+
+TEST(DeltaSync, ShortAndEmptyFiles) {
+  proto::FileDelta delta;
+  EXPECT_EQ(RoundTrip("", "hello", 0, &delta), "hello");
+  EXPECT_EQ(RoundTrip("hello", "", 0, &delta), "");
+  EXPECT_EQ(RoundTrip("hello", "hello", 0, &delta), "hello");
+  EXPECT_EQ(DeltaSync::LiteralBytes(delta), 0);
+  EXPECT_EQ(RoundTrip("hello", "hello world", 0, &delta), "hello world");
+}
+
+TEST(DeltaSync, UnalignedTailIsReused) {
+  const std::string basis = RandomData(10 * 1024 + 123, 4);
+  std::string target = basis;
+  target[10] ^= 1;
+  proto::FileDelta delta;
+  EXPECT_EQ(RoundTrip(basis, target, 1024, &delta), target);
+  EXPECT_EQ(DeltaSync::LiteralBytes(delta), 1024);
+}
+
+TEST(DeltaSync, RejectsCorruptDelta) {
+  const std::string basis = RandomData(8192, 5);
+  proto::FileSignature signature;
+  proto::FileDelta delta;
+  ASSERT_TRUE(DeltaSync::ComputeSignature(basis, 1024, &signature));
+  ASSERT_TRUE(DeltaSync::ComputeDelta(signature, basis, &delta));
+  std::string out;
+  EXPECT_FALSE(DeltaSync::ApplyDelta(basis.substr(0, 4096), delta, &out));
+  delta.mutable_ops(0)->set_block_index(100);
+  EXPECT_FALSE(DeltaSync::ApplyDelta(basis, delta, &out));
+}
+
+TEST(DeltaSync, RejectsForgedSignature) {
+  const std::string basis = RandomData(8192, 7);
+  proto::FileSignature signature;
+  proto::FileDelta delta;
+  ASSERT_TRUE(DeltaSync::ComputeSignature(basis, 1024, &signature));
+
+  proto::FileSignature forged = signature;
+  forged.set_file_size(uint64_t{1} << 60);
+  EXPECT_FALSE(DeltaSync::ComputeDelta(forged, basis, &delta));
+  forged = signature;
+  forged.mutable_blocks()->RemoveLast();
+  EXPECT_FALSE(DeltaSync::ComputeDelta(forged, basis, &delta));
+  forged = signature;
+  forged.set_file_size(8192 + 100);
+  EXPECT_FALSE(DeltaSync::ComputeDelta(forged, basis, &delta));
+  forged = signature;
+  forged.set_block_size(DeltaSync::kMaxBlockSize * 2);
+  EXPECT_FALSE(DeltaSync::ComputeDelta(forged, basis, &delta));
+  forged.Clear();
+  forged.set_file_size(8192);
+  EXPECT_FALSE(DeltaSync::ComputeDelta(forged, basis, &delta));
+}
+
+TEST(DeltaSync, SyncPair) {
+  const auto root = std::filesystem::temp_directory_path() / "delta_sync_test";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root / "src" / "sub");
+  const std::string data = RandomData(50000, 6);
+  std::ofstream(root / "src" / "sub" / "a.bin", std::ios::binary) << data;
+
+  proto::SyncPair pair;
+  pair.set_source_dir((root / "src").string());
+  pair.add_dest_dirs((root / "dst").string());
+  ASSERT_TRUE(DeltaSync::SyncPair(pair));
+
+  std::ifstream in(root / "dst" / "sub" / "a.bin", std::ios::binary);
+  const std::string copied((std::istreambuf_iterator<char>(in)),
+                           std::istreambuf_iterator<char>());
+  EXPECT_EQ(copied, data);
+
+  uint64_t literal = 0;
+  EXPECT_TRUE(DeltaSync::SyncFile((root / "src" / "sub" / "a.bin").string(),
+                                  (root / "dst" / "sub" / "a.bin").string(),
+                                  &literal));
+  EXPECT_EQ(literal, 0);
+
+  // With an index only files changed since the last round are synced.
+  const std::string index = (root / "index").string();
+  ASSERT_TRUE(DeltaSync::SyncPair(pair, index));
+  std::ofstream(root / "src" / "b.bin", std::ios::binary) << "b";
+  ASSERT_TRUE(DeltaSync::SyncPair(pair, index));
+  EXPECT_TRUE(std::filesystem::exists(root / "dst" / "b.bin"));
+  std::filesystem::remove_all(root);
+}
+
+}  // namespace
+}  // namespace sync
+}  // namespace impl
+}  // namespace tbox
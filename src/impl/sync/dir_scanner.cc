@@ -0,0 +1,341 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/impl/sync/dir_scanner.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#include "blake3.h"
+#include "src/common/defs.h"
+#include "src/common/logging.h"
+
+namespace tbox {
+namespace impl {
+namespace sync {
+
+namespace {
+
+struct Worker {
+  std::mutex mu;
+  std::deque<std::string> dirs;  // Relative paths, "" is the root.
+  std::vector<FileEntry> entries;
+  ScanStats stats;
+};
+
+class ScanJob {
+ public:
+  ScanJob(const std::string& root, const FileIndex* previous, int threads)
+      : root_(root), previous_(previous) {
+    for (int i = 0; i < threads; ++i) {
+      workers_.emplace_back(std::make_unique<Worker>());
+    }
+  }
+
+  void Run() {
+    pending_ = 1;
+    queued_ = 1;
+    workers_[0]->dirs.emplace_back();
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < workers_.size(); ++i) {
+      threads.emplace_back([this, i] { Loop(i); });
+    }
+    Loop(0);
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+
+  void Collect(std::vector<FileEntry>* entries, ScanStats* stats) {
+    entries->clear();
+    for (auto& worker : workers_) {
+      std::move(worker->entries.begin(), worker->entries.end(),
+                std::back_inserter(*entries));
+      if (stats) {
+        stats->dirs += worker->stats.dirs;
+        stats->files += worker->stats.files;
+        stats->hashed += worker->stats.hashed;
+        stats->hashed_bytes += worker->stats.hashed_bytes;
+        stats->steals += worker->stats.steals;
+        stats->errors += worker->stats.errors;
+      }
+    }
+    std::sort(entries->begin(), entries->end(),
+              [](const FileEntry& a, const FileEntry& b) {
+                return a.path < b.path;
+              });
+  }
+
+ private:
+  bool PopLocal(size_t self, std::string* dir) {
+    auto& worker = *workers_[self];
+    std::lock_guard<std::mutex> lock(worker.mu);
+    if (worker.dirs.empty()) {
+      return false;
+    }
+    *dir = std::move(worker.dirs.back());
+    worker.dirs.pop_back();
+    queued_.fetch_sub(1);
+    return true;
+  }
+
+  bool Steal(size_t self, std::string* dir) {
+    for (size_t i = 1; i < workers_.size(); ++i) {
+      auto& victim = *workers_[(self + i) % workers_.size()];
+      std::lock_guard<std::mutex> lock(victim.mu);
+      if (!victim.dirs.empty()) {
+        *dir = std::move(victim.dirs.front());
+        victim.dirs.pop_front();
+        queued_.fetch_sub(1);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Loop(size_t self) {
+    std::string dir;
+    while (true) {
+      if (PopLocal(self, &dir)) {
+        Process(self, dir);
+        continue;
+      }
+      if (Steal(self, &dir)) {
+        ++workers_[self]->stats.steals;
+        Process(self, dir);
+        continue;
+      }
+      if (!WaitForWork()) {
+        return;
+      }
+    }
+  }
+
+  // Sleeps until a directory is queued or the scan is over; false once
+  // nothing is queued or being listed. The counters are sequentially
+  // consistent so that either the waiter sees the new directory or the
+  // producer sees the waiter and wakes it under idle_mu_.
+  bool WaitForWork() {
+    std::unique_lock<std::mutex> lock(idle_mu_);
+    ++idle_;
+    idle_cv_.wait(lock, [this] { return queued_ > 0 || pending_ == 0; });
+    --idle_;
+    return pending_ > 0;
+  }
+
+  void Wake(bool all) {
+    if (idle_ == 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(idle_mu_);
+    if (all) {
+      idle_cv_.notify_all();
+    } else {
+      idle_cv_.notify_one();
+    }
+  }
+
+  void Process(size_t self, const std::string& rel_dir) {
+    auto& worker = *workers_[self];
+    ++worker.stats.dirs;
+    const std::filesystem::path dir_path =
+        rel_dir.empty() ? root_ : root_ / rel_dir;
+    std::error_code ec;
+    std::filesystem::directory_iterator it(
+        dir_path, std::filesystem::directory_options::skip_permission_denied,
+        ec);
+    for (; !ec && it != std::filesystem::directory_iterator();
+         it.increment(ec)) {
+      const std::string name = it->path().filename().string();
+      std::string rel = rel_dir.empty() ? name : rel_dir + "/" + name;
+      // The cached dirent type avoids a stat for every directory; symlinks
+      // are neither followed nor indexed.
+      std::error_code type_ec;
+      const auto status = it->symlink_status(type_ec);
+      if (type_ec) {
+        ++worker.stats.errors;
+        continue;
+      }
+      if (std::filesystem::is_directory(status)) {
+        pending_.fetch_add(1, std::memory_order_relaxed);
+        {
+          std::lock_guard<std::mutex> lock(worker.mu);
+          worker.dirs.push_back(std::move(rel));
+        }
+        queued_.fetch_add(1);
+        Wake(false);
+      } else if (std::filesystem::is_regular_file(status)) {
+        ProcessFile(&worker, it->path(), std::move(rel));
+      }
+    }
+    if (ec) {
+      LOG(ERROR) << "Failed to list " << dir_path << ": " << ec.message();
+      ++worker.stats.errors;
+    }
+    if (pending_.fetch_sub(1) == 1) {
+      Wake(true);
+    }
+  }
+
+  void ProcessFile(Worker* worker, const std::filesystem::path& path,
+                   std::string rel) {
+    FileEntry entry;
+    entry.path = std::move(rel);
+#if !defined(_WIN32)
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0) {
+      ++worker->stats.errors;
+      return;
+    }
+    entry.size = static_cast<uint64_t>(st.st_size);
+#if defined(__APPLE__)
+    entry.mtime_ns = static_cast<int64_t>(st.st_mtimespec.tv_sec) *
+                         1000000000 +
+                     st.st_mtimespec.tv_nsec;
+#else
+    entry.mtime_ns =
+        static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 +
+        st.st_mtim.tv_nsec;
+#endif
+    entry.inode = static_cast<uint64_t>(st.st_ino);
+#else
+    std::error_code ec;
+    entry.size = std::filesystem::file_size(path, ec);
+    entry.mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::filesystem::last_write_time(path, ec)
+                             .time_since_epoch())
+                         .count();
+#endif
+    ++worker->stats.files;
+
+    FileEntry old;
+    if (previous_ && previous_->Find(entry.path, &old) &&
+        old.SameMetadata(entry.size, entry.mtime_ns, entry.inode)) {
+      entry.hash = old.hash;
+    } else {
+      uint64_t bytes = 0;
+      if (!DirScanner::HashFile(path.string(), &entry.hash, &bytes)) {
+        ++worker->stats.errors;
+        return;
+      }
+      ++worker->stats.hashed;
+      worker->stats.hashed_bytes += bytes;
+    }
+    worker->entries.push_back(std::move(entry));
+  }
+
+  const std::filesystem::path root_;
+  const FileIndex* previous_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  // Directories queued or being listed; the scan ends when it drops to zero.
+  std::atomic<int64_t> pending_{0};
+  // Directories waiting in some worker's deque.
+  std::atomic<int64_t> queued_{0};
+  // Workers that found nothing to do, parked on idle_cv_.
+  std::atomic<int> idle_{0};
+  std::mutex idle_mu_;
+  std::condition_variable idle_cv_;
+};
+
+}  // namespace
+
+DirScanner::DirScanner(int threads) : threads_(threads) {
+  if (threads_ <= 0) {
+    threads_ = std::max(1u, std::thread::hardware_concurrency());
+  }
+}
+
+bool DirScanner::HashFile(const std::string& path,
+                          std::array<uint8_t, 32>* hash, uint64_t* bytes) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  blake3_hasher hasher;
+  blake3_hasher_init(&hasher);
+  std::vector<char> buffer(common::CALC_BUFFER_SIZE_BYTES);
+  *bytes = 0;
+  while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0) {
+    blake3_hasher_update(&hasher, buffer.data(), file.gcount());
+    *bytes += file.gcount();
+  }
+  if (file.bad()) {
+    return false;
+  }
+  blake3_hasher_finalize(&hasher, hash->data(), hash->size());
+  return true;
+}
+
+bool DirScanner::Scan(const std::string& root, const FileIndex* previous,
+                      std::vector<FileEntry>* entries, ScanStats* stats) {
+  std::error_code ec;
+  if (!std::filesystem::is_directory(root, ec)) {
+    LOG(ERROR) << "Scan root is not a directory: " << root;
+    return false;
+  }
+  ScanJob job(root, previous, threads_);
+  job.Run();
+  job.Collect(entries, stats);
+  return true;
+}
+
+bool DirScanner::Update(const std::string& root, const std::string& index_path,
+                        std::vector<std::string>* changed, ScanStats* stats,
+                        const std::function<bool(const std::string&)>& apply) {
+  std::vector<FileEntry> entries;
+  {
+    FileIndex previous;
+    if (!previous.Load(index_path)) {
+      LOG(WARNING) << "Ignoring unreadable index " << index_path;
+    }
+    if (!Scan(root, &previous, &entries, stats)) {
+      return false;
+    }
+    if (changed) {
+      changed->clear();
+    }
+    // A change that could not be applied keeps its old entry, or none if it
+    // is new, so that the next Update reports it again.
+    size_t kept = 0;
+    FileEntry old;
+    for (auto& entry : entries) {
+      const bool found = previous.Find(entry.path, &old);
+      if (!found || old.hash != entry.hash) {
+        if (changed) {
+          changed->push_back(entry.path);
+        }
+        if (apply && !apply(entry.path)) {
+          if (!found) {
+            continue;
+          }
+          entry = old;
+        }
+      }
+      if (&entries[kept] != &entry) {
+        entries[kept] = std::move(entry);
+      }
+      ++kept;
+    }
+    entries.resize(kept);
+  }
+  return FileIndex::Save(index_path, entries);
+}
+
+}  // namespace sync
+}  // namespace impl
+}  // namespace tbox
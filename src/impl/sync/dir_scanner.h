@@ -0,0 +1,73 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_IMPL_SYNC_DIR_SCANNER_H_
+#define TBOX_IMPL_SYNC_DIR_SCANNER_H_
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "src/impl/sync/file_index.h"
+
+namespace tbox {
+namespace impl {
+namespace sync {
+
+/// @brief Counters of one DirScanner::Scan() run.
+struct ScanStats {
+  uint64_t dirs = 0;
+  uint64_t files = 0;
+  uint64_t hashed = 0;        ///< Files whose content had to be read.
+  uint64_t hashed_bytes = 0;  ///< Bytes read for hashing.
+  uint64_t steals = 0;        ///< Directories taken from another worker.
+  uint64_t errors = 0;
+};
+
+/// @brief Multi-threaded directory walker producing FileEntry records.
+/// @details Every worker owns a deque of pending directories. It pushes the
+///          subdirectories it discovers onto the back and pops from the back,
+///          which keeps its working set local; idle workers steal from the
+///          front of a random victim, taking the oldest and usually largest
+///          subtrees. Files whose size, mtime and inode match the previous
+///          index reuse the stored hash, only changed files are read.
+class DirScanner final {
+ public:
+  /// @param threads Worker count, 0 for the hardware concurrency.
+  explicit DirScanner(int threads = 0);
+
+  /// @brief Walk root and fill entries sorted by relative path.
+  /// @param previous Index of the last scan, may be nullptr.
+  /// @return False if root is not a readable directory. Errors on
+  ///         individual entries are counted in stats and skipped.
+  bool Scan(const std::string& root, const FileIndex* previous,
+            std::vector<FileEntry>* entries, ScanStats* stats = nullptr);
+
+  /// @brief Scan root and persist the result at index_path.
+  /// @param changed If not null, receives the relative paths that are new or
+  ///        whose hash differs from the stored index.
+  /// @param apply If set, called with every changed path before the index is
+  ///        saved; paths it returns false for are not recorded as current
+  ///        and are reported as changed again by the next Update.
+  bool Update(const std::string& root, const std::string& index_path,
+              std::vector<std::string>* changed = nullptr,
+              ScanStats* stats = nullptr,
+              const std::function<bool(const std::string&)>& apply = nullptr);
+
+  /// @brief BLAKE3 of a file's content.
+  static bool HashFile(const std::string& path,
+                       std::array<uint8_t, 32>* hash, uint64_t* bytes);
+
+ private:
+  int threads_;
+};
+
+}  // namespace sync
+}  // namespace impl
+}  // namespace tbox
+
+#endif  // TBOX_IMPL_SYNC_DIR_SCANNER_H_
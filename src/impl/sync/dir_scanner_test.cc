@@ -0,0 +1,133 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/impl/sync/dir_scanner.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace impl {
+namespace sync {
+namespace {
+
+class DirScannerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    root_ = std::filesystem::temp_directory_path() / "dir_scanner_test";
+    std::filesystem::remove_all(root_);
+    for (int d = 0; d < 8; ++d) {
+      const auto dir = root_ / "tree" / ("d" + std::to_string(d)) / "sub";
+      std::filesystem::create_directories(dir);
+      for (int f = 0; f < 16; ++f) {
+        Write(dir / ("f" + std::to_string(f)), std::to_string(d * 100 + f));
+      }
+    }
+    Write(root_ / "tree" / "top", "top");
+  }
+
+  void TearDown() override { std::filesystem::remove_all(root_); }
+
+  static void Write(const std::filesystem::path& path,
+                    const std::string& content) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+  }
+
+  std::string Tree() const { return (root_ / "tree").string(); }
+  std::string Index() const { return (root_ / "index").string(); }
+
+  std::filesystem::path root_;
+};
+
+TEST_F(DirScannerTest, ScanFindsAllFilesSorted) {
+  std::vector<FileEntry> entries;
+  ScanStats stats;
+  ASSERT_TRUE(DirScanner(4).Scan(Tree(), nullptr, &entries, &stats));
+  EXPECT_EQ(entries.size(), 8 * 16 + 1);
+  EXPECT_EQ(stats.files, entries.size());
+  EXPECT_EQ(stats.hashed, entries.size());
+  EXPECT_EQ(stats.dirs, 1 + 8 * 2);
+  EXPECT_TRUE(std::is_sorted(entries.begin(), entries.end(),
+                             [](const FileEntry& a, const FileEntry& b) {
+                               return a.path < b.path;
+                             }));
+  EXPECT_EQ(entries.back().path, "top");
+  EXPECT_EQ(entries.back().size, 3);
+}
+
+TEST_F(DirScannerTest, IndexRoundTrip) {
+  std::vector<FileEntry> entries;
+  ASSERT_TRUE(DirScanner(2).Scan(Tree(), nullptr, &entries));
+  ASSERT_TRUE(FileIndex::Save(Index(), entries));
+
+  FileIndex index;
+  ASSERT_TRUE(index.Load(Index()));
+  EXPECT_EQ(index.Size(), entries.size());
+  for (const auto& entry : entries) {
+    FileEntry found;
+    ASSERT_TRUE(index.Find(entry.path, &found)) << entry.path;
+    EXPECT_EQ(found.size, entry.size);
+    EXPECT_EQ(found.mtime_ns, entry.mtime_ns);
+    EXPECT_EQ(found.inode, entry.inode);
+    EXPECT_EQ(found.hash, entry.hash);
+  }
+  FileEntry found;
+  EXPECT_FALSE(index.Find("missing", &found));
+
+  Write(Index(), "garbage");
+  EXPECT_FALSE(index.Load(Index()));
+  EXPECT_EQ(index.Size(), 0);
+}
+
+TEST_F(DirScannerTest, UpdateRehashesOnlyChangedFiles) {
+  std::vector<std::string> changed;
+  ScanStats stats;
+  ASSERT_TRUE(DirScanner(4).Update(Tree(), Index(), &changed, &stats));
+  EXPECT_EQ(changed.size(), 8 * 16 + 1);
+
+  stats = ScanStats();
+  ASSERT_TRUE(DirScanner(4).Update(Tree(), Index(), &changed, &stats));
+  EXPECT_TRUE(changed.empty());
+  EXPECT_EQ(stats.hashed, 0);
+
+  Write(root_ / "tree" / "d3" / "sub" / "f7", "changed content");
+  Write(root_ / "tree" / "new", "new");
+  stats = ScanStats();
+  ASSERT_TRUE(DirScanner(4).Update(Tree(), Index(), &changed, &stats));
+  EXPECT_EQ(changed, (std::vector<std::string>{"d3/sub/f7", "new"}));
+  EXPECT_EQ(stats.hashed, 2);
+}
+
+TEST_F(DirScannerTest, UpdateKeepsFailedChangesPending) {
+  std::vector<std::string> changed;
+  ASSERT_TRUE(DirScanner(4).Update(Tree(), Index(), &changed));
+
+  Write(root_ / "tree" / "d3" / "sub" / "f7", "changed content");
+  Write(root_ / "tree" / "new", "new");
+  std::vector<std::string> applied;
+  auto fail = [&](const std::string& path) {
+    applied.push_back(path);
+    return false;
+  };
+  ASSERT_TRUE(DirScanner(4).Update(Tree(), Index(), &changed, nullptr, fail));
+  EXPECT_EQ(applied, (std::vector<std::string>{"d3/sub/f7", "new"}));
+
+  // Neither change was recorded, so both are offered again.
+  ASSERT_TRUE(DirScanner(4).Update(Tree(), Index(), &changed, nullptr,
+                                   [](const std::string&) { return true; }));
+  EXPECT_EQ(changed, (std::vector<std::string>{"d3/sub/f7", "new"}));
+  ASSERT_TRUE(DirScanner(4).Update(Tree(), Index(), &changed));
+  EXPECT_TRUE(changed.empty());
+}
+
+}  // namespace
+}  // namespace sync
+}  // namespace impl
+}  // namespace tbox
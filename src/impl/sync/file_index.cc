@@ -0,0 +1,216 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/impl/sync/file_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "src/common/logging.h"
+
+namespace tbox {
+namespace impl {
+namespace sync {
+
+struct FileIndex::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t count;
+  uint64_t strings_size;
+};
+
+struct FileIndex::Record {
+  uint64_t path_offset;
+  uint32_t path_len;
+  uint32_t reserved;
+  uint64_t size;
+  int64_t mtime_ns;
+  uint64_t inode;
+  uint8_t hash[32];
+};
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'B', 'X', 'I', 'D', 'X', '\0', '\0'};
+constexpr uint32_t kVersion = 1;
+
+}  // namespace
+
+FileIndex::~FileIndex() { Unmap(); }
+
+void FileIndex::Unmap() {
+#if !defined(_WIN32)
+  if (data_ && buffer_.empty()) {
+    munmap(const_cast<uint8_t*>(data_), length_);
+  }
+#endif
+  data_ = nullptr;
+  length_ = 0;
+  records_ = nullptr;
+  count_ = 0;
+  strings_ = nullptr;
+  strings_size_ = 0;
+  buffer_.clear();
+}
+
+bool FileIndex::Load(const std::string& path) {
+  Unmap();
+  std::error_code ec;
+  if (!std::filesystem::exists(path, ec)) {
+    return true;
+  }
+
+#if !defined(_WIN32)
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG(ERROR) << "Failed to open index: " << path;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  length_ = static_cast<size_t>(st.st_size);
+  if (length_ > 0) {
+    void* addr = mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      close(fd);
+      length_ = 0;
+      LOG(ERROR) << "Failed to mmap index: " << path;
+      return false;
+    }
+    data_ = static_cast<const uint8_t*>(addr);
+  }
+  close(fd);
+#else
+  std::ifstream in(path, std::ios::binary);
+  buffer_.assign(std::istreambuf_iterator<char>(in),
+                 std::istreambuf_iterator<char>());
+  data_ = reinterpret_cast<const uint8_t*>(buffer_.data());
+  length_ = buffer_.size();
+#endif
+
+  Header header;
+  if (length_ < sizeof(header)) {
+    LOG(ERROR) << "Truncated index: " << path;
+    Unmap();
+    return false;
+  }
+  std::memcpy(&header, data_, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.record_size != sizeof(Record) ||
+      header.count > (length_ - sizeof(header)) / sizeof(Record) ||
+      sizeof(header) + header.count * sizeof(Record) + header.strings_size !=
+          length_) {
+    LOG(ERROR) << "Invalid index: " << path;
+    Unmap();
+    return false;
+  }
+  count_ = header.count;
+  records_ = reinterpret_cast<const Record*>(data_ + sizeof(header));
+  strings_ = reinterpret_cast<const char*>(records_ + count_);
+  strings_size_ = header.strings_size;
+  for (size_t i = 0; i < count_; ++i) {
+    if (records_[i].path_offset + records_[i].path_len > strings_size_) {
+      LOG(ERROR) << "Corrupt index record " << i << ": " << path;
+      Unmap();
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string_view FileIndex::PathOf(const Record& record) const {
+  return std::string_view(strings_ + record.path_offset, record.path_len);
+}
+
+bool FileIndex::Find(std::string_view path, FileEntry* out) const {
+  const Record* end = records_ + count_;
+  const Record* it = std::lower_bound(
+      records_, end, path, [this](const Record& record, std::string_view key) {
+        return PathOf(record) < key;
+      });
+  if (it == end || PathOf(*it) != path) {
+    return false;
+  }
+  out->path.assign(path);
+  out->size = it->size;
+  out->mtime_ns = it->mtime_ns;
+  out->inode = it->inode;
+  std::memcpy(out->hash.data(), it->hash, out->hash.size());
+  return true;
+}
+
+bool FileIndex::Save(const std::string& path,
+                     const std::vector<FileEntry>& entries) {
+  Header header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.record_size = sizeof(Record);
+  header.count = entries.size();
+  header.strings_size = 0;
+
+  std::vector<Record> records(entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const auto& entry = entries[i];
+    if (i > 0 && !(entries[i - 1].path < entry.path)) {
+      LOG(ERROR) << "Index entries not sorted at " << entry.path;
+      return false;
+    }
+    auto& record = records[i];
+    record.path_offset = header.strings_size;
+    record.path_len = static_cast<uint32_t>(entry.path.size());
+    record.reserved = 0;
+    record.size = entry.size;
+    record.mtime_ns = entry.mtime_ns;
+    record.inode = entry.inode;
+    std::memcpy(record.hash, entry.hash.data(), sizeof(record.hash));
+    header.strings_size += entry.path.size();
+  }
+
+  const std::string tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+      LOG(ERROR) << "Failed to open index for writing: " << tmp;
+      return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records.data()),
+              static_cast<std::streamsize>(records.size() * sizeof(Record)));
+    for (const auto& entry : entries) {
+      out.write(entry.path.data(),
+                static_cast<std::streamsize>(entry.path.size()));
+    }
+    if (!out.good()) {
+      LOG(ERROR) << "Failed to write index: " << tmp;
+      return false;
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(tmp, path, ec);
+  if (ec) {
+    LOG(ERROR) << "Failed to rename index " << tmp << ": " << ec.message();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace sync
+}  // namespace impl
+}  // namespace tbox
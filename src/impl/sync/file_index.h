@@ -0,0 +1,89 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_IMPL_SYNC_FILE_INDEX_H_
+#define TBOX_IMPL_SYNC_FILE_INDEX_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tbox {
+namespace impl {
+namespace sync {
+
+/// @brief Metadata and content hash of one regular file below a scan root.
+struct FileEntry {
+  std::string path;  ///< Path relative to the scan root, '/' separated.
+  uint64_t size = 0;
+  int64_t mtime_ns = 0;
+  uint64_t inode = 0;
+  std::array<uint8_t, 32> hash{};  ///< Raw BLAKE3 digest of the content.
+
+  /// @brief True if size, mtime and inode all match, so the hash is reusable.
+  bool SameMetadata(uint64_t other_size, int64_t other_mtime_ns,
+                    uint64_t other_inode) const {
+    return size == other_size && mtime_ns == other_mtime_ns &&
+           inode == other_inode;
+  }
+};
+
+/// @brief Persistent, read-only view of a previous scan.
+/// @details The on-disk layout is a fixed header, an array of fixed size
+///          records sorted by path and a string table holding the paths:
+///
+///              Header | Record[count] | path bytes
+///
+///          Load() maps the file and Find() binary searches the records in
+///          place, so opening an index of a million files costs one mmap and
+///          no parsing or allocation. Save() writes a new index to a temporary
+///          file and renames it over the old one.
+class FileIndex final {
+ public:
+  FileIndex() = default;
+  ~FileIndex();
+  FileIndex(const FileIndex&) = delete;
+  FileIndex& operator=(const FileIndex&) = delete;
+
+  /// @brief Map an index file. A missing file yields an empty index.
+  /// @return False if the file exists but is not a valid index.
+  bool Load(const std::string& path);
+
+  /// @brief Look up a relative path.
+  /// @param out Receives the entry when found.
+  /// @return False if the path is not in the index.
+  bool Find(std::string_view path, FileEntry* out) const;
+
+  size_t Size() const { return count_; }
+
+  /// @brief Write entries as an index, entries must be sorted by path.
+  static bool Save(const std::string& path,
+                   const std::vector<FileEntry>& entries);
+
+ private:
+  struct Header;
+  struct Record;
+
+  void Unmap();
+  std::string_view PathOf(const Record& record) const;
+
+  const uint8_t* data_ = nullptr;
+  size_t length_ = 0;
+  const Record* records_ = nullptr;
+  size_t count_ = 0;
+  const char* strings_ = nullptr;
+  size_t strings_size_ = 0;
+  /// Fallback storage when the platform has no mmap.
+  std::string buffer_;
+};
+
+}  // namespace sync
+}  // namespace impl
+}  // namespace tbox
+
+#endif  // TBOX_IMPL_SYNC_FILE_INDEX_H_
@@ -18,6 +18,7 @@
 #include "src/common/ssh_key_auth.h"
 #include "src/common/logging.h"
 #include "src/common/error.h"
+#include "src/common/trace.h"
 #include "src/impl/config_manager.h"
 #include "src/impl/session_manager.h"
 #include "src/impl/sqlite_manager.h"
@@ -183,6 +184,7 @@ class UserManager final {
       return Err_Fail;
     }
 
+    trace::ScopedSpan db_span("db.users.insert", trace::SpanKind::kClient);
     sqlite3_stmt* stmt = nullptr;
     auto ret = util::SqliteManager::Instance()->PrepareStatement(
         "INSERT OR IGNORE INTO users (user, salt, password) VALUES (?, ?, ?);",
@@ -233,6 +235,7 @@ class UserManager final {
     }
 
     if (login_user == "admin" || login_user == to_delete_user) {
+      trace::ScopedSpan db_span("db.users.delete", trace::SpanKind::kClient);
       sqlite3_stmt* stmt = nullptr;
       auto ret = util::SqliteManager::Instance()->PrepareStatement(
           "DELETE FROM users WHERE user = ?;", &stmt);
@@ -275,6 +278,7 @@ class UserManager final {
       return Err_User_invalid_passwd;
     }
 
+    trace::ScopedSpan db_span("db.users.select", trace::SpanKind::kClient);
     sqlite3_stmt* stmt = nullptr;
     util::SqliteManager::Instance()->PrepareStatement(
         "SELECT salt, password FROM users WHERE user = ?;", &stmt);
@@ -292,6 +296,7 @@ class UserManager final {
       std::string stored_hash =
           hash_text ? reinterpret_cast<const char*>(hash_text) : std::string();
       sqlite3_finalize(stmt);
+      db_span.End();
       if (util::Util::VerifyPassword(password, salt, stored_hash)) {
         *token = SessionManager::Instance()->GenerateToken(user);
         return Err_Success;
@@ -324,6 +329,7 @@ class UserManager final {
       return Err_User_invalid_name;
     }
 
+    trace::ScopedSpan db_span("db.users.select", trace::SpanKind::kClient);
     sqlite3_stmt* stmt = nullptr;
     util::SqliteManager::Instance()->PrepareStatement(
         "SELECT salt, password FROM users WHERE user = ?;", &stmt);
@@ -365,6 +371,7 @@ class UserManager final {
       return Err_User_change_password_error;
     }
 
+    trace::ScopedSpan db_span("db.users.update", trace::SpanKind::kClient);
     sqlite3_stmt* stmt = nullptr;
     auto ret = util::SqliteManager::Instance()->PrepareStatement(
         "UPDATE users SET salt = ?, password = ? WHERE user = ?;", &stmt);
@@ -0,0 +1,154 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/server/client_address.h"
+
+#include <exception>
+#include <optional>
+
+#include "src/common/logging.h"
+#include "src/impl/config_manager.h"
+
+namespace tbox {
+namespace server {
+namespace {
+
+std::string_view Trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+// Accepts "[::1]" as well, and reads IPv4-mapped IPv6 addresses as IPv4 so
+// that they match IPv4 networks.
+std::optional<folly::IPAddress> Parse(std::string_view s) {
+  s = Trim(s);
+  if (s.size() > 2 && s.front() == '[' && s.back() == ']') {
+    s = s.substr(1, s.size() - 2);
+  }
+  auto ip = folly::IPAddress::tryFromString(s);
+  if (!ip.hasValue()) {
+    return std::nullopt;
+  }
+  if (ip->isIPv4Mapped()) {
+    return folly::IPAddress(ip->asV6().createIPv4());
+  }
+  return *ip;
+}
+
+bool IsLoopback(std::string_view s) {
+  const auto ip = Parse(s);
+  return ip && ip->isLoopback();
+}
+
+}  // namespace
+
+ClientAddress::ClientAddress(const std::vector<std::string>& trusted_proxies) {
+  for (const std::string& proxy : trusted_proxies) {
+    try {
+      trusted_proxies_.push_back(folly::IPAddress::createNetwork(proxy));
+    } catch (const std::exception& e) {
+      LOG(WARNING) << "Ignoring trusted proxy " << proxy << ": " << e.what();
+    }
+  }
+}
+
+const ClientAddress& ClientAddress::Instance() {
+  static const ClientAddress* const instance =
+      new ClientAddress(util::ConfigManager::Instance()->TrustedProxies());
+  return *instance;
+}
+
+std::string ClientAddress::Resolve(std::string_view peer,
+                                   std::string_view forwarded_for,
+                                   std::string_view real_ip) const {
+  if (!IsTrustedProxy(peer)) {
+    return std::string(peer);
+  }
+  // Proxies append the address they saw, so walk the chain from the right;
+  // entries left of the first untrusted one may be made up by the client.
+  std::string_view last_trusted;
+  while (!forwarded_for.empty()) {
+    const size_t comma = forwarded_for.rfind(',');
+    const std::string_view hop = Trim(comma == std::string_view::npos
+                                          ? forwarded_for
+                                          : forwarded_for.substr(comma + 1));
+    forwarded_for = comma == std::string_view::npos
+                        ? std::string_view()
+                        : forwarded_for.substr(0, comma);
+    if (hop.empty()) {
+      continue;
+    }
+    if (!IsTrustedProxy(hop)) {
+      return std::string(hop);
+    }
+    last_trusted = hop;
+  }
+  if (!last_trusted.empty()) {
+    return std::string(last_trusted);
+  }
+  real_ip = Trim(real_ip);
+  return std::string(real_ip.empty() ? peer : real_ip);
+}
+
+bool ClientAddress::IsLocal(std::string_view peer,
+                            std::string_view forwarded_for,
+                            std::string_view real_ip) const {
+  if (!IsLoopback(peer)) {
+    return false;
+  }
+  if (Trim(forwarded_for).empty() && Trim(real_ip).empty()) {
+    return true;
+  }
+  return IsTrustedProxy(peer) &&
+         IsLoopback(Resolve(peer, forwarded_for, real_ip));
+}
+
+bool ClientAddress::IsTrustedProxy(std::string_view ip) const {
+  if (trusted_proxies_.empty()) {
+    return false;
+  }
+  const auto address = Parse(ip);
+  if (!address) {
+    return false;
+  }
+  for (const folly::CIDRNetwork& network : trusted_proxies_) {
+    if (address->inSubnet(network.first, network.second)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string_view ClientAddress::GrpcPeerIp(std::string_view peer) {
+  const size_t scheme = peer.find(':');
+  if (scheme != std::string_view::npos) {
+    peer.remove_prefix(scheme + 1);
+  }
+  if (peer.starts_with('[') || peer.starts_with("%5B")) {
+    const size_t open = peer.front() == '[' ? 1 : 3;
+    size_t close = peer.find(']');
+    if (close == std::string_view::npos) {
+      close = peer.find("%5D");
+    }
+    if (close != std::string_view::npos) {
+      return peer.substr(open, close - open);
+    }
+    return peer;
+  }
+  // An IPv4 address and a port; a bare IPv6 address has more colons.
+  const size_t port = peer.rfind(':');
+  if (port != std::string_view::npos && peer.find(':') == port) {
+    peer = peer.substr(0, port);
+  }
+  return peer;
+}
+
+}  // namespace server
+}  // namespace tbox
@@ -0,0 +1,61 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_CLIENT_ADDRESS_H_
+#define TBOX_SERVER_CLIENT_ADDRESS_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "folly/IPAddress.h"
+
+namespace tbox {
+namespace server {
+
+/// @brief Who sent a request, for rate limits and access checks, shared by
+///        the gRPC and HTTP servers.
+/// @details The connection's peer is the client unless the peer is one of
+///          the configured trusted_proxies. Only then are the forwarding
+///          headers read: the rightmost X-Forwarded-For entry that is not a
+///          trusted proxy (the address the outermost trusted proxy saw, as
+///          nginx's $proxy_add_x_forwarded_for appends it), else X-Real-IP.
+///          Anyone can send these headers, so from any other peer they are
+///          ignored.
+class ClientAddress final {
+ public:
+  /// @param trusted_proxies Addresses or CIDR networks ("10.0.0.0/8");
+  ///        entries that do not parse are logged and skipped.
+  explicit ClientAddress(const std::vector<std::string>& trusted_proxies);
+
+  /// @brief Shared instance for ConfigManager::TrustedProxies().
+  static const ClientAddress& Instance();
+
+  /// @param peer Address of the connection's peer, without a port.
+  /// @param forwarded_for X-Forwarded-For, all header lines joined by ",".
+  /// @param real_ip X-Real-IP.
+  std::string Resolve(std::string_view peer, std::string_view forwarded_for,
+                      std::string_view real_ip) const;
+
+  /// @brief True for requests from this host. The peer must be loopback; a
+  ///        request carrying forwarding headers is a proxied one and is only
+  ///        local if the peer is a trusted proxy forwarding for loopback.
+  bool IsLocal(std::string_view peer, std::string_view forwarded_for,
+               std::string_view real_ip) const;
+
+  bool IsTrustedProxy(std::string_view ip) const;
+
+  /// @brief The address in a gRPC peer string, "ipv4:1.2.3.4:5678" or
+  ///        "ipv6:[::1]:5678" (brackets may come percent-encoded).
+  static std::string_view GrpcPeerIp(std::string_view peer);
+
+ private:
+  std::vector<folly::CIDRNetwork> trusted_proxies_;
+};
+
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_CLIENT_ADDRESS_H_
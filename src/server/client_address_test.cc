@@ -0,0 +1,66 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/server/client_address.h"
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace server {
+namespace {
+
+TEST(ClientAddress, IgnoresHeadersFromUntrustedPeers) {
+  const ClientAddress address({});
+  EXPECT_EQ(address.Resolve("203.0.113.7", "127.0.0.1", "10.0.0.1"),
+            "203.0.113.7");
+  EXPECT_EQ(address.Resolve("127.0.0.1", "198.51.100.1", ""), "127.0.0.1");
+}
+
+TEST(ClientAddress, TrustedProxy) {
+  const ClientAddress address({"127.0.0.1", "10.0.0.0/8"});
+  // The client's own X-Forwarded-For is left of what the proxy appended.
+  EXPECT_EQ(address.Resolve("127.0.0.1", "127.0.0.1, 203.0.113.7", ""),
+            "203.0.113.7");
+  EXPECT_EQ(address.Resolve("10.1.2.3", "203.0.113.7,10.0.0.5", ""),
+            "203.0.113.7");
+  EXPECT_EQ(address.Resolve("127.0.0.1", "", "203.0.113.7"), "203.0.113.7");
+  EXPECT_EQ(address.Resolve("127.0.0.1", "", ""), "127.0.0.1");
+  EXPECT_EQ(address.Resolve("::ffff:127.0.0.1", "203.0.113.7", ""),
+            "203.0.113.7");
+}
+
+TEST(ClientAddress, IsLocal) {
+  const ClientAddress untrusted({});
+  EXPECT_TRUE(untrusted.IsLocal("127.0.0.1", "", ""));
+  EXPECT_TRUE(untrusted.IsLocal("::1", "", ""));
+  EXPECT_FALSE(untrusted.IsLocal("203.0.113.7", "127.0.0.1", ""));
+  // Forwarded by a proxy nobody vouched for.
+  EXPECT_FALSE(untrusted.IsLocal("127.0.0.1", "203.0.113.7", ""));
+  EXPECT_FALSE(untrusted.IsLocal("127.0.0.1", "127.0.0.1", ""));
+
+  const ClientAddress trusted({"127.0.0.1"});
+  EXPECT_FALSE(trusted.IsLocal("127.0.0.1", "127.0.0.1, 203.0.113.7", ""));
+  EXPECT_FALSE(trusted.IsLocal("127.0.0.1", "", "203.0.113.7"));
+  EXPECT_TRUE(trusted.IsLocal("127.0.0.1", "127.0.0.1", ""));
+}
+
+TEST(ClientAddress, InvalidTrustedProxiesAreSkipped) {
+  const ClientAddress address({"not an address", "10.0.0.0/8"});
+  EXPECT_TRUE(address.IsTrustedProxy("10.9.9.9"));
+  EXPECT_FALSE(address.IsTrustedProxy("not an address"));
+}
+
+TEST(ClientAddress, GrpcPeerIp) {
+  EXPECT_EQ(ClientAddress::GrpcPeerIp("ipv4:1.2.3.4:5678"), "1.2.3.4");
+  EXPECT_EQ(ClientAddress::GrpcPeerIp("ipv6:[::1]:5678"), "::1");
+  EXPECT_EQ(ClientAddress::GrpcPeerIp("ipv6:%5B2001:db8::1%5D:5678"),
+            "2001:db8::1");
+  EXPECT_EQ(ClientAddress::GrpcPeerIp("unix:/tmp/tbox.sock"),
+            "/tmp/tbox.sock");
+}
+
+}  // namespace
+}  // namespace server
+}  // namespace tbox
@@ -0,0 +1,97 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_GRPC_ADMISSION_POLICY_H_
+#define TBOX_SERVER_GRPC_ADMISSION_POLICY_H_
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "src/async_grpc/admission_policy.h"
+#include "src/impl/admission_controller.h"
+#include "src/server/client_address.h"
+
+namespace tbox {
+namespace server {
+
+/// @brief Admits gRPC calls through the AdmissionController shared with the
+///        HTTP server. The client id comes from the "x-client-id" metadata,
+///        the address from ClientAddress: the peer, or what a trusted proxy
+///        forwards for.
+class GrpcAdmissionPolicy final : public async_grpc::AdmissionPolicy {
+ public:
+  explicit GrpcAdmissionPolicy(
+      std::shared_ptr<impl::AdmissionController> controller)
+      : controller_(std::move(controller)) {}
+
+  ::grpc::Status Admit(const std::string& method,
+                       const ::grpc::ServerContext& context,
+                       std::unique_ptr<Ticket>* ticket) override {
+    const auto& metadata = context.client_metadata();
+    impl::AdmissionController::Request request;
+    auto it = metadata.find("x-client-id");
+    if (it != metadata.end()) {
+      request.client_id = std::string_view(it->second.data(),
+                                           it->second.size());
+    }
+    const std::string peer = context.peer();
+    const std::string ip = ClientAddress::Instance().Resolve(
+        ClientAddress::GrpcPeerIp(peer), Header(metadata, "x-forwarded-for"),
+        Header(metadata, "x-real-ip"));
+    request.ip = ip;
+    // UserOp hashes a password, which costs far more than other calls.
+    if (std::string_view(method).ends_with("/UserOp")) {
+      request.cost = impl::AdmissionController::kPasswordHashCost;
+    }
+
+    impl::AdmissionController::Permit permit;
+    const auto decision = controller_->Admit(request, &permit);
+    switch (decision) {
+      case impl::AdmissionController::Decision::kAdmitted:
+        if (permit) {
+          *ticket = std::make_unique<PermitTicket>(std::move(permit));
+        }
+        return ::grpc::Status::OK;
+      case impl::AdmissionController::Decision::kOverloaded:
+        return ::grpc::Status(
+            ::grpc::StatusCode::UNAVAILABLE,
+            impl::AdmissionController::DecisionName(decision));
+      default:
+        return ::grpc::Status(
+            ::grpc::StatusCode::RESOURCE_EXHAUSTED,
+            impl::AdmissionController::DecisionName(decision));
+    }
+  }
+
+ private:
+  struct PermitTicket final : public Ticket {
+    explicit PermitTicket(impl::AdmissionController::Permit permit)
+        : permit(std::move(permit)) {}
+    impl::AdmissionController::Permit permit;
+  };
+
+  // Every line of the header, joined by ",".
+  template <typename Metadata>
+  static std::string Header(const Metadata& metadata, const char* name) {
+    std::string value;
+    const auto range = metadata.equal_range(name);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (!value.empty()) {
+        value += ',';
+      }
+      value.append(it->second.data(), it->second.size());
+    }
+    return value;
+  }
+
+  std::shared_ptr<impl::AdmissionController> controller_;
+};
+
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_GRPC_ADMISSION_POLICY_H_
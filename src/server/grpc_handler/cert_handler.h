@@ -46,6 +46,9 @@ class CertOpHandler : public async_grpc::RpcHandler<CertOpMethod> {
         case proto::OpCode::OP_GET_CERT_FILE:
           handler::Handler::HandleGetCertFile(req, res.get());
           break;
+        case proto::OpCode::OP_GET_CERT_FILE_DELTA:
+          handler::Handler::HandleGetCertFileDelta(req, res.get());
+          break;
         default:
           res->set_err_code(proto::ErrCode::Fail);
           res->set_message("Invalid operation code for certificate management");
@@ -10,7 +10,7 @@ namespace server {
 namespace grpc_handler {
 
 // Define static members
-std::unordered_map<std::string, ClientIPInfo> ReportOpHandler::clients_map_;
+ClientRegistry ReportOpHandler::clients_map_;
 std::mutex ReportOpHandler::clients_mutex_;
 
 }  // namespace grpc_handler
@@ -15,12 +15,15 @@
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
+#include "src/common/heap.h"
 #include "src/common/logging.h"
 #include "src/async_grpc/rpc_handler.h"
 #include "src/impl/ddns_manager.h"
+#include "src/impl/event_hub.h"
 #include "src/impl/session_manager.h"
 #include "src/server/grpc_handler/meta.h"
 #include "src/util/util.h"
@@ -58,6 +61,71 @@ struct ClientIPInfo {
   int64_t client_timestamp;
 };
 
+/// @brief A ClientIPInfo as the registry keeps it. Entries live as long as
+/// the process, so their nodes, strings and vectors all come from the
+/// client registry heap instead of sharing pages with per request garbage.
+struct ClientRecord {
+  template <typename T>
+  using Allocator =
+      memory::HeapAllocator<T, memory::HeapId::kClientRegistry>;
+  using String =
+      std::basic_string<char, std::char_traits<char>, Allocator<char>>;
+  using Strings = std::vector<String, Allocator<String>>;
+
+  void Assign(const ClientIPInfo& info) {
+    AssignStrings(info.ipv4_addresses, &ipv4_addresses);
+    AssignStrings(info.ipv6_addresses, &ipv6_addresses);
+    client_info.assign(info.client_info.data(), info.client_info.size());
+    last_report_time_millis = info.last_report_time_millis;
+    client_timestamp = info.client_timestamp;
+  }
+
+  ClientIPInfo ToInfo() const {
+    ClientIPInfo info;
+    info.ipv4_addresses.assign(ipv4_addresses.begin(), ipv4_addresses.end());
+    info.ipv6_addresses.assign(ipv6_addresses.begin(), ipv6_addresses.end());
+    info.client_info.assign(client_info.data(), client_info.size());
+    info.last_report_time_millis = last_report_time_millis;
+    info.client_timestamp = client_timestamp;
+    return info;
+  }
+
+  Strings ipv4_addresses;
+  Strings ipv6_addresses;
+  String client_info;
+  int64_t last_report_time_millis = 0;
+  int64_t client_timestamp = 0;
+
+ private:
+  static void AssignStrings(const std::vector<std::string>& from,
+                            Strings* to) {
+    to->clear();
+    for (const auto& value : from) {
+      to->emplace_back(value.data(), value.size());
+    }
+  }
+};
+
+/// @brief Hash and equality of registry keys, with lookups by any string.
+struct ClientKeyHash {
+  using is_transparent = void;
+  size_t operator()(std::string_view key) const {
+    return std::hash<std::string_view>()(key);
+  }
+};
+
+struct ClientKeyEqual {
+  using is_transparent = void;
+  bool operator()(std::string_view a, std::string_view b) const {
+    return a == b;
+  }
+};
+
+using ClientRegistry = std::unordered_map<
+    ClientRecord::String, ClientRecord, ClientKeyHash, ClientKeyEqual,
+    ClientRecord::Allocator<std::pair<const ClientRecord::String,
+                                      ClientRecord>>>;
+
 class ReportOpHandler : public async_grpc::RpcHandler<ReportOpMethod> {
  public:
   ReportOpHandler() = default;
@@ -67,7 +135,13 @@ class ReportOpHandler : public async_grpc::RpcHandler<ReportOpMethod> {
   /// @return Map of client ID to ClientIPInfo
   static std::unordered_map<std::string, ClientIPInfo> GetAllClients() {
     std::lock_guard<std::mutex> lock(clients_mutex_);
-    return clients_map_;
+    std::unordered_map<std::string, ClientIPInfo> clients;
+    clients.reserve(clients_map_.size());
+    for (const auto& [client_id, record] : clients_map_) {
+      clients.emplace(std::string(client_id.data(), client_id.size()),
+                      record.ToInfo());
+    }
+    return clients;
   }
 
   /// @brief Get a specific client's information by ID
@@ -76,9 +150,9 @@ class ReportOpHandler : public async_grpc::RpcHandler<ReportOpMethod> {
   /// @return True if client was found, false otherwise
   static bool GetClientInfo(const std::string& client_id, ClientIPInfo& info) {
     std::lock_guard<std::mutex> lock(clients_mutex_);
-    auto it = clients_map_.find(client_id);
+    auto it = clients_map_.find(std::string_view(client_id));
     if (it != clients_map_.end()) {
-      info = it->second;
+      info = it->second.ToInfo();
       return true;
     }
     return false;
@@ -224,16 +298,32 @@ class ReportOpHandler : public async_grpc::RpcHandler<ReportOpMethod> {
 
     // Store/update client information in the map
     std::string client_id = req.client_id();
+    ClientIPInfo info;
+    info.ipv4_addresses = ipv4_addrs;
+    info.ipv6_addresses = ipv6_addrs;
+    info.client_info = req.client_info();
+    info.last_report_time_millis = now_millis;
+    info.client_timestamp = req.timestamp();
     {
       std::lock_guard<std::mutex> lock(clients_mutex_);
-      ClientIPInfo& client = clients_map_[client_id];
-      client.ipv4_addresses = ipv4_addrs;
-      client.ipv6_addresses = ipv6_addrs;
-      client.client_info = req.client_info();
-      client.last_report_time_millis = now_millis;
-      client.client_timestamp = req.timestamp();
+      auto it = clients_map_.find(std::string_view(client_id));
+      if (it == clients_map_.end()) {
+        it = clients_map_
+                 .try_emplace(ClientRecord::String(client_id.data(),
+                                                   client_id.size()))
+                 .first;
+      }
+      it->second.Assign(info);
     }
 
+    impl::EventHub::Instance()->Publish(
+        impl::EventHub::kTopicClient,
+        folly::dynamic::object("client_id", client_id)(
+            "ipv4", folly::dynamic::array_range(ipv4_addrs))(
+            "ipv6", folly::dynamic::array_range(ipv6_addrs))(
+            "client_info", req.client_info())("client_timestamp",
+                                               req.timestamp()));
+
     const std::vector<std::string> monitor_domains(
         req.monitor_domains().begin(), req.monitor_domains().end());
     const std::vector<std::string> record_types(
@@ -414,7 +504,7 @@ class ReportOpHandler : public async_grpc::RpcHandler<ReportOpMethod> {
   }
 
   // Static map to store all clients' IP information (keyed by token)
-  static std::unordered_map<std::string, ClientIPInfo> clients_map_;
+  static ClientRegistry clients_map_;
   static std::mutex clients_mutex_;
 };
 
@@ -6,7 +6,12 @@
 #ifndef TBOX_SERVER_GRPC_HANDLERS_USER_HANDLER_H
 #define TBOX_SERVER_GRPC_HANDLERS_USER_HANDLER_H
 
-#include "src/async_grpc/rpc_handler.h"
+#include <memory>
+
+#include "folly/executors/task_queue/BlockingQueue.h"
+#include "src/async_grpc/coroutine_rpc_handler.h"
+#include "src/common/task.h"
+#include "src/impl/password_hash_pool.h"
 #include "src/proto/service.pb.h"
 #include "src/server/grpc_handler/meta.h"
 #include "src/server/handler/handler.h"
@@ -15,15 +20,27 @@ namespace tbox {
 namespace server {
 namespace grpc_handler {
 
-class UserHandler : public async_grpc::RpcHandler<UserOpMethod> {
+// Registration, login and password changes spend milliseconds in PBKDF2 and
+// SQLite; they run on the password hash pool while the event thread serves
+// other RPCs. Send() finishes the unary call, RESOURCE_EXHAUSTED when the
+// pool's queue is full.
+class UserHandler : public async_grpc::CoroutineRpcHandler<UserOpMethod> {
  public:
-  void OnRequest(const proto::UserRequest& req) override {
-    auto res = std::make_unique<proto::UserResponse>();
-    handler::Handler::UserOpHandle(req, res.get());
+  common::Task<void> OnRequestAsync(const proto::UserRequest& req) override {
+    std::unique_ptr<proto::UserResponse> res;
+    try {
+      res = co_await impl::PasswordHashPool::Instance()->Run([req] {
+        auto res = std::make_unique<proto::UserResponse>();
+        handler::Handler::UserOpHandle(req, res.get());
+        return res;
+      });
+    } catch (const folly::QueueFullException&) {
+      Finish(::grpc::Status(::grpc::StatusCode::RESOURCE_EXHAUSTED,
+                            "too many password operations"));
+      co_return;
+    }
     Send(std::move(res));
   }
-
-  void OnReadsDone() override { Finish(grpc::Status::OK); }
 };
 
 }  // namespace grpc_handler
@@ -6,17 +6,25 @@
 #ifndef TBOX_SERVER_GRPC_SERVER_IMPL_H_
 #define TBOX_SERVER_GRPC_SERVER_IMPL_H_
 
+#include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "absl/strings/str_cat.h"
 #include "src/async_grpc/server.h"
+#include "src/common/logging.h"
+#include "src/common/trace.h"
+#include "src/impl/admission_controller.h"
 #include "src/impl/config_manager.h"
+#include "src/server/grpc_admission_policy.h"
 #include "src/server/grpc_handler/cert_handler.h"
 #include "src/server/grpc_handler/report_handler.h"
 #include "src/server/grpc_handler/server_handler.h"
 #include "src/server/grpc_handler/user_handler.h"
+#include "src/server/io_executor.h"
 #include "src/server/server_context.h"
+#include "src/server/thread_model.h"
 
 namespace tbox {
 namespace server {
@@ -30,10 +38,36 @@ class GrpcServer final {
         util::ConfigManager::Instance()->ServerAddr() + ":" +
         absl::StrCat(util::ConfigManager::Instance()->GrpcServerPort());
     server_builder.SetServerAddress(addr_port);
-    server_builder.SetNumGrpcThreads(
-        util::ConfigManager::Instance()->GrpcThreads());
-    server_builder.SetNumEventThreads(
-        util::ConfigManager::Instance()->EventThreads());
+    const ThreadModel& model = server_context->thread_model();
+    server_builder.SetNumGrpcThreads(model.grpc_threads);
+    server_builder.SetNumEventThreads(model.event_threads);
+    if (model.shared_executor) {
+      server_builder.SetEventScheduler(
+          EventScheduler(server_context->IoExecutor()));
+    }
+    if (model.pin_threads) {
+      server_builder.SetThreadInitializer(
+          [model](size_t i) { PinCurrentThread(model.GrpcCpu(i)); });
+    }
+    grpc_compression_algorithm algorithm;
+    if (async_grpc::ParseCompressionAlgorithm(
+            util::ConfigManager::Instance()->GrpcCompression(), &algorithm)) {
+      server_builder.SetCompressionAlgorithm(algorithm);
+      server_builder.SetCompressionLevel(GRPC_COMPRESS_LEVEL_LOW);
+    } else {
+      LOG(ERROR) << "Unsupported grpc_compression: "
+                 << util::ConfigManager::Instance()->GrpcCompression();
+    }
+
+    server_builder.SetAdmissionPolicy(std::make_shared<GrpcAdmissionPolicy>(
+        impl::AdmissionController::Instance()));
+
+    if (util::ConfigManager::Instance()->EnableTracing()) {
+      InstallSpanExporters();
+      server_builder.EnableTracing();
+      server_builder.SetTracingSamplerProbability(
+          util::ConfigManager::Instance()->TracingSampleProbability());
+    }
 
     // Register handlers
     server_builder
@@ -53,10 +87,33 @@ class GrpcServer final {
     server_->GetContext<ServerContext>()->MarkedGrpcServerInitedDone();
   }
 
-  void Shutdown() { server_->Shutdown(); }
+  void Shutdown() {
+    server_->Shutdown();
+    trace::Tracer::Instance()->Flush();
+  }
   void WaitForShutdown() { server_->WaitForShutdown(); }
 
  private:
+  // Recent spans stay in memory for /debug/traces and optionally go to an
+  // OTLP/JSON file as well.
+  static void InstallSpanExporters() {
+    auto config_manager = util::ConfigManager::Instance();
+    auto tracer = trace::Tracer::Instance();
+    tracer->ClearExporters();
+    tracer->AddExporter(std::make_shared<trace::RingBufferExporter>(
+        config_manager->TracingBufferSpans()));
+    const std::string otlp_file = config_manager->TracingOtlpFile();
+    if (otlp_file.empty()) {
+      return;
+    }
+    auto otlp = std::make_shared<trace::OtlpFileExporter>(otlp_file, "tbox");
+    if (otlp->ok()) {
+      tracer->AddExporter(otlp);
+    } else {
+      LOG(ERROR) << "Cannot open trace file " << otlp_file;
+    }
+  }
+
   std::unique_ptr<async_grpc::Server> server_;
 
  public:
@@ -14,6 +14,7 @@
 #include "src/common/logging.h"
 #include "src/impl/config_manager.h"
 #include "src/impl/session_manager.h"
+#include "src/impl/sync/delta_sync.h"
 #include "src/util/util.h"
 
 namespace tbox {
@@ -346,6 +347,30 @@ void Handler::HandleGetCertFile(const proto::CertRequest& req,
   res->set_file_content(content);
 }
 
+void Handler::HandleGetCertFileDelta(const proto::CertRequest& req,
+                                     proto::CertResponse* res) {
+  if (!IsConfiguredCertificateRequest(req)) {
+    res->set_err_code(proto::ErrCode::User_session_error);
+    res->set_message("Certificate synchronization is not authorized");
+    return;
+  }
+
+  const std::string content =
+      ReadFileContent(ConfiguredCertificatePath(req.filename()));
+  if (content.empty()) {
+    res->set_err_code(proto::ErrCode::Fail);
+    res->set_message("Certificate file is unavailable");
+    return;
+  }
+  if (!impl::sync::DeltaSync::ComputeDelta(req.signature(), content,
+                                           res->mutable_delta())) {
+    res->set_err_code(proto::ErrCode::Fail);
+    res->set_message("Invalid file signature");
+    return;
+  }
+  res->set_err_code(proto::ErrCode::Success);
+}
+
 std::string Handler::ReadFileContent(const std::string& file_path) {
   std::ifstream file(file_path, std::ios::binary);
   if (!file.is_open()) {
@@ -242,6 +242,13 @@ class Handler {
   static void HandleGetCertFile(const proto::CertRequest& req,
                                 proto::CertResponse* res);
 
+  /**
+   * @brief Handle OP_GET_CERT_FILE_DELTA - Return only the blocks of a
+   * certificate file that differ from the signature sent by the client
+   */
+  static void HandleGetCertFileDelta(const proto::CertRequest& req,
+                                     proto::CertResponse* res);
+
   /**
    * @brief Read content from a file.
    *
@@ -0,0 +1,193 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_HTTP3_SERVER_IMPL_H_
+#define TBOX_SERVER_HTTP3_SERVER_IMPL_H_
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fizz/backend/openssl/certificate/CertUtils.h"
+#include "fizz/server/CertManager.h"
+#include "fizz/server/FizzServerContext.h"
+#include "folly/FileUtil.h"
+#include "folly/SocketAddress.h"
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include "proxygen/httpserver/RequestHandlerAdaptor.h"
+#include "proxygen/httpserver/RequestHandlerFactory.h"
+#include "proxygen/lib/http/session/HQDownstreamSession.h"
+#include "proxygen/lib/http/session/HTTPSessionController.h"
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#include "quic/server/QuicServer.h"
+#include "quic/server/QuicServerTransport.h"
+#include "quic/server/QuicServerTransportFactory.h"
+#include "src/common/logging.h"
+
+namespace tbox {
+namespace server {
+
+using HandlerFactories =
+    std::vector<std::shared_ptr<proxygen::RequestHandlerFactory>>;
+
+/// @brief Controller of one HTTP/3 connection; owns itself and is deleted
+///        when the session detaches.
+class Http3SessionController final
+    : public proxygen::HTTPSessionController,
+      public proxygen::HTTPSessionBase::InfoCallback {
+ public:
+  Http3SessionController(std::shared_ptr<const HandlerFactories> factories,
+                         std::chrono::milliseconds txn_timeout)
+      : factories_(std::move(factories)), txn_timeout_(txn_timeout) {}
+
+  proxygen::HQSession* CreateSession() {
+    wangle::TransportInfo tinfo;
+    session_ = new proxygen::HQDownstreamSession(txn_timeout_, this, tinfo,
+                                                 this);
+    return session_;
+  }
+
+  void StartSession(std::shared_ptr<quic::QuicSocket> socket) {
+    session_->setSocket(std::move(socket));
+    session_->startNow();
+  }
+
+  /// @brief Same handler chain as the TCP listeners, built last to first
+  ///        like proxygen::HTTPServer does.
+  proxygen::HTTPTransactionHandler* getRequestHandler(
+      proxygen::HTTPTransaction&, proxygen::HTTPMessage* msg) override {
+    proxygen::RequestHandler* handler = nullptr;
+    for (auto it = factories_->rbegin(); it != factories_->rend(); ++it) {
+      handler = (*it)->onRequest(handler, msg);
+    }
+    return new proxygen::RequestHandlerAdaptor(handler);
+  }
+
+  proxygen::HTTPTransactionHandler* getParseErrorHandler(
+      proxygen::HTTPTransaction*, const proxygen::HTTPException&,
+      const folly::SocketAddress&) override {
+    return nullptr;
+  }
+
+  proxygen::HTTPTransactionHandler* getTransactionTimeoutHandler(
+      proxygen::HTTPTransaction*, const folly::SocketAddress&) override {
+    return nullptr;
+  }
+
+  void attachSession(proxygen::HTTPSessionBase*) override {}
+
+  void detachSession(const proxygen::HTTPSessionBase*) override {
+    delete this;
+  }
+
+  void onDestroy(const proxygen::HTTPSessionBase&) override {}
+
+ private:
+  std::shared_ptr<const HandlerFactories> factories_;
+  std::chrono::milliseconds txn_timeout_;
+  proxygen::HQSession* session_ = nullptr;
+};
+
+class Http3TransportFactory final : public quic::QuicServerTransportFactory {
+ public:
+  Http3TransportFactory(std::shared_ptr<const HandlerFactories> factories,
+                        std::chrono::milliseconds txn_timeout)
+      : factories_(std::move(factories)), txn_timeout_(txn_timeout) {}
+
+  quic::QuicServerTransport::Ptr make(
+      folly::EventBase* evb, std::unique_ptr<quic::FollyAsyncUDPSocket> socket,
+      const folly::SocketAddress&, quic::QuicVersion,
+      std::shared_ptr<const fizz::server::FizzServerContext> ctx) noexcept
+      override {
+    auto* controller = new Http3SessionController(factories_, txn_timeout_);
+    auto* session = controller->CreateSession();
+    auto transport = quic::QuicServerTransport::make(evb, std::move(socket),
+                                                     session, session, ctx);
+    controller->StartSession(transport);
+    return transport;
+  }
+
+ private:
+  std::shared_ptr<const HandlerFactories> factories_;
+  std::chrono::milliseconds txn_timeout_;
+};
+
+/// @brief HTTP/3 listener: mvfst QuicServer feeding proxygen HQ sessions
+///        that run the regular request handlers.
+class Http3Server final {
+ public:
+  Http3Server(folly::SocketAddress addr, size_t threads,
+              std::chrono::milliseconds idle_timeout,
+              std::shared_ptr<const HandlerFactories> factories)
+      : addr_(std::move(addr)),
+        threads_(threads),
+        factories_(std::move(factories)) {
+    quic::TransportSettings settings;
+    settings.idleTimeout = idle_timeout;
+    settings.advertisedInitialMaxStreamsBidi = 128;
+    settings.advertisedInitialMaxStreamsUni = 128;
+    server_ = quic::QuicServer::createQuicServer(settings);
+    server_->setQuicServerTransportFactory(
+        std::make_unique<Http3TransportFactory>(factories_, idle_timeout));
+    server_->setSupportedVersion(
+        {quic::QuicVersion::QUIC_V1, quic::QuicVersion::QUIC_DRAFT});
+  }
+
+  /// @brief Load the certificate used for the QUIC handshake.
+  /// @return false if the files cannot be read or do not parse.
+  bool LoadCertificate(const std::string& cert_file,
+                       const std::string& key_file) {
+    std::string cert;
+    std::string key;
+    if (!folly::readFile(cert_file.c_str(), cert) ||
+        !folly::readFile(key_file.c_str(), key)) {
+      LOG(ERROR) << "HTTP/3 cannot read " << cert_file << " or " << key_file;
+      return false;
+    }
+    try {
+      auto cert_manager = std::make_shared<fizz::server::CertManager>();
+      cert_manager->addCertAndSetDefault(
+          fizz::openssl::CertUtils::makeSelfCert(std::move(cert),
+                                                 std::move(key)));
+      auto ctx = std::make_shared<fizz::server::FizzServerContext>();
+      ctx->setCertManager(std::move(cert_manager));
+      ctx->setSupportedAlpns({"h3"});
+      ctx->setAlpnMode(fizz::server::AlpnMode::Required);
+      ctx->setSendNewSessionTicket(false);
+      ctx->setVersionFallbackEnabled(false);
+      server_->setFizzContext(std::move(ctx));
+    } catch (const std::exception& e) {
+      LOG(ERROR) << "HTTP/3 certificate error: " << e.what();
+      return false;
+    }
+    return true;
+  }
+
+  /// @brief Start the QUIC workers; does not block.
+  void Start() {
+    server_->start(addr_, threads_);
+    LOG(INFO) << "HTTP/3 server listening on udp " << addr_.describe();
+  }
+
+  void Shutdown() { server_->shutdown(); }
+
+ private:
+  folly::SocketAddress addr_;
+  size_t threads_;
+  std::shared_ptr<const HandlerFactories> factories_;
+  std::shared_ptr<quic::QuicServer> server_;
+};
+
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_HTTP3_SERVER_IMPL_H_
@@ -0,0 +1,105 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_HTTP_HANDLER_ADMISSION_FILTER_H_
+#define TBOX_SERVER_HTTP_HANDLER_ADMISSION_FILTER_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "proxygen/httpserver/Filters.h"
+#include "proxygen/httpserver/RequestHandler.h"
+#include "proxygen/httpserver/ResponseBuilder.h"
+#include "proxygen/lib/http/HTTPMessage.h"
+#include "src/impl/admission_controller.h"
+#include "src/server/client_address.h"
+#include "src/server/http_handler/handler_pool.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+
+/**
+ * @brief Holds the admission permit of a request and gives it back once the
+ * response is complete (or failed), so the concurrency limit sees the full
+ * request latency.
+ */
+class AdmissionFilter : public proxygen::Filter {
+ public:
+  AdmissionFilter(proxygen::RequestHandler* upstream,
+                  impl::AdmissionController::Permit permit)
+      : proxygen::Filter(upstream), permit_(std::move(permit)) {}
+
+  void requestComplete() noexcept override {
+    permit_.Release();
+    proxygen::Filter::requestComplete();
+  }
+
+  void onError(proxygen::ProxygenError err) noexcept override {
+    permit_.Release();
+    proxygen::Filter::onError(err);
+  }
+
+ private:
+  impl::AdmissionController::Permit permit_;
+};
+
+/**
+ * @brief Answers a request that admission control turned away: 429 with
+ * Retry-After for rate limited clients, 503 when the server is overloaded.
+ * The request body is never read.
+ */
+class RejectHandler : public proxygen::RequestHandler {
+ public:
+  explicit RejectHandler(impl::AdmissionController::Decision decision)
+      : decision_(decision) {}
+
+  void onRequest(
+      std::unique_ptr<proxygen::HTTPMessage> /*headers*/) noexcept override {}
+
+  void onBody(std::unique_ptr<folly::IOBuf> /*body*/) noexcept override {}
+
+  void onEOM() noexcept override {
+    const bool overloaded =
+        decision_ == impl::AdmissionController::Decision::kOverloaded;
+    proxygen::ResponseBuilder(downstream_)
+        .status(overloaded ? 503 : 429,
+                overloaded ? "Service Unavailable" : "Too Many Requests")
+        .header(proxygen::HTTP_HEADER_RETRY_AFTER, "1")
+        .body(impl::AdmissionController::DecisionName(decision_))
+        .sendWithEOM();
+  }
+
+  void onUpgrade(proxygen::UpgradeProtocol /*protocol*/) noexcept override {}
+
+  void requestComplete() noexcept override {
+    HandlerPool<RejectHandler>::Release(this);
+  }
+
+  void onError(proxygen::ProxygenError /*err*/) noexcept override {
+    HandlerPool<RejectHandler>::Release(this);
+  }
+
+ private:
+  impl::AdmissionController::Decision decision_;
+};
+
+/**
+ * @brief Client address for rate limiting: the connection's peer, or the
+ * client a trusted reverse proxy forwards for; see ClientAddress.
+ */
+inline std::string AdmissionClientIp(const proxygen::HTTPMessage& msg) {
+  const proxygen::HTTPHeaders& headers = msg.getHeaders();
+  return ClientAddress::Instance().Resolve(
+      msg.getClientIP(), headers.combine("x-forwarded-for", ","),
+      headers.getSingleOrEmpty("x-real-ip"));
+}
+
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_HTTP_HANDLER_ADMISSION_FILTER_H_
@@ -0,0 +1,67 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_HTTP_HANDLER_ALT_SVC_FILTER_H_
+#define TBOX_SERVER_HTTP_HANDLER_ALT_SVC_FILTER_H_
+
+#include <cstdint>
+#include <string>
+
+#include "proxygen/httpserver/Filters.h"
+#include "proxygen/httpserver/RequestHandlerFactory.h"
+#include "proxygen/lib/http/HTTPMessage.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+
+/**
+ * @brief Adds an Alt-Svc header to every response so browsers learn about
+ * the HTTP/3 listener and switch to it on their next request.
+ */
+class AltSvcFilter : public proxygen::Filter {
+ public:
+  AltSvcFilter(proxygen::RequestHandler* upstream, const std::string* value)
+      : proxygen::Filter(upstream), value_(value) {}
+
+  void sendHeaders(proxygen::HTTPMessage& msg) noexcept override {
+    msg.getHeaders().set("Alt-Svc", *value_);
+    downstream_->sendHeaders(msg);
+  }
+
+ private:
+  const std::string* value_;
+};
+
+class AltSvcFilterFactory : public proxygen::RequestHandlerFactory {
+ public:
+  /**
+   * @param http3_port UDP port of the HTTP/3 listener.
+   * @param max_age_sec How long clients may remember the alternative.
+   */
+  explicit AltSvcFilterFactory(uint32_t http3_port,
+                               uint32_t max_age_sec = 86400)
+      : value_("h3=\":" + std::to_string(http3_port) +
+               "\"; ma=" + std::to_string(max_age_sec)) {}
+
+  void onServerStart(folly::EventBase*) noexcept override {}
+
+  void onServerStop() noexcept override {}
+
+  proxygen::RequestHandler* onRequest(
+      proxygen::RequestHandler* handler,
+      proxygen::HTTPMessage*) noexcept override {
+    return new AltSvcFilter(handler, &value_);
+  }
+
+ private:
+  const std::string value_;
+};
+
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_HTTP_HANDLER_ALT_SVC_FILTER_H_
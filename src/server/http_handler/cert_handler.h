@@ -6,10 +6,14 @@
 #ifndef TBOX_SERVER_HTTP_HANDLER_CERT_HANDLER_H
 #define TBOX_SERVER_HTTP_HANDLER_CERT_HANDLER_H
 
+#include <string>
+#include <utility>
+
 #include "src/common/logging.h"
 #include "proxygen/httpserver/RequestHandler.h"
 #include "src/proto/service.pb.h"
 #include "src/server/handler/handler.h"
+#include "src/server/http_handler/message_codec.h"
 #include "src/server/http_handler/util.h"
 
 namespace tbox {
@@ -18,7 +22,15 @@ namespace http_handler {
 
 class CertHandler : public proxygen::RequestHandler {
  public:
-  void onRequest(std::unique_ptr<proxygen::HTTPMessage>) noexcept override {}
+  void onRequest(
+      std::unique_ptr<proxygen::HTTPMessage> headers) noexcept override {
+    const proxygen::HTTPHeaders& http_headers = headers->getHeaders();
+    request_format_ = MessageCodec::RequestFormat(
+        http_headers.getSingleOrEmpty(proxygen::HTTP_HEADER_CONTENT_TYPE));
+    response_format_ = MessageCodec::ResponseFormat(
+        http_headers.getSingleOrEmpty(proxygen::HTTP_HEADER_ACCEPT),
+        request_format_);
+  }
 
   void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
     body_.append(reinterpret_cast<const char*>(body->data()), body->length());
@@ -29,8 +41,10 @@ class CertHandler : public proxygen::RequestHandler {
     proto::CertResponse res;
     std::string res_body = "Parse request error";
 
-    if (!util::Util::JsonToMessage(body_, &req)) {
-      LOG(INFO) << body_;
+    if (!MessageCodec::Parse(&body_, request_format_, &req)) {
+      if (request_format_ == BodyFormat::kJson) {
+        LOG(INFO) << body_;
+      }
       Util::InternalServerError(res_body, downstream_);
       return;
     }
@@ -54,6 +68,9 @@ class CertHandler : public proxygen::RequestHandler {
         case proto::OpCode::OP_GET_CERT_FILE:
           handler::Handler::HandleGetCertFile(req, &res);
           break;
+        case proto::OpCode::OP_GET_CERT_FILE_DELTA:
+          handler::Handler::HandleGetCertFileDelta(req, &res);
+          break;
         default:
           res.set_err_code(proto::ErrCode::Fail);
           res.set_message("Invalid operation code for certificate management");
@@ -66,13 +83,13 @@ class CertHandler : public proxygen::RequestHandler {
       res.set_message(std::string("Operation failed: ") + e.what());
     }
 
-    res_body.clear();
-    if (!util::Util::MessageToJson(res, &res_body)) {
-      res_body = "Response pb to json error";
+    if (!MessageCodec::Serialize(res, response_format_, &res_body)) {
+      res_body = "Response pb serialize error";
       Util::InternalServerError(res_body, downstream_);
       return;
     }
-    Util::Success(res_body, downstream_);
+    Util::Success(std::move(res_body),
+                  MessageCodec::ContentType(response_format_), downstream_);
   }
 
   void onUpgrade(proxygen::UpgradeProtocol) noexcept override {}
@@ -81,6 +98,8 @@ class CertHandler : public proxygen::RequestHandler {
 
  private:
   std::string body_;
+  BodyFormat request_format_ = BodyFormat::kJson;
+  BodyFormat response_format_ = BodyFormat::kJson;
 };
 
 }  // namespace http_handler
@@ -0,0 +1,321 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_HTTP_HANDLER_DEBUG_HANDLER_H_
+#define TBOX_SERVER_HTTP_HANDLER_DEBUG_HANDLER_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "folly/Executor.h"
+#include "folly/io/async/EventBase.h"
+#include "folly/io/async/EventBaseManager.h"
+#include "proxygen/httpserver/RequestHandler.h"
+#include "proxygen/httpserver/ResponseBuilder.h"
+#include "proxygen/lib/http/HTTPMessage.h"
+#include "src/common/profiler.h"
+#include "src/common/trace.h"
+#include "src/server/client_address.h"
+#include "src/server/http_handler/handler_pool.h"
+#include "src/server/http_handler/util.h"
+
+#if defined(__linux__)
+#include "folly/Demangle.h"
+#include "folly/debugging/symbolizer/Symbolizer.h"
+#endif
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+
+/**
+ * @brief Introspection pages under /debug/.
+ *
+ * - "/debug/traces" lists the slowest recent gRPC requests still held by the
+ *   tracer's ring buffer, each with its spans: queue wait, handler, session
+ *   validation, DB and DNS calls. "?n=" sets how many (default 20).
+ * - "/debug/pprof/profile" samples the CPU of the whole process for
+ *   "?seconds=" (default 30) at "?hz=" (default 100) and returns a gzipped
+ *   pprof profile: `pprof -http=: http://127.0.0.1:<port>/debug/pprof/profile`.
+ * - "/debug/pprof/heap" returns the sampled heap profile, live and total
+ *   allocations by stack. Sampling is process wide, so it is only turned on
+ *   by heap_profile_sample_bytes in the server config, never by a request;
+ *   without it the page answers 409.
+ *
+ * Profiles are symbolized in process and built off the event base, which
+ * sends the response once they are done. One CPU profile runs at a time and
+ * others get 409 without starting a thread; the running one ends early when
+ * the server stops, see StopProfiles().
+ *
+ * The pages expose internals, so the factory only routes clients connected
+ * over loopback here, and not requests a proxy forwards for a remote client;
+ * see IsLocalClient().
+ */
+class DebugHandler : public proxygen::RequestHandler {
+ public:
+  static constexpr size_t kDefaultTraces = 20;
+  static constexpr size_t kMaxTraces = 200;
+  static constexpr int kDefaultProfileSeconds = 30;
+  static constexpr int kMaxProfileSeconds = 300;
+
+  /// @brief True if the connection comes from this host and is not proxied
+  ///        for someone else: forwarding headers count only from a trusted
+  ///        proxy, see ClientAddress::IsLocal.
+  static bool IsLocalClient(const proxygen::HTTPMessage& msg) {
+    const proxygen::HTTPHeaders& headers = msg.getHeaders();
+    return ClientAddress::Instance().IsLocal(
+        msg.getClientIP(), headers.combine("x-forwarded-for", ","),
+        headers.getSingleOrEmpty("x-real-ip"));
+  }
+
+  void onRequest(
+      std::unique_ptr<proxygen::HTTPMessage> headers) noexcept override {
+    path_ = headers->getPath();
+    const std::string& n = headers->getQueryParam("n");
+    if (!n.empty()) {
+      count_ = std::strtoul(n.c_str(), nullptr, 10);
+      if (count_ == 0) {
+        count_ = kDefaultTraces;
+      } else if (count_ > kMaxTraces) {
+        count_ = kMaxTraces;
+      }
+    }
+    const std::string& seconds = headers->getQueryParam("seconds");
+    if (!seconds.empty()) {
+      seconds_ = std::clamp(std::atoi(seconds.c_str()), 1, kMaxProfileSeconds);
+    }
+    const std::string& hz = headers->getQueryParam("hz");
+    if (!hz.empty()) {
+      hz_ = std::clamp(std::atoi(hz.c_str()), 1,
+                       profiler::CpuProfiler::kMaxHz);
+    }
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> /*body*/) noexcept override {}
+
+  void onEOM() noexcept override {
+    if (path_ == "/debug/traces") {
+      Util::Success(TracesPage(count_), "text/html; charset=utf-8",
+                    downstream_);
+      return;
+    }
+    if (path_ == "/debug/pprof/profile" || path_ == "/debug/pprof/heap") {
+      StartProfile(path_ == "/debug/pprof/heap");
+      return;
+    }
+    proxygen::ResponseBuilder(downstream_)
+        .status(404, "Not Found")
+        .body("The requested path was not found on this server.")
+        .sendWithEOM();
+  }
+
+  void onUpgrade(proxygen::UpgradeProtocol /*protocol*/) noexcept override {}
+
+  void requestComplete() noexcept override {
+    HandlerPool<DebugHandler>::Release(this);
+  }
+
+  void onError(proxygen::ProxygenError /*err*/) noexcept override {
+    HandlerPool<DebugHandler>::Release(this);
+  }
+
+  /// @brief Ends a running CPU profile, so that its thread lets go of the
+  ///        event base before the server waits for it to stop.
+  static void StopProfiles() { profiler::CpuProfiler::Instance()->Stop(); }
+
+  /// @brief The /debug/traces page for the count slowest traces.
+  static std::string TracesPage(size_t count) {
+    auto tracer = trace::Tracer::Instance();
+    auto ring = tracer->FindExporter<trace::RingBufferExporter>();
+    std::string page =
+        "<!DOCTYPE html><html><head><title>tbox traces</title><style>"
+        "body{font-family:monospace}td{padding:0 1em 0 0}"
+        ".error{color:#b00}</style></head><body><h1>Slowest recent RPCs</h1>";
+    if (!ring) {
+      page += "<p>Tracing is disabled, set enable_tracing in the server "
+              "config.</p></body></html>";
+      return page;
+    }
+    char line[160];
+    std::snprintf(line, sizeof(line),
+                  "<p>Sampling %.4g of requests, %zu spans buffered.</p>",
+                  tracer->sample_probability(), ring->Snapshot().size());
+    page += line;
+    page += "<table><tr><th>span</th><th>start (ms)</th><th>duration (ms)"
+            "</th><th>status</th><th>attributes</th></tr>";
+    for (const auto& trace : ring->SlowestTraces(count)) {
+      std::unordered_map<uint64_t, int> depth;
+      depth[trace.root.context.span_id] = 0;
+      AppendRow(trace.root, trace.root.start_unix_nanos, 0, &page);
+      for (const auto& span : trace.children) {
+        auto parent = depth.find(span.parent_span_id);
+        const int level = parent == depth.end() ? 1 : parent->second + 1;
+        depth[span.context.span_id] = level;
+        AppendRow(span, trace.root.start_unix_nanos, level, &page);
+      }
+      page += "<tr><td colspan=5>&nbsp;</td></tr>";
+    }
+    page += "</table></body></html>";
+    return page;
+  }
+
+ private:
+  // Collects on a thread of its own and responds on this event base, unless
+  // the request is gone by then. The keep-alive holds the event base open
+  // until the response is queued.
+  void StartProfile(bool heap) {
+    if (heap && !profiler::HeapProfiler::Supported()) {
+      SendProfile(501, "Profiling is not supported on this platform.");
+      return;
+    }
+    if (heap && profiler::HeapProfiler::Instance()->sample_interval() == 0) {
+      SendProfile(409,
+                  "Heap sampling is off, set heap_profile_sample_bytes in "
+                  "the server config.");
+      return;
+    }
+    if (!heap && !profiler::CpuProfiler::Supported()) {
+      SendProfile(501, "Profiling is not supported on this platform.");
+      return;
+    }
+    if (!heap && profiler::CpuProfiler::Instance()->running()) {
+      SendProfile(409, "A CPU profile is already running.");
+      return;
+    }
+    self_ = std::make_shared<DebugHandler*>(this);
+    std::weak_ptr<DebugHandler*> weak = self_;
+    auto evb = folly::getKeepAliveToken(
+        folly::EventBaseManager::get()->getExistingEventBase());
+    std::thread([evb = std::move(evb), weak, heap, seconds = seconds_,
+                 hz = hz_]() mutable {
+      int status = 200;
+      std::string body;
+      profiler::ProfileBuilder builder({});
+      if (heap) {
+        profiler::HeapProfiler::Instance()->Collect(&builder);
+      } else if (!profiler::CpuProfiler::Instance()->Collect(
+                     std::chrono::seconds(seconds), hz, &builder)) {
+        status = 409;
+        body = "A CPU profile is already running.";
+      }
+      if (status == 200) {
+        body = builder.Build(&DebugHandler::Symbolize);
+      }
+      evb->runInEventBaseThread(
+          [weak, status, body = std::move(body)]() mutable {
+            if (auto self = weak.lock()) {
+              (*self)->SendProfile(status, std::move(body));
+            }
+          });
+    }).detach();
+  }
+
+  void SendProfile(int status, std::string body) {
+    if (status == 200) {
+      Util::Success(std::move(body), "application/octet-stream", downstream_);
+      return;
+    }
+    proxygen::ResponseBuilder(downstream_)
+        .status(status, status == 409 ? "Conflict" : "Not Implemented")
+        .body(std::move(body))
+        .sendWithEOM();
+  }
+
+  static void Symbolize(const std::vector<uint64_t>& addresses,
+                        std::vector<profiler::Frame>* frames) {
+#if defined(__linux__)
+    if (!folly::symbolizer::Symbolizer::isAvailable()) {
+      return;
+    }
+    folly::symbolizer::Symbolizer symbolizer(
+        folly::symbolizer::LocationInfoMode::FAST);
+    const std::vector<uintptr_t> pcs(addresses.begin(), addresses.end());
+    std::vector<folly::symbolizer::SymbolizedFrame> symbolized(pcs.size());
+    symbolizer.symbolize(folly::range(pcs), folly::range(symbolized));
+    for (size_t i = 0; i < symbolized.size(); ++i) {
+      const auto& frame = symbolized[i];
+      if (!frame.found || frame.name == nullptr) {
+        continue;
+      }
+      (*frames)[i].function = folly::demangle(frame.name).toStdString();
+      if (frame.location.hasFileAndLine) {
+        (*frames)[i].file = frame.location.file.toString();
+        (*frames)[i].line = static_cast<int64_t>(frame.location.line);
+      }
+    }
+#else
+    (void)addresses;
+    (void)frames;
+#endif
+  }
+
+  static void AppendEscaped(std::string_view text, std::string* out) {
+    for (const char c : text) {
+      switch (c) {
+        case '<':
+          *out += "&lt;";
+          break;
+        case '>':
+          *out += "&gt;";
+          break;
+        case '&':
+          *out += "&amp;";
+          break;
+        case '"':
+          *out += "&quot;";
+          break;
+        default:
+          *out += c;
+      }
+    }
+  }
+
+  static void AppendRow(const trace::SpanData& span, int64_t trace_start,
+                        int level, std::string* out) {
+    const bool error = span.status == trace::StatusCode::kError;
+    *out += error ? "<tr class=error><td>" : "<tr><td>";
+    for (int i = 0; i < level; ++i) {
+      *out += "&nbsp;&nbsp;";
+    }
+    AppendEscaped(span.name, out);
+    char times[96];
+    std::snprintf(times, sizeof(times), "</td><td>%.3f</td><td>%.3f</td><td>",
+                  (span.start_unix_nanos - trace_start) / 1e6,
+                  span.duration_nanos() / 1e6);
+    *out += times;
+    *out += error ? "error " : "";
+    AppendEscaped(span.status_message, out);
+    *out += "</td><td>";
+    for (const auto& [key, value] : span.attributes) {
+      AppendEscaped(key, out);
+      *out += "=";
+      AppendEscaped(value, out);
+      *out += " ";
+    }
+    *out += "</td></tr>";
+  }
+
+  std::string path_;
+  size_t count_ = kDefaultTraces;
+  int seconds_ = kDefaultProfileSeconds;
+  int hz_ = profiler::CpuProfiler::kDefaultHz;
+  std::shared_ptr<DebugHandler*> self_;
+};
+
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_HTTP_HANDLER_DEBUG_HANDLER_H_
@@ -9,6 +9,7 @@
 #include "proxygen/httpserver/RequestHandler.h"
 #include "proxygen/httpserver/ResponseBuilder.h"
 #include "proxygen/lib/http/HTTPMessage.h"
+#include "src/server/http_handler/handler_pool.h"
 
 namespace tbox {
 namespace server {
@@ -16,6 +17,11 @@ namespace http_handler {
 
 class DefaultHandler : public proxygen::RequestHandler {
  public:
+  /// @param method_not_allowed Answer 405 instead of 404: the path exists
+  ///        but not for the request method.
+  explicit DefaultHandler(bool method_not_allowed = false)
+      : method_not_allowed_(method_not_allowed) {}
+
   void onRequest(
       std::unique_ptr<proxygen::HTTPMessage> headers) noexcept override {
     const proxygen::HTTPHeaders& reqHeaders = headers->getHeaders();
@@ -32,6 +38,13 @@ class DefaultHandler : public proxygen::RequestHandler {
   }
 
   void onEOM() noexcept override {
+    if (method_not_allowed_) {
+      proxygen::ResponseBuilder(downstream_)
+          .status(405, "Method Not Allowed")
+          .body("The requested method is not allowed for this path.")
+          .sendWithEOM();
+      return;
+    }
     // Respond with a 404 Not Found when the request reaches the end
     proxygen::ResponseBuilder(downstream_)
         .status(404, "Not Found")
@@ -41,11 +54,16 @@ class DefaultHandler : public proxygen::RequestHandler {
 
   void onUpgrade(proxygen::UpgradeProtocol /*protocol*/) noexcept override {}
 
-  void requestComplete() noexcept override { delete this; }
+  void requestComplete() noexcept override {
+    HandlerPool<DefaultHandler>::Release(this);
+  }
 
   void onError(proxygen::ProxygenError /*err*/) noexcept override {
-    delete this;
+    HandlerPool<DefaultHandler>::Release(this);
   }
+
+ private:
+  bool method_not_allowed_;
 };
 
 }  // namespace http_handler
@@ -0,0 +1,262 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_HTTP_HANDLER_EVENT_WEBSOCKET_HANDLER_H_
+#define TBOX_SERVER_HTTP_HANDLER_EVENT_WEBSOCKET_HANDLER_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "folly/io/IOBuf.h"
+#include "folly/io/async/EventBase.h"
+#include "folly/io/async/EventBaseManager.h"
+#include "proxygen/httpserver/RequestHandler.h"
+#include "proxygen/httpserver/ResponseBuilder.h"
+#include "proxygen/lib/http/HTTPMessage.h"
+#include "src/common/logging.h"
+#include "src/impl/config_manager.h"
+#include "src/impl/event_hub.h"
+#include "src/server/http_handler/websocket_handler.h"
+#include "src/util/compression.h"
+#include "src/util/io_buffer.h"
+#include "src/util/util.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+
+/**
+ * @brief Streams EventHub events to a WebSocket client at "/ws".
+ *
+ * The optional `topics` query parameter is a comma separated subset of
+ * client, cert and ddns; all topics are sent without it. Events arrive as
+ * JSON text frames.
+ *
+ * The upgrade negotiates a compression extension from the client's
+ * Sec-WebSocket-Extensions offer, limited to the websocket_compression
+ * codecs of the server config, with the websocket_dictionary for zstd and
+ * lz4 clients that offer its id. Connections are written straight from the
+ * hub's shared buffers: the hub compresses each event once per codec and
+ * dictionary in use, not once per connection.
+ *
+ * While proxygen reports the transport as paused nothing is drained; a
+ * client that stays behind long enough is evicted by the hub and closed
+ * with 1008.
+ */
+class EventWebSocketHandler : public proxygen::RequestHandler {
+ public:
+  void onRequest(
+      std::unique_ptr<proxygen::HTTPMessage> headers) noexcept override {
+    if (!headers->isIngressWebsocketUpgrade()) {
+      proxygen::ResponseBuilder(downstream_)
+          .status(426, "Upgrade Required")
+          .header(proxygen::HTTP_HEADER_UPGRADE, kUpgradeTo)
+          .sendWithEOM();
+      closed_ = true;
+      return;
+    }
+
+    std::set<std::string> topics;
+    std::vector<std::string> names;
+    util::Util::Split(headers->getQueryParam("topics"), ",", &names);
+    for (const auto& name : names) {
+      const std::string topic = util::Util::Trim(name);
+      if (!topic.empty()) {
+        topics.insert(topic);
+      }
+    }
+
+    websocket_.SetCompressionCodecs(
+        util::ConfigManager::Instance()->WebSocketCompression());
+    websocket_.SetDictionary(SharedDictionary());
+    const std::string extensions = websocket_.NegotiateExtensions(
+        headers->getHeaders().getSingleOrEmpty(kWSExtensionsHeader));
+
+    // Hub callbacks run on publisher threads; they only hop onto this
+    // connection's event base, where the handler may already be gone.
+    folly::EventBase* evb =
+        folly::EventBaseManager::get()->getExistingEventBase();
+    self_ = std::make_shared<EventWebSocketHandler*>(this);
+    std::weak_ptr<EventWebSocketHandler*> weak = self_;
+    hub_ = impl::EventHub::Instance();
+    subscriber_id_ = hub_->Subscribe(
+        topics,
+        [evb, weak] {
+          evb->runInEventBaseThread([weak] {
+            if (auto self = weak.lock()) {
+              (*self)->Flush();
+            }
+          });
+        },
+        [evb, weak] {
+          evb->runInEventBaseThread([weak] {
+            if (auto self = weak.lock()) {
+              (*self)->Close(kCloseSlowConsumer);
+            }
+          });
+        },
+        EncoderFor(websocket_.Codec(), websocket_.Dictionary()));
+    subscribed_ = true;
+
+    websocket_.SetSendFrameCallback([this](const std::string& frame) {
+      if (!closed_) {
+        downstream_->sendBody(util::CopyIoBuffer(frame));
+      }
+    });
+    websocket_.SetCloseCallback([this] { Finish(); });
+
+    proxygen::ResponseBuilder response(downstream_);
+    response.status(101, "Switching Protocols").setEgressWebsocketHeaders();
+    if (!extensions.empty()) {
+      response.header(kWSExtensionsHeader, extensions);
+    }
+    response.send();
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    // Clients only send control frames here; data messages are ignored.
+    if (subscribed_ && !closed_ && !websocket_.OnData(std::move(body))) {
+      Close(kCloseProtocolError);
+    }
+  }
+
+  void onEOM() noexcept override { Finish(); }
+
+  void onUpgrade(proxygen::UpgradeProtocol) noexcept override {}
+
+  void onEgressPaused() noexcept override { paused_ = true; }
+
+  void onEgressResumed() noexcept override {
+    paused_ = false;
+    Flush();
+  }
+
+  void requestComplete() noexcept override { Release(); }
+
+  void onError(proxygen::ProxygenError) noexcept override { Release(); }
+
+ private:
+  static constexpr uint16_t kCloseProtocolError = 1002;
+  static constexpr uint16_t kCloseSlowConsumer = 1008;
+
+  void Flush() {
+    if (closed_ || paused_ || !subscribed_) {
+      return;
+    }
+    auto frames = hub_->Drain(subscriber_id_);
+    if (frames) {
+      downstream_->sendBody(std::move(frames));
+    }
+  }
+
+  // Shared by all connections with the same codec and dictionary, so the
+  // hub compresses each event once per combination. Payloads that do not
+  // shrink fall back to the hub's plain frame.
+  static std::shared_ptr<const impl::EventHub::FrameEncoder> EncoderFor(
+      util::CompressionCodec codec,
+      const util::CompressionDictionary* dictionary) {
+    if (codec == util::CompressionCodec::kNone) {
+      return nullptr;
+    }
+    static std::mutex mutex;
+    static std::map<std::pair<util::CompressionCodec,
+                              const util::CompressionDictionary*>,
+                    std::shared_ptr<const impl::EventHub::FrameEncoder>>
+        encoders;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& encoder = encoders[{codec, dictionary}];
+    if (!encoder) {
+      encoder = std::make_shared<const impl::EventHub::FrameEncoder>(
+          [codec, dictionary](const std::string& payload)
+              -> std::unique_ptr<folly::IOBuf> {
+            std::string compressed;
+            if (payload.size() >= util::Compression::kMinCompressSize &&
+                util::Compression::Compress(codec, payload, &compressed, 0,
+                                            dictionary) &&
+                compressed.size() < payload.size()) {
+              return impl::EventHub::EncodeTextFrame(compressed, true);
+            }
+            return nullptr;
+          });
+    }
+    return encoder;
+  }
+
+  // The websocket_dictionary of the server config, loaded on first use. It is
+  // never freed, encoders keep a raw pointer to it.
+  static std::shared_ptr<const util::CompressionDictionary>
+  SharedDictionary() {
+    static const auto dictionary = LoadDictionary();
+    return dictionary;
+  }
+
+  static std::shared_ptr<const util::CompressionDictionary> LoadDictionary() {
+    const std::string path =
+        util::ConfigManager::Instance()->WebSocketDictionary();
+    if (path.empty()) {
+      return nullptr;
+    }
+    std::string content;
+    if (!util::Util::LoadSmallFile(path, &content) || content.empty()) {
+      LOG(ERROR) << "Cannot load WebSocket dictionary " << path;
+      return nullptr;
+    }
+    return std::make_shared<const util::CompressionDictionary>(
+        std::move(content));
+  }
+
+  void Close(uint16_t code) {
+    if (closed_) {
+      return;
+    }
+    const uint16_t wire_code = htons(code);
+    downstream_->sendBody(util::CopyIoBuffer(websocket_.AssembleFrame(
+        std::string(reinterpret_cast<const char*>(&wire_code),
+                    sizeof(wire_code)),
+        kWSOpClose)));
+    Finish();
+  }
+
+  void Finish() {
+    if (closed_) {
+      return;
+    }
+    closed_ = true;
+    Unsubscribe();
+    downstream_->sendEOM();
+  }
+
+  void Unsubscribe() {
+    if (subscribed_) {
+      subscribed_ = false;
+      hub_->Unsubscribe(subscriber_id_);
+    }
+  }
+
+  void Release() {
+    Unsubscribe();
+    self_.reset();
+    delete this;
+  }
+
+  WebSocketHandler websocket_;
+  std::shared_ptr<impl::EventHub> hub_;
+  impl::EventHub::SubscriberId subscriber_id_ = 0;
+  std::shared_ptr<EventWebSocketHandler*> self_;
+  bool subscribed_ = false;
+  bool paused_ = false;
+  bool closed_ = false;
+};
+
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_HTTP_HANDLER_EVENT_WEBSOCKET_HANDLER_H_
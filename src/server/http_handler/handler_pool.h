@@ -0,0 +1,77 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_HTTP_HANDLER_HANDLER_POOL_H_
+#define TBOX_SERVER_HTTP_HANDLER_HANDLER_POOL_H_
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+
+/// @brief Per-thread freelist that recycles request handler memory.
+/// @details proxygen creates a handler and delivers all of its callbacks on
+///          one EventBase thread, so a thread_local list is a per-EventBase
+///          list and needs no locking. Release() runs the destructor and
+///          keeps the storage; Acquire() constructs a fresh object in it, so
+///          a recycled handler never sees state from its previous request.
+///          Handlers call Release(this) where they would `delete this`.
+template <typename T>
+class HandlerPool final {
+  // Storage comes from plain operator new and is freed the same way.
+  static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+ public:
+  static constexpr size_t kMaxFree = 256;
+
+  template <typename... Args>
+  static T* Acquire(Args&&... args) {
+    auto& free_list = List().free;
+    if (free_list.empty()) {
+      return new T(std::forward<Args>(args)...);
+    }
+    void* storage = free_list.back();
+    free_list.pop_back();
+    return new (storage) T(std::forward<Args>(args)...);
+  }
+
+  static void Release(T* handler) {
+    auto& free_list = List().free;
+    handler->~T();
+    if (free_list.size() < kMaxFree) {
+      free_list.push_back(handler);
+    } else {
+      ::operator delete(static_cast<void*>(handler));
+    }
+  }
+
+  /// @brief Objects waiting for reuse on the calling thread.
+  static size_t FreeCount() { return List().free.size(); }
+
+ private:
+  struct FreeList {
+    ~FreeList() {
+      for (void* storage : free) {
+        ::operator delete(storage);
+      }
+    }
+    std::vector<void*> free;
+  };
+
+  static FreeList& List() {
+    static thread_local FreeList list;
+    return list;
+  }
+};
+
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_HTTP_HANDLER_HANDLER_POOL_H_
@@ -6,44 +6,215 @@
 #ifndef TBOX_SERVER_HTTP_HANDLER_HTTP_HANDLER_FACTORY_H_
 #define TBOX_SERVER_HTTP_HANDLER_HTTP_HANDLER_FACTORY_H_
 
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
 #include "proxygen/httpserver/RequestHandler.h"
 #include "proxygen/httpserver/RequestHandlerFactory.h"
 #include "src/common/logging.h"
+#include "src/common/metrics.h"
+#include "src/impl/admission_controller.h"
+#include "src/impl/config_manager.h"
+#include "src/server/http_handler/admission_filter.h"
+#include "src/server/http_handler/debug_handler.h"
 #include "src/server/http_handler/default_handler.h"
+#include "src/server/http_handler/event_websocket_handler.h"
+#include "src/server/http_handler/handler_pool.h"
+#include "src/server/http_handler/metrics_handler.h"
+#include "src/server/http_handler/router.h"
 #include "src/server/http_handler/server_handler.h"
+#include "src/server/http_handler/static_assets.h"
+#include "src/server/http_handler/static_handler.h"
 #include "src/server/http_handler/user_handler.h"
 
 namespace tbox {
 namespace server {
 namespace http_handler {
 
+enum HttpRoute : int {
+  kHttpRouteUser = 0,
+  kHttpRouteServer = 1,
+  kHttpRouteEvents = 2,
+  kHttpRouteStatic = 3,
+  kHttpRouteDebug = 4,
+  kHttpRouteMetrics = 5,
+};
+
+inline constexpr Route kHttpRoutes[] = {
+    {"/user", kRouteAny, kHttpRouteUser},
+    {"/server", kRouteAny, kHttpRouteServer},
+    {"/ws", kRouteGet, kHttpRouteEvents},
+    {"/debug/*", kRouteGet, kHttpRouteDebug},
+    {"/metrics", kRouteGet, kHttpRouteMetrics},
+    {"/*", kRouteGet | kRouteHead, kHttpRouteStatic},
+};
+
+inline constexpr auto kHttpRouteTable = MakeRouteTable(kHttpRoutes);
+
 /**
  * @brief Factory for creating HTTP request handlers based on URI path.
  *
- * Maps exact paths to concrete handlers:
+ * Routes come from the compile-time `kHttpRouteTable`:
  * - "/user"   -> `UserHandler`
  * - "/server" -> `ServerHandler`
- * All other paths fall back to `DefaultHandler` which returns 404.
+ * - "/ws"     -> `EventWebSocketHandler` (event stream, GET only)
+ * - "/debug/*" -> `DebugHandler` (GET only) for loopback peers that are not
+ *                 proxying for a remote client, 404 for everyone else
+ * - "/metrics" -> `MetricsHandler` (Prometheus, GET only) for the same
+ *                 local clients as "/debug/*", or everyone with
+ *                 metrics_public set
+ * - "/*"      -> `StaticHandler` (dashboard, GET and HEAD) once a web root
+ *                is loaded; a fallback, so other methods on unknown paths
+ *                still get 404
+ * All other requests fall back to `DefaultHandler` which returns 404, or
+ * 405 for a known path with the wrong method. Short lived handlers come from
+ * the per-EventBase `HandlerPool`.
+ *
+ * API routes pass `AdmissionController` first, on the headers alone, so a
+ * flooding client is turned away before its body is read or a handler is
+ * created. Static assets are served from memory and are not limited.
+ *
+ * A `LatencyFilter` times every request except the long lived "/ws" stream
+ * into tbox_http_request_duration_seconds, labelled by route; turned away
+ * requests count as "rejected", unknown paths as "other".
  */
 class HTTPHandlerFactory : public proxygen::RequestHandlerFactory {
  public:
   void onServerStart(folly::EventBase*) noexcept override {}
 
-  void onServerStop() noexcept override { LOG(INFO) << "HTTP server stopped"; }
+  void onServerStop() noexcept override {
+    // A CPU profile thread holds an event base open until it responds.
+    DebugHandler::StopProfiles();
+    LOG(INFO) << "HTTP server stopped";
+  }
 
   /**
-   * @brief Select a handler for the incoming request based on path.
+   * @brief Select a handler for the incoming request based on method and
+   * path.
    */
   proxygen::RequestHandler* onRequest(
       proxygen::RequestHandler*, proxygen::HTTPMessage* msg) noexcept override {
-    if (msg->getPath() == "/user") {
-      return new UserHandler();
-    } else if (msg->getPath() == "/server") {
-      return new ServerHandler();
-    } else {
-      return new DefaultHandler();
+    const int route =
+        kHttpRouteTable.Find(ToRouteMethod(*msg), msg->getPath());
+    impl::AdmissionController::Permit permit;
+    if (route == kHttpRouteUser || route == kHttpRouteServer ||
+        route == kHttpRouteEvents) {
+      impl::AdmissionController::Request request;
+      request.client_id = msg->getHeaders().getSingleOrEmpty("x-client-id");
+      const std::string ip = AdmissionClientIp(*msg);
+      request.ip = ip;
+      // Logins hash a password, which costs far more than other requests.
+      if (route == kHttpRouteUser) {
+        request.cost = impl::AdmissionController::kPasswordHashCost;
+      }
+      request.counts_toward_concurrency = route != kHttpRouteEvents;
+      const auto decision = admission_->Admit(request, &permit);
+      if (decision != impl::AdmissionController::Decision::kAdmitted) {
+        return Timed(kLatencyRejected,
+                     HandlerPool<RejectHandler>::Acquire(decision));
+      }
+    }
+    switch (route) {
+      case kHttpRouteUser:
+        return Timed(route, WithPermit(HandlerPool<UserHandler>::Acquire(),
+                                       std::move(permit)));
+      case kHttpRouteServer:
+        return Timed(route, WithPermit(HandlerPool<ServerHandler>::Acquire(),
+                                       std::move(permit)));
+      case kHttpRouteEvents:
+        return new EventWebSocketHandler();
+      case kHttpRouteDebug:
+        if (DebugHandler::IsLocalClient(*msg)) {
+          return Timed(route, HandlerPool<DebugHandler>::Acquire());
+        }
+        return Timed(kLatencyOther, HandlerPool<DefaultHandler>::Acquire());
+      case kHttpRouteMetrics:
+        if (metrics_public_ || DebugHandler::IsLocalClient(*msg)) {
+          return Timed(route, HandlerPool<MetricsHandler>::Acquire());
+        }
+        return Timed(kLatencyOther, HandlerPool<DefaultHandler>::Acquire());
+      case kHttpRouteStatic:
+        if (StaticAssetStore::Instance()->size() > 0) {
+          return Timed(route, HandlerPool<StaticHandler>::Acquire());
+        }
+        return Timed(kLatencyOther, HandlerPool<DefaultHandler>::Acquire());
+      default:
+        return Timed(kLatencyOther,
+                     HandlerPool<DefaultHandler>::Acquire(
+                         route == kHttpRouteTable.kMethodNotAllowed));
+    }
+  }
+
+ private:
+  // Latency histograms are indexed by route, then these two.
+  static constexpr int kLatencyRejected = kHttpRouteMetrics + 1;
+  static constexpr int kLatencyOther = kLatencyRejected + 1;
+  static constexpr int kNumLatencyLabels = kLatencyOther + 1;
+
+  static std::array<metrics::Histogram*, kNumLatencyLabels>
+  LatencyHistograms() {
+    static constexpr const char* kLabels[kNumLatencyLabels] = {
+        "user", "server", "ws", "static", "debug", "metrics", "rejected",
+        "other"};
+    std::array<metrics::Histogram*, kNumLatencyLabels> histograms{};
+    for (int i = 0; i < kNumLatencyLabels; ++i) {
+      if (i != kHttpRouteEvents) {
+        histograms[i] = metrics::Registry::Instance()->GetHistogram(
+            "tbox_http_request_duration_seconds",
+            "Time from HTTP request headers to the end of the response.",
+            {{"route", kLabels[i]}});
+      }
+    }
+    return histograms;
+  }
+
+  proxygen::RequestHandler* Timed(int label,
+                                  proxygen::RequestHandler* handler) {
+    return HandlerPool<LatencyFilter>::Acquire(handler, latency_[label]);
+  }
+
+  static proxygen::RequestHandler* WithPermit(
+      proxygen::RequestHandler* handler,
+      impl::AdmissionController::Permit permit) {
+    if (!permit) {
+      return handler;
+    }
+    return new AdmissionFilter(handler, std::move(permit));
+  }
+
+  static uint32_t ToRouteMethod(const proxygen::HTTPMessage& msg) {
+    const auto method = msg.getMethod();
+    if (!method) {
+      return kRouteOther;
+    }
+    switch (*method) {
+      case proxygen::HTTPMethod::GET:
+        return kRouteGet;
+      case proxygen::HTTPMethod::HEAD:
+        return kRouteHead;
+      case proxygen::HTTPMethod::POST:
+        return kRoutePost;
+      case proxygen::HTTPMethod::PUT:
+        return kRoutePut;
+      case proxygen::HTTPMethod::DELETE:
+        return kRouteDelete;
+      case proxygen::HTTPMethod::PATCH:
+        return kRoutePatch;
+      case proxygen::HTTPMethod::OPTIONS:
+        return kRouteOptions;
+      default:
+        return kRouteOther;
     }
   }
+
+  const std::shared_ptr<impl::AdmissionController> admission_ =
+      impl::AdmissionController::Instance();
+  const bool metrics_public_ = util::ConfigManager::Instance()->MetricsPublic();
+  const std::array<metrics::Histogram*, kNumLatencyLabels> latency_ =
+      LatencyHistograms();
 };
 
 }  // namespace http_handler
@@ -0,0 +1,429 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/server/http_handler/message_codec.h"
+
+#include <cctype>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+#include "simdjson.h"
+#include "src/proto/service.pb.h"
+#include "src/util/simd_codec.h"
+#include "src/util/util.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+
+namespace {
+
+using simdjson::ondemand::json_type;
+using JsonValue = simdjson::ondemand::value;
+
+bool StartsWithNoCase(std::string_view s, std::string_view prefix) {
+  if (s.size() < prefix.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < prefix.size(); ++i) {
+    if (std::tolower(static_cast<unsigned char>(s[i])) != prefix[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ContainsNoCase(std::string_view s, std::string_view needle) {
+  for (size_t i = 0; i + needle.size() <= s.size(); ++i) {
+    if (StartsWithNoCase(s.substr(i), needle)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool IsProtobufType(std::string_view type) {
+  return StartsWithNoCase(type, "application/x-protobuf") ||
+         StartsWithNoCase(type, "application/protobuf");
+}
+
+// Calls handler(key, value) for each member of the top level object.
+// Members the handler does not read are skipped by simdjson.
+template <typename Handler>
+bool ForEachMember(std::string* json, Handler&& handler) {
+  json->reserve(json->size() + simdjson::SIMDJSON_PADDING);
+  const simdjson::padded_string_view padded(json->data(), json->size(),
+                                            json->capacity());
+  thread_local simdjson::ondemand::parser parser;
+  simdjson::ondemand::document doc;
+  if (parser.iterate(padded).get(doc)) {
+    return false;
+  }
+  simdjson::ondemand::object object;
+  if (doc.get_object().get(object)) {
+    return false;
+  }
+  for (auto member : object) {
+    simdjson::ondemand::field field;
+    std::string_view key;
+    if (std::move(member).get(field) || field.unescaped_key().get(key) ||
+        !handler(key, field.value())) {
+      return false;
+    }
+  }
+  return doc.at_end();
+}
+
+bool IsKey(std::string_view key, std::string_view name,
+           std::string_view json_name = {}) {
+  return key == name || (!json_name.empty() && key == json_name);
+}
+
+// Readers return false for value types the reflection parser would treat
+// differently; the caller then falls back to it. null means default value.
+bool ReadString(JsonValue& value, std::string* out) {
+  json_type type;
+  if (value.type().get(type)) {
+    return false;
+  }
+  if (type == json_type::null) {
+    out->clear();
+    return true;
+  }
+  std::string_view s;
+  if (type != json_type::string || value.get_string().get(s)) {
+    return false;
+  }
+  out->assign(s.data(), s.size());
+  return true;
+}
+
+bool ReadBytes(JsonValue& value, std::string* out) {
+  json_type type;
+  if (value.type().get(type)) {
+    return false;
+  }
+  if (type == json_type::null) {
+    out->clear();
+    return true;
+  }
+  std::string_view s;
+  if (type != json_type::string || value.get_string().get(s)) {
+    return false;
+  }
+  // Standard alphabet only; URL safe input takes the slow path.
+  out->resize(util::SimdCodec::Base64DecodedSize(s.size()));
+  size_t size = 0;
+  if (!util::SimdCodec::Base64Decode(s, out->data(), &size)) {
+    return false;
+  }
+  out->resize(size);
+  return true;
+}
+
+bool ReadOpCode(JsonValue& value, proto::OpCode* out) {
+  json_type type;
+  if (value.type().get(type)) {
+    return false;
+  }
+  switch (type) {
+    case json_type::null:
+      *out = proto::OP_UNUSED;
+      return true;
+    case json_type::number: {
+      int64_t number;
+      if (value.get_int64().get(number) ||
+          number < std::numeric_limits<int32_t>::min() ||
+          number > std::numeric_limits<int32_t>::max()) {
+        return false;
+      }
+      *out = static_cast<proto::OpCode>(number);
+      return true;
+    }
+    case json_type::string: {
+      std::string_view name;
+      return !value.get_string().get(name) &&
+             proto::OpCode_Parse(std::string(name), out);
+    }
+    default:
+      return false;
+  }
+}
+
+bool ParseUserRequest(std::string* json, proto::UserRequest* req) {
+  return ForEachMember(json, [req](std::string_view key, JsonValue value) {
+    if (IsKey(key, "request_id", "requestId")) {
+      return ReadString(value, req->mutable_request_id());
+    } else if (IsKey(key, "op")) {
+      proto::OpCode op;
+      if (!ReadOpCode(value, &op)) {
+        return false;
+      }
+      req->set_op(op);
+      return true;
+    } else if (IsKey(key, "user")) {
+      return ReadString(value, req->mutable_user());
+    } else if (IsKey(key, "password")) {
+      return ReadString(value, req->mutable_password());
+    } else if (IsKey(key, "token")) {
+      return ReadString(value, req->mutable_token());
+    } else if (IsKey(key, "to_delete_user", "toDeleteUser")) {
+      return ReadString(value, req->mutable_to_delete_user());
+    } else if (IsKey(key, "client_nonce", "clientNonce")) {
+      return ReadBytes(value, req->mutable_client_nonce());
+    } else if (IsKey(key, "challenge_id", "challengeId")) {
+      return ReadString(value, req->mutable_challenge_id());
+    } else if (IsKey(key, "signature")) {
+      return ReadBytes(value, req->mutable_signature());
+    }
+    return true;
+  });
+}
+
+bool ParseCertRequest(std::string* json, proto::CertRequest* req) {
+  return ForEachMember(json, [req](std::string_view key, JsonValue value) {
+    if (IsKey(key, "request_id", "requestId")) {
+      return ReadString(value, req->mutable_request_id());
+    } else if (IsKey(key, "op")) {
+      proto::OpCode op;
+      if (!ReadOpCode(value, &op)) {
+        return false;
+      }
+      req->set_op(op);
+      return true;
+    } else if (IsKey(key, "token")) {
+      return ReadString(value, req->mutable_token());
+    } else if (IsKey(key, "domain")) {
+      return ReadString(value, req->mutable_domain());
+    } else if (IsKey(key, "filename")) {
+      return ReadString(value, req->mutable_filename());
+    } else if (IsKey(key, "client_id", "clientId")) {
+      return ReadString(value, req->mutable_client_id());
+    } else if (IsKey(key, "signature")) {
+      // Nested FileSignature, only sent with OP_GET_CERT_FILE_DELTA.
+      return false;
+    }
+    return true;
+  });
+}
+
+bool NeedsEscape(char c) {
+  return static_cast<unsigned char>(c) < 0x20 || c == '"' || c == '\\';
+}
+
+void AppendString(std::string_view s, std::string* out) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  out->push_back('"');
+  size_t run = 0;  // start of the pending unescaped run
+  for (size_t i = 0; i < s.size(); ++i) {
+    const char c = s[i];
+    if (!NeedsEscape(c)) {
+      continue;
+    }
+    out->append(s.data() + run, i - run);
+    run = i + 1;
+    switch (c) {
+      case '"':
+        out->append("\\\"");
+        break;
+      case '\\':
+        out->append("\\\\");
+        break;
+      case '\b':
+        out->append("\\b");
+        break;
+      case '\f':
+        out->append("\\f");
+        break;
+      case '\n':
+        out->append("\\n");
+        break;
+      case '\r':
+        out->append("\\r");
+        break;
+      case '\t':
+        out->append("\\t");
+        break;
+      default:
+        out->append("\\u00");
+        out->push_back(kHex[(c >> 4) & 0xF]);
+        out->push_back(kHex[c & 0xF]);
+    }
+  }
+  out->append(s.data() + run, s.size() - run);
+  out->push_back('"');
+}
+
+void AppendBytes(std::string_view s, std::string* out) {
+  out->push_back('"');
+  const size_t pos = out->size();
+  out->resize(pos + util::SimdCodec::Base64EncodedSize(s.size()));
+  util::SimdCodec::Base64Encode(s, out->data() + pos);
+  out->push_back('"');
+}
+
+// Appends "name": with the separating comma.
+void AppendKey(std::string_view name, std::string* out) {
+  if (out->back() != '{') {
+    out->push_back(',');
+  }
+  out->push_back('"');
+  out->append(name.data(), name.size());
+  out->append("\":");
+}
+
+// Same shape as Util::MessageToJson: proto field names, every field
+// printed, enums and int64 as numbers.
+void SerializeUserResponse(const proto::UserResponse& res, std::string* out) {
+  out->reserve(160 + res.challenge_id().size() + res.token().size() +
+               util::SimdCodec::Base64EncodedSize(
+                   res.server_nonce().size() + res.server_signature().size()));
+  out->push_back('{');
+  AppendKey("err_code", out);
+  out->append(std::to_string(res.err_code()));
+  AppendKey("challenge_id", out);
+  AppendString(res.challenge_id(), out);
+  AppendKey("server_nonce", out);
+  AppendBytes(res.server_nonce(), out);
+  AppendKey("server_signature", out);
+  AppendBytes(res.server_signature(), out);
+  AppendKey("token", out);
+  AppendString(res.token(), out);
+  AppendKey("challenge_expires_at", out);
+  out->append(std::to_string(res.challenge_expires_at()));
+  out->push_back('}');
+}
+
+void SerializeCertResponse(const proto::CertResponse& res, std::string* out) {
+  out->reserve(160 + res.certificate().size() + res.private_key().size() +
+               res.ca_certificate().size() + res.message().size() +
+               util::SimdCodec::Base64EncodedSize(res.file_content().size()));
+  out->push_back('{');
+  AppendKey("err_code", out);
+  out->append(std::to_string(res.err_code()));
+  AppendKey("certificate", out);
+  AppendString(res.certificate(), out);
+  AppendKey("private_key", out);
+  AppendString(res.private_key(), out);
+  AppendKey("ca_certificate", out);
+  AppendString(res.ca_certificate(), out);
+  AppendKey("message", out);
+  AppendString(res.message(), out);
+  AppendKey("file_content", out);
+  AppendBytes(res.file_content(), out);
+  out->push_back('}');
+}
+
+}  // namespace
+
+BodyFormat MessageCodec::RequestFormat(std::string_view content_type) {
+  while (!content_type.empty() && content_type.front() == ' ') {
+    content_type.remove_prefix(1);
+  }
+  return IsProtobufType(content_type) ? BodyFormat::kProtobuf
+                                      : BodyFormat::kJson;
+}
+
+BodyFormat MessageCodec::ResponseFormat(std::string_view accept,
+                                        BodyFormat request_format) {
+  if (ContainsNoCase(accept, "application/x-protobuf") ||
+      ContainsNoCase(accept, "application/protobuf")) {
+    return BodyFormat::kProtobuf;
+  }
+  if (ContainsNoCase(accept, "application/json")) {
+    return BodyFormat::kJson;
+  }
+  return request_format;
+}
+
+const char* MessageCodec::ContentType(BodyFormat format) {
+  return format == BodyFormat::kProtobuf ? kContentTypeProtobuf
+                                         : kContentTypeJson;
+}
+
+bool MessageCodec::Parse(std::string* body, BodyFormat format,
+                         google::protobuf::Message* msg) {
+  if (format == BodyFormat::kProtobuf) {
+    return msg->ParseFromString(*body);
+  }
+  if (ParseJsonFast(body, msg)) {
+    return true;
+  }
+  msg->Clear();
+  return util::Util::JsonToMessage(*body, msg);
+}
+
+bool MessageCodec::Serialize(const google::protobuf::Message& msg,
+                             BodyFormat format, std::string* out) {
+  out->clear();
+  if (format == BodyFormat::kProtobuf) {
+    return msg.SerializeToString(out);
+  }
+  if (SerializeJsonFast(msg, out)) {
+    return true;
+  }
+  out->clear();
+  return util::Util::MessageToJson(msg, out);
+}
+
+bool MessageCodec::ParseJsonFast(std::string* json,
+                                 google::protobuf::Message* msg) {
+  const auto* descriptor = msg->GetDescriptor();
+  if (descriptor == proto::UserRequest::descriptor()) {
+    auto* req = static_cast<proto::UserRequest*>(msg);
+    req->Clear();
+    return ParseUserRequest(json, req);
+  }
+  if (descriptor == proto::CertRequest::descriptor()) {
+    auto* req = static_cast<proto::CertRequest*>(msg);
+    req->Clear();
+    return ParseCertRequest(json, req);
+  }
+  return false;
+}
+
+bool MessageCodec::SerializeJsonFast(const google::protobuf::Message& msg,
+                                     std::string* out) {
+  const auto* descriptor = msg.GetDescriptor();
+  if (descriptor == proto::UserResponse::descriptor()) {
+    out->clear();
+    SerializeUserResponse(static_cast<const proto::UserResponse&>(msg), out);
+    return true;
+  }
+  if (descriptor == proto::CertResponse::descriptor()) {
+    const auto& res = static_cast<const proto::CertResponse&>(msg);
+    if (res.has_delta()) {
+      return false;
+    }
+    out->clear();
+    SerializeCertResponse(res, out);
+    return true;
+  }
+  return false;
+}
+
+bool MessageCodec::ReadStringFields(
+    std::string* json,
+    const std::vector<std::pair<std::string_view, std::string*>>& fields) {
+  return ForEachMember(json, [&fields](std::string_view key, JsonValue value) {
+    for (const auto& [name, out] : fields) {
+      if (key == name) {
+        json_type type;
+        std::string_view s;
+        if (!value.type().get(type) && type == json_type::string &&
+            !value.get_string().get(s)) {
+          out->assign(s.data(), s.size());
+        }
+        break;
+      }
+    }
+    return true;
+  });
+}
+
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
@@ -0,0 +1,80 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_HTTP_HANDLER_MESSAGE_CODEC_H_
+#define TBOX_SERVER_HTTP_HANDLER_MESSAGE_CODEC_H_
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "google/protobuf/message.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+
+constexpr char kContentTypeJson[] = "application/json";
+constexpr char kContentTypeProtobuf[] = "application/x-protobuf";
+
+enum class BodyFormat {
+  kJson = 0,
+  kProtobuf = 1,
+};
+
+/// @brief Request and response bodies of the HTTP JSON APIs.
+/// @details Bodies are JSON unless the client asks for protobuf binary with
+///          Content-Type / Accept: application/x-protobuf. JSON for the hot
+///          messages (UserRequest, CertRequest, UserResponse, CertResponse)
+///          is read with simdjson On Demand and written by hand, without
+///          protobuf reflection; it accepts and produces the same JSON as
+///          Util::JsonToMessage / Util::MessageToJson. Anything the fast
+///          path does not handle (other messages, nested messages,
+///          unexpected value types) falls back to the reflection codec.
+class MessageCodec final {
+ public:
+  /// @brief Body format from a Content-Type header value.
+  static BodyFormat RequestFormat(std::string_view content_type);
+
+  /// @brief Response format from an Accept header value; without an
+  ///        explicit preference the response mirrors the request.
+  static BodyFormat ResponseFormat(std::string_view accept,
+                                   BodyFormat request_format);
+
+  static const char* ContentType(BodyFormat format);
+
+  /// @brief Parse a request body into msg.
+  /// @param body Taken by pointer so simdjson can pad it in place.
+  static bool Parse(std::string* body, BodyFormat format,
+                    google::protobuf::Message* msg);
+
+  static bool Serialize(const google::protobuf::Message& msg,
+                        BodyFormat format, std::string* out);
+
+  /// @brief simdjson decoding only, for tests and benchmarks.
+  /// @return false when the fast path does not handle msg or this input;
+  ///         msg is then in an unspecified state.
+  static bool ParseJsonFast(std::string* json, google::protobuf::Message* msg);
+
+  /// @brief Hand written encoding only, for tests and benchmarks.
+  /// @return false when the fast path does not handle msg.
+  static bool SerializeJsonFast(const google::protobuf::Message& msg,
+                                std::string* out);
+
+  /// @brief Read top level string members of a JSON object.
+  /// @param fields Member names and where to store their values. Missing
+  ///        members and members of other types are left untouched.
+  /// @return false if json is not an object.
+  static bool ReadStringFields(
+      std::string* json,
+      const std::vector<std::pair<std::string_view, std::string*>>& fields);
+};
+
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_HTTP_HANDLER_MESSAGE_CODEC_H_
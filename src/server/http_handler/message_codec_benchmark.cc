@@ -0,0 +1,111 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+// Per request body cost of the HTTP JSON APIs: protobuf reflection JSON
+// (what the handlers used before), the simdjson / hand written fast path,
+// and protobuf binary bodies.
+//
+//   bazel run -c opt //src/server/http_handler:message_codec_benchmark
+
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "src/proto/service.pb.h"
+#include "src/server/http_handler/message_codec.h"
+#include "src/util/util.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+namespace {
+
+const char kLoginJson[] =
+    R"({"request_id":"3f2b8c1e-8d4a-4c55-9a57-0f1c2d3e4f50","op":11,)"
+    R"("user":"alice","password":"correct horse battery staple",)"
+    R"("challenge_id":"c-91d2e6","client_nonce":"q83vEjRWeJCrze8SNFZ4kA==",)"
+    R"("signature":"MEUCIQDf3Zb6sX0lq9p1JYk2w3V4u5t6r7e8w9q0a1s2d3f4gAIgOe7)"
+    R"(vB2m5n8p1q4r7s0t3u6v9w2x5y8z1a4b7c0d3e6f9g2h="})";
+
+proto::CertResponse Certificate() {
+  proto::CertResponse res;
+  res.set_err_code(proto::ErrCode::Success);
+  std::string pem = "-----BEGIN CERTIFICATE-----\n";
+  for (int i = 0; i < 40; ++i) {
+    pem += std::string(64, 'A' + i % 26) + "\n";
+  }
+  pem += "-----END CERTIFICATE-----\n";
+  res.set_certificate(pem);
+  res.set_message("ok");
+  return res;
+}
+
+void BM_ParseUserRequestReflection(benchmark::State& state) {
+  const std::string body = kLoginJson;
+  for (auto _ : state) {
+    proto::UserRequest req;
+    benchmark::DoNotOptimize(util::Util::JsonToMessage(body, &req));
+  }
+}
+BENCHMARK(BM_ParseUserRequestReflection);
+
+void BM_ParseUserRequestFast(benchmark::State& state) {
+  for (auto _ : state) {
+    std::string body = kLoginJson;
+    proto::UserRequest req;
+    benchmark::DoNotOptimize(
+        MessageCodec::Parse(&body, BodyFormat::kJson, &req));
+  }
+}
+BENCHMARK(BM_ParseUserRequestFast);
+
+void BM_ParseUserRequestProtobuf(benchmark::State& state) {
+  proto::UserRequest source;
+  std::string json = kLoginJson;
+  MessageCodec::Parse(&json, BodyFormat::kJson, &source);
+  const std::string binary = source.SerializeAsString();
+  for (auto _ : state) {
+    std::string body = binary;
+    proto::UserRequest req;
+    benchmark::DoNotOptimize(
+        MessageCodec::Parse(&body, BodyFormat::kProtobuf, &req));
+  }
+}
+BENCHMARK(BM_ParseUserRequestProtobuf);
+
+void BM_SerializeCertResponseReflection(benchmark::State& state) {
+  const proto::CertResponse res = Certificate();
+  for (auto _ : state) {
+    std::string out;
+    benchmark::DoNotOptimize(util::Util::MessageToJson(res, &out));
+  }
+}
+BENCHMARK(BM_SerializeCertResponseReflection);
+
+void BM_SerializeCertResponseFast(benchmark::State& state) {
+  const proto::CertResponse res = Certificate();
+  for (auto _ : state) {
+    std::string out;
+    benchmark::DoNotOptimize(
+        MessageCodec::Serialize(res, BodyFormat::kJson, &out));
+  }
+}
+BENCHMARK(BM_SerializeCertResponseFast);
+
+void BM_SerializeCertResponseProtobuf(benchmark::State& state) {
+  const proto::CertResponse res = Certificate();
+  for (auto _ : state) {
+    std::string out;
+    benchmark::DoNotOptimize(
+        MessageCodec::Serialize(res, BodyFormat::kProtobuf, &out));
+  }
+}
+BENCHMARK(BM_SerializeCertResponseProtobuf);
+
+}  // namespace
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
+
+BENCHMARK_MAIN();
@@ -0,0 +1,157 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/server/http_handler/message_codec.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/proto/service.pb.h"
+#include "src/util/util.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+namespace {
+
+// The fast path must agree with protobuf's own JSON parser.
+template <typename Message>
+void ExpectSameAsReflection(const std::string& json) {
+  Message expected;
+  ASSERT_TRUE(util::Util::JsonToMessage(json, &expected)) << json;
+  std::string body = json;
+  Message fast;
+  ASSERT_TRUE(MessageCodec::ParseJsonFast(&body, &fast)) << json;
+  EXPECT_EQ(fast.SerializeAsString(), expected.SerializeAsString()) << json;
+}
+
+TEST(MessageCodec, FastJsonMatchesReflection) {
+  ExpectSameAsReflection<proto::UserRequest>(
+      R"({"request_id":"r1","op":11,"user":"alice","password":"p\"w\\d\n",)"
+      R"("client_nonce":"AAECAwQ=","signature":"3q2+7w=="})");
+  ExpectSameAsReflection<proto::UserRequest>(
+      R"({"requestId":"r2","op":"OP_USER_LOGIN_CHALLENGE",)"
+      R"("toDeleteUser":"bob","challengeId":"c","token":null,)"
+      R"("unknown":{"nested":[1,2,{"x":"y"}]},"also_unknown":1.5})");
+  ExpectSameAsReflection<proto::UserRequest>(
+      R"({"user":"é中😀"})");
+  ExpectSameAsReflection<proto::UserRequest>(R"({})");
+  ExpectSameAsReflection<proto::CertRequest>(
+      R"({"request_id":"r3","op":"OP_GET_CERT_FILE","token":"t",)"
+      R"("domain":"example.com","filename":"fullchain.cer","clientId":"c1"})");
+}
+
+TEST(MessageCodec, FallsBackToReflection) {
+  // Nested message: not on the fast path, still parsed.
+  std::string body =
+      R"({"op":27,"filename":"a.key","signature":{"block_size":4096,)"
+      R"("blocks":[{"weak":1,"strong":"AAE="}]}})";
+  proto::CertRequest req;
+  std::string copy = body;
+  EXPECT_FALSE(MessageCodec::ParseJsonFast(&copy, &req));
+  ASSERT_TRUE(MessageCodec::Parse(&body, BodyFormat::kJson, &req));
+  EXPECT_EQ(req.filename(), "a.key");
+  EXPECT_EQ(req.signature().block_size(), 4096);
+  ASSERT_EQ(req.signature().blocks_size(), 1);
+
+  // Wrong value type: the reflection parser has the final word.
+  body = R"({"user":5})";
+  proto::UserRequest user;
+  copy = body;
+  EXPECT_FALSE(MessageCodec::ParseJsonFast(&copy, &user));
+  EXPECT_FALSE(MessageCodec::Parse(&body, BodyFormat::kJson, &user));
+
+  for (std::string bad : {std::string(R"({"user":"a")"), std::string("[1]"),
+                          std::string(R"({"user":"a"} x)"), std::string()}) {
+    EXPECT_FALSE(MessageCodec::Parse(&bad, BodyFormat::kJson, &user)) << bad;
+  }
+}
+
+TEST(MessageCodec, FastJsonOutputRoundTrips) {
+  proto::UserResponse user;
+  user.set_err_code(proto::ErrCode::Fail);
+  user.set_challenge_id("id \"quoted\" \\ \x01 \t");
+  user.set_server_nonce(std::string("\0\1\2\3\xff", 5));
+  user.set_token("token");
+  user.set_challenge_expires_at(1234567890123);
+  std::string json;
+  ASSERT_TRUE(MessageCodec::SerializeJsonFast(user, &json));
+  proto::UserResponse parsed;
+  ASSERT_TRUE(util::Util::JsonToMessage(json, &parsed)) << json;
+  EXPECT_EQ(parsed.SerializeAsString(), user.SerializeAsString());
+  // Every field is present, as with Util::MessageToJson.
+  EXPECT_NE(json.find("\"server_signature\":\"\""), std::string::npos);
+
+  proto::CertResponse cert;
+  cert.set_certificate("-----BEGIN CERTIFICATE-----\nMII...\n");
+  cert.set_file_content("binary\0data", 11);
+  ASSERT_TRUE(MessageCodec::SerializeJsonFast(cert, &json));
+  proto::CertResponse cert_parsed;
+  ASSERT_TRUE(util::Util::JsonToMessage(json, &cert_parsed)) << json;
+  EXPECT_EQ(cert_parsed.SerializeAsString(), cert.SerializeAsString());
+
+  cert.mutable_delta()->set_block_size(4096);
+  EXPECT_FALSE(MessageCodec::SerializeJsonFast(cert, &json));
+  ASSERT_TRUE(MessageCodec::Serialize(cert, BodyFormat::kJson, &json));
+  ASSERT_TRUE(util::Util::JsonToMessage(json, &cert_parsed)) << json;
+  EXPECT_EQ(cert_parsed.delta().block_size(), 4096);
+}
+
+TEST(MessageCodec, ProtobufBodies) {
+  proto::UserRequest req;
+  req.set_user("alice");
+  req.set_op(proto::OP_USER_LOGIN);
+  std::string body;
+  ASSERT_TRUE(MessageCodec::Serialize(req, BodyFormat::kProtobuf, &body));
+  proto::UserRequest parsed;
+  ASSERT_TRUE(MessageCodec::Parse(&body, BodyFormat::kProtobuf, &parsed));
+  EXPECT_EQ(parsed.user(), "alice");
+  EXPECT_EQ(parsed.op(), proto::OP_USER_LOGIN);
+}
+
+TEST(MessageCodec, Negotiation) {
+  EXPECT_EQ(MessageCodec::RequestFormat(""), BodyFormat::kJson);
+  EXPECT_EQ(MessageCodec::RequestFormat("application/json"),
+            BodyFormat::kJson);
+  EXPECT_EQ(MessageCodec::RequestFormat("Application/X-Protobuf"),
+            BodyFormat::kProtobuf);
+  EXPECT_EQ(MessageCodec::RequestFormat("application/protobuf; proto=x"),
+            BodyFormat::kProtobuf);
+
+  EXPECT_EQ(MessageCodec::ResponseFormat("", BodyFormat::kProtobuf),
+            BodyFormat::kProtobuf);
+  EXPECT_EQ(MessageCodec::ResponseFormat("*/*", BodyFormat::kJson),
+            BodyFormat::kJson);
+  EXPECT_EQ(MessageCodec::ResponseFormat("application/json",
+                                         BodyFormat::kProtobuf),
+            BodyFormat::kJson);
+  EXPECT_EQ(MessageCodec::ResponseFormat(
+                "application/x-protobuf, application/json;q=0.5",
+                BodyFormat::kJson),
+            BodyFormat::kProtobuf);
+  EXPECT_STREQ(MessageCodec::ContentType(BodyFormat::kProtobuf),
+               kContentTypeProtobuf);
+}
+
+TEST(MessageCodec, ReadStringFields) {
+  std::string body =
+      R"({"operation":"ec2_start","instance_id":"i-123","region":7,"x":[]})";
+  std::string operation, instance_id, region = "default";
+  ASSERT_TRUE(MessageCodec::ReadStringFields(
+      &body, {{"operation", &operation},
+              {"instance_id", &instance_id},
+              {"region", &region}}));
+  EXPECT_EQ(operation, "ec2_start");
+  EXPECT_EQ(instance_id, "i-123");
+  EXPECT_EQ(region, "default");
+  std::string bad = "not json";
+  EXPECT_FALSE(MessageCodec::ReadStringFields(&bad, {{"a", &region}}));
+}
+
+}  // namespace
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
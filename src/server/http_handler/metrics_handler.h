@@ -0,0 +1,95 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_HTTP_HANDLER_METRICS_HANDLER_H_
+#define TBOX_SERVER_HTTP_HANDLER_METRICS_HANDLER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "proxygen/httpserver/Filters.h"
+#include "proxygen/httpserver/RequestHandler.h"
+#include "proxygen/lib/http/HTTPMessage.h"
+#include "src/common/metrics.h"
+#include "src/server/http_handler/handler_pool.h"
+#include "src/server/http_handler/util.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+
+/**
+ * @brief Serves "/metrics": every registered metric in the Prometheus text
+ * format. The factory routes loopback clients here, and everyone else if
+ * metrics_public is set in the server config.
+ */
+class MetricsHandler : public proxygen::RequestHandler {
+ public:
+  void onRequest(
+      std::unique_ptr<proxygen::HTTPMessage> /*headers*/) noexcept override {}
+
+  void onBody(std::unique_ptr<folly::IOBuf> /*body*/) noexcept override {}
+
+  void onEOM() noexcept override {
+    Util::Success(metrics::Registry::Instance()->PrometheusText(),
+                  "text/plain; version=0.0.4; charset=utf-8", downstream_);
+  }
+
+  void onUpgrade(proxygen::UpgradeProtocol /*protocol*/) noexcept override {}
+
+  void requestComplete() noexcept override {
+    HandlerPool<MetricsHandler>::Release(this);
+  }
+
+  void onError(proxygen::ProxygenError /*err*/) noexcept override {
+    HandlerPool<MetricsHandler>::Release(this);
+  }
+};
+
+/**
+ * @brief Records how long a request took, from its headers to the end of
+ * the response (or the error), in a latency histogram. Comes from the
+ * `HandlerPool` like the handlers it wraps.
+ */
+class LatencyFilter : public proxygen::Filter {
+ public:
+  LatencyFilter(proxygen::RequestHandler* upstream,
+                metrics::Histogram* latency)
+      : proxygen::Filter(upstream),
+        latency_(latency),
+        start_(std::chrono::steady_clock::now()) {}
+
+  void requestComplete() noexcept override {
+    downstream_ = nullptr;
+    upstream_->requestComplete();
+    Finish();
+  }
+
+  void onError(proxygen::ProxygenError err) noexcept override {
+    downstream_ = nullptr;
+    upstream_->onError(err);
+    Finish();
+  }
+
+ private:
+  // proxygen::Filter deletes itself here; this one goes back to the pool.
+  void Finish() {
+    latency_->Record(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_)
+            .count()));
+    HandlerPool<LatencyFilter>::Release(this);
+  }
+
+  metrics::Histogram* const latency_;
+  const std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_HTTP_HANDLER_METRICS_HANDLER_H_
@@ -0,0 +1,325 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_HTTP_HANDLER_ROUTER_H_
+#define TBOX_SERVER_HTTP_HANDLER_ROUTER_H_
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+
+// Method bits a route accepts.
+enum RouteMethod : uint32_t {
+  kRouteGet = 1 << 0,
+  kRouteHead = 1 << 1,
+  kRoutePost = 1 << 2,
+  kRoutePut = 1 << 3,
+  kRouteDelete = 1 << 4,
+  kRoutePatch = 1 << 5,
+  kRouteOptions = 1 << 6,
+  kRouteOther = 1 << 7,
+  kRouteAny = 0xFF,
+};
+
+/// @brief One entry of a route table.
+/// @details pattern is either an exact path ("/user") or a prefix ending in
+///          "/*" ("/static/*" matches "/static/" and everything below it).
+///          Several entries may share a pattern with disjoint methods.
+struct Route {
+  std::string_view pattern;
+  uint32_t methods;
+  int target;
+};
+
+namespace router_internal {
+
+// Not constexpr: reaching it while building a table is a compile error.
+void InvalidRouteTable(const char* reason);
+
+// Little endian 8 byte load; memcpy outside constant evaluation.
+constexpr uint64_t Load64(const char* p, size_t n) {
+  if (!std::is_constant_evaluated() && n == 8 &&
+      std::endian::native == std::endian::little) {
+    uint64_t word;
+    std::memcpy(&word, p, 8);
+    return word;
+  }
+  uint64_t word = 0;
+  for (size_t i = 0; i < n; ++i) {
+    word |= uint64_t(static_cast<uint8_t>(p[i])) << (8 * i);
+  }
+  return word;
+}
+
+// Word at a time path hash, identical at compile time and at runtime.
+constexpr uint64_t HashPath(std::string_view s) {
+  uint64_t h = s.size() * 0x9e3779b97f4a7c15ULL;
+  size_t i = 0;
+  for (; i + 8 <= s.size(); i += 8) {
+    h = (h ^ Load64(s.data() + i, 8)) * 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 29;
+  }
+  if (i < s.size()) {
+    h = (h ^ Load64(s.data() + i, s.size() - i)) * 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 29;
+  }
+  return h;
+}
+
+// Top bits of a multiplicative hash; bits may be 0.
+constexpr size_t TopBits(uint64_t h, uint64_t multiplier, int bits) {
+  return static_cast<size_t>(((h * multiplier) >> (63 - bits)) >> 1);
+}
+
+constexpr size_t NextPow2(size_t n) {
+  size_t p = 1;
+  while (p < n) {
+    p <<= 1;
+  }
+  return p;
+}
+
+constexpr int Log2(size_t n) {
+  int bits = 0;
+  while ((size_t(1) << bits) < n) {
+    ++bits;
+  }
+  return bits;
+}
+
+constexpr bool IsPrefix(std::string_view pattern) {
+  return pattern.size() >= 2 && pattern.substr(pattern.size() - 2) == "/*";
+}
+
+}  // namespace router_internal
+
+/// @brief Route table built entirely at compile time.
+/// @details Exact paths go into a perfect hash (hash and displace): the
+///          path hash picks a bucket, the bucket's seed picks a slot that no
+///          other path uses, so a lookup costs one hash of the path, one
+///          slot probe and one string compare, however many routes there
+///          are. Prefix routes are few and are tried longest
+///          first when no exact path matches. A root "/*" route is a
+///          fallback: methods it does not take give kNotFound, not
+///          kMethodNotAllowed, for paths no other route knows.
+///
+///          Tables are built with MakeRouteTable() in a constexpr context;
+///          malformed or duplicate routes fail the build.
+template <size_t N>
+class RouteTable final {
+ public:
+  static constexpr int kNotFound = -1;
+  static constexpr int kMethodNotAllowed = -2;
+
+  consteval explicit RouteTable(const Route (&routes)[N]) {
+    using router_internal::InvalidRouteTable;
+    using router_internal::IsPrefix;
+    for (size_t i = 0; i < N; ++i) {
+      const std::string_view pattern = routes[i].pattern;
+      if (pattern.empty() || pattern[0] != '/') {
+        InvalidRouteTable("route pattern must start with '/'");
+      }
+      if (pattern.find('*') != std::string_view::npos && !IsPrefix(pattern)) {
+        InvalidRouteTable("'*' is only allowed as a trailing \"/*\"");
+      }
+      if (routes[i].methods == 0 || routes[i].target < 0) {
+        InvalidRouteTable("route needs a method and a target >= 0");
+      }
+      for (size_t j = 0; j < i; ++j) {
+        if (routes[j].pattern == pattern &&
+            (routes[j].methods & routes[i].methods)) {
+          InvalidRouteTable("duplicate route");
+        }
+      }
+    }
+
+    // Group routes by pattern, keeping declaration order inside a group.
+    bool placed[N] = {};
+    for (size_t i = 0; i < N; ++i) {
+      if (placed[i]) {
+        continue;
+      }
+      Group& group = IsPrefix(routes[i].pattern) ? prefixes_[prefix_count_++]
+                                                 : groups_[group_count_++];
+      group.key = routes[i].pattern;
+      group.begin = route_count_;
+      for (size_t j = i; j < N; ++j) {
+        if (!placed[j] && routes[j].pattern == routes[i].pattern) {
+          placed[j] = true;
+          routes_[route_count_++] = routes[j];
+        }
+      }
+      group.end = route_count_;
+      if (IsPrefix(group.key)) {
+        group.key.remove_suffix(1);  // keep the '/'
+      }
+    }
+
+    // Longest prefix first.
+    for (size_t i = 1; i < prefix_count_; ++i) {
+      for (size_t j = i; j > 0 && prefixes_[j - 1].key.size() <
+                                      prefixes_[j].key.size();
+           --j) {
+        const Group tmp = prefixes_[j];
+        prefixes_[j] = prefixes_[j - 1];
+        prefixes_[j - 1] = tmp;
+      }
+    }
+
+    BuildPerfectHash();
+  }
+
+  /// @brief Find the route for a request.
+  /// @param method One RouteMethod bit.
+  /// @param path Request path without the query string.
+  /// @return The route's target, kMethodNotAllowed if the path exists but
+  ///         not for method, kNotFound otherwise.
+  constexpr int Find(uint32_t method, std::string_view path) const {
+    bool path_found = false;
+    if (group_count_ > 0) {
+      const uint64_t h = router_internal::HashPath(path);
+      const uint32_t slot = slots_[Slot(h, seeds_[Bucket(h)])];
+      if (slot != 0 && groups_[slot - 1].key == path) {
+        const int target = MatchMethod(groups_[slot - 1], method);
+        if (target >= 0) {
+          return target;
+        }
+        path_found = true;
+      }
+    }
+    for (size_t i = 0; i < prefix_count_; ++i) {
+      const Group& group = prefixes_[i];
+      if (path.substr(0, group.key.size()) == group.key ||
+          path == group.key.substr(0, group.key.size() - 1)) {
+        const int target = MatchMethod(group, method);
+        if (target >= 0) {
+          return target;
+        }
+        // The root fallback matches every path, so it proves none exists.
+        path_found = path_found || group.key.size() > 1;
+      }
+    }
+    return path_found ? kMethodNotAllowed : kNotFound;
+  }
+
+  static constexpr size_t size() { return N; }
+
+ private:
+  struct Group {
+    std::string_view key;
+    uint32_t begin = 0;
+    uint32_t end = 0;
+  };
+
+  static constexpr size_t kSlots = router_internal::NextPow2(2 * N);
+  static constexpr size_t kBuckets = router_internal::NextPow2(N);
+  static constexpr uint32_t kMaxSeed = 1 << 16;
+
+  static constexpr size_t Bucket(uint64_t h) {
+    return router_internal::TopBits(h, 0x9e3779b97f4a7c15ULL,
+                                    router_internal::Log2(kBuckets));
+  }
+
+  static constexpr size_t Slot(uint64_t h, uint32_t seed) {
+    return router_internal::TopBits(h ^ (uint64_t(seed) << 32 | seed),
+                                    0xbf58476d1ce4e5b9ULL,
+                                    router_internal::Log2(kSlots));
+  }
+
+  constexpr int MatchMethod(const Group& group, uint32_t method) const {
+    for (uint32_t i = group.begin; i < group.end; ++i) {
+      if (routes_[i].methods & method) {
+        return routes_[i].target;
+      }
+    }
+    return kNotFound;
+  }
+
+  consteval void BuildPerfectHash() {
+    uint64_t hashes[N] = {};
+    size_t bucket_of[N] = {};
+    size_t bucket_size[kBuckets] = {};
+    for (size_t i = 0; i < group_count_; ++i) {
+      hashes[i] = router_internal::HashPath(groups_[i].key);
+      bucket_of[i] = Bucket(hashes[i]);
+      ++bucket_size[bucket_of[i]];
+    }
+
+    // Place the fullest buckets first, they are the hardest to fit.
+    bool done[kBuckets] = {};
+    for (size_t round = 0; round < kBuckets; ++round) {
+      size_t bucket = kBuckets;
+      for (size_t b = 0; b < kBuckets; ++b) {
+        if (!done[b] && bucket_size[b] > 0 &&
+            (bucket == kBuckets || bucket_size[b] > bucket_size[bucket])) {
+          bucket = b;
+        }
+      }
+      if (bucket == kBuckets) {
+        break;
+      }
+      done[bucket] = true;
+
+      bool fitted = false;
+      for (uint32_t seed = 1; seed < kMaxSeed && !fitted; ++seed) {
+        size_t taken[N] = {};
+        size_t count = 0;
+        fitted = true;
+        for (size_t i = 0; i < group_count_ && fitted; ++i) {
+          if (bucket_of[i] != bucket) {
+            continue;
+          }
+          const size_t slot = Slot(hashes[i], seed);
+          if (slots_[slot] != 0) {
+            fitted = false;
+          }
+          for (size_t k = 0; k < count && fitted; ++k) {
+            fitted = taken[k] != slot;
+          }
+          taken[count++] = slot;
+        }
+        if (fitted) {
+          seeds_[bucket] = seed;
+          count = 0;
+          for (size_t i = 0; i < group_count_; ++i) {
+            if (bucket_of[i] == bucket) {
+              slots_[taken[count++]] = static_cast<uint32_t>(i + 1);
+            }
+          }
+        }
+      }
+      if (!fitted) {
+        router_internal::InvalidRouteTable("no perfect hash seed found");
+      }
+    }
+  }
+
+  Route routes_[N] = {};
+  Group groups_[N] = {};
+  Group prefixes_[N] = {};
+  uint32_t seeds_[kBuckets] = {};
+  uint32_t slots_[kSlots] = {};  // group index + 1, 0 when empty
+  size_t route_count_ = 0;
+  size_t group_count_ = 0;
+  size_t prefix_count_ = 0;
+};
+
+template <size_t N>
+consteval RouteTable<N> MakeRouteTable(const Route (&routes)[N]) {
+  return RouteTable<N>(routes);
+}
+
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_HTTP_HANDLER_ROUTER_H_
@@ -0,0 +1,121 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+// Route dispatch cost with 64 routes: the compile-time RouteTable against
+// the string compare chain HTTPHandlerFactory used before and a hash map.
+// Lookups cycle through every route plus misses and prefix routes.
+//
+//   bazel run -c opt //src/server/http_handler:router_benchmark
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/server/http_handler/router.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+namespace {
+
+#define ROUTE(n) {"/api/v1/resource" #n, kRouteAny, n}
+
+constexpr Route kRoutes[] = {
+    ROUTE(0),  ROUTE(1),  ROUTE(2),  ROUTE(3),  ROUTE(4),  ROUTE(5),
+    ROUTE(6),  ROUTE(7),  ROUTE(8),  ROUTE(9),  ROUTE(10), ROUTE(11),
+    ROUTE(12), ROUTE(13), ROUTE(14), ROUTE(15), ROUTE(16), ROUTE(17),
+    ROUTE(18), ROUTE(19), ROUTE(20), ROUTE(21), ROUTE(22), ROUTE(23),
+    ROUTE(24), ROUTE(25), ROUTE(26), ROUTE(27), ROUTE(28), ROUTE(29),
+    ROUTE(30), ROUTE(31), ROUTE(32), ROUTE(33), ROUTE(34), ROUTE(35),
+    ROUTE(36), ROUTE(37), ROUTE(38), ROUTE(39), ROUTE(40), ROUTE(41),
+    ROUTE(42), ROUTE(43), ROUTE(44), ROUTE(45), ROUTE(46), ROUTE(47),
+    ROUTE(48), ROUTE(49), ROUTE(50), ROUTE(51), ROUTE(52), ROUTE(53),
+    ROUTE(54), ROUTE(55), ROUTE(56), ROUTE(57), ROUTE(58), ROUTE(59),
+    {"/static/*", kRouteGet, 60},
+    {"/user", kRouteAny, 61},
+    {"/server", kRouteAny, 62},
+    {"/ws", kRouteGet, 63},
+};
+
+#undef ROUTE
+
+constexpr auto kTable = MakeRouteTable(kRoutes);
+
+std::vector<std::string> Paths() {
+  std::vector<std::string> paths;
+  for (const auto& route : kRoutes) {
+    std::string path(route.pattern);
+    if (path.back() == '*') {
+      path.replace(path.size() - 1, 1, "js/app.js");
+    }
+    paths.push_back(path);
+  }
+  paths.push_back("/api/v1/resource99");
+  paths.push_back("/favicon.ico");
+  return paths;
+}
+
+void BM_RouteTable(benchmark::State& state) {
+  const auto paths = Paths();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(kTable.Find(kRouteGet, paths[i]));
+    i = i + 1 == paths.size() ? 0 : i + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RouteTable);
+
+// One string compare per route, in declaration order.
+void BM_CompareChain(benchmark::State& state) {
+  const auto paths = Paths();
+  const auto find = [](std::string_view path) {
+    for (const auto& route : kRoutes) {
+      std::string_view pattern = route.pattern;
+      if (pattern.back() == '*') {
+        pattern.remove_suffix(1);
+        if (path.substr(0, pattern.size()) == pattern) {
+          return route.target;
+        }
+      } else if (path == pattern) {
+        return route.target;
+      }
+    }
+    return -1;
+  };
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(find(paths[i]));
+    i = i + 1 == paths.size() ? 0 : i + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CompareChain);
+
+// Exact routes only, so it does a bit less work than the others.
+void BM_UnorderedMap(benchmark::State& state) {
+  const auto paths = Paths();
+  std::unordered_map<std::string_view, int> map;
+  for (const auto& route : kRoutes) {
+    map.emplace(route.pattern, route.target);
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    const auto it = map.find(paths[i]);
+    benchmark::DoNotOptimize(it == map.end() ? -1 : it->second);
+    i = i + 1 == paths.size() ? 0 : i + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UnorderedMap);
+
+}  // namespace
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
+
+BENCHMARK_MAIN();
@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/server/http_handler/router.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+namespace {
+
+constexpr Route kRoutes[] = {
+    {"/user", kRouteAny, 0},
+    {"/server", kRouteAny, 1},
+    {"/ws", kRouteGet, 2},
+    {"/items", kRouteGet | kRouteHead, 3},
+    {"/items", kRoutePost, 4},
+    {"/static/*", kRouteGet, 5},
+    {"/static/docs/*", kRouteGet, 6},
+};
+
+constexpr auto kTable = MakeRouteTable(kRoutes);
+
+// Lookups are usable in constant expressions too.
+static_assert(kTable.Find(kRouteGet, "/ws") == 2);
+static_assert(kTable.Find(kRoutePost, "/ws") ==
+              RouteTable<7>::kMethodNotAllowed);
+
+TEST(RouteTable, ExactAndMethods) {
+  EXPECT_EQ(kTable.Find(kRoutePost, "/user"), 0);
+  EXPECT_EQ(kTable.Find(kRouteGet, "/server"), 1);
+  EXPECT_EQ(kTable.Find(kRouteGet, "/items"), 3);
+  EXPECT_EQ(kTable.Find(kRouteHead, "/items"), 3);
+  EXPECT_EQ(kTable.Find(kRoutePost, "/items"), 4);
+  EXPECT_EQ(kTable.Find(kRouteDelete, "/items"), kTable.kMethodNotAllowed);
+  EXPECT_EQ(kTable.Find(kRouteGet, "/"), kTable.kNotFound);
+  EXPECT_EQ(kTable.Find(kRouteGet, "/users"), kTable.kNotFound);
+  EXPECT_EQ(kTable.Find(kRouteGet, "/use"), kTable.kNotFound);
+  EXPECT_EQ(kTable.Find(kRouteGet, ""), kTable.kNotFound);
+}
+
+TEST(RouteTable, LongestPrefixWins) {
+  EXPECT_EQ(kTable.Find(kRouteGet, "/static"), 5);
+  EXPECT_EQ(kTable.Find(kRouteGet, "/static/"), 5);
+  EXPECT_EQ(kTable.Find(kRouteGet, "/static/app.js"), 5);
+  EXPECT_EQ(kTable.Find(kRouteGet, "/static/docs/index.html"), 6);
+  EXPECT_EQ(kTable.Find(kRouteGet, "/staticfoo"), kTable.kNotFound);
+  EXPECT_EQ(kTable.Find(kRoutePost, "/static/app.js"),
+            kTable.kMethodNotAllowed);
+}
+
+constexpr Route kFallbackRoutes[] = {
+    {"/ws", kRouteGet, 0},
+    {"/debug/*", kRouteGet, 1},
+    {"/*", kRouteGet | kRouteHead, 2},
+};
+
+constexpr auto kFallbackTable = MakeRouteTable(kFallbackRoutes);
+
+TEST(RouteTable, RootFallback) {
+  EXPECT_EQ(kFallbackTable.Find(kRouteGet, "/"), 2);
+  EXPECT_EQ(kFallbackTable.Find(kRouteHead, "/app.js"), 2);
+  EXPECT_EQ(kFallbackTable.Find(kRouteGet, "/debug/traces"), 1);
+  // Unknown paths stay unknown for methods the fallback does not take.
+  EXPECT_EQ(kFallbackTable.Find(kRoutePost, "/app.js"),
+            kFallbackTable.kNotFound);
+  EXPECT_EQ(kFallbackTable.Find(kRouteDelete, "/"), kFallbackTable.kNotFound);
+  EXPECT_EQ(kFallbackTable.Find(kRoutePost, "/ws"),
+            kFallbackTable.kMethodNotAllowed);
+  EXPECT_EQ(kFallbackTable.Find(kRoutePost, "/debug/traces"),
+            kFallbackTable.kMethodNotAllowed);
+}
+
+constexpr Route kManyRoutes[] = {
+    {"/api/v1/r00", kRouteAny, 0},  {"/api/v1/r01", kRouteAny, 1},
+    {"/api/v1/r02", kRouteAny, 2},  {"/api/v1/r03", kRouteAny, 3},
+    {"/api/v1/r04", kRouteAny, 4},  {"/api/v1/r05", kRouteAny, 5},
+    {"/api/v1/r06", kRouteAny, 6},  {"/api/v1/r07", kRouteAny, 7},
+    {"/api/v1/r08", kRouteAny, 8},  {"/api/v1/r09", kRouteAny, 9},
+    {"/api/v1/r10", kRouteAny, 10}, {"/api/v1/r11", kRouteAny, 11},
+    {"/api/v1/r12", kRouteAny, 12}, {"/api/v1/r13", kRouteAny, 13},
+    {"/api/v1/r14", kRouteAny, 14}, {"/api/v1/r15", kRouteAny, 15},
+    {"/api/v1/r16", kRouteAny, 16}, {"/api/v1/r17", kRouteAny, 17},
+    {"/api/v1/r18", kRouteAny, 18}, {"/api/v1/r19", kRouteAny, 19},
+    {"/api/v1/r20", kRouteAny, 20}, {"/api/v1/r21", kRouteAny, 21},
+    {"/api/v1/r22", kRouteAny, 22}, {"/api/v1/r23", kRouteAny, 23},
+    {"/api/v1/r24", kRouteAny, 24}, {"/api/v1/r25", kRouteAny, 25},
+    {"/api/v1/r26", kRouteAny, 26}, {"/api/v1/r27", kRouteAny, 27},
+    {"/api/v1/r28", kRouteAny, 28}, {"/api/v1/r29", kRouteAny, 29},
+    {"/api/v1/r30", kRouteAny, 30}, {"/api/v1/r31", kRouteAny, 31},
+    {"/api/v1/r32", kRouteAny, 32}, {"/api/v1/r33", kRouteAny, 33},
+    {"/api/v1/r34", kRouteAny, 34}, {"/api/v1/r35", kRouteAny, 35},
+    {"/api/v1/r36", kRouteAny, 36}, {"/api/v1/r37", kRouteAny, 37},
+    {"/api/v1/r38", kRouteAny, 38}, {"/api/v1/r39", kRouteAny, 39},
+    {"/api/v1/r40", kRouteAny, 40}, {"/api/v1/r41", kRouteAny, 41},
+    {"/api/v1/r42", kRouteAny, 42}, {"/api/v1/r43", kRouteAny, 43},
+    {"/api/v1/r44", kRouteAny, 44}, {"/api/v1/r45", kRouteAny, 45},
+    {"/api/v1/r46", kRouteAny, 46}, {"/api/v1/r47", kRouteAny, 47},
+    {"/api/v1/r48", kRouteAny, 48}, {"/api/v1/r49", kRouteAny, 49},
+    {"/api/v1/r50", kRouteAny, 50}, {"/api/v1/r51", kRouteAny, 51},
+    {"/api/v1/r52", kRouteAny, 52}, {"/api/v1/r53", kRouteAny, 53},
+    {"/api/v1/r54", kRouteAny, 54}, {"/api/v1/r55", kRouteAny, 55},
+    {"/api/v1/r56", kRouteAny, 56}, {"/api/v1/r57", kRouteAny, 57},
+    {"/api/v1/r58", kRouteAny, 58}, {"/api/v1/r59", kRouteAny, 59},
+    {"/api/v1/r60", kRouteAny, 60}, {"/api/v1/r61", kRouteAny, 61},
+    {"/api/v1/r62", kRouteAny, 62}, {"/api/v1/r63", kRouteAny, 63},
+};
+
+TEST(RouteTable, EveryRouteOfALargeTable) {
+  constexpr auto table = MakeRouteTable(kManyRoutes);
+  for (const auto& route : kManyRoutes) {
+    EXPECT_EQ(table.Find(kRouteGet, route.pattern), route.target)
+        << route.pattern;
+    std::string miss(route.pattern);
+    miss.back() = 'x';
+    EXPECT_EQ(table.Find(kRouteGet, miss), table.kNotFound);
+  }
+}
+
+}  // namespace
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
@@ -22,6 +22,8 @@
 #include "proxygen/lib/http/HTTPMessage.h"
 #include "src/server/grpc_handler/report_handler.h"
 #include "src/server/handler/handler.h"
+#include "src/server/http_handler/handler_pool.h"
+#include "src/server/http_handler/message_codec.h"
 #include "src/server/http_handler/util.h"
 #include "src/server/version_info.h"
 #include "src/util/util.h"
@@ -92,13 +94,15 @@ class ServerHandler : public proxygen::RequestHandler {
     } else {
       client_ip_ = "unknown";
     }
+    request_format_ = MessageCodec::RequestFormat(
+        http_headers.getSingleOrEmpty(proxygen::HTTP_HEADER_CONTENT_TYPE));
   }
   void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
     body_.append(reinterpret_cast<const char*>(body->data()), body->length());
   }
   void onEOM() noexcept override {
     // Parse request body to check for EC2 operations
-    std::string operation = ParseOperation(body_);
+    std::string operation = ParseRequest();
 
     if (operation == "ec2_start" || operation == "ec2_stop") {
       HandleEC2Operation(operation);
@@ -107,17 +111,37 @@ class ServerHandler : public proxygen::RequestHandler {
     }
   }
   void onUpgrade(proxygen::UpgradeProtocol) noexcept override {}
-  void requestComplete() noexcept override {}
-  void onError(proxygen::ProxygenError) noexcept override {}
+  void requestComplete() noexcept override {
+    HandlerPool<ServerHandler>::Release(this);
+  }
+  void onError(proxygen::ProxygenError) noexcept override {
+    HandlerPool<ServerHandler>::Release(this);
+  }
 
  private:
-  /// @brief Parse operation from request body
-  std::string ParseOperation(const std::string& body) {
-    // Simple JSON parsing to extract operation type
-    if (body.find("\"operation\":\"ec2_start\"") != std::string::npos) {
-      return "ec2_start";
-    } else if (body.find("\"operation\":\"ec2_stop\"") != std::string::npos) {
-      return "ec2_stop";
+  /// @brief Parse the request body: a ServerRequest for protobuf bodies,
+  ///        {"operation","instance_id","region"} for JSON.
+  /// @return "ec2_start", "ec2_stop" or "server_info".
+  std::string ParseRequest() {
+    std::string operation;
+    if (request_format_ == BodyFormat::kProtobuf) {
+      proto::ServerRequest req;
+      if (req.ParseFromString(body_)) {
+        if (req.op() == proto::OpCode::OP_EC2_START) {
+          operation = "ec2_start";
+        } else if (req.op() == proto::OpCode::OP_EC2_STOP) {
+          operation = "ec2_stop";
+        }
+        instance_id_ = req.instance_id();
+        region_ = req.region();
+      }
+    } else if (!body_.empty()) {
+      MessageCodec::ReadStringFields(&body_, {{"operation", &operation},
+                                              {"instance_id", &instance_id_},
+                                              {"region", &region_}});
+    }
+    if (operation == "ec2_start" || operation == "ec2_stop") {
+      return operation;
     }
     return "server_info";
   }
@@ -315,9 +339,8 @@ class ServerHandler : public proxygen::RequestHandler {
   }
 
   void HandleEC2Operation(const std::string& operation) {
-    // Extract instance_id and region from request body
-    std::string instance_id = ExtractJSONValue(body_, "instance_id");
-    std::string region = ExtractJSONValue(body_, "region");
+    const std::string& instance_id = instance_id_;
+    const std::string& region = region_;
 
     if (instance_id.empty()) {
       std::string error_response =
@@ -394,24 +417,11 @@ class ServerHandler : public proxygen::RequestHandler {
     Util::Success(res_body, downstream_);
   }
 
-  /// @brief Extract value from JSON string (simple implementation)
-  std::string ExtractJSONValue(const std::string& json,
-                               const std::string& key) {
-    std::string search_key = "\"" + key + "\":\"";
-    size_t start_pos = json.find(search_key);
-    if (start_pos == std::string::npos) {
-      return "";
-    }
-    start_pos += search_key.length();
-    size_t end_pos = json.find("\"", start_pos);
-    if (end_pos == std::string::npos) {
-      return "";
-    }
-    return json.substr(start_pos, end_pos - start_pos);
-  }
-
   std::string body_;
   std::string client_ip_;
+  std::string instance_id_;
+  std::string region_;
+  BodyFormat request_format_ = BodyFormat::kJson;
 };
 
 }  // namespace http_handler
@@ -0,0 +1,474 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/server/http_handler/static_assets.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "brotli/encode.h"
+#include "src/common/logging.h"
+#include "src/util/compression.h"
+#include "src/util/util.h"
+#include "zlib.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+
+/// @brief Read-only mapping of a whole file; falls back to a heap copy
+///        where mmap is unavailable.
+class MappedFile final {
+ public:
+  ~MappedFile() {
+#if !defined(_WIN32)
+    if (data_ != nullptr) {
+      munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+  }
+
+  static std::shared_ptr<MappedFile> Open(const std::string& path) {
+    auto file = std::shared_ptr<MappedFile>(new MappedFile());
+#if !defined(_WIN32)
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      close(fd);
+      return nullptr;
+    }
+    void* data =
+        mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED,
+             fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      return nullptr;
+    }
+    file->data_ = static_cast<const char*>(data);
+    file->size_ = static_cast<size_t>(st.st_size);
+#else
+    if (!util::Util::LoadSmallFile(path, &file->copy_)) {
+      return nullptr;
+    }
+    file->size_ = file->copy_.size();
+#endif
+    return file;
+  }
+
+  std::string_view view() const {
+#if !defined(_WIN32)
+    return {data_, size_};
+#else
+    return copy_;
+#endif
+  }
+
+ private:
+  MappedFile() = default;
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+#if defined(_WIN32)
+  std::string copy_;
+#endif
+};
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr const char* kEncodingNames[kAssetEncodingCount] = {"br", "zstd",
+                                                             "gzip", ""};
+constexpr const char* kEtagSuffixes[kAssetEncodingCount] = {"-br", "-zstd",
+                                                            "-gz", ""};
+
+struct ContentType {
+  const char* extension;
+  const char* type;
+  bool compressible;
+};
+
+constexpr ContentType kContentTypes[] = {
+    {".html", "text/html; charset=utf-8", true},
+    {".js", "text/javascript; charset=utf-8", true},
+    {".mjs", "text/javascript; charset=utf-8", true},
+    {".css", "text/css; charset=utf-8", true},
+    {".json", "application/json", true},
+    {".map", "application/json", true},
+    {".webmanifest", "application/manifest+json", true},
+    {".svg", "image/svg+xml", true},
+    {".txt", "text/plain; charset=utf-8", true},
+    {".xml", "application/xml", true},
+    {".wasm", "application/wasm", true},
+    {".ttf", "font/ttf", true},
+    {".otf", "font/otf", true},
+    {".ico", "image/x-icon", true},
+    {".woff", "font/woff", false},
+    {".woff2", "font/woff2", false},
+    {".png", "image/png", false},
+    {".jpg", "image/jpeg", false},
+    {".jpeg", "image/jpeg", false},
+    {".gif", "image/gif", false},
+    {".webp", "image/webp", false},
+    {".avif", "image/avif", false},
+};
+
+const ContentType& LookupContentType(const std::string& extension) {
+  static constexpr ContentType kDefault = {"", "application/octet-stream",
+                                           false};
+  std::string lower = extension;
+  util::Util::ToLower(&lower);
+  for (const auto& type : kContentTypes) {
+    if (lower == type.extension) {
+      return type;
+    }
+  }
+  return kDefault;
+}
+
+// Extension of a precompressed sibling ("foo.js.br") and its encoding.
+bool PrecompressedEncoding(const std::string& extension,
+                           AssetEncoding* encoding) {
+  if (extension == ".br") {
+    *encoding = AssetEncoding::kBrotli;
+  } else if (extension == ".zst") {
+    *encoding = AssetEncoding::kZstd;
+  } else if (extension == ".gz") {
+    *encoding = AssetEncoding::kGzip;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool CompressBrotli(std::string_view in, int quality, std::string* out) {
+  size_t size = BrotliEncoderMaxCompressedSize(in.size());
+  if (size == 0) {
+    return false;
+  }
+  out->resize(size);
+  if (!BrotliEncoderCompress(
+          quality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, in.size(),
+          reinterpret_cast<const uint8_t*>(in.data()), &size,
+          reinterpret_cast<uint8_t*>(out->data()))) {
+    return false;
+  }
+  out->resize(size);
+  return true;
+}
+
+bool CompressGzip(std::string_view in, int level, std::string* out) {
+  z_stream stream{};
+  // 16 + 15 window bits: gzip wrapper instead of zlib.
+  if (deflateInit2(&stream, level, Z_DEFLATED, 16 + 15, 9,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  out->resize(deflateBound(&stream, static_cast<uLong>(in.size())));
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+  stream.avail_in = static_cast<uInt>(in.size());
+  stream.next_out = reinterpret_cast<Bytef*>(out->data());
+  stream.avail_out = static_cast<uInt>(out->size());
+  const int ret = deflate(&stream, Z_FINISH);
+  out->resize(stream.total_out);
+  deflateEnd(&stream);
+  return ret == Z_STREAM_END;
+}
+
+// Relative path with '/' separators as a request path.
+std::string UrlPath(const fs::path& root, const fs::path& file) {
+  return "/" + file.lexically_relative(root).generic_string();
+}
+
+std::string_view TrimSpaces(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  return a.size() == b.size() &&
+         std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+           return std::tolower(static_cast<unsigned char>(x)) ==
+                  std::tolower(static_cast<unsigned char>(y));
+         });
+}
+
+}  // namespace
+
+const char* AssetEncodingName(AssetEncoding encoding) {
+  return kEncodingNames[static_cast<size_t>(encoding)];
+}
+
+std::shared_ptr<StaticAssetStore> StaticAssetStore::Instance() {
+  static std::shared_ptr<StaticAssetStore> instance =
+      std::make_shared<StaticAssetStore>();
+  return instance;
+}
+
+bool StaticAssetStore::Load(const std::string& root_dir,
+                            const Options& options) {
+  std::error_code ec;
+  const fs::path root = fs::weakly_canonical(fs::path(root_dir), ec);
+  if (ec || !fs::is_directory(root, ec)) {
+    LOG(ERROR) << "Web root is not a directory: " << root_dir;
+    return false;
+  }
+
+  std::unordered_map<std::string, std::unique_ptr<StaticAsset>> assets;
+  std::vector<std::pair<fs::path, AssetEncoding>> precompressed;
+  std::vector<StaticAsset*> compressible;
+  size_t memory_bytes = 0;
+
+  // Small files are copied into buffers[], larger ones mapped.
+  auto set_body = [&](StaticAsset* asset, AssetEncoding encoding,
+                      const fs::path& file, size_t size) {
+    const size_t index = static_cast<size_t>(encoding);
+    if (size > options.max_memory_file_size) {
+      asset->mappings[index] = MappedFile::Open(file.string());
+      if (!asset->mappings[index]) {
+        return false;
+      }
+      asset->variants[index].body = asset->mappings[index]->view();
+      return true;
+    }
+    if (!util::Util::LoadSmallFile(file.string(), &asset->buffers[index])) {
+      return false;
+    }
+    asset->variants[index].body = asset->buffers[index];
+    memory_bytes += asset->buffers[index].size();
+    return true;
+  };
+
+  auto set_etag = [](StaticAsset* asset, AssetEncoding encoding,
+                     const std::string& hash) {
+    const size_t index = static_cast<size_t>(encoding);
+    asset->variants[index].etag =
+        "\"" + hash.substr(0, 32) + kEtagSuffixes[index] + "\"";
+  };
+
+  for (fs::recursive_directory_iterator it(root, ec), end; !ec && it != end;
+       it.increment(ec)) {
+    if (!it->is_regular_file(ec)) {
+      continue;
+    }
+    const fs::path& file = it->path();
+    AssetEncoding encoding;
+    if (PrecompressedEncoding(file.extension().string(), &encoding) &&
+        fs::is_regular_file(fs::path(file).replace_extension(), ec)) {
+      precompressed.emplace_back(file, encoding);
+      continue;
+    }
+
+    auto asset = std::make_unique<StaticAsset>();
+    const ContentType& type = LookupContentType(file.extension().string());
+    const std::string path = UrlPath(root, file);
+    asset->content_type = type.type;
+    // The dashboard build puts content hashed bundles under /assets, so they
+    // never change under the same name.
+    asset->cache_control = util::Util::StartWith(path, "/assets/")
+                               ? "public, max-age=31536000, immutable"
+                               : "no-cache";
+    const size_t size = static_cast<size_t>(it->file_size(ec));
+    std::string hash;
+    if (ec || !set_body(asset.get(), AssetEncoding::kIdentity, file, size) ||
+        !(asset->mappings[static_cast<size_t>(AssetEncoding::kIdentity)]
+              ? util::Util::FileBlake3(file.string(), &hash)
+              : util::Util::Blake3(
+                    asset->buffers[static_cast<size_t>(
+                        AssetEncoding::kIdentity)],
+                    &hash))) {
+      LOG(WARNING) << "Skip unreadable asset " << file;
+      ec.clear();
+      continue;
+    }
+    set_etag(asset.get(), AssetEncoding::kIdentity, hash);
+    if (type.compressible && size >= options.min_compress_size &&
+        size <= options.max_memory_file_size) {
+      compressible.push_back(asset.get());
+    }
+    assets[path] = std::move(asset);
+  }
+  if (ec) {
+    LOG(ERROR) << "Failed to scan web root " << root << ": " << ec.message();
+    return false;
+  }
+
+  // Variants shipped by the build win over compressing at startup.
+  for (const auto& [file, encoding] : precompressed) {
+    auto it = assets.find(UrlPath(root, fs::path(file).replace_extension()));
+    std::string hash;
+    if (it == assets.end() ||
+        !set_body(it->second.get(), encoding, file,
+                  static_cast<size_t>(fs::file_size(file, ec))) ||
+        !util::Util::FileBlake3(file.string(), &hash)) {
+      LOG(WARNING) << "Skip precompressed asset " << file;
+      ec.clear();
+      continue;
+    }
+    set_etag(it->second.get(), encoding, hash);
+  }
+
+  for (StaticAsset* asset : compressible) {
+    const std::string& identity =
+        asset->buffers[static_cast<size_t>(AssetEncoding::kIdentity)];
+    // Encoded variants share the identity hash, only the suffix differs.
+    const std::string hash =
+        asset->variant(AssetEncoding::kIdentity).etag.substr(1, 32);
+    for (AssetEncoding encoding :
+         {AssetEncoding::kBrotli, AssetEncoding::kZstd, AssetEncoding::kGzip}) {
+      if (asset->variant(encoding).present()) {
+        continue;
+      }
+      const size_t index = static_cast<size_t>(encoding);
+      std::string& out = asset->buffers[index];
+      bool ok = false;
+      switch (encoding) {
+        case AssetEncoding::kBrotli:
+          ok = CompressBrotli(identity, options.brotli_quality, &out);
+          break;
+        case AssetEncoding::kZstd:
+          ok = util::Compression::Compress(util::CompressionCodec::kZstd,
+                                           identity, &out,
+                                           options.zstd_level);
+          break;
+        default:
+          ok = CompressGzip(identity, options.gzip_level, &out);
+          break;
+      }
+      // Not worth a Content-Encoding if it saves less than 1/16.
+      if (!ok || out.size() > identity.size() - identity.size() / 16) {
+        out.clear();
+        out.shrink_to_fit();
+        continue;
+      }
+      out.shrink_to_fit();
+      asset->variants[index].body = out;
+      set_etag(asset, encoding, hash);
+      memory_bytes += out.size();
+    }
+  }
+
+  assets_ = std::move(assets);
+  memory_bytes_ = memory_bytes;
+  return true;
+}
+
+const StaticAsset* StaticAssetStore::Find(std::string_view path) const {
+  if (path.empty() || path == "/") {
+    path = "/index.html";
+  }
+  auto it = assets_.find(std::string(path));
+  if (it != assets_.end()) {
+    return it->second.get();
+  }
+  const size_t slash = path.rfind('/');
+  if (path.find('.', slash == std::string_view::npos ? 0 : slash) !=
+      std::string_view::npos) {
+    return nullptr;
+  }
+  it = assets_.find("/index.html");
+  return it == assets_.end() ? nullptr : it->second.get();
+}
+
+AssetEncoding StaticAssetStore::Negotiate(std::string_view accept_encoding,
+                                          const StaticAsset& asset) {
+  // q-value per encoding in kAssetEncodingCount order, -1 if not listed.
+  double q[kAssetEncodingCount] = {-1, -1, -1, -1};
+  double wildcard = -1;
+  while (!accept_encoding.empty()) {
+    const size_t comma = accept_encoding.find(',');
+    std::string_view item = accept_encoding.substr(0, comma);
+    accept_encoding = comma == std::string_view::npos
+                          ? std::string_view()
+                          : accept_encoding.substr(comma + 1);
+
+    double value = 1;
+    const size_t semicolon = item.find(';');
+    if (semicolon != std::string_view::npos) {
+      std::string_view param = TrimSpaces(item.substr(semicolon + 1));
+      if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') &&
+          param[1] == '=') {
+        value = std::strtod(std::string(param.substr(2)).c_str(), nullptr);
+      }
+      item = item.substr(0, semicolon);
+    }
+    item = TrimSpaces(item);
+    if (item == "*") {
+      wildcard = value;
+      continue;
+    }
+    for (size_t i = 0; i < kAssetEncodingCount; ++i) {
+      if (EqualsIgnoreCase(item, kEncodingNames[i]) ||
+          (i == static_cast<size_t>(AssetEncoding::kIdentity) &&
+           EqualsIgnoreCase(item, "identity")) ||
+          (i == static_cast<size_t>(AssetEncoding::kGzip) &&
+           EqualsIgnoreCase(item, "x-gzip"))) {
+        q[i] = value;
+      }
+    }
+  }
+
+  // Identity stays acceptable unless refused explicitly.
+  const size_t identity = static_cast<size_t>(AssetEncoding::kIdentity);
+  if (q[identity] < 0) {
+    q[identity] = wildcard == 0 ? 0 : 0.001;
+  }
+  size_t best = identity;
+  double best_q = 0;
+  for (size_t i = 0; i < kAssetEncodingCount; ++i) {
+    const double value = q[i] < 0 ? wildcard : q[i];
+    if (asset.variants[i].present() && value > best_q) {
+      best = i;
+      best_q = value;
+    }
+  }
+  return static_cast<AssetEncoding>(best);
+}
+
+bool StaticAssetStore::EtagMatches(std::string_view if_none_match,
+                                   std::string_view etag) {
+  if (TrimSpaces(if_none_match) == "*") {
+    return true;
+  }
+  while (!if_none_match.empty()) {
+    const size_t comma = if_none_match.find(',');
+    std::string_view candidate = TrimSpaces(if_none_match.substr(0, comma));
+    if_none_match = comma == std::string_view::npos
+                        ? std::string_view()
+                        : if_none_match.substr(comma + 1);
+    if (candidate.substr(0, 2) == "W/") {
+      candidate.remove_prefix(2);
+    }
+    if (candidate == etag) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
@@ -0,0 +1,108 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_HTTP_HANDLER_STATIC_ASSETS_H_
+#define TBOX_SERVER_HTTP_HANDLER_STATIC_ASSETS_H_
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+
+/// @brief Content-Encoding variants of an asset, in server preference order.
+enum class AssetEncoding {
+  kBrotli = 0,
+  kZstd = 1,
+  kGzip = 2,
+  kIdentity = 3,
+};
+
+constexpr size_t kAssetEncodingCount = 4;
+
+/// @brief Content-Encoding token, empty for kIdentity.
+const char* AssetEncodingName(AssetEncoding encoding);
+
+class MappedFile;
+
+/// @brief One file of the dashboard with all of its encoded bodies.
+struct StaticAsset {
+  struct Variant {
+    std::string_view body;
+    std::string etag;  // strong, quoted, unique per encoding
+
+    bool present() const { return !etag.empty(); }
+  };
+
+  const Variant& variant(AssetEncoding encoding) const {
+    return variants[static_cast<size_t>(encoding)];
+  }
+
+  std::string content_type;
+  std::string cache_control;
+  std::array<Variant, kAssetEncodingCount> variants;
+
+  // Owners of the bodies above: heap copies, or a read-only mapping for
+  // files above the in-memory limit.
+  std::array<std::string, kAssetEncodingCount> buffers;
+  std::array<std::shared_ptr<MappedFile>, kAssetEncodingCount> mappings;
+};
+
+/// @brief The built dashboard (src/web/dist), loaded once into memory.
+/// @details Load() reads every file, takes foo.js.br / .zst / .gz siblings
+///          as precompressed variants and compresses the remaining text
+///          assets itself, so a page load is served from memory without a
+///          disk read. Files larger than max_memory_file_size are mapped
+///          read-only instead of copied and are only served as found on
+///          disk. Load() must finish before Find() is called concurrently.
+class StaticAssetStore final {
+ public:
+  struct Options {
+    size_t max_memory_file_size = 16 * 1024 * 1024;
+    // Bodies below this size are sent uncompressed.
+    size_t min_compress_size = 256;
+    int brotli_quality = 11;
+    int zstd_level = 19;
+    int gzip_level = 9;
+  };
+
+  static std::shared_ptr<StaticAssetStore> Instance();
+
+  /// @return false if root is not a readable directory.
+  bool Load(const std::string& root, const Options& options);
+  bool Load(const std::string& root) { return Load(root, Options()); }
+
+  /// @brief Asset for a request path (no query string). "/" serves
+  ///        /index.html, and so does any path without a file extension
+  ///        that matches no file, for client side routing.
+  const StaticAsset* Find(std::string_view path) const;
+
+  size_t size() const { return assets_.size(); }
+  size_t MemoryBytes() const { return memory_bytes_; }
+
+  /// @brief Best variant of asset the client accepts, by Accept-Encoding
+  ///        q-values, ties going to the smaller encoding.
+  static AssetEncoding Negotiate(std::string_view accept_encoding,
+                                 const StaticAsset& asset);
+
+  /// @brief If-None-Match check (weak comparison, RFC 9110 13.1.2).
+  static bool EtagMatches(std::string_view if_none_match,
+                          std::string_view etag);
+
+ private:
+  std::unordered_map<std::string, std::unique_ptr<StaticAsset>> assets_;
+  size_t memory_bytes_ = 0;
+};
+
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_HTTP_HANDLER_STATIC_ASSETS_H_
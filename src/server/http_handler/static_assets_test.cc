@@ -0,0 +1,144 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/server/http_handler/static_assets.h"
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+namespace {
+
+namespace fs = std::filesystem;
+
+class StaticAssetStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    root_ = fs::temp_directory_path() /
+            ("static_assets_test_" + std::to_string(::getpid()));
+    fs::remove_all(root_);
+    fs::create_directories(root_ / "assets");
+
+    std::string js;
+    for (int i = 0; i < 200; ++i) {
+      js += "export const value" + std::to_string(i) + " = " +
+            std::to_string(i) + ";\n";
+    }
+    Write("index.html", "<!doctype html><div id=app></div>");
+    Write("assets/index-abc123.js", js);
+    Write("assets/index-abc123.js.br", "precompressed");
+    Write("logo.png", std::string(4096, 'x'));
+  }
+
+  void TearDown() override { fs::remove_all(root_); }
+
+  void Write(const std::string& name, const std::string& content) {
+    std::ofstream out(root_ / name, std::ios::binary);
+    out << content;
+  }
+
+  fs::path root_;
+};
+
+TEST_F(StaticAssetStoreTest, Load) {
+  StaticAssetStore store;
+  ASSERT_TRUE(store.Load(root_.string()));
+  // The .br sibling is a variant, not an asset of its own.
+  EXPECT_EQ(store.size(), 3);
+  EXPECT_EQ(store.Find("/assets/index-abc123.js.br"), nullptr);
+
+  const StaticAsset* js = store.Find("/assets/index-abc123.js");
+  ASSERT_NE(js, nullptr);
+  EXPECT_EQ(js->content_type, "text/javascript; charset=utf-8");
+  EXPECT_EQ(js->cache_control, "public, max-age=31536000, immutable");
+  EXPECT_EQ(js->variant(AssetEncoding::kBrotli).body, "precompressed");
+  ASSERT_TRUE(js->variant(AssetEncoding::kZstd).present());
+  ASSERT_TRUE(js->variant(AssetEncoding::kGzip).present());
+  EXPECT_LT(js->variant(AssetEncoding::kGzip).body.size(),
+            js->variant(AssetEncoding::kIdentity).body.size());
+  EXPECT_NE(js->variant(AssetEncoding::kGzip).etag,
+            js->variant(AssetEncoding::kIdentity).etag);
+  EXPECT_EQ(js->variant(AssetEncoding::kIdentity).etag.size(), 34);
+
+  // Too small to compress, and images are never compressed.
+  const StaticAsset* index = store.Find("/");
+  ASSERT_NE(index, nullptr);
+  EXPECT_EQ(index->cache_control, "no-cache");
+  EXPECT_FALSE(index->variant(AssetEncoding::kGzip).present());
+  const StaticAsset* png = store.Find("/logo.png");
+  ASSERT_NE(png, nullptr);
+  EXPECT_EQ(png->content_type, "image/png");
+  EXPECT_FALSE(png->variant(AssetEncoding::kBrotli).present());
+  EXPECT_EQ(store.MemoryBytes() > 4096, true);
+
+  // Client side routes fall back to index.html, missing files do not.
+  EXPECT_EQ(store.Find("/servers/1"), index);
+  EXPECT_EQ(store.Find("/missing.js"), nullptr);
+}
+
+TEST_F(StaticAssetStoreTest, LargeFilesAreMapped) {
+  StaticAssetStore::Options options;
+  options.max_memory_file_size = 1024;
+  StaticAssetStore store;
+  ASSERT_TRUE(store.Load(root_.string(), options));
+  const StaticAsset* png = store.Find("/logo.png");
+  ASSERT_NE(png, nullptr);
+  EXPECT_EQ(png->variant(AssetEncoding::kIdentity).body,
+            std::string(4096, 'x'));
+  EXPECT_NE(png->mappings[static_cast<size_t>(AssetEncoding::kIdentity)],
+            nullptr);
+  const StaticAsset* js = store.Find("/assets/index-abc123.js");
+  ASSERT_NE(js, nullptr);
+  EXPECT_FALSE(js->variant(AssetEncoding::kZstd).present());
+}
+
+TEST_F(StaticAssetStoreTest, LoadMissingRoot) {
+  StaticAssetStore store;
+  EXPECT_FALSE(store.Load((root_ / "missing").string()));
+}
+
+TEST(StaticAssetStore, Negotiate) {
+  StaticAsset asset;
+  for (auto& variant : asset.variants) {
+    variant.etag = "\"x\"";
+  }
+  EXPECT_EQ(StaticAssetStore::Negotiate("", asset), AssetEncoding::kIdentity);
+  EXPECT_EQ(StaticAssetStore::Negotiate("gzip, deflate, br, zstd", asset),
+            AssetEncoding::kBrotli);
+  EXPECT_EQ(StaticAssetStore::Negotiate("gzip, deflate", asset),
+            AssetEncoding::kGzip);
+  EXPECT_EQ(StaticAssetStore::Negotiate("br;q=0.5, GZIP", asset),
+            AssetEncoding::kGzip);
+  EXPECT_EQ(StaticAssetStore::Negotiate("*", asset), AssetEncoding::kBrotli);
+  EXPECT_EQ(StaticAssetStore::Negotiate("br;q=0, *;q=0.1", asset),
+            AssetEncoding::kZstd);
+  EXPECT_EQ(StaticAssetStore::Negotiate("identity", asset),
+            AssetEncoding::kIdentity);
+
+  asset.variants[static_cast<size_t>(AssetEncoding::kBrotli)].etag.clear();
+  EXPECT_EQ(StaticAssetStore::Negotiate("br, gzip;q=0.8", asset),
+            AssetEncoding::kGzip);
+}
+
+TEST(StaticAssetStore, EtagMatches) {
+  EXPECT_TRUE(StaticAssetStore::EtagMatches("\"abc\"", "\"abc\""));
+  EXPECT_TRUE(StaticAssetStore::EtagMatches("W/\"abc\"", "\"abc\""));
+  EXPECT_TRUE(StaticAssetStore::EtagMatches("\"x\", \"abc\"", "\"abc\""));
+  EXPECT_TRUE(StaticAssetStore::EtagMatches(" * ", "\"abc\""));
+  EXPECT_FALSE(StaticAssetStore::EtagMatches("\"abc-gz\"", "\"abc\""));
+  EXPECT_FALSE(StaticAssetStore::EtagMatches("", "\"abc\""));
+}
+
+}  // namespace
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
@@ -0,0 +1,111 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_HTTP_HANDLER_STATIC_HANDLER_H_
+#define TBOX_SERVER_HTTP_HANDLER_STATIC_HANDLER_H_
+
+#include <memory>
+#include <string>
+
+#include "folly/io/IOBuf.h"
+#include "proxygen/httpserver/RequestHandler.h"
+#include "proxygen/httpserver/ResponseBuilder.h"
+#include "proxygen/lib/http/HTTPMessage.h"
+#include "src/server/http_handler/handler_pool.h"
+#include "src/server/http_handler/static_assets.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+
+/**
+ * @brief Serves the dashboard from `StaticAssetStore` for GET and HEAD.
+ *
+ * The encoding is negotiated from Accept-Encoding, If-None-Match against the
+ * variant's strong ETag answers 304, and the body is an IOBuf wrapping the
+ * store's buffer (or file mapping), so nothing is copied or read per request.
+ */
+class StaticHandler : public proxygen::RequestHandler {
+ public:
+  void onRequest(
+      std::unique_ptr<proxygen::HTTPMessage> headers) noexcept override {
+    head_ = headers->getMethod() == proxygen::HTTPMethod::HEAD;
+    asset_ = StaticAssetStore::Instance()->Find(headers->getPath());
+    if (asset_ == nullptr) {
+      return;
+    }
+    const proxygen::HTTPHeaders& http_headers = headers->getHeaders();
+    encoding_ = StaticAssetStore::Negotiate(
+        http_headers.getSingleOrEmpty(proxygen::HTTP_HEADER_ACCEPT_ENCODING),
+        *asset_);
+    not_modified_ = StaticAssetStore::EtagMatches(
+        http_headers.getSingleOrEmpty(proxygen::HTTP_HEADER_IF_NONE_MATCH),
+        asset_->variant(encoding_).etag);
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> /*body*/) noexcept override {}
+
+  void onEOM() noexcept override {
+    if (asset_ == nullptr) {
+      proxygen::ResponseBuilder(downstream_)
+          .status(404, "Not Found")
+          .body("The requested path was not found on this server.")
+          .sendWithEOM();
+      return;
+    }
+
+    const StaticAsset::Variant& variant = asset_->variant(encoding_);
+    proxygen::ResponseBuilder response(downstream_);
+    if (not_modified_) {
+      response.status(304, "Not Modified");
+    } else {
+      response.status(200, "Ok")
+          .header(proxygen::HTTP_HEADER_CONTENT_TYPE, asset_->content_type);
+      if (encoding_ != AssetEncoding::kIdentity) {
+        response.header(proxygen::HTTP_HEADER_CONTENT_ENCODING,
+                        AssetEncodingName(encoding_));
+      }
+    }
+    response.header(proxygen::HTTP_HEADER_ETAG, variant.etag)
+        .header(proxygen::HTTP_HEADER_CACHE_CONTROL, asset_->cache_control)
+        .header(proxygen::HTTP_HEADER_VARY, "Accept-Encoding");
+    if (not_modified_) {
+      response.sendWithEOM();
+    } else if (head_) {
+      response
+          .header(proxygen::HTTP_HEADER_CONTENT_LENGTH,
+                  std::to_string(variant.body.size()))
+          .sendWithEOM();
+    } else {
+      // The store outlives every request, so the IOBuf only borrows.
+      response
+          .body(folly::IOBuf::wrapBuffer(variant.body.data(),
+                                         variant.body.size()))
+          .sendWithEOM();
+    }
+  }
+
+  void onUpgrade(proxygen::UpgradeProtocol /*protocol*/) noexcept override {}
+
+  void requestComplete() noexcept override {
+    HandlerPool<StaticHandler>::Release(this);
+  }
+
+  void onError(proxygen::ProxygenError /*err*/) noexcept override {
+    HandlerPool<StaticHandler>::Release(this);
+  }
+
+ private:
+  const StaticAsset* asset_ = nullptr;
+  AssetEncoding encoding_ = AssetEncoding::kIdentity;
+  bool head_ = false;
+  bool not_modified_ = false;
+};
+
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_HTTP_HANDLER_STATIC_HANDLER_H_
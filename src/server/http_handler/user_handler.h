@@ -6,8 +6,13 @@
 #ifndef TBOX_SERVER_HTTP_HANDLER_USER_HANDLER_H
 #define TBOX_SERVER_HTTP_HANDLER_USER_HANDLER_H
 
+#include <string>
+#include <utility>
+
 #include "proxygen/httpserver/RequestHandler.h"
 #include "src/server/handler/handler.h"
+#include "src/server/http_handler/handler_pool.h"
+#include "src/server/http_handler/message_codec.h"
 #include "src/server/http_handler/util.h"
 
 namespace tbox {
@@ -16,7 +21,15 @@ namespace http_handler {
 
 class UserHandler : public proxygen::RequestHandler {
  public:
-  void onRequest(std::unique_ptr<proxygen::HTTPMessage>) noexcept override {}
+  void onRequest(
+      std::unique_ptr<proxygen::HTTPMessage> headers) noexcept override {
+    const proxygen::HTTPHeaders& http_headers = headers->getHeaders();
+    request_format_ = MessageCodec::RequestFormat(
+        http_headers.getSingleOrEmpty(proxygen::HTTP_HEADER_CONTENT_TYPE));
+    response_format_ = MessageCodec::ResponseFormat(
+        http_headers.getSingleOrEmpty(proxygen::HTTP_HEADER_ACCEPT),
+        request_format_);
+  }
   void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
     body_.append(reinterpret_cast<const char*>(body->data()), body->length());
   }
@@ -25,28 +38,36 @@ class UserHandler : public proxygen::RequestHandler {
     proto::UserResponse res;
     std::string res_body = "Parse request error";
 
-    if (!util::Util::JsonToMessage(body_, &req)) {
-      LOG(INFO) << body_;
+    if (!MessageCodec::Parse(&body_, request_format_, &req)) {
+      if (request_format_ == BodyFormat::kJson) {
+        LOG(INFO) << body_;
+      }
       Util::InternalServerError(res_body, downstream_);
       return;
     }
 
     handler::Handler::WebUserOpHandle(req, &res);
 
-    res_body.clear();
-    if (!util::Util::MessageToJson(res, &res_body)) {
-      res_body = "Res pb to json error";
+    if (!MessageCodec::Serialize(res, response_format_, &res_body)) {
+      res_body = "Res pb serialize error";
       Util::InternalServerError(res_body, downstream_);
       return;
     }
-    Util::Success(res_body, downstream_);
+    Util::Success(std::move(res_body),
+                  MessageCodec::ContentType(response_format_), downstream_);
   }
   void onUpgrade(proxygen::UpgradeProtocol) noexcept override {}
-  void requestComplete() noexcept override {}
-  void onError(proxygen::ProxygenError) noexcept override {}
+  void requestComplete() noexcept override {
+    HandlerPool<UserHandler>::Release(this);
+  }
+  void onError(proxygen::ProxygenError) noexcept override {
+    HandlerPool<UserHandler>::Release(this);
+  }
 
  private:
   std::string body_;
+  BodyFormat request_format_ = BodyFormat::kJson;
+  BodyFormat response_format_ = BodyFormat::kJson;
 };
 
 }  // namespace http_handler
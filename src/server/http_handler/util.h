@@ -6,6 +6,10 @@
 #ifndef TBOX_SERVER_HTTP_HANDLER_UTIL_H
 #define TBOX_SERVER_HTTP_HANDLER_UTIL_H
 
+#include <string>
+#include <utility>
+
+#include "folly/io/IOBuf.h"
 #include "proxygen/httpserver/ResponseBuilder.h"
 
 namespace tbox {
@@ -41,6 +45,16 @@ class Util {
         .body(res_body)
         .sendWithEOM();
   }
+
+  /// @brief 200 with an explicit Content-Type; the body is moved, not copied.
+  static void Success(std::string res_body, const char* content_type,
+                      proxygen::ResponseHandler* downstream) {
+    proxygen::ResponseBuilder(downstream)
+        .status(200, "Ok")
+        .header(proxygen::HTTP_HEADER_CONTENT_TYPE, content_type)
+        .body(folly::IOBuf::fromString(std::move(res_body)))
+        .sendWithEOM();
+  }
 };
 
 }  // namespace http_handler
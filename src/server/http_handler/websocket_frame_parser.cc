@@ -0,0 +1,118 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/server/http_handler/websocket_frame_parser.h"
+
+#include "folly/io/Cursor.h"
+#include "src/common/logging.h"
+#include "src/util/simd_codec.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+
+size_t WebSocketFrameParser::ParseHeader(WebSocketFrameHeader* header,
+                                         bool* error) const {
+  const size_t available = queue_.chainLength();
+  if (available < 2) {
+    return 0;
+  }
+  folly::io::Cursor cursor(queue_.front());
+  const uint8_t b0 = cursor.read<uint8_t>();
+  const uint8_t b1 = cursor.read<uint8_t>();
+  const uint8_t length_field = b1 & 0x7F;
+  header->fin = (b0 & 0x80) != 0;
+  header->rsv1 = (b0 & kWSRsv1) != 0;
+  header->opcode = b0 & 0x0F;
+  header->mask = (b1 & 0x80) != 0;
+  header->masking_key = 0;
+
+  size_t header_size = 2;
+  if (length_field == 126) {
+    header_size += 2;
+  } else if (length_field == 127) {
+    header_size += 8;
+  }
+  if (header->mask) {
+    header_size += 4;
+  }
+  if (available < header_size) {
+    return 0;
+  }
+
+  if (length_field == 126) {
+    header->payload_length = cursor.readBE<uint16_t>();
+  } else if (length_field == 127) {
+    header->payload_length = cursor.readBE<uint64_t>();
+  } else {
+    header->payload_length = length_field;
+  }
+  if (header->mask) {
+    cursor.pull(&header->masking_key, sizeof(header->masking_key));
+  }
+
+  if (b0 & 0x30) {
+    LOG(ERROR) << "Reserved bits set without extension";
+    *error = true;
+  } else if ((header->opcode > kWSOpBinary && header->opcode < kWSOpClose) ||
+             header->opcode > kWSOpPong) {
+    LOG(ERROR) << "Invalid opcode: " << static_cast<int>(header->opcode);
+    *error = true;
+  } else if (header->opcode >= kWSOpClose &&
+             (!header->fin || header->payload_length > 125)) {
+    LOG(ERROR) << "Invalid control frame";
+    *error = true;
+  } else if (header->payload_length > max_frame_size_) {
+    LOG(ERROR) << "Payload too large: " << header->payload_length;
+    *error = true;
+  }
+  return header_size;
+}
+
+WebSocketFrameParser::Status WebSocketFrameParser::Next(
+    WebSocketFrame* frame) {
+  WebSocketFrameHeader header;
+  bool error = false;
+  const size_t header_size = ParseHeader(&header, &error);
+  if (error) {
+    return Status::kError;
+  }
+  if (header_size == 0 ||
+      queue_.chainLength() - header_size < header.payload_length) {
+    return Status::kNeedMore;
+  }
+
+  queue_.trimStart(header_size);
+  if (header.payload_length == 0) {
+    frame->payload = folly::IOBuf::create(0);
+  } else {
+    frame->payload = queue_.split(header.payload_length);
+  }
+  if (header.mask) {
+    Unmask(frame->payload.get(), header.masking_key);
+  }
+  frame->header = header;
+  return Status::kFrame;
+}
+
+void WebSocketFrameParser::Unmask(folly::IOBuf* payload, uint32_t masking_key,
+                                  size_t phase) {
+  folly::IOBuf* buf = payload;
+  do {
+    if (buf->length() > 0) {
+      if (buf->isSharedOne()) {
+        buf->unshareOne();
+      }
+      util::SimdCodec::XorMask(reinterpret_cast<char*>(buf->writableData()),
+                               buf->length(), masking_key, phase);
+      phase += buf->length();
+    }
+    buf = buf->next();
+  } while (buf != payload);
+}
+
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
@@ -0,0 +1,93 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_HTTP_HANDLER_WEBSOCKET_FRAME_PARSER_H_
+#define TBOX_SERVER_HTTP_HANDLER_WEBSOCKET_FRAME_PARSER_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "folly/io/IOBuf.h"
+#include "folly/io/IOBufQueue.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+
+// RSV1 marks the first frame of a compressed message (RFC 7692).
+constexpr uint8_t kWSRsv1 = 0x40;
+// Upper bound for a message after decompression.
+constexpr size_t kWSMaxMessageSize = 100 * 1024 * 1024;
+
+constexpr uint8_t kWSOpContinuation = 0x0;
+constexpr uint8_t kWSOpText = 0x1;
+constexpr uint8_t kWSOpBinary = 0x2;
+constexpr uint8_t kWSOpClose = 0x8;
+constexpr uint8_t kWSOpPing = 0x9;
+constexpr uint8_t kWSOpPong = 0xA;
+
+// WebSocket frame header structure
+struct WebSocketFrameHeader {
+  bool fin;
+  bool rsv1;
+  uint8_t opcode;
+  bool mask;
+  uint64_t payload_length;
+  uint32_t masking_key;  // wire order
+};
+
+struct WebSocketFrame {
+  WebSocketFrameHeader header;
+  /// Unmasked payload, the buffers handed to Append() with the headers
+  /// trimmed off. Never null.
+  std::unique_ptr<folly::IOBuf> payload;
+};
+
+/// @brief Incremental RFC 6455 frame parser.
+/// @details Reads are appended as they arrive; a read may end in the middle
+///          of a frame header or payload, or carry several frames. Complete
+///          frames are split off the queue without copying and unmasked in
+///          place. Only buffers shared with someone else are copied first.
+class WebSocketFrameParser final {
+ public:
+  enum class Status {
+    kFrame,     // *frame holds the next frame
+    kNeedMore,  // wait for more data
+    kError,     // protocol violation, close the connection
+  };
+
+  explicit WebSocketFrameParser(uint64_t max_frame_size = kWSMaxMessageSize)
+      : queue_(folly::IOBufQueue::cacheChainLength()),
+        max_frame_size_(max_frame_size) {}
+
+  void Append(std::unique_ptr<folly::IOBuf> data) {
+    queue_.append(std::move(data));
+  }
+
+  /// @brief Extract the next complete frame.
+  Status Next(WebSocketFrame* frame);
+
+  /// @brief Bytes received but not yet returned as frames.
+  size_t Buffered() const { return queue_.chainLength(); }
+
+  /// @brief Unmask a payload chain in place.
+  /// @param phase Key offset of the first payload byte.
+  static void Unmask(folly::IOBuf* payload, uint32_t masking_key,
+                     size_t phase = 0);
+
+ private:
+  // Decodes the header at the front of the queue.
+  // @return Header size, 0 if incomplete.
+  size_t ParseHeader(WebSocketFrameHeader* header, bool* error) const;
+
+  folly::IOBufQueue queue_;
+  uint64_t max_frame_size_;
+};
+
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_HTTP_HANDLER_WEBSOCKET_FRAME_PARSER_H_
@@ -0,0 +1,158 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/server/http_handler/websocket_frame_parser.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/server/http_handler/websocket_handler.h"
+
+namespace tbox {
+namespace server {
+namespace http_handler {
+namespace {
+
+constexpr uint8_t kKey[4] = {0xa1, 0xb2, 0xc3, 0xd4};
+
+// A client frame: always masked.
+std::string ClientFrame(const std::string& payload, uint8_t opcode = kWSOpText,
+                        bool fin = true) {
+  std::string frame;
+  frame.push_back(static_cast<char>((fin ? 0x80 : 0) | opcode));
+  if (payload.size() <= 125) {
+    frame.push_back(static_cast<char>(0x80 | payload.size()));
+  } else if (payload.size() <= 65535) {
+    frame.push_back(static_cast<char>(0x80 | 126));
+    frame.push_back(static_cast<char>(payload.size() >> 8));
+    frame.push_back(static_cast<char>(payload.size()));
+  } else {
+    frame.push_back(static_cast<char>(0x80 | 127));
+    for (int i = 7; i >= 0; --i) {
+      frame.push_back(static_cast<char>(uint64_t(payload.size()) >> (8 * i)));
+    }
+  }
+  frame.append(reinterpret_cast<const char*>(kKey), 4);
+  for (size_t i = 0; i < payload.size(); ++i) {
+    frame.push_back(static_cast<char>(payload[i] ^ kKey[i % 4]));
+  }
+  return frame;
+}
+
+std::string Payload(size_t size) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<char>('a' + i % 26);
+  }
+  return data;
+}
+
+std::string ToString(const folly::IOBuf& buf) {
+  return buf.cloneAsValue().moveToFbString().toStdString();
+}
+
+// Feeds stream in reads of read_size bytes, returns all payloads.
+std::vector<std::string> Parse(const std::string& stream, size_t read_size) {
+  WebSocketFrameParser parser;
+  std::vector<std::string> payloads;
+  for (size_t pos = 0; pos < stream.size(); pos += read_size) {
+    parser.Append(
+        folly::IOBuf::copyBuffer(stream.data() + pos,
+                                 std::min(read_size, stream.size() - pos)));
+    WebSocketFrame frame;
+    WebSocketFrameParser::Status status;
+    while ((status = parser.Next(&frame)) ==
+           WebSocketFrameParser::Status::kFrame) {
+      payloads.push_back(ToString(*frame.payload));
+    }
+    EXPECT_EQ(status, WebSocketFrameParser::Status::kNeedMore);
+  }
+  EXPECT_EQ(parser.Buffered(), 0);
+  return payloads;
+}
+
+TEST(WebSocketFrameParser, SplitAndPackedReads) {
+  const std::vector<std::string> payloads = {
+      "", "hi", Payload(125), Payload(126), Payload(70000)};
+  std::string stream;
+  for (const auto& p : payloads) {
+    stream += ClientFrame(p);
+  }
+  // One byte per read, odd sized reads and everything in a single read.
+  for (const size_t read_size : {size_t(1), size_t(7), size_t(4096),
+                                 stream.size()}) {
+    EXPECT_EQ(Parse(stream, read_size), payloads) << read_size;
+  }
+}
+
+TEST(WebSocketFrameParser, MultiMegabyteFrameIsNotCopied) {
+  const std::string payload = Payload(5 << 20);
+  const std::string stream = ClientFrame(payload, kWSOpBinary);
+  WebSocketFrameParser parser;
+  std::vector<const uint8_t*> reads;
+  for (size_t pos = 0; pos < stream.size(); pos += 65536) {
+    auto buf = folly::IOBuf::copyBuffer(
+        stream.data() + pos, std::min<size_t>(65536, stream.size() - pos));
+    reads.push_back(buf->data());
+    parser.Append(std::move(buf));
+  }
+  WebSocketFrame frame;
+  ASSERT_EQ(parser.Next(&frame), WebSocketFrameParser::Status::kFrame);
+  EXPECT_EQ(frame.header.opcode, kWSOpBinary);
+  EXPECT_EQ(frame.header.payload_length, payload.size());
+  // The payload chain points into the original read buffers.
+  EXPECT_EQ(frame.payload->countChainElements(), reads.size());
+  EXPECT_EQ(frame.payload->next()->data(), reads[1]);
+  EXPECT_EQ(ToString(*frame.payload), payload);
+}
+
+TEST(WebSocketFrameParser, RejectsProtocolErrors) {
+  const auto rejects = [](std::string frame) {
+    WebSocketFrameParser parser(1024);
+    parser.Append(folly::IOBuf::copyBuffer(frame));
+    WebSocketFrame out;
+    return parser.Next(&out) == WebSocketFrameParser::Status::kError;
+  };
+  EXPECT_FALSE(rejects(ClientFrame("ok")));
+  EXPECT_TRUE(rejects(ClientFrame("x", 0x3)));
+  EXPECT_TRUE(rejects(ClientFrame("x", kWSOpPing, false)));
+  EXPECT_TRUE(rejects(ClientFrame(Payload(126), kWSOpPing)));
+  EXPECT_TRUE(rejects(ClientFrame(Payload(2000))));
+  std::string rsv2 = ClientFrame("x");
+  rsv2[0] |= 0x20;
+  EXPECT_TRUE(rejects(rsv2));
+}
+
+TEST(WebSocketHandler, ReassemblesFragmentedMessages) {
+  WebSocketHandler handler;
+  std::vector<std::string> messages;
+  std::vector<std::string> sent;
+  handler.SetCallback([&](std::unique_ptr<folly::IOBuf> message) {
+    messages.push_back(ToString(*message));
+  });
+  handler.SetSendFrameCallback(
+      [&](const std::string& frame) { sent.push_back(frame); });
+
+  const std::string stream =
+      ClientFrame("hel", kWSOpText, false) + ClientFrame("ping", kWSOpPing) +
+      ClientFrame("lo", kWSOpContinuation) + ClientFrame("world");
+  for (size_t pos = 0; pos < stream.size(); pos += 5) {
+    ASSERT_TRUE(handler.OnData(folly::IOBuf::copyBuffer(
+        stream.data() + pos, std::min<size_t>(5, stream.size() - pos))));
+  }
+  EXPECT_EQ(messages, (std::vector<std::string>{"hello", "world"}));
+  ASSERT_EQ(sent.size(), 1);
+  EXPECT_EQ(sent[0], std::string("\x8a\x04ping", 6));
+
+  EXPECT_FALSE(handler.OnData(
+      folly::IOBuf::copyBuffer(ClientFrame("x", kWSOpContinuation))));
+}
+
+}  // namespace
+}  // namespace http_handler
+}  // namespace server
+}  // namespace tbox
@@ -9,11 +9,16 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "folly/io/IOBuf.h"
 #include "folly/io/IOBufQueue.h"
+#include "src/common/binary_log.h"
 #include "src/common/socket_compat.h"
+#include "src/server/http_handler/websocket_frame_parser.h"
+#include "src/util/compression.h"
+#include "src/util/util.h"
 
 namespace tbox {
 namespace server {
@@ -28,48 +33,145 @@ const std::string kWSVersionHeader = "Sec-WebSocket-Version";
 const std::string kWSVersion = "13";
 const std::string kUpgradeTo = "websocket";
 
-// WebSocket frame header structure
-struct WebSocketFrameHeader {
-  bool fin;
-  uint8_t opcode;
-  bool mask;
-  uint64_t payload_length;
-  uint32_t masking_key;
-};
+// Per-message compression extensions, in order of preference. Browsers only
+// speak permessage-deflate; our own clients offer zstd and lz4.
+const std::string kWSExtensionZstd = "permessage-zstd";
+const std::string kWSExtensionLz4 = "permessage-lz4";
+const std::string kWSExtensionDeflate = "permessage-deflate";
 
 class WebSocketHandler {
  public:
-  using MessageCallback = std::function<void(const std::string&)>;
+  /// Receives each complete message, unmasked and decompressed.
+  using MessageCallback =
+      std::function<void(std::unique_ptr<folly::IOBuf> message)>;
   using CloseCallback = std::function<void()>;
   using SendFrameCallback = std::function<void(const std::string&)>;
 
   WebSocketHandler()
-      : current_message_(std::make_unique<folly::IOBufQueue>()),
+      : current_message_(std::make_unique<folly::IOBufQueue>(
+            folly::IOBufQueue::cacheChainLength())),
         is_fragmented_(false),
         current_opcode_(0) {}
 
+  /// @brief Set the shared dictionary used by zstd and lz4 connections whose
+  ///        client offers the same dict_id.
+  void SetDictionary(std::shared_ptr<const util::CompressionDictionary> dict) {
+    dictionary_ = std::move(dict);
+  }
+
+  /// @brief Restrict and order the codecs NegotiateExtensions() accepts.
+  /// @param names Codec names such as "zstd"; "none" disables compression.
+  void SetCompressionCodecs(const std::vector<std::string>& names) {
+    preferred_codecs_.clear();
+    for (const auto& name : names) {
+      util::CompressionCodec codec;
+      if (util::ParseCompressionCodec(name, &codec) &&
+          codec != util::CompressionCodec::kNone) {
+        preferred_codecs_.push_back(codec);
+      }
+    }
+  }
+
+  /// @brief Pick a compression extension from the client's
+  ///        Sec-WebSocket-Extensions offer.
+  /// @return Value for the Sec-WebSocket-Extensions response header, empty if
+  ///         the connection stays uncompressed.
+  std::string NegotiateExtensions(const std::string& offered) {
+    codec_ = util::CompressionCodec::kNone;
+    use_dictionary_ = false;
+    std::vector<std::string> names;
+    std::vector<std::string> extensions;
+    util::Util::Split(offered, ",", &extensions);
+    bool dictionary_offered = false;
+    for (auto& extension : extensions) {
+      std::vector<std::string> params;
+      util::Util::Split(extension, ";", &params);
+      if (params.empty()) {
+        continue;
+      }
+      const std::string name = util::Util::Trim(params[0]);
+      if (name == kWSExtensionZstd || name == kWSExtensionLz4) {
+        names.push_back(name.substr(name.find('-') + 1));
+        for (size_t i = 1; i < params.size(); ++i) {
+          if (dictionary_ && util::Util::Trim(params[i]) ==
+                                 "dict_id=" +
+                                     std::to_string(dictionary_->Id())) {
+            dictionary_offered = true;
+          }
+        }
+      } else if (name == kWSExtensionDeflate) {
+        names.push_back("deflate");
+      }
+    }
+
+    codec_ = util::Compression::Negotiate(names, preferred_codecs_);
+    switch (codec_) {
+      case util::CompressionCodec::kZstd:
+      case util::CompressionCodec::kLz4: {
+        std::string response = codec_ == util::CompressionCodec::kZstd
+                                   ? kWSExtensionZstd
+                                   : kWSExtensionLz4;
+        if (dictionary_offered) {
+          use_dictionary_ = true;
+          response += "; dict_id=" + std::to_string(dictionary_->Id());
+        }
+        return response;
+      }
+      case util::CompressionCodec::kDeflate:
+        // Every message is compressed on its own, so neither side may keep
+        // the LZ77 window between messages.
+        return kWSExtensionDeflate +
+               "; server_no_context_takeover; client_no_context_takeover";
+      default:
+        return "";
+    }
+  }
+
+  util::CompressionCodec Codec() const { return codec_; }
+
+  /// @brief Dictionary negotiated along with Codec(), nullptr if none.
+  const util::CompressionDictionary* Dictionary() const {
+    return use_dictionary_ ? dictionary_.get() : nullptr;
+  }
+
   // Add new function to assemble WebSocket frames
-  std::string AssembleFrame(const std::string& message, uint8_t opcode = 0x1) {
+  std::string AssembleFrame(const std::string& message,
+                            uint8_t opcode = kWSOpText) {
     std::string frame;
 
-    // First byte: FIN (1) + opcode
-    frame.push_back(0x80 | (opcode & 0x0F));
+    // Data messages above the threshold go out compressed when a codec was
+    // negotiated; control frames never are.
+    std::string compressed;
+    const std::string* payload = &message;
+    uint8_t rsv = 0;
+    if (codec_ != util::CompressionCodec::kNone && opcode < kWSOpClose &&
+        message.size() >= util::Compression::kMinCompressSize &&
+        util::Compression::Compress(codec_, message, &compressed, 0,
+                                    Dictionary()) &&
+        compressed.size() < message.size()) {
+      payload = &compressed;
+      rsv = kWSRsv1;
+    }
+
+    // First byte: FIN (1) + RSV1 + opcode
+    frame.push_back(0x80 | rsv | (opcode & 0x0F));
 
     // Second byte: MASK (0) + payload length
-    if (message.size() <= 125) {
-      frame.push_back(message.size());
-    } else if (message.size() <= 65535) {
+    const std::string& message_ref = *payload;
+    if (message_ref.size() <= 125) {
+      frame.push_back(message_ref.size());
+    } else if (message_ref.size() <= 65535) {
       frame.push_back(126);
-      uint16_t len = htons(message.size());
+      uint16_t len = htons(message_ref.size());
       frame.append(reinterpret_cast<char*>(&len), sizeof(len));
     } else {
       frame.push_back(127);
-      uint64_t len = folly::Endian::big(message.size());
+      uint64_t len = folly::Endian::big(message_ref.size());
       frame.append(reinterpret_cast<char*>(&len), sizeof(len));
     }
 
     // Add payload without masking
-    frame.append(message);
+    frame.append(message_ref);
 
     return frame;
   }
@@ -86,165 +188,44 @@ class WebSocketHandler {
     send_frame_callback_ = std::move(callback);
   }
 
-  bool ProcessFrame(std::unique_ptr<folly::IOBuf> frame) {
-    LOG(INFO) << "Processing frame";
-    if (!frame || frame->length() < 2) {
-      LOG(ERROR) << "Frame too short";
-      return false;
-    }
-
-    // Parse frame header
-    const uint8_t* data = frame->data();
-    WebSocketFrameHeader header;
-    header.fin = (data[0] & 0x80) != 0;
-    header.opcode = data[0] & 0x0F;
-    header.mask = (data[1] & 0x80) != 0;
-
-    // Validate opcode
-    if (header.opcode > 0xA) {
-      LOG(ERROR) << "Invalid opcode: " << header.opcode;
-      return false;
-    }
-
-    // Handle control frames
-    if (header.opcode >= 0x8) {  // Control frames
-      if (!header.fin) {
-        LOG(ERROR) << "Control frame must not be fragmented";
-        return false;
-      }
-      if (frame->length() > 125) {
-        LOG(ERROR) << "Control frame payload too large";
-        return false;
-      }
-
-      switch (header.opcode) {
-        case 0x8:  // Close
-          LOG(INFO) << "Received close frame";
-          if (frame->length() >= 4) {
-            // Parse frame header
-            const uint8_t* data = frame->data();
-            bool fin = (data[0] & 0x80) != 0;
-            uint8_t opcode = data[0] & 0x0F;
-            bool mask = (data[1] & 0x80) != 0;
-            uint8_t length_field = data[1] & 0x7F;
-
-            // Calculate header size
-            size_t header_size = 2;  // Base header size
-            if (length_field == 126) {
-              header_size += 2;
-            } else if (length_field == 127) {
-              header_size += 8;
-            }
-
-            // Get masking key if present
-            uint32_t masking_key = 0;
-            if (mask) {
-              if (frame->length() < header_size + 4) {
-                LOG(ERROR) << "Frame too short for masking key";
-                return false;
-              }
-              masking_key =
-                  ntohl(*reinterpret_cast<const uint32_t*>(data + header_size));
-              header_size += 4;
-            }
-
-            // Get payload and unmask if needed
-            const uint8_t* payload = data + header_size;
-            uint16_t status_code;
-            if (mask) {
-              // Create a copy of the payload to unmask
-              std::vector<uint8_t> unmasked_payload(payload, payload + 2);
-              for (size_t i = 0; i < unmasked_payload.size(); i++) {
-                unmasked_payload[i] ^=
-                    (masking_key >> ((3 - (i % 4)) * 8)) & 0xFF;
-              }
-              status_code = ntohs(
-                  *reinterpret_cast<const uint16_t*>(unmasked_payload.data()));
-            } else {
-              status_code = ntohs(*reinterpret_cast<const uint16_t*>(payload));
-            }
-
-            LOG(INFO) << "Close frame: fin=" << fin
-                      << ", opcode=" << (int)opcode << ", mask=" << mask
-                      << ", length=" << (int)length_field
-                      << ", header_size=" << header_size << ", masking_key=0x"
-                      << std::hex << masking_key << std::dec
-                      << ", status_code=" << status_code << " (0x" << std::hex
-                      << status_code << std::dec << ")" << " [raw bytes: 0x"
-                      << std::hex << (int)payload[0] << " 0x" << (int)payload[1]
-                      << std::dec << "]";
-
-            // Send close frame in response
-            if (send_frame_callback_) {
-              std::string close_frame;
-              close_frame.push_back(0x88);  // FIN + CLOSE opcode
-              close_frame.push_back(0x82);  // MASK + 2 bytes payload length
-
-              // Generate random masking key
-              uint32_t response_masking_key = rand();
-              close_frame.append(reinterpret_cast<char*>(&response_masking_key),
-                                 sizeof(response_masking_key));
-
-              // Add status code in network byte order
-              uint16_t response_code = htons(1000);  // Normal Closure
-              std::string response_payload;
-              response_payload.append(reinterpret_cast<char*>(&response_code),
-                                      sizeof(response_code));
-
-              // Apply masking
-              for (size_t i = 0; i < response_payload.size(); i++) {
-                response_payload[i] ^=
-                    (response_masking_key >> ((3 - (i % 4)) * 8)) & 0xFF;
-              }
-              close_frame.append(response_payload);
-
-              LOG(INFO) << "Sending close frame with status: " << 1000 << " (0x"
-                        << std::hex << 1000 << std::dec << ")"
-                        << " [masking_key: 0x" << std::hex
-                        << response_masking_key << std::dec << "]";
-              send_frame_callback_(close_frame);
-            }
-          }
-          if (close_callback_) {
-            close_callback_();
-          }
-          return true;
-
-        case 0x9:  // Ping
-          LOG(INFO) << "Received ping frame";
-          if (send_frame_callback_) {
-            // Create pong frame
-            std::string pong_frame;
-            pong_frame.push_back(0x8A);  // FIN + PONG opcode
-            pong_frame.push_back(0x80);  // MASK + 0 bytes payload length
-
-            // Generate random masking key
-            uint32_t masking_key = rand();
-            pong_frame.append(reinterpret_cast<char*>(&masking_key),
-                              sizeof(masking_key));
-
-            LOG(INFO) << "Sending pong frame [masking_key: 0x" << std::hex
-                      << masking_key << std::dec << "]";
-            send_frame_callback_(pong_frame);
-          }
+  /// @brief Feed bytes read from the connection. A read may hold part of a
+  ///        frame or several frames; complete messages are delivered to the
+  ///        message callback as they finish.
+  /// @return false on a protocol error, the connection should be dropped.
+  bool OnData(std::unique_ptr<folly::IOBuf> data) {
+    parser_.Append(std::move(data));
+    WebSocketFrame frame;
+    while (true) {
+      switch (parser_.Next(&frame)) {
+        case WebSocketFrameParser::Status::kNeedMore:
           return true;
-
-        case 0xA:  // Pong
-          LOG(INFO) << "Received pong frame";
-          return true;
-
-        default:
-          LOG(ERROR) << "Unknown control frame opcode: " << header.opcode;
+        case WebSocketFrameParser::Status::kError:
           return false;
+        case WebSocketFrameParser::Status::kFrame:
+          if (!HandleFrame(std::move(frame))) {
+            return false;
+          }
+          break;
       }
     }
+  }
 
-    // Handle data frames
-    if (header.opcode == 0x0) {  // Continuation frame
+ private:
+  bool HandleFrame(WebSocketFrame frame) {
+    const WebSocketFrameHeader& header = frame.header;
+    if (header.opcode >= kWSOpClose) {
+      return HandleControlFrame(header.opcode, std::move(frame.payload));
+    }
+
+    if (header.opcode == kWSOpContinuation) {
       if (!is_fragmented_) {
         LOG(ERROR) << "Unexpected continuation frame";
         return false;
       }
+      if (header.rsv1) {
+        LOG(ERROR) << "RSV1 set on continuation frame";
+        return false;
+      }
     } else {  // New message
       if (is_fragmented_) {
         LOG(ERROR) << "Previous message not finished";
@@ -252,83 +233,108 @@ class WebSocketHandler {
       }
       is_fragmented_ = true;
       current_opcode_ = header.opcode;
-      current_message_ = std::make_unique<folly::IOBufQueue>();
-    }
-
-    // Parse payload length
-    size_t header_size = 2;
-    uint8_t length_field = data[1] & 0x7F;
-    uint64_t payload_length;
-    if (length_field == 126) {
-      if (frame->length() < 4)
-        return false;
-      payload_length = ntohs(*reinterpret_cast<const uint16_t*>(data + 2));
-      header_size = 4;
-    } else if (length_field == 127) {
-      if (frame->length() < 10)
+      current_compressed_ = header.rsv1;
+      current_message_ = std::make_unique<folly::IOBufQueue>(
+          folly::IOBufQueue::cacheChainLength());
+      if (current_compressed_ && codec_ == util::CompressionCodec::kNone) {
+        LOG(ERROR) << "Compressed frame without negotiated extension";
         return false;
-      payload_length =
-          folly::Endian::big(*reinterpret_cast<const uint64_t*>(data + 2));
-      header_size = 10;
-    } else {
-      payload_length = length_field;
+      }
     }
 
-    // Validate payload length
-    if (payload_length > 100 * 1024 * 1024) {  // 100MB limit
-      LOG(ERROR) << "Payload too large: " << payload_length;
+    current_message_->append(std::move(frame.payload));
+    if (current_message_->chainLength() > kWSMaxMessageSize) {
+      BLOG(ERROR, "Message too large: {}", current_message_->chainLength());
       return false;
     }
-
-    // Handle masking
-    if (header.mask) {
-      if (frame->length() < header_size + 4)
-        return false;
-      header.masking_key =
-          ntohl(*reinterpret_cast<const uint32_t*>(data + header_size));
-      header_size += 4;
+    if (!header.fin) {
+      return true;
     }
 
-    // Skip header
-    frame->trimStart(header_size);
-
-    // Unmask payload if needed
-    if (header.mask) {
-      uint8_t* payload = frame->writableData();
-      for (size_t i = 0; i < frame->length(); i++) {
-        payload[i] ^= (header.masking_key >> ((3 - (i % 4)) * 8)) & 0xFF;
+    is_fragmented_ = false;
+    auto message = current_message_->move();
+    if (!message) {
+      message = folly::IOBuf::create(0);
+    }
+    if (current_compressed_) {
+      // Decompression needs contiguous input, the only copy on this path.
+      const auto range = message->coalesce();
+      std::string inflated;
+      if (!util::Compression::Decompress(
+              codec_,
+              std::string_view(reinterpret_cast<const char*>(range.data()),
+                               range.size()),
+              &inflated, kWSMaxMessageSize, Dictionary())) {
+        BLOG(ERROR, "Failed to decompress {} message",
+             util::CompressionCodecName(codec_));
+        return false;
       }
+      message = folly::IOBuf::fromString(std::move(inflated));
     }
+    if (message_callback_) {
+      message_callback_(std::move(message));
+    }
+    return true;
+  }
 
-    // Add payload to current message
-    current_message_->append(std::move(frame));
-
-    // If this is the final frame, process the complete message
-    if (header.fin) {
-      is_fragmented_ = false;
-      auto complete_message = current_message_->move();
-      current_message_ = std::make_unique<folly::IOBufQueue>();
-
-      // Convert the complete message to string and call the callback
-      if (message_callback_) {
-        LOG(INFO) << "Calling callback for "
-                  << (current_opcode_ == 0x1 ? "text" : "binary") << " message";
-        std::string message_str =
-            complete_message->moveToFbString().toStdString();
-        message_callback_(message_str);
+  bool HandleControlFrame(uint8_t opcode,
+                          std::unique_ptr<folly::IOBuf> payload) {
+    switch (opcode) {
+      case kWSOpClose: {
+        // Control payloads are at most 125 bytes, copying them is free.
+        const std::string body = payload->moveToFbString().toStdString();
+        uint16_t status_code = 1005;  // No status received
+        if (body.size() >= 2) {
+          status_code = static_cast<uint16_t>(
+              static_cast<uint8_t>(body[0]) << 8 |
+              static_cast<uint8_t>(body[1]));
+        }
+        BLOG(INFO, "Received close frame, status: {}", status_code);
+        if (send_frame_callback_) {
+          const uint16_t response_code = htons(1000);  // Normal Closure
+          send_frame_callback_(AssembleFrame(
+              std::string(reinterpret_cast<const char*>(&response_code),
+                          sizeof(response_code)),
+              kWSOpClose));
+        }
+        if (close_callback_) {
+          close_callback_();
+        }
+        return true;
       }
-    }
 
-    return true;
+      case kWSOpPing:
+        // A pong echoes the ping payload (RFC 6455 5.5.3).
+        if (send_frame_callback_) {
+          send_frame_callback_(AssembleFrame(
+              payload->moveToFbString().toStdString(), kWSOpPong));
+        }
+        return true;
+
+      case kWSOpPong:
+        return true;
+
+      default:
+        BLOG(ERROR, "Unknown control frame opcode: {}",
+             static_cast<int>(opcode));
+        return false;
+    }
   }
 
- private:
+  WebSocketFrameParser parser_;
   std::unique_ptr<folly::IOBufQueue> current_message_;
   MessageCallback message_callback_;
   CloseCallback close_callback_;
   SendFrameCallback send_frame_callback_;
   bool is_fragmented_;
   uint8_t current_opcode_;
+  bool current_compressed_ = false;
+  util::CompressionCodec codec_ = util::CompressionCodec::kNone;
+  std::shared_ptr<const util::CompressionDictionary> dictionary_;
+  bool use_dictionary_ = false;
+  std::vector<util::CompressionCodec> preferred_codecs_ = {
+      util::CompressionCodec::kZstd, util::CompressionCodec::kLz4,
+      util::CompressionCodec::kDeflate};
 };
 
 }  // namespace http_handler
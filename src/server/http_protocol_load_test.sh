@@ -0,0 +1,107 @@
+#!/bin/bash
+# Compare request latency of a running tbox_server over HTTP/1.1, HTTP/2
+# (h2c prior knowledge and TLS ALPN) and HTTP/3, using h2load from nghttp2
+# (HTTP/3 needs an h2load built with ngtcp2/nghttp3).
+#
+#   bazel run //src/server:http_protocol_load_test -- \
+#       --http=10003 --h2c=10005 --https=10004 --h3=10004 --path=/server
+#
+# Ports left at 0 are skipped. --loss=PCT adds netem packet loss on the
+# loopback device for the run (root only) to compare behaviour on lossy
+# links.
+
+set -euo pipefail
+
+HOST=127.0.0.1
+HTTP_PORT=0
+H2C_PORT=0
+HTTPS_PORT=0
+H3_PORT=0
+URL_PATH=/server
+REQUESTS=20000
+CLIENTS=32
+STREAMS=8
+THREADS=4
+LOSS=0
+
+for arg in "$@"; do
+    case "${arg}" in
+        --host=*) HOST="${arg#*=}" ;;
+        --http=*) HTTP_PORT="${arg#*=}" ;;
+        --h2c=*) H2C_PORT="${arg#*=}" ;;
+        --https=*) HTTPS_PORT="${arg#*=}" ;;
+        --h3=*) H3_PORT="${arg#*=}" ;;
+        --path=*) URL_PATH="${arg#*=}" ;;
+        --requests=*) REQUESTS="${arg#*=}" ;;
+        --clients=*) CLIENTS="${arg#*=}" ;;
+        --streams=*) STREAMS="${arg#*=}" ;;
+        --threads=*) THREADS="${arg#*=}" ;;
+        --loss=*) LOSS="${arg#*=}" ;;
+        *)
+            echo "unknown argument: ${arg}" >&2
+            exit 1
+            ;;
+    esac
+done
+
+if ! command -v h2load >/dev/null 2>&1; then
+    echo "h2load not found, install nghttp2" >&2
+    exit 1
+fi
+
+WORK_DIR="$(mktemp -d)"
+cleanup() {
+    if [ "${LOSS}" != "0" ]; then
+        tc qdisc del dev lo root netem 2>/dev/null || true
+    fi
+    rm -rf "${WORK_DIR}"
+}
+trap cleanup EXIT
+
+if [ "${LOSS}" != "0" ]; then
+    tc qdisc add dev lo root netem loss "${LOSS}%"
+fi
+
+# h2load --log-file lines are "start_us status duration_us".
+report() {
+    local name="$1"
+    local log="$2"
+    sort -n -k3 "${log}" | awk -v name="${name}" '
+        { d[NR] = $3; sum += $3; if ($2 >= 400 || $2 < 0) errors++ }
+        END {
+            if (NR == 0) { printf "%-10s no requests completed\n", name; exit }
+            printf "%-10s n=%-7d err=%-5d mean=%7.0fus p50=%7dus p90=%7dus p99=%7dus max=%7dus\n",
+                name, NR, errors, sum / NR, d[int(NR * 0.50) + 1],
+                d[int(NR * 0.90) + 1], d[int(NR * 0.99) + 1], d[NR]
+        }'
+}
+
+run() {
+    local name="$1"
+    shift
+    local log="${WORK_DIR}/${name}.log"
+    if h2load -n "${REQUESTS}" -c "${CLIENTS}" -t "${THREADS}" \
+        --log-file="${log}" "$@" >"${WORK_DIR}/${name}.out" 2>&1; then
+        report "${name}" "${log}"
+    else
+        echo "${name}: h2load failed" >&2
+        tail -n 5 "${WORK_DIR}/${name}.out" >&2
+    fi
+}
+
+echo "${REQUESTS} requests, ${CLIENTS} connections, ${STREAMS} streams" \
+    "per connection (HTTP/1.1: 1), loss ${LOSS}%, path ${URL_PATH}"
+if [ "${HTTP_PORT}" != "0" ]; then
+    run http1.1 --h1 "http://${HOST}:${HTTP_PORT}${URL_PATH}"
+fi
+if [ "${H2C_PORT}" != "0" ]; then
+    run h2c -m "${STREAMS}" "http://${HOST}:${H2C_PORT}${URL_PATH}"
+fi
+if [ "${HTTPS_PORT}" != "0" ]; then
+    run h2-tls -m "${STREAMS}" --alpn-list=h2 \
+        "https://${HOST}:${HTTPS_PORT}${URL_PATH}"
+fi
+if [ "${H3_PORT}" != "0" ]; then
+    run h3 -m "${STREAMS}" --alpn-list=h3 \
+        "https://${HOST}:${H3_PORT}${URL_PATH}"
+fi
@@ -6,8 +6,11 @@
 #ifndef TBOX_SERVER_HTTP_SERVER_IMPL_H_
 #define TBOX_SERVER_HTTP_SERVER_IMPL_H_
 
+#include <chrono>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #if defined(__GNUC__) || defined(__clang__)
 #pragma GCC diagnostic push
@@ -15,12 +18,17 @@
 #endif
 #include "proxygen/httpserver/HTTPServer.h"
 #include "proxygen/httpserver/HTTPServerOptions.h"
+#include "proxygen/httpserver/RequestHandlerFactory.h"
 #if defined(__GNUC__) || defined(__clang__)
 #pragma GCC diagnostic pop
 #endif
 #include "src/impl/config_manager.h"
+#include "src/server/http3_server_impl.h"
+#include "src/server/http_handler/alt_svc_filter.h"
 #include "src/server/http_handler/http_handler_factory.h"
+#include "src/server/http_handler/static_assets.h"
 #include "src/server/server_context.h"
+#include "wangle/ssl/SSLContextConfig.h"
 
 namespace tbox {
 namespace server {
@@ -29,36 +37,97 @@ class HttpServer final {
  public:
   HttpServer(std::shared_ptr<ServerContext> server_context)
       : server_context_(server_context) {
+    auto config = util::ConfigManager::Instance();
+    const ThreadModel& model = server_context_->thread_model();
+    const size_t threads = model.http_io_threads;
+    const auto idle_timeout = model.http_idle_timeout;
+    const std::string addr = config->ServerAddr();
+
+    if (!config->WebRoot().empty()) {
+      auto assets = http_handler::StaticAssetStore::Instance();
+      if (assets->Load(config->WebRoot())) {
+        LOG(INFO) << "Serving " << assets->size() << " web assets from "
+                  << config->WebRoot() << ", " << assets->MemoryBytes()
+                  << " bytes in memory";
+      }
+    }
+
     proxygen::HTTPServerOptions options;
-    options.threads = static_cast<size_t>(sysconf(_SC_NPROCESSORS_ONLN));
-    options.idleTimeout = std::chrono::milliseconds(60000);
+    options.threads = threads;
+    options.idleTimeout = idle_timeout;
+    // One listening socket per IO thread, the kernel spreads connections.
+    options.reusePort = model.reuse_port;
+    // Plain HTTP/1.1 clients may switch to HTTP/2 with "Upgrade: h2c".
+    options.h2cEnabled = true;
+    proxygen::RequestHandlerChain chain;
+    if (config->Http3ServerPort() != 0) {
+      chain.addThen<http_handler::AltSvcFilterFactory>(
+          config->Http3ServerPort());
+    }
     options.handlerFactories =
-        proxygen::RequestHandlerChain()
-            .addThen<tbox::server::http_handler::HTTPHandlerFactory>()
+        chain.addThen<tbox::server::http_handler::HTTPHandlerFactory>()
             .build();
 
-    std::string addr = util::ConfigManager::Instance()->ServerAddr();
-    int32_t port = util::ConfigManager::Instance()->HttpServerPort();
-
-    proxygen::HTTPServer::IPConfig ip_config{
-        folly::SocketAddress(addr, port, true),
-        proxygen::HTTPServer::Protocol::HTTP};
-
-    std::vector<proxygen::HTTPServer::IPConfig> IPs{ip_config};
+    std::vector<proxygen::HTTPServer::IPConfig> IPs;
+    IPs.emplace_back(folly::SocketAddress(addr, config->HttpServerPort(), true),
+                     proxygen::HTTPServer::Protocol::HTTP);
+    if (config->H2cServerPort() != 0) {
+      IPs.emplace_back(
+          folly::SocketAddress(addr, config->H2cServerPort(), true),
+          proxygen::HTTPServer::Protocol::HTTP2);
+    }
+    if (config->HttpsServerPort() != 0) {
+      proxygen::HTTPServer::IPConfig tls_config(
+          folly::SocketAddress(addr, config->HttpsServerPort(), true),
+          proxygen::HTTPServer::Protocol::HTTP);
+      wangle::SSLContextConfig ssl_config;
+      ssl_config.isDefault = true;
+      ssl_config.setCertificate(config->TlsCertFile(), config->TlsKeyFile(),
+                                "");
+      // ALPN: prefer h2, keep http/1.1 for older clients.
+      ssl_config.setNextProtocols({"h2", "http/1.1"});
+      tls_config.sslConfigs.push_back(std::move(ssl_config));
+      IPs.push_back(std::move(tls_config));
+    }
 
     server_ = std::make_shared<proxygen::HTTPServer>(std::move(options));
     server_->bind(IPs);
+
+    if (config->Http3ServerPort() != 0) {
+      auto factories = std::make_shared<HandlerFactories>();
+      factories->push_back(
+          std::make_shared<tbox::server::http_handler::HTTPHandlerFactory>());
+      http3_server_ = std::make_unique<Http3Server>(
+          folly::SocketAddress(addr, config->Http3ServerPort(), true), threads,
+          idle_timeout, std::move(factories));
+      if (!http3_server_->LoadCertificate(config->TlsCertFile(),
+                                          config->TlsKeyFile())) {
+        LOG(ERROR) << "HTTP/3 listener disabled";
+        http3_server_.reset();
+      }
+    }
   }
 
  public:
+  /// @brief Start the QUIC listener, then serve TCP until Shutdown().
   void Start() {
-    server_->start();
+    if (http3_server_) {
+      http3_server_->Start();
+    }
+    // IO threads come from the shared, possibly pinned, executor.
+    server_->start(nullptr, nullptr, nullptr, server_context_->IoExecutor());
     server_context_->MarkedHttpServerInitedDone();
   }
-  void Shutdown() { server_->stop(); }
+  void Shutdown() {
+    if (http3_server_) {
+      http3_server_->Shutdown();
+    }
+    server_->stop();
+  }
 
  private:
   std::shared_ptr<proxygen::HTTPServer> server_;
+  std::unique_ptr<Http3Server> http3_server_;
   std::shared_ptr<ServerContext> server_context_;
 };
 
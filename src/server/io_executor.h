@@ -0,0 +1,71 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_IO_EXECUTOR_H_
+#define TBOX_SERVER_IO_EXECUTOR_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "folly/executors/IOThreadPoolExecutor.h"
+#include "folly/executors/thread_factory/NamedThreadFactory.h"
+#include "src/server/thread_model.h"
+
+namespace tbox {
+namespace server {
+
+/// @brief Names threads like NamedThreadFactory and pins the n-th thread it
+///        creates to cpu_for(n); a negative CPU leaves the thread unpinned.
+class PinnedThreadFactory final : public folly::NamedThreadFactory {
+ public:
+  PinnedThreadFactory(const std::string& prefix,
+                      std::function<int(size_t)> cpu_for)
+      : folly::NamedThreadFactory(prefix), cpu_for_(std::move(cpu_for)) {}
+
+  std::thread newThread(folly::Func&& func) override {
+    const int cpu = cpu_for_(next_.fetch_add(1));
+    return folly::NamedThreadFactory::newThread(
+        [cpu, func = std::move(func)]() mutable {
+          PinCurrentThread(cpu);
+          func();
+        });
+  }
+
+ private:
+  const std::function<int(size_t)> cpu_for_;
+  std::atomic<size_t> next_{0};
+};
+
+/// @brief IO executor sized and pinned by the thread model. proxygen runs
+///        its acceptors and connections on it, and with shared_executor the
+///        gRPC event queues are drained on it as well.
+inline std::shared_ptr<folly::IOThreadPoolExecutor> MakeIoExecutor(
+    const ThreadModel& model) {
+  return std::make_shared<folly::IOThreadPoolExecutor>(
+      model.http_io_threads,
+      std::make_shared<PinnedThreadFactory>(
+          "HTTPSrvExec", [model](size_t i) { return model.HttpIoCpu(i); }));
+}
+
+/// @brief Event scheduler that drains the gRPC event queues on executor,
+///        for Server::Builder::SetEventScheduler with shared_executor.
+/// @details A drain handed to the executor must still run at shutdown, so
+///          the gRPC server, which waits for scheduled drains, has to be
+///          shut down before the HTTP server stops and joins the executor.
+inline std::function<void(std::function<void()>)> EventScheduler(
+    std::shared_ptr<folly::IOThreadPoolExecutor> executor) {
+  return [executor = std::move(executor)](std::function<void()> task) {
+    executor->add(std::move(task));
+  };
+}
+
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_IO_EXECUTOR_H_
@@ -0,0 +1,98 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/server/io_executor.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/async_grpc/rpc.h"
+
+namespace tbox {
+namespace server {
+namespace {
+
+using async_grpc::Rpc;
+
+struct QueueState {
+  std::atomic<int> active{0};
+  std::atomic<int> handled{0};
+  std::atomic<bool> overlapped{false};
+};
+
+class CountingEvent : public Rpc::EventBase {
+ public:
+  explicit CountingEvent(QueueState* state)
+      : EventBase(Rpc::Event::RESUME), state_(state) {}
+
+  void Handle() override {
+    if (state_->active.fetch_add(1) != 0) {
+      state_->overlapped = true;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(20));
+    state_->active.fetch_sub(1);
+    state_->handled.fetch_add(1);
+  }
+
+ private:
+  QueueState* state_;
+};
+
+// The shutdown sequence of server.cc with shared_executor: the gRPC server
+// drains its queues while the HTTP IO executor still runs the drains it was
+// handed, then the HTTP server joins the executor.
+TEST(IoExecutor, SharedExecutorShutdown) {
+  ThreadModel::Options options;
+  options.http_io_threads = 4;
+  options.event_threads = 3;
+  options.shared_executor = true;
+  const ThreadModel model = ThreadModel::Plan(options, AvailableCpus());
+  ASSERT_TRUE(model.shared_executor);
+  auto executor = MakeIoExecutor(model);
+
+  std::vector<std::shared_ptr<Rpc::EventQueue>> queues;
+  std::vector<std::unique_ptr<QueueState>> states;
+  for (size_t i = 0; i < model.event_threads; ++i) {
+    queues.push_back(std::make_shared<Rpc::EventQueue>());
+    queues.back()->SetScheduler(EventScheduler(executor));
+    states.push_back(std::make_unique<QueueState>());
+  }
+
+  constexpr int kProducers = 4;
+  constexpr int kEvents = 500;
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&] {
+      for (int i = 0; i < kEvents; ++i) {
+        const size_t q = i % queues.size();
+        queues[q]->Push(
+            Rpc::UniqueEventPtr(new CountingEvent(states[q].get())));
+      }
+    });
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+
+  for (auto& queue : queues) {
+    queue->DrainForShutdown();
+  }
+  executor->join();
+
+  int handled = 0;
+  for (const auto& state : states) {
+    EXPECT_FALSE(state->overlapped);
+    handled += state->handled;
+  }
+  EXPECT_EQ(handled, kProducers * kEvents);
+}
+
+}  // namespace
+}  // namespace server
+}  // namespace tbox
@@ -12,7 +12,10 @@
 #include "folly/init/Init.h"
 #include "gflags/gflags.h"
 #include "glog/logging.h"
+#include "src/common/heap.h"
 #include "src/common/logging.h"
+#include "src/common/profiler.h"
+#include "src/impl/admission_controller.h"
 #include "src/impl/cert_manager.h"
 #include "src/impl/config_manager.h"
 #include "src/impl/ddns_manager.h"
@@ -60,12 +63,14 @@ void ShutdownCheckingThread(void) {
     LOG(INFO) << "Certificate manager stopped";
   }
 
-  if (http_server_ptr) {
-    http_server_ptr->Shutdown();
-  }
+  // gRPC first: with shared_executor its event queues drain on the HTTP IO
+  // executor, which stopping the HTTP server joins.
   if (grpc_server_ptr) {
     grpc_server_ptr->Shutdown();
   }
+  if (http_server_ptr) {
+    http_server_ptr->Shutdown();
+  }
   if (vlmcsd_handler_ptr) {
     vlmcsd_handler_ptr->Shutdown();
   }
@@ -99,7 +104,7 @@ int main(int argc, char** argv) {
     return 1;
   }
   tbox::logging::Initialize(argv[0], selected_log_dir,
-                            config_manager->WriteLogs());
+                            config_manager->LoggingOptions());
 
   LOG(INFO) << "Server initializing ...";
   LOG(INFO) << "Git commit: " << GIT_VERSION;
@@ -107,6 +112,17 @@ int main(int argc, char** argv) {
 
   LOG(INFO) << "Configuration initialized successfully";
 
+  // Limits are fixed before either server accepts a request.
+  tbox::impl::AdmissionController::Instance()->Configure(
+      tbox::impl::AdmissionController::FromConfig());
+
+  if (config_manager->HeapProfileSampleBytes() > 0) {
+    tbox::profiler::HeapProfiler::Instance()->SetSampleInterval(
+        static_cast<int64_t>(config_manager->HeapProfileSampleBytes()));
+  }
+  // Heap series are scraped from the start, not from first use.
+  tbox::memory::Heap::ExportMetrics();
+
   // Initialize UserManager to create preset users
   if (!tbox::impl::UserManager::Instance()->Init()) {
     LOG(ERROR) << "Failed to initialize UserManager";
@@ -8,11 +8,15 @@
 
 #include <atomic>
 #include <future>
+#include <memory>
+#include <mutex>
 
 #include "fmt/core.h"
 #include "src/common/logging.h"
 #include "src/async_grpc/execution_context.h"
 #include "src/impl/config_manager.h"
+#include "src/server/io_executor.h"
+#include "src/server/thread_model.h"
 #include "src/server/version_info.h"
 
 namespace tbox {
@@ -20,7 +24,22 @@ namespace server {
 
 class ServerContext : public async_grpc::ExecutionContext {
  public:
-  ServerContext() : is_inited_(false), git_commit_(GIT_VERSION) {}
+  ServerContext()
+      : is_inited_(false),
+        git_commit_(GIT_VERSION),
+        thread_model_(ThreadModel::FromConfig()) {
+    LOG(INFO) << "Thread model: " << thread_model_.ToString();
+  }
+
+  /// @brief Thread counts and CPU placement for the HTTP and gRPC servers.
+  const ThreadModel& thread_model() const { return thread_model_; }
+
+  /// @brief HTTP IO executor, created on first use.
+  std::shared_ptr<folly::IOThreadPoolExecutor> IoExecutor() {
+    std::call_once(io_executor_once_,
+                   [this]() { io_executor_ = MakeIoExecutor(thread_model_); });
+    return io_executor_;
+  }
 
   void MarkedHttpServerInitedDone() {
     LOG(INFO) << "HTTP server started on: "
@@ -47,6 +66,9 @@ class ServerContext : public async_grpc::ExecutionContext {
  private:
   std::atomic_bool is_inited_;
   std::string git_commit_;
+  const ThreadModel thread_model_;
+  std::once_flag io_executor_once_;
+  std::shared_ptr<folly::IOThreadPoolExecutor> io_executor_;
 };
 
 }  // namespace server
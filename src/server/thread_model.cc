@@ -0,0 +1,144 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/server/thread_model.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include <algorithm>
+#include <thread>
+
+#include "fmt/format.h"
+#include "src/impl/config_manager.h"
+
+namespace tbox {
+namespace server {
+
+ThreadModel ThreadModel::Plan(const Options& options,
+                              const std::vector<int>& available_cpus) {
+  ThreadModel model;
+  model.cpus = available_cpus;
+  if (model.cpus.empty()) {
+    model.cpus.push_back(0);
+  }
+  if (options.cpu_budget > 0 && options.cpu_budget < model.cpus.size()) {
+    model.cpus.resize(options.cpu_budget);
+  }
+  const size_t budget = model.cpus.size();
+
+  model.pin_threads = options.pin_threads;
+  model.reuse_port = options.reuse_port;
+  model.shared_executor = options.shared_executor;
+  if (options.http_idle_timeout_ms > 0) {
+    model.http_idle_timeout =
+        std::chrono::milliseconds(options.http_idle_timeout_ms);
+  }
+
+  size_t grpc_threads = std::max<size_t>(1, options.grpc_threads);
+  size_t event_threads = std::max<size_t>(1, options.event_threads);
+  size_t io_threads = options.http_io_threads;
+  if (options.cpu_budget > 0) {
+    const size_t quarter = std::max<size_t>(1, budget / 4);
+    grpc_threads = std::min(grpc_threads, quarter);
+    event_threads = std::min(event_threads, quarter);
+    if (io_threads == 0) {
+      const size_t others =
+          grpc_threads + (options.shared_executor ? 0 : event_threads);
+      io_threads = budget > others ? budget - others : 1;
+    }
+  } else if (io_threads == 0) {
+    io_threads = budget;
+  }
+  if (options.shared_executor) {
+    // One serialized queue per IO thread keeps every thread busy.
+    event_threads = io_threads;
+  }
+  model.http_io_threads = io_threads;
+  model.grpc_threads = grpc_threads;
+  model.event_threads = event_threads;
+  return model;
+}
+
+ThreadModel ThreadModel::FromConfig() {
+  auto config = util::ConfigManager::Instance();
+  Options options;
+  options.cpu_budget = config->CpuBudget();
+  options.http_io_threads = config->HttpIoThreads();
+  options.http_idle_timeout_ms = config->HttpIdleTimeoutMs();
+  options.grpc_threads = config->GrpcThreads();
+  options.event_threads = config->EventThreads();
+  options.pin_threads = config->PinThreads();
+  options.reuse_port = config->ReusePort();
+  options.shared_executor = config->SharedExecutor();
+  return Plan(options, AvailableCpus());
+}
+
+int ThreadModel::HttpIoCpu(size_t i) const {
+  return pin_threads ? cpus[i % cpus.size()] : -1;
+}
+
+int ThreadModel::GrpcCpu(size_t i) const {
+  // gRPC threads take the CPUs after the IO threads, wrapping around.
+  return pin_threads ? cpus[(http_io_threads + i) % cpus.size()] : -1;
+}
+
+std::string ThreadModel::ToString() const {
+  return fmt::format(
+      "cpus: {}, http io threads: {}, grpc threads: {}, event {}: {}, "
+      "pinned: {}, reuse port: {}, idle timeout: {}ms",
+      cpus.size(), http_io_threads, grpc_threads,
+      shared_executor ? "queues on io threads" : "threads", event_threads,
+      pin_threads, reuse_port, http_idle_timeout.count());
+}
+
+std::vector<int> AvailableCpus() {
+  std::vector<int> cpus;
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+  if (cpus.empty()) {
+    const unsigned count = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned cpu = 0; cpu < count; ++cpu) {
+      cpus.push_back(static_cast<int>(cpu));
+    }
+  }
+  return cpus;
+}
+
+bool PinCurrentThread(int cpu) {
+  if (cpu < 0) {
+    return false;
+  }
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+  if (cpu >= 64) {
+    return false;
+  }
+  return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#else
+  // macOS has no hard affinity API.
+  return false;
+#endif
+}
+
+}  // namespace server
+}  // namespace tbox
@@ -0,0 +1,79 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_SERVER_THREAD_MODEL_H_
+#define TBOX_SERVER_THREAD_MODEL_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tbox {
+namespace server {
+
+/// @brief How many threads the HTTP and gRPC servers run and where.
+/// @details With cpu_budget unset every server sizes itself as before
+///          (one HTTP IO thread per CPU plus grpc_threads + event_threads).
+///          With a budget the thread counts are carved out of it: a quarter
+///          each for gRPC completion queue and event threads, the rest for
+///          HTTP IO, or with shared_executor the gRPC events run on the HTTP
+///          IO threads and only the completion queue threads are extra.
+///          Handlers that still block, SQLite user lookups, DNS provider
+///          calls and PBKDF2 on the HTTP /user path, then hold an IO thread
+///          and stall every connection on it, so shared_executor only pays
+///          off when those are rare next to cheap requests.
+struct ThreadModel {
+  struct Options {
+    uint32_t cpu_budget = 0;
+    uint32_t http_io_threads = 0;
+    uint32_t http_idle_timeout_ms = 0;
+    uint32_t grpc_threads = 3;
+    uint32_t event_threads = 5;
+    bool pin_threads = false;
+    bool reuse_port = false;
+    bool shared_executor = false;
+  };
+
+  /// @param available_cpus CPUs this process may run on, see AvailableCpus.
+  static ThreadModel Plan(const Options& options,
+                          const std::vector<int>& available_cpus);
+
+  /// @brief Plan from ConfigManager and the process CPU affinity.
+  static ThreadModel FromConfig();
+
+  /// @brief CPU for HTTP IO thread i, or -1 when threads are not pinned.
+  int HttpIoCpu(size_t i) const;
+
+  /// @brief CPU for gRPC thread i (completion queue threads first, then
+  ///        event threads), or -1 when threads are not pinned.
+  int GrpcCpu(size_t i) const;
+
+  std::string ToString() const;
+
+  std::vector<int> cpus;
+  size_t http_io_threads = 0;
+  size_t grpc_threads = 0;
+  /// Dedicated event threads, or the number of serialized event queues when
+  /// shared_executor is set.
+  size_t event_threads = 0;
+  std::chrono::milliseconds http_idle_timeout{60000};
+  bool pin_threads = false;
+  bool reuse_port = false;
+  bool shared_executor = false;
+};
+
+/// @brief CPUs in the process affinity mask, in ascending order.
+std::vector<int> AvailableCpus();
+
+/// @brief Restrict the calling thread to one CPU.
+/// @return false if cpu < 0 or the platform refused.
+bool PinCurrentThread(int cpu);
+
+}  // namespace server
+}  // namespace tbox
+
+#endif  // TBOX_SERVER_THREAD_MODEL_H_
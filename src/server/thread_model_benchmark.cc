@@ -0,0 +1,138 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+// Latency of short HTTP style tasks while gRPC style handler work runs next
+// to them, for three thread layouts:
+//   Legacy:   one IO thread per CPU plus 5 event threads, unpinned.
+//   Budgeted: ThreadModel::Plan with a CPU budget, dedicated IO and event
+//             pools, pinned.
+//   Shared:   ThreadModel::Plan with shared_executor, handler work runs on
+//             the IO threads, pinned.
+// The argument is the CPU budget; p50 / p99 / max of the short tasks are
+// reported as counters.
+//
+//   bazel run -c opt //src/server:thread_model_benchmark
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "folly/executors/IOThreadPoolExecutor.h"
+#include "folly/executors/thread_factory/NamedThreadFactory.h"
+#include "src/server/io_executor.h"
+#include "src/server/thread_model.h"
+
+namespace tbox {
+namespace server {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kRequests = 20000;
+constexpr auto kRequestWork = std::chrono::microseconds(5);
+constexpr auto kRequestInterval = std::chrono::microseconds(25);
+constexpr auto kEventWork = std::chrono::microseconds(200);
+// One handler task per this many requests.
+constexpr int kRequestsPerEvent = 8;
+
+void Spin(std::chrono::microseconds work) {
+  const auto end = Clock::now() + work;
+  while (Clock::now() < end) {
+  }
+}
+
+enum class Layout { kLegacy, kBudgeted, kShared };
+
+void RunMixedLoad(benchmark::State& state, Layout layout) {
+  const std::vector<int> available = AvailableCpus();
+  ThreadModel::Options options;
+  if (layout != Layout::kLegacy) {
+    options.cpu_budget = static_cast<uint32_t>(state.range(0));
+    options.pin_threads = true;
+    options.shared_executor = layout == Layout::kShared;
+  }
+  const ThreadModel model = ThreadModel::Plan(options, available);
+
+  auto io = MakeIoExecutor(model);
+  std::shared_ptr<folly::IOThreadPoolExecutor> events = io;
+  if (layout != Layout::kShared) {
+    events = std::make_shared<folly::IOThreadPoolExecutor>(
+        model.event_threads,
+        std::make_shared<PinnedThreadFactory>(
+            "BenchEvents", [model](size_t i) {
+              return model.GrpcCpu(model.grpc_threads + i);
+            }));
+  }
+
+  std::vector<int64_t> latency_ns(kRequests);
+  for (auto _ : state) {
+    std::atomic<int> done{0};
+    auto next = Clock::now();
+    for (int i = 0; i < kRequests; ++i) {
+      std::this_thread::sleep_until(next);
+      next += kRequestInterval;
+      const auto submitted = Clock::now();
+      io->add([&latency_ns, &done, submitted, i]() {
+        Spin(kRequestWork);
+        latency_ns[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            Clock::now() - submitted)
+                            .count();
+        done.fetch_add(1, std::memory_order_release);
+      });
+      if (i % kRequestsPerEvent == 0) {
+        events->add([]() { Spin(kEventWork); });
+      }
+    }
+    while (done.load(std::memory_order_acquire) < kRequests) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  events->join();
+  io->join();
+
+  std::sort(latency_ns.begin(), latency_ns.end());
+  state.counters["threads"] = static_cast<double>(
+      model.http_io_threads +
+      (layout == Layout::kShared ? 0 : model.event_threads));
+  state.counters["p50_us"] = latency_ns[kRequests / 2] / 1000.0;
+  state.counters["p99_us"] = latency_ns[kRequests * 99 / 100] / 1000.0;
+  state.counters["max_us"] = latency_ns.back() / 1000.0;
+}
+
+void BM_MixedLoadLegacy(benchmark::State& state) {
+  RunMixedLoad(state, Layout::kLegacy);
+}
+BENCHMARK(BM_MixedLoadLegacy)->Arg(0)->Iterations(1)->UseRealTime();
+
+void BM_MixedLoadBudgeted(benchmark::State& state) {
+  RunMixedLoad(state, Layout::kBudgeted);
+}
+BENCHMARK(BM_MixedLoadBudgeted)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Iterations(1)
+    ->UseRealTime();
+
+void BM_MixedLoadShared(benchmark::State& state) {
+  RunMixedLoad(state, Layout::kShared);
+}
+BENCHMARK(BM_MixedLoadShared)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Iterations(1)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace server
+}  // namespace tbox
+
+BENCHMARK_MAIN();
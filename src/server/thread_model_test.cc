@@ -0,0 +1,100 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/server/thread_model.h"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace server {
+namespace {
+
+std::vector<int> Cpus(int n) {
+  std::vector<int> cpus;
+  for (int i = 0; i < n; ++i) {
+    cpus.push_back(i);
+  }
+  return cpus;
+}
+
+TEST(ThreadModel, LegacyCountsWithoutBudget) {
+  ThreadModel::Options options;
+  ThreadModel model = ThreadModel::Plan(options, Cpus(8));
+  EXPECT_EQ(model.cpus.size(), 8);
+  EXPECT_EQ(model.http_io_threads, 8);
+  EXPECT_EQ(model.grpc_threads, 3);
+  EXPECT_EQ(model.event_threads, 5);
+  EXPECT_EQ(model.http_idle_timeout.count(), 60000);
+  EXPECT_EQ(model.HttpIoCpu(0), -1);
+}
+
+TEST(ThreadModel, BudgetIsNotOversubscribed) {
+  ThreadModel::Options options;
+  options.cpu_budget = 8;
+  ThreadModel model = ThreadModel::Plan(options, Cpus(32));
+  EXPECT_EQ(model.cpus.size(), 8);
+  EXPECT_EQ(model.grpc_threads, 2);
+  EXPECT_EQ(model.event_threads, 2);
+  EXPECT_EQ(model.http_io_threads, 4);
+
+  // A small box still gets one thread of each kind.
+  options.cpu_budget = 2;
+  model = ThreadModel::Plan(options, Cpus(32));
+  EXPECT_EQ(model.grpc_threads, 1);
+  EXPECT_EQ(model.event_threads, 1);
+  EXPECT_EQ(model.http_io_threads, 1);
+
+  // The budget cannot exceed the CPUs the process may use.
+  options.cpu_budget = 64;
+  model = ThreadModel::Plan(options, Cpus(4));
+  EXPECT_EQ(model.cpus.size(), 4);
+}
+
+TEST(ThreadModel, SharedExecutor) {
+  ThreadModel::Options options;
+  options.cpu_budget = 8;
+  options.shared_executor = true;
+  ThreadModel model = ThreadModel::Plan(options, Cpus(8));
+  EXPECT_EQ(model.grpc_threads, 2);
+  EXPECT_EQ(model.http_io_threads, 6);
+  EXPECT_EQ(model.event_threads, 6);
+
+  options.http_io_threads = 3;
+  model = ThreadModel::Plan(options, Cpus(8));
+  EXPECT_EQ(model.http_io_threads, 3);
+  EXPECT_EQ(model.event_threads, 3);
+}
+
+TEST(ThreadModel, PinningFollowsAffinityMask) {
+  ThreadModel::Options options;
+  options.cpu_budget = 4;
+  options.pin_threads = true;
+  options.http_idle_timeout_ms = 5000;
+  ThreadModel model = ThreadModel::Plan(options, {2, 3, 6, 7, 9});
+  ASSERT_EQ(model.cpus, (std::vector<int>{2, 3, 6, 7}));
+  ASSERT_EQ(model.http_io_threads, 2);
+  EXPECT_EQ(model.HttpIoCpu(0), 2);
+  EXPECT_EQ(model.HttpIoCpu(1), 3);
+  EXPECT_EQ(model.GrpcCpu(0), 6);
+  EXPECT_EQ(model.GrpcCpu(1), 7);
+  EXPECT_EQ(model.GrpcCpu(2), 2);
+  EXPECT_EQ(model.http_idle_timeout.count(), 5000);
+}
+
+TEST(ThreadModel, PinCurrentThread) {
+  EXPECT_FALSE(PinCurrentThread(-1));
+  const std::vector<int> cpus = AvailableCpus();
+  ASSERT_FALSE(cpus.empty());
+#if defined(__linux__)
+  std::thread([&]() { EXPECT_TRUE(PinCurrentThread(cpus.back())); }).join();
+#endif
+}
+
+}  // namespace
+}  // namespace server
+}  // namespace tbox
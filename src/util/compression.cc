@@ -0,0 +1,409 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/util/compression.h"
+
+#include <algorithm>
+#include <cstring>
+
+#define LZ4_STATIC_LINKING_ONLY
+#include "lz4.h"
+#include "lz4hc.h"
+#include "src/common/logging.h"
+#include "zdict.h"
+#include "zlib.h"
+#include "zstd.h"
+
+namespace tbox {
+namespace util {
+
+namespace {
+
+// Trailer removed from / appended to permessage-deflate payloads.
+constexpr char kDeflateTail[4] = {0x00, 0x00, static_cast<char>(0xff),
+                                  static_cast<char>(0xff)};
+
+// LZ4 matches reach back at most 64KB.
+constexpr size_t kLz4DictSize = 64 * 1024;
+
+// Contexts are expensive to create, keep one set per thread.
+struct CodecContexts {
+  CodecContexts()
+      : zstd_cctx(ZSTD_createCCtx()),
+        zstd_dctx(ZSTD_createDCtx()),
+        lz4_stream(LZ4_createStream()) {
+    std::memset(&deflate, 0, sizeof(deflate));
+    std::memset(&inflate, 0, sizeof(inflate));
+  }
+
+  ~CodecContexts() {
+    ZSTD_freeCCtx(zstd_cctx);
+    ZSTD_freeDCtx(zstd_dctx);
+    LZ4_freeStream(lz4_stream);
+    if (deflate_level != kNoDeflate) {
+      deflateEnd(&deflate);
+    }
+    if (inflate_inited) {
+      inflateEnd(&inflate);
+    }
+  }
+
+  static constexpr int kNoDeflate = -2;
+
+  ZSTD_CCtx* zstd_cctx;
+  ZSTD_DCtx* zstd_dctx;
+  LZ4_stream_t* lz4_stream;
+  z_stream deflate;
+  int deflate_level = kNoDeflate;
+  z_stream inflate;
+  bool inflate_inited = false;
+};
+
+CodecContexts& Contexts() {
+  thread_local CodecContexts contexts;
+  return contexts;
+}
+
+void PutLE32(uint32_t v, char* out) {
+  for (int i = 0; i < 4; ++i) {
+    out[i] = static_cast<char>(v >> (8 * i));
+  }
+}
+
+uint32_t GetLE32(const char* in) {
+  uint32_t v = 0;
+  for (int i = 0; i < 4; ++i) {
+    v |= static_cast<uint32_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+  }
+  return v;
+}
+
+bool ZstdCompress(std::string_view input, std::string* out, int level,
+                  const CompressionDictionary* dict, ZSTD_CDict* cdict) {
+  auto* cctx = Contexts().zstd_cctx;
+  out->resize(ZSTD_compressBound(input.size()));
+  size_t ret;
+  if (dict && cdict) {
+    ret = ZSTD_compress_usingCDict(cctx, out->data(), out->size(),
+                                   input.data(), input.size(), cdict);
+  } else {
+    ret = ZSTD_compressCCtx(cctx, out->data(), out->size(), input.data(),
+                            input.size(), level ? level : ZSTD_CLEVEL_DEFAULT);
+  }
+  if (ZSTD_isError(ret)) {
+    LOG(ERROR) << "zstd compress error: " << ZSTD_getErrorName(ret);
+    return false;
+  }
+  out->resize(ret);
+  return true;
+}
+
+bool ZstdDecompress(std::string_view input, std::string* out, size_t max_size,
+                    ZSTD_DDict* ddict) {
+  const auto size = ZSTD_getFrameContentSize(input.data(), input.size());
+  if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN ||
+      size > max_size) {
+    LOG(ERROR) << "Invalid zstd frame content size: " << size;
+    return false;
+  }
+  auto* dctx = Contexts().zstd_dctx;
+  out->resize(size);
+  size_t ret;
+  if (ddict) {
+    ret = ZSTD_decompress_usingDDict(dctx, out->data(), out->size(),
+                                     input.data(), input.size(), ddict);
+  } else {
+    ret = ZSTD_decompressDCtx(dctx, out->data(), out->size(), input.data(),
+                              input.size());
+  }
+  if (ZSTD_isError(ret) || ret != size) {
+    LOG(ERROR) << "zstd decompress error: " << ZSTD_getErrorName(ret);
+    return false;
+  }
+  return true;
+}
+
+// LZ4 blocks do not record their decompressed size, prefix it as LE32.
+bool Lz4Compress(std::string_view input, std::string* out, int level,
+                 LZ4_stream_t* dict_stream) {
+  if (input.size() > LZ4_MAX_INPUT_SIZE) {
+    return false;
+  }
+  const int src_size = static_cast<int>(input.size());
+  const int bound = LZ4_compressBound(src_size);
+  out->resize(4 + bound);
+  PutLE32(static_cast<uint32_t>(input.size()), out->data());
+  char* dst = out->data() + 4;
+  int ret;
+  if (dict_stream) {
+    auto* stream = Contexts().lz4_stream;
+    LZ4_resetStream_fast(stream);
+    LZ4_attach_dictionary(stream, dict_stream);
+    ret = LZ4_compress_fast_continue(stream, input.data(), dst, src_size,
+                                     bound, 1);
+  } else if (level > 1) {
+    ret = LZ4_compress_HC(input.data(), dst, src_size, bound, level);
+  } else {
+    ret = LZ4_compress_default(input.data(), dst, src_size, bound);
+  }
+  if (ret <= 0) {
+    LOG(ERROR) << "lz4 compress error";
+    return false;
+  }
+  out->resize(4 + ret);
+  return true;
+}
+
+bool Lz4Decompress(std::string_view input, std::string* out, size_t max_size,
+                   std::string_view dict) {
+  if (input.size() < 4) {
+    return false;
+  }
+  const uint32_t size = GetLE32(input.data());
+  if (size > max_size || size > LZ4_MAX_INPUT_SIZE) {
+    LOG(ERROR) << "Invalid lz4 content size: " << size;
+    return false;
+  }
+  out->resize(size);
+  int ret;
+  if (!dict.empty()) {
+    ret = LZ4_decompress_safe_usingDict(
+        input.data() + 4, out->data(), static_cast<int>(input.size() - 4),
+        static_cast<int>(size), dict.data(), static_cast<int>(dict.size()));
+  } else {
+    ret = LZ4_decompress_safe(input.data() + 4, out->data(),
+                              static_cast<int>(input.size() - 4),
+                              static_cast<int>(size));
+  }
+  if (ret < 0 || static_cast<uint32_t>(ret) != size) {
+    LOG(ERROR) << "lz4 decompress error";
+    return false;
+  }
+  return true;
+}
+
+bool DeflateCompress(std::string_view input, std::string* out, int level) {
+  auto& ctx = Contexts();
+  const int z_level = level ? level : Z_DEFAULT_COMPRESSION;
+  if (ctx.deflate_level != z_level) {
+    if (ctx.deflate_level != CodecContexts::kNoDeflate) {
+      deflateEnd(&ctx.deflate);
+      ctx.deflate_level = CodecContexts::kNoDeflate;
+    }
+    if (deflateInit2(&ctx.deflate, z_level, Z_DEFLATED, -MAX_WBITS, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+      return false;
+    }
+    ctx.deflate_level = z_level;
+  } else {
+    deflateReset(&ctx.deflate);
+  }
+
+  out->resize(deflateBound(&ctx.deflate, input.size()) + 16);
+  ctx.deflate.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  ctx.deflate.avail_in = static_cast<uInt>(input.size());
+  ctx.deflate.next_out = reinterpret_cast<Bytef*>(out->data());
+  ctx.deflate.avail_out = static_cast<uInt>(out->size());
+  if (deflate(&ctx.deflate, Z_SYNC_FLUSH) != Z_OK ||
+      ctx.deflate.avail_in != 0) {
+    LOG(ERROR) << "deflate error";
+    return false;
+  }
+  size_t size = out->size() - ctx.deflate.avail_out;
+  if (size >= 4 &&
+      std::memcmp(out->data() + size - 4, kDeflateTail, 4) == 0) {
+    size -= 4;
+  }
+  out->resize(size);
+  return true;
+}
+
+bool DeflateDecompress(std::string_view input, std::string* out,
+                       size_t max_size) {
+  auto& ctx = Contexts();
+  if (!ctx.inflate_inited) {
+    if (inflateInit2(&ctx.inflate, -MAX_WBITS) != Z_OK) {
+      return false;
+    }
+    ctx.inflate_inited = true;
+  } else {
+    inflateReset(&ctx.inflate);
+  }
+
+  out->clear();
+  char buffer[16 * 1024];
+  for (const std::string_view chunk :
+       {input, std::string_view(kDeflateTail, sizeof(kDeflateTail))}) {
+    ctx.inflate.next_in =
+        reinterpret_cast<Bytef*>(const_cast<char*>(chunk.data()));
+    ctx.inflate.avail_in = static_cast<uInt>(chunk.size());
+    while (ctx.inflate.avail_in > 0) {
+      ctx.inflate.next_out = reinterpret_cast<Bytef*>(buffer);
+      ctx.inflate.avail_out = sizeof(buffer);
+      const int ret = inflate(&ctx.inflate, Z_SYNC_FLUSH);
+      if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+        LOG(ERROR) << "inflate error: " << ret;
+        return false;
+      }
+      const size_t produced = sizeof(buffer) - ctx.inflate.avail_out;
+      if (out->size() + produced > max_size) {
+        LOG(ERROR) << "Inflated payload exceeds " << max_size;
+        return false;
+      }
+      out->append(buffer, produced);
+      if (ret == Z_STREAM_END || (ret == Z_BUF_ERROR && produced == 0)) {
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+const char* CompressionCodecName(CompressionCodec codec) {
+  switch (codec) {
+    case CompressionCodec::kZstd:
+      return "zstd";
+    case CompressionCodec::kLz4:
+      return "lz4";
+    case CompressionCodec::kDeflate:
+      return "deflate";
+    case CompressionCodec::kNone:
+    default:
+      return "none";
+  }
+}
+
+bool ParseCompressionCodec(std::string_view name, CompressionCodec* codec) {
+  std::string lower(name);
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  for (const auto c : {CompressionCodec::kNone, CompressionCodec::kZstd,
+                       CompressionCodec::kLz4, CompressionCodec::kDeflate}) {
+    if (lower == CompressionCodecName(c)) {
+      *codec = c;
+      return true;
+    }
+  }
+  return false;
+}
+
+CompressionDictionary::CompressionDictionary(std::string content, int level)
+    : content_(std::move(content)) {
+  if (content_.empty()) {
+    return;
+  }
+  id_ = ZDICT_getDictID(content_.data(), content_.size());
+  cdict_ = ZSTD_createCDict(content_.data(), content_.size(), level);
+  ddict_ = ZSTD_createDDict(content_.data(), content_.size());
+  auto* stream = LZ4_createStream();
+  // LZ4 only looks back 64KB, the tail of the dictionary is what matters.
+  const size_t lz4_size = std::min<size_t>(content_.size(), kLz4DictSize);
+  LZ4_loadDict(stream, content_.data() + content_.size() - lz4_size,
+               static_cast<int>(lz4_size));
+  lz4_dict_ = stream;
+}
+
+CompressionDictionary::~CompressionDictionary() {
+  ZSTD_freeCDict(static_cast<ZSTD_CDict*>(cdict_));
+  ZSTD_freeDDict(static_cast<ZSTD_DDict*>(ddict_));
+  LZ4_freeStream(static_cast<LZ4_stream_t*>(lz4_dict_));
+}
+
+std::string CompressionDictionary::Train(
+    const std::vector<std::string>& samples, size_t dict_size) {
+  std::string buffer;
+  std::vector<size_t> sizes;
+  sizes.reserve(samples.size());
+  for (const auto& sample : samples) {
+    buffer.append(sample);
+    sizes.push_back(sample.size());
+  }
+  std::string dict(dict_size, '\0');
+  const size_t ret =
+      ZDICT_trainFromBuffer(dict.data(), dict.size(), buffer.data(),
+                            sizes.data(), static_cast<unsigned>(sizes.size()));
+  if (ZDICT_isError(ret)) {
+    LOG(ERROR) << "Dictionary training failed: " << ZDICT_getErrorName(ret);
+    return "";
+  }
+  dict.resize(ret);
+  return dict;
+}
+
+bool Compression::Compress(CompressionCodec codec, std::string_view input,
+                           std::string* out, int level,
+                           const CompressionDictionary* dict) {
+  if (dict && dict->Content().empty()) {
+    dict = nullptr;
+  }
+  switch (codec) {
+    case CompressionCodec::kNone:
+      out->assign(input);
+      return true;
+    case CompressionCodec::kZstd:
+      return ZstdCompress(input, out, level, dict,
+                          dict ? static_cast<ZSTD_CDict*>(dict->cdict_)
+                               : nullptr);
+    case CompressionCodec::kLz4:
+      return Lz4Compress(
+          input, out, level,
+          dict ? static_cast<LZ4_stream_t*>(dict->lz4_dict_) : nullptr);
+    case CompressionCodec::kDeflate:
+      return DeflateCompress(input, out, level);
+  }
+  return false;
+}
+
+bool Compression::Decompress(CompressionCodec codec, std::string_view input,
+                             std::string* out, size_t max_size,
+                             const CompressionDictionary* dict) {
+  if (dict && dict->Content().empty()) {
+    dict = nullptr;
+  }
+  switch (codec) {
+    case CompressionCodec::kNone:
+      if (input.size() > max_size) {
+        return false;
+      }
+      out->assign(input);
+      return true;
+    case CompressionCodec::kZstd:
+      return ZstdDecompress(
+          input, out, max_size,
+          dict ? static_cast<ZSTD_DDict*>(dict->ddict_) : nullptr);
+    case CompressionCodec::kLz4: {
+      if (!dict) {
+        return Lz4Decompress(input, out, max_size, {});
+      }
+      const std::string_view content = dict->Content();
+      return Lz4Decompress(input, out, max_size,
+                           content.substr(content.size() -
+                                          std::min<size_t>(content.size(),
+                                                           kLz4DictSize)));
+    }
+    case CompressionCodec::kDeflate:
+      return DeflateDecompress(input, out, max_size);
+  }
+  return false;
+}
+
+CompressionCodec Compression::Negotiate(
+    const std::vector<std::string>& offered,
+    const std::vector<CompressionCodec>& preferred) {
+  for (const auto codec : preferred) {
+    for (const auto& name : offered) {
+      CompressionCodec parsed;
+      if (ParseCompressionCodec(name, &parsed) && parsed == codec) {
+        return codec;
+      }
+    }
+  }
+  return CompressionCodec::kNone;
+}
+
+}  // namespace util
+}  // namespace tbox
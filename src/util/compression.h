@@ -0,0 +1,102 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_UTIL_COMPRESSION_H_
+#define TBOX_UTIL_COMPRESSION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tbox {
+namespace util {
+
+/// @brief Codecs usable for online (per message) compression.
+/// @details kDeflate produces permessage-deflate payloads (RFC 7692, raw
+///          deflate with the trailing empty block removed), which browsers
+///          understand. kZstd and kLz4 are much faster at a similar or better
+///          ratio and are preferred when both peers support them.
+enum class CompressionCodec {
+  kNone = 0,
+  kZstd = 1,
+  kLz4 = 2,
+  kDeflate = 3,
+};
+
+/// @brief Textual codec name, "none", "zstd", "lz4" or "deflate".
+const char* CompressionCodecName(CompressionCodec codec);
+
+/// @brief Parse a codec name, case insensitive.
+bool ParseCompressionCodec(std::string_view name, CompressionCodec* codec);
+
+/// @brief Pre-trained dictionary shared by both peers.
+/// @details Small protobuf and JSON messages barely compress on their own
+///          since every message has to re-learn field names and common
+///          values. A dictionary trained on representative samples primes
+///          the codec with that content. The digested zstd dictionaries are
+///          built once here and reused for every message.
+class CompressionDictionary final {
+ public:
+  /// @brief Wrap raw dictionary content, as produced by Train().
+  /// @param level zstd compression level baked into the digested dictionary.
+  explicit CompressionDictionary(std::string content, int level = 3);
+  ~CompressionDictionary();
+  CompressionDictionary(const CompressionDictionary&) = delete;
+  CompressionDictionary& operator=(const CompressionDictionary&) = delete;
+
+  /// @brief Train a dictionary of at most dict_size bytes from samples.
+  /// @return Dictionary content, empty on failure (e.g. too few samples).
+  static std::string Train(const std::vector<std::string>& samples,
+                           size_t dict_size);
+
+  const std::string& Content() const { return content_; }
+
+  /// @brief zstd dictionary id, 0 for raw content dictionaries.
+  uint32_t Id() const { return id_; }
+
+ private:
+  friend class Compression;
+  std::string content_;
+  uint32_t id_ = 0;
+  void* cdict_ = nullptr;     // ZSTD_CDict*
+  void* ddict_ = nullptr;     // ZSTD_DDict*
+  void* lz4_dict_ = nullptr;  // LZ4_stream_t* with the dictionary loaded
+};
+
+/// @brief One-shot message compression with thread local codec contexts.
+class Compression final {
+ public:
+  /// Inputs below this size are not worth compressing.
+  static constexpr size_t kMinCompressSize = 64;
+
+  /// @brief Compress input with codec.
+  /// @param level Codec level, 0 for the codec default.
+  /// @param dict Optional dictionary, ignored by kDeflate.
+  static bool Compress(CompressionCodec codec, std::string_view input,
+                       std::string* out, int level = 0,
+                       const CompressionDictionary* dict = nullptr);
+
+  /// @brief Decompress input produced by Compress().
+  /// @param max_size Refuse to produce more than this many bytes.
+  static bool Decompress(CompressionCodec codec, std::string_view input,
+                         std::string* out, size_t max_size,
+                         const CompressionDictionary* dict = nullptr);
+
+  /// @brief Pick the first codec of preferred that the peer offered.
+  /// @param offered Codec names announced by the peer.
+  static CompressionCodec Negotiate(
+      const std::vector<std::string>& offered,
+      const std::vector<CompressionCodec>& preferred = {
+          CompressionCodec::kZstd, CompressionCodec::kLz4,
+          CompressionCodec::kDeflate});
+};
+
+}  // namespace util
+}  // namespace tbox
+
+#endif  // TBOX_UTIL_COMPRESSION_H_
@@ -0,0 +1,109 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+// Ratio and throughput of the online compression codecs on payloads shaped
+// like our traffic: a single small client record (typical WebSocket / RPC
+// message) and a large ServerResponse style client list.
+//
+//   bazel run -c opt //src/util:compression_benchmark
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/util/compression.h"
+
+namespace tbox {
+namespace util {
+namespace {
+
+std::string ClientJson(int i) {
+  return "{\"client_id\":\"client-" + std::to_string(i) +
+         "\",\"client_ip\":[\"192.168.1." + std::to_string(i % 250) +
+         "\",\"2001:db8::" + std::to_string(i) +
+         "\"],\"timestamp\":" + std::to_string(1700000000 + i * 37) +
+         ",\"client_info\":\"linux x86_64\",\"monitor_domains\":[\"host" +
+         std::to_string(i % 7) + ".example.com\"]}";
+}
+
+std::string Payload(int64_t kind) {
+  if (kind == 0) {
+    return ClientJson(123456);
+  }
+  std::string list = "[";
+  for (int i = 0; i < 5000; ++i) {
+    list += ClientJson(i);
+    list += ",";
+  }
+  list.back() = ']';
+  return list;
+}
+
+const CompressionDictionary* Dictionary() {
+  static const auto* dict = [] {
+    std::vector<std::string> samples;
+    for (int i = 0; i < 2000; ++i) {
+      samples.push_back(ClientJson(i * 13));
+    }
+    return new CompressionDictionary(
+        CompressionDictionary::Train(samples, 16 * 1024));
+  }();
+  return dict;
+}
+
+// Args: codec, payload kind (0 small, 1 large), use dictionary.
+void BM_Compress(benchmark::State& state) {
+  const auto codec = static_cast<CompressionCodec>(state.range(0));
+  const std::string input = Payload(state.range(1));
+  const auto* dict = state.range(2) ? Dictionary() : nullptr;
+  std::string out;
+  for (auto _ : state) {
+    Compression::Compress(codec, input, &out, 0, dict);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+  state.counters["ratio"] =
+      static_cast<double>(input.size()) / std::max<size_t>(out.size(), 1);
+  state.SetLabel(std::string(CompressionCodecName(codec)) +
+                 (dict ? "+dict" : ""));
+}
+
+void BM_Decompress(benchmark::State& state) {
+  const auto codec = static_cast<CompressionCodec>(state.range(0));
+  const std::string input = Payload(state.range(1));
+  const auto* dict = state.range(2) ? Dictionary() : nullptr;
+  std::string compressed;
+  Compression::Compress(codec, input, &compressed, 0, dict);
+  std::string out;
+  for (auto _ : state) {
+    Compression::Decompress(codec, compressed, &out, input.size(), dict);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+  state.SetLabel(std::string(CompressionCodecName(codec)) +
+                 (dict ? "+dict" : ""));
+}
+
+void CodecArgs(benchmark::internal::Benchmark* b) {
+  for (const auto codec : {CompressionCodec::kZstd, CompressionCodec::kLz4,
+                           CompressionCodec::kDeflate}) {
+    for (const int kind : {0, 1}) {
+      b->Args({static_cast<int64_t>(codec), kind, 0});
+      if (codec != CompressionCodec::kDeflate) {
+        b->Args({static_cast<int64_t>(codec), kind, 1});
+      }
+    }
+  }
+}
+
+BENCHMARK(BM_Compress)->Apply(CodecArgs);
+BENCHMARK(BM_Decompress)->Apply(CodecArgs);
+
+}  // namespace
+}  // namespace util
+}  // namespace tbox
+
+BENCHMARK_MAIN();
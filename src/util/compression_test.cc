@@ -0,0 +1,99 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/util/compression.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace util {
+namespace {
+
+std::string ClientJson(int i) {
+  return "{\"client_id\":\"client-" + std::to_string(i) +
+         "\",\"client_ip\":[\"192.168.1." + std::to_string(i % 250) +
+         "\",\"2001:db8::" + std::to_string(i) +
+         "\"],\"timestamp\":" + std::to_string(1700000000 + i * 37) +
+         ",\"client_info\":\"linux x86_64\",\"monitor_domains\":[\"host" +
+         std::to_string(i % 7) + ".example.com\"]}";
+}
+
+constexpr CompressionCodec kCodecs[] = {
+    CompressionCodec::kNone, CompressionCodec::kZstd, CompressionCodec::kLz4,
+    CompressionCodec::kDeflate};
+
+TEST(Compression, RoundTrip) {
+  std::string large;
+  for (int i = 0; i < 2000; ++i) {
+    large += ClientJson(i);
+  }
+  for (const auto codec : kCodecs) {
+    for (const std::string& input : {std::string(), std::string("x"), large}) {
+      std::string compressed;
+      std::string out;
+      ASSERT_TRUE(Compression::Compress(codec, input, &compressed))
+          << CompressionCodecName(codec);
+      ASSERT_TRUE(
+          Compression::Decompress(codec, compressed, &out, input.size()))
+          << CompressionCodecName(codec);
+      EXPECT_EQ(out, input) << CompressionCodecName(codec);
+      if (codec != CompressionCodec::kNone && input == large) {
+        EXPECT_LT(compressed.size(), input.size() / 4);
+      }
+    }
+  }
+}
+
+TEST(Compression, RejectsOversizedOutput) {
+  const std::string input(10000, 'a');
+  for (const auto codec : kCodecs) {
+    std::string compressed;
+    std::string out;
+    ASSERT_TRUE(Compression::Compress(codec, input, &compressed));
+    EXPECT_FALSE(Compression::Decompress(codec, compressed, &out, 100))
+        << CompressionCodecName(codec);
+  }
+}
+
+TEST(Compression, DictionaryHelpsSmallMessages) {
+  std::vector<std::string> samples;
+  for (int i = 0; i < 1000; ++i) {
+    samples.push_back(ClientJson(i));
+  }
+  const std::string content = CompressionDictionary::Train(samples, 4096);
+  ASSERT_FALSE(content.empty());
+  CompressionDictionary dict(content);
+  EXPECT_NE(dict.Id(), 0);
+
+  const std::string message = ClientJson(4242);
+  for (const auto codec : {CompressionCodec::kZstd, CompressionCodec::kLz4}) {
+    std::string plain;
+    std::string primed;
+    std::string out;
+    ASSERT_TRUE(Compression::Compress(codec, message, &plain));
+    ASSERT_TRUE(Compression::Compress(codec, message, &primed, 0, &dict));
+    EXPECT_LT(primed.size(), plain.size()) << CompressionCodecName(codec);
+    ASSERT_TRUE(Compression::Decompress(codec, primed, &out, message.size(),
+                                        &dict));
+    EXPECT_EQ(out, message);
+  }
+}
+
+TEST(Compression, Negotiate) {
+  EXPECT_EQ(Compression::Negotiate({"gzip", "LZ4", "zstd"}),
+            CompressionCodec::kZstd);
+  EXPECT_EQ(Compression::Negotiate({"deflate", "lz4"}),
+            CompressionCodec::kLz4);
+  EXPECT_EQ(Compression::Negotiate({"br"}), CompressionCodec::kNone);
+  EXPECT_EQ(Compression::Negotiate({"zstd"}, {CompressionCodec::kLz4}),
+            CompressionCodec::kNone);
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tbox
@@ -0,0 +1,45 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/util/io_buffer.h"
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#include "src/common/heap.h"
+
+namespace tbox {
+namespace util {
+namespace {
+
+// The capacity travels in user_data, Heap::Free() needs it.
+void FreeIoBuffer(void* buf, void* user_data) {
+  memory::Heap::Free(memory::HeapId::kIoBuffers, buf,
+                     reinterpret_cast<uintptr_t>(user_data));
+}
+
+}  // namespace
+
+std::unique_ptr<folly::IOBuf> NewIoBuffer(size_t capacity) {
+  void* data = memory::Heap::Allocate(memory::HeapId::kIoBuffers, capacity);
+  if (data == nullptr) {
+    throw std::bad_alloc();
+  }
+  return folly::IOBuf::takeOwnership(data, capacity, 0, FreeIoBuffer,
+                                     reinterpret_cast<void*>(capacity));
+}
+
+std::unique_ptr<folly::IOBuf> CopyIoBuffer(std::string_view data) {
+  auto buf = NewIoBuffer(data.size());
+  if (!data.empty()) {
+    memcpy(buf->writableData(), data.data(), data.size());
+  }
+  buf->append(data.size());
+  return buf;
+}
+
+}  // namespace util
+}  // namespace tbox
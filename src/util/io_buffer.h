@@ -0,0 +1,31 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_UTIL_IO_BUFFER_H_
+#define TBOX_UTIL_IO_BUFFER_H_
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+#include "folly/io/IOBuf.h"
+
+namespace tbox {
+namespace util {
+
+/// @brief An empty IOBuf with room for capacity bytes, on the IO buffer
+///        heap (see memory::Heap). Use it for data handed to proxygen, so
+///        that outgoing frames and bodies do not fragment the pages of
+///        longer lived objects.
+std::unique_ptr<folly::IOBuf> NewIoBuffer(size_t capacity);
+
+/// @brief A copy of data on the IO buffer heap; folly::IOBuf::copyBuffer()
+///        on the global heap otherwise.
+std::unique_ptr<folly::IOBuf> CopyIoBuffer(std::string_view data);
+
+}  // namespace util
+}  // namespace tbox
+
+#endif  // TBOX_UTIL_IO_BUFFER_H_
@@ -0,0 +1,49 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/util/io_buffer.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "src/common/heap.h"
+
+namespace tbox {
+namespace util {
+namespace {
+
+TEST(IoBuffer, CopyIoBuffer) {
+  const memory::Heap::Stats before =
+      memory::Heap::GetStats(memory::HeapId::kIoBuffers);
+  const std::string frame(1000, 'x');
+  auto buf = CopyIoBuffer(frame);
+  EXPECT_EQ(std::string(reinterpret_cast<const char*>(buf->data()),
+                        buf->length()),
+            frame);
+
+  buf = CopyIoBuffer("");
+  EXPECT_EQ(buf->length(), 0u);
+  buf.reset();
+
+  const memory::Heap::Stats stats =
+      memory::Heap::GetStats(memory::HeapId::kIoBuffers);
+  EXPECT_EQ(stats.allocations - before.allocations, 2u);
+  EXPECT_EQ(stats.frees - before.frees, 2u);
+  EXPECT_EQ(stats.allocated_bytes - before.allocated_bytes, 1000u);
+  EXPECT_EQ(stats.freed_bytes - before.freed_bytes, 1000u);
+}
+
+TEST(IoBuffer, NewIoBuffer) {
+  auto buf = NewIoBuffer(64);
+  EXPECT_EQ(buf->length(), 0u);
+  EXPECT_GE(buf->tailroom(), 64u);
+  buf->writableTail()[0] = 'a';
+  buf->append(1);
+  EXPECT_EQ(buf->length(), 1u);
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tbox
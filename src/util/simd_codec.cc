@@ -0,0 +1,561 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/util/simd_codec.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TBOX_SIMD_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define TBOX_TARGET_AVX2
+#else
+#define TBOX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define TBOX_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace tbox {
+namespace util {
+
+namespace {
+
+constexpr char kHexLower[] = "0123456789abcdef";
+constexpr char kHexUpper[] = "0123456789ABCDEF";
+constexpr char kBase64[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Reverse tables, 0xff marks characters outside the alphabet.
+constexpr std::array<uint8_t, 256> HexValues() {
+  std::array<uint8_t, 256> t{};
+  for (auto& v : t) {
+    v = 0xff;
+  }
+  for (int i = 0; i < 16; ++i) {
+    t[static_cast<uint8_t>(kHexLower[i])] = i;
+    t[static_cast<uint8_t>(kHexUpper[i])] = i;
+  }
+  return t;
+}
+
+constexpr std::array<uint8_t, 256> Base64Values() {
+  std::array<uint8_t, 256> t{};
+  for (auto& v : t) {
+    v = 0xff;
+  }
+  for (int i = 0; i < 64; ++i) {
+    t[static_cast<uint8_t>(kBase64[i])] = i;
+  }
+  return t;
+}
+
+constexpr std::array<uint8_t, 256> kHexValue = HexValues();
+constexpr std::array<uint8_t, 256> kBase64Value = Base64Values();
+
+// Each kernel handles a prefix of its input and returns how much it
+// consumed, the scalar loops below finish the rest. Decoders stop at the
+// first block with an invalid character and leave the error to the scalar
+// loop, which is also where the exact position would be found.
+struct Kernels {
+  size_t (*hex_encode)(const uint8_t* in, size_t size, char* out, bool upper);
+  size_t (*hex_decode)(const char* in, size_t size, uint8_t* out);
+  size_t (*base64_encode)(const uint8_t* in, size_t size, char* out);
+  size_t (*base64_decode)(const char* in, size_t size, uint8_t* out);
+  // key is already rotated so that its first byte applies to data[0].
+  size_t (*xor_mask)(uint8_t* data, size_t size, uint32_t key);
+};
+
+size_t NoHexEncode(const uint8_t*, size_t, char*, bool) { return 0; }
+size_t NoDecode(const char*, size_t, uint8_t*) { return 0; }
+size_t NoBase64Encode(const uint8_t*, size_t, char*) { return 0; }
+size_t NoXorMask(uint8_t*, size_t, uint32_t) { return 0; }
+
+constexpr Kernels kScalarKernels = {NoHexEncode, NoDecode, NoBase64Encode,
+                                    NoDecode, NoXorMask};
+
+#if defined(TBOX_SIMD_AVX2)
+
+TBOX_TARGET_AVX2 size_t HexEncodeAvx2(const uint8_t* in, size_t size,
+                                      char* out, bool upper) {
+  const char* table = upper ? kHexUpper : kHexLower;
+  const __m256i lut = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    const __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    const __m256i hi = _mm256_shuffle_epi8(
+        lut, _mm256_and_si256(_mm256_srli_epi16(b, 4), mask));
+    const __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(b, mask));
+    // Unpacking works per 128 bit lane, lane 0 holds bytes 0-15.
+    const __m256i a = _mm256_unpacklo_epi8(hi, lo);
+    const __m256i z = _mm256_unpackhi_epi8(hi, lo);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i),
+                        _mm256_permute2x128_si256(a, z, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i + 32),
+                        _mm256_permute2x128_si256(a, z, 0x31));
+  }
+  return i;
+}
+
+TBOX_TARGET_AVX2 size_t HexDecodeAvx2(const char* in, size_t size,
+                                      uint8_t* out) {
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    const __m256i c =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    const __m256i digit = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    const __m256i is_digit = _mm256_cmpeq_epi8(
+        _mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+    const __m256i alpha = _mm256_sub_epi8(
+        _mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    const __m256i is_alpha = _mm256_cmpeq_epi8(
+        _mm256_min_epu8(alpha, _mm256_set1_epi8(5)), alpha);
+    if (_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_alpha)) != -1) {
+      break;
+    }
+    const __m256i v = _mm256_blendv_epi8(
+        _mm256_add_epi8(alpha, _mm256_set1_epi8(10)), digit, is_digit);
+    // hi * 16 + lo for every pair, then narrow the 16 bit results.
+    const __m256i w = _mm256_maddubs_epi16(v, _mm256_set1_epi16(0x0110));
+    const __m256i p =
+        _mm256_permute4x64_epi64(_mm256_packus_epi16(w, w), 0xd8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i / 2),
+                     _mm256_castsi256_si128(p));
+  }
+  return i;
+}
+
+// Base64 kernels follow Wojciech Mula's and Alfred Klomp's AVX2 codecs.
+TBOX_TARGET_AVX2 size_t Base64EncodeAvx2(const uint8_t* in, size_t size,
+                                         char* out) {
+  const __m256i shuffle = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,  //
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  const __m256i lut = _mm256_setr_epi8(
+      65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,  //
+      65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+  size_t i = 0;
+  size_t o = 0;
+  // Each lane takes 12 bytes through a 16 byte load, so 4 bytes of slack
+  // past the last block are needed.
+  for (; i + 28 <= size; i += 24, o += 32) {
+    const __m256i raw = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12)), 1);
+    const __m256i s = _mm256_shuffle_epi8(raw, shuffle);
+    const __m256i t0 = _mm256_and_si256(s, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(s, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    const __m256i idx = _mm256_or_si256(t1, t3);
+    // Map 0-63 to the alphabet by adding a per range offset.
+    __m256i range = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+    range = _mm256_sub_epi8(range,
+                            _mm256_cmpgt_epi8(idx, _mm256_set1_epi8(25)));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(out + o),
+        _mm256_add_epi8(idx, _mm256_shuffle_epi8(lut, range)));
+  }
+  return i;
+}
+
+TBOX_TARGET_AVX2 size_t Base64DecodeAvx2(const char* in, size_t size,
+                                         uint8_t* out) {
+  const __m256i lut_lo = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a,
+      0x1b, 0x1b, 0x1b, 0x1a,  //
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a,
+      0x1b, 0x1b, 0x1b, 0x1a);
+  const __m256i lut_hi = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x10, 0x10,  //
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x10, 0x10);
+  const __m256i lut_roll = _mm256_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,  //
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+  size_t i = 0;
+  size_t o = 0;
+  // Every block stores 32 bytes of which 24 are valid, stop while at least
+  // 8 more output bytes are still to come.
+  for (; i + 44 <= size; i += 32, o += 24) {
+    const __m256i c =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    const __m256i hi_nibbles =
+        _mm256_and_si256(_mm256_srli_epi32(c, 4), mask_2f);
+    const __m256i lo_nibbles = _mm256_and_si256(c, mask_2f);
+    const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    if (!_mm256_testz_si256(lo, hi)) {
+      break;
+    }
+    const __m256i eq_2f = _mm256_cmpeq_epi8(c, mask_2f);
+    const __m256i roll =
+        _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+    const __m256i v = _mm256_add_epi8(c, roll);
+    // Pack four 6 bit values into 3 bytes.
+    const __m256i ab_bc =
+        _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+    __m256i packed = _mm256_madd_epi16(ab_bc, _mm256_set1_epi32(0x00011000));
+    packed = _mm256_shuffle_epi8(
+        packed, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1,
+                                 -1, -1,  //
+                                 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1,
+                                 -1, -1));
+    packed = _mm256_permutevar8x32_epi32(
+        packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + o), packed);
+  }
+  return i;
+}
+
+TBOX_TARGET_AVX2 size_t XorMaskAvx2(uint8_t* data, size_t size,
+                                    uint32_t key) {
+  const __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    auto* p = reinterpret_cast<__m256i*>(data + i);
+    _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), k));
+  }
+  return i;
+}
+
+constexpr Kernels kAvx2Kernels = {HexEncodeAvx2, HexDecodeAvx2,
+                                  Base64EncodeAvx2, Base64DecodeAvx2,
+                                  XorMaskAvx2};
+
+bool CpuHasAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#elif defined(TBOX_SIMD_NEON)
+
+size_t HexEncodeNeon(const uint8_t* in, size_t size, char* out, bool upper) {
+  const uint8x16_t lut = vld1q_u8(
+      reinterpret_cast<const uint8_t*>(upper ? kHexUpper : kHexLower));
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    const uint8x16_t b = vld1q_u8(in + i);
+    uint8x16x2_t r;
+    r.val[0] = vqtbl1q_u8(lut, vshrq_n_u8(b, 4));
+    r.val[1] = vqtbl1q_u8(lut, vandq_u8(b, vdupq_n_u8(0x0f)));
+    vst2q_u8(reinterpret_cast<uint8_t*>(out + 2 * i), r);
+  }
+  return i;
+}
+
+// Nibble values of c into *v, returns 0xff lanes where c is a hex digit.
+inline uint8x16_t HexNibbles(uint8x16_t c, uint8x16_t* v) {
+  const uint8x16_t digit = vsubq_u8(c, vdupq_n_u8('0'));
+  const uint8x16_t is_digit = vcleq_u8(digit, vdupq_n_u8(9));
+  const uint8x16_t alpha =
+      vsubq_u8(vorrq_u8(c, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+  const uint8x16_t is_alpha = vcleq_u8(alpha, vdupq_n_u8(5));
+  *v = vbslq_u8(is_digit, digit, vaddq_u8(alpha, vdupq_n_u8(10)));
+  return vorrq_u8(is_digit, is_alpha);
+}
+
+size_t HexDecodeNeon(const char* in, size_t size, uint8_t* out) {
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    const uint8x16x2_t c = vld2q_u8(reinterpret_cast<const uint8_t*>(in + i));
+    uint8x16_t hi;
+    uint8x16_t lo;
+    const uint8x16_t valid =
+        vandq_u8(HexNibbles(c.val[0], &hi), HexNibbles(c.val[1], &lo));
+    if (vminvq_u8(valid) == 0) {
+      break;
+    }
+    vst1q_u8(out + i / 2, vorrq_u8(vshlq_n_u8(hi, 4), lo));
+  }
+  return i;
+}
+
+inline uint8x16x4_t LoadTable64(const uint8_t* table) {
+  uint8x16x4_t t;
+  t.val[0] = vld1q_u8(table);
+  t.val[1] = vld1q_u8(table + 16);
+  t.val[2] = vld1q_u8(table + 32);
+  t.val[3] = vld1q_u8(table + 48);
+  return t;
+}
+
+size_t Base64EncodeNeon(const uint8_t* in, size_t size, char* out) {
+  const uint8x16x4_t lut =
+      LoadTable64(reinterpret_cast<const uint8_t*>(kBase64));
+  size_t i = 0;
+  size_t o = 0;
+  for (; i + 48 <= size; i += 48, o += 64) {
+    const uint8x16x3_t s = vld3q_u8(in + i);
+    uint8x16x4_t idx;
+    idx.val[0] = vshrq_n_u8(s.val[0], 2);
+    idx.val[1] = vorrq_u8(vshlq_n_u8(vandq_u8(s.val[0], vdupq_n_u8(3)), 4),
+                          vshrq_n_u8(s.val[1], 4));
+    idx.val[2] = vorrq_u8(vshlq_n_u8(vandq_u8(s.val[1], vdupq_n_u8(15)), 2),
+                          vshrq_n_u8(s.val[2], 6));
+    idx.val[3] = vandq_u8(s.val[2], vdupq_n_u8(63));
+    for (int k = 0; k < 4; ++k) {
+      idx.val[k] = vqtbl4q_u8(lut, idx.val[k]);
+    }
+    vst4q_u8(reinterpret_cast<uint8_t*>(out + o), idx);
+  }
+  return i;
+}
+
+size_t Base64DecodeNeon(const char* in, size_t size, uint8_t* out) {
+  const uint8x16x4_t lut_lo = LoadTable64(kBase64Value.data());
+  const uint8x16x4_t lut_hi = LoadTable64(kBase64Value.data() + 64);
+  size_t i = 0;
+  size_t o = 0;
+  for (; i + 64 <= size; i += 64, o += 48) {
+    uint8x16x4_t v = vld4q_u8(reinterpret_cast<const uint8_t*>(in + i));
+    uint8x16_t bad = vdupq_n_u8(0);
+    for (int k = 0; k < 4; ++k) {
+      // Out of range indexes give 0 in vqtbl and keep the lane in vqtbx,
+      // non ASCII input is caught by its own high bit.
+      const uint8x16_t c = v.val[k];
+      v.val[k] = vqtbx4q_u8(vqtbl4q_u8(lut_lo, c), lut_hi,
+                            vsubq_u8(c, vdupq_n_u8(64)));
+      bad = vorrq_u8(bad, vorrq_u8(v.val[k], c));
+    }
+    if (vmaxvq_u8(bad) & 0x80) {
+      break;
+    }
+    uint8x16x3_t r;
+    r.val[0] = vorrq_u8(vshlq_n_u8(v.val[0], 2), vshrq_n_u8(v.val[1], 4));
+    r.val[1] = vorrq_u8(vshlq_n_u8(v.val[1], 4), vshrq_n_u8(v.val[2], 2));
+    r.val[2] = vorrq_u8(vshlq_n_u8(v.val[2], 6), v.val[3]);
+    vst3q_u8(out + o, r);
+  }
+  return i;
+}
+
+size_t XorMaskNeon(uint8_t* data, size_t size, uint32_t key) {
+  const uint8x16_t k = vreinterpretq_u8_u32(vdupq_n_u32(key));
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    vst1q_u8(data + i, veorq_u8(vld1q_u8(data + i), k));
+  }
+  return i;
+}
+
+constexpr Kernels kNeonKernels = {HexEncodeNeon, HexDecodeNeon,
+                                  Base64EncodeNeon, Base64DecodeNeon,
+                                  XorMaskNeon};
+
+#endif
+
+const Kernels* KernelsFor(SimdCodec::Isa isa) {
+  switch (isa) {
+#if defined(TBOX_SIMD_AVX2)
+    case SimdCodec::Isa::kAvx2:
+      return CpuHasAvx2() ? &kAvx2Kernels : nullptr;
+#elif defined(TBOX_SIMD_NEON)
+    case SimdCodec::Isa::kNeon:
+      return &kNeonKernels;
+#endif
+    case SimdCodec::Isa::kScalar:
+      return &kScalarKernels;
+    default:
+      return nullptr;
+  }
+}
+
+struct Dispatch {
+  Dispatch() : isa(SimdCodec::Best()), kernels(KernelsFor(isa.load())) {}
+  std::atomic<SimdCodec::Isa> isa;
+  std::atomic<const Kernels*> kernels;
+};
+
+Dispatch& ActiveDispatch() {
+  static Dispatch dispatch;
+  return dispatch;
+}
+
+const Kernels& Current() {
+  return *ActiveDispatch().kernels.load(std::memory_order_relaxed);
+}
+
+}  // namespace
+
+SimdCodec::Isa SimdCodec::Best() {
+  static const Isa best = [] {
+    for (const auto isa : {Isa::kAvx2, Isa::kNeon}) {
+      if (KernelsFor(isa)) {
+        return isa;
+      }
+    }
+    return Isa::kScalar;
+  }();
+  return best;
+}
+
+SimdCodec::Isa SimdCodec::Active() { return ActiveDispatch().isa.load(); }
+
+bool SimdCodec::SetActive(Isa isa) {
+  const Kernels* kernels = KernelsFor(isa);
+  if (!kernels) {
+    return false;
+  }
+  ActiveDispatch().kernels.store(kernels);
+  ActiveDispatch().isa.store(isa);
+  return true;
+}
+
+const char* SimdCodec::IsaName(Isa isa) {
+  switch (isa) {
+    case Isa::kAvx2:
+      return "avx2";
+    case Isa::kNeon:
+      return "neon";
+    case Isa::kScalar:
+    default:
+      return "scalar";
+  }
+}
+
+void SimdCodec::HexEncode(std::string_view in, char* out,
+                          bool use_upper_case) {
+  const auto* src = reinterpret_cast<const uint8_t*>(in.data());
+  size_t i = Current().hex_encode(src, in.size(), out, use_upper_case);
+  const char* table = use_upper_case ? kHexUpper : kHexLower;
+  for (; i < in.size(); ++i) {
+    out[2 * i] = table[src[i] >> 4];
+    out[2 * i + 1] = table[src[i] & 0x0f];
+  }
+}
+
+bool SimdCodec::HexDecode(std::string_view in, char* out) {
+  if (in.size() % 2) {
+    return false;
+  }
+  auto* dst = reinterpret_cast<uint8_t*>(out);
+  size_t i = Current().hex_decode(in.data(), in.size(), dst);
+  uint8_t bad = 0;
+  for (; i < in.size(); i += 2) {
+    const uint8_t hi = kHexValue[static_cast<uint8_t>(in[i])];
+    const uint8_t lo = kHexValue[static_cast<uint8_t>(in[i + 1])];
+    bad |= hi | lo;
+    dst[i / 2] = static_cast<uint8_t>(hi << 4 | lo);
+  }
+  return (bad & 0xf0) == 0;
+}
+
+size_t SimdCodec::Base64Encode(std::string_view in, char* out) {
+  const auto* src = reinterpret_cast<const uint8_t*>(in.data());
+  const size_t size = in.size();
+  size_t i = Current().base64_encode(src, size, out);
+  size_t o = i / 3 * 4;
+  for (; i + 3 <= size; i += 3, o += 4) {
+    const uint32_t v = src[i] << 16 | src[i + 1] << 8 | src[i + 2];
+    out[o] = kBase64[v >> 18];
+    out[o + 1] = kBase64[(v >> 12) & 63];
+    out[o + 2] = kBase64[(v >> 6) & 63];
+    out[o + 3] = kBase64[v & 63];
+  }
+  if (i < size) {
+    const uint32_t v = src[i] << 16 | (i + 1 < size ? src[i + 1] << 8 : 0);
+    out[o] = kBase64[v >> 18];
+    out[o + 1] = kBase64[(v >> 12) & 63];
+    out[o + 2] = i + 1 < size ? kBase64[(v >> 6) & 63] : '=';
+    out[o + 3] = '=';
+    o += 4;
+  }
+  return o;
+}
+
+bool SimdCodec::Base64Decode(std::string_view in, char* out,
+                             size_t* out_size) {
+  size_t size = in.size();
+  if (size % 4 == 0) {
+    for (int k = 0; k < 2 && size > 0 && in[size - 1] == '='; ++k) {
+      --size;
+    }
+  } else if (size % 4 == 1 || in.back() == '=') {
+    return false;
+  }
+  if (size % 4 == 1) {
+    return false;
+  }
+  auto* dst = reinterpret_cast<uint8_t*>(out);
+  size_t i = Current().base64_decode(in.data(), size, dst);
+  size_t o = i / 4 * 3;
+  uint8_t bad = 0;
+  for (; i + 4 <= size; i += 4, o += 3) {
+    const uint8_t a = kBase64Value[static_cast<uint8_t>(in[i])];
+    const uint8_t b = kBase64Value[static_cast<uint8_t>(in[i + 1])];
+    const uint8_t c = kBase64Value[static_cast<uint8_t>(in[i + 2])];
+    const uint8_t d = kBase64Value[static_cast<uint8_t>(in[i + 3])];
+    bad |= a | b | c | d;
+    const uint32_t v = a << 18 | b << 12 | c << 6 | d;
+    dst[o] = static_cast<uint8_t>(v >> 16);
+    dst[o + 1] = static_cast<uint8_t>(v >> 8);
+    dst[o + 2] = static_cast<uint8_t>(v);
+  }
+  if (i < size) {
+    const uint8_t a = kBase64Value[static_cast<uint8_t>(in[i])];
+    const uint8_t b = kBase64Value[static_cast<uint8_t>(in[i + 1])];
+    const uint8_t c =
+        i + 2 < size ? kBase64Value[static_cast<uint8_t>(in[i + 2])] : 0;
+    bad |= a | b | c;
+    const uint32_t v = a << 18 | b << 12 | c << 6;
+    dst[o++] = static_cast<uint8_t>(v >> 16);
+    if (i + 2 < size) {
+      dst[o++] = static_cast<uint8_t>(v >> 8);
+    }
+  }
+  *out_size = o;
+  return (bad & 0xc0) == 0;
+}
+
+void SimdCodec::XorMask(char* data, size_t size, uint32_t key,
+                        size_t phase) {
+  uint8_t bytes[4];
+  std::memcpy(bytes, &key, sizeof(key));
+  uint8_t rotated[4];
+  for (size_t j = 0; j < 4; ++j) {
+    rotated[j] = bytes[(phase + j) & 3];
+  }
+  std::memcpy(&key, rotated, sizeof(key));
+
+  auto* p = reinterpret_cast<uint8_t*>(data);
+  size_t i = Current().xor_mask(p, size, key);
+  // Blocks are multiples of 4, so the key is still in phase here.
+  const uint64_t wide = static_cast<uint64_t>(key) << 32 | key;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t v;
+    std::memcpy(&v, p + i, sizeof(v));
+    v ^= wide;
+    std::memcpy(p + i, &v, sizeof(v));
+  }
+  for (; i < size; ++i) {
+    p[i] ^= rotated[i & 3];
+  }
+}
+
+}  // namespace util
+}  // namespace tbox
@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_UTIL_SIMD_CODEC_H_
+#define TBOX_UTIL_SIMD_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace tbox {
+namespace util {
+
+/// @brief Vectorized hex and base64 (RFC 4648 standard alphabet) codecs and
+///        WebSocket payload masking.
+/// @details Kernels are picked once at runtime: AVX2 when the CPU has it,
+///          NEON on aarch64, a table driven scalar loop otherwise. All
+///          functions write into caller provided buffers sized with the
+///          *Size() helpers and never allocate.
+class SimdCodec final {
+ public:
+  enum class Isa {
+    kScalar = 0,
+    kAvx2 = 1,
+    kNeon = 2,
+  };
+
+  /// @brief Best instruction set supported by this CPU and build.
+  static Isa Best();
+
+  /// @brief Instruction set currently used by the codecs.
+  static Isa Active();
+
+  /// @brief Force an instruction set, for tests and benchmarks.
+  /// @return false if isa is not supported here.
+  static bool SetActive(Isa isa);
+
+  static const char* IsaName(Isa isa);
+
+  static constexpr size_t HexEncodedSize(size_t size) { return size * 2; }
+
+  /// @brief Write HexEncodedSize(in.size()) hex digits to out.
+  static void HexEncode(std::string_view in, char* out,
+                        bool use_upper_case = false);
+
+  /// @brief Decode in.size() / 2 bytes to out, either case accepted.
+  /// @return false on odd length or non hex digits.
+  static bool HexDecode(std::string_view in, char* out);
+
+  static constexpr size_t Base64EncodedSize(size_t size) {
+    return (size + 2) / 3 * 4;
+  }
+
+  /// @brief Upper bound of the decoded size of size base64 characters.
+  static constexpr size_t Base64DecodedSize(size_t size) {
+    return (size + 3) / 4 * 3;
+  }
+
+  /// @brief Write padded base64 of in to out.
+  /// @return Base64EncodedSize(in.size()).
+  static size_t Base64Encode(std::string_view in, char* out);
+
+  /// @brief Decode padded or unpadded base64.
+  /// @param out At least Base64DecodedSize(in.size()) bytes.
+  /// @param out_size Number of bytes written.
+  /// @return false on characters outside the alphabet or bad length.
+  static bool Base64Decode(std::string_view in, char* out, size_t* out_size);
+
+  /// @brief XOR data in place with a repeating 4 byte WebSocket masking key.
+  /// @param key Key bytes in wire order, as read with memcpy.
+  /// @param phase Offset into the key of data[0], so a payload split over
+  ///        several buffers can be unmasked piece by piece.
+  static void XorMask(char* data, size_t size, uint32_t key, size_t phase = 0);
+};
+
+}  // namespace util
+}  // namespace tbox
+
+#endif  // TBOX_UTIL_SIMD_CODEC_H_
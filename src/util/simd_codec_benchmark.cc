@@ -0,0 +1,177 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+// Hex and base64 throughput of the previous Util implementation (fmt per
+// byte, boost beast base64) against the scalar and vector SimdCodec kernels.
+// Sizes cover a SHA-256 digest, a challenge nonce / SSH key and bulk data.
+//
+//   bazel run -c opt //src/util:simd_codec_benchmark
+
+#include <cstdint>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "boost/beast/core/detail/base64.hpp"
+#include "fmt/core.h"
+#include "src/util/simd_codec.h"
+
+namespace tbox {
+namespace util {
+namespace {
+
+namespace base64 = boost::beast::detail::base64;
+
+constexpr int kLegacy = -1;
+
+std::string Data(size_t size) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<char>(i * 131 + 7);
+  }
+  return data;
+}
+
+// folly::unhexlify, which Util::HexToStr used to call.
+bool LegacyUnhex(const std::string& in, std::string* out) {
+  static const auto* table = [] {
+    auto* t = new signed char[256];
+    for (int c = 0; c < 256; ++c) {
+      t[c] = c >= '0' && c <= '9'   ? c - '0'
+             : c >= 'a' && c <= 'f' ? c - 'a' + 10
+             : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                    : 16;
+    }
+    return t;
+  }();
+  out->resize(in.size() / 2);
+  for (size_t i = 0; i < in.size(); i += 2) {
+    const int hi = table[static_cast<uint8_t>(in[i])];
+    const int lo = table[static_cast<uint8_t>(in[i + 1])];
+    if ((hi | lo) & 16) {
+      return false;
+    }
+    (*out)[i / 2] = static_cast<char>(hi << 4 | lo);
+  }
+  return true;
+}
+
+// Arg 0 selects the implementation, kLegacy or a SimdCodec::Isa.
+bool Select(benchmark::State& state) {
+  const int impl = static_cast<int>(state.range(0));
+  if (impl == kLegacy) {
+    state.SetLabel("legacy");
+    return true;
+  }
+  const auto isa = static_cast<SimdCodec::Isa>(impl);
+  if (!SimdCodec::SetActive(isa)) {
+    state.SkipWithError("isa not supported");
+    return false;
+  }
+  state.SetLabel(SimdCodec::IsaName(isa));
+  return true;
+}
+
+void BM_HexEncode(benchmark::State& state) {
+  const std::string data = Data(state.range(1));
+  std::string out(SimdCodec::HexEncodedSize(data.size()), '\0');
+  const bool legacy = state.range(0) == kLegacy;
+  if (!Select(state)) {
+    return;
+  }
+  for (auto _ : state) {
+    if (legacy) {
+      out.clear();
+      for (const char c : data) {
+        out.append(fmt::format("{:02x}", static_cast<unsigned char>(c)));
+      }
+    } else {
+      SimdCodec::HexEncode(data, out.data());
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+void BM_HexDecode(benchmark::State& state) {
+  const std::string data = Data(state.range(1));
+  std::string hex(SimdCodec::HexEncodedSize(data.size()), '\0');
+  SimdCodec::HexEncode(data, hex.data());
+  std::string out(data.size(), '\0');
+  const bool legacy = state.range(0) == kLegacy;
+  if (!Select(state)) {
+    return;
+  }
+  for (auto _ : state) {
+    if (legacy) {
+      benchmark::DoNotOptimize(LegacyUnhex(hex, &out));
+    } else {
+      benchmark::DoNotOptimize(SimdCodec::HexDecode(hex, out.data()));
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * hex.size());
+}
+
+void BM_Base64Encode(benchmark::State& state) {
+  const std::string data = Data(state.range(1));
+  std::string out(SimdCodec::Base64EncodedSize(data.size()), '\0');
+  const bool legacy = state.range(0) == kLegacy;
+  if (!Select(state)) {
+    return;
+  }
+  for (auto _ : state) {
+    if (legacy) {
+      benchmark::DoNotOptimize(
+          base64::encode(out.data(), data.data(), data.size()));
+    } else {
+      benchmark::DoNotOptimize(SimdCodec::Base64Encode(data, out.data()));
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+void BM_Base64Decode(benchmark::State& state) {
+  const std::string data = Data(state.range(1));
+  std::string encoded(SimdCodec::Base64EncodedSize(data.size()), '\0');
+  SimdCodec::Base64Encode(data, encoded.data());
+  std::string out(SimdCodec::Base64DecodedSize(encoded.size()), '\0');
+  const bool legacy = state.range(0) == kLegacy;
+  if (!Select(state)) {
+    return;
+  }
+  size_t size = 0;
+  for (auto _ : state) {
+    if (legacy) {
+      benchmark::DoNotOptimize(
+          base64::decode(out.data(), encoded.data(), encoded.size()));
+    } else {
+      benchmark::DoNotOptimize(
+          SimdCodec::Base64Decode(encoded, out.data(), &size));
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+
+void CodecArgs(benchmark::internal::Benchmark* b) {
+  for (const int impl : {kLegacy, static_cast<int>(SimdCodec::Isa::kScalar),
+                         static_cast<int>(SimdCodec::Best())}) {
+    for (const int size : {32, 1024, 1 << 20}) {
+      b->Args({impl, size});
+    }
+  }
+}
+
+BENCHMARK(BM_HexEncode)->Apply(CodecArgs);
+BENCHMARK(BM_HexDecode)->Apply(CodecArgs);
+BENCHMARK(BM_Base64Encode)->Apply(CodecArgs);
+BENCHMARK(BM_Base64Decode)->Apply(CodecArgs);
+
+}  // namespace
+}  // namespace util
+}  // namespace tbox
+
+BENCHMARK_MAIN();
@@ -0,0 +1,156 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/util/simd_codec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace tbox {
+namespace util {
+namespace {
+
+std::string RandomBytes(size_t size, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::string data(size, '\0');
+  for (auto& c : data) {
+    c = static_cast<char>(rng());
+  }
+  return data;
+}
+
+std::string Hex(std::string_view in, bool upper = false) {
+  std::string out(SimdCodec::HexEncodedSize(in.size()), '\0');
+  SimdCodec::HexEncode(in, out.data(), upper);
+  return out;
+}
+
+std::string Base64(std::string_view in) {
+  std::string out(SimdCodec::Base64EncodedSize(in.size()), '\0');
+  out.resize(SimdCodec::Base64Encode(in, out.data()));
+  return out;
+}
+
+bool Unbase64(std::string_view in, std::string* out) {
+  out->resize(SimdCodec::Base64DecodedSize(in.size()));
+  size_t size = 0;
+  const bool ret = SimdCodec::Base64Decode(in, out->data(), &size);
+  out->resize(size);
+  return ret;
+}
+
+// Runs every test once per instruction set available on this machine, so
+// the vector kernels are checked against the scalar reference.
+class SimdCodecTest : public ::testing::TestWithParam<SimdCodec::Isa> {
+ protected:
+  void SetUp() override {
+    if (!SimdCodec::SetActive(GetParam())) {
+      GTEST_SKIP() << SimdCodec::IsaName(GetParam()) << " not supported";
+    }
+  }
+  void TearDown() override { SimdCodec::SetActive(SimdCodec::Best()); }
+};
+
+TEST_P(SimdCodecTest, KnownVectors) {
+  EXPECT_EQ(Hex(""), "");
+  EXPECT_EQ(Hex("\x01\xab\xff"), "01abff");
+  EXPECT_EQ(Hex("\x01\xab\xff", true), "01ABFF");
+  const char* vectors[][2] = {{"", ""},         {"f", "Zg=="},
+                              {"fo", "Zm8="},   {"foo", "Zm9v"},
+                              {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="},
+                              {"foobar", "Zm9vYmFy"}};
+  for (const auto& v : vectors) {
+    EXPECT_EQ(Base64(v[0]), v[1]);
+    std::string out;
+    ASSERT_TRUE(Unbase64(v[1], &out));
+    EXPECT_EQ(out, v[0]);
+  }
+  std::string out;
+  ASSERT_TRUE(Unbase64("Zm9vYmE", &out));
+  EXPECT_EQ(out, "fooba");
+}
+
+TEST_P(SimdCodecTest, MatchesScalar) {
+  for (size_t size = 0; size < 300; ++size) {
+    const std::string data = RandomBytes(size, size);
+    SimdCodec::SetActive(SimdCodec::Isa::kScalar);
+    const std::string hex = Hex(data, size % 2);
+    const std::string b64 = Base64(data);
+    SimdCodec::SetActive(GetParam());
+
+    EXPECT_EQ(Hex(data, size % 2), hex) << size;
+    EXPECT_EQ(Base64(data), b64) << size;
+    std::string out(size, '\0');
+    ASSERT_TRUE(SimdCodec::HexDecode(hex, out.data())) << size;
+    EXPECT_EQ(out, data) << size;
+    ASSERT_TRUE(Unbase64(b64, &out)) << size;
+    EXPECT_EQ(out, data) << size;
+  }
+}
+
+TEST_P(SimdCodecTest, RejectsInvalidInput) {
+  const std::string data = RandomBytes(200, 1);
+  const std::string hex = Hex(data);
+  const std::string b64 = Base64(data);
+  std::string out(data.size(), '\0');
+  EXPECT_FALSE(SimdCodec::HexDecode("abc", out.data()));
+  // A bad character anywhere, inside a vector block or in the tail.
+  for (const size_t pos : {0ul, 5ul, 33ul, 100ul, hex.size() - 1}) {
+    for (const char bad : {'g', 'G', ' ', '\x80', '/', ':'}) {
+      std::string corrupt = hex;
+      corrupt[pos] = bad;
+      EXPECT_FALSE(SimdCodec::HexDecode(corrupt, out.data())) << pos;
+    }
+  }
+  for (const size_t pos : {0ul, 7ul, 40ul, 130ul, b64.size() - 3}) {
+    for (const char bad : {'-', '_', '=', ' ', '\x80', '\xff', '.'}) {
+      std::string corrupt = b64;
+      corrupt[pos] = bad;
+      EXPECT_FALSE(Unbase64(corrupt, &out)) << pos << " " << bad;
+    }
+  }
+  EXPECT_FALSE(Unbase64("Zm9vY", &out));
+  EXPECT_FALSE(Unbase64("Zg===", &out));
+}
+
+TEST_P(SimdCodecTest, XorMask) {
+  const uint8_t key_bytes[4] = {0x12, 0x34, 0x56, 0x78};
+  uint32_t key;
+  std::memcpy(&key, key_bytes, sizeof(key));
+  for (const size_t size : {0, 1, 7, 31, 32, 100, 1000}) {
+    const std::string data = RandomBytes(size, size);
+    std::string expected = data;
+    for (size_t i = 0; i < size; ++i) {
+      expected[i] ^= key_bytes[i % 4];
+    }
+    std::string masked = data;
+    SimdCodec::XorMask(masked.data(), masked.size(), key);
+    EXPECT_EQ(masked, expected) << size;
+
+    // Unmasking in uneven pieces keeps the key in phase.
+    std::string pieces = data;
+    for (size_t pos = 0, step = 1; pos < size; pos += step, step += 3) {
+      SimdCodec::XorMask(pieces.data() + pos, std::min(step, size - pos), key,
+                         pos);
+    }
+    EXPECT_EQ(pieces, expected) << size;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Isa, SimdCodecTest,
+    ::testing::Values(SimdCodec::Isa::kScalar, SimdCodec::Isa::kAvx2,
+                      SimdCodec::Isa::kNeon),
+    [](const ::testing::TestParamInfo<SimdCodec::Isa>& info) {
+      return std::string(SimdCodec::IsaName(info.param));
+    });
+
+}  // namespace
+}  // namespace util
+}  // namespace tbox
@@ -0,0 +1,483 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/util/stream_compression.h"
+
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "lz4frame.h"
+#include "lzma.h"
+#include "src/common/logging.h"
+#include "zstd.h"
+
+namespace tbox {
+namespace util {
+
+namespace {
+
+// Output is produced in pieces of this size and appended to the caller.
+constexpr size_t kOutChunk = 128 * 1024;
+
+// LZ4F_compressBound grows with the input, feed it bounded slices.
+constexpr size_t kLz4Slice = 64 * 1024;
+
+// Cap on xz decoder memory. The stream header chooses the dictionary size,
+// so without it a crafted file makes the decoder allocate up to 4 GiB per
+// thread. xz -9 needs 65 MiB single threaded; threads are dropped before
+// the cap is hit, and only a stream that cannot fit at all is rejected.
+constexpr uint64_t kXzMemlimit = 256 << 20;
+
+uint32_t Threads(int threads) {
+  if (threads > 0) {
+    return threads;
+  }
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+class ZstdCompressor final : public StreamCompressor {
+ public:
+  ~ZstdCompressor() override { ZSTD_freeCCtx(cctx_); }
+
+  bool Init(const StreamOptions& options) {
+    cctx_ = ZSTD_createCCtx();
+    if (!cctx_) {
+      return false;
+    }
+    const int level = options.level ? options.level : ZSTD_CLEVEL_DEFAULT;
+    const uint32_t threads = Threads(options.threads);
+    if (ZSTD_isError(
+            ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, level)) ||
+        ZSTD_isError(ZSTD_CCtx_setParameter(cctx_, ZSTD_c_checksumFlag,
+                                            options.checksum ? 1 : 0))) {
+      return false;
+    }
+    // A single worker still moves compression off the calling thread, only
+    // go multithreaded when asked for more than one.
+    if (threads > 1 && ZSTD_isError(ZSTD_CCtx_setParameter(
+                           cctx_, ZSTD_c_nbWorkers, threads))) {
+      LOG(WARNING) << "zstd built without multithread support";
+    }
+    return true;
+  }
+
+  bool Write(std::string_view input, std::string* out) override {
+    return Drive(input, ZSTD_e_continue, out);
+  }
+
+  bool Flush(std::string* out) override {
+    return Drive({}, ZSTD_e_flush, out);
+  }
+
+  bool Finish(std::string* out) override { return Drive({}, ZSTD_e_end, out); }
+
+ private:
+  bool Drive(std::string_view input, ZSTD_EndDirective mode,
+             std::string* out) {
+    ZSTD_inBuffer in = {input.data(), input.size(), 0};
+    while (true) {
+      const size_t offset = out->size();
+      out->resize(offset + kOutChunk);
+      ZSTD_outBuffer ob = {out->data() + offset, kOutChunk, 0};
+      const size_t ret = ZSTD_compressStream2(cctx_, &ob, &in, mode);
+      out->resize(offset + ob.pos);
+      if (ZSTD_isError(ret)) {
+        LOG(ERROR) << "zstd compress error: " << ZSTD_getErrorName(ret);
+        return false;
+      }
+      if (mode == ZSTD_e_continue ? in.pos == in.size : ret == 0) {
+        return true;
+      }
+    }
+  }
+
+  ZSTD_CCtx* cctx_ = nullptr;
+};
+
+class ZstdDecompressor final : public StreamDecompressor {
+ public:
+  ~ZstdDecompressor() override { ZSTD_freeDCtx(dctx_); }
+
+  bool Init() {
+    dctx_ = ZSTD_createDCtx();
+    return dctx_ != nullptr;
+  }
+
+  bool Write(std::string_view input, std::string* out) override {
+    ZSTD_inBuffer in = {input.data(), input.size(), 0};
+    while (true) {
+      const size_t offset = out->size();
+      out->resize(offset + kOutChunk);
+      ZSTD_outBuffer ob = {out->data() + offset, kOutChunk, 0};
+      const size_t consumed = in.pos;
+      const size_t ret = ZSTD_decompressStream(dctx_, &ob, &in);
+      out->resize(offset + ob.pos);
+      if (ZSTD_isError(ret)) {
+        LOG(ERROR) << "zstd decompress error: " << ZSTD_getErrorName(ret);
+        return false;
+      }
+      // Polling with no new input reports the next frame's header size.
+      if (in.pos != consumed || ob.pos != 0) {
+        finished_ = ret == 0;
+      }
+      // A full output buffer may hide more buffered output.
+      if (in.pos == in.size && ob.pos < ob.size) {
+        return true;
+      }
+    }
+  }
+
+  // Write() drains all output it can, only completeness is left to check.
+  bool Finish(std::string*) override {
+    if (!finished_) {
+      LOG(ERROR) << "Truncated zstd stream";
+    }
+    return finished_;
+  }
+
+ private:
+  ZSTD_DCtx* dctx_ = nullptr;
+  bool finished_ = false;
+};
+
+class Lz4Compressor final : public StreamCompressor {
+ public:
+  ~Lz4Compressor() override { LZ4F_freeCompressionContext(cctx_); }
+
+  bool Init(const StreamOptions& options) {
+    if (LZ4F_isError(LZ4F_createCompressionContext(&cctx_, LZ4F_VERSION))) {
+      return false;
+    }
+    prefs_.compressionLevel = options.level;
+    prefs_.frameInfo.blockSizeID = LZ4F_max4MB;
+    prefs_.frameInfo.contentChecksumFlag =
+        options.checksum ? LZ4F_contentChecksumEnabled : LZ4F_noContentChecksum;
+    return true;
+  }
+
+  bool Write(std::string_view input, std::string* out) override {
+    if (!Begin(out)) {
+      return false;
+    }
+    while (!input.empty()) {
+      const size_t n = std::min(input.size(), kLz4Slice);
+      const size_t offset = out->size();
+      out->resize(offset + LZ4F_compressBound(n, &prefs_));
+      const size_t ret =
+          LZ4F_compressUpdate(cctx_, out->data() + offset, out->size() - offset,
+                              input.data(), n, nullptr);
+      if (!Check(ret, offset, out)) {
+        return false;
+      }
+      input.remove_prefix(n);
+    }
+    return true;
+  }
+
+  bool Flush(std::string* out) override {
+    if (!Begin(out)) {
+      return false;
+    }
+    const size_t offset = out->size();
+    out->resize(offset + LZ4F_compressBound(0, &prefs_));
+    return Check(LZ4F_flush(cctx_, out->data() + offset, out->size() - offset,
+                            nullptr),
+                 offset, out);
+  }
+
+  bool Finish(std::string* out) override {
+    if (!Begin(out)) {
+      return false;
+    }
+    const size_t offset = out->size();
+    out->resize(offset + LZ4F_compressBound(0, &prefs_));
+    return Check(LZ4F_compressEnd(cctx_, out->data() + offset,
+                                  out->size() - offset, nullptr),
+                 offset, out);
+  }
+
+ private:
+  // The frame header is written lazily so Create() never produces output.
+  bool Begin(std::string* out) {
+    if (begun_) {
+      return true;
+    }
+    begun_ = true;
+    const size_t offset = out->size();
+    out->resize(offset + LZ4F_HEADER_SIZE_MAX);
+    return Check(LZ4F_compressBegin(cctx_, out->data() + offset,
+                                    LZ4F_HEADER_SIZE_MAX, &prefs_),
+                 offset, out);
+  }
+
+  static bool Check(size_t ret, size_t offset, std::string* out) {
+    if (LZ4F_isError(ret)) {
+      out->resize(offset);
+      LOG(ERROR) << "lz4 compress error: " << LZ4F_getErrorName(ret);
+      return false;
+    }
+    out->resize(offset + ret);
+    return true;
+  }
+
+  LZ4F_cctx* cctx_ = nullptr;
+  LZ4F_preferences_t prefs_ = {};
+  bool begun_ = false;
+};
+
+class Lz4Decompressor final : public StreamDecompressor {
+ public:
+  ~Lz4Decompressor() override { LZ4F_freeDecompressionContext(dctx_); }
+
+  bool Init() {
+    return !LZ4F_isError(LZ4F_createDecompressionContext(&dctx_, LZ4F_VERSION));
+  }
+
+  bool Write(std::string_view input, std::string* out) override {
+    while (true) {
+      const size_t offset = out->size();
+      out->resize(offset + kOutChunk);
+      size_t dst_size = kOutChunk;
+      size_t src_size = input.size();
+      const size_t ret = LZ4F_decompress(dctx_, out->data() + offset,
+                                         &dst_size, input.data(), &src_size,
+                                         nullptr);
+      out->resize(offset + dst_size);
+      if (LZ4F_isError(ret)) {
+        LOG(ERROR) << "lz4 decompress error: " << LZ4F_getErrorName(ret);
+        return false;
+      }
+      input.remove_prefix(src_size);
+      // 0 means the frame is complete, the context is ready for the next.
+      if (src_size != 0 || dst_size != 0) {
+        finished_ = ret == 0;
+      }
+      if (input.empty() && dst_size < kOutChunk) {
+        return true;
+      }
+    }
+  }
+
+  // Write() drains all output it can, only completeness is left to check.
+  bool Finish(std::string*) override {
+    if (!finished_) {
+      LOG(ERROR) << "Truncated lz4 stream";
+    }
+    return finished_;
+  }
+
+ private:
+  LZ4F_dctx* dctx_ = nullptr;
+  bool finished_ = false;
+};
+
+// Shared by the xz encoder and decoder, which only differ in setup.
+class XzStream {
+ public:
+  ~XzStream() { lzma_end(&strm_); }
+
+ protected:
+  bool Code(std::string_view input, lzma_action action, std::string* out,
+            bool* stream_end) {
+    strm_.next_in = reinterpret_cast<const uint8_t*>(input.data());
+    strm_.avail_in = input.size();
+    while (true) {
+      const size_t offset = out->size();
+      out->resize(offset + kOutChunk);
+      strm_.next_out = reinterpret_cast<uint8_t*>(out->data() + offset);
+      strm_.avail_out = kOutChunk;
+      const lzma_ret ret = lzma_code(&strm_, action);
+      out->resize(offset + kOutChunk - strm_.avail_out);
+      *stream_end = ret == LZMA_STREAM_END;
+      if (ret == LZMA_MEMLIMIT_ERROR) {
+        LOG(ERROR) << "xz stream needs more than " << kXzMemlimit
+                   << " bytes of memory to decode";
+        return false;
+      }
+      if (ret != LZMA_OK && ret != LZMA_STREAM_END) {
+        LOG(ERROR) << "xz error: " << ret;
+        return false;
+      }
+      // lzma_code only reports completion of flushes through its return
+      // value, LZMA_RUN is done once input is consumed and output has room.
+      if (*stream_end || (action == LZMA_RUN && strm_.avail_in == 0 &&
+                          strm_.avail_out != 0)) {
+        return true;
+      }
+    }
+  }
+
+  lzma_stream strm_ = LZMA_STREAM_INIT;
+};
+
+class XzCompressor final : public StreamCompressor, private XzStream {
+ public:
+  bool Init(const StreamOptions& options) {
+    const uint32_t preset =
+        options.level > 0 ? options.level : LZMA_PRESET_DEFAULT;
+    const lzma_check check =
+        options.checksum ? LZMA_CHECK_CRC64 : LZMA_CHECK_NONE;
+    const uint32_t threads = Threads(options.threads);
+    lzma_ret ret;
+    if (threads > 1) {
+      lzma_mt mt = {};
+      mt.threads = threads;
+      mt.preset = preset;
+      mt.check = check;
+      ret = lzma_stream_encoder_mt(&strm_, &mt);
+    } else {
+      ret = lzma_easy_encoder(&strm_, preset, check);
+    }
+    return ret == LZMA_OK;
+  }
+
+  bool Write(std::string_view input, std::string* out) override {
+    bool end = false;
+    return Code(input, LZMA_RUN, out, &end);
+  }
+
+  bool Flush(std::string* out) override {
+    bool end = false;
+    return Code({}, LZMA_FULL_FLUSH, out, &end);
+  }
+
+  bool Finish(std::string* out) override {
+    bool end = false;
+    return Code({}, LZMA_FINISH, out, &end);
+  }
+};
+
+class XzDecompressor final : public StreamDecompressor, private XzStream {
+ public:
+  bool Init(int threads) {
+    lzma_mt mt = {};
+    mt.threads = Threads(threads);
+    mt.flags = LZMA_CONCATENATED;
+    mt.memlimit_threading = kXzMemlimit;
+    mt.memlimit_stop = kXzMemlimit;
+    return lzma_stream_decoder_mt(&strm_, &mt) == LZMA_OK;
+  }
+
+  bool Write(std::string_view input, std::string* out) override {
+    bool end = false;
+    return Code(input, LZMA_RUN, out, &end);
+  }
+
+  // With LZMA_CONCATENATED the decoder can only tell a complete stream from
+  // a truncated one once it knows no more input follows.
+  bool Finish(std::string* out) override {
+    bool end = false;
+    return Code({}, LZMA_FINISH, out, &end) && end;
+  }
+};
+
+template <typename T, typename... Args>
+std::unique_ptr<T> Make(Args&&... args) {
+  auto stream = std::make_unique<T>();
+  if (!stream->Init(std::forward<Args>(args)...)) {
+    LOG(ERROR) << "Create compression stream error";
+    return nullptr;
+  }
+  return stream;
+}
+
+// Feeds src through stream in kChunkSize pieces, draining output to dst.
+template <typename Stream>
+bool Pump(const std::string& src, const std::string& dst, Stream* stream) {
+  std::ifstream in(src, std::ios::binary);
+  std::ofstream out(dst, std::ios::binary | std::ios::trunc);
+  if (!in || !out) {
+    LOG(ERROR) << "Open error: " << src << " -> " << dst;
+    return false;
+  }
+  std::vector<char> buf(StreamCompression::kChunkSize);
+  std::string produced;
+  while (in) {
+    in.read(buf.data(), buf.size());
+    produced.clear();
+    if (!stream->Write(std::string_view(buf.data(), in.gcount()), &produced)) {
+      return false;
+    }
+    out.write(produced.data(), produced.size());
+  }
+  produced.clear();
+  if (!in.eof() || !stream->Finish(&produced)) {
+    return false;
+  }
+  out.write(produced.data(), produced.size());
+  return out.good();
+}
+
+}  // namespace
+
+const char* StreamCodecName(StreamCodec codec) {
+  switch (codec) {
+    case StreamCodec::kLz4:
+      return "lz4";
+    case StreamCodec::kXz:
+      return "xz";
+    case StreamCodec::kZstd:
+    default:
+      return "zstd";
+  }
+}
+
+bool ParseStreamCodec(std::string_view name, StreamCodec* codec) {
+  std::string lower(name);
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  for (const auto c :
+       {StreamCodec::kZstd, StreamCodec::kLz4, StreamCodec::kXz}) {
+    if (lower == StreamCodecName(c)) {
+      *codec = c;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::unique_ptr<StreamCompressor> StreamCompressor::Create(
+    StreamCodec codec, const StreamOptions& options) {
+  switch (codec) {
+    case StreamCodec::kZstd:
+      return Make<ZstdCompressor>(options);
+    case StreamCodec::kLz4:
+      return Make<Lz4Compressor>(options);
+    case StreamCodec::kXz:
+      return Make<XzCompressor>(options);
+  }
+  return nullptr;
+}
+
+std::unique_ptr<StreamDecompressor> StreamDecompressor::Create(
+    StreamCodec codec, int threads) {
+  switch (codec) {
+    case StreamCodec::kZstd:
+      return Make<ZstdDecompressor>();
+    case StreamCodec::kLz4:
+      return Make<Lz4Decompressor>();
+    case StreamCodec::kXz:
+      return Make<XzDecompressor>(threads);
+  }
+  return nullptr;
+}
+
+bool StreamCompression::CompressFile(StreamCodec codec, const std::string& src,
+                                     const std::string& dst,
+                                     const StreamOptions& options) {
+  auto compressor = StreamCompressor::Create(codec, options);
+  return compressor && Pump(src, dst, compressor.get());
+}
+
+bool StreamCompression::DecompressFile(StreamCodec codec,
+                                       const std::string& src,
+                                       const std::string& dst, int threads) {
+  auto decompressor = StreamDecompressor::Create(codec, threads);
+  return decompressor && Pump(src, dst, decompressor.get());
+}
+
+}  // namespace util
+}  // namespace tbox
@@ -0,0 +1,106 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifndef TBOX_UTIL_STREAM_COMPRESSION_H_
+#define TBOX_UTIL_STREAM_COMPRESSION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace tbox {
+namespace util {
+
+/// @brief Container formats for streaming compression.
+/// @details All of them produce standard frames readable by the zstd, lz4 and
+///          xz command line tools.
+enum class StreamCodec {
+  kZstd = 0,
+  kLz4 = 1,
+  kXz = 2,
+};
+
+/// @brief Textual codec name, "zstd", "lz4" or "xz".
+const char* StreamCodecName(StreamCodec codec);
+
+/// @brief Parse a codec name, case insensitive.
+bool ParseStreamCodec(std::string_view name, StreamCodec* codec);
+
+struct StreamOptions {
+  /// Codec level, 0 for the codec default.
+  int level = 0;
+  /// Worker threads, 0 for one per core. zstd and xz split the input into
+  /// independent jobs compressed in parallel, LZ4 is always single threaded.
+  int threads = 0;
+  /// Append a content checksum to every frame.
+  bool checksum = true;
+};
+
+/// @brief Push chunks in, pull compressed bytes out.
+/// @details Memory use is bounded by the codec window and the worker job
+///          size, not by the amount of data passed through, so multi-GB
+///          archives can be compressed chunk by chunk. Output is appended to
+///          the caller's buffer, which may be drained between calls.
+class StreamCompressor {
+ public:
+  virtual ~StreamCompressor() = default;
+
+  /// @return nullptr if the codec context can not be created.
+  static std::unique_ptr<StreamCompressor> Create(
+      StreamCodec codec, const StreamOptions& options = StreamOptions());
+
+  /// @brief Compress input, appending whatever output is ready to out.
+  virtual bool Write(std::string_view input, std::string* out) = 0;
+
+  /// @brief Emit everything written so far, so a reader can decode it
+  ///        without waiting for Finish(). Costs some ratio, use sparingly.
+  virtual bool Flush(std::string* out) = 0;
+
+  /// @brief End the frame. The compressor can not be written to afterwards.
+  virtual bool Finish(std::string* out) = 0;
+};
+
+/// @brief Push compressed chunks in, pull decompressed bytes out.
+/// @details Concatenated frames are decoded as one stream. Decoder memory is
+///          capped whatever the input claims: zstd frames with a window over
+///          128 MiB and xz streams needing more than 256 MiB are rejected.
+class StreamDecompressor {
+ public:
+  virtual ~StreamDecompressor() = default;
+
+  /// @param threads Decoder threads, only used by xz for multi block input.
+  static std::unique_ptr<StreamDecompressor> Create(StreamCodec codec,
+                                                    int threads = 1);
+
+  /// @brief Decompress input, appending the decoded bytes to out.
+  /// @return false on corrupt input or input over the memory cap.
+  virtual bool Write(std::string_view input, std::string* out) = 0;
+
+  /// @brief Signal the end of input, appending any remaining output.
+  /// @return false if the input stopped in the middle of a frame.
+  virtual bool Finish(std::string* out) = 0;
+};
+
+class StreamCompression final {
+ public:
+  /// Chunk size used when reading files.
+  static constexpr size_t kChunkSize = 1024 * 1024;
+
+  /// @brief Compress the file at src into dst with bounded memory.
+  static bool CompressFile(StreamCodec codec, const std::string& src,
+                           const std::string& dst,
+                           const StreamOptions& options = StreamOptions());
+
+  /// @brief Decompress the file at src into dst with bounded memory.
+  static bool DecompressFile(StreamCodec codec, const std::string& src,
+                             const std::string& dst, int threads = 1);
+};
+
+}  // namespace util
+}  // namespace tbox
+
+#endif  // TBOX_UTIL_STREAM_COMPRESSION_H_
@@ -0,0 +1,201 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+#include "src/util/stream_compression.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lzma.h"
+
+namespace tbox {
+namespace util {
+namespace {
+
+constexpr StreamCodec kCodecs[] = {StreamCodec::kZstd, StreamCodec::kLz4,
+                                   StreamCodec::kXz};
+
+// Log like text, compressible but not trivially so.
+std::string LogData(size_t size) {
+  std::mt19937 rng(7);
+  std::string data;
+  while (data.size() < size) {
+    data += "2024-06-01 12:00:" + std::to_string(rng() % 60) +
+            " INFO client " + std::to_string(rng() % 1000) +
+            " reported ip 10.0." + std::to_string(rng() % 256) + "\n";
+  }
+  data.resize(size);
+  return data;
+}
+
+std::string Decompress(StreamCodec codec, const std::string& compressed,
+                       size_t chunk) {
+  auto decompressor = StreamDecompressor::Create(codec, 2);
+  EXPECT_NE(decompressor, nullptr);
+  std::string out;
+  for (size_t i = 0; i < compressed.size(); i += chunk) {
+    EXPECT_TRUE(decompressor->Write(
+        std::string_view(compressed).substr(i, chunk), &out));
+  }
+  EXPECT_TRUE(decompressor->Finish(&out));
+  return out;
+}
+
+TEST(StreamCompression, ChunkedRoundTrip) {
+  const std::string data = LogData(8 << 20);
+  for (const auto codec : kCodecs) {
+    for (const int threads : {1, 4}) {
+      StreamOptions options;
+      options.threads = threads;
+      options.level = 1;
+      auto compressor = StreamCompressor::Create(codec, options);
+      ASSERT_NE(compressor, nullptr);
+      std::string compressed;
+      for (size_t i = 0; i < data.size(); i += 100000) {
+        ASSERT_TRUE(compressor->Write(
+            std::string_view(data).substr(i, 100000), &compressed));
+      }
+      ASSERT_TRUE(compressor->Finish(&compressed));
+      EXPECT_LT(compressed.size(), data.size() / 3)
+          << StreamCodecName(codec);
+      EXPECT_EQ(Decompress(codec, compressed, 4096), data)
+          << StreamCodecName(codec) << " threads " << threads;
+    }
+  }
+}
+
+TEST(StreamCompression, FlushMakesPrefixReadable) {
+  const std::string first = LogData(10000);
+  for (const auto codec : kCodecs) {
+    auto compressor = StreamCompressor::Create(codec);
+    auto decompressor = StreamDecompressor::Create(codec);
+    std::string compressed;
+    ASSERT_TRUE(compressor->Write(first, &compressed));
+    ASSERT_TRUE(compressor->Flush(&compressed));
+    std::string out;
+    ASSERT_TRUE(decompressor->Write(compressed, &out));
+    EXPECT_EQ(out, first) << StreamCodecName(codec);
+
+    compressed.clear();
+    ASSERT_TRUE(compressor->Write("tail", &compressed));
+    ASSERT_TRUE(compressor->Finish(&compressed));
+    ASSERT_TRUE(decompressor->Write(compressed, &out));
+    ASSERT_TRUE(decompressor->Finish(&out));
+    EXPECT_EQ(out, first + "tail") << StreamCodecName(codec);
+  }
+}
+
+TEST(StreamCompression, EmptyAndConcatenated) {
+  for (const auto codec : kCodecs) {
+    std::string compressed;
+    for (const std::string& part : {std::string(), std::string("abc")}) {
+      auto compressor = StreamCompressor::Create(codec);
+      ASSERT_TRUE(compressor->Write(part, &compressed));
+      ASSERT_TRUE(compressor->Finish(&compressed));
+    }
+    EXPECT_EQ(Decompress(codec, compressed, 3), "abc")
+        << StreamCodecName(codec);
+  }
+}
+
+TEST(StreamCompression, RejectsTruncatedAndCorrupt) {
+  const std::string data = LogData(100000);
+  for (const auto codec : kCodecs) {
+    auto compressor = StreamCompressor::Create(codec);
+    std::string compressed;
+    ASSERT_TRUE(compressor->Write(data, &compressed));
+    ASSERT_TRUE(compressor->Finish(&compressed));
+
+    std::string out;
+    auto truncated = StreamDecompressor::Create(codec);
+    EXPECT_TRUE(truncated->Write(
+        std::string_view(compressed).substr(0, compressed.size() / 2), &out));
+    EXPECT_FALSE(truncated->Finish(&out)) << StreamCodecName(codec);
+
+    auto corrupt = StreamDecompressor::Create(codec);
+    EXPECT_FALSE(corrupt->Write("not a compressed stream", &out))
+        << StreamCodecName(codec);
+  }
+}
+
+// Skips a variable length integer of the xz format.
+size_t SkipVli(const std::string& s, size_t pos) {
+  while (static_cast<uint8_t>(s[pos]) & 0x80) {
+    ++pos;
+  }
+  return pos + 1;
+}
+
+TEST(StreamCompression, XzDecoderMemoryIsCapped) {
+  auto compressor = StreamCompressor::Create(StreamCodec::kXz);
+  std::string xz;
+  ASSERT_TRUE(compressor->Write(LogData(10000), &xz));
+  ASSERT_TRUE(compressor->Finish(&xz));
+
+  // Claim a 4 GiB dictionary in the first block header: after the 12 byte
+  // stream header come its size, flags, optional sizes, then the LZMA2
+  // filter id, property size and dictionary size byte; a CRC32 ends it.
+  const size_t block = 12;
+  const size_t header_size = (static_cast<uint8_t>(xz[block]) + 1) * 4;
+  const uint8_t flags = xz[block + 1];
+  size_t pos = block + 2;
+  if (flags & 0x40) {
+    pos = SkipVli(xz, pos);
+  }
+  if (flags & 0x80) {
+    pos = SkipVli(xz, pos);
+  }
+  ASSERT_EQ(xz[pos], LZMA_FILTER_LZMA2);
+  ASSERT_EQ(xz[pos + 1], 1);
+  xz[pos + 2] = 40;
+  const uint32_t crc = lzma_crc32(
+      reinterpret_cast<const uint8_t*>(xz.data() + block), header_size - 4, 0);
+  for (int i = 0; i < 4; ++i) {
+    xz[block + header_size - 4 + i] = static_cast<char>(crc >> (8 * i));
+  }
+
+  for (const int threads : {1, 4}) {
+    auto decompressor = StreamDecompressor::Create(StreamCodec::kXz, threads);
+    std::string out;
+    EXPECT_FALSE(decompressor->Write(xz, &out) && decompressor->Finish(&out))
+        << "threads " << threads;
+  }
+}
+
+TEST(StreamCompression, File) {
+  const auto dir = std::filesystem::temp_directory_path() /
+                   "stream_compression_test";
+  std::filesystem::create_directories(dir);
+  const std::string data = LogData(3 * StreamCompression::kChunkSize + 17);
+  const std::string src = (dir / "src").string();
+  std::ofstream(src, std::ios::binary) << data;
+  for (const auto codec : kCodecs) {
+    const std::string packed = (dir / "packed").string();
+    const std::string unpacked = (dir / "unpacked").string();
+    ASSERT_TRUE(StreamCompression::CompressFile(codec, src, packed));
+    ASSERT_TRUE(StreamCompression::DecompressFile(codec, packed, unpacked));
+    std::ifstream in(unpacked, std::ios::binary);
+    const std::string out((std::istreambuf_iterator<char>(in)),
+                          std::istreambuf_iterator<char>());
+    EXPECT_EQ(out, data) << StreamCodecName(codec);
+  }
+  EXPECT_FALSE(StreamCompression::CompressFile(
+      StreamCodec::kZstd, (dir / "missing").string(), (dir / "x").string()));
+  std::filesystem::remove_all(dir);
+}
+
+TEST(StreamCompression, ParseCodec) {
+  StreamCodec codec;
+  ASSERT_TRUE(ParseStreamCodec("XZ", &codec));
+  EXPECT_EQ(codec, StreamCodec::kXz);
+  EXPECT_FALSE(ParseStreamCodec("gzip", &codec));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tbox
@@ -25,7 +25,6 @@
 #include "boost/algorithm/string/predicate.hpp"
 #include "boost/algorithm/string/split.hpp"
 #include "boost/algorithm/string/trim_all.hpp"
-#include "boost/beast/core/detail/base64.hpp"
 #include "boost/uuid/random_generator.hpp"
 #include "boost/uuid/uuid_io.hpp"
 #include "crc32c/crc32c.h"
@@ -43,6 +42,7 @@
 #include "src/common/error.h"
 #include "src/common/logging.h"
 #include "src/proto/service.pb.h"
+#include "src/util/simd_codec.h"
 
 #if defined(_WIN32)
 #include <iphlpapi.h>
@@ -319,15 +319,13 @@ string Util::ToHexStr(const uint64_t in, const bool use_upper_case) {
 }
 
 void Util::ToHexStr(const string& in, string* out, const bool use_upper_case) {
-  out->clear();
-  out->reserve(in.size() * 2);
-  for (std::size_t i = 0; i < in.size(); ++i) {
-    if (use_upper_case) {
-      out->append(fmt::format("{:02X}", (unsigned char)in[i]));
-    } else {
-      out->append(fmt::format("{:02x}", (unsigned char)in[i]));
-    }
-  }
+  out->resize(SimdCodec::HexEncodedSize(in.size()));
+  SimdCodec::HexEncode(in, out->data(), use_upper_case);
+}
+
+void Util::ToHexStr(std::string_view in, char* out,
+                    const bool use_upper_case) {
+  SimdCodec::HexEncode(in, out, use_upper_case);
 }
 
 string Util::ToHexStr(const string& in, const bool use_upper_case) {
@@ -337,7 +335,12 @@ string Util::ToHexStr(const string& in, const bool use_upper_case) {
 }
 
 bool Util::HexToStr(const string& in, string* out) {
-  return folly::unhexlify(in, *out);
+  out->resize(in.size() / 2);
+  return SimdCodec::HexDecode(in, out->data());
+}
+
+bool Util::HexToStr(std::string_view in, char* out) {
+  return SimdCodec::HexDecode(in, out);
 }
 
 string Util::HexToStr(const string& in) {
@@ -406,10 +409,12 @@ bool Util::FileBlake3(const string& path, string* out,
 }
 
 void Util::Base64Encode(const string& input, string* out) {
-  out->resize(boost::beast::detail::base64::encoded_size(input.size()));
-  auto const ret = boost::beast::detail::base64::encode(
-      out->data(), input.data(), input.size());
-  out->resize(ret);
+  out->resize(SimdCodec::Base64EncodedSize(input.size()));
+  out->resize(SimdCodec::Base64Encode(input, out->data()));
+}
+
+size_t Util::Base64Encode(std::string_view input, char* out) {
+  return SimdCodec::Base64Encode(input, out);
 }
 
 string Util::Base64Encode(const string& input) {
@@ -419,11 +424,16 @@ string Util::Base64Encode(const string& input) {
 }
 
 void Util::Base64Decode(const string& input, string* out) {
-  out->resize(boost::beast::detail::base64::decoded_size(input.size()));
-  auto const ret = boost::beast::detail::base64::decode(
-      out->data(), input.data(), input.size());
-  out->resize(ret.first);
-  return;
+  out->resize(SimdCodec::Base64DecodedSize(input.size()));
+  size_t size = 0;
+  if (!SimdCodec::Base64Decode(input, out->data(), &size)) {
+    size = 0;
+  }
+  out->resize(size);
+}
+
+bool Util::Base64Decode(std::string_view input, char* out, size_t* out_size) {
+  return SimdCodec::Base64Decode(input, out, out_size);
 }
 
 string Util::Base64Decode(const string& input) {
@@ -118,8 +118,16 @@ class Util final {
 
   static void Base64Encode(const std::string& input, std::string* out);
 
+  /// @brief Invalid input yields an empty out.
   static void Base64Decode(const std::string& input, std::string* out);
 
+  /// @brief Allocation free variants, out must hold
+  ///        SimdCodec::Base64EncodedSize / Base64DecodedSize bytes.
+  static size_t Base64Encode(std::string_view input, char* out);
+
+  static bool Base64Decode(std::string_view input, char* out,
+                           size_t* out_size);
+
   static uint32_t CRC32(const std::string& content);
 
   static bool Blake3(const std::string& content, std::string* out,
@@ -191,6 +199,12 @@ class Util final {
   static std::string HexToStr(const std::string& in);
   static bool HexToStr(const std::string& in, std::string* out);
 
+  /// @brief Allocation free variants, out holds 2 * in.size() hex digits
+  ///        or in.size() / 2 decoded bytes.
+  static void ToHexStr(std::string_view in, char* out,
+                       const bool use_upper_case = false);
+  static bool HexToStr(std::string_view in, char* out);
+
   static int64_t MurmurHash64A(const std::string& str);
 
   static bool LZMACompress(const std::string& data, std::string* out);
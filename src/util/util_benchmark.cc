@@ -0,0 +1,1015 @@
+/*******************************************************************************
+ * Copyright (c) 2024  xiedeacc.com.
+ * All rights reserved.
+ *******************************************************************************/
+
+// Cost of every public Util function, grouped as in util.h, over the input
+// sizes the server sees: 16 to 64 byte ids, nonces and digests, 1 KiB
+// messages and 64 KiB to 1 MiB certificate files and bodies. Fixed cost
+// helpers (UUID, time formatting, IP enumeration) take no size.
+//
+// The context printed before the results has the SIMD kernels SimdCodec
+// picked (simd_codec_isa) and the CPU features the hashing libraries
+// dispatch on (cpu_features), so runs on different hosts compare. The hex
+// and base64 rows are labelled with the kernel they ran on; set
+// --simd_codec_isa=scalar to measure without vector code.
+//
+// Not covered: Sleep, PrintProtoMessage (writes to stdout),
+// ResolveDomainToIPv6 (queries DNS) and WriteToFile (Util cannot be
+// constructed, so the member function cannot be called).
+//
+//   bazel run -c opt //src/util:util_benchmark
+//   bazel run -c opt //src/util:util_benchmark -- --benchmark_filter=UUID
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+#include "benchmark/benchmark.h"
+#include "folly/IPAddress.h"
+#include "openssl/evp.h"
+#include "src/proto/service.pb.h"
+#include "src/util/simd_codec.h"
+#include "src/util/util.h"
+
+namespace tbox {
+namespace util {
+namespace {
+
+constexpr int64_t kTimestampMillis = 1718000000123;
+constexpr const char* kTimeFormat = "%Y-%m-%d%ET%H:%M:%E3S%Ez";
+constexpr const char* kTimeStr = "2024-06-10T06:13:20.123+00:00";
+
+std::string Data(size_t size) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<char>(i * 131 + 7);
+  }
+  return data;
+}
+
+// Printable text, compressible like a config or a log.
+std::string Text(size_t size) {
+  static constexpr char kWords[] =
+      "client report token domain certificate server update session ";
+  std::string text;
+  text.reserve(size);
+  while (text.size() < size) {
+    text.append(kWords, std::min(sizeof(kWords) - 1, size - text.size()));
+  }
+  return text;
+}
+
+// A file of size bytes, removed at exit.
+class TempFile final {
+ public:
+  explicit TempFile(size_t size)
+      : path_((std::filesystem::temp_directory_path() /
+               ("util_benchmark." + std::to_string(getpid()) + "." +
+                std::to_string(size)))
+                  .string()) {
+    std::ofstream(path_, std::ios::binary) << Data(size);
+  }
+  ~TempFile() { std::remove(path_.c_str()); }
+
+  const std::string& path() const { return path_; }
+
+ private:
+  const std::string path_;
+};
+
+proto::ReportRequest Report() {
+  proto::ReportRequest req;
+  req.set_request_id("5f0c6a3e-8f4b-4f7e-9c55-0a8f3d0b6c21");
+  req.set_op(proto::OpCode::OP_REPORT);
+  req.add_client_ip("203.0.113.7");
+  req.add_client_ip("2001:db8::7");
+  req.set_timestamp(kTimestampMillis / 1000);
+  req.set_client_info("linux x86_64");
+  req.set_token(std::string(64, 'a'));
+  req.set_client_id("home-nas-001");
+  req.add_monitor_domains("nas.example.com");
+  return req;
+}
+
+void SizeArgs(benchmark::internal::Benchmark* b) {
+  for (const int size : {16, 1024, 64 << 10}) {
+    b->Arg(size);
+  }
+}
+
+void CodecArgs(benchmark::internal::Benchmark* b) {
+  for (const int size : {32, 1024, 1 << 20}) {
+    b->Arg(size);
+  }
+}
+
+void FileArgs(benchmark::internal::Benchmark* b) {
+  for (const int size : {4 << 10, 1 << 20}) {
+    b->Arg(size);
+  }
+}
+
+void LabelIsa(benchmark::State& state) {
+  state.SetLabel(SimdCodec::IsaName(SimdCodec::Active()));
+}
+
+// Time.
+
+void BM_CurrentTimeMillis(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::CurrentTimeMillis());
+  }
+}
+BENCHMARK(BM_CurrentTimeMillis);
+
+void BM_CurrentTimeSeconds(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::CurrentTimeSeconds());
+  }
+}
+BENCHMARK(BM_CurrentTimeSeconds);
+
+void BM_CurrentTimeNanos(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::CurrentTimeNanos());
+  }
+}
+BENCHMARK(BM_CurrentTimeNanos);
+
+void BM_ToTimeStr(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::ToTimeStr());
+  }
+}
+BENCHMARK(BM_ToTimeStr);
+
+void BM_ToTimeStrTimestamp(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::ToTimeStr(kTimestampMillis));
+  }
+}
+BENCHMARK(BM_ToTimeStrTimestamp);
+
+void BM_ToTimeStrFormat(benchmark::State& state) {
+  const std::string format = "%Y-%m-%d %H:%M:%S";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::ToTimeStr(kTimestampMillis, format));
+  }
+}
+BENCHMARK(BM_ToTimeStrFormat);
+
+void BM_ToTimeStrZone(benchmark::State& state) {
+  const std::string format = kTimeFormat;
+  const std::string zone = "Asia/Shanghai";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::ToTimeStr(kTimestampMillis, format, zone));
+  }
+}
+BENCHMARK(BM_ToTimeStrZone);
+
+void BM_ToTimeStrUTC(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::ToTimeStrUTC());
+  }
+}
+BENCHMARK(BM_ToTimeStrUTC);
+
+void BM_ToTimeStrUTCFormat(benchmark::State& state) {
+  const std::string format = kTimeFormat;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::ToTimeStrUTC(kTimestampMillis, format));
+  }
+}
+BENCHMARK(BM_ToTimeStrUTCFormat);
+
+void BM_StrToTimeStamp(benchmark::State& state) {
+  const std::string time = kTimeStr;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::StrToTimeStamp(time));
+  }
+}
+BENCHMARK(BM_StrToTimeStamp);
+
+void BM_StrToTimeStampFormat(benchmark::State& state) {
+  const std::string time = "2024-06-10 06:13:20";
+  const std::string format = "%Y-%m-%d %H:%M:%S";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::StrToTimeStamp(time, format));
+  }
+}
+BENCHMARK(BM_StrToTimeStampFormat);
+
+void BM_StrToTimeStampZone(benchmark::State& state) {
+  const std::string time = "2024-06-10 14:13:20";
+  const std::string format = "%Y-%m-%d %H:%M:%S";
+  const std::string zone = "Asia/Shanghai";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::StrToTimeStamp(time, format, zone));
+  }
+}
+BENCHMARK(BM_StrToTimeStampZone);
+
+void BM_StrToTimeStampUTC(benchmark::State& state) {
+  const std::string time = kTimeStr;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::StrToTimeStampUTC(time));
+  }
+}
+BENCHMARK(BM_StrToTimeStampUTC);
+
+void BM_StrToTimeStampUTCFormat(benchmark::State& state) {
+  const std::string time = "2024-06-10 06:13:20";
+  const std::string format = "%Y-%m-%d %H:%M:%S";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::StrToTimeStampUTC(time, format));
+  }
+}
+BENCHMARK(BM_StrToTimeStampUTCFormat);
+
+void BM_ToTimeSpec(benchmark::State& state) {
+  int64_t ts = kTimestampMillis;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::ToTimeSpec(ts++));
+  }
+}
+BENCHMARK(BM_ToTimeSpec);
+
+// Randomness.
+
+void BM_Random(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::Random(0, 1000000));
+  }
+}
+BENCHMARK(BM_Random);
+
+void BM_UUID(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::UUID());
+  }
+}
+BENCHMARK(BM_UUID);
+
+void BM_FillSecureRandomBytes(benchmark::State& state) {
+  std::string bytes(state.range(0), '\0');
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::FillSecureRandomBytes(&bytes));
+  }
+  state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_FillSecureRandomBytes)->Arg(16)->Arg(32)->Arg(1024);
+
+// Strings.
+
+void BM_ToUpper(benchmark::State& state) {
+  const std::string text = Text(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::ToUpper(text));
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_ToUpper)->Apply(SizeArgs);
+
+void BM_ToLower(benchmark::State& state) {
+  const std::string text = Util::ToUpper(Text(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::ToLower(text));
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_ToLower)->Apply(SizeArgs);
+
+void BM_ToLowerInPlace(benchmark::State& state) {
+  const std::string upper = Util::ToUpper(Text(state.range(0)));
+  std::string text;
+  for (auto _ : state) {
+    text.assign(upper);
+    Util::ToLower(&text);
+    benchmark::DoNotOptimize(text.data());
+  }
+  state.SetBytesProcessed(state.iterations() * upper.size());
+}
+BENCHMARK(BM_ToLowerInPlace)->Apply(SizeArgs);
+
+void BM_Trim(benchmark::State& state) {
+  const std::string text = "  \t" + Text(state.range(0)) + " \r\n";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::Trim(text));
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_Trim)->Apply(SizeArgs);
+
+void BM_TrimInPlace(benchmark::State& state) {
+  const std::string padded = "  \t" + Text(state.range(0)) + " \r\n";
+  std::string text;
+  for (auto _ : state) {
+    text.assign(padded);
+    Util::Trim(&text);
+    benchmark::DoNotOptimize(text.data());
+  }
+  state.SetBytesProcessed(state.iterations() * padded.size());
+}
+BENCHMARK(BM_TrimInPlace)->Apply(SizeArgs);
+
+void BM_ToInt(benchmark::State& state) {
+  const std::string number = "1718000000123";
+  for (auto _ : state) {
+    int64_t value = 0;
+    benchmark::DoNotOptimize(Util::ToInt(number, &value));
+    benchmark::DoNotOptimize(Util::ToInt<int64_t>(number));
+  }
+}
+BENCHMARK(BM_ToInt);
+
+void BM_StartWith(benchmark::State& state) {
+  const std::string text = Text(state.range(0));
+  const std::string prefix = text.substr(0, text.size() / 2);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::StartWith(text, prefix));
+  }
+}
+BENCHMARK(BM_StartWith)->Apply(SizeArgs);
+
+void BM_EndWith(benchmark::State& state) {
+  const std::string text = Text(state.range(0));
+  const std::string postfix = text.substr(text.size() / 2);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::EndWith(text, postfix));
+  }
+}
+BENCHMARK(BM_EndWith)->Apply(SizeArgs);
+
+void BM_ReplaceAll(benchmark::State& state) {
+  const std::string original = Text(state.range(0));
+  const std::string from = "token";
+  const std::string to = "TOKEN";
+  std::string text;
+  for (auto _ : state) {
+    text.assign(original);
+    Util::ReplaceAll(&text, from, to);
+    benchmark::DoNotOptimize(text.data());
+  }
+  state.SetBytesProcessed(state.iterations() * original.size());
+}
+BENCHMARK(BM_ReplaceAll)->Apply(SizeArgs);
+
+void BM_ReplaceAllNumber(benchmark::State& state) {
+  const std::string original = Text(state.range(0));
+  std::string text;
+  for (auto _ : state) {
+    text.assign(original);
+    Util::ReplaceAll(&text, "token", 42);
+    benchmark::DoNotOptimize(text.data());
+  }
+  state.SetBytesProcessed(state.iterations() * original.size());
+}
+BENCHMARK(BM_ReplaceAllNumber)->Apply(SizeArgs);
+
+// Arg 0 is the number of comma separated fields, arg 1 trim_empty.
+void BM_Split(benchmark::State& state) {
+  std::string line;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    line.append(i == 0 ? "" : ",").append("field" + std::to_string(i));
+  }
+  const bool trim_empty = state.range(1) != 0;
+  std::vector<std::string> fields;
+  for (auto _ : state) {
+    Util::Split(line, ",", &fields, trim_empty);
+    benchmark::DoNotOptimize(fields.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Split)->ArgsProduct({{4, 64, 1024}, {0, 1}});
+
+// Hex and base64.
+
+void BM_Base64Encode(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::Base64Encode(data));
+  }
+  LabelIsa(state);
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_Base64Encode)->Apply(CodecArgs);
+
+void BM_Base64EncodeOut(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  std::string out;
+  for (auto _ : state) {
+    Util::Base64Encode(data, &out);
+    benchmark::DoNotOptimize(out.data());
+  }
+  LabelIsa(state);
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_Base64EncodeOut)->Apply(CodecArgs);
+
+void BM_Base64EncodeBuffer(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  std::string out(SimdCodec::Base64EncodedSize(data.size()), '\0');
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::Base64Encode(data, out.data()));
+  }
+  LabelIsa(state);
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_Base64EncodeBuffer)->Apply(CodecArgs);
+
+void BM_Base64Decode(benchmark::State& state) {
+  const std::string encoded = Util::Base64Encode(Data(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::Base64Decode(encoded));
+  }
+  LabelIsa(state);
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_Base64Decode)->Apply(CodecArgs);
+
+void BM_Base64DecodeOut(benchmark::State& state) {
+  const std::string encoded = Util::Base64Encode(Data(state.range(0)));
+  std::string out;
+  for (auto _ : state) {
+    Util::Base64Decode(encoded, &out);
+    benchmark::DoNotOptimize(out.data());
+  }
+  LabelIsa(state);
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_Base64DecodeOut)->Apply(CodecArgs);
+
+void BM_Base64DecodeBuffer(benchmark::State& state) {
+  const std::string encoded = Util::Base64Encode(Data(state.range(0)));
+  std::string out(SimdCodec::Base64DecodedSize(encoded.size()), '\0');
+  size_t size = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::Base64Decode(encoded, out.data(), &size));
+  }
+  LabelIsa(state);
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_Base64DecodeBuffer)->Apply(CodecArgs);
+
+void BM_ToHexStrInt(benchmark::State& state) {
+  uint64_t value = 0x0123456789abcdefULL;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::ToHexStr(value++));
+  }
+}
+BENCHMARK(BM_ToHexStrInt);
+
+void BM_ToHexStr(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::ToHexStr(data));
+  }
+  LabelIsa(state);
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ToHexStr)->Apply(CodecArgs);
+
+void BM_ToHexStrOut(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  std::string out;
+  for (auto _ : state) {
+    Util::ToHexStr(data, &out);
+    benchmark::DoNotOptimize(out.data());
+  }
+  LabelIsa(state);
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ToHexStrOut)->Apply(CodecArgs);
+
+void BM_ToHexStrBuffer(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  std::string out(SimdCodec::HexEncodedSize(data.size()), '\0');
+  for (auto _ : state) {
+    Util::ToHexStr(std::string_view(data), out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  LabelIsa(state);
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ToHexStrBuffer)->Apply(CodecArgs);
+
+void BM_HexToStr(benchmark::State& state) {
+  const std::string hex = Util::ToHexStr(Data(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::HexToStr(hex));
+  }
+  LabelIsa(state);
+  state.SetBytesProcessed(state.iterations() * hex.size());
+}
+BENCHMARK(BM_HexToStr)->Apply(CodecArgs);
+
+void BM_HexToStrOut(benchmark::State& state) {
+  const std::string hex = Util::ToHexStr(Data(state.range(0)));
+  std::string out;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::HexToStr(hex, &out));
+  }
+  LabelIsa(state);
+  state.SetBytesProcessed(state.iterations() * hex.size());
+}
+BENCHMARK(BM_HexToStrOut)->Apply(CodecArgs);
+
+void BM_HexToStrBuffer(benchmark::State& state) {
+  const std::string hex = Util::ToHexStr(Data(state.range(0)));
+  std::string out(hex.size() / 2, '\0');
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        Util::HexToStr(std::string_view(hex), out.data()));
+  }
+  LabelIsa(state);
+  state.SetBytesProcessed(state.iterations() * hex.size());
+}
+BENCHMARK(BM_HexToStrBuffer)->Apply(CodecArgs);
+
+void BM_HexStrToInt64(benchmark::State& state) {
+  const std::string hex = "7fedcba987654321";
+  int64_t value = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::HexStrToInt64(hex, &value));
+  }
+}
+BENCHMARK(BM_HexStrToInt64);
+
+// Checksums and hashes of memory.
+
+void BM_CRC32(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::CRC32(data));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_CRC32)->Apply(SizeArgs);
+
+void BM_MurmurHash64A(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::MurmurHash64A(data));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_MurmurHash64A)->Apply(SizeArgs);
+
+void BM_Blake3(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  std::string out;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::Blake3(data, &out));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_Blake3)->Apply(SizeArgs);
+
+void BM_MD5(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  std::string out;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::MD5(data, &out));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_MD5)->Apply(SizeArgs);
+
+void BM_SHA256(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  std::string out;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::SHA256(data, &out));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_SHA256)->Apply(SizeArgs);
+
+void BM_SHA256Return(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::SHA256(data));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_SHA256Return)->Apply(SizeArgs);
+
+void BM_SHA256_libsodium(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  std::string out;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::SHA256_libsodium(data, &out));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_SHA256_libsodium)->Apply(SizeArgs);
+
+void BM_HashSHA512(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  std::string out;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::Hash(data, EVP_sha512(), &out));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_HashSHA512)->Apply(SizeArgs);
+
+// The data fed in 1 KiB updates, as a stream would be.
+void BM_SHA256Stream(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  std::vector<std::string> chunks;
+  for (size_t i = 0; i < data.size(); i += 1024) {
+    chunks.push_back(data.substr(i, 1024));
+  }
+  std::string out;
+  for (auto _ : state) {
+    EVP_MD_CTX* context = Util::SHA256Init();
+    for (const std::string& chunk : chunks) {
+      Util::SHA256Update(context, chunk);
+    }
+    benchmark::DoNotOptimize(Util::SHA256Final(context, &out));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_SHA256Stream)->Apply(SizeArgs);
+
+void BM_HashStreamSHA512(benchmark::State& state) {
+  const std::string data = Data(state.range(0));
+  std::vector<std::string> chunks;
+  for (size_t i = 0; i < data.size(); i += 1024) {
+    chunks.push_back(data.substr(i, 1024));
+  }
+  std::string out;
+  for (auto _ : state) {
+    EVP_MD_CTX* context = Util::HashInit(EVP_sha512());
+    for (const std::string& chunk : chunks) {
+      Util::HashUpdate(context, chunk);
+    }
+    benchmark::DoNotOptimize(Util::HashFinal(context, &out));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_HashStreamSHA512)->Apply(SizeArgs);
+
+// Files, hot in the page cache.
+
+void BM_LoadSmallFile(benchmark::State& state) {
+  const TempFile file(state.range(0));
+  std::string content;
+  for (auto _ : state) {
+    content.clear();
+    benchmark::DoNotOptimize(Util::LoadSmallFile(file.path(), &content));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LoadSmallFile)->Apply(FileArgs);
+
+void BM_FileBlake3(benchmark::State& state) {
+  const TempFile file(state.range(0));
+  std::string out;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::FileBlake3(file.path(), &out));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FileBlake3)->Apply(FileArgs);
+
+void BM_FileHashSHA512(benchmark::State& state) {
+  const TempFile file(state.range(0));
+  std::string out;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::FileHash(file.path(), EVP_sha512(), &out));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FileHashSHA512)->Apply(FileArgs);
+
+void BM_SmallFileHashSHA512(benchmark::State& state) {
+  const TempFile file(state.range(0));
+  std::string out;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        Util::SmallFileHash(file.path(), EVP_sha512(), &out));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SmallFileHashSHA512)->Apply(FileArgs);
+
+void BM_FileSHA256(benchmark::State& state) {
+  const TempFile file(state.range(0));
+  std::string out;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::FileSHA256(file.path(), &out));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FileSHA256)->Apply(FileArgs);
+
+void BM_SmallFileSHA256(benchmark::State& state) {
+  const TempFile file(state.range(0));
+  std::string out;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::SmallFileSHA256(file.path(), &out));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SmallFileSHA256)->Apply(FileArgs);
+
+void BM_FileMD5(benchmark::State& state) {
+  const TempFile file(state.range(0));
+  std::string out;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::FileMD5(file.path(), &out));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FileMD5)->Apply(FileArgs);
+
+void BM_SmallFileMD5(benchmark::State& state) {
+  const TempFile file(state.range(0));
+  std::string out;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::SmallFileMD5(file.path(), &out));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SmallFileMD5)->Apply(FileArgs);
+
+// Passwords, PBKDF2 with Util::kIterations rounds.
+
+void BM_GenerateSalt(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::GenerateSalt());
+  }
+}
+BENCHMARK(BM_GenerateSalt);
+
+void BM_HashPassword(benchmark::State& state) {
+  const std::string password = Util::SHA256("password");
+  const std::string salt = Util::GenerateSalt();
+  std::string hash;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::HashPassword(password, salt, &hash));
+  }
+}
+BENCHMARK(BM_HashPassword)->Unit(benchmark::kMillisecond);
+
+void BM_VerifyPassword(benchmark::State& state) {
+  const std::string password = Util::SHA256("password");
+  const std::string salt = Util::GenerateSalt();
+  std::string hash;
+  Util::HashPassword(password, salt, &hash);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::VerifyPassword(password, salt, hash));
+  }
+}
+BENCHMARK(BM_VerifyPassword)->Unit(benchmark::kMillisecond);
+
+// Compression.
+
+void BM_LZMACompress(benchmark::State& state) {
+  const std::string text = Text(state.range(0));
+  std::string out;
+  for (auto _ : state) {
+    out.clear();
+    benchmark::DoNotOptimize(Util::LZMACompress(text, &out));
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_LZMACompress)->Arg(4 << 10)->Arg(64 << 10);
+
+void BM_LZMADecompress(benchmark::State& state) {
+  const std::string text = Text(state.range(0));
+  std::string compressed;
+  Util::LZMACompress(text, &compressed);
+  std::string out;
+  for (auto _ : state) {
+    out.clear();
+    benchmark::DoNotOptimize(Util::LZMADecompress(compressed, &out));
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_LZMADecompress)->Arg(4 << 10)->Arg(64 << 10);
+
+// Protobuf JSON, on a client report.
+
+void BM_MessageToJson(benchmark::State& state) {
+  const proto::ReportRequest req = Report();
+  std::string json;
+  for (auto _ : state) {
+    json.clear();
+    benchmark::DoNotOptimize(Util::MessageToJson(req, &json));
+  }
+}
+BENCHMARK(BM_MessageToJson);
+
+void BM_MessageToJsonReturn(benchmark::State& state) {
+  const proto::ReportRequest req = Report();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::MessageToJson(req));
+  }
+}
+BENCHMARK(BM_MessageToJsonReturn);
+
+void BM_MessageToPrettyJson(benchmark::State& state) {
+  const proto::ReportRequest req = Report();
+  std::string json;
+  for (auto _ : state) {
+    json.clear();
+    benchmark::DoNotOptimize(Util::MessageToPrettyJson(req, &json));
+  }
+}
+BENCHMARK(BM_MessageToPrettyJson);
+
+void BM_JsonToMessage(benchmark::State& state) {
+  const std::string json = Util::MessageToJson(Report());
+  proto::ReportRequest req;
+  for (auto _ : state) {
+    req.Clear();
+    benchmark::DoNotOptimize(Util::JsonToMessage(json, &req));
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_JsonToMessage);
+
+// Process and host.
+
+void BM_GetEnv(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::GetEnv("HOME"));
+  }
+}
+BENCHMARK(BM_GetEnv);
+
+void BM_FDCount(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::FDCount());
+  }
+}
+BENCHMARK(BM_FDCount);
+
+void BM_MemUsage(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::MemUsage());
+  }
+}
+BENCHMARK(BM_MemUsage);
+
+void BM_IsMountPoint(benchmark::State& state) {
+  const std::string path = "/";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::IsMountPoint(path));
+  }
+}
+BENCHMARK(BM_IsMountPoint);
+
+void BM_ExecutablePath(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::ExecutablePath());
+  }
+}
+BENCHMARK(BM_ExecutablePath);
+
+void BM_HomeDir(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::HomeDir());
+  }
+}
+BENCHMARK(BM_HomeDir);
+
+void BM_ListAllIPAddresses(benchmark::State& state) {
+  std::vector<folly::IPAddress> addresses;
+  for (auto _ : state) {
+    addresses.clear();
+    Util::ListAllIPAddresses(&addresses);
+    benchmark::DoNotOptimize(addresses.data());
+  }
+}
+BENCHMARK(BM_ListAllIPAddresses);
+
+void BM_GetLocalIPv4Addresses(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::GetLocalIPv4Addresses());
+  }
+}
+BENCHMARK(BM_GetLocalIPv4Addresses);
+
+void BM_GetLocalIPv6Addresses(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::GetLocalIPv6Addresses());
+  }
+}
+BENCHMARK(BM_GetLocalIPv6Addresses);
+
+void BM_GetAllLocalIPAddresses(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::GetAllLocalIPAddresses());
+  }
+}
+BENCHMARK(BM_GetAllLocalIPAddresses);
+
+void BM_GetLoopbackAndPrivateIPAddresses(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::GetLoopbackAndPrivateIPAddresses());
+  }
+}
+BENCHMARK(BM_GetLoopbackAndPrivateIPAddresses);
+
+void BM_GetPublicIPv6Addresses(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Util::GetPublicIPv6Addresses());
+  }
+}
+BENCHMARK(BM_GetPublicIPv6Addresses);
+
+void BM_IsLanIPAddress(benchmark::State& state) {
+  const std::vector<std::string> addresses = {"192.168.1.10", "203.0.113.7",
+                                              "fd00::1", "2001:db8::7"};
+  size_t next = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        Util::IsLanIPAddress(addresses[next++ % addresses.size()]));
+  }
+}
+BENCHMARK(BM_IsLanIPAddress);
+
+// CPU features the kernels above dispatch on, as "name name ...".
+std::string CpuFeatures() {
+  std::string features;
+  const auto add = [&features](bool supported, const char* name) {
+    if (supported) {
+      features.append(features.empty() ? "" : " ").append(name);
+    }
+  };
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  add(__builtin_cpu_supports("sse4.2"), "sse4.2");
+  add(__builtin_cpu_supports("pclmul"), "pclmul");
+  add(__builtin_cpu_supports("aes"), "aes");
+  add(__builtin_cpu_supports("avx"), "avx");
+  add(__builtin_cpu_supports("avx2"), "avx2");
+  add(__builtin_cpu_supports("bmi2"), "bmi2");
+  add(__builtin_cpu_supports("avx512f"), "avx512f");
+  add(__builtin_cpu_supports("avx512bw"), "avx512bw");
+  add(__builtin_cpu_supports("sha"), "sha");
+#elif defined(__aarch64__) && defined(__linux__)
+  const unsigned long hwcap = getauxval(AT_HWCAP);  // NOLINT(runtime/int)
+  add(hwcap & HWCAP_ASIMD, "asimd");
+  add(hwcap & HWCAP_AES, "aes");
+  add(hwcap & HWCAP_PMULL, "pmull");
+  add(hwcap & HWCAP_SHA2, "sha2");
+  add(hwcap & HWCAP_CRC32, "crc32");
+#endif
+  return features.empty() ? "none detected" : features;
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tbox
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  using tbox::util::SimdCodec;
+  // --simd_codec_isa=scalar|avx2|neon, for the hex and base64 rows.
+  for (int i = 1; i < argc; ++i) {
+    constexpr const char kFlag[] = "--simd_codec_isa=";
+    if (std::strncmp(argv[i], kFlag, sizeof(kFlag) - 1) != 0) {
+      continue;
+    }
+    const char* name = argv[i] + sizeof(kFlag) - 1;
+    bool found = false;
+    for (const auto isa : {SimdCodec::Isa::kScalar, SimdCodec::Isa::kAvx2,
+                           SimdCodec::Isa::kNeon}) {
+      if (std::strcmp(name, SimdCodec::IsaName(isa)) == 0) {
+        found = SimdCodec::SetActive(isa);
+      }
+    }
+    if (!found) {
+      std::fprintf(stderr, "simd_codec_isa %s is not supported here\n", name);
+      return 1;
+    }
+    argv[i] = argv[--argc];
+    --i;
+  }
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::AddCustomContext("cpu_features", tbox::util::CpuFeatures());
+  benchmark::AddCustomContext("simd_codec_isa",
+                              SimdCodec::IsaName(SimdCodec::Active()));
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -333,5 +333,24 @@ TEST(Util, HashPassword) {
   EXPECT_EQ(standard_hashed_password, hashed_password);
 }
 
+TEST(Util, HexAndBase64) {
+  const std::string data("\x00\x01\xfe\xff tbox", 8);
+  EXPECT_EQ(Util::ToHexStr(data), "0001feff2074626f");
+  EXPECT_EQ(Util::ToHexStr(data, true), "0001FEFF2074626F");
+  EXPECT_EQ(Util::HexToStr(Util::ToHexStr(data)), data);
+  EXPECT_EQ(Util::HexToStr("0g"), "");
+
+  EXPECT_EQ(Util::Base64Encode(data), "AAH+/yB0Ym8=");
+  EXPECT_EQ(Util::Base64Decode(Util::Base64Encode(data)), data);
+  EXPECT_EQ(Util::Base64Decode("AAH+/y!0Ym8="), "");
+
+  char encoded[8];
+  char decoded[6];
+  size_t size = 0;
+  ASSERT_EQ(Util::Base64Encode(std::string_view("tbox"), encoded), 8);
+  ASSERT_TRUE(Util::Base64Decode(std::string_view(encoded, 8), decoded, &size));
+  EXPECT_EQ(std::string_view(decoded, size), "tbox");
+}
+
 }  // namespace util
 }  // namespace tbox